@@ -35,18 +35,13 @@ HitDoc*
 DefDocReader_Fetch_Doc_IMP(DefaultDocReader *self, int32_t doc_id) {
     DefaultDocReaderIVARS *const ivars = DefDocReader_IVARS(self);
     Schema   *const schema = ivars->schema;
-    InStream *const dat_in = ivars->dat_in;
-    InStream *const ix_in  = ivars->ix_in;
+    InStream *const dat_in = DefDocReader_Doc_Stream(self, doc_id);
     Hash     *const fields = Hash_new(1);
-    int64_t   start;
     uint32_t  num_fields;
     size_t    field_name_cap = 31;
     char     *field_name = (char*)MALLOCATE(field_name_cap + 1);
 
-    // Get data file pointer from index, read number of fields.
-    InStream_Seek(ix_in, (int64_t)doc_id * 8);
-    start = InStream_Read_I64(ix_in);
-    InStream_Seek(dat_in, start);
+    // Read number of fields.
     num_fields = InStream_Read_CU32(dat_in);
 
     // Decode stored data and build up the doc field by field.
@@ -9019,6 +9019,9 @@ lucy_MakeFile_write(lucy_MakeFile *self) {
         if (chaz_HeadCheck_check_header("pcre.h")) {
             chaz_CFlags_add_external_lib(link_flags, "pcre");
         }
+        if (chaz_HeadCheck_check_header("pthread.h")) {
+            chaz_CFlags_add_external_lib(link_flags, "pthread");
+        }
         if (chaz_CLI_defined(self->cli, "enable-coverage")) {
             chaz_CFlags_enable_code_coverage(link_flags);
         }
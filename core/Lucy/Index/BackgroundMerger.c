@@ -143,11 +143,17 @@ BGMerger_init(BackgroundMerger *self, Obj *index, IndexManager *manager) {
      * file.) */
     ivars->seg_writer = SegWriter_new(ivars->schema, ivars->snapshot,
                                       ivars->segment, ivars->polyreader);
+    SegWriter_Set_Index_Sort(ivars->seg_writer,
+                             IxManager_Get_Index_Sort(ivars->manager));
 
     // Grab a local ref to the DeletionsWriter.
     ivars->del_writer
         = (DeletionsWriter*)INCREF(SegWriter_Get_Del_Writer(ivars->seg_writer));
 
+    // Indexers may merge away other segments while we work, so any
+    // deletions files we write must stand on their own.
+    DelWriter_Set_Merge_Cutoff(ivars->del_writer, INT64_MAX);
+
     // Release the write lock.  Now new Indexers can start while we work in
     // the background.
     S_release_write_lock(self);
@@ -248,6 +254,30 @@ S_maybe_merge(BackgroundMerger *self) {
     return num_to_merge;
 }
 
+// If finishing the segment sorted its docs, the doc maps still point at
+// where the docs were added, so send them on to where the sort moved them.
+static void
+S_follow_index_sort(BackgroundMerger *self) {
+    BackgroundMergerIVARS *const ivars = BGMerger_IVARS(self);
+    I32Array *sort_map = SegWriter_Get_Sort_Doc_Map(ivars->seg_writer);
+    if (!sort_map) { return; }
+
+    Vector *seg_names = Hash_Keys(ivars->doc_maps);
+    for (size_t i = 0, max = Vec_Get_Size(seg_names); i < max; i++) {
+        String   *seg_name = (String*)Vec_Fetch(seg_names, i);
+        I32Array *doc_map  = (I32Array*)Hash_Fetch(ivars->doc_maps, seg_name);
+        size_t    size     = I32Arr_Get_Size(doc_map);
+        int32_t  *ints     = (int32_t*)MALLOCATE(size * sizeof(int32_t));
+        for (size_t j = 0; j < size; j++) {
+            int32_t doc_id = I32Arr_Get(doc_map, j);
+            ints[j] = doc_id ? I32Arr_Get(sort_map, (size_t)doc_id) : 0;
+        }
+        Hash_Store(ivars->doc_maps, seg_name,
+                   (Obj*)I32Arr_new_steal(ints, size));
+    }
+    DECREF(seg_names);
+}
+
 static bool
 S_merge_updated_deletions(BackgroundMerger *self) {
     BackgroundMergerIVARS *const ivars = BGMerger_IVARS(self);
@@ -404,6 +434,7 @@ BGMerger_Prepare_Commit_IMP(BackgroundMerger *self) {
 
         // Finish the segment.
         SegWriter_Finish(ivars->seg_writer);
+        S_follow_index_sort(self);
 
         // Grab the write lock.
         S_obtain_write_lock(self);
@@ -0,0 +1,43 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_BLOCKSIMILARITY
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Index/BlockSimilarity.h"
+#include "Lucy/Index/Posting/BlockPosting.h"
+
+BlockSimilarity*
+BlockSim_new() {
+    BlockSimilarity *self = (BlockSimilarity*)Class_Make_Obj(BLOCKSIMILARITY);
+    return (BlockSimilarity*)Sim_init((Similarity*)self);
+}
+
+BlockPosting*
+BlockSim_Make_Posting_IMP(BlockSimilarity *self) {
+    return BlockPost_new((Similarity*)self);
+}
+
+BlockPostingWriter*
+BlockSim_Make_Posting_Writer_IMP(BlockSimilarity *self, Schema *schema,
+                                 Snapshot *snapshot, Segment *segment,
+                                 PolyReader *polyreader, int32_t field_num) {
+    UNUSED_VAR(self);
+    return BlockPostWriter_new(schema, snapshot, segment, polyreader,
+                               field_num);
+}
+
+
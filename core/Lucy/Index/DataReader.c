@@ -32,6 +32,7 @@ DataReader_init(DataReader *self, Schema *schema, Folder *folder,
     ivars->snapshot = (Snapshot*)INCREF(snapshot);
     ivars->segments = (Vector*)INCREF(segments);
     ivars->seg_tick = seg_tick;
+    ivars->num_sharers = 0;
     if (seg_tick != -1) {
         if (!segments) {
             THROW(ERR, "No segments array provided, but seg_tick is %i32",
@@ -64,6 +65,22 @@ DataReader_Destroy_IMP(DataReader *self) {
     SUPER_DESTROY(self, DATAREADER);
 }
 
+void
+DataReader_Share_IMP(DataReader *self) {
+    DataReader_IVARS(self)->num_sharers++;
+}
+
+void
+DataReader_Close_Shared_IMP(DataReader *self) {
+    DataReaderIVARS *const ivars = DataReader_IVARS(self);
+    if (ivars->num_sharers) {
+        ivars->num_sharers--;
+    }
+    else {
+        DataReader_Close(self);
+    }
+}
+
 Schema*
 DataReader_Get_Schema_IMP(DataReader *self) {
     return DataReader_IVARS(self)->schema;
@@ -22,8 +22,10 @@
 #include "Lucy/Index/DeletionsReader.h"
 #include "Lucy/Index/BitVecDelDocs.h"
 #include "Lucy/Index/DeletionsWriter.h"
+#include "Lucy/Index/LayeredDelDocs.h"
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/Snapshot.h"
+#include "Lucy/Index/SparseDelDocs.h"
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Search/BitVecMatcher.h"
 #include "Lucy/Search/SeriesMatcher.h"
@@ -75,11 +77,6 @@ void
 PolyDelReader_Close_IMP(PolyDeletionsReader *self) {
     PolyDeletionsReaderIVARS *const ivars = PolyDelReader_IVARS(self);
     if (ivars->readers) {
-        for (size_t i = 0, max = Vec_Get_Size(ivars->readers); i < max; i++) {
-            DeletionsReader *reader
-                = (DeletionsReader*)Vec_Fetch(ivars->readers, i);
-            if (reader) { DelReader_Close(reader); }
-        }
         Vec_Clear(ivars->readers);
     }
 }
@@ -154,15 +151,8 @@ DefDelReader_Destroy_IMP(DefaultDeletionsReader *self) {
     SUPER_DESTROY(self, DEFAULTDELETIONSREADER);
 }
 
-BitVector*
-DefDelReader_Read_Deletions_IMP(DefaultDeletionsReader *self) {
-    DefaultDeletionsReaderIVARS *const ivars = DefDelReader_IVARS(self);
-    Vector  *segments    = DefDelReader_Get_Segments(self);
-    Segment *segment     = DefDelReader_Get_Segment(self);
-    String  *my_seg_name = Seg_Get_Name(segment);
-    String  *del_file    = NULL;
-    int32_t  del_count   = 0;
-
+Hash*
+DefDelReader_find_deletions(Vector *segments, String *seg_name) {
     // Start with deletions files in the most recently added segments and work
     // backwards.  The first one we find which addresses our segment is the
     // one we need.
@@ -173,24 +163,66 @@ DefDelReader_Read_Deletions_IMP(DefaultDeletionsReader *self) {
         if (metadata) {
             Hash *files = (Hash*)CERTIFY(
                               Hash_Fetch_Utf8(metadata, "files", 5), HASH);
-            Hash *seg_files_data = (Hash*)Hash_Fetch(files, my_seg_name);
+            Hash *seg_files_data = (Hash*)Hash_Fetch(files, seg_name);
             if (seg_files_data) {
-                Obj *count = (Obj*)CERTIFY(
-                                 Hash_Fetch_Utf8(seg_files_data, "count", 5),
-                                 OBJ);
-                del_count = (int32_t)Json_obj_to_i64(count);
-                del_file  = (String*)CERTIFY(
-                                Hash_Fetch_Utf8(seg_files_data, "filename", 8),
-                                STRING);
-                break;
+                return (Hash*)CERTIFY(seg_files_data, HASH);
             }
         }
     }
+    return NULL;
+}
+
+Vector*
+DefDelReader_layers(Hash *seg_files_data) {
+    Vector *base = (Vector*)Hash_Fetch_Utf8(seg_files_data, "layers", 6);
+    if (base) { CERTIFY(base, VECTOR); }
+    size_t  num    = base ? Vec_Get_Size(base) : 0;
+    Vector *layers = Vec_new(num + 1);
+    for (size_t i = 0; i < num; i++) {
+        Vec_Push(layers, INCREF(CERTIFY(Vec_Fetch(base, i), HASH)));
+    }
+    Vec_Push(layers, INCREF(seg_files_data));
+    return layers;
+}
+
+static BitVector*
+S_open_layer(Folder *folder, Hash *layer) {
+    String *filename = (String*)CERTIFY(
+                           Hash_Fetch_Utf8(layer, "filename", 8), STRING);
+    String *type = (String*)Hash_Fetch_Utf8(layer, "type", 4);
+    if (type && Str_Equals_Utf8(type, "sparse", 6)) {
+        return (BitVector*)SparseDelDocs_new(folder, filename);
+    }
+    return (BitVector*)BitVecDelDocs_new(folder, filename);
+}
+
+BitVector*
+DefDelReader_Read_Deletions_IMP(DefaultDeletionsReader *self) {
+    DefaultDeletionsReaderIVARS *const ivars = DefDelReader_IVARS(self);
+    Vector  *segments    = DefDelReader_Get_Segments(self);
+    Segment *segment     = DefDelReader_Get_Segment(self);
+    Hash    *seg_files_data
+        = DefDelReader_find_deletions(segments, Seg_Get_Name(segment));
 
     DECREF(ivars->deldocs);
-    if (del_file) {
-        ivars->deldocs = (BitVector*)BitVecDelDocs_new(ivars->folder, del_file);
-        ivars->del_count = del_count;
+    if (seg_files_data) {
+        Obj *count = (Obj*)CERTIFY(
+                         Hash_Fetch_Utf8(seg_files_data, "count", 5), OBJ);
+        Vector *layers  = DefDelReader_layers(seg_files_data);
+        size_t  num     = Vec_Get_Size(layers);
+        Vector *deldocs = Vec_new(num);
+        for (size_t i = 0; i < num; i++) {
+            Hash *layer = (Hash*)Vec_Fetch(layers, i);
+            Vec_Push(deldocs, (Obj*)S_open_layer(ivars->folder, layer));
+        }
+
+        // Stack files which add to earlier ones rather than merging them.
+        ivars->deldocs = num == 1
+                         ? (BitVector*)Vec_Pop(deldocs)
+                         : (BitVector*)LayeredDelDocs_new(deldocs);
+        ivars->del_count = (int32_t)Json_obj_to_i64(count);
+        DECREF(deldocs);
+        DECREF(layers);
     }
     else {
         ivars->deldocs = NULL;
@@ -29,6 +29,7 @@
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Index/Snapshot.h"
+#include "Lucy/Object/RoaringBitVector.h"
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Search/BitVecMatcher.h"
 #include "Lucy/Search/Compiler.h"
@@ -37,7 +38,11 @@
 #include "Lucy/Search/Query.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/OutStream.h"
-#include "Lucy/Util/Json.h"
+#include "Lucy/Util/IndexFileNames.h"
+
+// The most deletions files a segment's deletions may be spread across
+// before the next update folds them back into one.
+#define MAX_LAYERS 8
 
 DeletionsWriter*
 DelWriter_init(DeletionsWriter *self, Schema *schema, Snapshot *snapshot,
@@ -47,6 +52,12 @@ DelWriter_init(DeletionsWriter *self, Schema *schema, Snapshot *snapshot,
     return self;
 }
 
+void
+DelWriter_Set_Merge_Cutoff_IMP(DeletionsWriter *self, int64_t cutoff) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(cutoff);
+}
+
 I32Array*
 DelWriter_Generate_Doc_Map_IMP(DeletionsWriter *self, Matcher *deletions,
                                int32_t doc_max, int32_t offset) {
@@ -70,7 +81,37 @@ DelWriter_Generate_Doc_Map_IMP(DeletionsWriter *self, Matcher *deletions,
     return I32Arr_new_steal(doc_map, (size_t)doc_max + 1);
 }
 
-int32_t DefDelWriter_current_file_format = 1;
+I32Array*
+DelWriter_invert_doc_map(I32Array *doc_map) {
+    size_t  size     = I32Arr_Get_Size(doc_map);
+    int32_t min_id   = INT32_MAX;
+    size_t  num_kept = 0;
+    for (size_t i = 1; i < size; i++) {
+        int32_t new_id = I32Arr_Get(doc_map, i);
+        if (new_id) {
+            if (new_id < min_id) { min_id = new_id; }
+            num_kept++;
+        }
+    }
+
+    int32_t *old_ids = (int32_t*)CALLOCATE(num_kept ? num_kept : 1,
+                                           sizeof(int32_t));
+    for (size_t i = 1; i < size; i++) {
+        int32_t new_id = I32Arr_Get(doc_map, i);
+        if (!new_id) { continue; }
+        size_t tick = (size_t)(new_id - min_id);
+        if (tick >= num_kept || old_ids[tick]) {
+            FREEMEM(old_ids);
+            THROW(ERR, "Doc map entries don't form an unbroken run: %i32",
+                  new_id);
+        }
+        old_ids[tick] = (int32_t)i;
+    }
+
+    return I32Arr_new_steal(old_ids, num_kept);
+}
+
+int32_t DefDelWriter_current_file_format = 2;
 
 DefaultDeletionsWriter*
 DefDelWriter_new(Schema *schema, Snapshot *snapshot, Segment *segment,
@@ -91,14 +132,18 @@ DefDelWriter_init(DefaultDeletionsWriter *self, Schema *schema,
     size_t num_seg_readers      = Vec_Get_Size(ivars->seg_readers);
     ivars->seg_starts           = PolyReader_Offsets(polyreader);
     ivars->bit_vecs             = Vec_new(num_seg_readers);
+    ivars->new_dels             = Vec_new(num_seg_readers);
     ivars->updated              = (bool*)CALLOCATE(num_seg_readers, sizeof(bool));
+    ivars->flatten              = (bool*)CALLOCATE(num_seg_readers, sizeof(bool));
+    ivars->merge_cutoff         = 0;
     ivars->searcher             = IxSearcher_new((Obj*)polyreader);
     ivars->name_to_tick         = Hash_new(num_seg_readers);
 
-    // Materialize a BitVector of deletions for each segment.
+    // Materialize a BitVector of deletions for each segment.  Roaring ones
+    // stay small when a big segment has few deletions.
     for (size_t i = 0; i < num_seg_readers; i++) {
         SegReader *seg_reader = (SegReader*)Vec_Fetch(ivars->seg_readers, i);
-        BitVector *bit_vec    = BitVec_new((size_t)SegReader_Doc_Max(seg_reader));
+        BitVector *bit_vec    = (BitVector*)RoarBitVec_new();
         DeletionsReader *del_reader
             = (DeletionsReader*)SegReader_Fetch(
                   seg_reader, Class_Get_Name(DELETIONSREADER));
@@ -114,6 +159,7 @@ DefDelWriter_init(DefaultDeletionsWriter *self, Schema *schema,
             DECREF(seg_dels);
         }
         Vec_Store(ivars->bit_vecs, i, (Obj*)bit_vec);
+        Vec_Store(ivars->new_dels, i, (Obj*)RoarBitVec_new());
         Hash_Store(ivars->name_to_tick,
                    SegReader_Get_Seg_Name(seg_reader),
                    (Obj*)Int_new((int64_t)i));
@@ -128,9 +174,11 @@ DefDelWriter_Destroy_IMP(DefaultDeletionsWriter *self) {
     DECREF(ivars->seg_readers);
     DECREF(ivars->seg_starts);
     DECREF(ivars->bit_vecs);
+    DECREF(ivars->new_dels);
     DECREF(ivars->searcher);
     DECREF(ivars->name_to_tick);
     FREEMEM(ivars->updated);
+    FREEMEM(ivars->flatten);
     SUPER_DESTROY(self, DEFAULTDELETIONSWRITER);
 }
 
@@ -142,32 +190,127 @@ S_del_filename(DefaultDeletionsWriter *self, SegReader *target_reader) {
                     Seg_Get_Name(target_seg));
 }
 
+void
+DefDelWriter_Set_Merge_Cutoff_IMP(DefaultDeletionsWriter *self,
+                                  int64_t cutoff) {
+    DefDelWriter_IVARS(self)->merge_cutoff = cutoff;
+}
+
+// Return the metadata for the deletions file to be written for the segment
+// at `tick`.  If the segment's existing files can stay, it lists them under
+// "layers" and the new file holds only the docs deleted since.
+static Hash*
+S_file_meta(DefaultDeletionsWriter *self, size_t tick) {
+    DefaultDeletionsWriterIVARS *const ivars = DefDelWriter_IVARS(self);
+    SegReader *seg_reader = (SegReader*)Vec_Fetch(ivars->seg_readers, tick);
+    BitVector *deldocs    = (BitVector*)Vec_Fetch(ivars->bit_vecs, tick);
+    BitVector *new_dels   = (BitVector*)Vec_Fetch(ivars->new_dels, tick);
+    size_t     count      = BitVec_Count(deldocs);
+    size_t     num_new    = BitVec_Count(new_dels);
+    Vector    *segments   = PolyReader_Get_Segments(ivars->polyreader);
+    Hash      *existing   = DefDelReader_find_deletions(
+                                segments, SegReader_Get_Seg_Name(seg_reader));
+    Vector    *layers     = NULL;
+
+    // Rewriting everything costs no more than twice as much as adding a
+    // layer once the new deletions outnumber the old ones.  Files which a
+    // background merge might remove can't be built upon.
+    if (existing && !ivars->flatten[tick] && num_new <= count - num_new) {
+        layers = DefDelReader_layers(existing);
+        size_t num_layers = Vec_Get_Size(layers);
+        bool   usable     = num_layers < MAX_LAYERS;
+        for (size_t i = 0; usable && i < num_layers; i++) {
+            Hash   *layer    = (Hash*)Vec_Fetch(layers, i);
+            String *filename = (String*)Hash_Fetch_Utf8(layer, "filename", 8);
+            int64_t host_num = (int64_t)IxFileNames_extract_gen(filename);
+            if (host_num <= ivars->merge_cutoff) { usable = false; }
+        }
+        if (!usable) {
+            DECREF(layers);
+            layers = NULL;
+        }
+    }
+
+    // Store doc ids when they take up less room than one bit per doc.
+    size_t num_to_write = layers ? num_new : count;
+    size_t doc_max      = (size_t)SegReader_Doc_Max(seg_reader);
+    size_t byte_size    = (doc_max + 1 + 7) / 8;
+    bool   sparse       = num_to_write * 4 < byte_size;
+
+    Hash *file_meta = Hash_new(4);
+    Hash_Store_Utf8(file_meta, "count", 5,
+                    (Obj*)Str_newf("%u32", (uint32_t)count));
+    Hash_Store_Utf8(file_meta, "filename", 8,
+                    (Obj*)S_del_filename(self, seg_reader));
+    Hash_Store_Utf8(file_meta, "type", 4,
+                    (Obj*)Str_newc(sparse ? "sparse" : "bitmap"));
+    if (layers) {
+        Vector *base = Vec_new(Vec_Get_Size(layers));
+        for (size_t i = 0, max = Vec_Get_Size(layers); i < max; i++) {
+            Hash   *layer      = (Hash*)Vec_Fetch(layers, i);
+            Obj    *filename   = Hash_Fetch_Utf8(layer, "filename", 8);
+            String *type       = (String*)Hash_Fetch_Utf8(layer, "type", 4);
+            Hash   *layer_meta = Hash_new(2);
+            Hash_Store_Utf8(layer_meta, "filename", 8,
+                            (Obj*)Str_Clone((String*)filename));
+            Hash_Store_Utf8(layer_meta, "type", 4,
+                            type ? (Obj*)Str_Clone(type)
+                                 : (Obj*)Str_newc("bitmap"));
+            Vec_Push(base, (Obj*)layer_meta);
+        }
+        Hash_Store_Utf8(file_meta, "layers", 6, (Obj*)base);
+        DECREF(layers);
+    }
+
+    return file_meta;
+}
+
+static void
+S_write_file(DefaultDeletionsWriter *self, size_t tick, Hash *file_meta) {
+    DefaultDeletionsWriterIVARS *const ivars = DefDelWriter_IVARS(self);
+    SegReader *seg_reader = (SegReader*)Vec_Fetch(ivars->seg_readers, tick);
+    BitVector *deldocs
+        = Hash_Fetch_Utf8(file_meta, "layers", 6)
+          ? (BitVector*)Vec_Fetch(ivars->new_dels, tick)
+          : (BitVector*)Vec_Fetch(ivars->bit_vecs, tick);
+    String    *type      = (String*)Hash_Fetch_Utf8(file_meta, "type", 4);
+    String    *filename  = (String*)Hash_Fetch_Utf8(file_meta, "filename", 8);
+    OutStream *outstream = Folder_Open_Out(ivars->folder, filename);
+    if (!outstream) { RETHROW(INCREF(Err_get_error())); }
+
+    if (Str_Equals_Utf8(type, "sparse", 6)) {
+        // Sorted doc ids.
+        int32_t doc_id = BitVec_Next_Hit(deldocs, 0);
+        while (doc_id != -1) {
+            OutStream_Write_U32(outstream, (uint32_t)doc_id);
+            doc_id = BitVec_Next_Hit(deldocs, (size_t)doc_id + 1);
+        }
+    }
+    else {
+        // Spell the deletions out with 1 bit for each doc in the segment.
+        int32_t    doc_max   = SegReader_Doc_Max(seg_reader);
+        size_t     byte_size = (((size_t)doc_max + 1) + 7) / 8;
+        BitVector *bitmap    = BitVec_new(byte_size * 8);
+        BitVec_Or(bitmap, deldocs);
+        OutStream_Write_Bytes(outstream,
+                              (char*)BitVec_Get_Raw_Bits(bitmap),
+                              byte_size);
+        DECREF(bitmap);
+    }
+
+    OutStream_Close(outstream);
+    DECREF(outstream);
+}
+
 void
 DefDelWriter_Finish_IMP(DefaultDeletionsWriter *self) {
     DefaultDeletionsWriterIVARS *const ivars = DefDelWriter_IVARS(self);
-    Folder *const folder = ivars->folder;
 
     for (size_t i = 0, max = Vec_Get_Size(ivars->seg_readers); i < max; i++) {
-        SegReader *seg_reader = (SegReader*)Vec_Fetch(ivars->seg_readers, i);
         if (ivars->updated[i]) {
-            BitVector *deldocs   = (BitVector*)Vec_Fetch(ivars->bit_vecs, i);
-            int32_t    doc_max   = SegReader_Doc_Max(seg_reader);
-            size_t     byte_size = (((size_t)doc_max + 1) + 7) / 8;
-            size_t     new_max   = byte_size * 8 - 1;
-            String    *filename  = S_del_filename(self, seg_reader);
-            OutStream *outstream = Folder_Open_Out(folder, filename);
-            if (!outstream) { RETHROW(INCREF(Err_get_error())); }
-
-            // Ensure that we have 1 bit for each doc in segment.
-            BitVec_Grow(deldocs, new_max);
-
-            // Write deletions data and clean up.
-            OutStream_Write_Bytes(outstream,
-                                  (char*)BitVec_Get_Raw_Bits(deldocs),
-                                  byte_size);
-            OutStream_Close(outstream);
-            DECREF(outstream);
-            DECREF(filename);
+            Hash *file_meta = S_file_meta(self, i);
+            S_write_file(self, i, file_meta);
+            DECREF(file_meta);
         }
     }
 
@@ -187,14 +330,9 @@ DefDelWriter_Metadata_IMP(DefaultDeletionsWriter *self) {
     for (size_t i = 0, max = Vec_Get_Size(ivars->seg_readers); i < max; i++) {
         SegReader *seg_reader = (SegReader*)Vec_Fetch(ivars->seg_readers, i);
         if (ivars->updated[i]) {
-            BitVector *deldocs   = (BitVector*)Vec_Fetch(ivars->bit_vecs, i);
-            Segment   *segment   = SegReader_Get_Segment(seg_reader);
-            Hash      *mini_meta = Hash_new(2);
-            Hash_Store_Utf8(mini_meta, "count", 5,
-                            (Obj*)Str_newf("%u32", (uint32_t)BitVec_Count(deldocs)));
-            Hash_Store_Utf8(mini_meta, "filename", 8,
-                            (Obj*)S_del_filename(self, seg_reader));
-            Hash_Store(files, Seg_Get_Name(segment), (Obj*)mini_meta);
+            Segment *segment = SegReader_Get_Segment(seg_reader);
+            Hash_Store(files, Seg_Get_Name(segment),
+                       (Obj*)S_file_meta(self, i));
         }
     }
     Hash_Store_Utf8(metadata, "files", 5, (Obj*)files);
@@ -249,6 +387,17 @@ DefDelWriter_Seg_Del_Count_IMP(DefaultDeletionsWriter *self,
     return deldocs ? (int32_t)BitVec_Count(deldocs) : 0;
 }
 
+// Mark a doc deleted, keeping track of those which weren't already.
+static void
+S_delete_doc(DefaultDeletionsWriterIVARS *ivars, size_t tick,
+             int32_t doc_id) {
+    BitVector *bit_vec = (BitVector*)Vec_Fetch(ivars->bit_vecs, tick);
+    if (BitVec_Get(bit_vec, (size_t)doc_id)) { return; }
+    BitVec_Set(bit_vec, (size_t)doc_id);
+    BitVec_Set((BitVector*)Vec_Fetch(ivars->new_dels, tick), (size_t)doc_id);
+    ivars->updated[tick] = true;
+}
+
 void
 DefDelWriter_Delete_By_Term_IMP(DefaultDeletionsWriter *self,
                                 String *field, Obj *term) {
@@ -258,20 +407,16 @@ DefDelWriter_Delete_By_Term_IMP(DefaultDeletionsWriter *self,
         PostingListReader *plist_reader
             = (PostingListReader*)SegReader_Fetch(
                   seg_reader, Class_Get_Name(POSTINGLISTREADER));
-        BitVector *bit_vec = (BitVector*)Vec_Fetch(ivars->bit_vecs, i);
         PostingList *plist = plist_reader
                              ? PListReader_Posting_List(plist_reader, field, term)
                              : NULL;
         int32_t doc_id;
-        int32_t num_zapped = 0;
 
         // Iterate through postings, marking each doc as deleted.
         if (plist) {
             while (0 != (doc_id = PList_Next(plist))) {
-                num_zapped += !BitVec_Get(bit_vec, (size_t)doc_id);
-                BitVec_Set(bit_vec, (size_t)doc_id);
+                S_delete_doc(ivars, i, doc_id);
             }
-            if (num_zapped) { ivars->updated[i] = true; }
             DECREF(plist);
         }
     }
@@ -285,19 +430,15 @@ DefDelWriter_Delete_By_Query_IMP(DefaultDeletionsWriter *self, Query *query) {
 
     for (size_t i = 0, max = Vec_Get_Size(ivars->seg_readers); i < max; i++) {
         SegReader *seg_reader = (SegReader*)Vec_Fetch(ivars->seg_readers, i);
-        BitVector *bit_vec = (BitVector*)Vec_Fetch(ivars->bit_vecs, i);
         Matcher *matcher = Compiler_Make_Matcher(compiler, seg_reader, false);
 
         if (matcher) {
             int32_t doc_id;
-            int32_t num_zapped = 0;
 
             // Iterate through matches, marking each doc as deleted.
             while (0 != (doc_id = Matcher_Next(matcher))) {
-                num_zapped += !BitVec_Get(bit_vec, (size_t)doc_id);
-                BitVec_Set(bit_vec, (size_t)doc_id);
+                S_delete_doc(ivars, i, doc_id);
             }
-            if (num_zapped) { ivars->updated[i] = true; }
 
             DECREF(matcher);
         }
@@ -310,14 +451,8 @@ void
 DefDelWriter_Delete_By_Doc_ID_IMP(DefaultDeletionsWriter *self, int32_t doc_id) {
     DefaultDeletionsWriterIVARS *const ivars = DefDelWriter_IVARS(self);
     uint32_t   sub_tick   = PolyReader_sub_tick(ivars->seg_starts, doc_id);
-    BitVector *bit_vec    = (BitVector*)Vec_Fetch(ivars->bit_vecs, sub_tick);
     int32_t    offset     = I32Arr_Get(ivars->seg_starts, sub_tick);
-    int32_t    seg_doc_id = doc_id - offset;
-
-    if (!BitVec_Get(bit_vec, (size_t)seg_doc_id)) {
-        ivars->updated[sub_tick] = true;
-        BitVec_Set(bit_vec, (size_t)seg_doc_id);
-    }
+    S_delete_doc(ivars, sub_tick, doc_id - offset);
 }
 
 bool
@@ -350,6 +485,7 @@ DefDelWriter_Merge_Segment_IMP(DefaultDeletionsWriter *self,
 
     if (del_meta) {
         Vector *seg_readers = ivars->seg_readers;
+        Vector *segments    = PolyReader_Get_Segments(ivars->polyreader);
         Hash   *files = (Hash*)Hash_Fetch_Utf8(del_meta, "files", 5);
         if (files) {
             HashIterator *iter = HashIter_new(files);
@@ -368,17 +504,28 @@ DefDelWriter_Merge_Segment_IMP(DefaultDeletionsWriter *self,
                         = Seg_Get_Name(SegReader_Get_Segment(candidate));
 
                     if (Str_Equals(seg, (Obj*)candidate_name)) {
-                        /* If the count hasn't changed, we're about to
-                         * merge away the most recent deletions file
-                         * pointing at this target segment -- so force a
-                         * new file to be written out. */
-                        int32_t count = (int32_t)Json_obj_to_i64(Hash_Fetch_Utf8(mini_meta, "count", 5));
-                        DeletionsReader *del_reader
-                            = (DeletionsReader*)SegReader_Obtain(
-                                  candidate, Class_Get_Name(DELETIONSREADER));
-                        if (count == DelReader_Del_Count(del_reader)) {
-                            ivars->updated[i] = true;
+                        /* If the file is one of those the target
+                         * segment's deletions are currently read from,
+                         * we're about to merge it away -- so force a new
+                         * file to be written out, holding all of the
+                         * segment's deletions. */
+                        Obj  *filename
+                            = Hash_Fetch_Utf8(mini_meta, "filename", 8);
+                        Hash *current
+                            = DefDelReader_find_deletions(segments, seg);
+                        Vector *layers = current
+                                         ? DefDelReader_layers(current)
+                                         : Vec_new(0);
+                        for (size_t j = 0; j < Vec_Get_Size(layers); j++) {
+                            Hash *layer = (Hash*)Vec_Fetch(layers, j);
+                            Obj  *layer_file
+                                = Hash_Fetch_Utf8(layer, "filename", 8);
+                            if (Obj_Equals(layer_file, filename)) {
+                                ivars->updated[i] = true;
+                                ivars->flatten[i] = true;
+                            }
                         }
+                        DECREF(layers);
                         break;
                     }
                 }
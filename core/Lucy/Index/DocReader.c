@@ -26,9 +26,18 @@
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/Snapshot.h"
 #include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/InStream.h"
+#include "Lucy/Store/RAMFile.h"
 #include "Lucy/Util/Json.h"
+#include "Lucy/Util/LZ4.h"
+#include "Lucy/Util/NumberUtils.h"
+
+// Seek to the uncompressed file position `start` and return the stream to
+// read from.
+static InStream*
+S_seek_record(DefaultDocReader *self, int64_t start);
 
 DocReader*
 DocReader_init(DocReader *self, Schema *schema, Folder *folder,
@@ -66,10 +75,6 @@ void
 PolyDocReader_Close_IMP(PolyDocReader *self) {
     PolyDocReaderIVARS *const ivars = PolyDocReader_IVARS(self);
     if (ivars->readers) {
-        for (size_t i = 0, max = Vec_Get_Size(ivars->readers); i < max; i++) {
-            DocReader *reader = (DocReader*)Vec_Fetch(ivars->readers, i);
-            if (reader) { DocReader_Close(reader); }
-        }
         Vec_Clear(ivars->readers);
     }
 }
@@ -121,6 +126,23 @@ DefDocReader_Close_IMP(DefaultDocReader *self) {
         DECREF(ivars->ix_in);
         ivars->ix_in = NULL;
     }
+    if (ivars->blk_in != NULL) {
+        InStream_Close(ivars->blk_in);
+        DECREF(ivars->blk_in);
+        ivars->blk_in = NULL;
+        ivars->blocks = NULL;
+    }
+    if (ivars->cache != NULL) {
+        for (int32_t i = 0; i < DEFDOCREADER_CACHE_SIZE; i++) {
+            DECREF(ivars->cache[i]);
+        }
+        FREEMEM(ivars->cache);
+        FREEMEM(ivars->cache_ids);
+        FREEMEM(ivars->cache_stamps);
+        ivars->cache        = NULL;
+        ivars->cache_ids    = NULL;
+        ivars->cache_stamps = NULL;
+    }
 }
 
 void
@@ -128,6 +150,15 @@ DefDocReader_Destroy_IMP(DefaultDocReader *self) {
     DefaultDocReaderIVARS *const ivars = DefDocReader_IVARS(self);
     DECREF(ivars->ix_in);
     DECREF(ivars->dat_in);
+    DECREF(ivars->blk_in);
+    if (ivars->cache != NULL) {
+        for (int32_t i = 0; i < DEFDOCREADER_CACHE_SIZE; i++) {
+            DECREF(ivars->cache[i]);
+        }
+        FREEMEM(ivars->cache);
+        FREEMEM(ivars->cache_ids);
+        FREEMEM(ivars->cache_stamps);
+    }
     SUPER_DESTROY(self, DEFAULTDOCREADER);
 }
 
@@ -146,17 +177,20 @@ DefDocReader_init(DefaultDocReader *self, Schema *schema, Folder *folder,
         String *seg_name  = Seg_Get_Name(segment);
         String *ix_file   = Str_newf("%o/documents.ix", seg_name);
         String *dat_file  = Str_newf("%o/documents.dat", seg_name);
+        String *blk_file  = Str_newf("%o/documents.blk", seg_name);
         Obj     *format   = Hash_Fetch_Utf8(metadata, "format", 6);
+        int64_t  format_val = 0;
 
-        // Check format.
+        // Check format.  Format 2 stored documents uncompressed, and is
+        // still readable.
         if (!format) { THROW(ERR, "Missing 'format' var"); }
         else {
-            int64_t format_val = Json_obj_to_i64(format);
-            if (format_val < DocWriter_current_file_format) {
+            format_val = Json_obj_to_i64(format);
+            if (format_val < 2) {
                 THROW(ERR, "Obsolete doc storage format %i64; "
                       "Index regeneration is required", format_val);
             }
-            else if (format_val != DocWriter_current_file_format) {
+            else if (format_val > DocWriter_current_file_format) {
                 THROW(ERR, "Unsupported doc storage format: %i64", format_val);
             }
         }
@@ -179,9 +213,44 @@ DefDocReader_init(DefaultDocReader *self, Schema *schema, Folder *folder,
                 DECREF(self);
                 RETHROW(error);
             }
+
+            // Docs are fetched by id, in no particular order.
+            InStream_Advise(ivars->ix_in, FH_ADVICE_RANDOM);
+            InStream_Advise(ivars->dat_in, FH_ADVICE_RANDOM);
+
+            if (format_val >= 3) {
+                ivars->blk_in = Folder_Open_In(folder, blk_file);
+                if (!ivars->blk_in) {
+                    Err *error = (Err*)INCREF(Err_get_error());
+                    DECREF(ix_file);
+                    DECREF(dat_file);
+                    DECREF(blk_file);
+                    DECREF(self);
+                    RETHROW(error);
+                }
+
+                // Map in the block table.  Each entry is a pair of 64-bit
+                // file positions; the last one only marks the end.
+                int64_t blk_len = InStream_Length(ivars->blk_in);
+                ivars->num_blocks = (int32_t)(blk_len / 16) - 1;
+                ivars->blocks = InStream_Buf(ivars->blk_in, (size_t)blk_len);
+
+                ivars->cache = (InStream**)CALLOCATE(DEFDOCREADER_CACHE_SIZE,
+                                                     sizeof(InStream*));
+                ivars->cache_ids = (int32_t*)MALLOCATE(
+                                       DEFDOCREADER_CACHE_SIZE
+                                       * sizeof(int32_t));
+                ivars->cache_stamps = (uint64_t*)CALLOCATE(
+                                          DEFDOCREADER_CACHE_SIZE,
+                                          sizeof(uint64_t));
+                for (int32_t i = 0; i < DEFDOCREADER_CACHE_SIZE; i++) {
+                    ivars->cache_ids[i] = -1;
+                }
+            }
         }
         DECREF(ix_file);
         DECREF(dat_file);
+        DECREF(blk_file);
     }
 
     return self;
@@ -200,9 +269,98 @@ DefDocReader_Read_Record_IMP(DefaultDocReader *self, ByteBuf *buffer,
 
     // Read in the record.
     char *buf = BB_Grow(buffer, size);
-    InStream_Seek(ivars->dat_in, start);
-    InStream_Read_Bytes(ivars->dat_in, buf, size);
+    InStream *instream = S_seek_record(self, start);
+    InStream_Read_Bytes(instream, buf, size);
     BB_Set_Size(buffer, size);
 }
 
+InStream*
+DefDocReader_Doc_Stream_IMP(DefaultDocReader *self, int32_t doc_id) {
+    DefaultDocReaderIVARS *const ivars = DefDocReader_IVARS(self);
+    InStream_Seek(ivars->ix_in, (int64_t)doc_id * 8);
+    int64_t start = InStream_Read_I64(ivars->ix_in);
+    return S_seek_record(self, start);
+}
+
+static int64_t
+S_block_entry(DefaultDocReaderIVARS *ivars, int32_t tick, int32_t which) {
+    const char *entry = ivars->blocks + ((size_t)tick * 2 + which) * 8;
+    return (int64_t)NumUtil_decode_bigend_u64(entry);
+}
+
+// Find the block which holds the uncompressed file position `start`.
+static int32_t
+S_find_block(DefaultDocReaderIVARS *ivars, int64_t start) {
+    int32_t lo = 0;
+    int32_t hi = ivars->num_blocks - 1;
+    while (hi > lo) {
+        int32_t mid = lo + (hi - lo + 1) / 2;
+        if (S_block_entry(ivars, mid, 0) <= start) { lo = mid; }
+        else                                      { hi = mid - 1; }
+    }
+    return lo;
+}
+
+// Decompress a block into a stream of its own.
+static InStream*
+S_load_block(DefaultDocReaderIVARS *ivars, int32_t tick) {
+    int64_t raw_start = S_block_entry(ivars, tick, 0);
+    int64_t file_pos  = S_block_entry(ivars, tick, 1);
+    size_t  raw_size  = (size_t)(S_block_entry(ivars, tick + 1, 0) - raw_start);
+    size_t  size      = (size_t)(S_block_entry(ivars, tick + 1, 1) - file_pos);
+    ByteBuf *contents = BB_new(raw_size);
+
+    InStream_Seek(ivars->dat_in, file_pos);
+    const char *buf = InStream_Buf(ivars->dat_in, size);
+    if (!LZ4_decompress(buf, size, BB_Get_Buf(contents), raw_size)) {
+        DECREF(contents);
+        THROW(ERR, "Corrupt document block at %i64 in %o", file_pos,
+              InStream_Get_Filename(ivars->dat_in));
+    }
+    InStream_Advance_Buf(ivars->dat_in, buf + size);
+    BB_Set_Size(contents, raw_size);
+
+    RAMFile  *file     = RAMFile_new(contents, true);
+    InStream *instream = InStream_open((Obj*)file);
+    DECREF(file);
+    DECREF(contents);
+    return instream;
+}
+
+static InStream*
+S_seek_record(DefaultDocReader *self, int64_t start) {
+    DefaultDocReaderIVARS *const ivars = DefDocReader_IVARS(self);
+
+    // Uncompressed storage.
+    if (!ivars->blocks) {
+        InStream_Seek(ivars->dat_in, start);
+        return ivars->dat_in;
+    }
+
+    // Look for the block among the ones we've decompressed recently, and
+    // failing that, load it in place of the least recently used.
+    int32_t  tick  = S_find_block(ivars, start);
+    int32_t  slot  = 0;
+    for (int32_t i = 0; i < DEFDOCREADER_CACHE_SIZE; i++) {
+        if (ivars->cache_ids[i] == tick) {
+            slot = i;
+            break;
+        }
+        if (ivars->cache_stamps[i] < ivars->cache_stamps[slot]) {
+            slot = i;
+        }
+    }
+    if (ivars->cache_ids[slot] != tick) {
+        InStream *block = S_load_block(ivars, tick);
+        DECREF(ivars->cache[slot]);
+        ivars->cache[slot]     = block;
+        ivars->cache_ids[slot] = tick;
+    }
+    ivars->cache_stamps[slot] = ++ivars->cache_clock;
+
+    InStream *block = ivars->cache[slot];
+    InStream_Seek(block, start - S_block_entry(ivars, tick, 0));
+    return block;
+}
+
 
@@ -0,0 +1,337 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_DOCVALUESREADER
+#define C_LUCY_POLYDOCVALUESREADER
+#define C_LUCY_DEFAULTDOCVALUESREADER
+#define C_LUCY_DOCVALUESCOLUMN
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/Blob.h"
+#include "Clownfish/Num.h"
+#include "Lucy/Index/DocValuesReader.h"
+#include "Lucy/Index/DocValuesWriter.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/Segment.h"
+#include "Lucy/Index/Snapshot.h"
+#include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
+#include "Lucy/Store/Folder.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Util/Json.h"
+#include "Lucy/Util/NumberUtils.h"
+
+static InStream*
+S_open_in(Folder *folder, String *seg_name, int32_t field_num,
+          const char *ext);
+
+DocValuesReader*
+DVReader_init(DocValuesReader *self, Schema *schema, Folder *folder,
+              Snapshot *snapshot, Vector *segments, int32_t seg_tick) {
+    return (DocValuesReader*)DataReader_init((DataReader*)self, schema,
+                                             folder, snapshot, segments,
+                                             seg_tick);
+}
+
+DocValuesReader*
+DVReader_Aggregator_IMP(DocValuesReader *self, Vector *readers,
+                        I32Array *offsets) {
+    UNUSED_VAR(self);
+    return (DocValuesReader*)PolyDVReader_new(readers, offsets);
+}
+
+PolyDocValuesReader*
+PolyDVReader_new(Vector *readers, I32Array *offsets) {
+    PolyDocValuesReader *self
+        = (PolyDocValuesReader*)Class_Make_Obj(POLYDOCVALUESREADER);
+    return PolyDVReader_init(self, readers, offsets);
+}
+
+PolyDocValuesReader*
+PolyDVReader_init(PolyDocValuesReader *self, Vector *readers,
+                  I32Array *offsets) {
+    DVReader_init((DocValuesReader*)self, NULL, NULL, NULL, NULL, -1);
+    PolyDocValuesReaderIVARS *const ivars = PolyDVReader_IVARS(self);
+    for (size_t i = 0, max = Vec_Get_Size(readers); i < max; i++) {
+        CERTIFY(Vec_Fetch(readers, i), DOCVALUESREADER);
+    }
+    ivars->readers = (Vector*)INCREF(readers);
+    ivars->offsets = (I32Array*)INCREF(offsets);
+    return self;
+}
+
+void
+PolyDVReader_Close_IMP(PolyDocValuesReader *self) {
+    PolyDocValuesReaderIVARS *const ivars = PolyDVReader_IVARS(self);
+    if (ivars->readers) {
+        Vec_Clear(ivars->readers);
+    }
+}
+
+void
+PolyDVReader_Destroy_IMP(PolyDocValuesReader *self) {
+    PolyDocValuesReaderIVARS *const ivars = PolyDVReader_IVARS(self);
+    DECREF(ivars->readers);
+    DECREF(ivars->offsets);
+    SUPER_DESTROY(self, POLYDOCVALUESREADER);
+}
+
+Obj*
+PolyDVReader_Fetch_Value_IMP(PolyDocValuesReader *self, String *field,
+                             int32_t doc_id) {
+    PolyDocValuesReaderIVARS *const ivars = PolyDVReader_IVARS(self);
+    uint32_t seg_tick = PolyReader_sub_tick(ivars->offsets, doc_id);
+    int32_t  offset   = I32Arr_Get(ivars->offsets, seg_tick);
+    DocValuesReader *dv_reader
+        = (DocValuesReader*)Vec_Fetch(ivars->readers, seg_tick);
+    if (!dv_reader) {
+        THROW(ERR, "Invalid doc_id: %i32", doc_id);
+    }
+    return DVReader_Fetch_Value(dv_reader, field, doc_id - offset);
+}
+
+DefaultDocValuesReader*
+DefDVReader_new(Schema *schema, Folder *folder, Snapshot *snapshot,
+                Vector *segments, int32_t seg_tick) {
+    DefaultDocValuesReader *self
+        = (DefaultDocValuesReader*)Class_Make_Obj(DEFAULTDOCVALUESREADER);
+    return DefDVReader_init(self, schema, folder, snapshot, segments,
+                            seg_tick);
+}
+
+DefaultDocValuesReader*
+DefDVReader_init(DefaultDocValuesReader *self, Schema *schema,
+                 Folder *folder, Snapshot *snapshot, Vector *segments,
+                 int32_t seg_tick) {
+    DVReader_init((DocValuesReader*)self, schema, folder, snapshot, segments,
+                  seg_tick);
+    DefaultDocValuesReaderIVARS *const ivars = DefDVReader_IVARS(self);
+    Segment *segment  = DefDVReader_Get_Segment(self);
+    Hash    *metadata = (Hash*)Seg_Fetch_Metadata_Utf8(segment, "docvalues",
+                                                       9);
+
+    // Check format.
+    ivars->format = 0;
+    if (metadata) {
+        Obj *format = Hash_Fetch_Utf8(metadata, "format", 6);
+        if (!format) { THROW(ERR, "Missing 'format' var"); }
+        else {
+            ivars->format = (int32_t)Json_obj_to_i64(format);
+            if (ivars->format < 1
+                || ivars->format > DVWriter_current_file_format
+               ) {
+                THROW(ERR, "Unsupported doc values format: %i32",
+                      ivars->format);
+            }
+        }
+    }
+
+    ivars->columns = Hash_new(0);
+    ivars->counts  = metadata
+                     ? (Hash*)INCREF(CERTIFY(
+                           Hash_Fetch_Utf8(metadata, "counts", 6), HASH))
+                     : Hash_new(0);
+
+    return self;
+}
+
+void
+DefDVReader_Close_IMP(DefaultDocValuesReader *self) {
+    DefaultDocValuesReaderIVARS *const ivars = DefDVReader_IVARS(self);
+    if (ivars->columns) {
+        DECREF(ivars->columns);
+        ivars->columns = NULL;
+    }
+    if (ivars->counts) {
+        DECREF(ivars->counts);
+        ivars->counts = NULL;
+    }
+}
+
+void
+DefDVReader_Destroy_IMP(DefaultDocValuesReader *self) {
+    DefaultDocValuesReaderIVARS *const ivars = DefDVReader_IVARS(self);
+    DECREF(ivars->columns);
+    DECREF(ivars->counts);
+    SUPER_DESTROY(self, DEFAULTDOCVALUESREADER);
+}
+
+static DocValuesColumn*
+S_lazy_init_column(DefaultDocValuesReader *self, String *field) {
+    DefaultDocValuesReaderIVARS *const ivars = DefDVReader_IVARS(self);
+
+    // See if we have any values.
+    Obj *count_obj = Hash_Fetch(ivars->counts, field);
+    int32_t count = count_obj ? (int32_t)Json_obj_to_i64(count_obj) : 0;
+    if (!count) { return NULL; }
+
+    Schema    *schema = DefDVReader_Get_Schema(self);
+    FieldType *type   = Schema_Fetch_Type(schema, field);
+    if (!type || !FType_Columnar(type)) {
+        THROW(ERR, "'%o' isn't a columnar field", field);
+    }
+
+    Folder  *folder    = DefDVReader_Get_Folder(self);
+    Segment *segment   = DefDVReader_Get_Segment(self);
+    int32_t  field_num = Seg_Field_Num(segment, field);
+    DocValuesColumn *column
+        = DVColumn_new(folder, Seg_Get_Name(segment), field_num, type);
+    Hash_Store(ivars->columns, field, (Obj*)column);
+    return column;
+}
+
+Obj*
+DefDVReader_Fetch_Value_IMP(DefaultDocValuesReader *self, String *field,
+                            int32_t doc_id) {
+    DefaultDocValuesReaderIVARS *const ivars = DefDVReader_IVARS(self);
+    DocValuesColumn *column
+        = (DocValuesColumn*)Hash_Fetch(ivars->columns, field);
+    if (!column) {
+        column = S_lazy_init_column(self, field);
+        if (!column) { return NULL; }
+    }
+    return DVColumn_Value(column, doc_id);
+}
+
+/*************************************************************************/
+
+DocValuesColumn*
+DVColumn_new(Folder *folder, String *seg_name, int32_t field_num,
+             FieldType *type) {
+    DocValuesColumn *self
+        = (DocValuesColumn*)Class_Make_Obj(DOCVALUESCOLUMN);
+    return DVColumn_init(self, folder, seg_name, field_num, type);
+}
+
+DocValuesColumn*
+DVColumn_init(DocValuesColumn *self, Folder *folder, String *seg_name,
+              int32_t field_num, FieldType *type) {
+    DocValuesColumnIVARS *const ivars = DVColumn_IVARS(self);
+    ivars->prim_id = FType_Primitive_ID(type) & FType_PRIMITIVE_ID_MASK;
+    switch (ivars->prim_id) {
+        case FType_TEXT:
+        case FType_BLOB:
+            ivars->width = 0;
+            break;
+        case FType_INT32:
+        case FType_FLOAT32:
+            ivars->width = 4;
+            break;
+        case FType_INT64:
+        case FType_FLOAT64:
+            ivars->width = 8;
+            break;
+        default:
+            DECREF(self);
+            THROW(ERR, "Unrecognized primitive id: %i32",
+                  (int32_t)FType_Primitive_ID(type));
+    }
+
+    ivars->dat_in = S_open_in(folder, seg_name, field_num, "dat");
+    ivars->nul_in = S_open_in(folder, seg_name, field_num, "nul");
+    if (!ivars->width) {
+        ivars->ix_in = S_open_in(folder, seg_name, field_num, "ix");
+    }
+
+    // Values are fetched by doc id, in no particular order.
+    InStream_Advise(ivars->dat_in, FH_ADVICE_RANDOM);
+    if (ivars->ix_in) {
+        InStream_Advise(ivars->ix_in, FH_ADVICE_RANDOM);
+    }
+
+    // The presence bits are small, so keep them in view.
+    int64_t nul_len = InStream_Length(ivars->nul_in);
+    ivars->present
+        = (const uint8_t*)InStream_Buf(ivars->nul_in, (size_t)nul_len);
+    ivars->present_cap = nul_len * 8;
+
+    return self;
+}
+
+static InStream*
+S_open_in(Folder *folder, String *seg_name, int32_t field_num,
+          const char *ext) {
+    String *path = Str_newf("%o/docvalues-%i32.%s", seg_name, field_num,
+                            ext);
+    InStream *instream = Folder_Open_In(folder, path);
+    DECREF(path);
+    if (!instream) { RETHROW(INCREF(Err_get_error())); }
+    return instream;
+}
+
+void
+DVColumn_Destroy_IMP(DocValuesColumn *self) {
+    DocValuesColumnIVARS *const ivars = DVColumn_IVARS(self);
+    if (ivars->dat_in) {
+        InStream_Close(ivars->dat_in);
+        DECREF(ivars->dat_in);
+    }
+    if (ivars->ix_in) {
+        InStream_Close(ivars->ix_in);
+        DECREF(ivars->ix_in);
+    }
+    if (ivars->nul_in) {
+        InStream_Close(ivars->nul_in);
+        DECREF(ivars->nul_in);
+    }
+    ivars->present = NULL;
+    SUPER_DESTROY(self, DOCVALUESCOLUMN);
+}
+
+Obj*
+DVColumn_Value_IMP(DocValuesColumn *self, int32_t doc_id) {
+    DocValuesColumnIVARS *const ivars = DVColumn_IVARS(self);
+    InStream *const dat_in = ivars->dat_in;
+
+    if (doc_id < 0 || doc_id >= ivars->present_cap) { return NULL; }
+    if (!NumUtil_u1get(ivars->present, (size_t)doc_id)) { return NULL; }
+
+    if (ivars->ix_in) {
+        InStream_Seek(ivars->ix_in, (int64_t)doc_id * 8);
+        int64_t start = InStream_Read_I64(ivars->ix_in);
+        int64_t end   = InStream_Read_I64(ivars->ix_in);
+        size_t  size  = (size_t)(end - start);
+        InStream_Seek(dat_in, start);
+        if (ivars->prim_id == FType_TEXT) {
+            char *buf = (char*)MALLOCATE(size + 1);
+            InStream_Read_Bytes(dat_in, buf, size);
+            buf[size] = '\0';
+            return (Obj*)Str_new_steal_utf8(buf, size);
+        }
+        else {
+            char *buf = (char*)MALLOCATE(size ? size : 1);
+            InStream_Read_Bytes(dat_in, buf, size);
+            return (Obj*)Blob_new_steal(buf, size);
+        }
+    }
+
+    InStream_Seek(dat_in, (int64_t)doc_id * ivars->width);
+    switch (ivars->prim_id) {
+        case FType_INT32:
+            return (Obj*)Int_new(InStream_Read_I32(dat_in));
+        case FType_INT64:
+            return (Obj*)Int_new(InStream_Read_I64(dat_in));
+        case FType_FLOAT32:
+            return (Obj*)Float_new(InStream_Read_F32(dat_in));
+        case FType_FLOAT64:
+            return (Obj*)Float_new(InStream_Read_F64(dat_in));
+        default:
+            THROW(ERR, "Unexpected primitive id: %i32",
+                  (int32_t)ivars->prim_id);
+            UNREACHABLE_RETURN(Obj*);
+    }
+}
@@ -0,0 +1,351 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_DOCVALUESWRITER
+#define C_LUCY_DOCVALUESCOLUMNWRITER
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/Blob.h"
+#include "Clownfish/Num.h"
+#include "Lucy/Index/DocValuesWriter.h"
+#include "Lucy/Index/DeletionsWriter.h"
+#include "Lucy/Index/DocValuesReader.h"
+#include "Lucy/Index/Inverter.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/Segment.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Index/Snapshot.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/Folder.h"
+#include "Lucy/Store/OutStream.h"
+
+int32_t DVWriter_current_file_format = 1;
+
+static DocValuesColumnWriter*
+S_lazy_init_col_writer(DocValuesWriter *self, int32_t field_num);
+
+static OutStream*
+S_open_out(Folder *folder, String *seg_name, int32_t field_num,
+           const char *ext);
+
+static void
+S_pad(DocValuesColumnWriterIVARS *ivars, int32_t doc_id);
+
+DocValuesWriter*
+DVWriter_new(Schema *schema, Snapshot *snapshot, Segment *segment,
+             PolyReader *polyreader) {
+    DocValuesWriter *self = (DocValuesWriter*)Class_Make_Obj(DOCVALUESWRITER);
+    return DVWriter_init(self, schema, snapshot, segment, polyreader);
+}
+
+DocValuesWriter*
+DVWriter_init(DocValuesWriter *self, Schema *schema, Snapshot *snapshot,
+              Segment *segment, PolyReader *polyreader) {
+    DataWriter_init((DataWriter*)self, schema, snapshot, segment, polyreader);
+    DocValuesWriterIVARS *const ivars = DVWriter_IVARS(self);
+    ivars->col_writers = Vec_new(Schema_Num_Fields(schema) + 1);
+    ivars->counts      = Hash_new(0);
+    return self;
+}
+
+void
+DVWriter_Destroy_IMP(DocValuesWriter *self) {
+    DocValuesWriterIVARS *const ivars = DVWriter_IVARS(self);
+    DECREF(ivars->col_writers);
+    DECREF(ivars->counts);
+    SUPER_DESTROY(self, DOCVALUESWRITER);
+}
+
+static DocValuesColumnWriter*
+S_lazy_init_col_writer(DocValuesWriter *self, int32_t field_num) {
+    DocValuesWriterIVARS *const ivars = DVWriter_IVARS(self);
+    DocValuesColumnWriter *col_writer
+        = (DocValuesColumnWriter*)Vec_Fetch(ivars->col_writers,
+                                            (size_t)field_num);
+    if (!col_writer) {
+        String    *field = Seg_Field_Name(ivars->segment, field_num);
+        FieldType *type  = Schema_Fetch_Type(ivars->schema, field);
+        col_writer = DVColWriter_new(ivars->folder,
+                                     Seg_Get_Name(ivars->segment),
+                                     field_num, type);
+        Vec_Store(ivars->col_writers, (size_t)field_num, (Obj*)col_writer);
+    }
+    return col_writer;
+}
+
+void
+DVWriter_Add_Inverted_Doc_IMP(DocValuesWriter *self, Inverter *inverter,
+                              int32_t doc_id) {
+    int32_t field_num;
+
+    Inverter_Iterate(inverter);
+    while (0 != (field_num = Inverter_Next(inverter))) {
+        FieldType *type = Inverter_Get_Type(inverter);
+        if (FType_Columnar(type)) {
+            DocValuesColumnWriter *col_writer
+                = S_lazy_init_col_writer(self, field_num);
+            DVColWriter_Add(col_writer, doc_id, Inverter_Get_Value(inverter));
+        }
+    }
+}
+
+void
+DVWriter_Add_Segment_IMP(DocValuesWriter *self, SegReader *reader,
+                         I32Array *doc_map) {
+    DocValuesWriterIVARS *const ivars = DVWriter_IVARS(self);
+    DocValuesReader *dv_reader = (DocValuesReader*)SegReader_Fetch(
+                                     reader, Class_Get_Name(DOCVALUESREADER));
+    int32_t doc_max = SegReader_Doc_Max(reader);
+    if (!dv_reader || doc_max == 0) { return; }
+
+    // Proceed field-at-a-time, so that each column gets written front to
+    // back.  Walk the docs in the order of their new doc ids, which differs
+    // from their old order if the doc map sorts the segment.
+    I32Array *old_ids  = doc_map ? DelWriter_invert_doc_map(doc_map) : NULL;
+    int32_t   num_docs = old_ids ? (int32_t)I32Arr_Get_Size(old_ids)
+                                 : doc_max;
+    Vector *fields = Schema_All_Fields(ivars->schema);
+    for (size_t i = 0, max = Vec_Get_Size(fields); i < max; i++) {
+        String    *field = (String*)Vec_Fetch(fields, i);
+        FieldType *type  = Schema_Fetch_Type(ivars->schema, field);
+        if (!FType_Columnar(type)) { continue; }
+
+        int32_t field_num = Seg_Field_Num(ivars->segment, field);
+        for (int32_t j = 0; j < num_docs; j++) {
+            int32_t old_id = old_ids ? I32Arr_Get(old_ids, (size_t)j) : j + 1;
+            int32_t new_id = doc_map
+                             ? I32Arr_Get(doc_map, (size_t)old_id)
+                             : old_id;
+            Obj *value = DVReader_Fetch_Value(dv_reader, field, old_id);
+            if (value) {
+                DocValuesColumnWriter *col_writer
+                    = S_lazy_init_col_writer(self, field_num);
+                DVColWriter_Add(col_writer, new_id, value);
+                DECREF(value);
+            }
+        }
+    }
+    DECREF(fields);
+    DECREF(old_ids);
+}
+
+void
+DVWriter_Finish_IMP(DocValuesWriter *self) {
+    DocValuesWriterIVARS *const ivars = DVWriter_IVARS(self);
+    Vector *const col_writers = ivars->col_writers;
+    int32_t doc_max = (int32_t)Seg_Get_Count(ivars->segment);
+    bool    wrote   = false;
+
+    for (size_t i = 1, max = Vec_Get_Size(col_writers); i < max; i++) {
+        DocValuesColumnWriter *col_writer
+            = (DocValuesColumnWriter*)Vec_Fetch(col_writers, i);
+        if (col_writer) {
+            String *field = Seg_Field_Name(ivars->segment, (int32_t)i);
+            int32_t count = DVColWriter_Finish(col_writer, doc_max);
+            Hash_Store(ivars->counts, field, (Obj*)Str_newf("%i32", count));
+            wrote = true;
+        }
+    }
+    Vec_Clear(col_writers);
+
+    // Only store metadata if at least one column was written.
+    if (wrote) {
+        Seg_Store_Metadata_Utf8(ivars->segment, "docvalues", 9,
+                                (Obj*)DVWriter_Metadata(self));
+    }
+}
+
+Hash*
+DVWriter_Metadata_IMP(DocValuesWriter *self) {
+    DocValuesWriterIVARS *const ivars = DVWriter_IVARS(self);
+    DVWriter_Metadata_t super_meta
+        = (DVWriter_Metadata_t)SUPER_METHOD_PTR(DOCVALUESWRITER,
+                                                LUCY_DVWriter_Metadata);
+    Hash *const metadata = super_meta(self);
+    Hash_Store_Utf8(metadata, "counts", 6, INCREF(ivars->counts));
+    return metadata;
+}
+
+int32_t
+DVWriter_Format_IMP(DocValuesWriter *self) {
+    UNUSED_VAR(self);
+    return DVWriter_current_file_format;
+}
+
+/*************************************************************************/
+
+DocValuesColumnWriter*
+DVColWriter_new(Folder *folder, String *seg_name, int32_t field_num,
+                FieldType *type) {
+    DocValuesColumnWriter *self
+        = (DocValuesColumnWriter*)Class_Make_Obj(DOCVALUESCOLUMNWRITER);
+    return DVColWriter_init(self, folder, seg_name, field_num, type);
+}
+
+DocValuesColumnWriter*
+DVColWriter_init(DocValuesColumnWriter *self, Folder *folder,
+                 String *seg_name, int32_t field_num, FieldType *type) {
+    DocValuesColumnWriterIVARS *const ivars = DVColWriter_IVARS(self);
+    ivars->prim_id  = FType_Primitive_ID(type) & FType_PRIMITIVE_ID_MASK;
+    ivars->next_doc = 0;
+    ivars->count    = 0;
+    ivars->present  = BitVec_new(0);
+    switch (ivars->prim_id) {
+        case FType_TEXT:
+        case FType_BLOB:
+            ivars->width = 0;
+            break;
+        case FType_INT32:
+        case FType_FLOAT32:
+            ivars->width = 4;
+            break;
+        case FType_INT64:
+        case FType_FLOAT64:
+            ivars->width = 8;
+            break;
+        default:
+            DECREF(self);
+            THROW(ERR, "Unrecognized primitive id: %i32",
+                  (int32_t)FType_Primitive_ID(type));
+    }
+
+    ivars->dat_out = S_open_out(folder, seg_name, field_num, "dat");
+    ivars->nul_out = S_open_out(folder, seg_name, field_num, "nul");
+    if (!ivars->width) {
+        ivars->ix_out = S_open_out(folder, seg_name, field_num, "ix");
+    }
+
+    return self;
+}
+
+static OutStream*
+S_open_out(Folder *folder, String *seg_name, int32_t field_num,
+           const char *ext) {
+    String *path = Str_newf("%o/docvalues-%i32.%s", seg_name, field_num,
+                            ext);
+    OutStream *outstream = Folder_Open_Out(folder, path);
+    DECREF(path);
+    if (!outstream) { RETHROW(INCREF(Err_get_error())); }
+    return outstream;
+}
+
+void
+DVColWriter_Destroy_IMP(DocValuesColumnWriter *self) {
+    DocValuesColumnWriterIVARS *const ivars = DVColWriter_IVARS(self);
+    DECREF(ivars->dat_out);
+    DECREF(ivars->ix_out);
+    DECREF(ivars->nul_out);
+    DECREF(ivars->present);
+    SUPER_DESTROY(self, DOCVALUESCOLUMNWRITER);
+}
+
+// Give every doc before `doc_id` which hasn't been written yet an empty
+// entry.
+static void
+S_pad(DocValuesColumnWriterIVARS *ivars, int32_t doc_id) {
+    OutStream *const dat_out = ivars->dat_out;
+    if (ivars->ix_out) {
+        int64_t filepos = OutStream_Tell(dat_out);
+        for (; ivars->next_doc < doc_id; ivars->next_doc++) {
+            OutStream_Write_I64(ivars->ix_out, filepos);
+        }
+    }
+    else if (ivars->width == 4) {
+        for (; ivars->next_doc < doc_id; ivars->next_doc++) {
+            OutStream_Write_I32(dat_out, 0);
+        }
+    }
+    else {
+        for (; ivars->next_doc < doc_id; ivars->next_doc++) {
+            OutStream_Write_I64(dat_out, 0);
+        }
+    }
+}
+
+void
+DVColWriter_Add_IMP(DocValuesColumnWriter *self, int32_t doc_id,
+                    Obj *value) {
+    DocValuesColumnWriterIVARS *const ivars = DVColWriter_IVARS(self);
+    OutStream *const dat_out = ivars->dat_out;
+
+    if (doc_id < ivars->next_doc) {
+        THROW(ERR, "Doc ids out of order: %i32 after %i32", doc_id,
+              ivars->next_doc - 1);
+    }
+    S_pad(ivars, doc_id);
+
+    switch (ivars->prim_id) {
+        case FType_TEXT: {
+            OutStream_Write_I64(ivars->ix_out, OutStream_Tell(dat_out));
+            OutStream_Write_Bytes(dat_out, Str_Get_Ptr8((String*)value),
+                                  Str_Get_Size((String*)value));
+            break;
+        }
+        case FType_BLOB: {
+            OutStream_Write_I64(ivars->ix_out, OutStream_Tell(dat_out));
+            OutStream_Write_Bytes(dat_out, Blob_Get_Buf((Blob*)value),
+                                  Blob_Get_Size((Blob*)value));
+            break;
+        }
+        case FType_INT32:
+            OutStream_Write_I32(dat_out,
+                                (int32_t)Int_Get_Value((Integer*)value));
+            break;
+        case FType_INT64:
+            OutStream_Write_I64(dat_out, Int_Get_Value((Integer*)value));
+            break;
+        case FType_FLOAT32:
+            OutStream_Write_F32(dat_out,
+                                (float)Float_Get_Value((Float*)value));
+            break;
+        case FType_FLOAT64:
+            OutStream_Write_F64(dat_out, Float_Get_Value((Float*)value));
+            break;
+        default:
+            THROW(ERR, "Unexpected primitive id: %i32",
+                  (int32_t)ivars->prim_id);
+    }
+
+    BitVec_Set(ivars->present, (size_t)doc_id);
+    ivars->next_doc = doc_id + 1;
+    ivars->count++;
+}
+
+int32_t
+DVColWriter_Finish_IMP(DocValuesColumnWriter *self, int32_t doc_max) {
+    DocValuesColumnWriterIVARS *const ivars = DVColWriter_IVARS(self);
+
+    // Pad out through `doc_max`, then write one final file pointer so that
+    // the length of the last value can be derived.
+    S_pad(ivars, doc_max + 1);
+    if (ivars->ix_out) {
+        OutStream_Write_I64(ivars->ix_out, OutStream_Tell(ivars->dat_out));
+        OutStream_Close(ivars->ix_out);
+    }
+    OutStream_Close(ivars->dat_out);
+
+    // Write out the bit vector of docs which have values.
+    BitVec_Grow(ivars->present, (size_t)doc_max + 1);
+    size_t byte_size = ((size_t)doc_max + 8) / 8;
+    OutStream_Write_Bytes(ivars->nul_out,
+                          (char*)BitVec_Get_Raw_Bits(ivars->present),
+                          byte_size);
+    OutStream_Close(ivars->nul_out);
+
+    return ivars->count;
+}
@@ -15,12 +15,14 @@
  */
 
 #define C_LUCY_DOCWRITER
+#define C_LUCY_DEFAULTDOCREADER
 #include "Lucy/Util/ToolSet.h"
 
 #include "Clownfish/Blob.h"
 #include "Clownfish/Num.h"
 #include "Lucy/Index/DocWriter.h"
 #include "Lucy/Document/Doc.h"
+#include "Lucy/Index/DeletionsWriter.h"
 #include "Lucy/Index/DocReader.h"
 #include "Lucy/Index/Inverter.h"
 #include "Lucy/Index/PolyReader.h"
@@ -29,14 +31,23 @@
 #include "Lucy/Index/Snapshot.h"
 #include "Lucy/Plan/FieldType.h"
 #include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
 #include "Lucy/Store/Folder.h"
+#include "Lucy/Store/InStream.h"
 #include "Lucy/Store/OutStream.h"
+#include "Lucy/Store/RAMFile.h"
 #include "Lucy/Util/Freezer.h"
+#include "Lucy/Util/LZ4.h"
 
 static OutStream*
 S_lazy_init(DocWriter *self);
 
-int32_t DocWriter_current_file_format = 2;
+// Compress the pending block, if any, into documents.dat and start a new
+// one.
+static void
+S_flush_block(DocWriter *self);
+
+int32_t DocWriter_current_file_format = 3;
 
 DocWriter*
 DocWriter_new(Schema *schema, Snapshot *snapshot, Segment *segment,
@@ -57,6 +68,9 @@ DocWriter_Destroy_IMP(DocWriter *self) {
     DocWriterIVARS *const ivars = DocWriter_IVARS(self);
     DECREF(ivars->dat_out);
     DECREF(ivars->ix_out);
+    DECREF(ivars->blk_out);
+    DECREF(ivars->block_file);
+    DECREF(ivars->block_out);
     SUPER_DESTROY(self, DOCWRITER);
 }
 
@@ -76,22 +90,58 @@ S_lazy_init(DocWriter *self) {
         ivars->dat_out = Folder_Open_Out(folder, dat_file);
         DECREF(dat_file);
         if (!ivars->dat_out) { RETHROW(INCREF(Err_get_error())); }
+        String *blk_file = Str_newf("%o/documents.blk", seg_name);
+        ivars->blk_out = Folder_Open_Out(folder, blk_file);
+        DECREF(blk_file);
+        if (!ivars->blk_out) { RETHROW(INCREF(Err_get_error())); }
+
+        // Records accumulate in RAM until there's a block's worth.
+        ivars->block_start = 0;
+        ivars->block_file  = RAMFile_new(NULL, false);
+        ivars->block_out   = OutStream_open((Obj*)ivars->block_file);
 
         // Go past non-doc #0.
         OutStream_Write_I64(ivars->ix_out, 0);
     }
 
-    return ivars->dat_out;
+    return ivars->block_out;
+}
+
+static void
+S_flush_block(DocWriter *self) {
+    DocWriterIVARS *const ivars = DocWriter_IVARS(self);
+    OutStream_Close(ivars->block_out);
+    ByteBuf *raw      = RAMFile_Get_Contents(ivars->block_file);
+    size_t   raw_size = BB_Get_Size(raw);
+
+    if (raw_size) {
+        // Record where the block starts in both the uncompressed and the
+        // compressed data.
+        OutStream_Write_I64(ivars->blk_out, ivars->block_start);
+        OutStream_Write_I64(ivars->blk_out, OutStream_Tell(ivars->dat_out));
+
+        ByteBuf *compressed = BB_new(LZ4_compress_bound(raw_size));
+        size_t   size = LZ4_compress(BB_Get_Buf(raw), raw_size,
+                                     BB_Get_Buf(compressed));
+        OutStream_Write_Bytes(ivars->dat_out, BB_Get_Buf(compressed), size);
+        DECREF(compressed);
+        ivars->block_start += (int64_t)raw_size;
+    }
+
+    DECREF(ivars->block_out);
+    DECREF(ivars->block_file);
+    ivars->block_file = RAMFile_new(NULL, false);
+    ivars->block_out  = OutStream_open((Obj*)ivars->block_file);
 }
 
 void
 DocWriter_Add_Inverted_Doc_IMP(DocWriter *self, Inverter *inverter,
                                int32_t doc_id) {
     DocWriterIVARS *const ivars = DocWriter_IVARS(self);
-    OutStream *dat_out    = S_lazy_init(self);
+    OutStream *block_out  = S_lazy_init(self);
     OutStream *ix_out     = ivars->ix_out;
     uint32_t   num_stored = 0;
-    int64_t    start      = OutStream_Tell(dat_out);
+    int64_t    start      = ivars->block_start + OutStream_Tell(block_out);
     int64_t    expected   = OutStream_Tell(ix_out) / 8;
 
     // Verify doc id.
@@ -105,7 +155,7 @@ DocWriter_Add_Inverted_Doc_IMP(DocWriter *self, Inverter *inverter,
         FieldType *type = Inverter_Get_Type(inverter);
         if (FType_Stored(type)) { num_stored++; }
     }
-    OutStream_Write_CU32(dat_out, num_stored);
+    OutStream_Write_CU32(block_out, num_stored);
 
     Inverter_Iterate(inverter);
     while (Inverter_Next(inverter)) {
@@ -114,7 +164,7 @@ DocWriter_Add_Inverted_Doc_IMP(DocWriter *self, Inverter *inverter,
         if (FType_Stored(type)) {
             String *field = Inverter_Get_Field_Name(inverter);
             Obj *value = Inverter_Get_Value(inverter);
-            Freezer_serialize_string(field, dat_out);
+            Freezer_serialize_string(field, block_out);
             switch (FType_Primitive_ID(type) & FType_PRIMITIVE_ID_MASK) {
                 case FType_TEXT: {
                     const char *buf  = Str_Get_Ptr8((String*)value);
@@ -123,8 +173,8 @@ DocWriter_Add_Inverted_Doc_IMP(DocWriter *self, Inverter *inverter,
                         THROW(ERR, "Field %o over 2GB: %u64", field,
                               (uint64_t)size);
                     }
-                    OutStream_Write_CU32(dat_out, (uint32_t)size);
-                    OutStream_Write_Bytes(dat_out, buf, size);
+                    OutStream_Write_CU32(block_out, (uint32_t)size);
+                    OutStream_Write_Bytes(block_out, buf, size);
                     break;
                 }
                 case FType_BLOB: {
@@ -134,28 +184,28 @@ DocWriter_Add_Inverted_Doc_IMP(DocWriter *self, Inverter *inverter,
                         THROW(ERR, "Field %o over 2GB: %u64", field,
                               (uint64_t)size);
                     }
-                    OutStream_Write_CU32(dat_out, (uint32_t)size);
-                    OutStream_Write_Bytes(dat_out, buf, size);
+                    OutStream_Write_CU32(block_out, (uint32_t)size);
+                    OutStream_Write_Bytes(block_out, buf, size);
                     break;
                 }
                 case FType_INT32: {
                     int32_t val = (int32_t)Int_Get_Value((Integer*)value);
-                    OutStream_Write_CI32(dat_out, val);
+                    OutStream_Write_CI32(block_out, val);
                     break;
                 }
                 case FType_INT64: {
                     int64_t val = Int_Get_Value((Integer*)value);
-                    OutStream_Write_CI64(dat_out, val);
+                    OutStream_Write_CI64(block_out, val);
                     break;
                 }
                 case FType_FLOAT32: {
                     float val = (float)Float_Get_Value((Float*)value);
-                    OutStream_Write_F32(dat_out, val);
+                    OutStream_Write_F32(block_out, val);
                     break;
                 }
                 case FType_FLOAT64: {
                     double val = Float_Get_Value((Float*)value);
-                    OutStream_Write_F64(dat_out, val);
+                    OutStream_Write_F64(block_out, val);
                     break;
                 }
                 default:
@@ -166,6 +216,10 @@ DocWriter_Add_Inverted_Doc_IMP(DocWriter *self, Inverter *inverter,
 
     // Write file pointer.
     OutStream_Write_I64(ix_out, start);
+
+    if (OutStream_Tell(block_out) >= DOCWRITER_BLOCK_SIZE) {
+        S_flush_block(self);
+    }
 }
 
 void
@@ -179,29 +233,45 @@ DocWriter_Add_Segment_IMP(DocWriter *self, SegReader *reader,
         return;
     }
     else {
-        OutStream *const dat_out = S_lazy_init(self);
+        S_lazy_init(self);
         OutStream *const ix_out  = ivars->ix_out;
         ByteBuf   *const buffer  = BB_new(0);
         DefaultDocReader *const doc_reader
             = (DefaultDocReader*)CERTIFY(
                   SegReader_Obtain(reader, Class_Get_Name(DOCREADER)),
                   DEFAULTDOCREADER);
+        DefaultDocReaderIVARS *const reader_ivars
+            = DefDocReader_IVARS(doc_reader);
 
-        for (int32_t i = 1, max = SegReader_Doc_Max(reader); i <= max; i++) {
-            if (I32Arr_Get(doc_map, (size_t)i)) {
-                int64_t  start = OutStream_Tell(dat_out);
+        // The records get copied over in the order of their new doc ids --
+        // front to back, unless the doc map sorts the segment.
+        I32Array *old_ids = DelWriter_invert_doc_map(doc_map);
+        if (reader_ivars->dat_in) {
+            InStream_Advise(reader_ivars->ix_in, FH_ADVICE_SEQUENTIAL);
+            InStream_Advise(reader_ivars->dat_in, FH_ADVICE_SEQUENTIAL);
+        }
 
-                // Copy record over.
-                DefDocReader_Read_Record(doc_reader, buffer, i);
-                const char *buf  = BB_Get_Buf(buffer);
-                size_t      size = BB_Get_Size(buffer);
-                OutStream_Write_Bytes(dat_out, buf, size);
+        for (size_t i = 0, max = I32Arr_Get_Size(old_ids); i < max; i++) {
+            int32_t    old_id    = I32Arr_Get(old_ids, i);
+            OutStream *block_out = ivars->block_out;
+            int64_t    start     = ivars->block_start
+                                   + OutStream_Tell(block_out);
 
-                // Write file pointer.
-                OutStream_Write_I64(ix_out, start);
+            // Copy record over.
+            DefDocReader_Read_Record(doc_reader, buffer, old_id);
+            const char *buf  = BB_Get_Buf(buffer);
+            size_t      size = BB_Get_Size(buffer);
+            OutStream_Write_Bytes(block_out, buf, size);
+
+            // Write file pointer.
+            OutStream_Write_I64(ix_out, start);
+
+            if (OutStream_Tell(block_out) >= DOCWRITER_BLOCK_SIZE) {
+                S_flush_block(self);
             }
         }
 
+        DECREF(old_ids);
         DECREF(buffer);
     }
 }
@@ -210,14 +280,19 @@ void
 DocWriter_Finish_IMP(DocWriter *self) {
     DocWriterIVARS *const ivars = DocWriter_IVARS(self);
     if (ivars->dat_out) {
+        S_flush_block(self);
+
         // Write one final file pointer, so that we can derive the length of
-        // the last record.
-        int64_t end = OutStream_Tell(ivars->dat_out);
-        OutStream_Write_I64(ivars->ix_out, end);
+        // the last record, and one final block entry, so that we can derive
+        // the length of the last block.
+        OutStream_Write_I64(ivars->ix_out, ivars->block_start);
+        OutStream_Write_I64(ivars->blk_out, ivars->block_start);
+        OutStream_Write_I64(ivars->blk_out, OutStream_Tell(ivars->dat_out));
 
         // Close down output streams.
         OutStream_Close(ivars->dat_out);
         OutStream_Close(ivars->ix_out);
+        OutStream_Close(ivars->blk_out);
         Seg_Store_Metadata_Utf8(ivars->segment, "documents", 9,
                                 (Obj*)DocWriter_Metadata(self));
     }
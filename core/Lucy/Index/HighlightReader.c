@@ -27,6 +27,7 @@
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/Snapshot.h"
 #include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
 #include "Lucy/Store/InStream.h"
 #include "Lucy/Store/OutStream.h"
 #include "Lucy/Store/Folder.h"
@@ -73,11 +74,6 @@ void
 PolyHLReader_Close_IMP(PolyHighlightReader *self) {
     PolyHighlightReaderIVARS *const ivars = PolyHLReader_IVARS(self);
     if (ivars->readers) {
-        for (size_t i = 0, max = Vec_Get_Size(ivars->readers); i < max; i++) {
-            HighlightReader *sub_reader
-                = (HighlightReader*)Vec_Fetch(ivars->readers, i);
-            if (sub_reader) { HLReader_Close(sub_reader); }
-        }
         DECREF(ivars->readers);
         DECREF(ivars->offsets);
         ivars->readers = NULL;
@@ -159,6 +155,10 @@ DefHLReader_init(DefaultHighlightReader *self, Schema *schema,
             DECREF(self);
             RETHROW(error);
         }
+
+        // Highlight data is fetched one hit at a time, by doc id.
+        InStream_Advise(ivars->ix_in, FH_ADVICE_RANDOM);
+        InStream_Advise(ivars->dat_in, FH_ADVICE_RANDOM);
     }
     DECREF(ix_file);
     DECREF(dat_file);
@@ -16,6 +16,7 @@
 
 #define C_LUCY_HIGHLIGHTWRITER
 #define C_LUCY_DEFAULTHIGHLIGHTWRITER
+#define C_LUCY_DEFAULTHIGHLIGHTREADER
 #include "Lucy/Util/ToolSet.h"
 
 #include <stdio.h>
@@ -26,6 +27,7 @@
 #include "Lucy/Analysis/Inversion.h"
 #include "Lucy/Plan/FieldType.h"
 #include "Lucy/Plan/FullTextType.h"
+#include "Lucy/Index/DeletionsWriter.h"
 #include "Lucy/Index/HighlightReader.h"
 #include "Lucy/Index/Inverter.h"
 #include "Lucy/Index/PolyReader.h"
@@ -33,6 +35,7 @@
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/Snapshot.h"
 #include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/OutStream.h"
 #include "Lucy/Store/InStream.h"
@@ -232,14 +235,23 @@ HLWriter_Add_Segment_IMP(HighlightWriter *self, SegReader *reader,
                   DEFAULTHIGHLIGHTREADER);
         OutStream *dat_out = S_lazy_init(self);
         OutStream *ix_out  = ivars->ix_out;
-        int32_t    orig;
         ByteBuf   *bb = BB_new(0);
 
-        for (orig = 1; orig <= doc_max; orig++) {
-            // Skip deleted docs.
-            if (doc_map && !I32Arr_Get(doc_map, (size_t)orig)) {
-                continue;
-            }
+        // The records get copied over in the order of their new doc ids --
+        // front to back, unless the doc map sorts the segment.  Deleted docs
+        // drop out of the inverted doc map.
+        I32Array *old_ids = doc_map ? DelWriter_invert_doc_map(doc_map) : NULL;
+        int32_t num_docs  = old_ids ? (int32_t)I32Arr_Get_Size(old_ids)
+                                    : doc_max;
+        DefaultHighlightReaderIVARS *const reader_ivars
+            = DefHLReader_IVARS(hl_reader);
+        if (reader_ivars->dat_in) {
+            InStream_Advise(reader_ivars->ix_in, FH_ADVICE_SEQUENTIAL);
+            InStream_Advise(reader_ivars->dat_in, FH_ADVICE_SEQUENTIAL);
+        }
+
+        for (int32_t i = 0; i < num_docs; i++) {
+            int32_t orig = old_ids ? I32Arr_Get(old_ids, (size_t)i) : i + 1;
 
             // Write file pointer.
             OutStream_Write_I64(ix_out, OutStream_Tell(dat_out));
@@ -250,6 +262,7 @@ HLWriter_Add_Segment_IMP(HighlightWriter *self, SegReader *reader,
 
             BB_Set_Size(bb, 0);
         }
+        DECREF(old_ids);
         DECREF(bb);
     }
 }
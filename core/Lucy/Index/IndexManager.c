@@ -23,6 +23,7 @@
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/Snapshot.h"
+#include "Lucy/Search/SortSpec.h"
 #include "Lucy/Store/DirHandle.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/Lock.h"
@@ -48,6 +49,7 @@ IxManager_init(IndexManager *self, String *host,
                                 : Str_new_from_trusted_utf8("", 0);
     ivars->lock_factory        = (LockFactory*)INCREF(lock_factory);
     ivars->folder              = NULL;
+    ivars->index_sort          = NULL;
     ivars->write_lock_timeout  = 1000;
     ivars->write_lock_interval = 100;
     ivars->merge_lock_timeout  = 0;
@@ -64,6 +66,7 @@ IxManager_Destroy_IMP(IndexManager *self) {
     DECREF(ivars->host);
     DECREF(ivars->folder);
     DECREF(ivars->lock_factory);
+    DECREF(ivars->index_sort);
     SUPER_DESTROY(self, INDEXMANAGER);
 }
 
@@ -420,4 +423,17 @@ IxManager_Set_Deletion_Lock_Interval_IMP(IndexManager *self,
     IxManager_IVARS(self)->deletion_lock_interval = interval;
 }
 
+void
+IxManager_Set_Index_Sort_IMP(IndexManager *self, SortSpec *sort_spec) {
+    IndexManagerIVARS *const ivars = IxManager_IVARS(self);
+    SortSpec *temp = ivars->index_sort;
+    ivars->index_sort = (SortSpec*)INCREF(sort_spec);
+    DECREF(temp);
+}
+
+SortSpec*
+IxManager_Get_Index_Sort_IMP(IndexManager *self) {
+    return IxManager_IVARS(self)->index_sort;
+}
+
 
@@ -75,7 +75,7 @@ IxReader_Close_IMP(IndexReader *self) {
         while (HashIter_Next(iter)) {
             DataReader *component = (DataReader*)HashIter_Get_Value(iter);
             if (Obj_is_a((Obj*)component, DATAREADER)) {
-                DataReader_Close(component);
+                DataReader_Close_Shared(component);
             }
         }
         DECREF(iter);
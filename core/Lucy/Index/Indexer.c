@@ -29,6 +29,7 @@
 #include "Lucy/Index/FilePurger.h"
 #include "Lucy/Index/IndexManager.h"
 #include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/PostingListWriter.h"
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Index/Snapshot.h"
@@ -38,10 +39,17 @@
 #include "Lucy/Search/Query.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/FSFolder.h"
+#include "Lucy/Store/InStream.h"
 #include "Lucy/Store/Lock.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Store/RAMFile.h"
 #include "Lucy/Util/Freezer.h"
 #include "Lucy/Util/IndexFileNames.h"
 #include "Lucy/Util/Json.h"
+#include "Lucy/Util/Threads.h"
+
+// Number of docs to buffer per thread before handing them out.
+#define DOCS_PER_THREAD 256
 
 int32_t Indexer_CREATE   = 0x00000001;
 int32_t Indexer_TRUNCATE = 0x00000002;
@@ -63,6 +71,18 @@ S_init_folder(Obj *index, bool create);
 static String*
 S_find_schema_file(Snapshot *snapshot);
 
+// Copy a doc into the buffer of docs waiting for the worker threads.
+static void
+S_buffer_doc(Indexer *self, Doc *doc, float boost);
+
+// Add all buffered docs to the workers' segments, in parallel.
+static void
+S_flush_docs(Indexer *self);
+
+// Finish the workers' segments and add them to the snapshot.
+static void
+S_finish_workers(Indexer *self);
+
 Indexer*
 Indexer_new(Schema *schema, Obj *index, IndexManager *manager, int32_t flags) {
     Indexer *self = (Indexer*)Class_Make_Obj(INDEXER);
@@ -86,6 +106,11 @@ Indexer_init(Indexer *self, Schema *schema, Obj *index,
     ivars->needs_commit  = false;
     ivars->snapfile      = NULL;
     ivars->merge_lock    = NULL;
+    ivars->workers       = NULL;
+    ivars->doc_buf       = NULL;
+    ivars->doc_out       = NULL;
+    ivars->num_pending   = 0;
+    ivars->num_threads   = 1;
 
     // Assign.
     ivars->folder       = folder;
@@ -208,6 +233,8 @@ Indexer_init(Indexer *self, Schema *schema, Obj *index,
         = FilePurger_new(folder, ivars->snapshot, ivars->manager);
     ivars->seg_writer = SegWriter_new(ivars->schema, ivars->snapshot,
                                      ivars->segment, ivars->polyreader);
+    SegWriter_Set_Index_Sort(ivars->seg_writer,
+                             IxManager_Get_Index_Sort(ivars->manager));
     SegWriter_Prep_Seg_Dir(ivars->seg_writer);
 
     // Grab a local ref to the DeletionsWriter.
@@ -237,6 +264,9 @@ Indexer_Destroy_IMP(Indexer *self) {
     DECREF(ivars->file_purger);
     DECREF(ivars->write_lock);
     DECREF(ivars->snapfile);
+    DECREF(ivars->workers);
+    DECREF(ivars->doc_out);
+    DECREF(ivars->doc_buf);
     SUPER_DESTROY(self, INDEXER);
 }
 
@@ -271,7 +301,175 @@ S_init_folder(Obj *index, bool create) {
 void
 Indexer_Add_Doc_IMP(Indexer *self, Doc *doc, float boost) {
     IndexerIVARS *const ivars = Indexer_IVARS(self);
-    SegWriter_Add_Doc(ivars->seg_writer, doc, boost);
+    if (ivars->num_threads > 1) {
+        S_buffer_doc(self, doc, boost);
+    }
+    else {
+        SegWriter_Add_Doc(ivars->seg_writer, doc, boost);
+    }
+}
+
+static void
+S_buffer_doc(Indexer *self, Doc *doc, float boost) {
+    IndexerIVARS *const ivars = Indexer_IVARS(self);
+
+    // Serialize rather than hold on to the doc: callers often reuse the same
+    // Doc object, and the worker threads need copies that nothing else
+    // refers to.
+    if (!ivars->doc_out) {
+        ivars->doc_buf = RAMFile_new(NULL, false);
+        ivars->doc_out = OutStream_open((Obj*)ivars->doc_buf);
+    }
+    OutStream_Write_F32(ivars->doc_out, boost);
+    Freezer_freeze((Obj*)doc, ivars->doc_out);
+    ivars->num_pending++;
+
+    if (ivars->num_pending >= ivars->num_threads * DOCS_PER_THREAD) {
+        S_flush_docs(self);
+    }
+}
+
+// Give each worker a private copy of the Schema, a private Snapshot and an
+// empty PolyReader, so that the objects a SegWriter creates lazily while
+// adding docs never touch refcounts shared with another thread.  The worker
+// segments are numbered after the Indexer's own.
+static void
+S_init_workers(Indexer *self) {
+    IndexerIVARS *const ivars = Indexer_IVARS(self);
+    Obj     *dump    = (Obj*)Schema_Dump(ivars->schema);
+    int64_t  seg_num = Seg_Get_Number(ivars->segment);
+
+    ivars->workers = Vec_new(ivars->num_threads);
+    for (uint32_t i = 0; i < ivars->num_threads; i++) {
+        Schema   *schema   = (Schema*)CERTIFY(Freezer_load(dump), SCHEMA);
+        Snapshot *snapshot = Snapshot_new();
+        Segment  *segment  = Seg_new(seg_num + 1 + i);
+        PolyReader *polyreader
+            = PolyReader_new(schema, ivars->folder, NULL, NULL, NULL);
+
+        Vector *fields = Schema_All_Fields(schema);
+        for (size_t j = 0, max = Vec_Get_Size(fields); j < max; j++) {
+            Seg_Add_Field(segment, (String*)Vec_Fetch(fields, j));
+        }
+        DECREF(fields);
+
+        SegWriter *seg_writer
+            = SegWriter_new(schema, snapshot, segment, polyreader);
+        SegWriter_Set_Index_Sort(seg_writer,
+                                 IxManager_Get_Index_Sort(ivars->manager));
+        SegWriter_Prep_Seg_Dir(seg_writer);
+
+        // Look up the segment directory now, so that the Folder has already
+        // cached it before several threads open files within it.
+        Folder_Find_Folder(ivars->folder, Seg_Get_Name(segment));
+
+        Vec_Push(ivars->workers, (Obj*)seg_writer);
+        DECREF(polyreader);
+        DECREF(segment);
+        DECREF(snapshot);
+        DECREF(schema);
+    }
+
+    DECREF(dump);
+}
+
+typedef struct {
+    SegWriter  *seg_writer;
+    Doc       **docs;
+    float      *boosts;
+    uint32_t    num_docs;
+} S_WorkerBatch;
+
+// Runs on a worker thread.  Each tick has a SegWriter of its own, so the
+// only object it shares with other threads is the Folder.
+static void
+S_add_docs(void *context, uint32_t tick) {
+    S_WorkerBatch *batch = (S_WorkerBatch*)context + tick;
+    for (uint32_t i = 0; i < batch->num_docs; i++) {
+        SegWriter_Add_Doc(batch->seg_writer, batch->docs[i],
+                          batch->boosts[i]);
+    }
+}
+
+static void
+S_flush_docs(Indexer *self) {
+    IndexerIVARS *const ivars = Indexer_IVARS(self);
+    if (!ivars->num_pending) { return; }
+    if (!ivars->workers) { S_init_workers(self); }
+
+    uint32_t num_workers = (uint32_t)Vec_Get_Size(ivars->workers);
+    uint32_t num_docs    = ivars->num_pending;
+    uint32_t max_batch   = (num_docs + num_workers - 1) / num_workers;
+    Doc    **docs   = (Doc**)MALLOCATE(num_docs * sizeof(Doc*));
+    float   *boosts = (float*)MALLOCATE(num_docs * sizeof(float));
+    S_WorkerBatch *batches
+        = (S_WorkerBatch*)CALLOCATE(num_workers, sizeof(S_WorkerBatch));
+    for (uint32_t i = 0; i < num_workers; i++) {
+        batches[i].seg_writer = (SegWriter*)Vec_Fetch(ivars->workers, i);
+        batches[i].docs       = docs + i * max_batch;
+        batches[i].boosts     = boosts + i * max_batch;
+    }
+
+    // Thaw the buffered docs here on the calling thread, dealing them out
+    // in turn so that each worker gets a similar mix.
+    OutStream_Close(ivars->doc_out);
+    InStream *instream = InStream_open((Obj*)ivars->doc_buf);
+    for (uint32_t i = 0; i < num_docs; i++) {
+        S_WorkerBatch *batch = batches + i % num_workers;
+        batch->boosts[batch->num_docs] = InStream_Read_F32(instream);
+        batch->docs[batch->num_docs]   = (Doc*)Freezer_thaw(instream);
+        batch->num_docs++;
+    }
+    InStream_Close(instream);
+    DECREF(instream);
+    DECREF(ivars->doc_out);
+    DECREF(ivars->doc_buf);
+    ivars->doc_out     = NULL;
+    ivars->doc_buf     = NULL;
+    ivars->num_pending = 0;
+
+    Threads_run(num_workers, num_workers, S_add_docs, batches);
+
+    for (uint32_t i = 0; i < num_workers; i++) {
+        for (uint32_t j = 0; j < batches[i].num_docs; j++) {
+            DECREF(batches[i].docs[j]);
+        }
+    }
+    FREEMEM(batches);
+    FREEMEM(boosts);
+    FREEMEM(docs);
+}
+
+static int64_t
+S_worker_doc_count(Indexer *self) {
+    IndexerIVARS *const ivars = Indexer_IVARS(self);
+    int64_t count = 0;
+    if (ivars->workers) {
+        for (size_t i = 0, max = Vec_Get_Size(ivars->workers); i < max; i++) {
+            SegWriter *seg_writer = (SegWriter*)Vec_Fetch(ivars->workers, i);
+            count += Seg_Get_Count(SegWriter_Get_Segment(seg_writer));
+        }
+    }
+    return count;
+}
+
+static void
+S_finish_workers(Indexer *self) {
+    IndexerIVARS *const ivars = Indexer_IVARS(self);
+    if (!ivars->workers) { return; }
+    for (size_t i = 0, max = Vec_Get_Size(ivars->workers); i < max; i++) {
+        SegWriter *seg_writer = (SegWriter*)Vec_Fetch(ivars->workers, i);
+        Segment   *segment    = SegWriter_Get_Segment(seg_writer);
+        String    *seg_name   = Seg_Get_Name(segment);
+        if (Seg_Get_Count(segment)) {
+            SegWriter_Finish(seg_writer);
+            Snapshot_Add_Entry(ivars->snapshot, seg_name);
+        }
+        else {
+            // Fewer docs than threads.
+            Folder_Delete_Tree(ivars->folder, seg_name);
+        }
+    }
 }
 
 void
@@ -428,6 +626,9 @@ S_maybe_merge(Indexer *self, Vector *seg_readers) {
         DECREF(merge_lock);
     }
 
+    // Deletions files mustn't build on files a background merge may remove.
+    DelWriter_Set_Merge_Cutoff(ivars->del_writer, cutoff);
+
     // Get a list of segments to recycle.  Validate and confirm that there are
     // no dupes in the list.
     Vector *to_merge = IxManager_Recycle(ivars->manager, ivars->polyreader,
@@ -491,6 +692,10 @@ Indexer_Prepare_Commit_IMP(Indexer *self) {
         THROW(ERR, "Can't call Prepare_Commit() more than once");
     }
 
+    // Add any docs still waiting for the worker threads.
+    S_flush_docs(self);
+    int64_t worker_doc_count = S_worker_doc_count(self);
+
     // Merge existing index data.
     if (num_seg_readers) {
         merge_happened = S_maybe_merge(self, seg_readers);
@@ -498,6 +703,7 @@ Indexer_Prepare_Commit_IMP(Indexer *self) {
 
     // Add a new segment and write a new snapshot file if...
     if (Seg_Get_Count(ivars->segment)             // Docs/segs added.
+        || worker_doc_count                      // Docs added by threads.
         || merge_happened                        // Some segs merged.
         || !Snapshot_Num_Entries(ivars->snapshot) // Initializing index.
         || DelWriter_Updated(ivars->del_writer)
@@ -516,8 +722,19 @@ Indexer_Prepare_Commit_IMP(Indexer *self) {
         StrHelp_to_base36(schema_gen, &base36);
         String *new_schema_name = Str_newf("schema_%s.json", base36);
 
-        // Finish the segment, write schema file.
-        SegWriter_Finish(ivars->seg_writer);
+        // Finish the segments, write schema file.  Skip our own segment if
+        // the worker threads got all the new docs and it holds nothing else.
+        if (Seg_Get_Count(ivars->segment)
+            || merge_happened
+            || DelWriter_Updated(ivars->del_writer)
+            || !worker_doc_count
+           ) {
+            SegWriter_Finish(ivars->seg_writer);
+        }
+        else {
+            Folder_Delete_Tree(folder, Seg_Get_Name(ivars->segment));
+        }
+        S_finish_workers(self);
         Schema_Write(schema, folder, new_schema_name);
         String *old_schema_name = S_find_schema_file(snapshot);
         if (old_schema_name) {
@@ -588,6 +805,28 @@ Indexer_Get_Seg_Writer_IMP(Indexer *self) {
     return Indexer_IVARS(self)->seg_writer;
 }
 
+void
+Indexer_Set_Num_Threads_IMP(Indexer *self, uint32_t num_threads) {
+    IndexerIVARS *const ivars = Indexer_IVARS(self);
+    if (ivars->workers || ivars->num_pending) {
+        THROW(ERR, "Can't change the number of threads after adding docs");
+    }
+    ivars->num_threads = num_threads ? num_threads : 1;
+
+    // Postings merged into the Indexer's own segment get sorted on the same
+    // number of threads.
+    PostingListWriter *plist_writer = (PostingListWriter*)SegWriter_Fetch(
+        ivars->seg_writer, Class_Get_Name(POSTINGLISTWRITER));
+    if (plist_writer && Obj_is_a((Obj*)plist_writer, POSTINGLISTWRITER)) {
+        PListWriter_Set_Sort_Threads(plist_writer, ivars->num_threads);
+    }
+}
+
+uint32_t
+Indexer_Get_Num_Threads_IMP(Indexer *self) {
+    return Indexer_IVARS(self)->num_threads;
+}
+
 Doc*
 Indexer_Get_Stock_Doc_IMP(Indexer *self) {
     return Indexer_IVARS(self)->stock_doc;
@@ -232,11 +232,10 @@ InvEntry_init(InverterEntry *self, Schema *schema, String *field,
         ivars->type = (FieldType*)INCREF(Schema_Fetch_Type(schema, field));
         if (!ivars->type) { THROW(ERR, "Unknown field: '%o'", field); }
         ivars->value   = NULL;
-        ivars->indexed = FType_Indexed(ivars->type);
-        if (ivars->indexed && FType_is_a(ivars->type, NUMERICTYPE)) {
-            THROW(ERR, "Field '%o' spec'd as indexed, but numerical types cannot "
-                  "be indexed yet", field);
-        }
+        // Indexed numeric fields go into a point index rather than being
+        // inverted.  See PointWriter.
+        ivars->indexed = FType_Indexed(ivars->type)
+                         && !FType_is_a(ivars->type, NUMERICTYPE);
         if (FType_is_a(ivars->type, FULLTEXTTYPE)) {
             ivars->highlightable
                 = FullTextType_Highlightable((FullTextType*)ivars->type);
@@ -0,0 +1,92 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_LAYEREDDELDOCS
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Index/LayeredDelDocs.h"
+
+LayeredDelDocs*
+LayeredDelDocs_new(Vector *layers) {
+    LayeredDelDocs *self = (LayeredDelDocs*)Class_Make_Obj(LAYEREDDELDOCS);
+    return LayeredDelDocs_init(self, layers);
+}
+
+LayeredDelDocs*
+LayeredDelDocs_init(LayeredDelDocs *self, Vector *layers) {
+    BitVec_init((BitVector*)self, 0);
+    LayeredDelDocsIVARS *const ivars = LayeredDelDocs_IVARS(self);
+    for (size_t i = 0, max = Vec_Get_Size(layers); i < max; i++) {
+        CERTIFY(Vec_Fetch(layers, i), BITVECTOR);
+    }
+    ivars->layers = (Vector*)INCREF(layers);
+    return self;
+}
+
+void
+LayeredDelDocs_Destroy_IMP(LayeredDelDocs *self) {
+    LayeredDelDocsIVARS *const ivars = LayeredDelDocs_IVARS(self);
+    DECREF(ivars->layers);
+    SUPER_DESTROY(self, LAYEREDDELDOCS);
+}
+
+bool
+LayeredDelDocs_Get_IMP(LayeredDelDocs *self, size_t tick) {
+    Vector *const layers = LayeredDelDocs_IVARS(self)->layers;
+    for (size_t i = 0, max = Vec_Get_Size(layers); i < max; i++) {
+        if (BitVec_Get((BitVector*)Vec_Fetch(layers, i), tick)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int32_t
+LayeredDelDocs_Next_Hit_IMP(LayeredDelDocs *self, size_t tick) {
+    Vector *const layers = LayeredDelDocs_IVARS(self)->layers;
+    int32_t next_hit = -1;
+    for (size_t i = 0, max = Vec_Get_Size(layers); i < max; i++) {
+        int32_t hit = BitVec_Next_Hit((BitVector*)Vec_Fetch(layers, i), tick);
+        if (hit != -1 && (next_hit == -1 || hit < next_hit)) {
+            next_hit = hit;
+        }
+    }
+    return next_hit;
+}
+
+size_t
+LayeredDelDocs_Count_IMP(LayeredDelDocs *self) {
+    Vector *const layers = LayeredDelDocs_IVARS(self)->layers;
+    size_t count = 0;
+    for (size_t i = 0, max = Vec_Get_Size(layers); i < max; i++) {
+        count += BitVec_Count((BitVector*)Vec_Fetch(layers, i));
+    }
+    return count;
+}
+
+I32Array*
+LayeredDelDocs_To_Array_IMP(LayeredDelDocs *self) {
+    size_t   count   = LayeredDelDocs_Count(self);
+    int32_t *doc_ids = (int32_t*)MALLOCATE((count + 1) * sizeof(int32_t));
+    size_t   num     = 0;
+    int32_t  doc_id  = LayeredDelDocs_Next_Hit(self, 0);
+    while (doc_id != -1 && num < count) {
+        doc_ids[num++] = doc_id;
+        doc_id = LayeredDelDocs_Next_Hit(self, (size_t)doc_id + 1);
+    }
+    return I32Arr_new_steal(doc_ids, num);
+}
+
@@ -24,13 +24,15 @@
 #include "Lucy/Plan/Architecture.h"
 #include "Lucy/Plan/FieldType.h"
 #include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/InStream.h"
 #include "Lucy/Util/NumberUtils.h"
 
-// Read the data we've arrived at after a seek operation.
+// Read the entry at `tick` into a term stepper and a TermInfo.
 static void
-S_read_entry(LexIndex *self);
+S_read_entry(LexIndex *self, int32_t tick, TermStepper *term_stepper,
+             TermInfo *tinfo);
 
 LexIndex*
 LexIndex_new(Schema *schema, Folder *folder, Segment *segment,
@@ -81,6 +83,11 @@ LexIndex_init(LexIndex *self, Schema *schema, Folder *folder,
         DECREF(self);
         RETHROW(error);
     }
+
+    // Lookups binary search the index, hopping all over both files.
+    InStream_Advise(ivars->ixix_in, FH_ADVICE_RANDOM);
+    InStream_Advise(ivars->ix_in, FH_ADVICE_RANDOM);
+
     ivars->index_interval = Arch_Index_Interval(arch);
     ivars->skip_interval  = Arch_Skip_Interval(arch);
     ivars->size    = (int32_t)(InStream_Length(ivars->ixix_in) / (int32_t)sizeof(int64_t));
@@ -122,13 +129,13 @@ LexIndex_Get_Term_Info_IMP(LexIndex *self) {
 }
 
 static void
-S_read_entry(LexIndex *self) {
+S_read_entry(LexIndex *self, int32_t tick, TermStepper *term_stepper,
+             TermInfo *tinfo) {
     LexIndexIVARS *const ivars = LexIndex_IVARS(self);
     InStream *ix_in  = ivars->ix_in;
-    TermInfo *const tinfo = ivars->tinfo;
-    int64_t offset = (int64_t)NumUtil_decode_bigend_u64(ivars->offsets + ivars->tick);
+    int64_t offset = (int64_t)NumUtil_decode_bigend_u64(ivars->offsets + tick);
     InStream_Seek(ix_in, offset);
-    TermStepper_Read_Key_Frame(ivars->term_stepper, ix_in);
+    TermStepper_Read_Key_Frame(term_stepper, ix_in);
     int32_t doc_freq = InStream_Read_CI32(ix_in);
     TInfo_Set_Doc_Freq(tinfo, doc_freq);
     TInfo_Set_Post_FilePos(tinfo, InStream_Read_CI64(ix_in));
@@ -139,6 +146,16 @@ S_read_entry(LexIndex *self) {
     TInfo_Set_Lex_FilePos(tinfo, InStream_Read_CI64(ix_in));
 }
 
+void
+LexIndex_Read_Tick_IMP(LexIndex *self, int32_t tick,
+                       TermStepper *term_stepper, TermInfo *tinfo) {
+    LexIndexIVARS *const ivars = LexIndex_IVARS(self);
+    if (tick < 0 || tick >= ivars->size) {
+        THROW(ERR, "Tick out of range: %i32 (size %i32)", tick, ivars->size);
+    }
+    S_read_entry(self, tick, term_stepper, tinfo);
+}
+
 void
 LexIndex_Seek_IMP(LexIndex *self, Obj *target) {
     LexIndexIVARS *const ivars = LexIndex_IVARS(self);
@@ -198,7 +215,7 @@ LexIndex_Seek_IMP(LexIndex *self, Obj *target) {
                  : result == -100 // if result is still -100, it wasn't set
                  ? hi
                  : result;
-    S_read_entry(self);
+    S_read_entry(self, ivars->tick, ivars->term_stepper, ivars->tinfo);
 }
 
 
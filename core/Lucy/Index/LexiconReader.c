@@ -72,11 +72,6 @@ void
 PolyLexReader_Close_IMP(PolyLexiconReader *self) {
     PolyLexiconReaderIVARS *const ivars = PolyLexReader_IVARS(self);
     if (ivars->readers) {
-        for (size_t i = 0, max = Vec_Get_Size(ivars->readers); i < max; i++) {
-            LexiconReader *reader
-                = (LexiconReader*)Vec_Fetch(ivars->readers, i);
-            if (reader) { LexReader_Close(reader); }
-        }
         Vec_Clear(ivars->readers);
     }
 }
@@ -218,15 +213,8 @@ S_find_tinfo(DefaultLexiconReader *self, String *field, Obj *target) {
         SegLexicon *lexicon
             = (SegLexicon*)Vec_Fetch(ivars->lexicons, (size_t)field_num);
 
-        if (lexicon) {
-            // Iterate until the result is ge the term.
-            SegLex_Seek(lexicon, target);
-
-            //if found matches target, return info; otherwise NULL
-            Obj *found = SegLex_Get_Term(lexicon);
-            if (found && Obj_Equals(target, found)) {
-                return SegLex_Get_Term_Info(lexicon);
-            }
+        if (lexicon && SegLex_Seek_Exact(lexicon, target)) {
+            return SegLex_Get_Term_Info(lexicon);
         }
     }
     return NULL;
@@ -31,6 +31,7 @@
 #include "Lucy/Plan/Architecture.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/FST.h"
 
 int32_t LexWriter_current_file_format = 3;
 
@@ -62,6 +63,8 @@ LexWriter_init(LexiconWriter *self, Schema *schema, Snapshot *snapshot,
     ivars->dat_file           = NULL;
     ivars->ix_file            = NULL;
     ivars->ixix_file          = NULL;
+    ivars->fst_file           = NULL;
+    ivars->fst_builder        = NULL;
     ivars->counts             = Hash_new(0);
     ivars->ix_counts          = Hash_new(0);
     ivars->temp_mode          = false;
@@ -79,6 +82,8 @@ LexWriter_Destroy_IMP(LexiconWriter *self) {
     DECREF(ivars->dat_file);
     DECREF(ivars->ix_file);
     DECREF(ivars->ixix_file);
+    DECREF(ivars->fst_file);
+    DECREF(ivars->fst_builder);
     DECREF(ivars->dat_out);
     DECREF(ivars->ix_out);
     DECREF(ivars->ixix_out);
@@ -116,6 +121,13 @@ LexWriter_Add_Term_IMP(LexiconWriter* self, Obj* term_text, TermInfo* tinfo) {
         S_add_last_term_to_ix(self);
     }
 
+    if (ivars->fst_builder) {
+        // Map the term's bytes to its term number.
+        ByteBuf *bytes = (ByteBuf*)CERTIFY(term_text, BYTEBUF);
+        FSTBuilder_Add(ivars->fst_builder, BB_Get_Buf(bytes),
+                       BB_Get_Size(bytes), (uint64_t)ivars->count);
+    }
+
     TermStepper_Write_Delta(ivars->term_stepper, dat_out, term_text);
     TermStepper_Write_Delta(ivars->tinfo_stepper, dat_out, (Obj*)tinfo);
 
@@ -137,9 +149,11 @@ LexWriter_Start_Field_IMP(LexiconWriter *self, int32_t field_num) {
     DECREF(ivars->dat_file);
     DECREF(ivars->ix_file);
     DECREF(ivars->ixix_file);
+    DECREF(ivars->fst_file);
     ivars->dat_file  = Str_newf("%o/lexicon-%i32.dat",  seg_name, field_num);
     ivars->ix_file   = Str_newf("%o/lexicon-%i32.ix",   seg_name, field_num);
     ivars->ixix_file = Str_newf("%o/lexicon-%i32.ixix", seg_name, field_num);
+    ivars->fst_file  = Str_newf("%o/lexicon-%i32.fst",  seg_name, field_num);
     ivars->dat_out = Folder_Open_Out(folder, ivars->dat_file);
     if (!ivars->dat_out) { RETHROW(INCREF(Err_get_error())); }
     ivars->ix_out = Folder_Open_Out(folder, ivars->ix_file);
@@ -152,6 +166,7 @@ LexWriter_Start_Field_IMP(LexiconWriter *self, int32_t field_num) {
     ivars->ix_count = 0;
     ivars->term_stepper = FType_Make_Term_Stepper(type);
     TermStepper_Reset(ivars->tinfo_stepper);
+    ivars->fst_builder = FSTBuilder_new();
 }
 
 void
@@ -164,6 +179,16 @@ LexWriter_Finish_Field_IMP(LexiconWriter *self, int32_t field_num) {
     Hash_Store(ivars->ix_counts, field,
                (Obj*)Str_newf("%i32", ivars->ix_count));
 
+    // Write the term index.
+    OutStream *fst_out = Folder_Open_Out(LexWriter_Get_Folder(self),
+                                         ivars->fst_file);
+    if (!fst_out) { RETHROW(INCREF(Err_get_error())); }
+    FSTBuilder_Finish(ivars->fst_builder, fst_out);
+    OutStream_Close(fst_out);
+    DECREF(fst_out);
+    DECREF(ivars->fst_builder);
+    ivars->fst_builder = NULL;
+
     // Close streams.
     OutStream_Close(ivars->dat_out);
     OutStream_Close(ivars->ix_out);
@@ -0,0 +1,384 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_POINTREADER
+#define C_LUCY_DEFAULTPOINTREADER
+#define C_LUCY_POINTTREE
+#include "Lucy/Util/ToolSet.h"
+
+#include <string.h>
+
+#include "Lucy/Index/PointReader.h"
+#include "Lucy/Index/PointWriter.h"
+#include "Lucy/Index/Segment.h"
+#include "Lucy/Index/Snapshot.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Object/I32Array.h"
+#include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
+#include "Lucy/Store/Folder.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Util/Json.h"
+#include "Lucy/Util/NumberUtils.h"
+#include "Clownfish/Util/SortUtils.h"
+
+// Each entry in the ".ix" file: lowest key, highest key, file pointer.
+#define LEAF_ENTRY_SIZE 24
+
+// Above this many matches per doc in the segment, ordering the matches with
+// a bit vector beats sorting them.
+#define DENSE_RATIO 32
+
+static InStream*
+S_open_in(Folder *folder, String *seg_name, int32_t field_num,
+          const char *ext);
+
+PointReader*
+PointReader_init(PointReader *self, Schema *schema, Folder *folder,
+                 Snapshot *snapshot, Vector *segments, int32_t seg_tick) {
+    return (PointReader*)DataReader_init((DataReader*)self, schema, folder,
+                                         snapshot, segments, seg_tick);
+}
+
+PointReader*
+PointReader_Aggregator_IMP(PointReader *self, Vector *readers,
+                           I32Array *offsets) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(readers);
+    UNUSED_VAR(offsets);
+    return NULL;
+}
+
+uint64_t
+PointReader_key_i64(int64_t value) {
+    return (uint64_t)value ^ UINT64_C(0x8000000000000000);
+}
+
+uint64_t
+PointReader_key_f64(double value) {
+    union { double d; uint64_t u; } bits;
+    bits.d = value == 0.0 ? 0.0 : value;
+    // Flip all the bits of negative numbers, so that larger magnitudes sort
+    // lower, and only the sign bit of the rest.
+    if (bits.u & UINT64_C(0x8000000000000000)) {
+        return ~bits.u;
+    }
+    else {
+        return bits.u | UINT64_C(0x8000000000000000);
+    }
+}
+
+/***************************************************************************/
+
+DefaultPointReader*
+DefPointReader_new(Schema *schema, Folder *folder, Snapshot *snapshot,
+                   Vector *segments, int32_t seg_tick) {
+    DefaultPointReader *self
+        = (DefaultPointReader*)Class_Make_Obj(DEFAULTPOINTREADER);
+    return DefPointReader_init(self, schema, folder, snapshot, segments,
+                               seg_tick);
+}
+
+DefaultPointReader*
+DefPointReader_init(DefaultPointReader *self, Schema *schema, Folder *folder,
+                    Snapshot *snapshot, Vector *segments, int32_t seg_tick) {
+    PointReader_init((PointReader*)self, schema, folder, snapshot, segments,
+                     seg_tick);
+    DefaultPointReaderIVARS *const ivars = DefPointReader_IVARS(self);
+    Segment *segment  = DefPointReader_Get_Segment(self);
+    Hash    *metadata = (Hash*)Seg_Fetch_Metadata_Utf8(segment, "points", 6);
+
+    // Check format.
+    ivars->format = 0;
+    if (metadata) {
+        Obj *format = Hash_Fetch_Utf8(metadata, "format", 6);
+        if (!format) { THROW(ERR, "Missing 'format' var"); }
+        else {
+            ivars->format = (int32_t)Json_obj_to_i64(format);
+            if (ivars->format < 1
+                || ivars->format > PointWriter_current_file_format
+               ) {
+                THROW(ERR, "Unsupported point data format: %i32",
+                      ivars->format);
+            }
+        }
+    }
+
+    ivars->trees  = Hash_new(0);
+    ivars->counts = metadata
+                    ? (Hash*)INCREF(CERTIFY(
+                          Hash_Fetch_Utf8(metadata, "counts", 6), HASH))
+                    : Hash_new(0);
+
+    return self;
+}
+
+void
+DefPointReader_Close_IMP(DefaultPointReader *self) {
+    DefaultPointReaderIVARS *const ivars = DefPointReader_IVARS(self);
+    if (ivars->trees) {
+        DECREF(ivars->trees);
+        ivars->trees = NULL;
+    }
+    if (ivars->counts) {
+        DECREF(ivars->counts);
+        ivars->counts = NULL;
+    }
+}
+
+void
+DefPointReader_Destroy_IMP(DefaultPointReader *self) {
+    DefaultPointReaderIVARS *const ivars = DefPointReader_IVARS(self);
+    DECREF(ivars->trees);
+    DECREF(ivars->counts);
+    SUPER_DESTROY(self, DEFAULTPOINTREADER);
+}
+
+PointTree*
+DefPointReader_Fetch_Tree_IMP(DefaultPointReader *self, String *field) {
+    DefaultPointReaderIVARS *const ivars = DefPointReader_IVARS(self);
+    if (!ivars->trees) { THROW(ERR, "Can't Fetch_Tree after Close"); }
+    PointTree *tree = (PointTree*)Hash_Fetch(ivars->trees, field);
+    if (tree) { return tree; }
+
+    // See if we have any points.
+    Obj *count_obj = Hash_Fetch(ivars->counts, field);
+    int64_t count = count_obj ? Json_obj_to_i64(count_obj) : 0;
+    if (!count) { return NULL; }
+
+    Schema    *schema = DefPointReader_Get_Schema(self);
+    FieldType *type   = Schema_Fetch_Type(schema, field);
+    if (!type || !FType_Indexed(type) || !FType_is_a(type, NUMERICTYPE)) {
+        THROW(ERR, "'%o' isn't an indexed numeric field", field);
+    }
+
+    Folder  *folder    = DefPointReader_Get_Folder(self);
+    Segment *segment   = DefPointReader_Get_Segment(self);
+    int32_t  field_num = Seg_Field_Num(segment, field);
+    tree = PointTree_new(folder, Seg_Get_Name(segment), field_num);
+    Hash_Store(ivars->trees, field, (Obj*)tree);
+    return tree;
+}
+
+/***************************************************************************/
+
+PointTree*
+PointTree_new(Folder *folder, String *seg_name, int32_t field_num) {
+    PointTree *self = (PointTree*)Class_Make_Obj(POINTTREE);
+    return PointTree_init(self, folder, seg_name, field_num);
+}
+
+PointTree*
+PointTree_init(PointTree *self, Folder *folder, String *seg_name,
+               int32_t field_num) {
+    PointTreeIVARS *const ivars = PointTree_IVARS(self);
+    ivars->dat_in  = S_open_in(folder, seg_name, field_num, "dat");
+    ivars->ix_in   = S_open_in(folder, seg_name, field_num, "ix");
+    ivars->keys    = (uint64_t*)MALLOCATE(POINT_LEAF_SIZE * sizeof(uint64_t));
+    ivars->doc_ids = (int32_t*)MALLOCATE(POINT_LEAF_SIZE * sizeof(int32_t));
+
+    // The block index gets binary searched for every query, so keep it
+    // resident.  Leaf blocks are visited in ascending order.
+    int64_t ix_len = InStream_Length(ivars->ix_in);
+    if (ix_len % LEAF_ENTRY_SIZE) {
+        THROW(ERR, "Corrupt point index '%o': length %i64",
+              InStream_Get_Filename(ivars->ix_in), ix_len);
+    }
+    ivars->num_leaves = (uint32_t)(ix_len / LEAF_ENTRY_SIZE);
+    InStream_Advise(ivars->ix_in, FH_ADVICE_WILLNEED);
+    ivars->leaves = (const uint8_t*)InStream_Buf(ivars->ix_in,
+                                                 (size_t)ix_len);
+    InStream_Advise(ivars->dat_in, FH_ADVICE_SEQUENTIAL);
+
+    return self;
+}
+
+static InStream*
+S_open_in(Folder *folder, String *seg_name, int32_t field_num,
+          const char *ext) {
+    String *path = Str_newf("%o/points-%i32.%s", seg_name, field_num, ext);
+    InStream *instream = Folder_Open_In(folder, path);
+    DECREF(path);
+    if (!instream) { RETHROW(INCREF(Err_get_error())); }
+    return instream;
+}
+
+void
+PointTree_Destroy_IMP(PointTree *self) {
+    PointTreeIVARS *const ivars = PointTree_IVARS(self);
+    if (ivars->dat_in) {
+        InStream_Close(ivars->dat_in);
+        DECREF(ivars->dat_in);
+    }
+    if (ivars->ix_in) {
+        InStream_Close(ivars->ix_in);
+        DECREF(ivars->ix_in);
+    }
+    FREEMEM(ivars->keys);
+    FREEMEM(ivars->doc_ids);
+    SUPER_DESTROY(self, POINTTREE);
+}
+
+uint32_t
+PointTree_Num_Leaves_IMP(PointTree *self) {
+    return PointTree_IVARS(self)->num_leaves;
+}
+
+static CFISH_INLINE uint64_t
+SI_leaf_min(PointTreeIVARS *ivars, uint32_t leaf) {
+    return NumUtil_decode_bigend_u64(ivars->leaves + leaf * LEAF_ENTRY_SIZE);
+}
+
+static CFISH_INLINE uint64_t
+SI_leaf_max(PointTreeIVARS *ivars, uint32_t leaf) {
+    return NumUtil_decode_bigend_u64(ivars->leaves + leaf * LEAF_ENTRY_SIZE
+                                     + 8);
+}
+
+static CFISH_INLINE int64_t
+SI_leaf_filepos(PointTreeIVARS *ivars, uint32_t leaf) {
+    return (int64_t)NumUtil_decode_bigend_u64(
+               ivars->leaves + leaf * LEAF_ENTRY_SIZE + 16);
+}
+
+// Decode the doc ids of a leaf block into the doc id buffer, leaving the
+// InStream positioned at its keys.  Return the number of points.
+static uint32_t
+S_read_doc_ids(PointTreeIVARS *ivars, uint32_t leaf) {
+    InStream *const dat_in = ivars->dat_in;
+    InStream_Seek(dat_in, SI_leaf_filepos(ivars, leaf));
+    uint32_t count = InStream_Read_CU32(dat_in);
+    if (count > POINT_LEAF_SIZE) {
+        THROW(ERR, "Corrupt point data in '%o': %u32 points in block",
+              InStream_Get_Filename(dat_in), count);
+    }
+    const char *buf = InStream_Buf(dat_in, count * CU32_MAX_BYTES);
+    for (uint32_t i = 0; i < count; i++) {
+        ivars->doc_ids[i] = (int32_t)NumUtil_decode_cu32(&buf);
+    }
+    InStream_Advance_Buf(dat_in, buf);
+    return count;
+}
+
+uint32_t
+PointTree_Read_Leaf_IMP(PointTree *self, uint32_t leaf, uint64_t **keys,
+                        int32_t **doc_ids) {
+    PointTreeIVARS *const ivars = PointTree_IVARS(self);
+    if (leaf >= ivars->num_leaves) {
+        THROW(ERR, "Leaf %u32 out of range (%u32)", leaf, ivars->num_leaves);
+    }
+    uint32_t count = S_read_doc_ids(ivars, leaf);
+
+    // Keys are stored as deltas from the previous key.
+    InStream *const dat_in = ivars->dat_in;
+    const char *buf = InStream_Buf(dat_in, count * CU64_MAX_BYTES);
+    uint64_t key = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        key += NumUtil_decode_cu64(&buf);
+        ivars->keys[i] = key;
+    }
+    InStream_Advance_Buf(dat_in, buf);
+
+    *keys    = ivars->keys;
+    *doc_ids = ivars->doc_ids;
+    return count;
+}
+
+static int
+S_compare_doc_ids(void *context, const void *va, const void *vb) {
+    int32_t a = *(const int32_t*)va;
+    int32_t b = *(const int32_t*)vb;
+    UNUSED_VAR(context);
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+I32Array*
+PointTree_Range_IMP(PointTree *self, uint64_t lower, uint64_t upper,
+                    int32_t doc_max) {
+    PointTreeIVARS *const ivars = PointTree_IVARS(self);
+    size_t   num_hits = 0;
+    size_t   cap      = POINT_LEAF_SIZE;
+    int32_t *hits     = (int32_t*)MALLOCATE(cap * sizeof(int32_t));
+
+    // Both the lowest and the highest keys of the blocks ascend, so the
+    // first block which might hold a match is the first whose highest key
+    // reaches `lower`.
+    uint32_t lo = 0;
+    uint32_t hi = ivars->num_leaves;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (SI_leaf_max(ivars, mid) < lower) { lo = mid + 1; }
+        else                                 { hi = mid; }
+    }
+
+    for (uint32_t leaf = lo;
+         leaf < ivars->num_leaves && SI_leaf_min(ivars, leaf) <= upper;
+         leaf++
+        ) {
+        if (cap - num_hits < POINT_LEAF_SIZE) {
+            cap = Memory_oversize(num_hits + POINT_LEAF_SIZE,
+                                  sizeof(int32_t));
+            hits = (int32_t*)REALLOCATE(hits, cap * sizeof(int32_t));
+        }
+        if (SI_leaf_min(ivars, leaf) >= lower
+            && SI_leaf_max(ivars, leaf) <= upper
+           ) {
+            // The whole block matches, so there's no need to look at keys.
+            uint32_t count = S_read_doc_ids(ivars, leaf);
+            memcpy(hits + num_hits, ivars->doc_ids, count * sizeof(int32_t));
+            num_hits += count;
+        }
+        else {
+            uint64_t *keys;
+            int32_t  *doc_ids;
+            uint32_t count = PointTree_Read_Leaf(self, leaf, &keys, &doc_ids);
+            for (uint32_t i = 0; i < count; i++) {
+                hits[num_hits] = doc_ids[i];
+                num_hits += keys[i] >= lower && keys[i] <= upper;
+            }
+        }
+    }
+
+    // Put the matches in doc id order.
+    if (num_hits > 1) {
+        if (num_hits > (size_t)doc_max / DENSE_RATIO) {
+            BitVector *bit_vec = BitVec_new((size_t)doc_max + 1);
+            for (size_t i = 0; i < num_hits; i++) {
+                BitVec_Set(bit_vec, (size_t)hits[i]);
+            }
+            size_t num_docs = 0;
+            int32_t doc_id = BitVec_Next_Hit(bit_vec, 0);
+            while (doc_id != -1) {
+                hits[num_docs++] = doc_id;
+                doc_id = BitVec_Next_Hit(bit_vec, (size_t)doc_id + 1);
+            }
+            num_hits = num_docs;
+            DECREF(bit_vec);
+        }
+        else {
+            int32_t *scratch
+                = (int32_t*)MALLOCATE(num_hits * sizeof(int32_t));
+            Sort_mergesort(hits, scratch, (uint32_t)num_hits, sizeof(int32_t),
+                           S_compare_doc_ids, NULL);
+            FREEMEM(scratch);
+        }
+    }
+
+    return I32Arr_new_steal(hits, num_hits);
+}
+
@@ -0,0 +1,520 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_POINTWRITER
+#include "Lucy/Util/ToolSet.h"
+
+#include <math.h>
+
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/Util/SortUtils.h"
+#include "Lucy/Index/PointWriter.h"
+#include "Lucy/Index/PointReader.h"
+#include "Lucy/Index/Inverter.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/Segment.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Index/Snapshot.h"
+#include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/Folder.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+
+int32_t PointWriter_current_file_format = 1;
+
+static uint32_t default_mem_thresh = 0x400000; // 4 MB
+
+typedef struct {
+    uint64_t key;
+    int32_t  doc_id;
+    int32_t  padding;
+} PointRecord;
+
+// A sorted run of one field's points in the temp file.
+typedef struct {
+    int64_t start;
+    int64_t count;
+} PointRun;
+
+// Read cursor over a PointRun, used while merging.
+typedef struct {
+    int64_t      next_pos;
+    int64_t      remaining;
+    PointRecord *buf;
+    size_t       tick;
+    size_t       max;
+} PointRunReader;
+
+static void
+S_add_point(PointWriter *self, int32_t field_num, uint64_t key,
+            int32_t doc_id);
+
+static bool
+S_key_for_value(FieldType *type, Obj *value, uint64_t *key);
+
+static int
+S_compare_records(void *context, const void *va, const void *vb);
+
+static void
+S_flush(PointWriter *self);
+
+static int64_t
+S_write_field(PointWriter *self, int32_t field_num, ByteBuf *pool);
+
+static int64_t
+S_merge_runs(PointWriter *self, int32_t field_num, ByteBuf *run_buf,
+             InStream *temp_in);
+
+static void
+S_write_block(OutStream *dat_out, OutStream *ix_out,
+              const PointRecord *records, size_t count);
+
+static OutStream*
+S_open_out(Folder *folder, String *seg_name, int32_t field_num,
+           const char *ext);
+
+PointWriter*
+PointWriter_new(Schema *schema, Snapshot *snapshot, Segment *segment,
+                PolyReader *polyreader) {
+    PointWriter *self = (PointWriter*)Class_Make_Obj(POINTWRITER);
+    return PointWriter_init(self, schema, snapshot, segment, polyreader);
+}
+
+PointWriter*
+PointWriter_init(PointWriter *self, Schema *schema, Snapshot *snapshot,
+                 Segment *segment, PolyReader *polyreader) {
+    DataWriter_init((DataWriter*)self, schema, snapshot, segment, polyreader);
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    ivars->pools        = Vec_new(Schema_Num_Fields(schema) + 1);
+    ivars->runs         = Vec_new(Schema_Num_Fields(schema) + 1);
+    ivars->counts       = Hash_new(0);
+    ivars->temp_out     = NULL;
+    ivars->mem_consumed = 0;
+    ivars->mem_thresh   = default_mem_thresh;
+    return self;
+}
+
+void
+PointWriter_Destroy_IMP(PointWriter *self) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    DECREF(ivars->pools);
+    DECREF(ivars->runs);
+    DECREF(ivars->counts);
+    DECREF(ivars->temp_out);
+    SUPER_DESTROY(self, POINTWRITER);
+}
+
+void
+PointWriter_set_default_mem_thresh(uint32_t mem_thresh) {
+    default_mem_thresh = mem_thresh;
+}
+
+static void
+S_add_point(PointWriter *self, int32_t field_num, uint64_t key,
+            int32_t doc_id) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    ByteBuf *pool = (ByteBuf*)Vec_Fetch(ivars->pools, (size_t)field_num);
+    if (!pool) {
+        pool = BB_new(POINT_LEAF_SIZE * sizeof(PointRecord));
+        Vec_Store(ivars->pools, (size_t)field_num, (Obj*)pool);
+    }
+    PointRecord record;
+    record.key     = key;
+    record.doc_id  = doc_id;
+    record.padding = 0;
+    BB_Cat_Bytes(pool, &record, sizeof(PointRecord));
+
+    ivars->mem_consumed += sizeof(PointRecord);
+    if (ivars->mem_consumed >= ivars->mem_thresh) {
+        S_flush(self);
+    }
+}
+
+// Sort the points buffered for each field and append them to the temp file
+// as one run per field.
+static void
+S_flush(PointWriter *self) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    Vector *const pools = ivars->pools;
+
+    if (!ivars->temp_out) {
+        String *path = Str_newf("%o/point_temp",
+                                Seg_Get_Name(ivars->segment));
+        ivars->temp_out = Folder_Open_Out(ivars->folder, path);
+        DECREF(path);
+        if (!ivars->temp_out) { RETHROW(INCREF(Err_get_error())); }
+    }
+
+    for (size_t i = 1, max = Vec_Get_Size(pools); i < max; i++) {
+        ByteBuf *pool = (ByteBuf*)Vec_Fetch(pools, i);
+        if (!pool || !BB_Get_Size(pool)) { continue; }
+
+        PointRecord *records = (PointRecord*)BB_Get_Buf(pool);
+        size_t       size    = BB_Get_Size(pool);
+        size_t       count   = size / sizeof(PointRecord);
+        PointRecord *scratch = (PointRecord*)MALLOCATE(size);
+        Sort_mergesort(records, scratch, (uint32_t)count, sizeof(PointRecord),
+                       S_compare_records, NULL);
+        FREEMEM(scratch);
+
+        // The temp file is only ever read back by this process, so the
+        // records can be written out as they sit in memory.
+        PointRun run;
+        run.start = OutStream_Tell(ivars->temp_out);
+        run.count = (int64_t)count;
+        OutStream_Write_Bytes(ivars->temp_out, records, size);
+
+        ByteBuf *run_buf = (ByteBuf*)Vec_Fetch(ivars->runs, i);
+        if (!run_buf) {
+            run_buf = BB_new(sizeof(PointRun));
+            Vec_Store(ivars->runs, i, (Obj*)run_buf);
+        }
+        BB_Cat_Bytes(run_buf, &run, sizeof(PointRun));
+        BB_Set_Size(pool, 0);
+    }
+
+    ivars->mem_consumed = 0;
+}
+
+// Derive the key for a value, returning false if the value can't be placed
+// in the point index (i.e. NaN).
+static bool
+S_key_for_value(FieldType *type, Obj *value, uint64_t *key) {
+    switch (FType_Primitive_ID(type) & FType_PRIMITIVE_ID_MASK) {
+        case FType_INT32:
+        case FType_INT64:
+            *key = PointReader_key_i64(Int_Get_Value((Integer*)value));
+            return true;
+        case FType_FLOAT32: {
+                // Round the same way the value is stored.
+                float f = (float)Float_Get_Value((Float*)value);
+                if (isnan(f)) { return false; }
+                *key = PointReader_key_f64((double)f);
+                return true;
+            }
+        case FType_FLOAT64: {
+                double d = Float_Get_Value((Float*)value);
+                if (isnan(d)) { return false; }
+                *key = PointReader_key_f64(d);
+                return true;
+            }
+        default:
+            THROW(ERR, "Unexpected primitive id: %i32",
+                  (int32_t)FType_Primitive_ID(type));
+            UNREACHABLE_RETURN(bool);
+    }
+}
+
+void
+PointWriter_Add_Inverted_Doc_IMP(PointWriter *self, Inverter *inverter,
+                                 int32_t doc_id) {
+    int32_t field_num;
+
+    Inverter_Iterate(inverter);
+    while (0 != (field_num = Inverter_Next(inverter))) {
+        FieldType *type = Inverter_Get_Type(inverter);
+        if (FType_Indexed(type) && FType_is_a(type, NUMERICTYPE)) {
+            Obj *value = Inverter_Get_Value(inverter);
+            uint64_t key;
+            if (value && S_key_for_value(type, value, &key)) {
+                S_add_point(self, field_num, key, doc_id);
+            }
+        }
+    }
+}
+
+void
+PointWriter_Add_Segment_IMP(PointWriter *self, SegReader *reader,
+                            I32Array *doc_map) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    PointReader *point_reader = (PointReader*)SegReader_Fetch(
+                                    reader, Class_Get_Name(POINTREADER));
+    if (!point_reader) { return; }
+
+    // The keys are already derived, so points can be copied over block by
+    // block, translating the doc ids.
+    Vector *fields = Schema_All_Fields(ivars->schema);
+    for (size_t i = 0, max = Vec_Get_Size(fields); i < max; i++) {
+        String    *field = (String*)Vec_Fetch(fields, i);
+        FieldType *type  = Schema_Fetch_Type(ivars->schema, field);
+        if (!FType_Indexed(type) || !FType_is_a(type, NUMERICTYPE)) {
+            continue;
+        }
+        PointTree *tree = PointReader_Fetch_Tree(point_reader, field);
+        if (!tree) { continue; }
+
+        int32_t  field_num  = Seg_Field_Num(ivars->segment, field);
+        uint32_t num_leaves = PointTree_Num_Leaves(tree);
+        for (uint32_t leaf = 0; leaf < num_leaves; leaf++) {
+            uint64_t *keys;
+            int32_t  *doc_ids;
+            uint32_t count = PointTree_Read_Leaf(tree, leaf, &keys, &doc_ids);
+            for (uint32_t j = 0; j < count; j++) {
+                int32_t new_id = doc_map
+                                 ? I32Arr_Get(doc_map, (size_t)doc_ids[j])
+                                 : doc_ids[j];
+                if (!new_id) { continue; } // Skip deleted docs.
+                S_add_point(self, field_num, keys[j], new_id);
+            }
+        }
+    }
+    DECREF(fields);
+}
+
+static int
+S_compare_records(void *context, const void *va, const void *vb) {
+    const PointRecord *a = (const PointRecord*)va;
+    const PointRecord *b = (const PointRecord*)vb;
+    UNUSED_VAR(context);
+    if (a->key != b->key) { return a->key < b->key ? -1 : 1; }
+    return a->doc_id < b->doc_id ? -1 : a->doc_id > b->doc_id ? 1 : 0;
+}
+
+static int64_t
+S_write_field(PointWriter *self, int32_t field_num, ByteBuf *pool) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    String      *seg_name = Seg_Get_Name(ivars->segment);
+    PointRecord *records  = (PointRecord*)BB_Get_Buf(pool);
+    size_t       count    = BB_Get_Size(pool) / sizeof(PointRecord);
+    if (count > UINT32_MAX) {
+        THROW(ERR, "Too many points for field %i32: %u64", field_num,
+              (uint64_t)count);
+    }
+
+    PointRecord *scratch
+        = (PointRecord*)MALLOCATE(count * sizeof(PointRecord));
+    Sort_mergesort(records, scratch, (uint32_t)count, sizeof(PointRecord),
+                   S_compare_records, NULL);
+    FREEMEM(scratch);
+
+    OutStream *dat_out = S_open_out(ivars->folder, seg_name, field_num,
+                                    "dat");
+    OutStream *ix_out  = S_open_out(ivars->folder, seg_name, field_num, "ix");
+    for (size_t start = 0; start < count; start += POINT_LEAF_SIZE) {
+        size_t end = start + POINT_LEAF_SIZE < count
+                     ? start + POINT_LEAF_SIZE
+                     : count;
+        S_write_block(dat_out, ix_out, records + start, end - start);
+    }
+    OutStream_Close(dat_out);
+    OutStream_Close(ix_out);
+    DECREF(dat_out);
+    DECREF(ix_out);
+
+    return (int64_t)count;
+}
+
+static void
+S_refill_run(PointRunReader *reader, InStream *temp_in, size_t cap) {
+    size_t num = reader->remaining < (int64_t)cap
+                 ? (size_t)reader->remaining
+                 : cap;
+    InStream_Seek(temp_in, reader->next_pos);
+    InStream_Read_Bytes(temp_in, (char*)reader->buf,
+                        num * sizeof(PointRecord));
+    reader->next_pos  += (int64_t)(num * sizeof(PointRecord));
+    reader->remaining -= (int64_t)num;
+    reader->tick       = 0;
+    reader->max        = num;
+}
+
+// Merge the sorted runs of a spilled field, reading each run through a
+// buffer so that the merge as a whole stays within mem_thresh.
+static int64_t
+S_merge_runs(PointWriter *self, int32_t field_num, ByteBuf *run_buf,
+             InStream *temp_in) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    String   *seg_name = Seg_Get_Name(ivars->segment);
+    PointRun *runs     = (PointRun*)BB_Get_Buf(run_buf);
+    size_t    num_runs = BB_Get_Size(run_buf) / sizeof(PointRun);
+
+    int64_t count = 0;
+    for (size_t i = 0; i < num_runs; i++) {
+        count += runs[i].count;
+    }
+    if (count > UINT32_MAX) {
+        THROW(ERR, "Too many points for field %i32: %i64", field_num, count);
+    }
+
+    size_t cap = ivars->mem_thresh / sizeof(PointRecord) / num_runs;
+    if (cap < POINT_LEAF_SIZE) { cap = POINT_LEAF_SIZE; }
+    PointRunReader *readers
+        = (PointRunReader*)MALLOCATE(num_runs * sizeof(PointRunReader));
+    for (size_t i = 0; i < num_runs; i++) {
+        readers[i].next_pos  = runs[i].start;
+        readers[i].remaining = runs[i].count;
+        readers[i].buf = (PointRecord*)MALLOCATE(cap * sizeof(PointRecord));
+        readers[i].tick      = 0;
+        readers[i].max       = 0;
+    }
+    PointRecord *leaf
+        = (PointRecord*)MALLOCATE(POINT_LEAF_SIZE * sizeof(PointRecord));
+    size_t num_in_leaf = 0;
+
+    OutStream *dat_out = S_open_out(ivars->folder, seg_name, field_num,
+                                    "dat");
+    OutStream *ix_out  = S_open_out(ivars->folder, seg_name, field_num, "ix");
+    while (true) {
+        PointRunReader *best = NULL;
+        for (size_t i = 0; i < num_runs; i++) {
+            PointRunReader *reader = &readers[i];
+            if (reader->tick == reader->max) {
+                if (!reader->remaining) { continue; }
+                S_refill_run(reader, temp_in, cap);
+            }
+            if (!best
+                || S_compare_records(NULL, &reader->buf[reader->tick],
+                                     &best->buf[best->tick]) < 0
+               ) {
+                best = reader;
+            }
+        }
+        if (!best) { break; }
+
+        leaf[num_in_leaf++] = best->buf[best->tick++];
+        if (num_in_leaf == POINT_LEAF_SIZE) {
+            S_write_block(dat_out, ix_out, leaf, num_in_leaf);
+            num_in_leaf = 0;
+        }
+    }
+    if (num_in_leaf) {
+        S_write_block(dat_out, ix_out, leaf, num_in_leaf);
+    }
+    OutStream_Close(dat_out);
+    OutStream_Close(ix_out);
+    DECREF(dat_out);
+    DECREF(ix_out);
+
+    for (size_t i = 0; i < num_runs; i++) {
+        FREEMEM(readers[i].buf);
+    }
+    FREEMEM(readers);
+    FREEMEM(leaf);
+
+    return count;
+}
+
+static void
+S_write_block(OutStream *dat_out, OutStream *ix_out,
+              const PointRecord *records, size_t count) {
+    OutStream_Write_U64(ix_out, records[0].key);
+    OutStream_Write_U64(ix_out, records[count - 1].key);
+    OutStream_Write_U64(ix_out, (uint64_t)OutStream_Tell(dat_out));
+
+    // Doc ids come before the keys, so that blocks which lie entirely
+    // within a range can be read without decoding the keys.
+    OutStream_Write_CU32(dat_out, (uint32_t)count);
+    for (size_t i = 0; i < count; i++) {
+        OutStream_Write_CU32(dat_out, (uint32_t)records[i].doc_id);
+    }
+    uint64_t last_key = 0;
+    for (size_t i = 0; i < count; i++) {
+        OutStream_Write_CU64(dat_out, records[i].key - last_key);
+        last_key = records[i].key;
+    }
+}
+
+static OutStream*
+S_open_out(Folder *folder, String *seg_name, int32_t field_num,
+           const char *ext) {
+    String *path = Str_newf("%o/points-%i32.%s", seg_name, field_num, ext);
+    OutStream *outstream = Folder_Open_Out(folder, path);
+    DECREF(path);
+    if (!outstream) { RETHROW(INCREF(Err_get_error())); }
+    return outstream;
+}
+
+void
+PointWriter_Finish_IMP(PointWriter *self) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    Vector *const pools = ivars->pools;
+    bool wrote = false;
+
+    if (ivars->temp_out) {
+        // Once anything has been spilled, spill the rest too and merge.
+        S_flush(self);
+        OutStream_Close(ivars->temp_out);
+        String *path = Str_newf("%o/point_temp",
+                                Seg_Get_Name(ivars->segment));
+        InStream *temp_in = Folder_Open_In(ivars->folder, path);
+        if (!temp_in) {
+            DECREF(path);
+            RETHROW(INCREF(Err_get_error()));
+        }
+
+        Vector *const runs = ivars->runs;
+        for (size_t i = 1, max = Vec_Get_Size(runs); i < max; i++) {
+            ByteBuf *run_buf = (ByteBuf*)Vec_Fetch(runs, i);
+            if (run_buf && BB_Get_Size(run_buf)) {
+                String *field = Seg_Field_Name(ivars->segment, (int32_t)i);
+                int64_t count
+                    = S_merge_runs(self, (int32_t)i, run_buf, temp_in);
+                Hash_Store(ivars->counts, field,
+                           (Obj*)Str_newf("%i64", count));
+                wrote = true;
+            }
+        }
+        Vec_Clear(runs);
+
+        InStream_Close(temp_in);
+        DECREF(temp_in);
+        Folder_Delete(ivars->folder, path);
+        DECREF(path);
+        DECREF(ivars->temp_out);
+        ivars->temp_out = NULL;
+    }
+    else {
+        for (size_t i = 1, max = Vec_Get_Size(pools); i < max; i++) {
+            ByteBuf *pool = (ByteBuf*)Vec_Fetch(pools, i);
+            if (pool && BB_Get_Size(pool)) {
+                String *field = Seg_Field_Name(ivars->segment, (int32_t)i);
+                int64_t count = S_write_field(self, (int32_t)i, pool);
+                Hash_Store(ivars->counts, field,
+                           (Obj*)Str_newf("%i64", count));
+                wrote = true;
+            }
+        }
+    }
+    Vec_Clear(pools);
+    ivars->mem_consumed = 0;
+
+    // Only store metadata if at least one field was written.
+    if (wrote) {
+        Seg_Store_Metadata_Utf8(ivars->segment, "points", 6,
+                                (Obj*)PointWriter_Metadata(self));
+    }
+}
+
+Hash*
+PointWriter_Metadata_IMP(PointWriter *self) {
+    PointWriterIVARS *const ivars = PointWriter_IVARS(self);
+    PointWriter_Metadata_t super_meta
+        = (PointWriter_Metadata_t)SUPER_METHOD_PTR(POINTWRITER,
+                                                   LUCY_PointWriter_Metadata);
+    Hash *const metadata = super_meta(self);
+    Hash_Store_Utf8(metadata, "counts", 6, INCREF(ivars->counts));
+    return metadata;
+}
+
+int32_t
+PointWriter_Format_IMP(PointWriter *self) {
+    UNUSED_VAR(self);
+    return PointWriter_current_file_format;
+}
+
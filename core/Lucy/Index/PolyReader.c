@@ -48,6 +48,7 @@ S_release_deletion_lock(PolyReader *self);
 // Try to open all SegReaders.
 struct try_open_elements_context {
     PolyReader *self;
+    PolyReader *prior;
     Vector     *seg_readers;
 };
 void
@@ -64,12 +65,13 @@ S_try_read_snapshot(void *context);
 
 // Try to open an individual SegReader.
 struct try_open_segreader_context {
-    Schema    *schema;
-    Folder    *folder;
-    Snapshot  *snapshot;
-    Vector    *segments;
-    int32_t    seg_tick;
-    SegReader *result;
+    PolyReader *prior;
+    Schema     *schema;
+    Folder     *folder;
+    Snapshot   *snapshot;
+    Vector     *segments;
+    int32_t     seg_tick;
+    SegReader  *result;
 };
 static void
 S_try_open_segreader(void *context);
@@ -77,6 +79,17 @@ S_try_open_segreader(void *context);
 static Folder*
 S_derive_folder(Obj *index);
 
+// Open the index, reusing the SegReaders of `prior` where possible.
+static PolyReader*
+S_do_open(PolyReader *self, Obj *index, Snapshot *snapshot,
+          IndexManager *manager, PolyReader *prior);
+
+// Return a SegReader from `prior` for the segment at `seg_tick`, or NULL if
+// there isn't one which can be reused.
+static SegReader*
+S_reuse_seg_reader(PolyReader *prior, Schema *schema, Snapshot *snapshot,
+                   Vector *segments, int32_t seg_tick);
+
 PolyReader*
 PolyReader_new(Schema *schema, Folder *folder, Snapshot *snapshot,
                IndexManager *manager, Vector *sub_readers) {
@@ -191,9 +204,12 @@ PolyReader_Close_IMP(PolyReader *self) {
     PolyReaderIVARS *const ivars = PolyReader_IVARS(self);
     PolyReader_Close_t super_close
         = SUPER_METHOD_PTR(POLYREADER, LUCY_PolyReader_Close);
+    // The SegReaders own the per-segment components, which the aggregate
+    // readers closed by super_close() only borrow.  Either may be shared
+    // with a reader created by Reopen().
     for (size_t i = 0, max = Vec_Get_Size(ivars->sub_readers); i < max; i++) {
         SegReader *seg_reader = (SegReader*)Vec_Fetch(ivars->sub_readers, i);
-        SegReader_Close(seg_reader);
+        SegReader_Close_Shared(seg_reader);
     }
     super_close(self);
 }
@@ -217,8 +233,16 @@ static void
 S_try_open_segreader(void *context) {
     struct try_open_segreader_context *args
         = (struct try_open_segreader_context*)context;
-    args->result = SegReader_new(args->schema, args->folder, args->snapshot,
-                                 args->segments, args->seg_tick);
+    args->result = args->prior
+                   ? S_reuse_seg_reader(args->prior, args->schema,
+                                        args->snapshot, args->segments,
+                                        args->seg_tick)
+                   : NULL;
+    if (!args->result) {
+        args->result = SegReader_new(args->schema, args->folder,
+                                     args->snapshot, args->segments,
+                                     args->seg_tick);
+    }
 }
 
 void
@@ -260,7 +284,26 @@ S_try_open_elements(void *context) {
         Obj *dump = Json_slurp_json(folder, schema_file);
         if (dump) { // read file successfully
             DECREF(ivars->schema);
-            ivars->schema = (Schema*)CERTIFY(Freezer_load(dump), SCHEMA);
+            ivars->schema = NULL;
+            if (args->prior) {
+                // If the Schema hasn't changed, keep using the prior
+                // reader's, which its SegReaders were opened with.
+                // Round-trip its dump through JSON so that the two compare
+                // on equal terms.
+                Schema *prior_schema = PolyReader_Get_Schema(args->prior);
+                Hash   *prior_dump   = Schema_Dump(prior_schema);
+                String *json         = Json_to_json((Obj*)prior_dump);
+                Obj    *normalized   = json ? Json_from_json(json) : NULL;
+                if (normalized && Obj_Equals(normalized, dump)) {
+                    ivars->schema = (Schema*)INCREF(prior_schema);
+                }
+                DECREF(normalized);
+                DECREF(json);
+                DECREF(prior_dump);
+            }
+            if (!ivars->schema) {
+                ivars->schema = (Schema*)CERTIFY(Freezer_load(dump), SCHEMA);
+            }
             DECREF(dump);
             schema_file = NULL;
         }
@@ -301,6 +344,7 @@ S_try_open_elements(void *context) {
 
     // Open individual SegReaders.
     struct try_open_segreader_context seg_context;
+    seg_context.prior    = args->prior;
     seg_context.schema   = PolyReader_Get_Schema(self);
     seg_context.folder   = folder;
     seg_context.snapshot = PolyReader_Get_Snapshot(self);
@@ -321,6 +365,14 @@ S_try_open_elements(void *context) {
     DECREF(segments);
     DECREF(files);
     if (error) {
+        // Give back any SegReaders borrowed from the prior reader.
+        for (size_t i = 0, max = Vec_Get_Size(args->seg_readers);
+             i < max; i++
+            ) {
+            SegReader *seg_reader
+                = (SegReader*)Vec_Fetch(args->seg_readers, i);
+            SegReader_Close_Shared(seg_reader);
+        }
         DECREF(args->seg_readers);
         args->seg_readers = NULL;
         RETHROW(error);
@@ -334,6 +386,20 @@ int32_t  PolyReader_debug1_num_passes     = 0;
 PolyReader*
 PolyReader_do_open(PolyReader *self, Obj *index, Snapshot *snapshot,
                    IndexManager *manager) {
+    return S_do_open(self, index, snapshot, manager, NULL);
+}
+
+PolyReader*
+PolyReader_Reopen_IMP(PolyReader *self, Snapshot *snapshot) {
+    PolyReaderIVARS *const ivars = PolyReader_IVARS(self);
+    PolyReader *reopened = (PolyReader*)Class_Make_Obj(POLYREADER);
+    return S_do_open(reopened, (Obj*)ivars->folder, snapshot, ivars->manager,
+                     self);
+}
+
+static PolyReader*
+S_do_open(PolyReader *self, Obj *index, Snapshot *snapshot,
+          IndexManager *manager, PolyReader *prior) {
     PolyReaderIVARS *const ivars = PolyReader_IVARS(self);
     Folder   *folder   = S_derive_folder(index);
     uint64_t  last_gen = 0;
@@ -425,6 +491,7 @@ PolyReader_do_open(PolyReader *self, Obj *index, Snapshot *snapshot,
          * not, we have a real exception, so throw an error. */
         struct try_open_elements_context context;
         context.self        = self;
+        context.prior       = prior;
         context.seg_readers = NULL;
         Err *error = Err_trap(S_try_open_elements, &context);
         if (error) {
@@ -452,6 +519,42 @@ PolyReader_do_open(PolyReader *self, Obj *index, Snapshot *snapshot,
     return self;
 }
 
+static SegReader*
+S_reuse_seg_reader(PolyReader *prior, Schema *schema, Snapshot *snapshot,
+                   Vector *segments, int32_t seg_tick) {
+    PolyReaderIVARS *const prior_ivars = PolyReader_IVARS(prior);
+    Segment *segment  = (Segment*)Vec_Fetch(segments, (size_t)seg_tick);
+    String  *seg_name = Seg_Get_Name(segment);
+
+    // SegReaders opened against a different Schema can't be shared.
+    if (PolyReader_Get_Schema(prior) != schema) { return NULL; }
+
+    for (size_t i = 0, max = Vec_Get_Size(prior_ivars->sub_readers);
+         i < max; i++
+        ) {
+        SegReader *seg_reader
+            = (SegReader*)Vec_Fetch(prior_ivars->sub_readers, i);
+        if (!Str_Equals(SegReader_Get_Seg_Name(seg_reader), (Obj*)seg_name)) {
+            continue;
+        }
+
+        // Segments are never modified once committed, but their deletions
+        // may have been superseded by a newer deletions file.
+        Hash *old_dels = DefDelReader_find_deletions(
+                             SegReader_Get_Segments(seg_reader), seg_name);
+        Hash *new_dels = DefDelReader_find_deletions(segments, seg_name);
+        if (old_dels == new_dels
+            || (old_dels && new_dels && Hash_Equals(old_dels, (Obj*)new_dels))
+           ) {
+            SegReader_Share(seg_reader);
+            return (SegReader*)INCREF(seg_reader);
+        }
+        return SegReader_Reopen(seg_reader, snapshot, segments, seg_tick);
+    }
+
+    return NULL;
+}
+
 static Folder*
 S_derive_folder(Obj *index) {
     Folder *folder = NULL;
@@ -16,6 +16,7 @@
 
 #define C_LUCY_POSTING
 #define C_LUCY_POSTINGWRITER
+#define C_LUCY_RAWPOSTING
 #include "Lucy/Util/ToolSet.h"
 
 #include "Lucy/Index/Posting.h"
@@ -45,6 +46,18 @@ Post_Get_Doc_ID_IMP(Posting *self) {
     return Post_IVARS(self)->doc_id;
 }
 
+RawPosting*
+Post_Read_Temp_Raw_IMP(Posting *self, InStream *instream, int32_t last_doc_id,
+                       String *term_text, MemoryPool *mem_pool) {
+    return Post_Read_Raw(self, instream, last_doc_id, term_text, mem_pool);
+}
+
+float
+Post_Impact_IMP(Posting *self, RawPosting *raw_posting) {
+    UNUSED_VAR(self);
+    return (float)RawPost_IVARS(raw_posting)->freq;
+}
+
 PostingWriter*
 PostWriter_init(PostingWriter *self, Schema *schema, Snapshot *snapshot,
                 Segment *segment, PolyReader *polyreader, int32_t field_num) {
@@ -0,0 +1,462 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_BLOCKPOSTING
+#define C_LUCY_BLOCKPOSTINGWRITER
+#define C_LUCY_RAWPOSTING
+#define C_LUCY_TERMINFO
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Index/Posting/BlockPosting.h"
+#include "Clownfish/ByteBuf.h"
+#include "Lucy/Index/Posting/RawPosting.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/Segment.h"
+#include "Lucy/Index/Similarity.h"
+#include "Lucy/Index/Snapshot.h"
+#include "Lucy/Index/TermInfo.h"
+#include "Lucy/Plan/Architecture.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/Folder.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/MemoryPool.h"
+#include "Lucy/Util/NumberUtils.h"
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+#define FIELD_BOOST_LEN  1
+#define MAX_RAW_POSTING_LEN(_raw_post_size, _text_len, _freq) \
+    (              _raw_post_size \
+                   + _text_len                /* term text content */ \
+                   + FIELD_BOOST_LEN          /* field boost byte */ \
+                   + (CU32_MAX_BYTES * _freq)  /* positions deltas */ \
+    )
+
+// Decode the next block header and its packed doc ids, freqs and norms.  If
+// `skip_prox` is true, leave `instream` at the start of the next block and
+// note where the positions begin; otherwise leave it at the positions.
+static void
+S_read_block(BlockPostingIVARS *ivars, InStream *instream, int32_t base,
+             bool skip_prox);
+
+// Skip over `count` compressed integers.
+static void
+S_skip_cu32s(InStream *instream, uint32_t count);
+
+// Read one bit-packed array of `count` integers from `instream`.
+static void
+S_read_packed(InStream *instream, uint32_t *dest, uint32_t count);
+
+// Turn an array of doc deltas into absolute doc ids in place.
+static void
+S_prefix_sum(uint32_t *values, uint32_t count, uint32_t base);
+
+// Write out pending postings as a block.
+static void
+S_flush_block(BlockPostingWriter *self);
+
+// Bit-pack `count` integers and write them to `outstream`.
+static void
+S_write_packed(OutStream *outstream, const uint32_t *values, uint32_t count,
+               uint8_t *scratch);
+
+BlockPosting*
+BlockPost_new(Similarity *sim) {
+    BlockPosting *self = (BlockPosting*)Class_Make_Obj(BLOCKPOSTING);
+    return BlockPost_init(self, sim);
+}
+
+BlockPosting*
+BlockPost_init(BlockPosting *self, Similarity *sim) {
+    ScorePost_init((ScorePosting*)self, sim);
+    BlockPostingIVARS *const ivars = BlockPost_IVARS(self);
+    ivars->doc_ids    = NULL;
+    ivars->freqs      = NULL;
+    ivars->norms      = NULL;
+    ivars->block_cap  = 0;
+    ivars->block_max  = 0;
+    ivars->block_tick = 0;
+    ivars->prox_in      = NULL;
+    ivars->prox_filepos = 0;
+    ivars->prox_tick    = 0;
+    return self;
+}
+
+void
+BlockPost_Destroy_IMP(BlockPosting *self) {
+    BlockPostingIVARS *const ivars = BlockPost_IVARS(self);
+    FREEMEM(ivars->doc_ids);
+    FREEMEM(ivars->freqs);
+    FREEMEM(ivars->norms);
+    DECREF(ivars->prox_in);
+    SUPER_DESTROY(self, BLOCKPOSTING);
+}
+
+void
+BlockPost_Reset_IMP(BlockPosting *self) {
+    BlockPostingIVARS *const ivars = BlockPost_IVARS(self);
+    BlockPost_Reset_t super_reset
+        = SUPER_METHOD_PTR(BLOCKPOSTING, LUCY_BlockPost_Reset);
+    super_reset(self);
+
+    // Discard whatever remains of the current block.
+    ivars->block_max  = 0;
+    ivars->block_tick = 0;
+    ivars->prox_tick  = 0;
+}
+
+static void
+S_read_block(BlockPostingIVARS *ivars, InStream *instream, int32_t base,
+             bool skip_prox) {
+    const uint32_t count = InStream_Read_CU32(instream);
+    if (count > ivars->block_cap) {
+        ivars->doc_ids = (uint32_t*)REALLOCATE(ivars->doc_ids,
+                                               count * sizeof(uint32_t));
+        ivars->freqs   = (uint32_t*)REALLOCATE(ivars->freqs,
+                                               count * sizeof(uint32_t));
+        ivars->norms   = (uint8_t*)REALLOCATE(ivars->norms, count);
+        ivars->block_cap = count;
+    }
+
+    // Doc deltas, then freqs (stored minus one), then boost bytes.
+    S_read_packed(instream, ivars->doc_ids, count);
+    S_prefix_sum(ivars->doc_ids, count, (uint32_t)base);
+    S_read_packed(instream, ivars->freqs, count);
+    for (uint32_t i = 0; i < count; i++) {
+        ivars->freqs[i] += 1;
+    }
+    InStream_Read_Bytes(instream, (char*)ivars->norms, count);
+
+    // The positions follow.  Either step over them, leaving them to the
+    // position stream, or stay put so that they're read inline.
+    const uint32_t prox_len = InStream_Read_CU32(instream);
+    if (skip_prox) {
+        if (!ivars->prox_in) { ivars->prox_in = InStream_Clone(instream); }
+        ivars->prox_filepos = InStream_Tell(instream);
+        InStream_Seek(instream, ivars->prox_filepos + prox_len);
+    }
+
+    ivars->block_max  = count;
+    ivars->block_tick = 0;
+    ivars->prox_tick  = 0;
+}
+
+static void
+S_skip_cu32s(InStream *instream, uint32_t count) {
+    // Each compressed integer ends with the only one of its bytes whose
+    // high bit is clear, so only those need counting.  Work through the
+    // data in bounded chunks to keep buffer requests modest.
+    while (count) {
+        uint32_t chunk = count < 1024 ? count : 1024;
+        count -= chunk;
+        const char *buf = InStream_Buf(instream, chunk * CU32_MAX_BYTES);
+#if defined(__SSE2__)
+        // While at least 16 integers remain, none of the next 16 bytes can
+        // belong to anything beyond them, so take the bytes 16 at a time.
+        while (chunk >= 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)buf);
+            int continued = _mm_movemask_epi8(bytes);
+            uint32_t ends = 16;
+            while (continued) {
+                continued &= continued - 1;
+                ends--;
+            }
+            chunk -= ends;
+            buf   += 16;
+        }
+#endif
+        while (chunk) {
+            if (!(*(const uint8_t*)buf & 0x80)) { chunk--; }
+            buf++;
+        }
+        InStream_Advance_Buf(instream, buf);
+    }
+}
+
+static void
+S_read_packed(InStream *instream, uint32_t *dest, uint32_t count) {
+    const uint32_t width = InStream_Read_U8(instream);
+    if (width > 32) {
+        THROW(ERR, "Invalid bit width in '%o': %u32",
+              InStream_Get_Filename(instream), width);
+    }
+    const size_t num_bytes = ((size_t)count * width + 7) / 8;
+    const char *buf = InStream_Buf(instream, num_bytes);
+    buf += NumUtil_unpack_bits(buf, count, width, dest);
+    InStream_Advance_Buf(instream, buf);
+}
+
+static void
+S_prefix_sum(uint32_t *values, uint32_t count, uint32_t base) {
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    // Four lanes at a time: two shifted adds produce the running sum within
+    // the register, then the carry from the previous group is added and the
+    // highest lane is broadcast to become the next carry.
+    __m128i carry = _mm_set1_epi32((int)base);
+    for (; i + 4 <= count; i += 4) {
+        __m128i sums = _mm_loadu_si128((const __m128i*)(values + i));
+        sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 4));
+        sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 8));
+        sums = _mm_add_epi32(sums, carry);
+        _mm_storeu_si128((__m128i*)(values + i), sums);
+        carry = _mm_shuffle_epi32(sums, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    if (i > 0) { base = values[i - 1]; }
+#endif
+    for (; i < count; i++) {
+        base += values[i];
+        values[i] = base;
+    }
+}
+
+void
+BlockPost_Read_Record_IMP(BlockPosting *self, InStream *instream) {
+    BlockPostingIVARS *const ivars = BlockPost_IVARS(self);
+
+    if (ivars->block_tick >= ivars->block_max) {
+        S_read_block(ivars, instream, ivars->doc_id, true);
+    }
+
+    // Serve doc id, freq and boost from the decoded block.  Positions wait
+    // for Get_Prox().
+    const uint32_t tick = ivars->block_tick++;
+    ivars->doc_id = (int32_t)ivars->doc_ids[tick];
+    ivars->freq   = ivars->freqs[tick];
+    ivars->weight = ivars->norm_decoder[ivars->norms[tick]];
+}
+
+uint32_t*
+BlockPost_Get_Prox_IMP(BlockPosting *self) {
+    BlockPostingIVARS *const ivars = BlockPost_IVARS(self);
+    if (!ivars->block_tick) { return NULL; }
+    const uint32_t doc_tick = ivars->block_tick - 1;
+    if (ivars->prox_tick > doc_tick) {
+        // Already decoded.
+        return ivars->prox;
+    }
+
+    // Skip the positions of the docs passed over since the last decode.
+    InStream *const prox_in = ivars->prox_in;
+    InStream_Seek(prox_in, ivars->prox_filepos);
+    uint32_t num_skipped = 0;
+    for (uint32_t i = ivars->prox_tick; i < doc_tick; i++) {
+        num_skipped += ivars->freqs[i];
+    }
+    if (num_skipped) { S_skip_cu32s(prox_in, num_skipped); }
+
+    // Decode the current doc's positions.
+    uint32_t num_prox = ivars->freq;
+    if (num_prox > ivars->prox_cap) {
+        ivars->prox = (uint32_t*)REALLOCATE(
+                         ivars->prox, num_prox * sizeof(uint32_t));
+        ivars->prox_cap = num_prox;
+    }
+    uint32_t *positions = ivars->prox;
+    uint32_t  position  = 0;
+    const char *buf = InStream_Buf(prox_in, num_prox * CU32_MAX_BYTES);
+    while (num_prox--) {
+        position += NumUtil_decode_cu32(&buf);
+        *positions++ = position;
+    }
+    InStream_Advance_Buf(prox_in, buf);
+
+    ivars->prox_filepos = InStream_Tell(prox_in);
+    ivars->prox_tick    = doc_tick + 1;
+    return ivars->prox;
+}
+
+RawPosting*
+BlockPost_Read_Raw_IMP(BlockPosting *self, InStream *instream,
+                       int32_t last_doc_id, String *term_text,
+                       MemoryPool *mem_pool) {
+    BlockPostingIVARS *const ivars = BlockPost_IVARS(self);
+    const char *const text_buf  = Str_Get_Ptr8(term_text);
+    const size_t      text_size = Str_Get_Size(term_text);
+
+    if (ivars->block_tick >= ivars->block_max) {
+        S_read_block(ivars, instream, last_doc_id, false);
+    }
+
+    const uint32_t tick   = ivars->block_tick++;
+    const int32_t  doc_id = (int32_t)ivars->doc_ids[tick];
+    const uint32_t freq   = ivars->freqs[tick];
+    const size_t base_size = Class_Get_Obj_Alloc_Size(RAWPOSTING);
+    size_t raw_post_bytes  = MAX_RAW_POSTING_LEN(base_size, text_size, freq);
+    void *const allocation = MemPool_Grab(mem_pool, raw_post_bytes);
+    RawPosting *const raw_posting
+        = RawPost_new(allocation, doc_id, freq, text_buf, text_size);
+    RawPostingIVARS *const raw_post_ivars = RawPost_IVARS(raw_posting);
+    uint32_t num_prox = freq;
+    char *const start = raw_post_ivars->blob + text_size;
+    char *dest        = start;
+
+    // Field_boost.
+    *((uint8_t*)dest) = ivars->norms[tick];
+    dest++;
+
+    // Read positions.
+    while (num_prox--) {
+        dest += InStream_Read_Raw_C64(instream, dest);
+    }
+
+    // Resize raw posting memory allocation.
+    raw_post_ivars->aux_len = (size_t)(dest - start);
+    raw_post_bytes = (size_t)(dest - (char*)raw_posting);
+    MemPool_Resize(mem_pool, raw_posting, raw_post_bytes);
+
+    return raw_posting;
+}
+
+RawPosting*
+BlockPost_Read_Temp_Raw_IMP(BlockPosting *self, InStream *instream,
+                            int32_t last_doc_id, String *term_text,
+                            MemoryPool *mem_pool) {
+    BlockPost_Read_Raw_t super_read_raw
+        = SUPER_METHOD_PTR(BLOCKPOSTING, LUCY_BlockPost_Read_Raw);
+    return super_read_raw(self, instream, last_doc_id, term_text, mem_pool);
+}
+
+/***************************************************************************/
+
+BlockPostingWriter*
+BlockPostWriter_new(Schema *schema, Snapshot *snapshot, Segment *segment,
+                    PolyReader *polyreader, int32_t field_num) {
+    BlockPostingWriter *self
+        = (BlockPostingWriter*)Class_Make_Obj(BLOCKPOSTINGWRITER);
+    return BlockPostWriter_init(self, schema, snapshot, segment, polyreader,
+                                field_num);
+}
+
+BlockPostingWriter*
+BlockPostWriter_init(BlockPostingWriter *self, Schema *schema,
+                     Snapshot *snapshot, Segment *segment,
+                     PolyReader *polyreader, int32_t field_num) {
+    Architecture *arch   = Schema_Get_Architecture(schema);
+    Folder       *folder = PolyReader_Get_Folder(polyreader);
+    String *filename
+        = Str_newf("%o/postings-%i32.dat", Seg_Get_Name(segment), field_num);
+    PostWriter_init((PostingWriter*)self, schema, snapshot, segment,
+                    polyreader, field_num);
+    BlockPostingWriterIVARS *const ivars = BlockPostWriter_IVARS(self);
+
+    // Blocks end wherever a skip entry may point.
+    const uint32_t block_size = (uint32_t)Arch_Skip_Interval(arch);
+    ivars->block_size  = block_size;
+    ivars->num_pending = 0;
+    ivars->last_doc_id = 0;
+    ivars->doc_deltas  = (uint32_t*)MALLOCATE(block_size * sizeof(uint32_t));
+    ivars->freqs       = (uint32_t*)MALLOCATE(block_size * sizeof(uint32_t));
+    ivars->norms       = (uint8_t*)MALLOCATE(block_size);
+    ivars->packed      = (uint8_t*)MALLOCATE(block_size * sizeof(uint32_t));
+    ivars->prox_buf    = BB_new(0);
+
+    ivars->outstream = Folder_Open_Out(folder, filename);
+    if (!ivars->outstream) { RETHROW(INCREF(Err_get_error())); }
+    DECREF(filename);
+    return self;
+}
+
+void
+BlockPostWriter_Destroy_IMP(BlockPostingWriter *self) {
+    BlockPostingWriterIVARS *const ivars = BlockPostWriter_IVARS(self);
+    DECREF(ivars->outstream);
+    DECREF(ivars->prox_buf);
+    FREEMEM(ivars->doc_deltas);
+    FREEMEM(ivars->freqs);
+    FREEMEM(ivars->norms);
+    FREEMEM(ivars->packed);
+    SUPER_DESTROY(self, BLOCKPOSTINGWRITER);
+}
+
+void
+BlockPostWriter_Write_Posting_IMP(BlockPostingWriter *self,
+                                  RawPosting *posting) {
+    BlockPostingWriterIVARS *const ivars = BlockPostWriter_IVARS(self);
+    RawPostingIVARS *const posting_ivars = RawPost_IVARS(posting);
+    const int32_t  doc_id      = posting_ivars->doc_id;
+    const uint32_t tick        = ivars->num_pending++;
+    char  *const   aux_content = posting_ivars->blob
+                                 + posting_ivars->content_len;
+
+    // The aux content is a boost byte followed by the position deltas.
+    ivars->doc_deltas[tick] = (uint32_t)(doc_id - ivars->last_doc_id);
+    ivars->freqs[tick]      = posting_ivars->freq - 1;
+    ivars->norms[tick]      = *(uint8_t*)aux_content;
+    BB_Cat_Bytes(ivars->prox_buf, aux_content + FIELD_BOOST_LEN,
+                 posting_ivars->aux_len - FIELD_BOOST_LEN);
+    ivars->last_doc_id = doc_id;
+
+    if (ivars->num_pending == ivars->block_size) {
+        S_flush_block(self);
+    }
+}
+
+static void
+S_flush_block(BlockPostingWriter *self) {
+    BlockPostingWriterIVARS *const ivars = BlockPostWriter_IVARS(self);
+    OutStream *const outstream = ivars->outstream;
+    const uint32_t count = ivars->num_pending;
+    if (count == 0) { return; }
+
+    OutStream_Write_CU32(outstream, count);
+    S_write_packed(outstream, ivars->doc_deltas, count, ivars->packed);
+    S_write_packed(outstream, ivars->freqs, count, ivars->packed);
+    OutStream_Write_Bytes(outstream, ivars->norms, count);
+    OutStream_Write_CU32(outstream, (uint32_t)BB_Get_Size(ivars->prox_buf));
+    OutStream_Write_Bytes(outstream, BB_Get_Buf(ivars->prox_buf),
+                          BB_Get_Size(ivars->prox_buf));
+
+    BB_Set_Size(ivars->prox_buf, 0);
+    ivars->num_pending = 0;
+}
+
+static void
+S_write_packed(OutStream *outstream, const uint32_t *values, uint32_t count,
+               uint8_t *scratch) {
+    uint32_t max = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        max |= values[i];
+    }
+    const uint32_t width = NumUtil_bit_width(max);
+    const size_t num_bytes = NumUtil_pack_bits(values, count, width, scratch);
+    OutStream_Write_U8(outstream, (uint8_t)width);
+    OutStream_Write_Bytes(outstream, scratch, num_bytes);
+}
+
+void
+BlockPostWriter_Start_Term_IMP(BlockPostingWriter *self, TermInfo *tinfo) {
+    BlockPostingWriterIVARS *const ivars = BlockPostWriter_IVARS(self);
+    TermInfoIVARS *const tinfo_ivars = TInfo_IVARS(tinfo);
+    S_flush_block(self);
+    ivars->last_doc_id = 0;
+    tinfo_ivars->post_filepos = OutStream_Tell(ivars->outstream);
+}
+
+void
+BlockPostWriter_Update_Skip_Info_IMP(BlockPostingWriter *self,
+                                     TermInfo *tinfo) {
+    BlockPostingWriterIVARS *const ivars = BlockPostWriter_IVARS(self);
+    TermInfoIVARS *const tinfo_ivars = TInfo_IVARS(tinfo);
+    // Skip entries coincide with block boundaries, so the block which
+    // precedes this one has already been flushed.
+    tinfo_ivars->post_filepos = OutStream_Tell(ivars->outstream);
+}
+
+
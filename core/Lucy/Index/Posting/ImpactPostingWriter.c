@@ -0,0 +1,226 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_IMPACTPOSTINGWRITER
+#define C_LUCY_RAWPOSTING
+#define C_LUCY_TERMINFO
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Index/Posting/ImpactPostingWriter.h"
+#include "Lucy/Index/Posting/RawPosting.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/Segment.h"
+#include "Lucy/Index/Similarity.h"
+#include "Lucy/Index/Snapshot.h"
+#include "Lucy/Index/TermInfo.h"
+#include "Lucy/Plan/Architecture.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/Folder.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/NumberUtils.h"
+
+// Write out the buffered postings of the current term if there are enough
+// of them, then empty the buffer.
+static void
+S_flush_term(ImpactPostingWriter *self);
+
+// Order by descending impact, then ascending doc id.
+static int
+S_compare_by_impact(const void *va, const void *vb);
+
+static int
+S_compare_by_doc_id(const void *va, const void *vb);
+
+ImpactPostingWriter*
+ImpactPostWriter_new(Schema *schema, Snapshot *snapshot, Segment *segment,
+                     PolyReader *polyreader, int32_t field_num) {
+    ImpactPostingWriter *self
+        = (ImpactPostingWriter*)Class_Make_Obj(IMPACTPOSTINGWRITER);
+    return ImpactPostWriter_init(self, schema, snapshot, segment, polyreader,
+                                 field_num);
+}
+
+ImpactPostingWriter*
+ImpactPostWriter_init(ImpactPostingWriter *self, Schema *schema,
+                      Snapshot *snapshot, Segment *segment,
+                      PolyReader *polyreader, int32_t field_num) {
+    Architecture *arch     = Schema_Get_Architecture(schema);
+    Folder       *folder   = PolyReader_Get_Folder(polyreader);
+    String       *seg_name = Seg_Get_Name(segment);
+    String       *field    = Seg_Field_Name(segment, field_num);
+    Similarity   *sim      = Schema_Fetch_Sim(schema, field);
+    String *dat_file = Str_newf("%o/impacts-%i32.dat", seg_name, field_num);
+    String *ix_file  = Str_newf("%o/impacts-%i32.ix", seg_name, field_num);
+    PostWriter_init((PostingWriter*)self, schema, snapshot, segment,
+                    polyreader, field_num);
+    ImpactPostingWriterIVARS *const ivars = ImpactPostWriter_IVARS(self);
+
+    // Init.
+    ivars->entries      = NULL;
+    ivars->num_entries  = 0;
+    ivars->entries_cap  = 0;
+    ivars->post_filepos = 0;
+
+    // Derive.
+    ivars->block_size = (uint32_t)Arch_Skip_Interval(arch);
+    ivars->posting    = Sim_Make_Posting(sim);
+    ivars->dat_out    = Folder_Open_Out(folder, dat_file);
+    ivars->ix_out     = ivars->dat_out
+                        ? Folder_Open_Out(folder, ix_file)
+                        : NULL;
+    DECREF(dat_file);
+    DECREF(ix_file);
+    if (!ivars->ix_out) {
+        Err *error = (Err*)INCREF(Err_get_error());
+        DECREF(self);
+        RETHROW(error);
+    }
+
+    return self;
+}
+
+void
+ImpactPostWriter_Destroy_IMP(ImpactPostingWriter *self) {
+    ImpactPostingWriterIVARS *const ivars = ImpactPostWriter_IVARS(self);
+    DECREF(ivars->posting);
+    DECREF(ivars->dat_out);
+    DECREF(ivars->ix_out);
+    FREEMEM(ivars->entries);
+    SUPER_DESTROY(self, IMPACTPOSTINGWRITER);
+}
+
+void
+ImpactPostWriter_Write_Posting_IMP(ImpactPostingWriter *self,
+                                   RawPosting *posting) {
+    ImpactPostingWriterIVARS *const ivars = ImpactPostWriter_IVARS(self);
+    RawPostingIVARS *const posting_ivars = RawPost_IVARS(posting);
+
+    if (ivars->num_entries == ivars->entries_cap) {
+        size_t new_cap = Memory_oversize(ivars->num_entries + 1,
+                                         sizeof(ImpactEntry));
+        ivars->entries = (ImpactEntry*)REALLOCATE(
+                             ivars->entries, new_cap * sizeof(ImpactEntry));
+        ivars->entries_cap = (uint32_t)new_cap;
+    }
+
+    // The aux content starts with the boost byte.
+    ImpactEntry *entry = ivars->entries + ivars->num_entries++;
+    entry->doc_id = posting_ivars->doc_id;
+    entry->freq   = posting_ivars->freq;
+    entry->norm   = *(uint8_t*)(posting_ivars->blob
+                                + posting_ivars->content_len);
+    entry->impact = Post_Impact(ivars->posting, posting);
+}
+
+void
+ImpactPostWriter_Start_Term_IMP(ImpactPostingWriter *self, TermInfo *tinfo) {
+    ImpactPostingWriterIVARS *const ivars = ImpactPostWriter_IVARS(self);
+    S_flush_term(self);
+    ivars->post_filepos = TInfo_IVARS(tinfo)->post_filepos;
+}
+
+void
+ImpactPostWriter_Update_Skip_Info_IMP(ImpactPostingWriter *self,
+                                      TermInfo *tinfo) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(tinfo);
+}
+
+void
+ImpactPostWriter_Finish_IMP(ImpactPostingWriter *self) {
+    ImpactPostingWriterIVARS *const ivars = ImpactPostWriter_IVARS(self);
+    S_flush_term(self);
+    OutStream_Close(ivars->dat_out);
+    OutStream_Close(ivars->ix_out);
+}
+
+static void
+S_flush_term(ImpactPostingWriter *self) {
+    ImpactPostingWriterIVARS *const ivars = ImpactPostWriter_IVARS(self);
+    OutStream   *const dat_out     = ivars->dat_out;
+    ImpactEntry *const entries     = ivars->entries;
+    const uint32_t     num_entries = ivars->num_entries;
+    const uint32_t     block_size  = ivars->block_size;
+    ivars->num_entries = 0;
+
+    // Short lists are cheap enough to walk in doc id order.
+    if (num_entries < block_size) { return; }
+
+    OutStream_Write_I64(ivars->ix_out, ivars->post_filepos);
+    OutStream_Write_I64(ivars->ix_out, OutStream_Tell(dat_out));
+
+    qsort(entries, num_entries, sizeof(ImpactEntry), S_compare_by_impact);
+    for (uint32_t start = 0; start < num_entries; start += block_size) {
+        ImpactEntry *const block = entries + start;
+        const uint32_t count = num_entries - start < block_size
+                               ? num_entries - start
+                               : block_size;
+        const float max_impact = block[0].impact;
+
+        // Within a block, go back to doc id order so that the ids can be
+        // delta encoded.
+        qsort(block, count, sizeof(ImpactEntry), S_compare_by_doc_id);
+        OutStream_Write_CU32(dat_out, count);
+        OutStream_Write_F32(dat_out, max_impact);
+        int32_t last_doc_id = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            OutStream_Write_CU32(dat_out,
+                                 (uint32_t)(block[i].doc_id - last_doc_id));
+            OutStream_Write_CU32(dat_out, block[i].freq);
+            OutStream_Write_U8(dat_out, block[i].norm);
+            last_doc_id = block[i].doc_id;
+        }
+    }
+}
+
+static int
+S_compare_by_impact(const void *va, const void *vb) {
+    const ImpactEntry *a = (const ImpactEntry*)va;
+    const ImpactEntry *b = (const ImpactEntry*)vb;
+    if (a->impact > b->impact) { return -1; }
+    if (a->impact < b->impact) { return 1; }
+    return a->doc_id < b->doc_id ? -1 : a->doc_id > b->doc_id ? 1 : 0;
+}
+
+static int
+S_compare_by_doc_id(const void *va, const void *vb) {
+    const ImpactEntry *a = (const ImpactEntry*)va;
+    const ImpactEntry *b = (const ImpactEntry*)vb;
+    return a->doc_id < b->doc_id ? -1 : a->doc_id > b->doc_id ? 1 : 0;
+}
+
+int64_t
+ImpactPostWriter_find_list(const void *ix, int64_t num_lists,
+                           int64_t post_filepos) {
+    const uint8_t *entries = (const uint8_t*)ix;
+    int64_t lo = 0;
+    int64_t hi = num_lists - 1;
+
+    // Lists are written in term order, so their keys ascend.
+    while (lo <= hi) {
+        const int64_t mid = lo + (hi - lo) / 2;
+        const int64_t key
+            = (int64_t)NumUtil_decode_bigend_u64(entries + mid * 16);
+        if (key < post_filepos)      { lo = mid + 1; }
+        else if (key > post_filepos) { hi = mid - 1; }
+        else {
+            return (int64_t)NumUtil_decode_bigend_u64(entries + mid * 16 + 8);
+        }
+    }
+
+    return -1;
+}
+
@@ -167,6 +167,11 @@ MatchPostMatcher_Score_IMP(MatchPostingMatcher* self) {
     return MatchPostMatcher_IVARS(self)->weight;
 }
 
+float
+MatchPostMatcher_Max_Score_IMP(MatchPostingMatcher* self) {
+    return MatchPostMatcher_IVARS(self)->weight;
+}
+
 /***************************************************************************/
 
 MatchPostingWriter*
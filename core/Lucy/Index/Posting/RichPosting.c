@@ -190,6 +190,23 @@ RichPost_Read_Raw_IMP(RichPosting *self, InStream *instream,
     return raw_posting;
 }
 
+float
+RichPost_Impact_IMP(RichPosting *self, RawPosting *raw_posting) {
+    RichPostingIVARS *const ivars = RichPost_IVARS(self);
+    RawPostingIVARS *const raw_post_ivars = RawPost_IVARS(raw_posting);
+    const char *buf = raw_post_ivars->blob + raw_post_ivars->content_len;
+    float impact = 0.0f;
+
+    // Each position is followed by its boost byte.
+    for (uint32_t i = 0; i < raw_post_ivars->freq; i++) {
+        NumUtil_skip_cint(&buf);
+        impact += ivars->norm_decoder[*(uint8_t*)buf];
+        buf++;
+    }
+
+    return impact;
+}
+
 RichPostingMatcher*
 RichPost_Make_Matcher_IMP(RichPosting *self, Similarity *sim,
                           PostingList *plist, Compiler *compiler,
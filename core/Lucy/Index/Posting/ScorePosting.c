@@ -20,6 +20,8 @@
 #define C_LUCY_TOKEN
 #include "Lucy/Util/ToolSet.h"
 
+#include <float.h>
+
 #include "Lucy/Index/Posting/ScorePosting.h"
 #include "Lucy/Analysis/Token.h"
 #include "Lucy/Analysis/Inversion.h"
@@ -211,6 +213,15 @@ ScorePost_Read_Raw_IMP(ScorePosting *self, InStream *instream,
     return raw_posting;
 }
 
+float
+ScorePost_Impact_IMP(ScorePosting *self, RawPosting *raw_posting) {
+    ScorePostingIVARS *const ivars = ScorePost_IVARS(self);
+    RawPostingIVARS *const raw_post_ivars = RawPost_IVARS(raw_posting);
+    const uint8_t *aux_content
+        = (uint8_t*)raw_post_ivars->blob + raw_post_ivars->content_len;
+    return raw_post_ivars->freq * ivars->norm_decoder[*aux_content];
+}
+
 ScorePostingMatcher*
 ScorePost_Make_Matcher_IMP(ScorePosting *self, Similarity *sim,
                            PostingList *plist, Compiler *compiler,
@@ -256,6 +267,28 @@ ScorePostMatcher_Score_IMP(ScorePostingMatcher* self) {
     return score;
 }
 
+// Translate a bound on impact into a bound on score.
+static float
+S_score_bound(ScorePostingMatcherIVARS *ivars, float impact) {
+    if (impact == FLT_MAX || ivars->weight < 0.0f) { return FLT_MAX; }
+    float bound = Sim_Impact_Bound(ivars->sim, impact);
+    return bound == FLT_MAX ? FLT_MAX : bound * ivars->weight;
+}
+
+float
+ScorePostMatcher_Max_Score_IMP(ScorePostingMatcher *self) {
+    ScorePostingMatcherIVARS *const ivars = ScorePostMatcher_IVARS(self);
+    if (!ivars->plist) { return 0.0f; }
+    return S_score_bound(ivars, PList_Max_Impact(ivars->plist));
+}
+
+float
+ScorePostMatcher_Block_Max_Score_IMP(ScorePostingMatcher *self) {
+    ScorePostingMatcherIVARS *const ivars = ScorePostMatcher_IVARS(self);
+    if (!ivars->plist) { return 0.0f; }
+    return S_score_bound(ivars, PList_Block_Max_Impact(ivars->plist));
+}
+
 void
 ScorePostMatcher_Destroy_IMP(ScorePostingMatcher *self) {
     ScorePostingMatcherIVARS *const ivars = ScorePostMatcher_IVARS(self);
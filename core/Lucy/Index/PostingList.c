@@ -16,6 +16,7 @@
 
 #define C_LUCY_POSTINGLIST
 #include <string.h>
+#include <float.h>
 
 #include "Lucy/Util/ToolSet.h"
 
@@ -30,4 +31,14 @@ PList_init(PostingList *self) {
     return self;
 }
 
+float
+PList_Block_Max_Impact_IMP(PostingList *self) {
+    return PList_Max_Impact(self);
+}
+
+float
+PList_Max_Impact_IMP(PostingList *self) {
+    UNUSED_VAR(self);
+    return FLT_MAX;
+}
 
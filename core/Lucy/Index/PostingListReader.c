@@ -20,17 +20,25 @@
 #include "Lucy/Util/ToolSet.h"
 
 #include "Lucy/Index/PostingListReader.h"
+#include "Clownfish/Blob.h"
 #include "Lucy/Index/LexiconReader.h"
 #include "Lucy/Index/PostingListWriter.h"
+#include "Lucy/Index/Posting/ImpactPostingWriter.h"
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/SegPostingList.h"
 #include "Lucy/Index/Snapshot.h"
 #include "Lucy/Plan/Architecture.h"
 #include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/FullTextType.h"
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Store/Folder.h"
+#include "Lucy/Store/InStream.h"
 #include "Lucy/Util/Json.h"
 
+// Open the impact-ordered lists of every field which has them.
+static void
+S_open_impacts(DefaultPostingListReader *self);
+
 PostingListReader*
 PListReader_init(PostingListReader *self, Schema *schema, Folder *folder,
                  Snapshot *snapshot, Vector *segments, int32_t seg_tick) {
@@ -88,9 +96,74 @@ DefPListReader_init(DefaultPostingListReader *self, Schema *schema,
         }
     }
 
+    S_open_impacts(self);
+
     return self;
 }
 
+static void
+S_open_impacts(DefaultPostingListReader *self) {
+    DefaultPostingListReaderIVARS *const ivars = DefPListReader_IVARS(self);
+    Folder  *folder   = DefPListReader_Get_Folder(self);
+    Segment *segment  = DefPListReader_Get_Segment(self);
+    Vector  *fields   = Schema_All_Fields(ivars->schema);
+    String  *seg_name = Seg_Get_Name(segment);
+
+    ivars->impact_ixes    = Vec_new(0);
+    ivars->impact_dat_ins = Vec_new(0);
+
+    for (size_t i = 0, max = Vec_Get_Size(fields); i < max; i++) {
+        String    *field = (String*)Vec_Fetch(fields, i);
+        FieldType *type  = Schema_Fetch_Type(ivars->schema, field);
+        if (!FType_is_a(type, FULLTEXTTYPE)
+            || !FullTextType_Impact_Ordered((FullTextType*)type)
+           ) {
+            continue;
+        }
+        int32_t field_num = Seg_Field_Num(segment, field);
+        if (!field_num) { continue; }
+
+        // Segments written before the property was set have no lists.
+        String *ix_file = Str_newf("%o/impacts-%i32.ix", seg_name, field_num);
+        if (!Folder_Exists(folder, ix_file)) {
+            DECREF(ix_file);
+            continue;
+        }
+        String   *dat_file = Str_newf("%o/impacts-%i32.dat", seg_name,
+                                      field_num);
+        InStream *ix_in    = Folder_Open_In(folder, ix_file);
+        InStream *dat_in   = ix_in ? Folder_Open_In(folder, dat_file) : NULL;
+        DECREF(ix_file);
+        DECREF(dat_file);
+        if (!dat_in) {
+            DECREF(ix_in);
+            DECREF(fields);
+            RETHROW(INCREF(Err_get_error()));
+        }
+
+        // The index is binary searched for every term, so keep it resident.
+        int64_t ix_len = InStream_Length(ix_in);
+        if (ix_len % 16) {
+            Err *error = Err_new(Str_newf("Corrupt impact index '%o': "
+                                          "length %i64",
+                                          InStream_Get_Filename(ix_in),
+                                          ix_len));
+            DECREF(ix_in);
+            DECREF(dat_in);
+            DECREF(fields);
+            RETHROW(error);
+        }
+        const char *buf = InStream_Buf(ix_in, (size_t)ix_len);
+        Vec_Store(ivars->impact_ixes, (size_t)field_num,
+                  (Obj*)Blob_new(buf, (size_t)ix_len));
+        Vec_Store(ivars->impact_dat_ins, (size_t)field_num, (Obj*)dat_in);
+        InStream_Close(ix_in);
+        DECREF(ix_in);
+    }
+
+    DECREF(fields);
+}
+
 void
 DefPListReader_Close_IMP(DefaultPostingListReader *self) {
     DefaultPostingListReaderIVARS *const ivars = DefPListReader_IVARS(self);
@@ -99,12 +172,27 @@ DefPListReader_Close_IMP(DefaultPostingListReader *self) {
         DECREF(ivars->lex_reader);
         ivars->lex_reader = NULL;
     }
+    if (ivars->impact_dat_ins) {
+        for (size_t i = 0, max = Vec_Get_Size(ivars->impact_dat_ins);
+             i < max; i++
+            ) {
+            InStream *dat_in
+                = (InStream*)Vec_Fetch(ivars->impact_dat_ins, i);
+            if (dat_in) { InStream_Close(dat_in); }
+        }
+        DECREF(ivars->impact_dat_ins);
+        ivars->impact_dat_ins = NULL;
+    }
+    DECREF(ivars->impact_ixes);
+    ivars->impact_ixes = NULL;
 }
 
 void
 DefPListReader_Destroy_IMP(DefaultPostingListReader *self) {
     DefaultPostingListReaderIVARS *const ivars = DefPListReader_IVARS(self);
     DECREF(ivars->lex_reader);
+    DECREF(ivars->impact_ixes);
+    DECREF(ivars->impact_dat_ins);
     SUPER_DESTROY(self, DEFAULTPOSTINGLISTREADER);
 }
 
@@ -130,3 +218,24 @@ DefPListReader_Get_Lex_Reader_IMP(DefaultPostingListReader *self) {
     return DefPListReader_IVARS(self)->lex_reader;
 }
 
+InStream*
+DefPListReader_Impact_Stream_IMP(DefaultPostingListReader *self,
+                                 int32_t field_num, int64_t post_filepos) {
+    DefaultPostingListReaderIVARS *const ivars = DefPListReader_IVARS(self);
+    if (!ivars->impact_ixes || field_num <= 0) { return NULL; }
+    Blob *ix = (Blob*)Vec_Fetch(ivars->impact_ixes, (size_t)field_num);
+    if (!ix) { return NULL; }
+
+    int64_t dat_filepos
+        = ImpactPostWriter_find_list(Blob_Get_Buf(ix),
+                                     (int64_t)(Blob_Get_Size(ix) / 16),
+                                     post_filepos);
+    if (dat_filepos < 0) { return NULL; }
+
+    InStream *dat_in
+        = (InStream*)Vec_Fetch(ivars->impact_dat_ins, (size_t)field_num);
+    InStream *retval = InStream_Clone(dat_in);
+    InStream_Seek(retval, dat_filepos);
+    return retval;
+}
+
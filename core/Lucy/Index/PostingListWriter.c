@@ -30,6 +30,7 @@
 #include "Lucy/Index/Snapshot.h"
 #include "Lucy/Plan/Architecture.h"
 #include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/NumericType.h"
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/InStream.h"
@@ -38,7 +39,7 @@
 
 static uint32_t default_mem_thresh = 0x1000000;
 
-int32_t PListWriter_current_file_format = 1;
+int32_t PListWriter_current_file_format = 2;
 
 // Open streams only if content gets added.
 static void
@@ -70,6 +71,7 @@ PListWriter_init(PostingListWriter *self, Schema *schema, Snapshot *snapshot,
     // Init.
     ivars->pools          = Vec_new(Schema_Num_Fields(schema));
     ivars->mem_thresh     = default_mem_thresh;
+    ivars->sort_threads   = 1;
     ivars->mem_pool       = MemPool_new(0);
     ivars->lex_temp_out   = NULL;
     ivars->post_temp_out  = NULL;
@@ -111,6 +113,8 @@ S_lazy_init_posting_pool(PostingListWriter *self, int32_t field_num) {
                             ivars->polyreader, field, ivars->lex_writer,
                             ivars->mem_pool, ivars->lex_temp_out,
                             ivars->post_temp_out, ivars->skip_out);
+        PostPool_Set_Num_Threads(pool, ivars->sort_threads);
+        PostPool_Set_Mem_Thresh(pool, ivars->mem_thresh);
         Vec_Store(ivars->pools, (size_t)field_num, (Obj*)pool);
     }
     return pool;
@@ -133,6 +137,17 @@ PListWriter_set_default_mem_thresh(uint32_t mem_thresh) {
     default_mem_thresh = mem_thresh;
 }
 
+void
+PListWriter_Set_Sort_Threads_IMP(PostingListWriter *self,
+                                 uint32_t num_threads) {
+    PostingListWriterIVARS *const ivars = PListWriter_IVARS(self);
+    ivars->sort_threads = num_threads ? num_threads : 1;
+    for (size_t i = 0, max = Vec_Get_Size(ivars->pools); i < max; i++) {
+        PostingPool *pool = (PostingPool*)Vec_Fetch(ivars->pools, i);
+        if (pool) { PostPool_Set_Num_Threads(pool, ivars->sort_threads); }
+    }
+}
+
 int32_t
 PListWriter_Format_IMP(PostingListWriter *self) {
     UNUSED_VAR(self);
@@ -152,7 +167,7 @@ PListWriter_Add_Inverted_Doc_IMP(PostingListWriter *self, Inverter *inverter,
     int32_t field_num;
     while (0 != (field_num = Inverter_Next(inverter))) {
         FieldType *type = Inverter_Get_Type(inverter);
-        if (FType_Indexed(type)) {
+        if (FType_Indexed(type) && !FType_is_a(type, NUMERICTYPE)) {
             Inversion   *inversion = Inverter_Get_Inversion(inverter);
             Similarity  *sim  = Inverter_Get_Similarity(inverter);
             PostingPool *pool = S_lazy_init_posting_pool(self, field_num);
@@ -192,6 +207,7 @@ PListWriter_Add_Segment_IMP(PostingListWriter *self, SegReader *reader,
         int32_t new_field_num = Seg_Field_Num(segment, field);
 
         if (!FType_Indexed(type)) { continue; }
+        if (FType_is_a(type, NUMERICTYPE)) { continue; } // see PointWriter
         if (!old_field_num)       { continue; } // not in old segment
         if (!new_field_num) {
             THROW(ERR, "Unrecognized field: %o", field);
@@ -18,7 +18,6 @@
 #define C_LUCY_RAWPOSTING
 #define C_LUCY_MEMORYPOOL
 #define C_LUCY_TERMINFO
-#define C_LUCY_SKIPSTEPPER
 #include "Lucy/Util/ToolSet.h"
 
 #include "Lucy/Index/PostingPool.h"
@@ -26,37 +25,74 @@
 #include "Lucy/Analysis/Inversion.h"
 #include "Lucy/Plan/Architecture.h"
 #include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/FullTextType.h"
 #include "Lucy/Index/LexiconReader.h"
 #include "Lucy/Index/LexiconWriter.h"
 #include "Lucy/Index/PolyReader.h"
 #include "Lucy/Index/Posting.h"
+#include "Lucy/Index/Posting/ImpactPostingWriter.h"
 #include "Lucy/Index/Posting/RawPosting.h"
+#include "Lucy/Index/Posting/RichPosting.h"
+#include "Lucy/Index/Posting/ScorePosting.h"
 #include "Lucy/Index/PostingListReader.h"
 #include "Lucy/Index/RawLexicon.h"
 #include "Lucy/Index/RawPostingList.h"
 #include "Lucy/Index/Segment.h"
+#include "Lucy/Index/SegPostingList.h"
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Index/Similarity.h"
 #include "Lucy/Index/Snapshot.h"
-#include "Lucy/Index/SkipStepper.h"
+#include "Lucy/Index/SkipListWriter.h"
 #include "Lucy/Index/TermInfo.h"
 #include "Lucy/Index/TermStepper.h"
 #include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/FileHandle.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/InStream.h"
 #include "Lucy/Store/OutStream.h"
 #include "Lucy/Util/MemoryPool.h"
+#include "Lucy/Util/Threads.h"
+#include "Clownfish/Util/SortUtils.h"
+
+// Buckets smaller than this are sorted by comparison rather than by another
+// radix pass.
+#define RADIX_CUTOFF 64
+
+// Smallest buffer worth spreading across threads.
+#define MIN_THREADED_SORT 0x10000
+
+// A posting's sort key.  Sorting an array of these avoids chasing a pointer
+// into the MemoryPool for most comparisons.
+typedef struct {
+    uint64_t    prefix;
+    uint32_t    len;
+    int32_t     doc_id;
+    RawPosting *posting;
+} S_PostingKey;
+
+// Shared state for sorting the top-level radix buckets.
+typedef struct {
+    S_PostingKey *keys;
+    S_PostingKey *scratch;
+    uint32_t      starts[257];
+} S_RadixContext;
 
 // Prepare to read back postings from disk.
 static void
 S_fresh_flip(PostingPool *self, InStream *lex_temp_in,
              InStream *post_temp_in);
 
-// Main loop.
+// Main loop.  `impact_writer`, if supplied, is fed the same postings.
 static void
 S_write_terms_and_postings(PostingPool *self, PostingWriter *post_writer,
+                           PostingWriter *impact_writer,
                            OutStream *skip_stream);
 
+// Return an ImpactPostingWriter if the field asks for impact-ordered
+// postings in a format which supports them, or NULL.
+static PostingWriter*
+S_maybe_impact_writer(PostingPool *self);
+
 PostingPool*
 PostPool_new(Schema *schema, Snapshot *snapshot, Segment *segment,
              PolyReader *polyreader,  String *field,
@@ -90,7 +126,6 @@ PostPool_init(PostingPool *self, Schema *schema, Snapshot *snapshot,
     ivars->post_start       = INT64_MAX;
     ivars->lex_end          = 0;
     ivars->post_end         = 0;
-    ivars->skip_stepper     = SkipStepper_new();
 
     // Assign.
     ivars->schema         = (Schema*)INCREF(schema);
@@ -108,6 +143,8 @@ PostPool_init(PostingPool *self, Schema *schema, Snapshot *snapshot,
     Similarity *sim = Schema_Fetch_Sim(schema, field);
     ivars->posting   = Sim_Make_Posting(sim);
     ivars->type      = (FieldType*)INCREF(Schema_Fetch_Type(schema, field));
+    ivars->skip_writer
+        = SkipWriter_new(Schema_Get_Architecture(schema));
     ivars->field_num = Seg_Field_Num(segment, field);
 
     return self;
@@ -131,7 +168,7 @@ PostPool_Destroy_IMP(PostingPool *self) {
     DECREF(ivars->lex_temp_in);
     DECREF(ivars->post_temp_in);
     DECREF(ivars->posting);
-    DECREF(ivars->skip_stepper);
+    DECREF(ivars->skip_writer);
     DECREF(ivars->type);
     MemoryPool *mem_pool = ivars->mem_pool;
     SUPER_DESTROY(self, POSTINGPOOL);
@@ -171,6 +208,170 @@ PostPool_Compare_IMP(PostingPool *self, Obj **ptr_a, Obj **ptr_b) {
     return comparison;
 }
 
+uint64_t
+PostPool_Key_Prefix_IMP(PostingPool *self, Obj *item) {
+    RawPostingIVARS *const posting = RawPost_IVARS((RawPosting*)item);
+    UNUSED_VAR(self);
+    return SortEx_bytes_prefix(posting->blob, posting->content_len);
+}
+
+// Compare two keys exactly as PostPool_Compare_IMP compares their postings.
+static CFISH_INLINE int
+SI_compare_keys(const S_PostingKey *a, const S_PostingKey *b) {
+    if (a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    // Equal prefixes mean that the first 8 bytes match, or that the shorter
+    // term is all there is of the longer one's first bytes.
+    if (a->len > 8 && b->len > 8) {
+        const uint32_t len = a->len < b->len ? a->len : b->len;
+        int comparison = memcmp(RawPost_IVARS(a->posting)->blob + 8,
+                                RawPost_IVARS(b->posting)->blob + 8,
+                                len - 8);
+        if (comparison != 0) { return comparison; }
+    }
+    if (a->len != b->len) {
+        return a->len < b->len ? -1 : 1;
+    }
+    if (a->doc_id != b->doc_id) {
+        return a->doc_id < b->doc_id ? -1 : 1;
+    }
+    return 0;
+}
+
+static int
+S_compare_keys(void *context, const void *va, const void *vb) {
+    UNUSED_VAR(context);
+    return SI_compare_keys((const S_PostingKey*)va, (const S_PostingKey*)vb);
+}
+
+// Postings arrive in doc id order, so the keys within a bucket are often
+// sorted already.
+static void
+S_sort_keys(S_PostingKey *keys, S_PostingKey *scratch, uint32_t num_keys) {
+    for (uint32_t i = 1; i < num_keys; i++) {
+        if (SI_compare_keys(&keys[i - 1], &keys[i]) > 0) {
+            Sort_mergesort(keys, scratch, num_keys, sizeof(S_PostingKey),
+                           S_compare_keys, NULL);
+            return;
+        }
+    }
+}
+
+// Distribute keys into buckets by byte `byte_num` of their prefix, keeping
+// the keys within each bucket in order.  Fill `starts` with the offset of
+// each bucket, plus the end of the last.  Return false if all keys share the
+// same byte, in which case nothing moves.
+static bool
+S_distribute(S_PostingKey *keys, S_PostingKey *scratch, uint32_t num_keys,
+             uint32_t byte_num, uint32_t *starts) {
+    const uint32_t shift = 56 - 8 * byte_num;
+    uint32_t counts[256];
+    memset(counts, 0, sizeof(counts));
+    for (uint32_t i = 0; i < num_keys; i++) {
+        counts[(keys[i].prefix >> shift) & 0xFF]++;
+    }
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < 256; i++) {
+        starts[i] = sum;
+        sum += counts[i];
+        counts[i] = starts[i];
+    }
+    starts[256] = sum;
+
+    const uint32_t first_byte = (keys[0].prefix >> shift) & 0xFF;
+    if (starts[first_byte + 1] - starts[first_byte] == num_keys) {
+        return false;
+    }
+    for (uint32_t i = 0; i < num_keys; i++) {
+        scratch[counts[(keys[i].prefix >> shift) & 0xFF]++] = keys[i];
+    }
+    memcpy(keys, scratch, num_keys * sizeof(S_PostingKey));
+    return true;
+}
+
+// Most-significant-byte-first radix sort on the prefix, starting at byte
+// `byte_num`.
+static void
+S_radix_sort(S_PostingKey *keys, S_PostingKey *scratch, uint32_t num_keys,
+             uint32_t byte_num) {
+    uint32_t starts[257];
+    while (byte_num < 8 && num_keys >= RADIX_CUTOFF) {
+        if (S_distribute(keys, scratch, num_keys, byte_num, starts)) {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t size = starts[i + 1] - starts[i];
+                if (size > 1) {
+                    S_radix_sort(keys + starts[i], scratch + starts[i], size,
+                                 byte_num + 1);
+                }
+            }
+            return;
+        }
+        byte_num++;
+    }
+    S_sort_keys(keys, scratch, num_keys);
+}
+
+// Sort one top-level bucket.  May run on a worker thread.
+static void
+S_sort_bucket(void *context, uint32_t tick) {
+    S_RadixContext *const radix_context = (S_RadixContext*)context;
+    const uint32_t start = radix_context->starts[tick];
+    const uint32_t size  = radix_context->starts[tick + 1] - start;
+    if (size > 1) {
+        S_radix_sort(radix_context->keys + start,
+                     radix_context->scratch + start, size, 1);
+    }
+}
+
+void
+PostPool_Sort_Buffer_IMP(PostingPool *self) {
+    PostingPoolIVARS *const ivars = PostPool_IVARS(self);
+    if (ivars->buf_tick != 0) {
+        THROW(ERR, "Cant Sort_Buffer() after fetching %u32 items",
+              ivars->buf_tick);
+    }
+    const uint32_t num_keys = ivars->buf_max;
+    if (num_keys < 2) { return; }
+
+    S_PostingKey *keys
+        = (S_PostingKey*)MALLOCATE(2 * (size_t)num_keys
+                                   * sizeof(S_PostingKey));
+    S_PostingKey *scratch = keys + num_keys;
+    for (uint32_t i = 0; i < num_keys; i++) {
+        RawPosting *posting = (RawPosting*)ivars->buffer[i];
+        RawPostingIVARS *const posting_ivars = RawPost_IVARS(posting);
+        keys[i].prefix  = SortEx_bytes_prefix(posting_ivars->blob,
+                                              posting_ivars->content_len);
+        keys[i].len     = (uint32_t)posting_ivars->content_len;
+        keys[i].doc_id  = posting_ivars->doc_id;
+        keys[i].posting = posting;
+    }
+
+    // The first pass splits the keys into independent buckets, which may be
+    // sorted on several threads.
+    S_RadixContext context;
+    context.keys    = keys;
+    context.scratch = scratch;
+    S_distribute(keys, scratch, num_keys, 0, context.starts);
+    if (ivars->num_threads > 1
+        && num_keys >= MIN_THREADED_SORT
+        && Threads_available()
+       ) {
+        Threads_run(256, ivars->num_threads, S_sort_bucket, &context);
+    }
+    else {
+        for (uint32_t i = 0; i < 256; i++) {
+            S_sort_bucket(&context, i);
+        }
+    }
+
+    for (uint32_t i = 0; i < num_keys; i++) {
+        ivars->buffer[i] = (Obj*)keys[i].posting;
+    }
+    FREEMEM(keys);
+}
+
 MemoryPool*
 PostPool_Get_Mem_Pool_IMP(PostingPool *self) {
     return PostPool_IVARS(self)->mem_pool;
@@ -235,6 +436,68 @@ PostPool_Flip_IMP(PostingPool *self) {
     ivars->flipped = true;
 }
 
+// Indicate whether a doc map changes the order of the docs it keeps, as one
+// which sorts a segment does.
+static bool
+S_reorders(I32Array *doc_map) {
+    if (!doc_map) { return false; }
+    int32_t last_doc_id = 0;
+    for (size_t i = 1, max = I32Arr_Get_Size(doc_map); i < max; i++) {
+        int32_t doc_id = I32Arr_Get(doc_map, i);
+        if (doc_id) {
+            if (doc_id < last_doc_id) { return true; }
+            last_doc_id = doc_id;
+        }
+    }
+    return false;
+}
+
+// Feed every posting of a segment whose docs get reordered through the
+// buffer, spilling sorted runs to the temp files whenever the postings read
+// so far pass the memory threshold.  Unlike the docs of an ordinary segment,
+// the docs of one term come out of the doc map in no particular order, so
+// they can't be merged straight from the segment.
+static void
+S_spill_reordered(PostingPool *self, Lexicon *lexicon, PostingList *plist,
+                  I32Array *doc_map, int32_t doc_base) {
+    PostingPoolIVARS *const ivars = PostPool_IVARS(self);
+    MemoryPool *mem_pool = MemPool_new(0);
+
+    while (Lex_Next(lexicon)) {
+        String *term_text = (String*)Lex_Get_Term(lexicon);
+        if (term_text && !Obj_is_a((Obj*)term_text, STRING)) {
+            THROW(ERR, "Only String terms are supported for now");
+        }
+        uint32_t post_count  = (uint32_t)Lex_Doc_Freq(lexicon);
+        int32_t  last_doc_id = doc_base;
+        Post_Set_Doc_ID(PList_Get_Posting(plist), doc_base);
+
+        for (; post_count > 0; post_count--) {
+            RawPosting *rawpost
+                = PList_Read_Raw(plist, last_doc_id, term_text, mem_pool);
+            RawPostingIVARS *const rawpost_ivars = RawPost_IVARS(rawpost);
+            last_doc_id = rawpost_ivars->doc_id;
+
+            // Skip deletions.
+            const int32_t remapped
+                = I32Arr_Get(doc_map,
+                             (size_t)(rawpost_ivars->doc_id - doc_base));
+            if (!remapped) { continue; }
+            rawpost_ivars->doc_id = remapped;
+            PostPool_Feed(self, (Obj*)rawpost);
+
+            if (MemPool_Get_Consumed(mem_pool) >= ivars->mem_thresh) {
+                PostPool_Flush(self);
+                MemPool_Release_All(mem_pool);
+            }
+        }
+    }
+
+    // The buffer can't outlive the MemoryPool its postings live in.
+    PostPool_Flush(self);
+    DECREF(mem_pool);
+}
+
 void
 PostPool_Add_Segment_IMP(PostingPool *self, SegReader *reader,
                          I32Array *doc_map, int32_t doc_base) {
@@ -256,6 +519,20 @@ PostPool_Add_Segment_IMP(PostingPool *self, SegReader *reader,
             THROW(ERR, "Got a Lexicon but no PostingList for '%o' in '%o'",
                   ivars->field, SegReader_Get_Seg_Name(reader));
         }
+        if (Obj_is_a((Obj*)plist, SEGPOSTINGLIST)) {
+            // The merge walks the whole postings file front to back.
+            InStream *post_stream
+                = SegPList_Get_Post_Stream((SegPostingList*)plist);
+            if (post_stream) {
+                InStream_Advise(post_stream, FH_ADVICE_SEQUENTIAL);
+            }
+        }
+        if (S_reorders(doc_map)) {
+            S_spill_reordered(self, lexicon, plist, doc_map, doc_base);
+            DECREF(lexicon);
+            DECREF(plist);
+            return;
+        }
         PostingPool *run
             = PostPool_new(ivars->schema, ivars->snapshot, ivars->segment,
                            ivars->polyreader, ivars->field, ivars->lex_writer,
@@ -300,7 +577,7 @@ PostPool_Flush_IMP(PostingPool *self) {
     run_ivars->lex_start  = OutStream_Tell(ivars->lex_temp_out);
     run_ivars->post_start = OutStream_Tell(ivars->post_temp_out);
     PostPool_Sort_Buffer(self);
-    S_write_terms_and_postings(run, post_writer, NULL);
+    S_write_terms_and_postings(run, post_writer, NULL, NULL);
 
     run_ivars->lex_end  = OutStream_Tell(ivars->lex_temp_out);
     run_ivars->post_end = OutStream_Tell(ivars->post_temp_out);
@@ -331,14 +608,43 @@ PostPool_Finish_IMP(PostingPool *self) {
         = Sim_Make_Posting_Writer(sim, ivars->schema, ivars->snapshot,
                                   ivars->segment, ivars->polyreader,
                                   ivars->field_num);
+    PostingWriter *impact_writer = S_maybe_impact_writer(self);
     LexWriter_Start_Field(ivars->lex_writer, ivars->field_num);
-    S_write_terms_and_postings(self, post_writer, ivars->skip_out);
+    S_write_terms_and_postings(self, post_writer, impact_writer,
+                               ivars->skip_out);
     LexWriter_Finish_Field(ivars->lex_writer, ivars->field_num);
+    if (impact_writer) {
+        PostWriter_Finish(impact_writer);
+        DECREF(impact_writer);
+    }
     DECREF(post_writer);
 }
 
+static PostingWriter*
+S_maybe_impact_writer(PostingPool *self) {
+    PostingPoolIVARS *const ivars = PostPool_IVARS(self);
+    FieldType *const type    = ivars->type;
+    Posting   *const posting = ivars->posting;
+
+    // The list records freqs and boost bytes only, which is all that
+    // ScorePosting and BlockPosting score on.
+    if (!Obj_is_a((Obj*)type, FULLTEXTTYPE)
+        || !FullTextType_Impact_Ordered((FullTextType*)type)
+        || !Obj_is_a((Obj*)posting, SCOREPOSTING)
+        || Obj_is_a((Obj*)posting, RICHPOSTING)
+       ) {
+        return NULL;
+    }
+    return (PostingWriter*)ImpactPostWriter_new(ivars->schema,
+                                                ivars->snapshot,
+                                                ivars->segment,
+                                                ivars->polyreader,
+                                                ivars->field_num);
+}
+
 static void
 S_write_terms_and_postings(PostingPool *self, PostingWriter *post_writer,
+                           PostingWriter *impact_writer,
                            OutStream *skip_stream) {
     PostingPoolIVARS *const ivars = PostPool_IVARS(self);
     TermInfo      *const tinfo            = TInfo_new(0);
@@ -346,11 +652,8 @@ S_write_terms_and_postings(PostingPool *self, PostingWriter *post_writer,
     TermInfoIVARS *const tinfo_ivars      = TInfo_IVARS(tinfo);
     TermInfoIVARS *const skip_tinfo_ivars = TInfo_IVARS(skip_tinfo);
     LexiconWriter *const lex_writer       = ivars->lex_writer;
-    SkipStepper   *const skip_stepper     = ivars->skip_stepper;
-    SkipStepperIVARS *const skip_stepper_ivars
-        = SkipStepper_IVARS(skip_stepper);
-    int32_t        last_skip_doc          = 0;
-    int64_t        last_skip_filepos      = 0;
+    SkipListWriter *const skip_writer     = ivars->skip_writer;
+    Posting       *const posting_class    = ivars->posting;
     const int32_t  skip_interval
         = Arch_Skip_Interval(Schema_Get_Architecture(ivars->schema));
 
@@ -362,7 +665,7 @@ S_write_terms_and_postings(PostingPool *self, PostingWriter *post_writer,
         = BB_new_bytes(post_ivars->blob, post_ivars->content_len);
     char     *last_text_buf  = BB_Get_Buf(last_term_text);
     size_t    last_text_size = BB_Get_Size(last_term_text);
-    SkipStepper_Set_ID_And_Filepos(skip_stepper, 0, 0);
+    SkipWriter_Start_Term(skip_writer);
 
     // Initialize sentinel to be used on the last iter, using an empty string
     // in order to make LexiconWriter Do The Right Thing.
@@ -393,18 +696,27 @@ S_write_terms_and_postings(PostingPool *self, PostingWriter *post_writer,
 
         // If the term text changes, process the last term.
         if (!same_text_as_last) {
+            // Write the finished term's skip data, now that all of its
+            // blocks are known.
+            if (skip_stream != NULL) {
+                int64_t skip_filepos
+                    = SkipWriter_Finish_Term(skip_writer, skip_stream,
+                                             tinfo_ivars->post_filepos);
+                if (skip_filepos >= 0) {
+                    tinfo_ivars->skip_filepos = skip_filepos;
+                }
+            }
+
             // Hand off to LexiconWriter.
             LexWriter_Add_Term(lex_writer, (Obj*)last_term_text, tinfo);
 
             // Start each term afresh.
             TInfo_Reset(tinfo);
             PostWriter_Start_Term(post_writer, tinfo);
-
-            // Init skip data in preparation for the next term.
-            skip_stepper_ivars->doc_id  = 0;
-            skip_stepper_ivars->filepos = tinfo_ivars->post_filepos;
-            last_skip_doc         = 0;
-            last_skip_filepos     = tinfo_ivars->post_filepos;
+            if (impact_writer) {
+                PostWriter_Start_Term(impact_writer, tinfo);
+            }
+            SkipWriter_Start_Term(skip_writer);
 
             // Remember the term_text so we can write string diffs.
             last_text_size = post_ivars->content_len;
@@ -418,28 +730,25 @@ S_write_terms_and_postings(PostingPool *self, PostingWriter *post_writer,
 
         // Write posting data.
         PostWriter_Write_Posting(post_writer, posting);
+        if (impact_writer) {
+            PostWriter_Write_Posting(impact_writer, posting);
+        }
+        if (skip_stream != NULL) {
+            SkipWriter_Add_Posting(skip_writer,
+                                   Post_Impact(posting_class, posting));
+        }
 
         // Doc freq lags by one iter.
         tinfo_ivars->doc_freq++;
 
-        //  Write skip data.
+        // Close off a skip block.
         if (skip_stream != NULL
-            && same_text_as_last
             && tinfo_ivars->doc_freq % skip_interval == 0
             && tinfo_ivars->doc_freq != 0
            ) {
-            // If first skip group, save skip stream pos for term info.
-            if (tinfo_ivars->doc_freq == skip_interval) {
-                tinfo_ivars->skip_filepos = OutStream_Tell(skip_stream);
-            }
-            // Write deltas.
-            last_skip_doc               = skip_stepper_ivars->doc_id;
-            last_skip_filepos           = skip_stepper_ivars->filepos;
-            skip_stepper_ivars->doc_id  = post_ivars->doc_id;
             PostWriter_Update_Skip_Info(post_writer, skip_tinfo);
-            skip_stepper_ivars->filepos = skip_tinfo_ivars->post_filepos;
-            SkipStepper_Write_Record(skip_stepper, skip_stream,
-                                     last_skip_doc, last_skip_filepos);
+            SkipWriter_Add_Entry(skip_writer, post_ivars->doc_id,
+                                 skip_tinfo_ivars->post_filepos);
         }
 
         // Retrieve the next posting from the sort pool.
@@ -64,8 +64,8 @@ RawPosting*
 RawPList_Read_Raw_IMP(RawPostingList *self, int32_t last_doc_id,
                       String *term_text, MemoryPool *mem_pool) {
     RawPostingListIVARS *const ivars = RawPList_IVARS(self);
-    return Post_Read_Raw(ivars->posting, ivars->instream,
-                         last_doc_id, term_text, mem_pool);
+    return Post_Read_Temp_Raw(ivars->posting, ivars->instream,
+                              last_doc_id, term_text, mem_pool);
 }
 
 
@@ -31,12 +31,23 @@
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/InStream.h"
+#include "Lucy/Util/FST.h"
 #include "Lucy/Util/Json.h"
 
 // Iterate until the state is greater than or equal to the target.
 static void
 S_scan_to(SegLexicon *self, Obj *target);
 
+// Position the Lexicon on term number `term_num` by reading the closest key
+// frame at or before it and stepping forward, without comparing any terms.
+static void
+S_seek_to_num(SegLexicon *self, int32_t term_num);
+
+// Return the number of terms less than `term`, or if `inclusive` is true,
+// less than or equal to `term`.
+static int32_t
+S_term_bound(SegLexicon *self, String *term, bool inclusive);
+
 SegLexicon*
 SegLex_new(Schema *schema, Folder *folder, Segment *segment,
            String *field) {
@@ -94,8 +105,24 @@ SegLex_init(SegLexicon *self, Schema *schema, Folder *folder,
     }
     DECREF(filename);
 
+    // Segments written before the term index was added don't have one.
+    filename = Str_newf("%o/lexicon-%i32.fst", seg_name, field_num);
+    if (Folder_Exists(folder, filename)) {
+        InStream *fst_in = Folder_Open_In(folder, filename);
+        if (!fst_in) {
+            Err *error = (Err*)INCREF(Err_get_error());
+            DECREF(filename);
+            DECREF(self);
+            RETHROW(error);
+        }
+        ivars->fst = FST_new(fst_in);
+        DECREF(fst_in);
+    }
+    DECREF(filename);
+
     // Define the term_num as "not yet started".
     ivars->term_num = -1;
+    ivars->limit    = ivars->size;
 
     // Get steppers.
     ivars->term_stepper  = FType_Make_Term_Stepper(type);
@@ -111,6 +138,7 @@ SegLex_Destroy_IMP(SegLexicon *self) {
     DECREF(ivars->term_stepper);
     DECREF(ivars->tinfo_stepper);
     DECREF(ivars->lex_index);
+    DECREF(ivars->fst);
     DECREF(ivars->instream);
     SUPER_DESTROY(self, SEGLEXICON);
 }
@@ -125,6 +153,13 @@ SegLex_Seek_IMP(SegLexicon *self, Obj *target) {
         SegLex_Reset(self);
         return;
     }
+    ivars->limit = ivars->size;
+
+    // The term index knows the number of the term we want.
+    if (ivars->fst) {
+        S_seek_to_num(self, S_term_bound(self, (String*)target, false));
+        return;
+    }
 
     // Use the LexIndex to get in the ballpark.
     LexIndex_Seek(lex_index, target);
@@ -146,6 +181,7 @@ void
 SegLex_Reset_IMP(SegLexicon* self) {
     SegLexiconIVARS *const ivars = SegLex_IVARS(self);
     ivars->term_num = -1;
+    ivars->limit    = ivars->size;
     InStream_Seek(ivars->instream, 0);
     TermStepper_Reset(ivars->term_stepper);
     TermStepper_Reset(ivars->tinfo_stepper);
@@ -185,8 +221,8 @@ SegLex_Next_IMP(SegLexicon *self) {
     SegLexiconIVARS *const ivars = SegLex_IVARS(self);
 
     // If we've run out of terms, null out and return.
-    if (++ivars->term_num >= ivars->size) {
-        ivars->term_num = ivars->size; // don't keep growing
+    if (++ivars->term_num >= ivars->limit) {
+        ivars->term_num = ivars->limit; // don't keep growing
         TermStepper_Reset(ivars->term_stepper);
         TermStepper_Reset(ivars->tinfo_stepper);
         return false;
@@ -212,4 +248,131 @@ S_scan_to(SegLexicon *self, Obj *target) {
     } while (SegLex_Next(self));
 }
 
+bool
+SegLex_Seek_Exact_IMP(SegLexicon *self, Obj *target) {
+    SegLexiconIVARS *const ivars = SegLex_IVARS(self);
+
+    if (target == NULL) {
+        SegLex_Reset(self);
+        return false;
+    }
+
+    if (ivars->fst) {
+        // Terms which aren't in the segment are ruled out without I/O.
+        String *term = (String*)CERTIFY(target, STRING);
+        int64_t term_num = FST_Get(ivars->fst, Str_Get_Ptr8(term),
+                                   Str_Get_Size(term));
+        if (term_num < 0) { return false; }
+        ivars->limit = ivars->size;
+        S_seek_to_num(self, (int32_t)term_num);
+        return true;
+    }
+
+    SegLex_Seek(self, target);
+    Obj *found = SegLex_Get_Term(self);
+    return found != NULL && Obj_Equals(target, found);
+}
+
+void
+SegLex_Seek_Range_IMP(SegLexicon *self, String *lower_term,
+                      String *upper_term, bool include_lower,
+                      bool include_upper) {
+    SegLexiconIVARS *const ivars = SegLex_IVARS(self);
+    int32_t start = lower_term
+                    ? S_term_bound(self, lower_term, !include_lower)
+                    : 0;
+    int32_t end   = upper_term
+                    ? S_term_bound(self, upper_term, include_upper)
+                    : ivars->size;
+    ivars->limit = end > start ? end : start;
+    S_seek_to_num(self, start);
+}
+
+void
+SegLex_Seek_Prefix_IMP(SegLexicon *self, String *prefix) {
+    SegLexiconIVARS *const ivars = SegLex_IVARS(self);
+    const char *ptr  = Str_Get_Ptr8(prefix);
+    size_t      size = Str_Get_Size(prefix);
+    int32_t     start = S_term_bound(self, prefix, false);
+    int32_t     end   = ivars->size;
+
+    if (ivars->fst) {
+        // The first term past the prefix is the ceiling of the prefix with
+        // its last byte bumped up.
+        while (size && (uint8_t)ptr[size - 1] == 0xFF) { size--; }
+        if (size) {
+            char  stack_buf[64];
+            char *buf = size <= sizeof(stack_buf)
+                        ? stack_buf
+                        : (char*)MALLOCATE(size);
+            memcpy(buf, ptr, size);
+            buf[size - 1] = (char)((uint8_t)buf[size - 1] + 1);
+            int64_t num = FST_Ceil(ivars->fst, buf, size);
+            if (buf != stack_buf) { FREEMEM(buf); }
+            if (num >= 0) { end = (int32_t)num; }
+        }
+    }
+    else {
+        // Count the matching terms the slow way, starting from where
+        // S_term_bound() left us.
+        end = start;
+        do {
+            String *term = (String*)SegLex_Get_Term(self);
+            if (!term || !Str_Starts_With(term, prefix)) { break; }
+            end++;
+        } while (SegLex_Next(self));
+    }
+
+    ivars->limit = end;
+    S_seek_to_num(self, start);
+}
+
+static int32_t
+S_term_bound(SegLexicon *self, String *term, bool inclusive) {
+    SegLexiconIVARS *const ivars = SegLex_IVARS(self);
+    CERTIFY(term, STRING);
+
+    if (ivars->fst) {
+        const char *ptr  = Str_Get_Ptr8(term);
+        size_t      size = Str_Get_Size(term);
+        int64_t num = FST_Ceil(ivars->fst, ptr, size);
+        if (num < 0) { return ivars->size; }
+        if (inclusive && FST_Get(ivars->fst, ptr, size) == num) { num++; }
+        return (int32_t)num;
+    }
+
+    SegLex_Seek(self, (Obj*)term);
+    int32_t num   = ivars->term_num;
+    Obj    *found = SegLex_Get_Term(self);
+    if (inclusive && found && Obj_Equals((Obj*)term, found)) { num++; }
+    return num;
+}
+
+static void
+S_seek_to_num(SegLexicon *self, int32_t term_num) {
+    SegLexiconIVARS *const ivars = SegLex_IVARS(self);
+    TermStepper *const term_stepper  = ivars->term_stepper;
+    TermStepper *const tinfo_stepper = ivars->tinfo_stepper;
+    InStream    *const instream      = ivars->instream;
+
+    if (term_num >= ivars->limit) {
+        ivars->term_num = ivars->limit;
+        TermStepper_Reset(term_stepper);
+        TermStepper_Reset(tinfo_stepper);
+        return;
+    }
+
+    // The key frame for tick N holds term number N * index_interval - 1.
+    int32_t   tick  = term_num / ivars->index_interval;
+    TermInfo *tinfo = (TermInfo*)TermStepper_Get_Value(tinfo_stepper);
+    LexIndex_Read_Tick(ivars->lex_index, tick, term_stepper, tinfo);
+    InStream_Seek(instream, TInfo_Get_Lex_FilePos(tinfo));
+    ivars->term_num = tick * ivars->index_interval - 1;
+
+    while (ivars->term_num < term_num) {
+        TermStepper_Read_Delta(term_stepper, instream);
+        TermStepper_Read_Delta(tinfo_stepper, instream);
+        ivars->term_num++;
+    }
+}
 
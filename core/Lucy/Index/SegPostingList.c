@@ -16,7 +16,6 @@
 
 #define C_LUCY_SEGPOSTINGLIST
 #define C_LUCY_POSTING
-#define C_LUCY_SKIPSTEPPER
 #include "Lucy/Util/ToolSet.h"
 
 #include "Lucy/Index/SegPostingList.h"
@@ -24,7 +23,7 @@
 #include "Lucy/Index/Posting/RawPosting.h"
 #include "Lucy/Index/PostingListReader.h"
 #include "Lucy/Index/Segment.h"
-#include "Lucy/Index/SkipStepper.h"
+#include "Lucy/Index/SkipListReader.h"
 #include "Lucy/Index/TermInfo.h"
 #include "Lucy/Index/SegLexicon.h"
 #include "Lucy/Index/LexiconReader.h"
@@ -65,16 +64,13 @@ SegPList_init(SegPostingList *self, PostingListReader *plist_reader,
     // Init.
     ivars->doc_freq        = 0;
     ivars->count           = 0;
-
-    // Init skipping vars.
-    ivars->skip_stepper    = SkipStepper_new();
-    ivars->skip_count      = 0;
-    ivars->num_skips       = 0;
+    ivars->post_filepos    = 0;
 
     // Assign.
     ivars->plist_reader    = (PostingListReader*)INCREF(plist_reader);
     ivars->field           = Str_Clone(field);
     ivars->skip_interval   = Arch_Skip_Interval(arch);
+    ivars->skip_reader     = SkipReader_new(arch);
 
     // Derive.
     Similarity *sim  = Schema_Fetch_Sim(schema, field);
@@ -116,7 +112,7 @@ SegPList_Destroy_IMP(SegPostingList *self) {
     SegPostingListIVARS *const ivars = SegPList_IVARS(self);
     DECREF(ivars->plist_reader);
     DECREF(ivars->posting);
-    DECREF(ivars->skip_stepper);
+    DECREF(ivars->skip_reader);
     DECREF(ivars->field);
 
     if (ivars->post_stream != NULL) {
@@ -177,59 +173,29 @@ int32_t
 SegPList_Advance_IMP(SegPostingList *self, int32_t target) {
     SegPostingListIVARS *const ivars = SegPList_IVARS(self);
     PostingIVARS *const posting_ivars = Post_IVARS(ivars->posting);
-    const int32_t skip_interval = ivars->skip_interval;
-
-    if ((int32_t)ivars->doc_freq >= skip_interval) {
-        InStream *post_stream           = ivars->post_stream;
-        InStream *skip_stream           = ivars->skip_stream;
-        SkipStepper *const skip_stepper = ivars->skip_stepper;
-        SkipStepperIVARS *const skip_stepper_ivars
-            = SkipStepper_IVARS(skip_stepper);
-        int32_t new_doc_id              = skip_stepper_ivars->doc_id;
-        int64_t new_filepos             = InStream_Tell(post_stream);
-
-        /* Assuming the default skip_interval of 16...
-         *
-         * Say we're currently on the 5th doc matching this term, and we get a
-         * request to skip to the 18th doc matching it.  We won't have skipped
-         * yet, but we'll have already gone past 5 of the 16 skip docs --
-         * ergo, the modulus in the following formula.
-         */
-        int32_t num_skipped = 0 - ((int32_t)ivars->count % skip_interval);
-        if (num_skipped == 0 && ivars->count != 0) {
-            num_skipped = 0 - skip_interval;
-        }
-
-        // See if there's anything to skip.
-        while (target > skip_stepper_ivars->doc_id) {
-            new_doc_id  = skip_stepper_ivars->doc_id;
-            new_filepos = skip_stepper_ivars->filepos;
 
-            if (skip_stepper_ivars->doc_id != 0
-                && skip_stepper_ivars->doc_id >= posting_ivars->doc_id
-               ) {
-                num_skipped += skip_interval;
-            }
-
-            if (ivars->skip_count >= ivars->num_skips) {
-                break;
-            }
-
-            SkipStepper_Read_Record(skip_stepper, skip_stream);
-            ivars->skip_count++;
-        }
+    if ((int32_t)ivars->doc_freq >= ivars->skip_interval) {
+        SkipListReader *const skip_reader = ivars->skip_reader;
+        SkipReader_Skip_To(skip_reader, target);
 
-        // If we found something to skip, skip it.
-        if (new_filepos > InStream_Tell(post_stream)) {
+        // The skip reader may already be past the target if
+        // Shallow_Advance() was called with a later one, in which case we
+        // just scan.
+        int32_t  skip_doc_id = SkipReader_Get_Doc_ID(skip_reader);
+        uint32_t skip_count  = SkipReader_Get_Count(skip_reader);
+        if (skip_count > ivars->count && skip_doc_id < target) {
 
             // Move the postings filepointer up.
-            InStream_Seek(post_stream, new_filepos);
+            InStream_Seek(ivars->post_stream,
+                          SkipReader_Get_Filepos(skip_reader));
 
-            // Jump to the new doc id.
-            posting_ivars->doc_id = new_doc_id;
+            // Jump to the new doc id, discarding any state the Posting has
+            // buffered from the records we just skipped over.
+            Post_Reset(ivars->posting);
+            posting_ivars->doc_id = skip_doc_id;
 
-            // Increase count by the number of docs we skipped over.
-            ivars->count += (uint32_t)num_skipped;
+            // The count now reflects the docs we skipped over.
+            ivars->count = skip_count;
         }
     }
 
@@ -242,6 +208,26 @@ SegPList_Advance_IMP(SegPostingList *self, int32_t target) {
     }
 }
 
+int32_t
+SegPList_Shallow_Advance_IMP(SegPostingList *self, int32_t target) {
+    SegPostingListIVARS *const ivars = SegPList_IVARS(self);
+    if ((int32_t)ivars->doc_freq < ivars->skip_interval) {
+        return INT32_MAX;
+    }
+    SkipReader_Skip_To(ivars->skip_reader, target);
+    return SkipReader_Get_Block_End(ivars->skip_reader);
+}
+
+float
+SegPList_Block_Max_Impact_IMP(SegPostingList *self) {
+    return SkipReader_Get_Block_Max(SegPList_IVARS(self)->skip_reader);
+}
+
+float
+SegPList_Max_Impact_IMP(SegPostingList *self) {
+    return SkipReader_Get_Max_Impact(SegPList_IVARS(self)->skip_reader);
+}
+
 void
 SegPList_Seek_IMP(SegPostingList *self, Obj *target) {
     SegPostingListIVARS *const ivars = SegPList_IVARS(self);
@@ -287,19 +273,34 @@ S_seek_tinfo(SegPostingList *self, TermInfo *tinfo) {
         // Transfer doc_freq, seek main stream.
         int64_t post_filepos = TInfo_Get_Post_FilePos(tinfo);
         ivars->doc_freq      = (uint32_t)TInfo_Get_Doc_Freq(tinfo);
+        ivars->post_filepos  = post_filepos;
         InStream_Seek(ivars->post_stream, post_filepos);
 
         // Prepare posting.
         Post_Reset(ivars->posting);
 
         // Prepare to skip.
-        ivars->skip_count = 0;
-        ivars->num_skips  = ivars->doc_freq / (uint32_t)ivars->skip_interval;
-        SkipStepper_Set_ID_And_Filepos(ivars->skip_stepper, 0, post_filepos);
-        InStream_Seek(ivars->skip_stream, TInfo_Get_Skip_FilePos(tinfo));
+        SkipReader_Init_Term(ivars->skip_reader, ivars->skip_stream,
+                             TInfo_Get_Skip_FilePos(tinfo), ivars->doc_freq,
+                             post_filepos);
     }
 }
 
+InStream*
+SegPList_Impact_Stream_IMP(SegPostingList *self) {
+    SegPostingListIVARS *const ivars = SegPList_IVARS(self);
+
+    // Short lists don't get an impact-ordered copy.
+    if ((int32_t)ivars->doc_freq < ivars->skip_interval) { return NULL; }
+    if (!Obj_is_a((Obj*)ivars->plist_reader, DEFAULTPOSTINGLISTREADER)) {
+        return NULL;
+    }
+
+    return DefPListReader_Impact_Stream(
+               (DefaultPostingListReader*)ivars->plist_reader,
+               ivars->field_num, ivars->post_filepos);
+}
+
 Matcher*
 SegPList_Make_Matcher_IMP(SegPostingList *self, Similarity *sim,
                           Compiler *compiler, bool need_score) {
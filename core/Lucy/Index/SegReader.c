@@ -17,6 +17,7 @@
 #define C_LUCY_SEGREADER
 #include "Lucy/Util/ToolSet.h"
 
+#include "Clownfish/HashIterator.h"
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Index/DeletionsReader.h"
 #include "Lucy/Index/DocReader.h"
@@ -26,6 +27,7 @@
 #include "Lucy/Plan/Architecture.h"
 #include "Lucy/Plan/FieldType.h"
 #include "Lucy/Plan/Schema.h"
+#include "Lucy/Search/FilterCache.h"
 #include "Lucy/Search/Matcher.h"
 #include "Lucy/Store/Folder.h"
 
@@ -33,6 +35,10 @@
 static void
 S_try_init_components(void *context);
 
+// Try to initialize only the DeletionsReader.
+static void
+S_try_register_deletions(void *context);
+
 SegReader*
 SegReader_new(Schema *schema, Folder *folder, Snapshot *snapshot,
               Vector *segments, int32_t seg_tick) {
@@ -53,6 +59,7 @@ SegReader_init(SegReader *self, Schema *schema, Folder *folder,
     ivars->doc_max    = (int32_t)Seg_Get_Count(segment);
     ivars->seg_name   = (String*)INCREF(Seg_Get_Name(segment));
     ivars->seg_num    = Seg_Get_Number(segment);
+    ivars->filter_cache = NULL;
     Err *error = Err_trap(S_try_init_components, self);
     if (error) {
         // An error occurred, so clean up self and rethrow the exception.
@@ -76,10 +83,70 @@ S_try_init_components(void *context) {
     Arch_Init_Seg_Reader(arch, self);
 }
 
+SegReader*
+SegReader_Reopen_IMP(SegReader *self, Snapshot *snapshot, Vector *segments,
+                     int32_t seg_tick) {
+    SegReaderIVARS *const ivars = SegReader_IVARS(self);
+    Schema    *schema  = SegReader_Get_Schema(self);
+    String    *del_api = Class_Get_Name(DELETIONSREADER);
+    SegReader *twin    = (SegReader*)Class_Make_Obj(SEGREADER);
+
+    IxReader_init((IndexReader*)twin, schema, SegReader_Get_Folder(self),
+                  snapshot, segments, seg_tick, NULL);
+    SegReaderIVARS *const twin_ivars = SegReader_IVARS(twin);
+    Segment *segment = SegReader_Get_Segment(twin);
+    if (!Str_Equals(Seg_Get_Name(segment), (Obj*)ivars->seg_name)) {
+        DECREF(twin);
+        THROW(ERR, "Can't reopen %o as %o", ivars->seg_name,
+              Seg_Get_Name(segment));
+    }
+    twin_ivars->doc_max      = ivars->doc_max;
+    twin_ivars->seg_name     = (String*)INCREF(ivars->seg_name);
+    twin_ivars->seg_num      = ivars->seg_num;
+    twin_ivars->filter_cache
+        = (FilterCache*)INCREF(SegReader_Get_Filter_Cache(self));
+
+    // Share everything but the deletions.
+    HashIterator *iter = HashIter_new(ivars->components);
+    while (HashIter_Next(iter)) {
+        String *api = HashIter_Get_Key(iter);
+        if (!Str_Equals(api, (Obj*)del_api)) {
+            Obj *component = HashIter_Get_Value(iter);
+            if (Obj_is_a(component, DATAREADER)) {
+                DataReader_Share((DataReader*)component);
+            }
+            Hash_Store(twin_ivars->components, api, INCREF(component));
+        }
+    }
+    DECREF(iter);
+    Err *error = Err_trap(S_try_register_deletions, twin);
+    if (error) {
+        // Hand the shared components back.
+        SegReader_Close(twin);
+        DECREF(twin);
+        RETHROW(error);
+    }
+
+    DeletionsReader *del_reader
+        = (DeletionsReader*)Hash_Fetch(twin_ivars->components, del_api);
+    twin_ivars->del_count = del_reader ? DelReader_Del_Count(del_reader) : 0;
+
+    return twin;
+}
+
+static void
+S_try_register_deletions(void *context) {
+    SegReader *self = (SegReader*)context;
+    Schema *schema = SegReader_Get_Schema(self);
+    Architecture *arch = Schema_Get_Architecture(schema);
+    Arch_Register_Deletions_Reader(arch, self);
+}
+
 void
 SegReader_Destroy_IMP(SegReader *self) {
     SegReaderIVARS *const ivars = SegReader_IVARS(self);
     DECREF(ivars->seg_name);
+    DECREF(ivars->filter_cache);
     SUPER_DESTROY(self, SEGREADER);
 }
 
@@ -134,4 +201,14 @@ SegReader_Seg_Readers_IMP(SegReader *self) {
     return seg_readers;
 }
 
+FilterCache*
+SegReader_Get_Filter_Cache_IMP(SegReader *self) {
+    SegReaderIVARS *const ivars = SegReader_IVARS(self);
+    if (!ivars->filter_cache) {
+        Schema       *schema = SegReader_Get_Schema(self);
+        Architecture *arch   = Schema_Get_Architecture(schema);
+        ivars->filter_cache = FilterCache_new(Arch_Filter_Cache_Budget(arch));
+    }
+    return ivars->filter_cache;
+}
 
@@ -18,7 +18,10 @@
 #include "Lucy/Util/ToolSet.h"
 
 #include "Lucy/Index/SegWriter.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/Util/SortUtils.h"
 #include "Lucy/Document/Doc.h"
+#include "Lucy/Plan/FieldType.h"
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Store/DirHandle.h"
 #include "Lucy/Store/Folder.h"
@@ -28,7 +31,15 @@
 #include "Lucy/Index/Segment.h"
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Index/Snapshot.h"
+#include "Lucy/Index/SortCache.h"
+#include "Lucy/Index/SortReader.h"
 #include "Lucy/Plan/Architecture.h"
+#include "Lucy/Search/SortRule.h"
+#include "Lucy/Search/SortSpec.h"
+
+// Rewrite the finished segment so that its doc ids follow the index sort.
+static void
+S_sort_segment(SegWriter *self);
 
 SegWriter*
 SegWriter_new(Schema *schema, Snapshot *snapshot, Segment *segment,
@@ -46,6 +57,8 @@ SegWriter_init(SegWriter *self, Schema *schema, Snapshot *snapshot,
     ivars->by_api   = Hash_new(0);
     ivars->inverter = Inverter_new(schema, segment);
     ivars->writers  = Vec_new(16);
+    ivars->index_sort   = NULL;
+    ivars->sort_doc_map = NULL;
     Arch_Init_Seg_Writer(arch, self);
     return self;
 }
@@ -57,6 +70,8 @@ SegWriter_Destroy_IMP(SegWriter *self) {
     DECREF(ivars->writers);
     DECREF(ivars->by_api);
     DECREF(ivars->del_writer);
+    DECREF(ivars->index_sort);
+    DECREF(ivars->sort_doc_map);
     SUPER_DESTROY(self, SEGWRITER);
 }
 
@@ -191,6 +206,24 @@ SegWriter_Delete_Segment_IMP(SegWriter *self, SegReader *reader) {
     Snapshot_Delete_Entry(snapshot, seg_name);
 }
 
+static Vector*
+S_index_sort_metadata(SortSpec *sort_spec) {
+    Vector *rules    = SortSpec_Get_Rules(sort_spec);
+    Vector *metadata = Vec_new(Vec_Get_Size(rules));
+    for (size_t i = 0, max = Vec_Get_Size(rules); i < max; i++) {
+        SortRule *rule  = (SortRule*)Vec_Fetch(rules, i);
+        Hash     *entry = Hash_new(2);
+        Hash_Store_Utf8(entry, "field", 5,
+                        (Obj*)Str_Clone(SortRule_Get_Field(rule)));
+        Hash_Store_Utf8(entry, "reverse", 7,
+                        (Obj*)(SortRule_Get_Reverse(rule)
+                               ? CFISH_TRUE
+                               : CFISH_FALSE));
+        Vec_Push(metadata, (Obj*)entry);
+    }
+    return metadata;
+}
+
 void
 SegWriter_Finish_IMP(SegWriter *self) {
     SegWriterIVARS *const ivars = SegWriter_IVARS(self);
@@ -202,6 +235,17 @@ SegWriter_Finish_IMP(SegWriter *self) {
         DataWriter_Finish(writer);
     }
 
+    // Put the docs in index sort order and say so, so that searches sorted
+    // the same way know that they may stop early.
+    if (ivars->index_sort) {
+        if (Seg_Get_Count(ivars->segment) > 1) {
+            S_sort_segment(self);
+        }
+        Vector *metadata = S_index_sort_metadata(ivars->index_sort);
+        Seg_Store_Metadata_Utf8(ivars->segment, "index_sort", 10,
+                                (Obj*)metadata);
+    }
+
     // Write segment metadata and add the segment directory to the snapshot.
     Snapshot *snapshot = SegWriter_Get_Snapshot(self);
     String *segmeta_filename = Str_newf("%o/segmeta.json", seg_name);
@@ -232,4 +276,246 @@ SegWriter_Get_Del_Writer_IMP(SegWriter *self) {
     return SegWriter_IVARS(self)->del_writer;
 }
 
+void
+SegWriter_Set_Index_Sort_IMP(SegWriter *self, SortSpec *sort_spec) {
+    SegWriterIVARS *const ivars = SegWriter_IVARS(self);
+    if (sort_spec) {
+        Vector *rules = SortSpec_Get_Rules(sort_spec);
+        if (!Vec_Get_Size(rules)) {
+            THROW(ERR, "Can't sort an index by a SortSpec with no SortRules");
+        }
+        for (size_t i = 0, max = Vec_Get_Size(rules); i < max; i++) {
+            SortRule *rule = (SortRule*)Vec_Fetch(rules, i);
+            if (SortRule_Get_Type(rule) != SortRule_FIELD) {
+                THROW(ERR, "Indexes can only be sorted by field");
+            }
+            String    *field = SortRule_Get_Field(rule);
+            FieldType *type  = Schema_Fetch_Type(ivars->schema, field);
+            if (!type || !FType_Sortable(type)) {
+                THROW(ERR, "'%o' isn't a sortable field", field);
+            }
+        }
+    }
+    SortSpec *temp = ivars->index_sort;
+    ivars->index_sort = (SortSpec*)INCREF(sort_spec);
+    DECREF(temp);
+}
+
+SortSpec*
+SegWriter_Get_Index_Sort_IMP(SegWriter *self) {
+    return SegWriter_IVARS(self)->index_sort;
+}
+
+I32Array*
+SegWriter_Get_Sort_Doc_Map_IMP(SegWriter *self) {
+    return SegWriter_IVARS(self)->sort_doc_map;
+}
+
+typedef struct {
+    SortCache **caches;
+    bool       *reverse;
+    uint32_t    num_rules;
+} S_IndexSortContext;
+
+static int
+S_compare_docs(void *context, const void *va, const void *vb) {
+    S_IndexSortContext *sort_context = (S_IndexSortContext*)context;
+    const int32_t a = *(const int32_t*)va;
+    const int32_t b = *(const int32_t*)vb;
+    for (uint32_t i = 0; i < sort_context->num_rules; i++) {
+        SortCache *cache = sort_context->caches[i];
+        if (!cache) { continue; } // No doc has a value.
+        int32_t a_ord = SortCache_Ordinal(cache, a);
+        int32_t b_ord = SortCache_Ordinal(cache, b);
+        if (a_ord != b_ord) {
+            int comparison = a_ord < b_ord ? -1 : 1;
+            return sort_context->reverse[i] ? -comparison : comparison;
+        }
+    }
+    return 0;
+}
+
+// Map each doc in `reader` to its position in index sort order.  Ordinals
+// are compared exactly as SortCollector compares them, and the sort is
+// stable, so ties keep the order in which the docs were added.
+static I32Array*
+S_sorted_doc_map(SortSpec *index_sort, SegReader *reader) {
+    Vector  *rules     = SortSpec_Get_Rules(index_sort);
+    uint32_t num_rules = (uint32_t)Vec_Get_Size(rules);
+    int32_t  doc_max   = SegReader_Doc_Max(reader);
+    SortReader *sort_reader
+        = (SortReader*)SegReader_Fetch(reader, Class_Get_Name(SORTREADER));
+
+    S_IndexSortContext context;
+    context.caches    = (SortCache**)CALLOCATE(num_rules, sizeof(SortCache*));
+    context.reverse   = (bool*)CALLOCATE(num_rules, sizeof(bool));
+    context.num_rules = num_rules;
+    for (uint32_t i = 0; i < num_rules; i++) {
+        SortRule *rule = (SortRule*)Vec_Fetch(rules, i);
+        context.caches[i] = sort_reader
+                            ? SortReader_Fetch_Sort_Cache(
+                                  sort_reader, SortRule_Get_Field(rule))
+                            : NULL;
+        context.reverse[i] = !!SortRule_Get_Reverse(rule);
+    }
+
+    int32_t *doc_ids = (int32_t*)MALLOCATE((size_t)doc_max * sizeof(int32_t));
+    int32_t *scratch = (int32_t*)MALLOCATE((size_t)doc_max * sizeof(int32_t));
+    for (int32_t i = 0; i < doc_max; i++) { doc_ids[i] = i + 1; }
+    Sort_mergesort(doc_ids, scratch, (uint32_t)doc_max, sizeof(int32_t),
+                   S_compare_docs, &context);
+
+    int32_t *doc_map
+        = (int32_t*)CALLOCATE((size_t)doc_max + 1, sizeof(int32_t));
+    for (int32_t i = 0; i < doc_max; i++) { doc_map[doc_ids[i]] = i + 1; }
+
+    FREEMEM(scratch);
+    FREEMEM(doc_ids);
+    FREEMEM(context.reverse);
+    FREEMEM(context.caches);
+    return I32Arr_new_steal(doc_map, (size_t)doc_max + 1);
+}
+
+struct sort_segment_context {
+    SegWriter  *self;
+    String     *moved;
+    Vector     *segments;
+    SegReader  *reader;
+    I32Array   *doc_map;
+    Segment    *sorted;
+    PolyReader *polyreader;
+    SegWriter  *writer;
+};
+
+// Move the unsorted files aside, read them back, and write the sorted copy.
+// Everything allocated goes in the context so that the caller can clean up
+// whether or not this succeeds.
+static void
+S_rewrite_sorted(void *context) {
+    struct sort_segment_context *args
+        = (struct sort_segment_context*)context;
+    SegWriterIVARS *const ivars = SegWriter_IVARS(args->self);
+    Folder  *folder   = ivars->folder;
+    Segment *segment  = ivars->segment;
+    String  *seg_name = Seg_Get_Name(segment);
+
+    Vector *entries = Folder_List(folder, seg_name);
+    if (!entries || !Folder_MkDir(folder, args->moved)) {
+        DECREF(entries);
+        RETHROW(INCREF(Err_get_error()));
+    }
+    for (size_t i = 0, max = Vec_Get_Size(entries); i < max; i++) {
+        String *entry = (String*)Vec_Fetch(entries, i);
+        String *from  = Str_newf("%o/%o", seg_name, entry);
+        String *to    = Str_newf("%o/%o", args->moved, entry);
+        bool    moved = Str_Equals_Utf8(entry, "unsorted", 8)
+                        || Folder_Rename(folder, from, to);
+        DECREF(to);
+        DECREF(from);
+        if (!moved) {
+            DECREF(entries);
+            RETHROW(INCREF(Err_get_error()));
+        }
+    }
+    DECREF(entries);
+
+    // Read the unsorted segment back.  The Segment object still holds the
+    // metadata which its DataWriters stored.
+    String *staging = Str_newf("%o/unsorted", seg_name);
+    Folder *staging_folder = Folder_Find_Folder(folder, staging);
+    DECREF(staging);
+    if (!staging_folder) {
+        THROW(ERR, "Can't open '%o/unsorted'", seg_name);
+    }
+    args->segments = Vec_new(1);
+    Vec_Push(args->segments, INCREF(segment));
+    args->reader = SegReader_new(ivars->schema, staging_folder, NULL,
+                                 args->segments, 0);
+    args->doc_map = S_sorted_doc_map(ivars->index_sort, args->reader);
+
+    // Write the sorted copy under the original name, numbering the fields
+    // the same way.
+    args->sorted = Seg_new(Seg_Get_Number(segment));
+    for (int32_t i = 1; Seg_Field_Name(segment, i) != NULL; i++) {
+        Seg_Add_Field(args->sorted, Seg_Field_Name(segment, i));
+    }
+    args->polyreader
+        = PolyReader_new(ivars->schema, folder, NULL, NULL, NULL);
+    args->writer = SegWriter_new(ivars->schema, ivars->snapshot, args->sorted,
+                                 args->polyreader);
+    SegWriterIVARS *const writer_ivars = SegWriter_IVARS(args->writer);
+    SegWriter_Add_Segment(args->writer, args->reader, args->doc_map);
+    for (size_t i = 0, max = Vec_Get_Size(writer_ivars->writers);
+         i < max; i++
+        ) {
+        DataWriter *data_writer
+            = (DataWriter*)Vec_Fetch(writer_ivars->writers, i);
+        DataWriter_Finish(data_writer);
+    }
+
+    // Adopt the metadata which describes the sorted files, replacing what
+    // was stored for the unsorted ones.
+    Hash *metadata = Seg_Get_Metadata(segment);
+    HashIterator *iter = HashIter_new(Seg_Get_Metadata(args->sorted));
+    while (HashIter_Next(iter)) {
+        Hash_Store(metadata, HashIter_Get_Key(iter),
+                   INCREF(HashIter_Get_Value(iter)));
+    }
+    DECREF(iter);
+}
+
+// The DataWriters only know how to write a segment under its own name, and
+// the sort order isn't known until every doc is in.  So move the finished
+// segment's files into `seg_N/unsorted/seg_N`, read them back, and add them
+// to a fresh SegWriter along with a doc map which sorts them.  Keeping the
+// staging area inside the segment directory means that if anything goes
+// wrong, whatever is left behind goes away along with the segment.
+static void
+S_sort_segment(SegWriter *self) {
+    SegWriterIVARS *const ivars = SegWriter_IVARS(self);
+    Folder *folder   = ivars->folder;
+    String *seg_name = Seg_Get_Name(ivars->segment);
+    String *staging  = Str_newf("%o/unsorted", seg_name);
+
+    struct sort_segment_context context;
+    context.self       = self;
+    context.moved      = Str_newf("%o/%o", staging, seg_name);
+    context.segments   = NULL;
+    context.reader     = NULL;
+    context.doc_map    = NULL;
+    context.sorted     = NULL;
+    context.polyreader = NULL;
+    context.writer     = NULL;
+
+    Err *error = NULL;
+    if (!Folder_MkDir(folder, staging)) {
+        error = (Err*)INCREF(Err_get_error());
+    }
+    else {
+        error = Err_trap(S_rewrite_sorted, &context);
+    }
+    if (!error) {
+        DECREF(ivars->sort_doc_map);
+        ivars->sort_doc_map = (I32Array*)INCREF(context.doc_map);
+    }
+
+    if (context.reader) { SegReader_Close(context.reader); }
+    DECREF(context.reader);
+    DECREF(context.writer);
+    DECREF(context.polyreader);
+    DECREF(context.sorted);
+    DECREF(context.doc_map);
+    DECREF(context.segments);
+    DECREF(context.moved);
+
+    if (Folder_Exists(folder, staging)
+        && !Folder_Delete_Tree(folder, staging)
+        && !error
+       ) {
+        error = Err_new(Str_newf("Couldn't completely remove '%o'",
+                                 staging));
+    }
+    DECREF(staging);
+    if (error) { RETHROW(error); }
+}
 
@@ -149,6 +149,12 @@ Sim_TF_IMP(Similarity *self, float freq) {
     return (float)sqrt(freq);
 }
 
+float
+Sim_Impact_Bound_IMP(Similarity *self, float impact) {
+    UNUSED_VAR(self);
+    return impact;
+}
+
 uint8_t
 Sim_Encode_Norm_IMP(Similarity *self, float f) {
     uint32_t norm;
@@ -0,0 +1,279 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_SKIPLISTREADER
+#include <float.h>
+
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Index/SkipListReader.h"
+#include "Lucy/Index/SkipListWriter.h"
+#include "Lucy/Plan/Architecture.h"
+#include "Lucy/Store/InStream.h"
+
+// Read the skip data header and prime every level.
+static void
+S_load(SkipListReaderIVARS *ivars);
+
+// Decode the next entry on `level`, using the supplied values as the base for
+// its deltas.
+static void
+S_read_next(SkipListReaderIVARS *ivars, int32_t level, int32_t base_doc_id,
+            int64_t base_filepos);
+
+// Pass the next entry on `level`, moving the level below up to match.
+static void
+S_consume(SkipListReaderIVARS *ivars, int32_t level);
+
+SkipListReader*
+SkipReader_new(Architecture *arch) {
+    SkipListReader *self = (SkipListReader*)Class_Make_Obj(SKIPLISTREADER);
+    return SkipReader_init(self, arch);
+}
+
+SkipListReader*
+SkipReader_init(SkipListReader *self, Architecture *arch) {
+    SkipListReaderIVARS *const ivars = SkipReader_IVARS(self);
+
+    // Assign.
+    ivars->skip_interval   = Arch_Skip_Interval(arch);
+    ivars->skip_multiplier = Arch_Skip_Multiplier(arch);
+
+    // Init.
+    const size_t max = SKIP_MAX_LEVELS;
+    ivars->instream       = NULL;
+    ivars->starts         = (int64_t*)MALLOCATE(max * sizeof(int64_t));
+    ivars->positions      = (int64_t*)MALLOCATE(max * sizeof(int64_t));
+    ivars->num_entries    = (uint32_t*)MALLOCATE(max * sizeof(uint32_t));
+    ivars->consumed       = (uint32_t*)MALLOCATE(max * sizeof(uint32_t));
+    ivars->next_doc_ids   = (int32_t*)MALLOCATE(max * sizeof(int32_t));
+    ivars->next_fileposes = (int64_t*)MALLOCATE(max * sizeof(int64_t));
+    ivars->next_impacts   = (float*)MALLOCATE(max * sizeof(float));
+    ivars->next_children  = (int64_t*)MALLOCATE(max * sizeof(int64_t));
+    ivars->skip_filepos   = 0;
+    ivars->post_filepos   = 0;
+    ivars->filepos        = 0;
+    ivars->max_impact     = FLT_MAX;
+    ivars->doc_id         = 0;
+    ivars->num_levels     = 0;
+    ivars->doc_freq       = 0;
+    ivars->count          = 0;
+    ivars->loaded         = true;
+
+    return self;
+}
+
+void
+SkipReader_Destroy_IMP(SkipListReader *self) {
+    SkipListReaderIVARS *const ivars = SkipReader_IVARS(self);
+    DECREF(ivars->instream);
+    FREEMEM(ivars->starts);
+    FREEMEM(ivars->positions);
+    FREEMEM(ivars->num_entries);
+    FREEMEM(ivars->consumed);
+    FREEMEM(ivars->next_doc_ids);
+    FREEMEM(ivars->next_fileposes);
+    FREEMEM(ivars->next_impacts);
+    FREEMEM(ivars->next_children);
+    SUPER_DESTROY(self, SKIPLISTREADER);
+}
+
+void
+SkipReader_Init_Term_IMP(SkipListReader *self, InStream *instream,
+                         int64_t skip_filepos, uint32_t doc_freq,
+                         int64_t post_filepos) {
+    SkipListReaderIVARS *const ivars = SkipReader_IVARS(self);
+    if (instream != ivars->instream) {
+        InStream *old = ivars->instream;
+        ivars->instream = (InStream*)INCREF(instream);
+        DECREF(old);
+    }
+    ivars->skip_filepos = skip_filepos;
+    ivars->post_filepos = post_filepos;
+    ivars->doc_freq     = doc_freq;
+    ivars->doc_id       = 0;
+    ivars->filepos      = post_filepos;
+    ivars->count        = 0;
+    ivars->num_levels   = 0;
+    ivars->max_impact   = FLT_MAX;
+
+    // Terms with fewer docs than the skip interval have no skip data.
+    ivars->loaded = doc_freq < (uint32_t)ivars->skip_interval;
+}
+
+static void
+S_load(SkipListReaderIVARS *ivars) {
+    InStream *const instream   = ivars->instream;
+    int64_t  *const starts     = ivars->starts;
+    const uint32_t  multiplier = (uint32_t)ivars->skip_multiplier;
+
+    ivars->loaded = true;
+    InStream_Seek(instream, ivars->skip_filepos);
+    ivars->max_impact = InStream_Read_F32(instream);
+    ivars->num_levels = (int32_t)InStream_Read_CU32(instream);
+    if (ivars->num_levels < 1 || ivars->num_levels > SKIP_MAX_LEVELS) {
+        THROW(ERR, "Invalid number of skip levels in '%o': %i32",
+              InStream_Get_Filename(instream), ivars->num_levels);
+    }
+
+    // Level sizes are stored from the top down, with the levels following
+    // in the same order.
+    for (int32_t level = ivars->num_levels - 1; level > 0; level--) {
+        starts[level] = (int64_t)InStream_Read_CU64(instream);
+    }
+    int64_t cursor = InStream_Tell(instream);
+    for (int32_t level = ivars->num_levels - 1; level >= 0; level--) {
+        const int64_t size = level > 0 ? starts[level] : 0;
+        starts[level] = cursor;
+        cursor += size;
+    }
+
+    // Prime each level with its first entry.
+    uint32_t num_entries = ivars->doc_freq / (uint32_t)ivars->skip_interval;
+    for (int32_t level = 0; level < ivars->num_levels; level++) {
+        ivars->num_entries[level] = num_entries;
+        ivars->consumed[level]    = 0;
+        ivars->positions[level]   = starts[level];
+        S_read_next(ivars, level, 0, ivars->post_filepos);
+        num_entries /= multiplier;
+    }
+}
+
+static void
+S_read_next(SkipListReaderIVARS *ivars, int32_t level, int32_t base_doc_id,
+            int64_t base_filepos) {
+    InStream *const instream = ivars->instream;
+
+    if (ivars->consumed[level] >= ivars->num_entries[level]) {
+        ivars->next_doc_ids[level] = INT32_MAX;
+        return;
+    }
+
+    InStream_Seek(instream, ivars->positions[level]);
+    ivars->next_doc_ids[level]
+        = base_doc_id + (int32_t)InStream_Read_CU32(instream);
+    ivars->next_fileposes[level]
+        = base_filepos + (int64_t)InStream_Read_CU64(instream);
+    ivars->next_impacts[level] = InStream_Read_F32(instream);
+    if (level > 0) {
+        ivars->next_children[level] = (int64_t)InStream_Read_CU64(instream);
+    }
+    ivars->positions[level] = InStream_Tell(instream);
+}
+
+static void
+S_consume(SkipListReaderIVARS *ivars, int32_t level) {
+    const uint32_t multiplier = (uint32_t)ivars->skip_multiplier;
+    const int32_t  doc_id     = ivars->next_doc_ids[level];
+    const int64_t  filepos    = ivars->next_fileposes[level];
+    const uint32_t passed     = ++ivars->consumed[level];
+
+    // Each entry on this level spans skip_interval * multiplier^level docs.
+    uint32_t span = (uint32_t)ivars->skip_interval;
+    for (int32_t i = 0; i < level; i++) { span *= multiplier; }
+    const uint32_t count = passed * span;
+
+    // A higher level may lag behind a lower one which has already been
+    // scanned further, so only ever move forward.
+    if (count > ivars->count) {
+        ivars->doc_id  = doc_id;
+        ivars->filepos = filepos;
+        ivars->count   = count;
+    }
+
+    // Bring the level below up to the entry we just passed.
+    if (level > 0) {
+        const int32_t  below       = level - 1;
+        const uint32_t children    = passed * multiplier;
+        if (children > ivars->consumed[below]) {
+            ivars->consumed[below]  = children;
+            ivars->positions[below] = ivars->starts[below]
+                                      + ivars->next_children[level];
+            S_read_next(ivars, below, doc_id, filepos);
+        }
+    }
+
+    S_read_next(ivars, level, doc_id, filepos);
+}
+
+void
+SkipReader_Skip_To_IMP(SkipListReader *self, int32_t target) {
+    SkipListReaderIVARS *const ivars = SkipReader_IVARS(self);
+    if (!ivars->loaded) { S_load(ivars); }
+    if (ivars->num_levels == 0) { return; }
+
+    // Climb as high as the target allows, then work back down, passing
+    // every entry which precedes the target on each level.
+    int32_t level = 0;
+    while (level + 1 < ivars->num_levels
+           && ivars->next_doc_ids[level + 1] < target
+          ) {
+        level++;
+    }
+    while (1) {
+        if (ivars->next_doc_ids[level] < target) {
+            S_consume(ivars, level);
+        }
+        else if (level > 0) {
+            level--;
+        }
+        else {
+            break;
+        }
+    }
+}
+
+int32_t
+SkipReader_Get_Doc_ID_IMP(SkipListReader *self) {
+    return SkipReader_IVARS(self)->doc_id;
+}
+
+int64_t
+SkipReader_Get_Filepos_IMP(SkipListReader *self) {
+    return SkipReader_IVARS(self)->filepos;
+}
+
+uint32_t
+SkipReader_Get_Count_IMP(SkipListReader *self) {
+    return SkipReader_IVARS(self)->count;
+}
+
+int32_t
+SkipReader_Get_Block_End_IMP(SkipListReader *self) {
+    SkipListReaderIVARS *const ivars = SkipReader_IVARS(self);
+    if (!ivars->loaded) { S_load(ivars); }
+    if (ivars->num_levels == 0) { return INT32_MAX; }
+    return ivars->next_doc_ids[0];
+}
+
+float
+SkipReader_Get_Block_Max_IMP(SkipListReader *self) {
+    SkipListReaderIVARS *const ivars = SkipReader_IVARS(self);
+    if (!ivars->loaded) { S_load(ivars); }
+    if (ivars->num_levels == 0 || ivars->next_doc_ids[0] == INT32_MAX) {
+        // The final, partial block has no entry of its own.
+        return ivars->max_impact;
+    }
+    return ivars->next_impacts[0];
+}
+
+float
+SkipReader_Get_Max_Impact_IMP(SkipListReader *self) {
+    SkipListReaderIVARS *const ivars = SkipReader_IVARS(self);
+    if (!ivars->loaded) { S_load(ivars); }
+    return ivars->max_impact;
+}
+
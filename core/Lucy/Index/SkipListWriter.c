@@ -0,0 +1,216 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_SKIPLISTWRITER
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Index/SkipListWriter.h"
+#include "Clownfish/ByteBuf.h"
+#include "Lucy/Plan/Architecture.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/NumberUtils.h"
+
+#define MAX_ENTRY_LEN (CU32_MAX_BYTES + CU64_MAX_BYTES * 2 + sizeof(float))
+
+// Append one skip entry to `buf`, encoded as deltas from the previous entry
+// on the same level.  Entries above level 0 also carry a child pointer.
+static void
+S_cat_entry(ByteBuf *buf, uint32_t doc_delta, uint64_t filepos_delta,
+            float impact, bool has_child, int64_t child_offset);
+
+SkipListWriter*
+SkipWriter_new(Architecture *arch) {
+    SkipListWriter *self = (SkipListWriter*)Class_Make_Obj(SKIPLISTWRITER);
+    return SkipWriter_init(self, arch);
+}
+
+SkipListWriter*
+SkipWriter_init(SkipListWriter *self, Architecture *arch) {
+    SkipListWriterIVARS *const ivars = SkipWriter_IVARS(self);
+
+    // Assign.
+    ivars->skip_interval   = Arch_Skip_Interval(arch);
+    ivars->skip_multiplier = Arch_Skip_Multiplier(arch);
+    if (ivars->skip_multiplier < 2) {
+        int32_t multiplier = ivars->skip_multiplier;
+        DECREF(self);
+        THROW(ERR, "Skip_Multiplier must be at least 2: %i32", multiplier);
+    }
+
+    // Init.
+    ivars->level_bufs
+        = (ByteBuf**)MALLOCATE(SKIP_MAX_LEVELS * sizeof(ByteBuf*));
+    for (int32_t i = 0; i < SKIP_MAX_LEVELS; i++) {
+        ivars->level_bufs[i] = BB_new(0);
+    }
+    ivars->cap           = 0;
+    ivars->num_entries   = 0;
+    ivars->doc_ids       = NULL;
+    ivars->fileposes     = NULL;
+    ivars->impacts       = NULL;
+    ivars->child_offsets = NULL;
+    ivars->block_max     = 0.0f;
+    ivars->max_impact    = 0.0f;
+
+    return self;
+}
+
+void
+SkipWriter_Destroy_IMP(SkipListWriter *self) {
+    SkipListWriterIVARS *const ivars = SkipWriter_IVARS(self);
+    if (ivars->level_bufs) {
+        for (int32_t i = 0; i < SKIP_MAX_LEVELS; i++) {
+            DECREF(ivars->level_bufs[i]);
+        }
+        FREEMEM(ivars->level_bufs);
+    }
+    FREEMEM(ivars->doc_ids);
+    FREEMEM(ivars->fileposes);
+    FREEMEM(ivars->impacts);
+    FREEMEM(ivars->child_offsets);
+    SUPER_DESTROY(self, SKIPLISTWRITER);
+}
+
+void
+SkipWriter_Start_Term_IMP(SkipListWriter *self) {
+    SkipListWriterIVARS *const ivars = SkipWriter_IVARS(self);
+    ivars->num_entries = 0;
+    ivars->block_max   = 0.0f;
+    ivars->max_impact  = 0.0f;
+}
+
+void
+SkipWriter_Add_Posting_IMP(SkipListWriter *self, float impact) {
+    SkipListWriterIVARS *const ivars = SkipWriter_IVARS(self);
+    if (impact > ivars->block_max)  { ivars->block_max  = impact; }
+    if (impact > ivars->max_impact) { ivars->max_impact = impact; }
+}
+
+void
+SkipWriter_Add_Entry_IMP(SkipListWriter *self, int32_t doc_id,
+                         int64_t filepos) {
+    SkipListWriterIVARS *const ivars = SkipWriter_IVARS(self);
+    if (ivars->num_entries == ivars->cap) {
+        uint32_t new_cap = ivars->cap ? ivars->cap * 2 : 16;
+        ivars->doc_ids = (int32_t*)REALLOCATE(
+                             ivars->doc_ids, new_cap * sizeof(int32_t));
+        ivars->fileposes = (int64_t*)REALLOCATE(
+                               ivars->fileposes, new_cap * sizeof(int64_t));
+        ivars->impacts = (float*)REALLOCATE(
+                             ivars->impacts, new_cap * sizeof(float));
+        ivars->child_offsets = (int64_t*)REALLOCATE(
+                                   ivars->child_offsets,
+                                   new_cap * sizeof(int64_t));
+        ivars->cap = new_cap;
+    }
+    const uint32_t tick = ivars->num_entries++;
+    ivars->doc_ids[tick]   = doc_id;
+    ivars->fileposes[tick] = filepos;
+    ivars->impacts[tick]   = ivars->block_max;
+    ivars->block_max       = 0.0f;
+}
+
+int64_t
+SkipWriter_Finish_Term_IMP(SkipListWriter *self, OutStream *outstream,
+                           int64_t post_filepos) {
+    SkipListWriterIVARS *const ivars = SkipWriter_IVARS(self);
+    const uint32_t multiplier  = (uint32_t)ivars->skip_multiplier;
+    int32_t   *const doc_ids   = ivars->doc_ids;
+    int64_t   *const fileposes = ivars->fileposes;
+    float     *const impacts   = ivars->impacts;
+    int64_t   *const offsets   = ivars->child_offsets;
+    uint32_t   num_entries     = ivars->num_entries;
+    int32_t    num_levels      = 0;
+
+    if (num_entries == 0) { return -1; }
+
+    // Encode level 0, then build each higher level by folding groups of
+    // `multiplier` entries from the level below into one.  The arrays are
+    // overwritten in place, since entry N on a level is derived only from
+    // entries N and above on the level below it.
+    while (num_entries > 0 && num_levels < SKIP_MAX_LEVELS) {
+        ByteBuf *buf = ivars->level_bufs[num_levels];
+        int32_t  last_doc_id  = 0;
+        int64_t  last_filepos = post_filepos;
+        BB_Set_Size(buf, 0);
+
+        if (num_levels == 0) {
+            for (uint32_t i = 0; i < num_entries; i++) {
+                S_cat_entry(buf, (uint32_t)(doc_ids[i] - last_doc_id),
+                            (uint64_t)(fileposes[i] - last_filepos),
+                            impacts[i], false, 0);
+                offsets[i]   = (int64_t)BB_Get_Size(buf);
+                last_doc_id  = doc_ids[i];
+                last_filepos = fileposes[i];
+            }
+        }
+        else {
+            for (uint32_t i = 0; i < num_entries; i++) {
+                const uint32_t first = i * multiplier;
+                const uint32_t last  = first + multiplier - 1;
+                const int64_t  child = offsets[last];
+                float impact = impacts[first];
+                for (uint32_t j = first + 1; j <= last; j++) {
+                    if (impacts[j] > impact) { impact = impacts[j]; }
+                }
+                doc_ids[i]   = doc_ids[last];
+                fileposes[i] = fileposes[last];
+                impacts[i]   = impact;
+                S_cat_entry(buf, (uint32_t)(doc_ids[i] - last_doc_id),
+                            (uint64_t)(fileposes[i] - last_filepos),
+                            impact, true, child);
+                offsets[i]   = (int64_t)BB_Get_Size(buf);
+                last_doc_id  = doc_ids[i];
+                last_filepos = fileposes[i];
+            }
+        }
+
+        num_levels++;
+        num_entries /= multiplier;
+    }
+
+    // Write a header with the sizes of every level but the lowest, then the
+    // levels themselves from the top down.
+    const int64_t skip_filepos = OutStream_Tell(outstream);
+    OutStream_Write_F32(outstream, ivars->max_impact);
+    OutStream_Write_CU32(outstream, (uint32_t)num_levels);
+    for (int32_t level = num_levels - 1; level > 0; level--) {
+        ByteBuf *buf = ivars->level_bufs[level];
+        OutStream_Write_CU64(outstream, BB_Get_Size(buf));
+    }
+    for (int32_t level = num_levels - 1; level >= 0; level--) {
+        ByteBuf *buf = ivars->level_bufs[level];
+        OutStream_Write_Bytes(outstream, BB_Get_Buf(buf), BB_Get_Size(buf));
+    }
+
+    return skip_filepos;
+}
+
+static void
+S_cat_entry(ByteBuf *buf, uint32_t doc_delta, uint64_t filepos_delta,
+            float impact, bool has_child, int64_t child_offset) {
+    char  scratch[MAX_ENTRY_LEN];
+    char *ptr = scratch;
+    NumUtil_encode_cu32(doc_delta, &ptr);
+    NumUtil_encode_cu64(filepos_delta, &ptr);
+    NumUtil_encode_bigend_f32(impact, ptr);
+    ptr += sizeof(float);
+    if (has_child) {
+        NumUtil_encode_cu64((uint64_t)child_offset, &ptr);
+    }
+    BB_Cat_Bytes(buf, scratch, (size_t)(ptr - scratch));
+}
+
@@ -118,6 +118,16 @@ F64SortCache_Value_IMP(Float64SortCache *self, int32_t ord) {
     }
 }
 
+double
+F64SortCache_Value_To_F64_IMP(Float64SortCache *self, int32_t ord) {
+    Float64SortCacheIVARS *const ivars = F64SortCache_IVARS(self);
+    if (ord < 0 || ord == ivars->null_ord) {
+        THROW(ERR, "No value for ordinal %i32 of %o", ord, ivars->field);
+    }
+    InStream_Seek(ivars->dat_in, ord * (int64_t)sizeof(double));
+    return (double)InStream_Read_F64(ivars->dat_in);
+}
+
 /***************************************************************************/
 
 Float32SortCache*
@@ -156,6 +166,16 @@ F32SortCache_Value_IMP(Float32SortCache *self, int32_t ord) {
     }
 }
 
+double
+F32SortCache_Value_To_F64_IMP(Float32SortCache *self, int32_t ord) {
+    Float32SortCacheIVARS *const ivars = F32SortCache_IVARS(self);
+    if (ord < 0 || ord == ivars->null_ord) {
+        THROW(ERR, "No value for ordinal %i32 of %o", ord, ivars->field);
+    }
+    InStream_Seek(ivars->dat_in, ord * (int64_t)sizeof(float));
+    return (double)InStream_Read_F32(ivars->dat_in);
+}
+
 /***************************************************************************/
 
 Int32SortCache*
@@ -194,6 +214,16 @@ I32SortCache_Value_IMP(Int32SortCache *self, int32_t ord) {
     }
 }
 
+double
+I32SortCache_Value_To_F64_IMP(Int32SortCache *self, int32_t ord) {
+    Int32SortCacheIVARS *const ivars = I32SortCache_IVARS(self);
+    if (ord < 0 || ord == ivars->null_ord) {
+        THROW(ERR, "No value for ordinal %i32 of %o", ord, ivars->field);
+    }
+    InStream_Seek(ivars->dat_in, ord * (int64_t)sizeof(int32_t));
+    return (double)InStream_Read_I32(ivars->dat_in);
+}
+
 /***************************************************************************/
 
 Int64SortCache*
@@ -232,4 +262,14 @@ I64SortCache_Value_IMP(Int64SortCache *self, int32_t ord) {
     }
 }
 
+double
+I64SortCache_Value_To_F64_IMP(Int64SortCache *self, int32_t ord) {
+    Int64SortCacheIVARS *const ivars = I64SortCache_IVARS(self);
+    if (ord < 0 || ord == ivars->null_ord) {
+        THROW(ERR, "No value for ordinal %i32 of %o", ord, ivars->field);
+    }
+    InStream_Seek(ivars->dat_in, ord * (int64_t)sizeof(int64_t));
+    return (double)InStream_Read_I64(ivars->dat_in);
+}
+
 
@@ -19,6 +19,7 @@
 #include "Lucy/Util/ToolSet.h"
 
 #include "Lucy/Index/SortFieldWriter.h"
+#include "Lucy/Index/DeletionsWriter.h"
 #include "Lucy/Index/Inverter.h"
 #include "Lucy/Index/PolyReader.h"
 #include "Lucy/Index/Segment.h"
@@ -364,14 +365,29 @@ S_lazy_init_sorted_ids(SortFieldWriter *self) {
         sum += count;
     }
 
-    // Distribute.
+    // Distribute.  Docs which share an ordinal must come out in the order
+    // of their new doc ids, which may not be their old order if the doc map
+    // sorts the segment.  So place the docs which Refill() skips first, then
+    // the rest by new doc id.
+    I32Array *const doc_map = ivars->doc_map;
     int32_t *sorted_ids
         = (int32_t*)MALLOCATE(((size_t)run_max + 1) * sizeof(int32_t));
     for (int32_t doc_id = 0; doc_id <= run_max; ++doc_id) {
+        if (doc_map && I32Arr_Get(doc_map, (size_t)doc_id)) { continue; }
         int32_t ord = SortCache_Ordinal(sort_cache, doc_id);
         int32_t pos = counts[ord]++;
         sorted_ids[pos] = doc_id;
     }
+    if (doc_map) {
+        I32Array *old_ids = DelWriter_invert_doc_map(doc_map);
+        for (size_t i = 0, max = I32Arr_Get_Size(old_ids); i < max; i++) {
+            int32_t doc_id = I32Arr_Get(old_ids, i);
+            int32_t ord    = SortCache_Ordinal(sort_cache, doc_id);
+            int32_t pos    = counts[ord]++;
+            sorted_ids[pos] = doc_id;
+        }
+        DECREF(old_ids);
+    }
 
     ivars->sorted_ids = sorted_ids;
     FREEMEM(counts);
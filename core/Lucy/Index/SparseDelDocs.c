@@ -0,0 +1,114 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_SPARSEDELDOCS
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Index/SparseDelDocs.h"
+#include "Lucy/Store/Folder.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Util/NumberUtils.h"
+
+SparseDelDocs*
+SparseDelDocs_new(Folder *folder, String *filename) {
+    SparseDelDocs *self = (SparseDelDocs*)Class_Make_Obj(SPARSEDELDOCS);
+    return SparseDelDocs_init(self, folder, filename);
+}
+
+SparseDelDocs*
+SparseDelDocs_init(SparseDelDocs *self, Folder *folder, String *filename) {
+    BitVec_init((BitVector*)self, 0);
+    SparseDelDocsIVARS *const ivars = SparseDelDocs_IVARS(self);
+    ivars->filename = Str_Clone(filename);
+    ivars->instream = Folder_Open_In(folder, filename);
+    if (!ivars->instream) {
+        Err *error = (Err*)INCREF(Err_get_error());
+        DECREF(self);
+        RETHROW(error);
+    }
+    int64_t len = InStream_Length(ivars->instream);
+    if (len % 4 != 0 || len / 4 > INT32_MAX) {
+        Err *error = Err_new(Str_newf("Unexpected deletions file length "
+                                      "for '%o': %i64", filename, len));
+        DECREF(self);
+        RETHROW(error);
+    }
+    ivars->num_doc_ids = (uint32_t)(len / 4);
+    ivars->doc_ids
+        = (const uint8_t*)InStream_Buf(ivars->instream, (size_t)len);
+    return self;
+}
+
+void
+SparseDelDocs_Destroy_IMP(SparseDelDocs *self) {
+    SparseDelDocsIVARS *const ivars = SparseDelDocs_IVARS(self);
+    DECREF(ivars->filename);
+    if (ivars->instream) {
+        InStream_Close(ivars->instream);
+        DECREF(ivars->instream);
+    }
+    ivars->doc_ids = NULL;
+    SUPER_DESTROY(self, SPARSEDELDOCS);
+}
+
+static CFISH_INLINE uint32_t
+SI_doc_id(SparseDelDocsIVARS *ivars, uint32_t tick) {
+    return NumUtil_decode_bigend_u32(ivars->doc_ids + (size_t)tick * 4);
+}
+
+// Return the position of the first doc id not less than `target`.
+static uint32_t
+S_lower_bound(SparseDelDocsIVARS *ivars, size_t target) {
+    uint32_t lo = 0;
+    uint32_t hi = ivars->num_doc_ids;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if ((size_t)SI_doc_id(ivars, mid) < target) { lo = mid + 1; }
+        else                                        { hi = mid; }
+    }
+    return lo;
+}
+
+bool
+SparseDelDocs_Get_IMP(SparseDelDocs *self, size_t tick) {
+    SparseDelDocsIVARS *const ivars = SparseDelDocs_IVARS(self);
+    uint32_t pos = S_lower_bound(ivars, tick);
+    return pos < ivars->num_doc_ids && (size_t)SI_doc_id(ivars, pos) == tick;
+}
+
+int32_t
+SparseDelDocs_Next_Hit_IMP(SparseDelDocs *self, size_t tick) {
+    SparseDelDocsIVARS *const ivars = SparseDelDocs_IVARS(self);
+    uint32_t pos = S_lower_bound(ivars, tick);
+    return pos < ivars->num_doc_ids ? (int32_t)SI_doc_id(ivars, pos) : -1;
+}
+
+size_t
+SparseDelDocs_Count_IMP(SparseDelDocs *self) {
+    return SparseDelDocs_IVARS(self)->num_doc_ids;
+}
+
+I32Array*
+SparseDelDocs_To_Array_IMP(SparseDelDocs *self) {
+    SparseDelDocsIVARS *const ivars = SparseDelDocs_IVARS(self);
+    int32_t *doc_ids
+        = (int32_t*)MALLOCATE((ivars->num_doc_ids + 1) * sizeof(int32_t));
+    for (uint32_t i = 0; i < ivars->num_doc_ids; i++) {
+        doc_ids[i] = (int32_t)SI_doc_id(ivars, i);
+    }
+    return I32Arr_new_steal(doc_ids, ivars->num_doc_ids);
+}
+
@@ -20,37 +20,38 @@
 #include "Lucy/Object/BitVector.h"
 #include "Lucy/Util/NumberUtils.h"
 
-// Shared subroutine for performing both OR and XOR ops.
 #define DO_OR 1
 #define DO_XOR 2
+#define DO_AND 3
+#define DO_AND_NOT 4
+
+// Shared subroutine for performing both OR and XOR ops.
 static void
 S_do_or_or_xor(BitVector *self, const BitVector *other, int operation);
 
-// Number of 1 bits given a u8 value.
-static const uint32_t BYTE_COUNTS[256] = {
-    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
-};
+// Apply an operation a bit at a time, for when `other` keeps its bits
+// somewhere other than a plain byte array.
+static void
+S_do_generic_op(BitVector *self, BitVector *other, int operation);
 
 static CFISH_INLINE size_t
 SI_octet_size(size_t bit_size) {
     return (bit_size + 7) / 8;
 }
 
+// Load 8 bytes of bits as a word whose lowest bit is the first bit.
+static CFISH_INLINE uint64_t
+SI_load_word(const uint8_t *bytes) {
+    return (uint64_t)bytes[0]
+           | ((uint64_t)bytes[1] << 8)
+           | ((uint64_t)bytes[2] << 16)
+           | ((uint64_t)bytes[3] << 24)
+           | ((uint64_t)bytes[4] << 32)
+           | ((uint64_t)bytes[5] << 40)
+           | ((uint64_t)bytes[6] << 48)
+           | ((uint64_t)bytes[7] << 56);
+}
+
 BitVector*
 BitVec_new(size_t capacity) {
     BitVector *self = (BitVector*)Class_Make_Obj(BITVECTOR);
@@ -117,6 +118,11 @@ BitVec_Mimic_IMP(BitVector *self, Obj *other) {
     CERTIFY(other, BITVECTOR);
     BitVectorIVARS *const ivars = BitVec_IVARS(self);
     BitVectorIVARS *const ovars = BitVec_IVARS((BitVector*)other);
+    if (!ovars->bits) {
+        BitVec_Clear_All(self);
+        S_do_generic_op(self, (BitVector*)other, DO_OR);
+        return;
+    }
     const size_t my_byte_size = SI_octet_size(ivars->cap);
     const size_t other_byte_size = SI_octet_size(ovars->cap);
     if (my_byte_size > other_byte_size) {
@@ -181,15 +187,6 @@ BitVec_Get_IMP(BitVector *self, size_t tick) {
     return NumUtil_u1get(ivars->bits, tick);
 }
 
-static int32_t
-S_first_bit_in_nonzero_byte(uint8_t num) {
-    int32_t first_bit = 0;
-    if ((num & 0xF) == 0) { first_bit += 4; num >>= 4; }
-    if ((num & 0x3) == 0) { first_bit += 2; num >>= 2; }
-    if ((num & 0x1) == 0) { first_bit += 1; }
-    return first_bit;
-}
-
 int32_t
 BitVec_Next_Hit_IMP(BitVector *self, size_t tick) {
     BitVectorIVARS *const ivars = BitVec_IVARS(self);
@@ -211,15 +208,22 @@ BitVec_Next_Hit_IMP(BitVector *self, size_t tick) {
         size_t min_sub_tick = tick & 0x7;
         uint8_t byte = (uint8_t)(*ptr >> min_sub_tick);
         if (byte) {
-            return (int32_t)tick + S_first_bit_in_nonzero_byte(byte);
+            return (int32_t)(tick + NumUtil_ctz_u64(byte));
         }
     }
 
-    for (ptr++ ; ptr < limit; ptr++) {
+    // Look at a word at a time until the last few bytes.
+    for (ptr++; limit - ptr >= 8; ptr += 8) {
+        uint64_t word = SI_load_word(ptr);
+        if (word != 0) {
+            int32_t base = (int32_t)((ptr - ivars->bits) * 8);
+            return base + (int32_t)NumUtil_ctz_u64(word);
+        }
+    }
+    for (; ptr < limit; ptr++) {
         if (*ptr != 0) {
-            // There's a non-zero bit in this byte.
             int32_t base = (int32_t)((ptr - ivars->bits) * 8);
-            return base + S_first_bit_in_nonzero_byte(*ptr);
+            return base + (int32_t)NumUtil_ctz_u64(*ptr);
         }
     }
 
@@ -230,6 +234,10 @@ void
 BitVec_And_IMP(BitVector *self, const BitVector *other) {
     BitVectorIVARS *const ivars = BitVec_IVARS(self);
     const BitVectorIVARS *const ovars = BitVec_IVARS((BitVector*)other);
+    if (!ovars->bits) {
+        S_do_generic_op(self, (BitVector*)other, DO_AND);
+        return;
+    }
     uint8_t *bits_a = ivars->bits;
     uint8_t *bits_b = ovars->bits;
     const size_t min_cap = ivars->cap < ovars->cap
@@ -270,6 +278,11 @@ S_do_or_or_xor(BitVector *self, const BitVector *other, int operation) {
     uint8_t *limit;
     size_t byte_size;
 
+    if (!ovars->bits) {
+        S_do_generic_op(self, (BitVector*)other, operation);
+        return;
+    }
+
     // Sort out what the minimum and maximum caps are.
     if (ivars->cap < ovars->cap) {
         max_cap = ovars->cap;
@@ -312,10 +325,41 @@ S_do_or_or_xor(BitVector *self, const BitVector *other, int operation) {
     }
 }
 
+static void
+S_do_generic_op(BitVector *self, BitVector *other, int operation) {
+    if (operation == DO_AND) {
+        int32_t tick = BitVec_Next_Hit(self, 0);
+        while (tick != -1) {
+            if (!BitVec_Get(other, (size_t)tick)) {
+                BitVec_Clear(self, (size_t)tick);
+            }
+            tick = BitVec_Next_Hit(self, (size_t)tick + 1);
+        }
+        return;
+    }
+
+    int32_t tick = BitVec_Next_Hit(other, 0);
+    while (tick != -1) {
+        switch (operation) {
+            case DO_OR:      BitVec_Set(self, (size_t)tick);   break;
+            case DO_XOR:     BitVec_Flip(self, (size_t)tick);  break;
+            case DO_AND_NOT: BitVec_Clear(self, (size_t)tick); break;
+            default:
+                THROW(ERR, "Unrecognized operation: %i32",
+                      (int32_t)operation);
+        }
+        tick = BitVec_Next_Hit(other, (size_t)tick + 1);
+    }
+}
+
 void
 BitVec_And_Not_IMP(BitVector *self, const BitVector *other) {
     BitVectorIVARS *const ivars = BitVec_IVARS(self);
     const BitVectorIVARS *const ovars = BitVec_IVARS((BitVector*)other);
+    if (!ovars->bits) {
+        S_do_generic_op(self, (BitVector*)other, DO_AND_NOT);
+        return;
+    }
     uint8_t *bits_a = ivars->bits;
     uint8_t *bits_b = ovars->bits;
     const size_t min_cap = ivars->cap < ovars->cap
@@ -392,8 +436,11 @@ BitVec_Count_IMP(BitVector *self) {
     uint8_t *ptr = ivars->bits;
     uint8_t *const limit = ptr + byte_size;
 
+    for (; limit - ptr >= 8; ptr += 8) {
+        count += NumUtil_popcount_u64(SI_load_word(ptr));
+    }
     for (; ptr < limit; ptr++) {
-        count += BYTE_COUNTS[*ptr];
+        count += NumUtil_popcount_u64(*ptr);
     }
 
     return count;
@@ -0,0 +1,669 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_ROARINGBITVECTOR
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Object/RoaringBitVector.h"
+#include "Lucy/Util/NumberUtils.h"
+
+#define DO_OR 1
+#define DO_XOR 2
+#define DO_AND 3
+#define DO_AND_NOT 4
+
+// Bits per chunk, 64-bit words per bitmap chunk, and the most bits an array
+// chunk holds before it becomes a bitmap.  At that size both take 8 kB.
+#define CHUNK_SIZE  65536
+#define NUM_WORDS   1024
+#define ARRAY_MAX   4096
+
+// A chunk holds either a sorted array of offsets or a bitmap, never both.
+// A freshly added chunk is an empty array.
+typedef struct {
+    uint32_t  key;
+    uint32_t  card;
+    uint32_t  array_cap;
+    uint16_t *array;
+    uint64_t *words;
+} S_Chunk;
+
+// Apply an operation a bit at a time, for when `other` isn't roaring.
+static void
+S_do_generic_op(RoaringBitVector *self, BitVector *other, int operation);
+
+// Apply an operation chunk by chunk against another RoaringBitVector.
+static void
+S_do_roaring_op(RoaringBitVector *self, RoaringBitVector *other,
+                int operation);
+
+static CFISH_INLINE S_Chunk*
+SI_chunks(RoaringBitVectorIVARS *ivars) {
+    return (S_Chunk*)ivars->chunks;
+}
+
+// Return the index of the chunk with `key`, or if there isn't one, minus one
+// minus the index where it would go.
+static int64_t
+S_find_chunk(RoaringBitVectorIVARS *ivars, uint32_t key) {
+    S_Chunk *chunks = SI_chunks(ivars);
+    uint32_t lo = 0;
+    uint32_t hi = ivars->num_chunks;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (chunks[mid].key < key) { lo = mid + 1; }
+        else                       { hi = mid; }
+    }
+    if (lo < ivars->num_chunks && chunks[lo].key == key) { return lo; }
+    return -1 - (int64_t)lo;
+}
+
+// Return the index of the chunk with `key`, adding one if needed.
+static uint32_t
+S_obtain_chunk(RoaringBitVectorIVARS *ivars, uint32_t key) {
+    int64_t found = S_find_chunk(ivars, key);
+    if (found >= 0) { return (uint32_t)found; }
+    uint32_t pos = (uint32_t)(-1 - found);
+    if (ivars->num_chunks == ivars->chunks_cap) {
+        ivars->chunks_cap = ivars->chunks_cap ? ivars->chunks_cap * 2 : 4;
+        ivars->chunks = REALLOCATE(ivars->chunks,
+                                   ivars->chunks_cap * sizeof(S_Chunk));
+    }
+    S_Chunk *chunks = SI_chunks(ivars);
+    memmove(chunks + pos + 1, chunks + pos,
+            (ivars->num_chunks - pos) * sizeof(S_Chunk));
+    memset(chunks + pos, 0, sizeof(S_Chunk));
+    chunks[pos].key = key;
+    ivars->num_chunks++;
+    return pos;
+}
+
+static void
+S_remove_chunk(RoaringBitVectorIVARS *ivars, uint32_t pos) {
+    S_Chunk *chunks = SI_chunks(ivars);
+    FREEMEM(chunks[pos].array);
+    FREEMEM(chunks[pos].words);
+    memmove(chunks + pos, chunks + pos + 1,
+            (ivars->num_chunks - pos - 1) * sizeof(S_Chunk));
+    ivars->num_chunks--;
+}
+
+// Return the index of the first offset in the array which is not less than
+// `low`.
+static uint32_t
+S_lower_bound(const uint16_t *array, uint32_t card, uint32_t low) {
+    uint32_t lo = 0;
+    uint32_t hi = card;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (array[mid] < low) { lo = mid + 1; }
+        else                  { hi = mid; }
+    }
+    return lo;
+}
+
+static void
+S_to_bitmap(S_Chunk *chunk) {
+    uint64_t *words = (uint64_t*)CALLOCATE(NUM_WORDS, sizeof(uint64_t));
+    for (uint32_t i = 0; i < chunk->card; i++) {
+        uint16_t low = chunk->array[i];
+        words[low >> 6] |= UINT64_C(1) << (low & 63);
+    }
+    FREEMEM(chunk->array);
+    chunk->array     = NULL;
+    chunk->array_cap = 0;
+    chunk->words     = words;
+}
+
+static void
+S_to_array(S_Chunk *chunk) {
+    uint16_t *array
+        = (uint16_t*)MALLOCATE((chunk->card + 1) * sizeof(uint16_t));
+    uint32_t num = 0;
+    for (uint32_t w = 0; w < NUM_WORDS; w++) {
+        uint64_t word = chunk->words[w];
+        while (word) {
+            array[num++] = (uint16_t)(w * 64 + NumUtil_ctz_u64(word));
+            word &= word - 1;
+        }
+    }
+    FREEMEM(chunk->words);
+    chunk->words     = NULL;
+    chunk->array     = array;
+    chunk->array_cap = chunk->card + 1;
+}
+
+static uint32_t
+S_count_words(const uint64_t *words) {
+    uint32_t card = 0;
+    for (uint32_t w = 0; w < NUM_WORDS; w++) {
+        card += NumUtil_popcount_u64(words[w]);
+    }
+    return card;
+}
+
+// Pick the right form for the chunk at `pos` after its card has changed,
+// dropping it if it's empty.  Returns false if the chunk was dropped.
+static bool
+S_normalize(RoaringBitVectorIVARS *ivars, uint32_t pos) {
+    S_Chunk *chunk = SI_chunks(ivars) + pos;
+    if (chunk->card == 0) {
+        S_remove_chunk(ivars, pos);
+        return false;
+    }
+    if (chunk->words && chunk->card <= ARRAY_MAX) {
+        S_to_array(chunk);
+    }
+    else if (!chunk->words && chunk->card > ARRAY_MAX) {
+        S_to_bitmap(chunk);
+    }
+    return true;
+}
+
+// Return the lowest offset in the chunk which is not less than `low`, or -1.
+static int32_t
+S_chunk_next(const S_Chunk *chunk, uint32_t low) {
+    if (!chunk->words) {
+        uint32_t i = S_lower_bound(chunk->array, chunk->card, low);
+        return i < chunk->card ? (int32_t)chunk->array[i] : -1;
+    }
+    uint32_t w = low >> 6;
+    uint64_t word = chunk->words[w] & (~UINT64_C(0) << (low & 63));
+    while (word == 0) {
+        if (++w == NUM_WORDS) { return -1; }
+        word = chunk->words[w];
+    }
+    return (int32_t)(w * 64 + NumUtil_ctz_u64(word));
+}
+
+static void
+S_check_tick(size_t tick) {
+    if ((uint64_t)tick > UINT32_MAX) {
+        THROW(ERR, "Tick out of range for RoaringBitVector: %u64",
+              (uint64_t)tick);
+    }
+}
+
+RoaringBitVector*
+RoarBitVec_new() {
+    RoaringBitVector *self
+        = (RoaringBitVector*)Class_Make_Obj(ROARINGBITVECTOR);
+    return RoarBitVec_init(self);
+}
+
+RoaringBitVector*
+RoarBitVec_init(RoaringBitVector *self) {
+    BitVec_init((BitVector*)self, 0);
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    ivars->chunks     = NULL;
+    ivars->num_chunks = 0;
+    ivars->chunks_cap = 0;
+    return self;
+}
+
+void
+RoarBitVec_Destroy_IMP(RoaringBitVector *self) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    RoarBitVec_Clear_All(self);
+    FREEMEM(ivars->chunks);
+    SUPER_DESTROY(self, ROARINGBITVECTOR);
+}
+
+RoaringBitVector*
+RoarBitVec_Clone_IMP(RoaringBitVector *self) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    RoaringBitVector *twin = RoarBitVec_new();
+    RoaringBitVectorIVARS *const tvars = RoarBitVec_IVARS(twin);
+
+    // Forbid inheritance.
+    if (RoarBitVec_get_class(self) != ROARINGBITVECTOR) {
+        THROW(ERR, "Attempt by %o to inherit RoarBitVec_Clone",
+              RoarBitVec_get_class_name(self));
+    }
+
+    tvars->cap        = ivars->cap;
+    tvars->num_chunks = ivars->num_chunks;
+    tvars->chunks_cap = ivars->num_chunks;
+    tvars->chunks     = MALLOCATE((ivars->num_chunks + 1) * sizeof(S_Chunk));
+    S_Chunk *source = SI_chunks(ivars);
+    S_Chunk *dest   = SI_chunks(tvars);
+    for (uint32_t i = 0; i < ivars->num_chunks; i++) {
+        dest[i] = source[i];
+        if (source[i].words) {
+            dest[i].words
+                = (uint64_t*)MALLOCATE(NUM_WORDS * sizeof(uint64_t));
+            memcpy(dest[i].words, source[i].words,
+                   NUM_WORDS * sizeof(uint64_t));
+        }
+        else {
+            dest[i].array_cap = source[i].card + 1;
+            dest[i].array = (uint16_t*)MALLOCATE(
+                                dest[i].array_cap * sizeof(uint16_t));
+            memcpy(dest[i].array, source[i].array,
+                   source[i].card * sizeof(uint16_t));
+        }
+    }
+
+    return twin;
+}
+
+bool
+RoarBitVec_Get_IMP(RoaringBitVector *self, size_t tick) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    if ((uint64_t)tick > UINT32_MAX) { return false; }
+    int64_t pos = S_find_chunk(ivars, (uint32_t)(tick >> 16));
+    if (pos < 0) { return false; }
+    const S_Chunk *chunk = SI_chunks(ivars) + pos;
+    uint32_t low = tick & 0xFFFF;
+    if (chunk->words) {
+        return (chunk->words[low >> 6] >> (low & 63)) & 1;
+    }
+    uint32_t i = S_lower_bound(chunk->array, chunk->card, low);
+    return i < chunk->card && chunk->array[i] == low;
+}
+
+void
+RoarBitVec_Set_IMP(RoaringBitVector *self, size_t tick) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    S_check_tick(tick);
+    uint32_t pos   = S_obtain_chunk(ivars, (uint32_t)(tick >> 16));
+    S_Chunk *chunk = SI_chunks(ivars) + pos;
+    uint32_t low   = tick & 0xFFFF;
+
+    if (!chunk->words) {
+        uint32_t i = S_lower_bound(chunk->array, chunk->card, low);
+        if (i < chunk->card && chunk->array[i] == low) { return; }
+        if (chunk->card < ARRAY_MAX) {
+            if (chunk->card == chunk->array_cap) {
+                uint32_t new_cap = chunk->array_cap
+                                   ? chunk->array_cap * 2
+                                   : 4;
+                if (new_cap > ARRAY_MAX) { new_cap = ARRAY_MAX; }
+                chunk->array = (uint16_t*)REALLOCATE(
+                                   chunk->array, new_cap * sizeof(uint16_t));
+                chunk->array_cap = new_cap;
+            }
+            memmove(chunk->array + i + 1, chunk->array + i,
+                    (chunk->card - i) * sizeof(uint16_t));
+            chunk->array[i] = (uint16_t)low;
+            chunk->card++;
+            if (tick >= ivars->cap) { ivars->cap = tick + 1; }
+            return;
+        }
+        S_to_bitmap(chunk);
+    }
+
+    uint64_t mask = UINT64_C(1) << (low & 63);
+    if (!(chunk->words[low >> 6] & mask)) {
+        chunk->words[low >> 6] |= mask;
+        chunk->card++;
+    }
+    if (tick >= ivars->cap) { ivars->cap = tick + 1; }
+}
+
+void
+RoarBitVec_Clear_IMP(RoaringBitVector *self, size_t tick) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    if ((uint64_t)tick > UINT32_MAX) { return; }
+    int64_t pos = S_find_chunk(ivars, (uint32_t)(tick >> 16));
+    if (pos < 0) { return; }
+    S_Chunk *chunk = SI_chunks(ivars) + pos;
+    uint32_t low   = tick & 0xFFFF;
+
+    if (chunk->words) {
+        uint64_t mask = UINT64_C(1) << (low & 63);
+        if (!(chunk->words[low >> 6] & mask)) { return; }
+        chunk->words[low >> 6] &= ~mask;
+    }
+    else {
+        uint32_t i = S_lower_bound(chunk->array, chunk->card, low);
+        if (i == chunk->card || chunk->array[i] != low) { return; }
+        memmove(chunk->array + i, chunk->array + i + 1,
+                (chunk->card - i - 1) * sizeof(uint16_t));
+    }
+    chunk->card--;
+    S_normalize(ivars, (uint32_t)pos);
+}
+
+void
+RoarBitVec_Clear_All_IMP(RoaringBitVector *self) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    S_Chunk *chunks = SI_chunks(ivars);
+    for (uint32_t i = 0; i < ivars->num_chunks; i++) {
+        FREEMEM(chunks[i].array);
+        FREEMEM(chunks[i].words);
+    }
+    ivars->num_chunks = 0;
+}
+
+void
+RoarBitVec_Grow_IMP(RoaringBitVector *self, size_t capacity) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    if (capacity > ivars->cap) { ivars->cap = capacity; }
+}
+
+int32_t
+RoarBitVec_Next_Hit_IMP(RoaringBitVector *self, size_t tick) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    if ((uint64_t)tick > UINT32_MAX) { return -1; }
+    int64_t  found = S_find_chunk(ivars, (uint32_t)(tick >> 16));
+    uint32_t pos   = found >= 0 ? (uint32_t)found : (uint32_t)(-1 - found);
+    uint32_t low   = found >= 0 ? (uint32_t)(tick & 0xFFFF) : 0;
+    S_Chunk *chunks = SI_chunks(ivars);
+
+    for (; pos < ivars->num_chunks; pos++, low = 0) {
+        int32_t offset = S_chunk_next(chunks + pos, low);
+        if (offset != -1) {
+            uint64_t hit = ((uint64_t)chunks[pos].key << 16)
+                           | (uint32_t)offset;
+            if (hit > INT32_MAX) {
+                THROW(ERR, "Next_Hit result too large: %u64", hit);
+            }
+            return (int32_t)hit;
+        }
+    }
+
+    return -1;
+}
+
+size_t
+RoarBitVec_Count_IMP(RoaringBitVector *self) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    S_Chunk *chunks = SI_chunks(ivars);
+    size_t count = 0;
+    for (uint32_t i = 0; i < ivars->num_chunks; i++) {
+        count += chunks[i].card;
+    }
+    return count;
+}
+
+I32Array*
+RoarBitVec_To_Array_IMP(RoaringBitVector *self) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    size_t   count  = RoarBitVec_Count(self);
+    int32_t *array  = (int32_t*)CALLOCATE(count + 1, sizeof(int32_t));
+    S_Chunk *chunks = SI_chunks(ivars);
+    size_t   num    = 0;
+
+    for (uint32_t i = 0; i < ivars->num_chunks; i++) {
+        const S_Chunk *chunk = chunks + i;
+        const uint32_t base  = chunk->key << 16;
+        if (!chunk->words) {
+            for (uint32_t j = 0; j < chunk->card; j++) {
+                array[num++] = (int32_t)(base | chunk->array[j]);
+            }
+            continue;
+        }
+        for (uint32_t w = 0; w < NUM_WORDS; w++) {
+            uint64_t word = chunk->words[w];
+            while (word) {
+                array[num++]
+                    = (int32_t)(base + w * 64 + NumUtil_ctz_u64(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    return I32Arr_new_steal(array, count);
+}
+
+void
+RoarBitVec_Flip_IMP(RoaringBitVector *self, size_t tick) {
+    if (RoarBitVec_Get(self, tick)) { RoarBitVec_Clear(self, tick); }
+    else                            { RoarBitVec_Set(self, tick); }
+}
+
+void
+RoarBitVec_Flip_Block_IMP(RoaringBitVector *self, size_t offset,
+                          size_t length) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    if (length == 0) { return; }
+    size_t last = offset + length - 1;
+    if (last < offset) { THROW(ERR, "Flip_Block range overflows"); }
+    S_check_tick(last);
+    const uint32_t first_key = (uint32_t)(offset >> 16);
+    const uint32_t last_key  = (uint32_t)(last >> 16);
+
+    for (uint32_t key = first_key; key <= last_key; key++) {
+        uint32_t lo = key == first_key ? (uint32_t)(offset & 0xFFFF) : 0;
+        uint32_t hi = key == last_key ? (uint32_t)(last & 0xFFFF) : 0xFFFF;
+        uint32_t pos   = S_obtain_chunk(ivars, key);
+        S_Chunk *chunk = SI_chunks(ivars) + pos;
+        if (!chunk->words) { S_to_bitmap(chunk); }
+
+        for (uint32_t w = lo >> 6; w <= hi >> 6; w++) {
+            uint32_t start = w == lo >> 6 ? lo & 63 : 0;
+            uint32_t end   = w == hi >> 6 ? hi & 63 : 63;
+            uint64_t mask  = end - start == 63
+                             ? ~UINT64_C(0)
+                             : ((UINT64_C(1) << (end - start + 1)) - 1)
+                               << start;
+            chunk->words[w] ^= mask;
+        }
+        chunk->card = S_count_words(chunk->words);
+        S_normalize(ivars, pos);
+    }
+
+    if (last >= ivars->cap) { ivars->cap = last + 1; }
+}
+
+void
+RoarBitVec_Mimic_IMP(RoaringBitVector *self, Obj *other) {
+    CERTIFY(other, BITVECTOR);
+    if ((Obj*)self == other) { return; }
+    RoarBitVec_Clear_All(self);
+    RoarBitVec_Or(self, (BitVector*)other);
+}
+
+void
+RoarBitVec_And_IMP(RoaringBitVector *self, const BitVector *other) {
+    if (Obj_is_a((Obj*)other, ROARINGBITVECTOR)) {
+        S_do_roaring_op(self, (RoaringBitVector*)other, DO_AND);
+    }
+    else {
+        S_do_generic_op(self, (BitVector*)other, DO_AND);
+    }
+}
+
+void
+RoarBitVec_Or_IMP(RoaringBitVector *self, const BitVector *other) {
+    if (Obj_is_a((Obj*)other, ROARINGBITVECTOR)) {
+        S_do_roaring_op(self, (RoaringBitVector*)other, DO_OR);
+    }
+    else {
+        S_do_generic_op(self, (BitVector*)other, DO_OR);
+    }
+}
+
+void
+RoarBitVec_Xor_IMP(RoaringBitVector *self, const BitVector *other) {
+    if (Obj_is_a((Obj*)other, ROARINGBITVECTOR)) {
+        S_do_roaring_op(self, (RoaringBitVector*)other, DO_XOR);
+    }
+    else {
+        S_do_generic_op(self, (BitVector*)other, DO_XOR);
+    }
+}
+
+void
+RoarBitVec_And_Not_IMP(RoaringBitVector *self, const BitVector *other) {
+    if (Obj_is_a((Obj*)other, ROARINGBITVECTOR)) {
+        S_do_roaring_op(self, (RoaringBitVector*)other, DO_AND_NOT);
+    }
+    else {
+        S_do_generic_op(self, (BitVector*)other, DO_AND_NOT);
+    }
+}
+
+static void
+S_do_generic_op(RoaringBitVector *self, BitVector *other, int operation) {
+    if (operation == DO_AND) {
+        int32_t tick = RoarBitVec_Next_Hit(self, 0);
+        while (tick != -1) {
+            if (!BitVec_Get(other, (size_t)tick)) {
+                RoarBitVec_Clear(self, (size_t)tick);
+            }
+            tick = RoarBitVec_Next_Hit(self, (size_t)tick + 1);
+        }
+        return;
+    }
+
+    int32_t tick = BitVec_Next_Hit(other, 0);
+    while (tick != -1) {
+        switch (operation) {
+            case DO_OR:      RoarBitVec_Set(self, (size_t)tick);   break;
+            case DO_XOR:     RoarBitVec_Flip(self, (size_t)tick);  break;
+            case DO_AND_NOT: RoarBitVec_Clear(self, (size_t)tick); break;
+            default:
+                THROW(ERR, "Unrecognized operation: %i32",
+                      (int32_t)operation);
+        }
+        tick = BitVec_Next_Hit(other, (size_t)tick + 1);
+    }
+}
+
+// Merge two array chunks into `chunk`, which may end up holding more than
+// ARRAY_MAX offsets until it is normalized.
+static void
+S_array_op(S_Chunk *chunk, const S_Chunk *other, int operation) {
+    const uint16_t *a = chunk->array;
+    const uint16_t *b = other->array;
+    const uint32_t  a_card = chunk->card;
+    const uint32_t  b_card = other->card;
+    uint16_t *out = (uint16_t*)MALLOCATE((a_card + b_card + 1)
+                                         * sizeof(uint16_t));
+    uint32_t i = 0, j = 0, num = 0;
+
+    while (i < a_card && j < b_card) {
+        if (a[i] < b[j]) {
+            if (operation != DO_AND) { out[num++] = a[i]; }
+            i++;
+        }
+        else if (a[i] > b[j]) {
+            if (operation == DO_OR || operation == DO_XOR) {
+                out[num++] = b[j];
+            }
+            j++;
+        }
+        else {
+            if (operation == DO_OR || operation == DO_AND) {
+                out[num++] = a[i];
+            }
+            i++;
+            j++;
+        }
+    }
+    if (operation != DO_AND) {
+        while (i < a_card) { out[num++] = a[i++]; }
+    }
+    if (operation == DO_OR || operation == DO_XOR) {
+        while (j < b_card) { out[num++] = b[j++]; }
+    }
+
+    FREEMEM(chunk->array);
+    chunk->array     = out;
+    chunk->array_cap = a_card + b_card + 1;
+    chunk->card      = num;
+}
+
+// Combine a chunk with another a word at a time, turning it into a bitmap
+// first.  The loops are kept simple so that compilers can vectorize them.
+static void
+S_bitmap_op(S_Chunk *chunk, const S_Chunk *other, int operation) {
+    uint64_t scratch[NUM_WORDS];
+    const uint64_t *b = other->words;
+    if (!b) {
+        memset(scratch, 0, sizeof(scratch));
+        for (uint32_t i = 0; i < other->card; i++) {
+            uint16_t low = other->array[i];
+            scratch[low >> 6] |= UINT64_C(1) << (low & 63);
+        }
+        b = scratch;
+    }
+    if (!chunk->words) { S_to_bitmap(chunk); }
+    uint64_t *a = chunk->words;
+
+    switch (operation) {
+        case DO_OR:
+            for (uint32_t w = 0; w < NUM_WORDS; w++) { a[w] |= b[w]; }
+            break;
+        case DO_XOR:
+            for (uint32_t w = 0; w < NUM_WORDS; w++) { a[w] ^= b[w]; }
+            break;
+        case DO_AND:
+            for (uint32_t w = 0; w < NUM_WORDS; w++) { a[w] &= b[w]; }
+            break;
+        case DO_AND_NOT:
+            for (uint32_t w = 0; w < NUM_WORDS; w++) { a[w] &= ~b[w]; }
+            break;
+        default:
+            THROW(ERR, "Unrecognized operation: %i32", (int32_t)operation);
+    }
+    chunk->card = S_count_words(a);
+}
+
+static void
+S_do_roaring_op(RoaringBitVector *self, RoaringBitVector *other,
+                int operation) {
+    RoaringBitVectorIVARS *const ivars = RoarBitVec_IVARS(self);
+    RoaringBitVectorIVARS *const ovars = RoarBitVec_IVARS(other);
+
+    if (self == other) {
+        if (operation == DO_XOR || operation == DO_AND_NOT) {
+            RoarBitVec_Clear_All(self);
+        }
+        return;
+    }
+
+    if (operation == DO_AND || operation == DO_AND_NOT) {
+        // Only chunks which are already present can change.
+        uint32_t pos = 0;
+        while (pos < ivars->num_chunks) {
+            S_Chunk *chunk = SI_chunks(ivars) + pos;
+            int64_t found = S_find_chunk(ovars, chunk->key);
+            if (found < 0) {
+                if (operation == DO_AND) { S_remove_chunk(ivars, pos); }
+                else                     { pos++; }
+                continue;
+            }
+            const S_Chunk *other_chunk = SI_chunks(ovars) + found;
+            if (!chunk->words && !other_chunk->words) {
+                S_array_op(chunk, other_chunk, operation);
+            }
+            else {
+                S_bitmap_op(chunk, other_chunk, operation);
+            }
+            if (S_normalize(ivars, pos)) { pos++; }
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < ovars->num_chunks; i++) {
+        const S_Chunk *other_chunk = SI_chunks(ovars) + i;
+        uint32_t pos   = S_obtain_chunk(ivars, other_chunk->key);
+        S_Chunk *chunk = SI_chunks(ivars) + pos;
+        if (!chunk->words && !other_chunk->words) {
+            S_array_op(chunk, other_chunk, operation);
+        }
+        else {
+            S_bitmap_op(chunk, other_chunk, operation);
+        }
+        S_normalize(ivars, pos);
+    }
+    if (ovars->cap > ivars->cap) { ivars->cap = ovars->cap; }
+}
+
+
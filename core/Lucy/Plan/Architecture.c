@@ -21,6 +21,10 @@
 #include "Lucy/Index/DeletionsReader.h"
 #include "Lucy/Index/DeletionsWriter.h"
 #include "Lucy/Index/DocReader.h"
+#include "Lucy/Index/DocValuesReader.h"
+#include "Lucy/Index/DocValuesWriter.h"
+#include "Lucy/Index/PointReader.h"
+#include "Lucy/Index/PointWriter.h"
 #include "Lucy/Index/DocWriter.h"
 #include "Lucy/Index/HighlightReader.h"
 #include "Lucy/Index/HighlightWriter.h"
@@ -64,6 +68,8 @@ Arch_Init_Seg_Writer_IMP(Architecture *self, SegWriter *writer) {
     Arch_Register_Posting_List_Writer(self, writer);
     Arch_Register_Sort_Writer(self, writer);
     Arch_Register_Doc_Writer(self, writer);
+    Arch_Register_Doc_Values_Writer(self, writer);
+    Arch_Register_Point_Writer(self, writer);
     Arch_Register_Highlight_Writer(self, writer);
     Arch_Register_Deletions_Writer(self, writer);
 }
@@ -131,6 +137,34 @@ Arch_Register_Sort_Writer_IMP(Architecture *self, SegWriter *writer) {
     SegWriter_Add_Writer(writer, (DataWriter*)INCREF(sort_writer));
 }
 
+void
+Arch_Register_Doc_Values_Writer_IMP(Architecture *self, SegWriter *writer) {
+    Schema     *schema     = SegWriter_Get_Schema(writer);
+    Snapshot   *snapshot   = SegWriter_Get_Snapshot(writer);
+    Segment    *segment    = SegWriter_Get_Segment(writer);
+    PolyReader *polyreader = SegWriter_Get_PolyReader(writer);
+    DocValuesWriter *dv_writer
+        = DVWriter_new(schema, snapshot, segment, polyreader);
+    UNUSED_VAR(self);
+    SegWriter_Register(writer, Class_Get_Name(DOCVALUESWRITER),
+                       (DataWriter*)dv_writer);
+    SegWriter_Add_Writer(writer, (DataWriter*)INCREF(dv_writer));
+}
+
+void
+Arch_Register_Point_Writer_IMP(Architecture *self, SegWriter *writer) {
+    Schema      *schema       = SegWriter_Get_Schema(writer);
+    Snapshot    *snapshot     = SegWriter_Get_Snapshot(writer);
+    Segment     *segment      = SegWriter_Get_Segment(writer);
+    PolyReader  *polyreader   = SegWriter_Get_PolyReader(writer);
+    PointWriter *point_writer
+        = PointWriter_new(schema, snapshot, segment, polyreader);
+    UNUSED_VAR(self);
+    SegWriter_Register(writer, Class_Get_Name(POINTWRITER),
+                       (DataWriter*)point_writer);
+    SegWriter_Add_Writer(writer, (DataWriter*)INCREF(point_writer));
+}
+
 void
 Arch_Register_Highlight_Writer_IMP(Architecture *self, SegWriter *writer) {
     Schema     *schema     = SegWriter_Get_Schema(writer);
@@ -165,6 +199,8 @@ Arch_Init_Seg_Reader_IMP(Architecture *self, SegReader *reader) {
     Arch_Register_Lexicon_Reader(self, reader);
     Arch_Register_Posting_List_Reader(self, reader);
     Arch_Register_Sort_Reader(self, reader);
+    Arch_Register_Doc_Values_Reader(self, reader);
+    Arch_Register_Point_Reader(self, reader);
     Arch_Register_Highlight_Reader(self, reader);
     Arch_Register_Deletions_Reader(self, reader);
 }
@@ -228,6 +264,34 @@ Arch_Register_Sort_Reader_IMP(Architecture *self, SegReader *reader) {
                        (DataReader*)sort_reader);
 }
 
+void
+Arch_Register_Doc_Values_Reader_IMP(Architecture *self, SegReader *reader) {
+    Schema     *schema   = SegReader_Get_Schema(reader);
+    Folder     *folder   = SegReader_Get_Folder(reader);
+    Vector     *segments = SegReader_Get_Segments(reader);
+    Snapshot   *snapshot = SegReader_Get_Snapshot(reader);
+    int32_t     seg_tick = SegReader_Get_Seg_Tick(reader);
+    DefaultDocValuesReader *dv_reader
+        = DefDVReader_new(schema, folder, snapshot, segments, seg_tick);
+    UNUSED_VAR(self);
+    SegReader_Register(reader, Class_Get_Name(DOCVALUESREADER),
+                       (DataReader*)dv_reader);
+}
+
+void
+Arch_Register_Point_Reader_IMP(Architecture *self, SegReader *reader) {
+    Schema     *schema   = SegReader_Get_Schema(reader);
+    Folder     *folder   = SegReader_Get_Folder(reader);
+    Vector     *segments = SegReader_Get_Segments(reader);
+    Snapshot   *snapshot = SegReader_Get_Snapshot(reader);
+    int32_t     seg_tick = SegReader_Get_Seg_Tick(reader);
+    DefaultPointReader *point_reader
+        = DefPointReader_new(schema, folder, snapshot, segments, seg_tick);
+    UNUSED_VAR(self);
+    SegReader_Register(reader, Class_Get_Name(POINTREADER),
+                       (DataReader*)point_reader);
+}
+
 void
 Arch_Register_Highlight_Reader_IMP(Architecture *self, SegReader *reader) {
     Schema     *schema   = SegReader_Get_Schema(reader);
@@ -274,4 +338,16 @@ Arch_Skip_Interval_IMP(Architecture *self) {
     return 16;
 }
 
+int32_t
+Arch_Skip_Multiplier_IMP(Architecture *self) {
+    UNUSED_VAR(self);
+    return 8;
+}
+
+size_t
+Arch_Filter_Cache_Budget_IMP(Architecture *self) {
+    UNUSED_VAR(self);
+    return 16 * 1024 * 1024;
+}
+
 
@@ -79,6 +79,9 @@ BlobType_Dump_For_Schema_IMP(BlobType *self) {
     if (ivars->stored) {
         Hash_Store_Utf8(dump, "stored", 6, (Obj*)CFISH_TRUE);
     }
+    if (ivars->columnar) {
+        Hash_Store_Utf8(dump, "columnar", 8, (Obj*)CFISH_TRUE);
+    }
 
     return dump;
 }
@@ -104,6 +107,7 @@ BlobType_Load_IMP(BlobType *self, Obj *dump) {
     Obj *boost_dump      = Hash_Fetch_Utf8(source, "boost", 5);
     Obj *indexed_dump    = Hash_Fetch_Utf8(source, "indexed", 7);
     Obj *stored_dump     = Hash_Fetch_Utf8(source, "stored", 6);
+    Obj *columnar_dump   = Hash_Fetch_Utf8(source, "columnar", 8);
     UNUSED_VAR(self);
 
     BlobType_init(loaded, false);
@@ -117,6 +121,9 @@ BlobType_Load_IMP(BlobType *self, Obj *dump) {
     if (stored_dump){
         loaded_ivars->stored = Json_obj_to_bool(stored_dump);
     }
+    if (columnar_dump) {
+        loaded_ivars->columnar = Json_obj_to_bool(columnar_dump);
+    }
 
     return loaded;
 }
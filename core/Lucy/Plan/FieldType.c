@@ -35,6 +35,7 @@ FType_init2(FieldType *self, float boost, bool indexed, bool stored,
     ivars->indexed           = indexed;
     ivars->stored            = stored;
     ivars->sortable          = sortable;
+    ivars->columnar          = false;
     ABSTRACT_CLASS_CHECK(self, FIELDTYPE);
     return self;
 }
@@ -59,6 +60,11 @@ FType_Set_Sortable_IMP(FieldType *self, bool sortable) {
     FType_IVARS(self)->sortable = !!sortable;
 }
 
+void
+FType_Set_Columnar_IMP(FieldType *self, bool columnar) {
+    FType_IVARS(self)->columnar = !!columnar;
+}
+
 float
 FType_Get_Boost_IMP(FieldType *self) {
     return FType_IVARS(self)->boost;
@@ -79,6 +85,11 @@ FType_Sortable_IMP(FieldType *self) {
     return FType_IVARS(self)->sortable;
 }
 
+bool
+FType_Columnar_IMP(FieldType *self) {
+    return FType_IVARS(self)->columnar;
+}
+
 bool
 FType_Binary_IMP(FieldType *self) {
     UNUSED_VAR(self);
@@ -107,6 +118,7 @@ FType_Equals_IMP(FieldType *self, Obj *other) {
     if (!!ivars->indexed    != !!ovars->indexed)       { return false; }
     if (!!ivars->stored     != !!ovars->stored)        { return false; }
     if (!!ivars->sortable   != !!ovars->sortable)      { return false; }
+    if (!!ivars->columnar   != !!ovars->columnar)      { return false; }
     if (!!FType_Binary(self) != !!FType_Binary((FieldType*)other)) {
         return false;
     }
@@ -51,6 +51,9 @@ FullTextType_init2(FullTextType *self, Analyzer *analyzer, float boost,
     ivars->highlightable = highlightable;
     ivars->analyzer      = (Analyzer*)INCREF(analyzer);
 
+    /* Init */
+    ivars->impact_ordered = false;
+
     return self;
 }
 
@@ -73,6 +76,9 @@ FullTextType_Equals_IMP(FullTextType *self, Obj *other) {
     if (!super_equals(self, other))                       { return false; }
     if (!!ivars->sortable      != !!ovars->sortable)      { return false; }
     if (!!ivars->highlightable != !!ovars->highlightable) { return false; }
+    if (!!ivars->impact_ordered != !!ovars->impact_ordered) {
+        return false;
+    }
     if (!Analyzer_Equals(ivars->analyzer, (Obj*)ovars->analyzer)) {
         return false;
     }
@@ -98,9 +104,15 @@ FullTextType_Dump_For_Schema_IMP(FullTextType *self) {
     if (ivars->sortable) {
         Hash_Store_Utf8(dump, "sortable", 8, (Obj*)CFISH_TRUE);
     }
+    if (ivars->columnar) {
+        Hash_Store_Utf8(dump, "columnar", 8, (Obj*)CFISH_TRUE);
+    }
     if (ivars->highlightable) {
         Hash_Store_Utf8(dump, "highlightable", 13, (Obj*)CFISH_TRUE);
     }
+    if (ivars->impact_ordered) {
+        Hash_Store_Utf8(dump, "impact_ordered", 14, (Obj*)CFISH_TRUE);
+    }
 
     return dump;
 }
@@ -138,6 +150,8 @@ FullTextType_Load_IMP(FullTextType *self, Obj *dump) {
     Obj *stored_dump  = Hash_Fetch_Utf8(source, "stored", 6);
     Obj *sort_dump    = Hash_Fetch_Utf8(source, "sortable", 8);
     Obj *hl_dump      = Hash_Fetch_Utf8(source, "highlightable", 13);
+    Obj *col_dump     = Hash_Fetch_Utf8(source, "columnar", 8);
+    Obj *impact_dump  = Hash_Fetch_Utf8(source, "impact_ordered", 14);
     bool indexed  = indexed_dump ? Json_obj_to_bool(indexed_dump) : true;
     bool stored   = stored_dump  ? Json_obj_to_bool(stored_dump)  : true;
     bool sortable = sort_dump    ? Json_obj_to_bool(sort_dump)    : false;
@@ -159,6 +173,13 @@ FullTextType_Load_IMP(FullTextType *self, Obj *dump) {
 
     FullTextType_init2(loaded, analyzer, boost, indexed, stored,
                        sortable, hl);
+    if (col_dump) {
+        FullTextType_IVARS(loaded)->columnar = Json_obj_to_bool(col_dump);
+    }
+    if (impact_dump) {
+        FullTextType_IVARS(loaded)->impact_ordered
+            = Json_obj_to_bool(impact_dump);
+    }
     DECREF(analyzer);
     return loaded;
 }
@@ -178,6 +199,16 @@ FullTextType_Highlightable_IMP(FullTextType *self) {
     return FullTextType_IVARS(self)->highlightable;
 }
 
+void
+FullTextType_Set_Impact_Ordered_IMP(FullTextType *self, bool impact_ordered) {
+    FullTextType_IVARS(self)->impact_ordered = !!impact_ordered;
+}
+
+bool
+FullTextType_Impact_Ordered_IMP(FullTextType *self) {
+    return FullTextType_IVARS(self)->impact_ordered;
+}
+
 Similarity*
 FullTextType_Make_Similarity_IMP(FullTextType *self) {
     UNUSED_VAR(self);
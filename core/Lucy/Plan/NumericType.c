@@ -63,6 +63,9 @@ NumType_Dump_For_Schema_IMP(NumericType *self) {
     if (ivars->sortable) {
         Hash_Store_Utf8(dump, "sortable", 8, (Obj*)CFISH_TRUE);
     }
+    if (ivars->columnar) {
+        Hash_Store_Utf8(dump, "columnar", 8, (Obj*)CFISH_TRUE);
+    }
 
     return dump;
 }
@@ -116,11 +119,16 @@ NumType_Load_IMP(NumericType *self, Obj *dump) {
     Obj *indexed_dump = Hash_Fetch_Utf8(source, "indexed", 7);
     Obj *stored_dump  = Hash_Fetch_Utf8(source, "stored", 6);
     Obj *sort_dump    = Hash_Fetch_Utf8(source, "sortable", 8);
+    Obj *col_dump     = Hash_Fetch_Utf8(source, "columnar", 8);
     bool indexed  = indexed_dump ? Json_obj_to_bool(indexed_dump) : true;
     bool stored   = stored_dump  ? Json_obj_to_bool(stored_dump)  : true;
     bool sortable = sort_dump    ? Json_obj_to_bool(sort_dump)    : false;
 
-    return NumType_init2(loaded, boost, indexed, stored, sortable);
+    NumType_init2(loaded, boost, indexed, stored, sortable);
+    if (col_dump) {
+        NumType_IVARS(loaded)->columnar = Json_obj_to_bool(col_dump);
+    }
+    return loaded;
 }
 
 /****************************************************************************/
@@ -75,6 +75,9 @@ StringType_Dump_For_Schema_IMP(StringType *self) {
     if (ivars->sortable) {
         Hash_Store_Utf8(dump, "sortable", 8, (Obj*)CFISH_TRUE);
     }
+    if (ivars->columnar) {
+        Hash_Store_Utf8(dump, "columnar", 8, (Obj*)CFISH_TRUE);
+    }
 
     return dump;
 }
@@ -101,6 +104,7 @@ StringType_Load_IMP(StringType *self, Obj *dump) {
     Obj *indexed_dump    = Hash_Fetch_Utf8(source, "indexed", 7);
     Obj *stored_dump     = Hash_Fetch_Utf8(source, "stored", 6);
     Obj *sortable_dump   = Hash_Fetch_Utf8(source, "sortable", 8);
+    Obj *columnar_dump   = Hash_Fetch_Utf8(source, "columnar", 8);
     UNUSED_VAR(self);
 
     float boost    = boost_dump    ? (float)Json_obj_to_f64(boost_dump) : 1.0f;
@@ -108,7 +112,11 @@ StringType_Load_IMP(StringType *self, Obj *dump) {
     bool  stored   = stored_dump   ? Json_obj_to_bool(stored_dump)      : true;
     bool  sortable = sortable_dump ? Json_obj_to_bool(sortable_dump)    : false;
 
-    return StringType_init2(loaded, boost, indexed, stored, sortable);
+    StringType_init2(loaded, boost, indexed, stored, sortable);
+    if (columnar_dump) {
+        StringType_IVARS(loaded)->columnar = Json_obj_to_bool(columnar_dump);
+    }
+    return loaded;
 }
 
 Similarity*
@@ -37,11 +37,25 @@ ANDMatcher_init(ANDMatcher *self, Vector *children, Similarity *sim) {
     // Assign.
     ivars->more         = ivars->num_kids ? true : false;
     ivars->kids         = (Matcher**)MALLOCATE(ivars->num_kids * sizeof(Matcher*));
+    ivars->by_cost      = (Matcher**)MALLOCATE(ivars->num_kids * sizeof(Matcher*));
+    int64_t *costs = (int64_t*)MALLOCATE(ivars->num_kids * sizeof(int64_t));
     for (uint32_t i = 0; i < ivars->num_kids; i++) {
         Matcher *child = (Matcher*)Vec_Fetch(children, i);
         ivars->kids[i] = child;
         if (!Matcher_Next(child)) { ivars->more = false; }
+
+        // Insertion sort by ascending cost, so that the rarest child leads.
+        int64_t  cost = Matcher_Cost(child);
+        uint32_t j    = i;
+        while (j > 0 && costs[j - 1] > cost) {
+            costs[j]          = costs[j - 1];
+            ivars->by_cost[j] = ivars->by_cost[j - 1];
+            j--;
+        }
+        costs[j]          = cost;
+        ivars->by_cost[j] = child;
     }
+    FREEMEM(costs);
 
     // Derive.
     ivars->matching_kids = ivars->num_kids;
@@ -53,6 +67,7 @@ void
 ANDMatcher_Destroy_IMP(ANDMatcher *self) {
     ANDMatcherIVARS *const ivars = ANDMatcher_IVARS(self);
     FREEMEM(ivars->kids);
+    FREEMEM(ivars->by_cost);
     SUPER_DESTROY(self, ANDMATCHER);
 }
 
@@ -63,7 +78,7 @@ ANDMatcher_Next_IMP(ANDMatcher *self) {
         return ANDMatcher_Advance(self, 1);
     }
     if (ivars->more) {
-        const int32_t target = Matcher_Get_Doc_ID(ivars->kids[0]) + 1;
+        const int32_t target = Matcher_Get_Doc_ID(ivars->by_cost[0]) + 1;
         return ANDMatcher_Advance(self, target);
     }
     else {
@@ -74,78 +89,65 @@ ANDMatcher_Next_IMP(ANDMatcher *self) {
 int32_t
 ANDMatcher_Advance_IMP(ANDMatcher *self, int32_t target) {
     ANDMatcherIVARS *const ivars = ANDMatcher_IVARS(self);
-    Matcher **const kids     = ivars->kids;
+    Matcher **const kids     = ivars->by_cost;
     const uint32_t  num_kids = ivars->num_kids;
-    int32_t         highest  = 0;
+    int32_t         doc_id;
 
     if (!ivars->more) { return 0; }
+    Matcher *const lead = kids[0];
 
-    // First step: Advance first child and use its doc as a starting point.
+    // First step: advance the cheapest child to propose a candidate.  On the
+    // first call, all children are already positioned on their first docs.
     if (ivars->first_time) {
         ivars->first_time = false;
+        doc_id = Matcher_Get_Doc_ID(lead);
+        if (doc_id < target) {
+            doc_id = Matcher_Advance(lead, target);
+        }
     }
     else {
-        highest = Matcher_Advance(kids[0], target);
-        if (!highest) {
-            ivars->more = false;
-            return 0;
-        }
+        doc_id = Matcher_Advance(lead, target);
     }
 
-    // Second step: reconcile.
-    while (1) {
-        bool agreement = true;
-
-        // Scoot all Matchers up.
-        for (uint32_t i = 0; i < num_kids; i++) {
+    // Second step: bring the other children up to the candidate, in order
+    // of ascending cost.  If one of them overshoots, the lead leaps ahead to
+    // meet it and the round starts over, so the common children are only
+    // ever advanced to docs which the rare ones have already matched.
+    while (doc_id) {
+        uint32_t i;
+        for (i = 1; i < num_kids; i++) {
             Matcher *const child = kids[i];
             int32_t candidate = Matcher_Get_Doc_ID(child);
-
-            // If this child is highest, others will need to catch up.
-            if (highest < candidate) {
-                highest = candidate;
-            }
-
-            // If least doc Matchers can agree on exceeds target, raise bar.
-            if (target < highest) {
-                target = highest;
-            }
-
-            // Scoot this Matcher up if not already at highest.
-            if (candidate < target) {
-                // This Matcher is definitely the highest right now.
-                highest = Matcher_Advance(child, target);
-                if (!highest) {
+            if (candidate < doc_id) {
+                candidate = Matcher_Advance(child, doc_id);
+                if (!candidate) {
                     ivars->more = false;
                     return 0;
                 }
             }
-        }
-
-        // If Matchers don't agree, send back through the loop.
-        for (uint32_t i = 0; i < num_kids; i++) {
-            Matcher *const child = kids[i];
-            const int32_t candidate = Matcher_Get_Doc_ID(child);
-            if (candidate != highest) {
-                agreement = false;
+            if (candidate > doc_id) {
+                doc_id = Matcher_Advance(lead, candidate);
                 break;
             }
         }
-
-        if (!agreement) {
-            continue;
-        }
-        if (highest >= target) {
-            break;
+        if (i == num_kids) {
+            return doc_id;
         }
     }
 
-    return highest;
+    ivars->more = false;
+    return 0;
 }
 
 int32_t
 ANDMatcher_Get_Doc_ID_IMP(ANDMatcher *self) {
-    return Matcher_Get_Doc_ID(ANDMatcher_IVARS(self)->kids[0]);
+    return Matcher_Get_Doc_ID(ANDMatcher_IVARS(self)->by_cost[0]);
+}
+
+int64_t
+ANDMatcher_Cost_IMP(ANDMatcher *self) {
+    ANDMatcherIVARS *const ivars = ANDMatcher_IVARS(self);
+    return ivars->num_kids ? Matcher_Cost(ivars->by_cost[0]) : 0;
 }
 
 float
@@ -31,6 +31,7 @@ BitVecMatcher_init(BitVecMatcher *self, BitVector *bit_vector) {
     Matcher_init((Matcher*)self);
     ivars->bit_vec = (BitVector*)INCREF(bit_vector);
     ivars->doc_id = 0;
+    ivars->cost   = -1;
     return self;
 }
 
@@ -61,4 +62,18 @@ BitVecMatcher_Get_Doc_ID_IMP(BitVecMatcher *self) {
     return BitVecMatcher_IVARS(self)->doc_id;
 }
 
+float
+BitVecMatcher_Score_IMP(BitVecMatcher *self) {
+    UNUSED_VAR(self);
+    return 0.0f;
+}
+
+int64_t
+BitVecMatcher_Cost_IMP(BitVecMatcher *self) {
+    BitVecMatcherIVARS *const ivars = BitVecMatcher_IVARS(self);
+    if (ivars->cost < 0) {
+        ivars->cost = (int64_t)BitVec_Count(ivars->bit_vec);
+    }
+    return ivars->cost;
+}
 
@@ -19,6 +19,8 @@
 #define C_LUCY_OFFSETCOLLECTOR
 #include "Lucy/Util/ToolSet.h"
 
+#include "charmony.h"
+
 #include "Lucy/Search/Collector.h"
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Search/Matcher.h"
@@ -62,6 +64,24 @@ Coll_Set_Base_IMP(Collector *self, int32_t base) {
     Coll_IVARS(self)->base = base;
 }
 
+float
+Coll_Competitive_Score_IMP(Collector *self) {
+    UNUSED_VAR(self);
+    return CHY_F32_NEGINF;
+}
+
+bool
+Coll_Accepts_Docs_Out_Of_Order_IMP(Collector *self) {
+    UNUSED_VAR(self);
+    return false;
+}
+
+bool
+Coll_Segment_Done_IMP(Collector *self) {
+    UNUSED_VAR(self);
+    return false;
+}
+
 BitCollector*
 BitColl_new(BitVector *bit_vec) {
     BitCollector *self = (BitCollector*)Class_Make_Obj(BITCOLLECTOR);
@@ -150,4 +170,21 @@ OffsetColl_Need_Score_IMP(OffsetCollector *self) {
     return Coll_Need_Score(ivars->inner_coll);
 }
 
+float
+OffsetColl_Competitive_Score_IMP(OffsetCollector *self) {
+    OffsetCollectorIVARS *const ivars = OffsetColl_IVARS(self);
+    return Coll_Competitive_Score(ivars->inner_coll);
+}
+
+bool
+OffsetColl_Accepts_Docs_Out_Of_Order_IMP(OffsetCollector *self) {
+    OffsetCollectorIVARS *const ivars = OffsetColl_IVARS(self);
+    return Coll_Accepts_Docs_Out_Of_Order(ivars->inner_coll);
+}
+
+bool
+OffsetColl_Segment_Done_IMP(OffsetCollector *self) {
+    OffsetCollectorIVARS *const ivars = OffsetColl_IVARS(self);
+    return Coll_Segment_Done(ivars->inner_coll);
+}
 
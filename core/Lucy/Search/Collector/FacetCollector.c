@@ -0,0 +1,282 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_FACETCOLLECTOR
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/Collector/FacetCollector.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/Util/SortUtils.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Index/SortCache.h"
+#include "Lucy/Index/SortCache/NumericSortCache.h"
+#include "Lucy/Index/SortReader.h"
+
+// Turn the current segment's top ordinals into values and add their counts
+// to the totals.
+static void
+S_merge_segment(FacetCollector *self);
+
+FacetCollector*
+FacetColl_new(String *field, uint32_t num_buckets) {
+    FacetCollector *self = (FacetCollector*)Class_Make_Obj(FACETCOLLECTOR);
+    return FacetColl_init(self, field, num_buckets);
+}
+
+FacetCollector*
+FacetColl_init(FacetCollector *self, String *field, uint32_t num_buckets) {
+    Coll_init((Collector*)self);
+    FacetCollectorIVARS *const ivars = FacetColl_IVARS(self);
+    ivars->field       = Str_Clone(field);
+    ivars->num_buckets = num_buckets;
+    ivars->seg_buckets = num_buckets + num_buckets / 2 + 10;
+    ivars->sort_cache  = NULL;
+    ivars->counts      = NULL;
+    ivars->cardinality = 0;
+    ivars->null_ord    = -1;
+    ivars->totals      = Hash_new(0);
+    ivars->values      = Hash_new(0);
+    ivars->total_hits  = 0;
+    ivars->num_values  = 0;
+    ivars->min         = 0.0;
+    ivars->max         = 0.0;
+    ivars->sum         = 0.0;
+    return self;
+}
+
+void
+FacetColl_Destroy_IMP(FacetCollector *self) {
+    FacetCollectorIVARS *const ivars = FacetColl_IVARS(self);
+    DECREF(ivars->field);
+    DECREF(ivars->sort_cache);
+    DECREF(ivars->totals);
+    DECREF(ivars->values);
+    FREEMEM(ivars->counts);
+    SUPER_DESTROY(self, FACETCOLLECTOR);
+}
+
+void
+FacetColl_Collect_IMP(FacetCollector *self, int32_t doc_id) {
+    FacetCollectorIVARS *const ivars = FacetColl_IVARS(self);
+    ivars->total_hits++;
+    if (ivars->sort_cache) {
+        ivars->counts[SortCache_Ordinal(ivars->sort_cache, doc_id)]++;
+    }
+}
+
+void
+FacetColl_Set_Reader_IMP(FacetCollector *self, SegReader *reader) {
+    FacetCollectorIVARS *const ivars = FacetColl_IVARS(self);
+    S_merge_segment(self);
+
+    SortReader *sort_reader
+        = reader
+          ? (SortReader*)SegReader_Fetch(reader, Class_Get_Name(SORTREADER))
+          : NULL;
+    SortCache *sort_cache
+        = sort_reader
+          ? SortReader_Fetch_Sort_Cache(sort_reader, ivars->field)
+          : NULL;
+    if (sort_cache) {
+        ivars->sort_cache  = (SortCache*)INCREF(sort_cache);
+        ivars->cardinality = SortCache_Get_Cardinality(sort_cache);
+        ivars->null_ord    = SortCache_Get_Null_Ord(sort_cache);
+        ivars->counts      = (uint32_t*)CALLOCATE((size_t)ivars->cardinality,
+                                                  sizeof(uint32_t));
+    }
+
+    FacetColl_Set_Reader_t super_set_reader
+        = (FacetColl_Set_Reader_t)SUPER_METHOD_PTR(FACETCOLLECTOR,
+                                                   LUCY_FacetColl_Set_Reader);
+    super_set_reader(self, reader);
+}
+
+static int
+S_compare_counts(void *context, const void *va, const void *vb) {
+    const uint32_t *counts = (const uint32_t*)context;
+    const int32_t a = *(const int32_t*)va;
+    const int32_t b = *(const int32_t*)vb;
+    if (counts[a] != counts[b]) { return counts[a] > counts[b] ? -1 : 1; }
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+// Read one value per distinct ordinal rather than one per hit.
+static void
+S_aggregate(FacetCollectorIVARS *ivars, NumericSortCache *sort_cache) {
+    for (int32_t ord = 0; ord < ivars->cardinality; ord++) {
+        uint32_t count = ivars->counts[ord];
+        if (!count || ord == ivars->null_ord) { continue; }
+        double value = NumSortCache_Value_To_F64(sort_cache, ord);
+        if (!ivars->num_values || value < ivars->min) { ivars->min = value; }
+        if (!ivars->num_values || value > ivars->max) { ivars->max = value; }
+        ivars->sum        += value * count;
+        ivars->num_values += count;
+    }
+}
+
+static void
+S_merge_segment(FacetCollector *self) {
+    FacetCollectorIVARS *const ivars = FacetColl_IVARS(self);
+    SortCache *sort_cache = ivars->sort_cache;
+    if (!sort_cache) { return; }
+
+    if (Obj_is_a((Obj*)sort_cache, NUMERICSORTCACHE)) {
+        S_aggregate(ivars, (NumericSortCache*)sort_cache);
+    }
+
+    // Gather the ordinals which were seen, then keep the most frequent.
+    int32_t *ords = (int32_t*)MALLOCATE(
+                        ((size_t)ivars->cardinality + 1) * sizeof(int32_t));
+    uint32_t num_ords = 0;
+    for (int32_t ord = 0; ord < ivars->cardinality; ord++) {
+        if (ivars->counts[ord] && ord != ivars->null_ord) {
+            ords[num_ords++] = ord;
+        }
+    }
+    if (num_ords > ivars->seg_buckets) {
+        int32_t *scratch
+            = (int32_t*)MALLOCATE(num_ords * sizeof(int32_t));
+        Sort_mergesort(ords, scratch, num_ords, sizeof(int32_t),
+                       S_compare_counts, ivars->counts);
+        FREEMEM(scratch);
+        num_ords = ivars->seg_buckets;
+    }
+
+    // Only now go from ordinals to values.
+    for (uint32_t i = 0; i < num_ords; i++) {
+        Obj    *value = SortCache_Value(sort_cache, ords[i]);
+        String *key   = Obj_To_String(value);
+        Integer *total = (Integer*)Hash_Fetch(ivars->totals, key);
+        int64_t  count = ivars->counts[ords[i]];
+        if (total) { count += Int_Get_Value(total); }
+        else       { Hash_Store(ivars->values, key, INCREF(value)); }
+        Hash_Store(ivars->totals, key, (Obj*)Int_new(count));
+        DECREF(key);
+        DECREF(value);
+    }
+
+    FREEMEM(ords);
+    FREEMEM(ivars->counts);
+    DECREF(ivars->sort_cache);
+    ivars->counts      = NULL;
+    ivars->sort_cache  = NULL;
+    ivars->cardinality = 0;
+    ivars->null_ord    = -1;
+}
+
+typedef struct {
+    String  *key;
+    int64_t  count;
+} S_Bucket;
+
+static int
+S_compare_buckets(void *context, const void *va, const void *vb) {
+    UNUSED_VAR(context);
+    const S_Bucket *a = (const S_Bucket*)va;
+    const S_Bucket *b = (const S_Bucket*)vb;
+    if (a->count != b->count) { return a->count > b->count ? -1 : 1; }
+    return Str_Compare_To(a->key, (Obj*)b->key);
+}
+
+Vector*
+FacetColl_Top_Values_IMP(FacetCollector *self) {
+    FacetCollectorIVARS *const ivars = FacetColl_IVARS(self);
+    S_merge_segment(self);
+
+    size_t    num_buckets = Hash_Get_Size(ivars->totals);
+    S_Bucket *buckets
+        = (S_Bucket*)MALLOCATE((num_buckets + 1) * sizeof(S_Bucket));
+    S_Bucket *scratch
+        = (S_Bucket*)MALLOCATE((num_buckets + 1) * sizeof(S_Bucket));
+    HashIterator *iter = HashIter_new(ivars->totals);
+    size_t i = 0;
+    while (HashIter_Next(iter)) {
+        buckets[i].key   = HashIter_Get_Key(iter);
+        buckets[i].count = Int_Get_Value((Integer*)HashIter_Get_Value(iter));
+        i++;
+    }
+    DECREF(iter);
+    Sort_mergesort(buckets, scratch, (uint32_t)num_buckets, sizeof(S_Bucket),
+                   S_compare_buckets, NULL);
+
+    size_t  num_wanted = num_buckets < ivars->num_buckets
+                         ? num_buckets
+                         : ivars->num_buckets;
+    Vector *top_values = Vec_new(num_wanted);
+    for (i = 0; i < num_wanted; i++) {
+        Obj *value = Hash_Fetch(ivars->values, buckets[i].key);
+        Vec_Push(top_values, INCREF(value));
+    }
+
+    FREEMEM(scratch);
+    FREEMEM(buckets);
+    return top_values;
+}
+
+uint32_t
+FacetColl_Get_Count_IMP(FacetCollector *self, Obj *value) {
+    FacetCollectorIVARS *const ivars = FacetColl_IVARS(self);
+    S_merge_segment(self);
+    if (!value) { return 0; }
+    String  *key   = Obj_To_String(value);
+    Integer *total = (Integer*)Hash_Fetch(ivars->totals, key);
+    DECREF(key);
+    return total ? (uint32_t)Int_Get_Value(total) : 0;
+}
+
+uint32_t
+FacetColl_Get_Total_Hits_IMP(FacetCollector *self) {
+    return FacetColl_IVARS(self)->total_hits;
+}
+
+uint32_t
+FacetColl_Get_Num_Values_IMP(FacetCollector *self) {
+    S_merge_segment(self);
+    return FacetColl_IVARS(self)->num_values;
+}
+
+double
+FacetColl_Get_Min_IMP(FacetCollector *self) {
+    S_merge_segment(self);
+    return FacetColl_IVARS(self)->min;
+}
+
+double
+FacetColl_Get_Max_IMP(FacetCollector *self) {
+    S_merge_segment(self);
+    return FacetColl_IVARS(self)->max;
+}
+
+double
+FacetColl_Get_Sum_IMP(FacetCollector *self) {
+    S_merge_segment(self);
+    return FacetColl_IVARS(self)->sum;
+}
+
+bool
+FacetColl_Need_Score_IMP(FacetCollector *self) {
+    UNUSED_VAR(self);
+    return false;
+}
+
+bool
+FacetColl_Accepts_Docs_Out_Of_Order_IMP(FacetCollector *self) {
+    UNUSED_VAR(self);
+    return true;
+}
+
+
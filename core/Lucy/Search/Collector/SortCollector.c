@@ -22,6 +22,7 @@
 
 #include "Lucy/Search/Collector/SortCollector.h"
 #include "Lucy/Index/SegReader.h"
+#include "Lucy/Index/Segment.h"
 #include "Lucy/Index/SortCache.h"
 #include "Lucy/Index/SortCache/NumericSortCache.h"
 #include "Lucy/Index/SortCache/TextSortCache.h"
@@ -33,6 +34,7 @@
 #include "Lucy/Search/Matcher.h"
 #include "Lucy/Search/SortRule.h"
 #include "Lucy/Search/SortSpec.h"
+#include "Lucy/Util/Json.h"
 #include "Lucy/Util/NumberUtils.h"
 
 #define COMPARE_BY_SCORE             0x1
@@ -68,6 +70,15 @@ S_derive_action(SortRule *rule, SortCache *sort_cache);
 static CFISH_INLINE bool
 SI_competitive(SortCollectorIVARS *ivars, int32_t doc_id);
 
+// Add a doc to the current segment's queue of top hits.
+static void
+S_push_seg_hit(SortCollectorIVARS *ivars, int32_t doc_id, float score);
+
+// Fetch the values for the current segment's top hits and move them into
+// the HitQueue.
+static void
+S_flush_seg_hits(SortCollectorIVARS *ivars);
+
 SortCollector*
 SortColl_new(Schema *schema, SortSpec *sort_spec, uint32_t wanted) {
     SortCollector *self = (SortCollector*)Class_Make_Obj(SORTCOLLECTOR);
@@ -103,9 +114,12 @@ SortColl_init(SortCollector *self, Schema *schema, SortSpec *sort_spec,
     Coll_init((Collector*)self);
     SortCollectorIVARS *const ivars = SortColl_IVARS(self);
     ivars->total_hits    = 0;
+    ivars->total_hits_threshold = UINT32_MAX;
     ivars->bubble_doc    = INT32_MAX;
     ivars->bubble_score  = CHY_F32_NEGINF;
     ivars->seg_doc_max   = 0;
+    ivars->seg_sorted    = false;
+    ivars->seg_done      = false;
 
     // Assign.
     ivars->wanted        = wanted;
@@ -140,13 +154,17 @@ SortColl_init(SortCollector *self, Schema *schema, SortSpec *sort_spec,
         }
     }
 
-    // Perform an optimization.  So long as we always collect docs in
-    // ascending order, Collect() will favor lower doc numbers -- so we may
-    // not need to execute a final COMPARE_BY_DOC_ID action.
+    // Documents can only be skipped on the basis of their scores if the
+    // score decides the sort order.
+    SortRule *first_rule = (SortRule*)Vec_Fetch(rules, 0);
+    ivars->score_first = SortRule_Get_Type(first_rule) == SortRule_SCORE
+                         && !SortRule_Get_Reverse(first_rule);
+
+    // Docs collected in ascending order never reach a final
+    // COMPARE_BY_DOC_ID action, since ties favor the docs already in the
+    // queue.  Keep it anyway: it is only evaluated on a tie, and Matchers
+    // which collect out of order rely on it.
     ivars->num_actions = num_rules;
-    if (ivars->actions[num_rules - 1] == COMPARE_BY_DOC_ID) {
-        ivars->num_actions--;
-    }
 
     // Override our derived actions with an action which will be excecuted
     // autmatically until the queue fills up.
@@ -162,6 +180,19 @@ SortColl_init(SortCollector *self, Schema *schema, SortSpec *sort_spec,
     ivars->bumped = MatchDoc_new(INT32_MAX, score, values);
     DECREF(values);
 
+    // When sorting by field values, the segment being searched keeps its
+    // own queue of doc ids and scores, ranked by ordinal.  Values are only
+    // fetched for the docs still in it when the segment is done.
+    ivars->seg_size = 0;
+    if (ivars->need_values) {
+        ivars->seg_doc_ids = (int32_t*)MALLOCATE(wanted * sizeof(int32_t));
+        ivars->seg_scores  = (float*)MALLOCATE(wanted * sizeof(float));
+    }
+    else {
+        ivars->seg_doc_ids = NULL;
+        ivars->seg_scores  = NULL;
+    }
+
     return self;
 }
 
@@ -175,6 +206,8 @@ SortColl_Destroy_IMP(SortCollector *self) {
     FREEMEM(ivars->ord_arrays);
     FREEMEM(ivars->auto_actions);
     FREEMEM(ivars->derived_actions);
+    FREEMEM(ivars->seg_doc_ids);
+    FREEMEM(ivars->seg_scores);
     SUPER_DESTROY(self, SORTCOLLECTOR);
 }
 
@@ -226,12 +259,60 @@ S_derive_action(SortRule *rule, SortCache *cache) {
     UNREACHABLE_RETURN(uint8_t);
 }
 
+// Decide whether the segment's docs are numbered in the order of our rules,
+// leaving aside a final ascending doc id rule: they must match the first
+// rules of the index sort the segment was written with.
+static bool
+S_follows_index_sort(SortCollectorIVARS *ivars, SegReader *reader) {
+    uint32_t  num_rules = ivars->num_rules;
+    SortRule *last_rule = (SortRule*)Vec_Fetch(ivars->rules, num_rules - 1);
+    if (SortRule_Get_Type(last_rule) == SortRule_DOC_ID
+        && !SortRule_Get_Reverse(last_rule)
+       ) {
+        num_rules--;
+    }
+    if (num_rules == 0) { return true; }
+
+    Segment *segment = SegReader_Get_Segment(reader);
+    Vector *index_sort
+        = (Vector*)Seg_Fetch_Metadata_Utf8(segment, "index_sort", 10);
+    if (!index_sort
+        || !Obj_is_a((Obj*)index_sort, VECTOR)
+        || Vec_Get_Size(index_sort) < num_rules
+       ) {
+        return false;
+    }
+    for (uint32_t i = 0; i < num_rules; i++) {
+        SortRule *rule  = (SortRule*)Vec_Fetch(ivars->rules, i);
+        Hash     *entry = (Hash*)Vec_Fetch(index_sort, i);
+        if (SortRule_Get_Type(rule) != SortRule_FIELD
+            || !entry
+            || !Obj_is_a((Obj*)entry, HASH)
+           ) {
+            return false;
+        }
+        Obj *field   = Hash_Fetch_Utf8(entry, "field", 5);
+        Obj *reverse = Hash_Fetch_Utf8(entry, "reverse", 7);
+        if (!field
+            || !reverse
+            || !Str_Equals(SortRule_Get_Field(rule), field)
+            || Json_obj_to_bool(reverse) != !!SortRule_Get_Reverse(rule)
+           ) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void
 SortColl_Set_Reader_IMP(SortCollector *self, SegReader *reader) {
     SortCollectorIVARS *const ivars = SortColl_IVARS(self);
     SortReader *sort_reader
         = (SortReader*)SegReader_Fetch(reader, Class_Get_Name(SORTREADER));
 
+    // Finish off the previous segment while its sort caches are at hand.
+    S_flush_seg_hits(ivars);
+
     // Reset threshold variables and trigger auto-action behavior.
     MatchDocIVARS *const bumped_ivars = MatchDoc_IVARS(ivars->bumped);
     bumped_ivars->doc_id = INT32_MAX;
@@ -255,6 +336,8 @@ SortColl_Set_Reader_IMP(SortCollector *self, SegReader *reader) {
         }
     }
     ivars->seg_doc_max = reader ? (uint32_t)SegReader_Doc_Max(reader) : 0;
+    ivars->seg_sorted  = reader ? S_follows_index_sort(ivars, reader) : false;
+    ivars->seg_done    = false;
     SortColl_Set_Reader_t super_set_reader
         = (SortColl_Set_Reader_t)SUPER_METHOD_PTR(SORTCOLLECTOR,
                                                   LUCY_SortColl_Set_Reader);
@@ -264,6 +347,7 @@ SortColl_Set_Reader_IMP(SortCollector *self, SegReader *reader) {
 Vector*
 SortColl_Pop_Match_Docs_IMP(SortCollector *self) {
     SortCollectorIVARS *const ivars = SortColl_IVARS(self);
+    S_flush_seg_hits(ivars);
     return HitQ_Pop_All(ivars->hit_q);
 }
 
@@ -272,6 +356,50 @@ SortColl_Get_Total_Hits_IMP(SortCollector *self) {
     return SortColl_IVARS(self)->total_hits;
 }
 
+void
+SortColl_Set_Total_Hits_Threshold_IMP(SortCollector *self,
+                                      uint32_t threshold) {
+    SortColl_IVARS(self)->total_hits_threshold = threshold;
+}
+
+float
+SortColl_Competitive_Score_IMP(SortCollector *self) {
+    SortCollectorIVARS *const ivars = SortColl_IVARS(self);
+    if (!ivars->score_first
+        || !ivars->wanted
+        || ivars->total_hits < ivars->total_hits_threshold
+       ) {
+        return CHY_F32_NEGINF;
+    }
+
+    // The least MatchDoc in a full queue sets the bar for all segments.  A
+    // full segment queue sets one for the rest of its segment.
+    float threshold = CHY_F32_NEGINF;
+    if (HitQ_Get_Size(ivars->hit_q) == ivars->wanted) {
+        MatchDoc *least = (MatchDoc*)HitQ_Peek(ivars->hit_q);
+        threshold = MatchDoc_IVARS(least)->score;
+    }
+    if (ivars->seg_size == ivars->wanted
+        && ivars->seg_scores[0] > threshold
+       ) {
+        threshold = ivars->seg_scores[0];
+    }
+    return threshold;
+}
+
+bool
+SortColl_Accepts_Docs_Out_Of_Order_IMP(SortCollector *self) {
+    SortCollectorIVARS *const ivars = SortColl_IVARS(self);
+    return ivars->score_first
+           && ivars->derived_actions[ivars->num_rules - 1]
+              == COMPARE_BY_DOC_ID;
+}
+
+bool
+SortColl_Segment_Done_IMP(SortCollector *self) {
+    return SortColl_IVARS(self)->seg_done;
+}
+
 bool
 SortColl_Need_Score_IMP(SortCollector *self) {
     return SortColl_IVARS(self)->need_score;
@@ -288,29 +416,23 @@ SortColl_Collect_IMP(SortCollector *self, int32_t doc_id) {
     if (SI_competitive(ivars, doc_id)) {
         MatchDoc *const match_doc = ivars->bumped;
         MatchDocIVARS *const match_doc_ivars = MatchDoc_IVARS(match_doc);
-        match_doc_ivars->doc_id = doc_id + ivars->base;
 
         if (ivars->need_score && match_doc_ivars->score == CHY_F32_NEGINF) {
             match_doc_ivars->score = Matcher_Score(ivars->matcher);
         }
 
-        // Fetch values so that cross-segment sorting can work.
+        // Rank by ordinal within the segment.  Values, which are needed for
+        // cross-segment sorting, wait until the segment is done.
         if (ivars->need_values) {
-            Vector *values = match_doc_ivars->values;
-
-            for (uint32_t i = 0, max = ivars->num_rules; i < max; i++) {
-                SortCache *cache   = ivars->sort_caches[i];
-                Obj       *old_val = Vec_Delete(values, i);
-                DECREF(old_val);
-                if (cache) {
-                    int32_t ord = SortCache_Ordinal(cache, doc_id);
-                    Obj *val = SortCache_Value(cache, ord);
-                    if (val) { Vec_Store(values, i, (Obj*)val); }
-                }
-            }
+            S_push_seg_hit(ivars, doc_id, match_doc_ivars->score);
+            match_doc_ivars->score = ivars->need_score
+                                     ? CHY_F32_NEGINF
+                                     : CHY_F32_NAN;
+            return;
         }
 
         // Insert the new MatchDoc.
+        match_doc_ivars->doc_id = doc_id + ivars->base;
         ivars->bumped = (MatchDoc*)HitQ_Jostle(ivars->hit_q, (Obj*)match_doc);
 
         if (ivars->bumped) {
@@ -342,6 +464,123 @@ SortColl_Collect_IMP(SortCollector *self, int32_t doc_id) {
         }
 
     }
+    else if (ivars->seg_sorted
+             && ivars->total_hits >= ivars->total_hits_threshold
+            ) {
+        // This segment's docs arrive in our sort order, so none of those
+        // still to come can compete either.
+        ivars->seg_done = true;
+    }
+}
+
+// Compare two docs from the current segment the way the HitQueue would
+// compare their MatchDocs, but by ordinal rather than by value.  Return a
+// negative number if `a` sorts ahead of `b`.  Ordinals order NULLs last, as
+// FType_null_back_compare_values does.
+static int32_t
+S_compare_seg_hits(SortCollectorIVARS *ivars, int32_t a_doc, float a_score,
+                   int32_t b_doc, float b_score) {
+    for (uint32_t i = 0, max = ivars->num_rules; i < max; i++) {
+        SortRule *rule      = (SortRule*)Vec_Fetch(ivars->rules, i);
+        int32_t   rule_type = SortRule_Get_Type(rule);
+        int32_t   comparison;
+        if (rule_type == SortRule_SCORE) {
+            comparison = a_score > b_score ? -1 : a_score < b_score ? 1 : 0;
+        }
+        else if (rule_type == SortRule_DOC_ID) {
+            comparison = a_doc < b_doc ? -1 : a_doc > b_doc ? 1 : 0;
+        }
+        else {
+            SortCache *cache = ivars->sort_caches[i];
+            if (!cache) { continue; }
+            int32_t a_ord = SortCache_Ordinal(cache, a_doc);
+            int32_t b_ord = SortCache_Ordinal(cache, b_doc);
+            comparison = a_ord < b_ord ? -1 : a_ord > b_ord ? 1 : 0;
+        }
+        if (comparison) {
+            return SortRule_Get_Reverse(rule) ? -comparison : comparison;
+        }
+    }
+    return 0;
+}
+
+// The segment queue is a binary heap with the doc which sorts last on top.
+static void
+S_push_seg_hit(SortCollectorIVARS *ivars, int32_t doc_id, float score) {
+    int32_t *const doc_ids = ivars->seg_doc_ids;
+    float   *const scores  = ivars->seg_scores;
+
+    if (ivars->seg_size < ivars->wanted) {
+        uint32_t i = ivars->seg_size++;
+        while (i > 0) {
+            uint32_t parent = (i - 1) / 2;
+            if (S_compare_seg_hits(ivars, doc_id, score, doc_ids[parent],
+                                   scores[parent]) <= 0) {
+                break;
+            }
+            doc_ids[i] = doc_ids[parent];
+            scores[i]  = scores[parent];
+            i = parent;
+        }
+        doc_ids[i] = doc_id;
+        scores[i]  = score;
+        if (ivars->seg_size < ivars->wanted) { return; }
+
+        // The queue is full, so start testing whether hits are competitive.
+        ivars->actions = ivars->derived_actions;
+    }
+    else {
+        // SI_competitive() has established that the doc beats the one on
+        // top, so replace it.
+        uint32_t size = ivars->seg_size;
+        uint32_t i    = 0;
+        while (true) {
+            uint32_t child = 2 * i + 1;
+            if (child >= size) { break; }
+            if (child + 1 < size
+                && S_compare_seg_hits(ivars, doc_ids[child + 1],
+                                      scores[child + 1], doc_ids[child],
+                                      scores[child]) > 0
+               ) {
+                child++;
+            }
+            if (S_compare_seg_hits(ivars, doc_ids[child], scores[child],
+                                   doc_id, score) <= 0) {
+                break;
+            }
+            doc_ids[i] = doc_ids[child];
+            scores[i]  = scores[child];
+            i = child;
+        }
+        doc_ids[i] = doc_id;
+        scores[i]  = score;
+    }
+
+    // The doc on top is the one to beat.
+    ivars->bubble_doc   = (uint32_t)doc_ids[0];
+    ivars->bubble_score = scores[0];
+}
+
+static void
+S_flush_seg_hits(SortCollectorIVARS *ivars) {
+    for (uint32_t i = 0; i < ivars->seg_size; i++) {
+        int32_t doc_id = ivars->seg_doc_ids[i];
+        Vector *values = Vec_new(ivars->num_rules);
+        for (uint32_t j = 0, max = ivars->num_rules; j < max; j++) {
+            SortCache *cache = ivars->sort_caches[j];
+            if (cache) {
+                int32_t ord = SortCache_Ordinal(cache, doc_id);
+                Obj *val = SortCache_Value(cache, ord);
+                if (val) { Vec_Store(values, j, val); }
+            }
+        }
+        MatchDoc *match_doc = MatchDoc_new(doc_id + ivars->base,
+                                           ivars->seg_scores[i], values);
+        Obj *bumped = HitQ_Jostle(ivars->hit_q, (Obj*)match_doc);
+        DECREF(bumped);
+        DECREF(values);
+    }
+    ivars->seg_size = 0;
 }
 
 static CFISH_INLINE int32_t
@@ -0,0 +1,241 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_FILTERCACHE
+#define C_LUCY_FILTERCACHEENTRY
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/HashIterator.h"
+#include "Lucy/Search/FilterCache.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Object/I32Array.h"
+#include "Lucy/Search/Query.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Store/RAMFile.h"
+#include "Lucy/Util/Freezer.h"
+
+// Rough cost of an entry apart from its set of docs.
+#define ENTRY_OVERHEAD 64
+
+static String*
+S_make_key(Query *query);
+
+static Query*
+S_copy_query(Query *query);
+
+static size_t
+S_doc_set_bytes(Obj *doc_set);
+
+// Remove the least recently used entry.
+static void
+S_evict(FilterCache *self);
+
+FilterCache*
+FilterCache_new(size_t budget) {
+    FilterCache *self = (FilterCache*)Class_Make_Obj(FILTERCACHE);
+    return FilterCache_init(self, budget);
+}
+
+FilterCache*
+FilterCache_init(FilterCache *self, size_t budget) {
+    FilterCacheIVARS *const ivars = FilterCache_IVARS(self);
+    ivars->entries  = Hash_new(0);
+    ivars->budget   = budget;
+    ivars->consumed = 0;
+    ivars->clock    = 0;
+    ivars->size     = 0;
+    return self;
+}
+
+void
+FilterCache_Destroy_IMP(FilterCache *self) {
+    FilterCacheIVARS *const ivars = FilterCache_IVARS(self);
+    DECREF(ivars->entries);
+    SUPER_DESTROY(self, FILTERCACHE);
+}
+
+static String*
+S_make_key(Query *query) {
+    String *string = Query_To_String(query);
+    String *key = Str_newf("%o %o", Obj_get_class_name((Obj*)query), string);
+    DECREF(string);
+    return key;
+}
+
+// Entries keep a copy of their query made by round-tripping it through
+// FREEZE and THAW, so that a caller who goes on to change the one it passed
+// in (with Set_Boost, say) can't alter a stored key.
+static Query*
+S_copy_query(Query *query) {
+    RAMFile *ram_file = RAMFile_new(NULL, false);
+    OutStream *outstream = OutStream_open((Obj*)ram_file);
+    FREEZE(query, outstream);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+
+    InStream *instream = InStream_open((Obj*)ram_file);
+    Query *copy = (Query*)THAW(instream);
+    DECREF(instream);
+    DECREF(ram_file);
+    return copy;
+}
+
+static size_t
+S_doc_set_bytes(Obj *doc_set) {
+    if (Obj_is_a(doc_set, BITVECTOR)) {
+        return BitVec_Get_Capacity((BitVector*)doc_set) / 8;
+    }
+    else {
+        I32Array *doc_ids = (I32Array*)CERTIFY(doc_set, I32ARRAY);
+        return I32Arr_Get_Size(doc_ids) * sizeof(int32_t);
+    }
+}
+
+Obj*
+FilterCache_Fetch_IMP(FilterCache *self, Query *query) {
+    FilterCacheIVARS *const ivars = FilterCache_IVARS(self);
+    String *key = S_make_key(query);
+    Vector *bucket = (Vector*)Hash_Fetch(ivars->entries, key);
+    DECREF(key);
+    if (!bucket) { return NULL; }
+
+    for (size_t i = 0, max = Vec_Get_Size(bucket); i < max; i++) {
+        FilterCacheEntry *entry = (FilterCacheEntry*)Vec_Fetch(bucket, i);
+        FilterCacheEntryIVARS *const entry_ivars
+            = FilterCacheEntry_IVARS(entry);
+        if (Query_Equals(query, (Obj*)entry_ivars->query)) {
+            entry_ivars->stamp = ++ivars->clock;
+            return entry_ivars->doc_set;
+        }
+    }
+    return NULL;
+}
+
+void
+FilterCache_Store_IMP(FilterCache *self, Query *query, Obj *doc_set) {
+    FilterCacheIVARS *const ivars = FilterCache_IVARS(self);
+    size_t bytes = S_doc_set_bytes(doc_set) + ENTRY_OVERHEAD;
+    if (bytes > ivars->budget) { return; }
+    if (FilterCache_Fetch(self, query)) { return; }
+
+    while (ivars->consumed + bytes > ivars->budget) {
+        S_evict(self);
+    }
+
+    Query  *copy   = S_copy_query(query);
+    String *key    = S_make_key(copy);
+    Vector *bucket = (Vector*)Hash_Fetch(ivars->entries, key);
+    if (!bucket) {
+        bucket = Vec_new(1);
+        Hash_Store(ivars->entries, key, (Obj*)bucket);
+    }
+    DECREF(key);
+
+    FilterCacheEntry *entry = FilterCacheEntry_new(copy, doc_set, bytes);
+    DECREF(copy);
+    FilterCacheEntry_IVARS(entry)->stamp = ++ivars->clock;
+    Vec_Push(bucket, (Obj*)entry);
+    ivars->consumed += bytes;
+    ivars->size++;
+}
+
+static void
+S_evict(FilterCache *self) {
+    FilterCacheIVARS *const ivars = FilterCache_IVARS(self);
+    Vector   *oldest_bucket = NULL;
+    size_t    oldest_tick   = 0;
+    uint64_t  oldest_stamp  = UINT64_MAX;
+
+    HashIterator *iter = HashIter_new(ivars->entries);
+    while (HashIter_Next(iter)) {
+        Vector *bucket = (Vector*)HashIter_Get_Value(iter);
+        for (size_t i = 0, max = Vec_Get_Size(bucket); i < max; i++) {
+            FilterCacheEntry *entry = (FilterCacheEntry*)Vec_Fetch(bucket, i);
+            uint64_t stamp = FilterCacheEntry_IVARS(entry)->stamp;
+            if (stamp < oldest_stamp) {
+                oldest_bucket = bucket;
+                oldest_tick   = i;
+                oldest_stamp  = stamp;
+            }
+        }
+    }
+    DECREF(iter);
+    if (!oldest_bucket) {
+        THROW(ERR, "Filter cache accounting is off: %u64 bytes with no "
+              "entries", (uint64_t)ivars->consumed);
+    }
+
+    // Empty buckets are left in place; they cost little and the key is
+    // likely to be seen again.
+    FilterCacheEntry *evicted
+        = (FilterCacheEntry*)Vec_Fetch(oldest_bucket, oldest_tick);
+    ivars->consumed -= FilterCacheEntry_IVARS(evicted)->bytes;
+    ivars->size--;
+    Vec_Excise(oldest_bucket, oldest_tick, 1);
+}
+
+void
+FilterCache_Clear_IMP(FilterCache *self) {
+    FilterCacheIVARS *const ivars = FilterCache_IVARS(self);
+    Hash_Clear(ivars->entries);
+    ivars->consumed = 0;
+    ivars->size     = 0;
+}
+
+uint32_t
+FilterCache_Get_Size_IMP(FilterCache *self) {
+    return FilterCache_IVARS(self)->size;
+}
+
+size_t
+FilterCache_Get_Consumed_IMP(FilterCache *self) {
+    return FilterCache_IVARS(self)->consumed;
+}
+
+size_t
+FilterCache_Get_Budget_IMP(FilterCache *self) {
+    return FilterCache_IVARS(self)->budget;
+}
+
+/***************************************************************************/
+
+FilterCacheEntry*
+FilterCacheEntry_new(Query *query, Obj *doc_set, size_t bytes) {
+    FilterCacheEntry *self
+        = (FilterCacheEntry*)Class_Make_Obj(FILTERCACHEENTRY);
+    return FilterCacheEntry_init(self, query, doc_set, bytes);
+}
+
+FilterCacheEntry*
+FilterCacheEntry_init(FilterCacheEntry *self, Query *query, Obj *doc_set,
+                      size_t bytes) {
+    FilterCacheEntryIVARS *const ivars = FilterCacheEntry_IVARS(self);
+    ivars->query   = (Query*)INCREF(query);
+    ivars->doc_set = INCREF(doc_set);
+    ivars->bytes   = bytes;
+    ivars->stamp   = 0;
+    return self;
+}
+
+void
+FilterCacheEntry_Destroy_IMP(FilterCacheEntry *self) {
+    FilterCacheEntryIVARS *const ivars = FilterCacheEntry_IVARS(self);
+    DECREF(ivars->query);
+    DECREF(ivars->doc_set);
+    SUPER_DESTROY(self, FILTERCACHEENTRY);
+}
+
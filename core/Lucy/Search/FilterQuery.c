@@ -0,0 +1,176 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_FILTERQUERY
+#define C_LUCY_FILTERCOMPILER
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/FilterQuery.h"
+#include "Lucy/Index/DocVector.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Object/I32Array.h"
+#include "Lucy/Search/BitVecMatcher.h"
+#include "Lucy/Search/FilterCache.h"
+#include "Lucy/Search/I32ArrayMatcher.h"
+#include "Lucy/Search/Searcher.h"
+
+// Sets with no more than one match per this many docs are stored as arrays
+// of doc ids, which then take up less space than a bit vector.
+#define SPARSE_RATIO 32
+
+// Run `matcher` to the end, returning the docs it matched as a BitVector or
+// an I32Array.
+static Obj*
+S_gather(Matcher *matcher, int32_t doc_max);
+
+FilterQuery*
+FilterQuery_new(Query *query) {
+    FilterQuery *self = (FilterQuery*)Class_Make_Obj(FILTERQUERY);
+    return FilterQuery_init(self, query);
+}
+
+FilterQuery*
+FilterQuery_init(FilterQuery *self, Query *query) {
+    self = (FilterQuery*)PolyQuery_init((PolyQuery*)self, NULL);
+    FilterQuery_Set_Boost(self, 0.0f);
+    FilterQuery_Add_Child(self, query);
+    return self;
+}
+
+Query*
+FilterQuery_Get_Query_IMP(FilterQuery *self) {
+    FilterQueryIVARS *const ivars = FilterQuery_IVARS(self);
+    return (Query*)Vec_Fetch(ivars->children, 0);
+}
+
+String*
+FilterQuery_To_String_IMP(FilterQuery *self) {
+    FilterQueryIVARS *const ivars = FilterQuery_IVARS(self);
+    String *query_string = Obj_To_String(Vec_Fetch(ivars->children, 0));
+    String *retval = Str_newf("Filter(%o)", query_string);
+    DECREF(query_string);
+    return retval;
+}
+
+bool
+FilterQuery_Equals_IMP(FilterQuery *self, Obj *other) {
+    if ((FilterQuery*)other == self)   { return true; }
+    if (!Obj_is_a(other, FILTERQUERY)) { return false; }
+    FilterQuery_Equals_t super_equals
+        = (FilterQuery_Equals_t)SUPER_METHOD_PTR(FILTERQUERY,
+                                                 LUCY_FilterQuery_Equals);
+    return super_equals(self, other);
+}
+
+Compiler*
+FilterQuery_Make_Compiler_IMP(FilterQuery *self, Searcher *searcher,
+                              float boost, bool subordinate) {
+    FilterCompiler *compiler = FilterCompiler_new(self, searcher, boost);
+    if (!subordinate) {
+        FilterCompiler_Normalize(compiler);
+    }
+    return (Compiler*)compiler;
+}
+
+/**********************************************************************/
+
+FilterCompiler*
+FilterCompiler_new(FilterQuery *parent, Searcher *searcher, float boost) {
+    FilterCompiler *self = (FilterCompiler*)Class_Make_Obj(FILTERCOMPILER);
+    return FilterCompiler_init(self, parent, searcher, boost);
+}
+
+FilterCompiler*
+FilterCompiler_init(FilterCompiler *self, FilterQuery *parent,
+                    Searcher *searcher, float boost) {
+    PolyCompiler_init((PolyCompiler*)self, (PolyQuery*)parent, searcher,
+                      boost);
+    return self;
+}
+
+float
+FilterCompiler_Sum_Of_Squared_Weights_IMP(FilterCompiler *self) {
+    UNUSED_VAR(self);
+    return 0.0f;
+}
+
+Vector*
+FilterCompiler_Highlight_Spans_IMP(FilterCompiler *self, Searcher *searcher,
+                                   DocVector *doc_vec, String *field) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(searcher);
+    UNUSED_VAR(doc_vec);
+    UNUSED_VAR(field);
+    return Vec_new(0);
+}
+
+Matcher*
+FilterCompiler_Make_Matcher_IMP(FilterCompiler *self, SegReader *reader,
+                                bool need_score) {
+    FilterCompilerIVARS *const ivars = FilterCompiler_IVARS(self);
+    Query       *query   = FilterQuery_Get_Query((FilterQuery*)ivars->parent);
+    FilterCache *cache   = SegReader_Get_Filter_Cache(reader);
+    Obj         *doc_set = INCREF(FilterCache_Fetch(cache, query));
+    UNUSED_VAR(need_score);
+
+    if (!doc_set) {
+        Compiler *child_compiler
+            = (Compiler*)CERTIFY(Vec_Fetch(ivars->children, 0), COMPILER);
+        Matcher *matcher
+            = Compiler_Make_Matcher(child_compiler, reader, false);
+        doc_set = matcher
+                  ? S_gather(matcher, SegReader_Doc_Max(reader))
+                  : (Obj*)I32Arr_new_blank(0);
+        FilterCache_Store(cache, query, doc_set);
+        DECREF(matcher);
+    }
+
+    Matcher *retval = NULL;
+    if (Obj_is_a(doc_set, BITVECTOR)) {
+        retval = (Matcher*)BitVecMatcher_new((BitVector*)doc_set);
+    }
+    else if (I32Arr_Get_Size((I32Array*)doc_set)) {
+        retval = (Matcher*)I32ArrMatcher_new((I32Array*)doc_set);
+    }
+    DECREF(doc_set);
+    return retval;
+}
+
+static Obj*
+S_gather(Matcher *matcher, int32_t doc_max) {
+    BitVector *bit_vec = BitVec_new((size_t)doc_max + 1);
+    size_t     count   = 0;
+    int32_t    doc_id;
+    while (0 != (doc_id = Matcher_Next(matcher))) {
+        BitVec_Set(bit_vec, (size_t)doc_id);
+        count++;
+    }
+    if (count > (size_t)doc_max / SPARSE_RATIO) {
+        return (Obj*)bit_vec;
+    }
+
+    int32_t *doc_ids = (int32_t*)MALLOCATE((count + 1) * sizeof(int32_t));
+    size_t   num_ids = 0;
+    doc_id = BitVec_Next_Hit(bit_vec, 0);
+    while (doc_id != -1) {
+        doc_ids[num_ids++] = doc_id;
+        doc_id = BitVec_Next_Hit(bit_vec, (size_t)doc_id + 1);
+    }
+    DECREF(bit_vec);
+    return (Obj*)I32Arr_new_steal(doc_ids, num_ids);
+}
+
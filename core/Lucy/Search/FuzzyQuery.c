@@ -0,0 +1,165 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_FUZZYQUERY
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/FuzzyQuery.h"
+#include "Lucy/Search/TermAutomaton.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/Freezer.h"
+#include "Lucy/Util/Json.h"
+
+FuzzyQuery*
+FuzzyQuery_new(String *field, String *term, uint32_t max_edits,
+               uint32_t prefix_length, uint32_t max_terms, int32_t rewrite) {
+    FuzzyQuery *self = (FuzzyQuery*)Class_Make_Obj(FUZZYQUERY);
+    return FuzzyQuery_init(self, field, term, max_edits, prefix_length,
+                           max_terms, rewrite);
+}
+
+FuzzyQuery*
+FuzzyQuery_init(FuzzyQuery *self, String *field, String *term,
+                uint32_t max_edits, uint32_t prefix_length,
+                uint32_t max_terms, int32_t rewrite) {
+    MultiTermQuery_init((MultiTermQuery*)self, field, max_terms, rewrite);
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    ivars->term          = Str_Clone(term);
+    ivars->max_edits     = max_edits;
+    ivars->prefix_length = prefix_length;
+    if (max_edits > 2) {
+        DECREF(self);
+        THROW(ERR, "max_edits can't be greater than 2: %u32", max_edits);
+    }
+    if (prefix_length > UINT8_MAX) {
+        DECREF(self);
+        THROW(ERR, "prefix_length can't be greater than 255: %u32",
+              prefix_length);
+    }
+    return self;
+}
+
+void
+FuzzyQuery_Destroy_IMP(FuzzyQuery *self) {
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    DECREF(ivars->term);
+    SUPER_DESTROY(self, FUZZYQUERY);
+}
+
+String*
+FuzzyQuery_Get_Term_IMP(FuzzyQuery *self) {
+    return FuzzyQuery_IVARS(self)->term;
+}
+
+uint32_t
+FuzzyQuery_Get_Max_Edits_IMP(FuzzyQuery *self) {
+    return FuzzyQuery_IVARS(self)->max_edits;
+}
+
+uint32_t
+FuzzyQuery_Get_Prefix_Length_IMP(FuzzyQuery *self) {
+    return FuzzyQuery_IVARS(self)->prefix_length;
+}
+
+TermAutomaton*
+FuzzyQuery_Make_Automaton_IMP(FuzzyQuery *self) {
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    return (TermAutomaton*)LevAuto_new(ivars->term, ivars->max_edits,
+                                       ivars->prefix_length);
+}
+
+float
+FuzzyQuery_Term_Boost_IMP(FuzzyQuery *self, int32_t cost) {
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    return 1.0f - (float)cost / (float)(ivars->max_edits + 1);
+}
+
+String*
+FuzzyQuery_To_String_IMP(FuzzyQuery *self) {
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    return Str_newf("%o:%o~%u32", ivars->field, ivars->term,
+                    ivars->max_edits);
+}
+
+bool
+FuzzyQuery_Equals_IMP(FuzzyQuery *self, Obj *other) {
+    if ((FuzzyQuery*)other == self)                   { return true; }
+    if (!Obj_is_a(other, FUZZYQUERY))                 { return false; }
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    FuzzyQueryIVARS *const ovars = FuzzyQuery_IVARS((FuzzyQuery*)other);
+    if (!Str_Equals(ivars->term, (Obj*)ovars->term))  { return false; }
+    if (ivars->max_edits != ovars->max_edits)         { return false; }
+    if (ivars->prefix_length != ovars->prefix_length) { return false; }
+    FuzzyQuery_Equals_t super_equals
+        = SUPER_METHOD_PTR(FUZZYQUERY, LUCY_FuzzyQuery_Equals);
+    return super_equals(self, other);
+}
+
+void
+FuzzyQuery_Serialize_IMP(FuzzyQuery *self, OutStream *outstream) {
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    FuzzyQuery_Serialize_t super_serialize
+        = SUPER_METHOD_PTR(FUZZYQUERY, LUCY_FuzzyQuery_Serialize);
+    super_serialize(self, outstream);
+    Freezer_serialize_string(ivars->term, outstream);
+    OutStream_Write_CU32(outstream, ivars->max_edits);
+    OutStream_Write_CU32(outstream, ivars->prefix_length);
+}
+
+FuzzyQuery*
+FuzzyQuery_Deserialize_IMP(FuzzyQuery *self, InStream *instream) {
+    FuzzyQuery_Deserialize_t super_deserialize
+        = SUPER_METHOD_PTR(FUZZYQUERY, LUCY_FuzzyQuery_Deserialize);
+    self = super_deserialize(self, instream);
+    FuzzyQueryIVARS *const ivars = FuzzyQuery_IVARS(self);
+    ivars->term          = Freezer_read_string(instream);
+    ivars->max_edits     = InStream_Read_CU32(instream);
+    ivars->prefix_length = InStream_Read_CU32(instream);
+    return self;
+}
+
+Obj*
+FuzzyQuery_Dump_IMP(FuzzyQuery *self) {
+    FuzzyQueryIVARS *ivars = FuzzyQuery_IVARS(self);
+    FuzzyQuery_Dump_t super_dump
+        = SUPER_METHOD_PTR(FUZZYQUERY, LUCY_FuzzyQuery_Dump);
+    Hash *dump = (Hash*)CERTIFY(super_dump(self), HASH);
+    Hash_Store_Utf8(dump, "term", 4, Freezer_dump((Obj*)ivars->term));
+    Hash_Store_Utf8(dump, "max_edits", 9,
+                    (Obj*)Str_newf("%u32", ivars->max_edits));
+    Hash_Store_Utf8(dump, "prefix_length", 13,
+                    (Obj*)Str_newf("%u32", ivars->prefix_length));
+    return (Obj*)dump;
+}
+
+Obj*
+FuzzyQuery_Load_IMP(FuzzyQuery *self, Obj *dump) {
+    Hash *source = (Hash*)CERTIFY(dump, HASH);
+    FuzzyQuery_Load_t super_load
+        = SUPER_METHOD_PTR(FUZZYQUERY, LUCY_FuzzyQuery_Load);
+    FuzzyQuery *loaded = (FuzzyQuery*)super_load(self, dump);
+    FuzzyQueryIVARS *loaded_ivars = FuzzyQuery_IVARS(loaded);
+    Obj *term = CERTIFY(Hash_Fetch_Utf8(source, "term", 4), OBJ);
+    loaded_ivars->term = (String*)CERTIFY(Freezer_load(term), STRING);
+    Obj *max_edits = CERTIFY(Hash_Fetch_Utf8(source, "max_edits", 9), OBJ);
+    loaded_ivars->max_edits = (uint32_t)Json_obj_to_i64(max_edits);
+    Obj *prefix_length
+        = CERTIFY(Hash_Fetch_Utf8(source, "prefix_length", 13), OBJ);
+    loaded_ivars->prefix_length = (uint32_t)Json_obj_to_i64(prefix_length);
+    return (Obj*)loaded;
+}
+
@@ -0,0 +1,101 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_I32ARRAYMATCHER
+#define C_LUCY_I32ARRAY
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/I32ArrayMatcher.h"
+#include "Lucy/Object/I32Array.h"
+
+I32ArrayMatcher*
+I32ArrMatcher_new(I32Array *doc_ids) {
+    I32ArrayMatcher *self
+        = (I32ArrayMatcher*)Class_Make_Obj(I32ARRAYMATCHER);
+    return I32ArrMatcher_init(self, doc_ids);
+}
+
+I32ArrayMatcher*
+I32ArrMatcher_init(I32ArrayMatcher *self, I32Array *doc_ids) {
+    Matcher_init((Matcher*)self);
+    I32ArrayMatcherIVARS *const ivars = I32ArrMatcher_IVARS(self);
+    ivars->doc_ids = (I32Array*)INCREF(doc_ids);
+    ivars->ids     = I32Arr_IVARS(doc_ids)->ints;
+    ivars->size    = I32Arr_Get_Size(doc_ids);
+    ivars->tick    = 0;
+    ivars->doc_id  = 0;
+    return self;
+}
+
+void
+I32ArrMatcher_Destroy_IMP(I32ArrayMatcher *self) {
+    I32ArrayMatcherIVARS *const ivars = I32ArrMatcher_IVARS(self);
+    DECREF(ivars->doc_ids);
+    SUPER_DESTROY(self, I32ARRAYMATCHER);
+}
+
+int32_t
+I32ArrMatcher_Next_IMP(I32ArrayMatcher *self) {
+    I32ArrayMatcherIVARS *const ivars = I32ArrMatcher_IVARS(self);
+    if (ivars->tick >= ivars->size) {
+        ivars->doc_id = 0;
+        return 0;
+    }
+    ivars->doc_id = ivars->ids[ivars->tick++];
+    return ivars->doc_id;
+}
+
+int32_t
+I32ArrMatcher_Advance_IMP(I32ArrayMatcher *self, int32_t target) {
+    I32ArrayMatcherIVARS *const ivars = I32ArrMatcher_IVARS(self);
+    const int32_t *const ids = ivars->ids;
+    size_t lo = ivars->tick;
+    size_t hi = ivars->size;
+
+    // Gallop to find a window which holds the target, then binary search
+    // within it.
+    size_t step = 1;
+    while (lo + step < hi && ids[lo + step] < target) {
+        lo += step;
+        step *= 2;
+    }
+    if (lo + step < hi) { hi = lo + step + 1; }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ids[mid] < target) { lo = mid + 1; }
+        else                   { hi = mid; }
+    }
+
+    ivars->tick = lo;
+    return I32ArrMatcher_Next(self);
+}
+
+float
+I32ArrMatcher_Score_IMP(I32ArrayMatcher* self) {
+    UNUSED_VAR(self);
+    return 0.0f;
+}
+
+int32_t
+I32ArrMatcher_Get_Doc_ID_IMP(I32ArrayMatcher* self) {
+    return I32ArrMatcher_IVARS(self)->doc_id;
+}
+
+int64_t
+I32ArrMatcher_Cost_IMP(I32ArrayMatcher *self) {
+    return (int64_t)I32ArrMatcher_IVARS(self)->size;
+}
+
@@ -0,0 +1,119 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_IMPACTMATCHER
+#define C_LUCY_TERMMATCHER
+#define C_LUCY_SCOREPOSTING
+#define C_LUCY_BITVECMATCHER
+#include "Lucy/Util/ToolSet.h"
+
+#include <float.h>
+
+#include "Lucy/Search/ImpactMatcher.h"
+#include "Lucy/Index/Posting/ScorePosting.h"
+#include "Lucy/Index/PostingList.h"
+#include "Lucy/Index/Similarity.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Search/BitVecMatcher.h"
+#include "Lucy/Search/Collector.h"
+#include "Lucy/Search/Compiler.h"
+#include "Lucy/Store/InStream.h"
+
+ImpactMatcher*
+ImpactMatcher_new(Similarity *sim, PostingList *plist, Compiler *compiler,
+                  InStream *impact_stream) {
+    ImpactMatcher *self = (ImpactMatcher*)Class_Make_Obj(IMPACTMATCHER);
+    return ImpactMatcher_init(self, sim, plist, compiler, impact_stream);
+}
+
+ImpactMatcher*
+ImpactMatcher_init(ImpactMatcher *self, Similarity *sim, PostingList *plist,
+                   Compiler *compiler, InStream *impact_stream) {
+    ScorePostMatcher_init((ScorePostingMatcher*)self, sim, plist, compiler);
+    ImpactMatcherIVARS *const ivars = ImpactMatcher_IVARS(self);
+    ivars->impact_stream = (InStream*)INCREF(impact_stream);
+    return self;
+}
+
+void
+ImpactMatcher_Destroy_IMP(ImpactMatcher *self) {
+    ImpactMatcherIVARS *const ivars = ImpactMatcher_IVARS(self);
+    if (ivars->impact_stream) {
+        InStream_Close(ivars->impact_stream);
+        DECREF(ivars->impact_stream);
+    }
+    SUPER_DESTROY(self, IMPACTMATCHER);
+}
+
+void
+ImpactMatcher_Collect_IMP(ImpactMatcher *self, Collector *collector,
+                          Matcher *deletions) {
+    ImpactMatcherIVARS *const ivars = ImpactMatcher_IVARS(self);
+    BitVector *deldocs = NULL;
+    if (deletions && Obj_is_a((Obj*)deletions, BITVECMATCHER)) {
+        deldocs = BitVecMatcher_IVARS((BitVecMatcher*)deletions)->bit_vec;
+    }
+
+    // Docs come out of the impact-ordered list in no particular order, so
+    // the deletions have to be probed rather than iterated.
+    if (!Coll_Accepts_Docs_Out_Of_Order(collector)
+        || (deletions && !deldocs)
+       ) {
+        ImpactMatcher_Collect_t super_collect
+            = (ImpactMatcher_Collect_t)SUPER_METHOD_PTR(
+                  IMPACTMATCHER, LUCY_ImpactMatcher_Collect);
+        super_collect(self, collector, deletions);
+        return;
+    }
+
+    InStream *const instream = ivars->impact_stream;
+    ScorePosting *const posting
+        = (ScorePosting*)PList_Get_Posting(ivars->plist);
+    ScorePostingIVARS *const post_ivars = ScorePost_IVARS(posting);
+    const float *const norm_decoder = post_ivars->norm_decoder;
+    uint32_t remaining = PList_Get_Doc_Freq(ivars->plist);
+
+    // Score() reads the same Posting whichever order docs arrive in.
+    ivars->posting = (Posting*)posting;
+    Coll_Set_Matcher(collector, (Matcher*)self);
+
+    while (remaining) {
+        const uint32_t count      = InStream_Read_CU32(instream);
+        const float    max_impact = InStream_Read_F32(instream);
+        float bound = Sim_Impact_Bound(ivars->sim, max_impact);
+        if (bound != FLT_MAX && ivars->weight >= 0.0f) {
+            bound *= ivars->weight;
+
+            // Blocks come in descending order of impact, so if this one
+            // can't compete, neither can any which follow.
+            if (bound < Coll_Competitive_Score(collector)) { break; }
+        }
+
+        int32_t doc_id = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            doc_id += (int32_t)InStream_Read_CU32(instream);
+            post_ivars->doc_id = doc_id;
+            post_ivars->freq   = InStream_Read_CU32(instream);
+            post_ivars->weight = norm_decoder[InStream_Read_U8(instream)];
+            if (deldocs && BitVec_Get(deldocs, (size_t)doc_id)) { continue; }
+            Coll_Collect(collector, doc_id);
+        }
+        remaining -= count;
+    }
+
+    Coll_Set_Matcher(collector, NULL);
+}
+
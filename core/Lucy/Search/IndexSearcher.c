@@ -22,6 +22,7 @@
 #include "Lucy/Document/HitDoc.h"
 #include "Lucy/Index/DeletionsReader.h"
 #include "Lucy/Index/DocReader.h"
+#include "Lucy/Index/DocValuesReader.h"
 #include "Lucy/Index/DocVector.h"
 #include "Lucy/Index/IndexReader.h"
 #include "Lucy/Index/LexiconReader.h"
@@ -42,6 +43,7 @@
 #include "Lucy/Search/Compiler.h"
 #include "Lucy/Store/Folder.h"
 #include "Lucy/Store/FSFolder.h"
+#include "Lucy/Util/Threads.h"
 
 IndexSearcher*
 IxSearcher_new(Obj *index) {
@@ -61,11 +63,16 @@ IxSearcher_init(IndexSearcher *self, Obj *index) {
     Searcher_init((Searcher*)self, IxReader_Get_Schema(ivars->reader));
     ivars->seg_readers = IxReader_Seg_Readers(ivars->reader);
     ivars->seg_starts  = IxReader_Offsets(ivars->reader);
+    ivars->total_hits_threshold = UINT32_MAX;
+    ivars->num_threads = 1;
     ivars->doc_reader = (DocReader*)IxReader_Fetch(
                            ivars->reader, Class_Get_Name(DOCREADER));
+    ivars->dv_reader = (DocValuesReader*)IxReader_Fetch(
+                          ivars->reader, Class_Get_Name(DOCVALUESREADER));
     ivars->hl_reader = (HighlightReader*)IxReader_Fetch(
                           ivars->reader, Class_Get_Name(HIGHLIGHTREADER));
     if (ivars->doc_reader) { INCREF(ivars->doc_reader); }
+    if (ivars->dv_reader)  { INCREF(ivars->dv_reader); }
     if (ivars->hl_reader)  { INCREF(ivars->hl_reader); }
 
     return self;
@@ -76,6 +83,7 @@ IxSearcher_Destroy_IMP(IndexSearcher *self) {
     IndexSearcherIVARS *const ivars = IxSearcher_IVARS(self);
     DECREF(ivars->reader);
     DECREF(ivars->doc_reader);
+    DECREF(ivars->dv_reader);
     DECREF(ivars->hl_reader);
     DECREF(ivars->seg_readers);
     DECREF(ivars->seg_starts);
@@ -89,6 +97,35 @@ IxSearcher_Fetch_Doc_IMP(IndexSearcher *self, int32_t doc_id) {
     return DocReader_Fetch_Doc(ivars->doc_reader, doc_id);
 }
 
+Hash*
+IxSearcher_Fetch_Fields_IMP(IndexSearcher *self, int32_t doc_id,
+                            Vector *fields) {
+    IndexSearcherIVARS *const ivars = IxSearcher_IVARS(self);
+    Schema *const schema  = IxSearcher_Get_Schema(self);
+    Hash   *const retval  = Hash_new(Vec_Get_Size(fields));
+    HitDoc *hit_doc       = NULL;
+
+    for (size_t i = 0, max = Vec_Get_Size(fields); i < max; i++) {
+        String    *field = (String*)CERTIFY(Vec_Fetch(fields, i), STRING);
+        FieldType *type  = Schema_Fetch_Type(schema, field);
+        Obj       *value = NULL;
+        if (!type) { continue; }
+
+        if (FType_Columnar(type) && ivars->dv_reader) {
+            value = DVReader_Fetch_Value(ivars->dv_reader, field, doc_id);
+        }
+        else if (FType_Stored(type)) {
+            // Fall back to the stored doc, fetching it at most once.
+            if (!hit_doc) { hit_doc = IxSearcher_Fetch_Doc(self, doc_id); }
+            value = HitDoc_Extract(hit_doc, field);
+        }
+        if (value) { Hash_Store(retval, field, value); }
+    }
+
+    DECREF(hit_doc);
+    return retval;
+}
+
 DocVector*
 IxSearcher_Fetch_Doc_Vec_IMP(IndexSearcher *self, int32_t doc_id) {
     IndexSearcherIVARS *const ivars = IxSearcher_IVARS(self);
@@ -111,13 +148,25 @@ IxSearcher_Doc_Freq_IMP(IndexSearcher *self, String *field, Obj *term) {
     return lex_reader ? LexReader_Doc_Freq(lex_reader, field, term) : 0;
 }
 
+// Collect hits from several segments at once, each into its own
+// SortCollector, then merge them as PolySearcher merges its sub-searchers.
+static TopDocs*
+S_parallel_top_docs(IndexSearcher *self, Query *query, uint32_t wanted,
+                    SortSpec *sort_spec);
+
 TopDocs*
 IxSearcher_Top_Docs_IMP(IndexSearcher *self, Query *query, uint32_t num_wanted,
                         SortSpec *sort_spec) {
+    IndexSearcherIVARS *const ivars = IxSearcher_IVARS(self);
     Schema        *schema    = IxSearcher_Get_Schema(self);
     uint32_t       doc_max   = (uint32_t)IxSearcher_Doc_Max(self);
     uint32_t       wanted    = num_wanted > doc_max ? doc_max : num_wanted;
+    if (ivars->num_threads > 1 && Vec_Get_Size(ivars->seg_readers) > 1) {
+        return S_parallel_top_docs(self, query, wanted, sort_spec);
+    }
     SortCollector *collector = SortColl_new(schema, sort_spec, wanted);
+    SortColl_Set_Total_Hits_Threshold(collector,
+                                      ivars->total_hits_threshold);
     IxSearcher_Collect(self, query, (Collector*)collector);
     Vector  *match_docs = SortColl_Pop_Match_Docs(collector);
     uint32_t total_hits = SortColl_Get_Total_Hits(collector);
@@ -127,6 +176,88 @@ IxSearcher_Top_Docs_IMP(IndexSearcher *self, Query *query, uint32_t num_wanted,
     return retval;
 }
 
+typedef struct {
+    Matcher   *matcher;
+    Matcher   *deletions;
+    Collector *collector;
+} S_SegmentTask;
+
+// Runs on a worker thread.  Err_trap() may call into the host language, so
+// errors aren't trapped here.
+static void
+S_collect_segment(void *context, uint32_t tick) {
+    S_SegmentTask *task = (S_SegmentTask*)context + tick;
+    if (task->matcher) {
+        Matcher_Collect(task->matcher, task->collector, task->deletions);
+    }
+}
+
+static TopDocs*
+S_parallel_top_docs(IndexSearcher *self, Query *query, uint32_t wanted,
+                    SortSpec *sort_spec) {
+    IndexSearcherIVARS *const ivars = IxSearcher_IVARS(self);
+    Schema   *const schema      = IxSearcher_Get_Schema(self);
+    Vector   *const seg_readers = ivars->seg_readers;
+    I32Array *const seg_starts  = ivars->seg_starts;
+    uint32_t  num_segs = (uint32_t)Vec_Get_Size(seg_readers);
+    Compiler *compiler = Query_is_a(query, COMPILER)
+                         ? (Compiler*)INCREF(query)
+                         : Query_Make_Compiler(query, (Searcher*)self,
+                                               Query_Get_Boost(query), false);
+    S_SegmentTask *tasks
+        = (S_SegmentTask*)CALLOCATE(num_segs, sizeof(S_SegmentTask));
+
+    // Set up each segment's Matcher and collector here on the calling
+    // thread, because doing so touches objects which all segments share.
+    for (uint32_t i = 0; i < num_segs; i++) {
+        SegReader *seg_reader = (SegReader*)Vec_Fetch(seg_readers, i);
+        SortCollector *collector = SortColl_new(schema, sort_spec, wanted);
+        SortColl_Set_Total_Hits_Threshold(collector,
+                                          ivars->total_hits_threshold);
+        tasks[i].collector = (Collector*)collector;
+        tasks[i].matcher
+            = Compiler_Make_Matcher(compiler, seg_reader,
+                                    SortColl_Need_Score(collector));
+        if (tasks[i].matcher) {
+            DeletionsReader *del_reader = (DeletionsReader*)SegReader_Fetch(
+                                              seg_reader,
+                                              Class_Get_Name(DELETIONSREADER));
+            tasks[i].deletions = DelReader_Iterator(del_reader);
+            SortColl_Set_Reader(collector, seg_reader);
+            SortColl_Set_Base(collector, I32Arr_Get(seg_starts, i));
+        }
+    }
+
+    Threads_run(num_segs, ivars->num_threads, S_collect_segment, tasks);
+
+    // Merge the per-segment results.
+    HitQueue *hit_q      = sort_spec
+                           ? HitQ_new(schema, sort_spec, wanted)
+                           : HitQ_new(NULL, NULL, wanted);
+    uint32_t  total_hits = 0;
+    for (uint32_t i = 0; i < num_segs; i++) {
+        SortCollector *collector = (SortCollector*)tasks[i].collector;
+        Vector *match_docs = SortColl_Pop_Match_Docs(collector);
+        total_hits += SortColl_Get_Total_Hits(collector);
+        for (size_t j = 0, max = Vec_Get_Size(match_docs); j < max; j++) {
+            MatchDoc *match_doc = (MatchDoc*)Vec_Fetch(match_docs, j);
+            if (!HitQ_Insert(hit_q, INCREF(match_doc))) { break; }
+        }
+        DECREF(match_docs);
+        DECREF(tasks[i].matcher);
+        DECREF(tasks[i].deletions);
+        DECREF(collector);
+    }
+    FREEMEM(tasks);
+    DECREF(compiler);
+
+    Vector  *match_docs = HitQ_Pop_All(hit_q);
+    TopDocs *retval     = TopDocs_new(match_docs, total_hits);
+    DECREF(match_docs);
+    DECREF(hit_q);
+    return retval;
+}
+
 void
 IxSearcher_Collect_IMP(IndexSearcher *self, Query *query, Collector *collector) {
     IndexSearcherIVARS *const ivars = IxSearcher_IVARS(self);
@@ -161,6 +292,27 @@ IxSearcher_Collect_IMP(IndexSearcher *self, Query *query, Collector *collector)
     DECREF(compiler);
 }
 
+void
+IxSearcher_Set_Total_Hits_Threshold_IMP(IndexSearcher *self,
+                                        uint32_t threshold) {
+    IxSearcher_IVARS(self)->total_hits_threshold = threshold;
+}
+
+uint32_t
+IxSearcher_Get_Total_Hits_Threshold_IMP(IndexSearcher *self) {
+    return IxSearcher_IVARS(self)->total_hits_threshold;
+}
+
+void
+IxSearcher_Set_Num_Threads_IMP(IndexSearcher *self, uint32_t num_threads) {
+    IxSearcher_IVARS(self)->num_threads = num_threads ? num_threads : 1;
+}
+
+uint32_t
+IxSearcher_Get_Num_Threads_IMP(IndexSearcher *self) {
+    return IxSearcher_IVARS(self)->num_threads;
+}
+
 IndexReader*
 IxSearcher_Get_Reader_IMP(IndexSearcher *self) {
     return IxSearcher_IVARS(self)->reader;
@@ -64,4 +64,8 @@ MatchAllMatcher_Get_Doc_ID_IMP(MatchAllMatcher* self) {
     return MatchAllMatcher_IVARS(self)->doc_id;
 }
 
+int64_t
+MatchAllMatcher_Cost_IMP(MatchAllMatcher* self) {
+    return MatchAllMatcher_IVARS(self)->doc_max;
+}
 
@@ -18,6 +18,8 @@
 #define CFISH_USE_SHORT_NAMES
 #define LUCY_USE_SHORT_NAMES
 
+#include <float.h>
+
 #include "Lucy/Search/Matcher.h"
 #include "Clownfish/Err.h"
 #include "Lucy/Search/Collector.h"
@@ -38,6 +40,30 @@ Matcher_Advance_IMP(Matcher *self, int32_t target) {
     }
 }
 
+float
+Matcher_Max_Score_IMP(Matcher *self) {
+    UNUSED_VAR(self);
+    return FLT_MAX;
+}
+
+int32_t
+Matcher_Shallow_Advance_IMP(Matcher *self, int32_t target) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(target);
+    return INT32_MAX;
+}
+
+float
+Matcher_Block_Max_Score_IMP(Matcher *self) {
+    return Matcher_Max_Score(self);
+}
+
+int64_t
+Matcher_Cost_IMP(Matcher *self) {
+    UNUSED_VAR(self);
+    return INT32_MAX;
+}
+
 void
 Matcher_Collect_IMP(Matcher *self, Collector *collector, Matcher *deletions) {
     int32_t doc_id        = 0;
@@ -78,6 +104,7 @@ Matcher_Collect_IMP(Matcher *self, Collector *collector, Matcher *deletions) {
 
         if (doc_id) {
             Coll_Collect(collector, doc_id);
+            if (Coll_Segment_Done(collector)) { break; }
         }
         else {
             break;
@@ -0,0 +1,421 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_MULTITERMQUERY
+#define C_LUCY_MULTITERMCOMPILER
+#define C_LUCY_MULTITERMMATCHER
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/MultiTermQuery.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/Util/SortUtils.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Index/Lexicon.h"
+#include "Lucy/Index/LexiconReader.h"
+#include "Lucy/Index/PostingList.h"
+#include "Lucy/Index/PostingListReader.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Search/BitVecMatcher.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/NoMatchQuery.h"
+#include "Lucy/Search/ORQuery.h"
+#include "Lucy/Search/Searcher.h"
+#include "Lucy/Search/TermAutomaton.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/Freezer.h"
+#include "Lucy/Util/Json.h"
+
+int32_t MultiTermQuery_CONSTANT_SCORE = 0;
+int32_t MultiTermQuery_TOP_TERMS      = 1;
+
+// Called for each accepted term, while the lexicon is positioned on it.
+typedef void
+(*S_Visit_t)(void *context, Lexicon *lexicon, String *term);
+
+// Walk `lexicon`, visiting each term which `automaton` accepts.
+static void
+S_expand(TermAutomaton *automaton, Lexicon *lexicon, S_Visit_t visit,
+         void *context);
+
+// Fetch the Lexicon for `field` from a SegReader, or NULL.
+static Lexicon*
+S_lexicon(SegReader *reader, String *field);
+
+MultiTermQuery*
+MultiTermQuery_init(MultiTermQuery *self, String *field, uint32_t max_terms,
+                    int32_t rewrite) {
+    Query_init((Query*)self, 1.0f);
+    MultiTermQueryIVARS *const ivars = MultiTermQuery_IVARS(self);
+    ABSTRACT_CLASS_CHECK(self, MULTITERMQUERY);
+    ivars->field     = Str_Clone(field);
+    ivars->max_terms = max_terms;
+    ivars->rewrite   = rewrite;
+    if (rewrite != MultiTermQuery_CONSTANT_SCORE
+        && rewrite != MultiTermQuery_TOP_TERMS
+       ) {
+        DECREF(self);
+        THROW(ERR, "Invalid rewrite mode: %i32", rewrite);
+    }
+    return self;
+}
+
+void
+MultiTermQuery_Destroy_IMP(MultiTermQuery *self) {
+    MultiTermQueryIVARS *const ivars = MultiTermQuery_IVARS(self);
+    DECREF(ivars->field);
+    SUPER_DESTROY(self, MULTITERMQUERY);
+}
+
+String*
+MultiTermQuery_Get_Field_IMP(MultiTermQuery *self) {
+    return MultiTermQuery_IVARS(self)->field;
+}
+
+uint32_t
+MultiTermQuery_Get_Max_Terms_IMP(MultiTermQuery *self) {
+    return MultiTermQuery_IVARS(self)->max_terms;
+}
+
+int32_t
+MultiTermQuery_Get_Rewrite_IMP(MultiTermQuery *self) {
+    return MultiTermQuery_IVARS(self)->rewrite;
+}
+
+float
+MultiTermQuery_Term_Boost_IMP(MultiTermQuery *self, int32_t cost) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(cost);
+    return 1.0f;
+}
+
+bool
+MultiTermQuery_Equals_IMP(MultiTermQuery *self, Obj *other) {
+    if ((MultiTermQuery*)other == self)                { return true; }
+    if (!Obj_is_a(other, MULTITERMQUERY))              { return false; }
+    MultiTermQueryIVARS *const ivars = MultiTermQuery_IVARS(self);
+    MultiTermQueryIVARS *const ovars
+        = MultiTermQuery_IVARS((MultiTermQuery*)other);
+    if (ivars->boost != ovars->boost)                  { return false; }
+    if (!Str_Equals(ivars->field, (Obj*)ovars->field)) { return false; }
+    if (ivars->max_terms != ovars->max_terms)          { return false; }
+    if (ivars->rewrite != ovars->rewrite)              { return false; }
+    return true;
+}
+
+void
+MultiTermQuery_Serialize_IMP(MultiTermQuery *self, OutStream *outstream) {
+    MultiTermQueryIVARS *const ivars = MultiTermQuery_IVARS(self);
+    OutStream_Write_F32(outstream, ivars->boost);
+    Freezer_serialize_string(ivars->field, outstream);
+    OutStream_Write_CU32(outstream, ivars->max_terms);
+    OutStream_Write_CI32(outstream, ivars->rewrite);
+}
+
+MultiTermQuery*
+MultiTermQuery_Deserialize_IMP(MultiTermQuery *self, InStream *instream) {
+    float    boost     = InStream_Read_F32(instream);
+    String  *field     = Freezer_read_string(instream);
+    uint32_t max_terms = InStream_Read_CU32(instream);
+    int32_t  rewrite   = InStream_Read_CI32(instream);
+    MultiTermQuery_init(self, field, max_terms, rewrite);
+    MultiTermQuery_Set_Boost(self, boost);
+    DECREF(field);
+    return self;
+}
+
+Obj*
+MultiTermQuery_Dump_IMP(MultiTermQuery *self) {
+    MultiTermQueryIVARS *ivars = MultiTermQuery_IVARS(self);
+    MultiTermQuery_Dump_t super_dump
+        = SUPER_METHOD_PTR(MULTITERMQUERY, LUCY_MultiTermQuery_Dump);
+    Hash *dump = (Hash*)CERTIFY(super_dump(self), HASH);
+    Hash_Store_Utf8(dump, "field", 5, Freezer_dump((Obj*)ivars->field));
+    Hash_Store_Utf8(dump, "max_terms", 9,
+                    (Obj*)Str_newf("%u32", ivars->max_terms));
+    Hash_Store_Utf8(dump, "rewrite", 7,
+                    (Obj*)Str_newf("%i32", ivars->rewrite));
+    return (Obj*)dump;
+}
+
+Obj*
+MultiTermQuery_Load_IMP(MultiTermQuery *self, Obj *dump) {
+    Hash *source = (Hash*)CERTIFY(dump, HASH);
+    MultiTermQuery_Load_t super_load
+        = SUPER_METHOD_PTR(MULTITERMQUERY, LUCY_MultiTermQuery_Load);
+    MultiTermQuery *loaded = (MultiTermQuery*)super_load(self, dump);
+    MultiTermQueryIVARS *loaded_ivars = MultiTermQuery_IVARS(loaded);
+    Obj *field = CERTIFY(Hash_Fetch_Utf8(source, "field", 5), OBJ);
+    loaded_ivars->field = (String*)CERTIFY(Freezer_load(field), STRING);
+    Obj *max_terms = CERTIFY(Hash_Fetch_Utf8(source, "max_terms", 9), OBJ);
+    loaded_ivars->max_terms = (uint32_t)Json_obj_to_i64(max_terms);
+    Obj *rewrite = CERTIFY(Hash_Fetch_Utf8(source, "rewrite", 7), OBJ);
+    loaded_ivars->rewrite = (int32_t)Json_obj_to_i64(rewrite);
+    return (Obj*)loaded;
+}
+
+Compiler*
+MultiTermQuery_Make_Compiler_IMP(MultiTermQuery *self, Searcher *searcher,
+                                 float boost, bool subordinate) {
+    MultiTermQueryIVARS *const ivars = MultiTermQuery_IVARS(self);
+
+    // Only an IndexSearcher can hand over the readers needed to pick the
+    // top terms up front.
+    if (ivars->rewrite == MultiTermQuery_TOP_TERMS
+        && Obj_is_a((Obj*)searcher, INDEXSEARCHER)
+       ) {
+        IndexReader *reader = IxSearcher_Get_Reader((IndexSearcher*)searcher);
+        Query *rewritten = MultiTermQuery_Rewrite(self, reader);
+        Compiler *compiler
+            = Query_Make_Compiler(rewritten, searcher, boost, subordinate);
+        DECREF(rewritten);
+        return compiler;
+    }
+
+    MultiTermCompiler *compiler
+        = MultiTermCompiler_new(self, searcher, boost);
+    if (!subordinate) {
+        MultiTermCompiler_Normalize(compiler);
+    }
+    return (Compiler*)compiler;
+}
+
+static void
+S_expand(TermAutomaton *automaton, Lexicon *lexicon, S_Visit_t visit,
+         void *context) {
+    Lex_Seek(lexicon, (Obj*)SSTR_WRAP_C(""));
+    Obj *term = Lex_Get_Term(lexicon);
+
+    while (term && Obj_is_a(term, STRING)) {
+        if (TermAuto_Run(automaton, (String*)term) >= 0) {
+            visit(context, lexicon, (String*)term);
+        }
+        else {
+            String *target = TermAuto_Next_Target(automaton, (String*)term);
+            if (!target) { break; }
+
+            // Stepping is cheaper than seeking when the target is an
+            // extension of the current term, and so probably close by.
+            if (!Str_Starts_With(target, (String*)term)) {
+                Lex_Seek(lexicon, (Obj*)target);
+                DECREF(target);
+                term = Lex_Get_Term(lexicon);
+                continue;
+            }
+            DECREF(target);
+        }
+        term = Lex_Next(lexicon) ? Lex_Get_Term(lexicon) : NULL;
+    }
+}
+
+static Lexicon*
+S_lexicon(SegReader *reader, String *field) {
+    LexiconReader *lex_reader
+        = (LexiconReader*)SegReader_Fetch(reader,
+                                          Class_Get_Name(LEXICONREADER));
+    return lex_reader ? LexReader_Lexicon(lex_reader, field, NULL) : NULL;
+}
+
+typedef struct {
+    String  *term;
+    int64_t  doc_freq;
+    float    boost;
+} S_Candidate;
+
+static void
+S_add_doc_freq(void *context, Lexicon *lexicon, String *term) {
+    Hash    *doc_freqs = (Hash*)context;
+    Integer *total     = (Integer*)Hash_Fetch(doc_freqs, term);
+    int64_t  doc_freq  = Lex_Doc_Freq(lexicon);
+    if (total) { doc_freq += Int_Get_Value(total); }
+    Hash_Store(doc_freqs, term, (Obj*)Int_new(doc_freq));
+}
+
+static int
+S_compare_candidates(void *context, const void *va, const void *vb) {
+    UNUSED_VAR(context);
+    const S_Candidate *a = (const S_Candidate*)va;
+    const S_Candidate *b = (const S_Candidate*)vb;
+    if (a->boost != b->boost) { return a->boost > b->boost ? -1 : 1; }
+    if (a->doc_freq != b->doc_freq) {
+        return a->doc_freq > b->doc_freq ? -1 : 1;
+    }
+    return Str_Compare_To(a->term, (Obj*)b->term);
+}
+
+Query*
+MultiTermQuery_Rewrite_IMP(MultiTermQuery *self, IndexReader *reader) {
+    MultiTermQueryIVARS *const ivars = MultiTermQuery_IVARS(self);
+    TermAutomaton *automaton = MultiTermQuery_Make_Automaton(self);
+
+    // Sum the doc freqs of each matching term across segments.
+    Hash   *doc_freqs   = Hash_new(0);
+    Vector *seg_readers = IxReader_Seg_Readers(reader);
+    for (size_t i = 0, max = Vec_Get_Size(seg_readers); i < max; i++) {
+        SegReader *seg_reader = (SegReader*)Vec_Fetch(seg_readers, i);
+        Lexicon   *lexicon    = S_lexicon(seg_reader, ivars->field);
+        if (lexicon) {
+            S_expand(automaton, lexicon, S_add_doc_freq, doc_freqs);
+            DECREF(lexicon);
+        }
+    }
+    DECREF(seg_readers);
+
+    // Rank the terms and keep the best.
+    size_t num_terms = Hash_Get_Size(doc_freqs);
+    S_Candidate *candidates
+        = (S_Candidate*)MALLOCATE((num_terms + 1) * sizeof(S_Candidate));
+    S_Candidate *scratch
+        = (S_Candidate*)MALLOCATE((num_terms + 1) * sizeof(S_Candidate));
+    HashIterator *iter = HashIter_new(doc_freqs);
+    size_t num_candidates = 0;
+    while (HashIter_Next(iter)) {
+        String *term = HashIter_Get_Key(iter);
+        S_Candidate *candidate = &candidates[num_candidates++];
+        candidate->term     = term;
+        candidate->doc_freq
+            = Int_Get_Value((Integer*)HashIter_Get_Value(iter));
+        candidate->boost
+            = MultiTermQuery_Term_Boost(self, TermAuto_Run(automaton, term));
+    }
+    DECREF(iter);
+    Sort_mergesort(candidates, scratch, (uint32_t)num_candidates,
+                   sizeof(S_Candidate), S_compare_candidates, NULL);
+
+    Query *retval;
+    size_t num_wanted = num_candidates < ivars->max_terms
+                        ? num_candidates
+                        : ivars->max_terms;
+    if (num_wanted == 0) {
+        retval = (Query*)NoMatchQuery_new();
+    }
+    else {
+        Vector *children = Vec_new(num_wanted);
+        for (size_t i = 0; i < num_wanted; i++) {
+            TermQuery *term_query
+                = TermQuery_new(ivars->field, (Obj*)candidates[i].term);
+            TermQuery_Set_Boost(term_query, candidates[i].boost);
+            Vec_Push(children, (Obj*)term_query);
+        }
+        retval = (Query*)ORQuery_new(children);
+        DECREF(children);
+    }
+    Query_Set_Boost(retval, ivars->boost);
+
+    FREEMEM(scratch);
+    FREEMEM(candidates);
+    DECREF(doc_freqs);
+    DECREF(automaton);
+    return retval;
+}
+
+/**********************************************************************/
+
+MultiTermCompiler*
+MultiTermCompiler_new(MultiTermQuery *parent, Searcher *searcher,
+                      float boost) {
+    MultiTermCompiler *self
+        = (MultiTermCompiler*)Class_Make_Obj(MULTITERMCOMPILER);
+    return MultiTermCompiler_init(self, parent, searcher, boost);
+}
+
+MultiTermCompiler*
+MultiTermCompiler_init(MultiTermCompiler *self, MultiTermQuery *parent,
+                       Searcher *searcher, float boost) {
+    return (MultiTermCompiler*)Compiler_init((Compiler*)self, (Query*)parent,
+                                             searcher, NULL, boost);
+}
+
+typedef struct {
+    PostingList *plist;
+    BitVector   *bit_vec;
+    uint32_t     num_terms;
+} S_BitGatherer;
+
+static void
+S_set_bits(void *context, Lexicon *lexicon, String *term) {
+    S_BitGatherer *gatherer = (S_BitGatherer*)context;
+    int32_t doc_id;
+    UNUSED_VAR(term);
+    PList_Seek_Lex(gatherer->plist, lexicon);
+    while (0 != (doc_id = PList_Next(gatherer->plist))) {
+        BitVec_Set(gatherer->bit_vec, (size_t)doc_id);
+    }
+    gatherer->num_terms++;
+}
+
+Matcher*
+MultiTermCompiler_Make_Matcher_IMP(MultiTermCompiler *self,
+                                   SegReader *reader, bool need_score) {
+    MultiTermQuery *parent
+        = (MultiTermQuery*)MultiTermCompiler_IVARS(self)->parent;
+    String *field = MultiTermQuery_IVARS(parent)->field;
+    PostingListReader *plist_reader
+        = (PostingListReader*)SegReader_Fetch(
+              reader, Class_Get_Name(POSTINGLISTREADER));
+    Lexicon *lexicon = S_lexicon(reader, field);
+    PostingList *plist = plist_reader
+                         ? PListReader_Posting_List(plist_reader, field, NULL)
+                         : NULL;
+    Matcher *retval = NULL;
+    UNUSED_VAR(need_score);
+
+    if (lexicon && plist) {
+        TermAutomaton *automaton = MultiTermQuery_Make_Automaton(parent);
+        S_BitGatherer gatherer;
+        gatherer.plist     = plist;
+        gatherer.bit_vec   = BitVec_new((size_t)SegReader_Doc_Max(reader) + 1);
+        gatherer.num_terms = 0;
+        S_expand(automaton, lexicon, S_set_bits, &gatherer);
+        if (gatherer.num_terms) {
+            float weight = MultiTermCompiler_Get_Weight(self);
+            retval = (Matcher*)MultiTermMatcher_new(gatherer.bit_vec, weight);
+        }
+        DECREF(gatherer.bit_vec);
+        DECREF(automaton);
+    }
+
+    DECREF(plist);
+    DECREF(lexicon);
+    return retval;
+}
+
+/**********************************************************************/
+
+MultiTermMatcher*
+MultiTermMatcher_new(BitVector *bit_vector, float score) {
+    MultiTermMatcher *self
+        = (MultiTermMatcher*)Class_Make_Obj(MULTITERMMATCHER);
+    return MultiTermMatcher_init(self, bit_vector, score);
+}
+
+MultiTermMatcher*
+MultiTermMatcher_init(MultiTermMatcher *self, BitVector *bit_vector,
+                      float score) {
+    BitVecMatcher_init((BitVecMatcher*)self, bit_vector);
+    MultiTermMatcher_IVARS(self)->score = score;
+    return self;
+}
+
+float
+MultiTermMatcher_Score_IMP(MultiTermMatcher *self) {
+    return MultiTermMatcher_IVARS(self)->score;
+}
+
+
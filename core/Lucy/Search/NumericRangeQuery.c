@@ -0,0 +1,247 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_NUMERICRANGEQUERY
+#define C_LUCY_NUMERICRANGECOMPILER
+#define C_LUCY_RANGEQUERY
+#include "Lucy/Util/ToolSet.h"
+
+#include <math.h>
+
+#include "Lucy/Search/NumericRangeQuery.h"
+#include "Clownfish/Num.h"
+#include "Lucy/Index/PointReader.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Object/I32Array.h"
+#include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Search/I32ArrayMatcher.h"
+#include "Lucy/Search/Searcher.h"
+
+// Translate the query's bounds into an inclusive range of point keys for a
+// field of the supplied type.  Return false if no value can match.
+static bool
+S_find_bounds(RangeQueryIVARS *query_ivars, FieldType *type,
+              uint64_t *lower, uint64_t *upper);
+
+static bool
+S_int_bound(Obj *term, bool inclusive, bool is_lower, int64_t *bound);
+
+static bool
+S_float_bound(Obj *term, bool inclusive, bool is_lower, double *bound);
+
+NumericRangeQuery*
+NumRangeQuery_new(String *field, Obj *lower_term, Obj *upper_term,
+                  bool include_lower, bool include_upper) {
+    NumericRangeQuery *self
+        = (NumericRangeQuery*)Class_Make_Obj(NUMERICRANGEQUERY);
+    return NumRangeQuery_init(self, field, lower_term, upper_term,
+                              include_lower, include_upper);
+}
+
+NumericRangeQuery*
+NumRangeQuery_init(NumericRangeQuery *self, String *field, Obj *lower_term,
+                   Obj *upper_term, bool include_lower, bool include_upper) {
+    Obj *terms[2] = { lower_term, upper_term };
+    for (int i = 0; i < 2; i++) {
+        if (terms[i]
+            && !Obj_is_a(terms[i], INTEGER)
+            && !Obj_is_a(terms[i], FLOAT)
+           ) {
+            String *class_name = Obj_get_class_name(terms[i]);
+            DECREF(self);
+            THROW(ERR, "NumericRangeQuery bounds must be numbers, not %o",
+                  class_name);
+        }
+    }
+    return (NumericRangeQuery*)RangeQuery_init((RangeQuery*)self, field,
+                                               lower_term, upper_term,
+                                               include_lower, include_upper);
+}
+
+bool
+NumRangeQuery_Equals_IMP(NumericRangeQuery *self, Obj *other) {
+    if (!Obj_is_a(other, NUMERICRANGEQUERY)) { return false; }
+    NumRangeQuery_Equals_t super_equals
+        = (NumRangeQuery_Equals_t)SUPER_METHOD_PTR(NUMERICRANGEQUERY,
+                                                   LUCY_NumRangeQuery_Equals);
+    return super_equals(self, other);
+}
+
+Compiler*
+NumRangeQuery_Make_Compiler_IMP(NumericRangeQuery *self, Searcher *searcher,
+                                float boost, bool subordinate) {
+    NumericRangeCompiler *compiler
+        = NumRangeCompiler_new(self, searcher, boost);
+    if (!subordinate) {
+        NumRangeCompiler_Normalize(compiler);
+    }
+    return (Compiler*)compiler;
+}
+
+/**********************************************************************/
+
+NumericRangeCompiler*
+NumRangeCompiler_new(NumericRangeQuery *parent, Searcher *searcher,
+                     float boost) {
+    NumericRangeCompiler *self
+        = (NumericRangeCompiler*)Class_Make_Obj(NUMERICRANGECOMPILER);
+    return NumRangeCompiler_init(self, parent, searcher, boost);
+}
+
+NumericRangeCompiler*
+NumRangeCompiler_init(NumericRangeCompiler *self, NumericRangeQuery *parent,
+                      Searcher *searcher, float boost) {
+    return (NumericRangeCompiler*)RangeCompiler_init((RangeCompiler*)self,
+                                                     (RangeQuery*)parent,
+                                                     searcher, boost);
+}
+
+Matcher*
+NumRangeCompiler_Make_Matcher_IMP(NumericRangeCompiler *self,
+                                  SegReader *reader, bool need_score) {
+    RangeQuery *parent
+        = (RangeQuery*)NumRangeCompiler_IVARS(self)->parent;
+    RangeQueryIVARS *const parent_ivars = RangeQuery_IVARS(parent);
+    Schema    *schema = SegReader_Get_Schema(reader);
+    FieldType *type   = Schema_Fetch_Type(schema, parent_ivars->field);
+
+    if (!type || !FType_is_a(type, NUMERICTYPE)) {
+        return NULL;
+    }
+    else if (!FType_Indexed(type)) {
+        // Fall back to scanning the sort cache.
+        NumRangeCompiler_Make_Matcher_t super_make_matcher
+            = (NumRangeCompiler_Make_Matcher_t)SUPER_METHOD_PTR(
+                  NUMERICRANGECOMPILER, LUCY_NumRangeCompiler_Make_Matcher);
+        return super_make_matcher(self, reader, need_score);
+    }
+
+    PointReader *point_reader
+        = (PointReader*)SegReader_Fetch(reader, Class_Get_Name(POINTREADER));
+    PointTree *tree = point_reader
+                      ? PointReader_Fetch_Tree(point_reader,
+                                               parent_ivars->field)
+                      : NULL;
+    uint64_t lower, upper;
+    if (!tree || !S_find_bounds(parent_ivars, type, &lower, &upper)) {
+        return NULL;
+    }
+
+    I32Array *doc_ids = PointTree_Range(tree, lower, upper,
+                                        SegReader_Doc_Max(reader));
+    Matcher *retval = I32Arr_Get_Size(doc_ids)
+                      ? (Matcher*)I32ArrMatcher_new(doc_ids)
+                      : NULL;
+    DECREF(doc_ids);
+    return retval;
+}
+
+static bool
+S_find_bounds(RangeQueryIVARS *query_ivars, FieldType *type,
+              uint64_t *lower, uint64_t *upper) {
+    int32_t prim_id = FType_Primitive_ID(type) & FType_PRIMITIVE_ID_MASK;
+    if (prim_id == FType_INT32 || prim_id == FType_INT64) {
+        int64_t low  = INT64_MIN;
+        int64_t high = INT64_MAX;
+        if (query_ivars->lower_term
+            && !S_int_bound(query_ivars->lower_term,
+                            query_ivars->include_lower, true, &low)
+           ) {
+            return false;
+        }
+        if (query_ivars->upper_term
+            && !S_int_bound(query_ivars->upper_term,
+                            query_ivars->include_upper, false, &high)
+           ) {
+            return false;
+        }
+        *lower = PointReader_key_i64(low);
+        *upper = PointReader_key_i64(high);
+    }
+    else {
+        double low  = -INFINITY;
+        double high = INFINITY;
+        if (query_ivars->lower_term
+            && !S_float_bound(query_ivars->lower_term,
+                              query_ivars->include_lower, true, &low)
+           ) {
+            return false;
+        }
+        if (query_ivars->upper_term
+            && !S_float_bound(query_ivars->upper_term,
+                              query_ivars->include_upper, false, &high)
+           ) {
+            return false;
+        }
+        *lower = PointReader_key_f64(low);
+        *upper = PointReader_key_f64(high);
+    }
+    return *lower <= *upper;
+}
+
+// Round a bound to the nearest integer which lies within the range.
+static bool
+S_int_bound(Obj *term, bool inclusive, bool is_lower, int64_t *bound) {
+    if (Obj_is_a(term, INTEGER)) {
+        int64_t value = Int_Get_Value((Integer*)term);
+        if (!inclusive) {
+            if (value == (is_lower ? INT64_MAX : INT64_MIN)) { return false; }
+            value += is_lower ? 1 : -1;
+        }
+        *bound = value;
+        return true;
+    }
+
+    double value   = Float_Get_Value((Float*)term);
+    double rounded = is_lower ? ceil(value) : floor(value);
+    if (isnan(value)) { return false; }
+    if (!inclusive && rounded == value) {
+        rounded += is_lower ? 1.0 : -1.0;
+    }
+
+    // 2^63 is the first double beyond the range of int64_t.
+    const double limit = 9223372036854775808.0;
+    if (rounded >= limit) {
+        if (is_lower) { return false; }
+        *bound = INT64_MAX;
+    }
+    else if (rounded < -limit) {
+        if (!is_lower) { return false; }
+        *bound = INT64_MIN;
+    }
+    else {
+        *bound = (int64_t)rounded;
+    }
+    return true;
+}
+
+static bool
+S_float_bound(Obj *term, bool inclusive, bool is_lower, double *bound) {
+    double value = Obj_is_a(term, INTEGER)
+                   ? (double)Int_Get_Value((Integer*)term)
+                   : Float_Get_Value((Float*)term);
+    if (isnan(value)) { return false; }
+    if (!inclusive) {
+        double limit = is_lower ? INFINITY : -INFINITY;
+        if (value == limit) { return false; }
+        value = nextafter(value, limit);
+    }
+    *bound = value;
+    return true;
+}
+
@@ -151,6 +151,17 @@ ORMatcher_Advance_IMP(ORMatcher *self, int32_t target) {
     } while (true);
 }
 
+int64_t
+ORMatcher_Cost_IMP(ORMatcher *self) {
+    ORMatcherIVARS *const ivars = ORMatcher_IVARS(self);
+    int64_t cost = 0;
+    for (uint32_t i = 0; i < ivars->num_kids; i++) {
+        Matcher *child = (Matcher*)Vec_Fetch(ivars->children, i);
+        if (child) { cost += Matcher_Cost(child); }
+    }
+    return cost;
+}
+
 int32_t
 ORMatcher_Get_Doc_ID_IMP(ORMatcher *self) {
     return ORMatcher_IVARS(self)->top_hmd->doc;
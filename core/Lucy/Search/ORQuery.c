@@ -18,6 +18,8 @@
 #define C_LUCY_ORCOMPILER
 #include "Lucy/Util/ToolSet.h"
 
+#include <float.h>
+
 #include "Lucy/Search/ORQuery.h"
 
 #include "Clownfish/CharBuf.h"
@@ -25,6 +27,7 @@
 #include "Lucy/Index/Similarity.h"
 #include "Lucy/Search/ORMatcher.h"
 #include "Lucy/Search/Searcher.h"
+#include "Lucy/Search/WANDScorer.h"
 #include "Lucy/Store/InStream.h"
 #include "Lucy/Store/OutStream.h"
 
@@ -114,6 +117,7 @@ ORCompiler_Make_Matcher_IMP(ORCompiler *self, SegReader *reader,
     else {
         Vector *submatchers = Vec_new(num_kids);
         uint32_t num_submatchers = 0;
+        bool     bounded = false;
 
         // Accumulate sub-matchers.
         for (size_t i = 0; i < num_kids; i++) {
@@ -123,6 +127,9 @@ ORCompiler_Make_Matcher_IMP(ORCompiler *self, SegReader *reader,
             Vec_Push(submatchers, (Obj*)submatcher);
             if (submatcher != NULL) {
                 num_submatchers++;
+                if (need_score && Matcher_Max_Score(submatcher) < FLT_MAX) {
+                    bounded = true;
+                }
             }
         }
 
@@ -132,10 +139,15 @@ ORCompiler_Make_Matcher_IMP(ORCompiler *self, SegReader *reader,
             return NULL;
         }
         else {
+            // If any sub-matcher can bound its scores, a top-N search can
+            // skip docs which can't compete; WANDScorer behaves just like
+            // ORScorer when the Collector doesn't supply a threshold.
             Similarity *sim    = ORCompiler_Get_Similarity(self);
-            Matcher    *retval = need_score
-                                 ? (Matcher*)ORScorer_new(submatchers, sim)
-                                 : (Matcher*)ORMatcher_new(submatchers);
+            Matcher    *retval = !need_score
+                                 ? (Matcher*)ORMatcher_new(submatchers)
+                                 : bounded
+                                 ? (Matcher*)WANDScorer_new(submatchers, sim)
+                                 : (Matcher*)ORScorer_new(submatchers, sim);
             DECREF(submatchers);
             return retval;
         }
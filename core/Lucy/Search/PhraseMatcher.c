@@ -25,6 +25,10 @@
 #include "Lucy/Index/Similarity.h"
 #include "Lucy/Search/Compiler.h"
 
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
 PhraseMatcher*
 PhraseMatcher_new(Similarity *sim, Vector *plists, Compiler *compiler) {
     PhraseMatcher *self = (PhraseMatcher*)Class_Make_Obj(PHRASEMATCHER);
@@ -58,6 +62,21 @@ PhraseMatcher_init(PhraseMatcher *self, Similarity *similarity, Vector *plists,
         ivars->plists[i] = (PostingList*)INCREF(plist);
     }
 
+    // Order the PostingLists by ascending doc freq for intersecting.  Phrase
+    // matching itself still needs them in phrase order.
+    ivars->by_freq = (PostingList**)MALLOCATE(
+                        ivars->num_elements * sizeof(PostingList*));
+    for (uint32_t i = 0; i < ivars->num_elements; i++) {
+        PostingList *const plist = ivars->plists[i];
+        uint32_t doc_freq = PList_Get_Doc_Freq(plist);
+        uint32_t j = i;
+        while (j > 0 && PList_Get_Doc_Freq(ivars->by_freq[j - 1]) > doc_freq) {
+            ivars->by_freq[j] = ivars->by_freq[j - 1];
+            j--;
+        }
+        ivars->by_freq[j] = plist;
+    }
+
     // Assign.
     ivars->sim       = (Similarity*)INCREF(similarity);
     ivars->compiler  = (Compiler*)INCREF(compiler);
@@ -75,6 +94,7 @@ PhraseMatcher_Destroy_IMP(PhraseMatcher *self) {
         }
         FREEMEM(ivars->plists);
     }
+    FREEMEM(ivars->by_freq);
     DECREF(ivars->sim);
     DECREF(ivars->anchor_set);
     DECREF(ivars->compiler);
@@ -99,148 +119,126 @@ PhraseMatcher_Next_IMP(PhraseMatcher *self) {
 int32_t
 PhraseMatcher_Advance_IMP(PhraseMatcher *self, int32_t target) {
     PhraseMatcherIVARS *const ivars  = PhraseMatcher_IVARS(self);
-    PostingList **const plists       = ivars->plists;
+    PostingList **const plists       = ivars->by_freq;
     const uint32_t      num_elements = ivars->num_elements;
-    int32_t             highest      = 0;
+    int32_t             doc_id;
 
     // Reset match variables to indicate no match.  New values will be
     // assigned if a match succeeds.
     ivars->phrase_freq = 0.0;
     ivars->doc_id      = 0;
 
-    // Find the lowest possible matching doc ID greater than the current doc
-    // ID.  If any one of the PostingLists is exhausted, we're done.
+    if (!ivars->more || !num_elements) { return 0; }
+    PostingList *const lead = plists[0];
+
     if (ivars->first_time) {
         ivars->first_time = false;
 
-        // On the first call to Advance(), advance all PostingLists.
-        for (size_t i = 0, max = ivars->num_elements; i < max; i++) {
-            int32_t candidate = PList_Advance(plists[i], target);
-            if (!candidate) {
+        // On the first call to Advance(), advance all PostingLists.  If any
+        // one of them is exhausted, we're done.
+        for (uint32_t i = 1; i < num_elements; i++) {
+            if (!PList_Advance(plists[i], target)) {
                 ivars->more = false;
                 return 0;
             }
-            else if (candidate > highest) {
-                // Remember the highest doc ID so far.
-                highest = candidate;
-            }
-        }
-    }
-    else {
-        // On subsequent iters, advance only one PostingList.  Its new doc ID
-        // becomes the minimum target which all the others must move up to.
-        highest = PList_Advance(plists[0], target);
-        if (highest == 0) {
-            ivars->more = false;
-            return 0;
         }
     }
 
-    // Find a doc which contains all the terms.
-    while (1) {
-        bool agreement = true;
-
-        // Scoot all posting lists up to at least the current minimum.
-        for (uint32_t i = 0; i < num_elements; i++) {
+    // The PostingList with the lowest doc freq leads, proposing candidate
+    // docs.  The others are brought up to each candidate in turn; if one of
+    // them overshoots, the lead leaps ahead to meet it.
+    doc_id = PList_Advance(lead, target);
+    while (doc_id) {
+        uint32_t i;
+        for (i = 1; i < num_elements; i++) {
             PostingList *const plist = plists[i];
             int32_t candidate = PList_Get_Doc_ID(plist);
-
-            // Is this PostingList already beyond the minimum?  Then raise the
-            // bar for everyone else.
-            if (highest < candidate) { highest = candidate; }
-            if (target < highest)    { target = highest; }
-
-            // Scoot this posting list up.
-            if (candidate < target) {
-                candidate = PList_Advance(plist, target);
-
-                // If this PostingList is exhausted, we're done.
-                if (candidate == 0) {
+            if (candidate < doc_id) {
+                candidate = PList_Advance(plist, doc_id);
+                if (!candidate) {
                     ivars->more = false;
                     return 0;
                 }
-
-                // After calling PList_Advance(), we are guaranteed to be
-                // either at or beyond the minimum, so we can assign without
-                // checking and the minumum will either go up or stay the
-                // same.
-                highest = candidate;
+            }
+            if (candidate > doc_id) {
+                doc_id = PList_Advance(lead, candidate);
+                break;
             }
         }
+        if (i < num_elements) { continue; }
 
-        // See whether all the PostingLists have managed to converge on a
-        // single doc ID.
-        for (uint32_t i = 0; i < num_elements; i++) {
-            const int32_t candidate = PList_Get_Doc_ID(plists[i]);
-            if (candidate != highest) { agreement = false; }
-        }
-
-        // If we've found a doc with all terms in it, see if they form a
+        // We've found a doc with all terms in it, so see if they form a
         // phrase.
-        if (agreement && highest >= target) {
-            ivars->phrase_freq = PhraseMatcher_Calc_Phrase_Freq(self);
-            if (ivars->phrase_freq == 0.0) {
-                // No phrase.  Move on to another doc.
-                target += 1;
-            }
-            else {
-                // Success!
-                ivars->doc_id = highest;
-                return highest;
-            }
+        ivars->phrase_freq = PhraseMatcher_Calc_Phrase_Freq(self);
+        if (ivars->phrase_freq != 0.0) {
+            // Success!
+            ivars->doc_id = doc_id;
+            return doc_id;
         }
+
+        // No phrase.  Move on to another doc.
+        doc_id = PList_Next(lead);
     }
+
+    ivars->more = false;
+    return 0;
 }
 
-static CFISH_INLINE uint32_t
-SI_winnow_anchors(uint32_t *anchors_start, const uint32_t *const anchors_end,
-                  const uint32_t *candidates, const uint32_t *const candidates_end,
-                  uint32_t offset) {
-    uint32_t *anchors = anchors_start;
-    uint32_t *anchors_found = anchors_start;
-    uint32_t target_anchor;
-    uint32_t target_candidate;
-
-    // Safety check, so there's no chance of a bad dereference.
-    if (anchors_start == anchors_end || candidates == candidates_end) {
-        return 0;
-    }
+int64_t
+PhraseMatcher_Cost_IMP(PhraseMatcher *self) {
+    PhraseMatcherIVARS *const ivars = PhraseMatcher_IVARS(self);
+    return ivars->num_elements ? PList_Get_Doc_Freq(ivars->by_freq[0]) : 0;
+}
 
-    /* This function is a loop that finds terms that can continue a phrase.
-     * It overwrites the anchors in place, and returns the number remaining.
-     * The basic algorithm is to alternately increment the candidates' pointer
-     * until it is at or beyond its target position, and then increment the
-     * anchors' pointer until it is at or beyond its target.  The non-standard
-     * form is to avoid unnecessary comparisons.  This loop has not been
-     * tested for speed, but glancing at the object code produced (objdump -S)
-     * it appears to be significantly faster than the nested loop alternative.
-     * But given the vagaries of modern processors, it merits actual
-     * testing.*/
-
-SPIN_CANDIDATES:
-    target_candidate = *anchors + offset;
-    while (*candidates < target_candidate) {
-        if (++candidates == candidates_end) { goto DONE; }
+uint32_t
+PhraseMatcher_winnow_anchors(uint32_t *anchors, uint32_t num_anchors,
+                             const uint32_t *candidates,
+                             uint32_t num_candidates, uint32_t offset) {
+    uint32_t num_found = 0;
+    uint32_t a = 0;
+    uint32_t c = 0;
+
+    /* Both arrays ascend, so this is a merge: the candidates move up to each
+     * anchor's target position, and the anchor survives if one of them lands
+     * on it exactly.  Survivors are written back over the anchors.
+     *
+     * With SSE2, each target is compared against four candidates at once.
+     * Positions fit in 31 bits, so signed comparisons are safe.  Candidates
+     * below the target form a prefix of the four lanes, so the first
+     * candidate at or above it lies at the prefix's length. */
+#if defined(__SSE2__)
+    while (a < num_anchors && c + 4 <= num_candidates) {
+        const uint32_t target = anchors[a] + offset;
+        const __m128i  needle = _mm_set1_epi32((int)target);
+        const __m128i  block
+            = _mm_loadu_si128((const __m128i*)(candidates + c));
+        const int below = _mm_movemask_ps(
+                              _mm_castsi128_ps(_mm_cmplt_epi32(block, needle)));
+        if (below == 0xF) {
+            c += 4;
+            continue;
+        }
+        c += (uint32_t)((below & 1) + ((below >> 1) & 1) + ((below >> 2) & 1));
+        if (candidates[c] == target) {
+            anchors[num_found++] = anchors[a];
+        }
+        a++;
+    }
+#endif
+    while (a < num_anchors && c < num_candidates) {
+        const uint32_t target = anchors[a] + offset;
+        if (candidates[c] < target) {
+            c++;
+        }
+        else {
+            if (candidates[c] == target) {
+                anchors[num_found++] = anchors[a];
+            }
+            a++;
+        }
     }
-    if (*candidates == target_candidate) { goto MATCH; }
-    goto SPIN_ANCHORS;
-
-SPIN_ANCHORS:
-    target_anchor = *candidates - offset;
-    while (*anchors < target_anchor) {
-        if (++anchors == anchors_end) { goto DONE; }
-    };
-    if (*anchors == target_anchor) { goto MATCH; }
-    goto SPIN_CANDIDATES;
-
-MATCH:
-    *anchors_found++ = *anchors;
-    if (++anchors == anchors_end) { goto DONE; }
-    goto SPIN_CANDIDATES;
-
-DONE:
-    // Return number of anchors remaining.
-    return (uint32_t)(anchors_found - anchors_start);
+
+    return num_found;
 }
 
 float
@@ -274,27 +272,22 @@ PhraseMatcher_Calc_Phrase_Freq_IMP(PhraseMatcher *self) {
 
     size_t    amount        = anchors_remaining * sizeof(uint32_t);
     uint32_t *anchors_start = (uint32_t*)BB_Grow(ivars->anchor_set, amount);
-    uint32_t *anchors_end   = anchors_start + anchors_remaining;
-    memcpy(anchors_start, post_ivars->prox, amount);
+    memcpy(anchors_start, ScorePost_Get_Prox(posting), amount);
 
     // Match the positions of other terms against the anchor set.
     for (uint32_t i = 1, max = ivars->num_elements; i < max; i++) {
         // Get the array of positions for the next term.  Unlike the anchor
         // set (which is a copy), these won't be overwritten.
         ScorePosting *next_post = (ScorePosting*)PList_Get_Posting(plists[i]);
-        ScorePostingIVARS *const next_post_ivars = ScorePost_IVARS(next_post);
-        uint32_t *candidates_start = next_post_ivars->prox;
-        uint32_t *candidates_end   = candidates_start + next_post_ivars->freq;
+        uint32_t *candidates = ScorePost_Get_Prox(next_post);
+        uint32_t  num_candidates = ScorePost_IVARS(next_post)->freq;
 
         // Splice out anchors that don't match the next term.  Bail out if
         // we've eliminated all possible anchors.
         anchors_remaining
-            = SI_winnow_anchors(anchors_start, anchors_end,
-                                candidates_start, candidates_end, i);
+            = PhraseMatcher_winnow_anchors(anchors_start, anchors_remaining,
+                                           candidates, num_candidates, i);
         if (!anchors_remaining) { return 0.0f; }
-
-        // Adjust end for number of anchors that remain.
-        anchors_end = anchors_start + anchors_remaining;
     }
 
     // The number of anchors left is the phrase freq.
@@ -0,0 +1,133 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_PREFIXQUERY
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/PrefixQuery.h"
+#include "Clownfish/CharBuf.h"
+#include "Lucy/Search/TermAutomaton.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/Freezer.h"
+
+PrefixQuery*
+PrefixQuery_new(String *field, String *prefix, uint32_t max_terms,
+                int32_t rewrite) {
+    PrefixQuery *self = (PrefixQuery*)Class_Make_Obj(PREFIXQUERY);
+    return PrefixQuery_init(self, field, prefix, max_terms, rewrite);
+}
+
+PrefixQuery*
+PrefixQuery_init(PrefixQuery *self, String *field, String *prefix,
+                 uint32_t max_terms, int32_t rewrite) {
+    MultiTermQuery_init((MultiTermQuery*)self, field, max_terms, rewrite);
+    PrefixQueryIVARS *const ivars = PrefixQuery_IVARS(self);
+    ivars->prefix = Str_Clone(prefix);
+    return self;
+}
+
+void
+PrefixQuery_Destroy_IMP(PrefixQuery *self) {
+    PrefixQueryIVARS *const ivars = PrefixQuery_IVARS(self);
+    DECREF(ivars->prefix);
+    SUPER_DESTROY(self, PREFIXQUERY);
+}
+
+String*
+PrefixQuery_Get_Prefix_IMP(PrefixQuery *self) {
+    return PrefixQuery_IVARS(self)->prefix;
+}
+
+TermAutomaton*
+PrefixQuery_Make_Automaton_IMP(PrefixQuery *self) {
+    // Escape the prefix and append a star.
+    String  *prefix = PrefixQuery_IVARS(self)->prefix;
+    CharBuf *buf    = CB_new(Str_Get_Size(prefix) + 1);
+    StringIterator *iter = Str_Top(prefix);
+    int32_t code_point;
+    while (STR_OOB != (code_point = StrIter_Next(iter))) {
+        if (code_point == '*' || code_point == '?' || code_point == '\\') {
+            CB_Cat_Char(buf, '\\');
+        }
+        CB_Cat_Char(buf, code_point);
+    }
+    CB_Cat_Char(buf, '*');
+    DECREF(iter);
+    String *pattern = CB_Yield_String(buf);
+    TermAutomaton *automaton = (TermAutomaton*)WildcardAuto_new(pattern);
+    DECREF(pattern);
+    DECREF(buf);
+    return automaton;
+}
+
+String*
+PrefixQuery_To_String_IMP(PrefixQuery *self) {
+    PrefixQueryIVARS *const ivars = PrefixQuery_IVARS(self);
+    return Str_newf("%o:%o*", ivars->field, ivars->prefix);
+}
+
+bool
+PrefixQuery_Equals_IMP(PrefixQuery *self, Obj *other) {
+    if ((PrefixQuery*)other == self)   { return true; }
+    if (!Obj_is_a(other, PREFIXQUERY)) { return false; }
+    PrefixQueryIVARS *const ivars = PrefixQuery_IVARS(self);
+    PrefixQueryIVARS *const ovars = PrefixQuery_IVARS((PrefixQuery*)other);
+    if (!Str_Equals(ivars->prefix, (Obj*)ovars->prefix)) { return false; }
+    PrefixQuery_Equals_t super_equals
+        = SUPER_METHOD_PTR(PREFIXQUERY, LUCY_PrefixQuery_Equals);
+    return super_equals(self, other);
+}
+
+void
+PrefixQuery_Serialize_IMP(PrefixQuery *self, OutStream *outstream) {
+    PrefixQuery_Serialize_t super_serialize
+        = SUPER_METHOD_PTR(PREFIXQUERY, LUCY_PrefixQuery_Serialize);
+    super_serialize(self, outstream);
+    Freezer_serialize_string(PrefixQuery_IVARS(self)->prefix, outstream);
+}
+
+PrefixQuery*
+PrefixQuery_Deserialize_IMP(PrefixQuery *self, InStream *instream) {
+    PrefixQuery_Deserialize_t super_deserialize
+        = SUPER_METHOD_PTR(PREFIXQUERY, LUCY_PrefixQuery_Deserialize);
+    self = super_deserialize(self, instream);
+    PrefixQuery_IVARS(self)->prefix = Freezer_read_string(instream);
+    return self;
+}
+
+Obj*
+PrefixQuery_Dump_IMP(PrefixQuery *self) {
+    PrefixQueryIVARS *ivars = PrefixQuery_IVARS(self);
+    PrefixQuery_Dump_t super_dump
+        = SUPER_METHOD_PTR(PREFIXQUERY, LUCY_PrefixQuery_Dump);
+    Hash *dump = (Hash*)CERTIFY(super_dump(self), HASH);
+    Hash_Store_Utf8(dump, "prefix", 6, Freezer_dump((Obj*)ivars->prefix));
+    return (Obj*)dump;
+}
+
+Obj*
+PrefixQuery_Load_IMP(PrefixQuery *self, Obj *dump) {
+    Hash *source = (Hash*)CERTIFY(dump, HASH);
+    PrefixQuery_Load_t super_load
+        = SUPER_METHOD_PTR(PREFIXQUERY, LUCY_PrefixQuery_Load);
+    PrefixQuery *loaded = (PrefixQuery*)super_load(self, dump);
+    Obj *prefix = CERTIFY(Hash_Fetch_Utf8(source, "prefix", 6), OBJ);
+    PrefixQuery_IVARS(loaded)->prefix
+        = (String*)CERTIFY(Freezer_load(prefix), STRING);
+    return (Obj*)loaded;
+}
+
@@ -26,6 +26,7 @@
 #include "Lucy/Search/QueryParser/QueryLexer.h"
 #include "Lucy/Analysis/Analyzer.h"
 #include "Lucy/Plan/FieldType.h"
+#include "Lucy/Plan/NumericType.h"
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Search/LeafQuery.h"
 #include "Lucy/Search/ANDQuery.h"
@@ -132,7 +133,10 @@ QParser_init(QueryParser *self, Schema *schema, Analyzer *analyzer,
         for (size_t i = 0; i < num_fields; i++) {
             String *field = (String*)Vec_Fetch(all_fields, i);
             FieldType *type = Schema_Fetch_Type(schema, field);
-            if (type && FType_Indexed(type)) {
+            // Numeric fields are searched with NumericRangeQuery, not terms.
+            if (type && FType_Indexed(type)
+                && !FType_is_a(type, NUMERICTYPE)
+               ) {
                 Vec_Push(ivars->fields, INCREF(field));
             }
         }
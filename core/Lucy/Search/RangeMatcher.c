@@ -19,6 +19,23 @@
 
 #include "Lucy/Search/RangeMatcher.h"
 #include "Lucy/Index/SortCache.h"
+#include "Lucy/Util/NumberUtils.h"
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+// Number of documents scanned at once.
+#define SCAN_BLOCK_SIZE 1024
+
+// Scanning packed ords works a whole byte at a time, so the match buffer
+// needs room for a few docs past the end of the block.
+#define MATCHES_CAP (SCAN_BLOCK_SIZE + 8)
+
+// Scan the ords for the docs from `start` to `end` inclusive, filling the
+// match buffer.
+static void
+S_scan(RangeMatcherIVARS *ivars, int32_t start, int32_t end);
 
 RangeMatcher*
 RangeMatcher_new(int32_t lower_bound, int32_t upper_bound, SortCache *sort_cache,
@@ -36,14 +53,51 @@ RangeMatcher_init(RangeMatcher *self, int32_t lower_bound, int32_t upper_bound,
 
     // Init.
     ivars->doc_id       = 0;
+    ivars->num_matches  = 0;
+    ivars->match_tick   = 0;
+    ivars->scan_pos     = 1;
+    ivars->byte_masks   = NULL;
+    ivars->matches      = (int32_t*)MALLOCATE(MATCHES_CAP * sizeof(int32_t));
 
     // Assign.
-    ivars->lower_bound  = lower_bound;
-    ivars->upper_bound  = upper_bound;
     ivars->sort_cache   = (SortCache*)INCREF(sort_cache);
     ivars->doc_max      = doc_max;
 
     // Derive.
+    ivars->ords         = SortCache_Get_Ords(sort_cache);
+    ivars->ord_width    = SortCache_Get_Ord_Width(sort_cache);
+    ivars->native_ords  = SortCache_Get_Native_Ords(sort_cache);
+
+    // Clamp the bounds to the ords which the width can represent, so that
+    // the scanning loops can test `ord - lower <= upper - lower` unsigned.
+    int32_t max_ord = ivars->ord_width >= 32
+                      ? INT32_MAX
+                      : (1 << ivars->ord_width) - 1;
+    ivars->lower_bound  = lower_bound < 0 ? 0 : lower_bound;
+    ivars->upper_bound  = upper_bound > max_ord ? max_ord : upper_bound;
+    if (ivars->lower_bound > ivars->upper_bound) {
+        // Nothing can match.
+        ivars->scan_pos = doc_max + 1;
+    }
+
+    // Ords narrower than a byte get looked up a byte at a time: for each
+    // possible byte, note which of the docs packed into it match.
+    if (ivars->ord_width < 8) {
+        const uint32_t width    = (uint32_t)ivars->ord_width;
+        const uint32_t per_byte = 8 / width;
+        const int32_t  ord_mask = (1 << width) - 1;
+        ivars->byte_masks = (uint8_t*)MALLOCATE(256);
+        for (uint32_t byte = 0; byte < 256; byte++) {
+            uint8_t mask = 0;
+            for (uint32_t i = 0; i < per_byte; i++) {
+                int32_t ord = (int32_t)(byte >> (i * width)) & ord_mask;
+                if (ord >= ivars->lower_bound && ord <= ivars->upper_bound) {
+                    mask |= (uint8_t)(1 << i);
+                }
+            }
+            ivars->byte_masks[byte] = mask;
+        }
+    }
 
     return self;
 }
@@ -52,34 +106,49 @@ void
 RangeMatcher_Destroy_IMP(RangeMatcher *self) {
     RangeMatcherIVARS *const ivars = RangeMatcher_IVARS(self);
     DECREF(ivars->sort_cache);
+    FREEMEM(ivars->byte_masks);
+    FREEMEM(ivars->matches);
     SUPER_DESTROY(self, RANGEMATCHER);
 }
 
 int32_t
 RangeMatcher_Next_IMP(RangeMatcher* self) {
     RangeMatcherIVARS *const ivars = RangeMatcher_IVARS(self);
-    while (1) {
-        if (++ivars->doc_id > ivars->doc_max) {
-            ivars->doc_id--;
+    while (ivars->match_tick >= ivars->num_matches) {
+        if (ivars->scan_pos > ivars->doc_max) {
             return 0;
         }
-        else {
-            // Check if ord for this document is within the specied range.
-            // TODO: Unroll? i.e. use SortCache_Get_Ords at constructor time
-            // and save ourselves some method call overhead.
-            const int32_t ord
-                = SortCache_Ordinal(ivars->sort_cache, ivars->doc_id);
-            if (ord >= ivars->lower_bound && ord <= ivars->upper_bound) {
-                break;
-            }
-        }
+        int32_t start = ivars->scan_pos;
+        int32_t end   = ivars->doc_max - start < SCAN_BLOCK_SIZE
+                        ? ivars->doc_max
+                        : start + SCAN_BLOCK_SIZE - 1;
+        S_scan(ivars, start, end);
+        ivars->scan_pos = end + 1;
     }
+    ivars->doc_id = ivars->matches[ivars->match_tick++];
     return ivars->doc_id;
 }
 
 int32_t
 RangeMatcher_Advance_IMP(RangeMatcher* self, int32_t target) {
-    RangeMatcher_IVARS(self)->doc_id = target - 1;
+    RangeMatcherIVARS *const ivars = RangeMatcher_IVARS(self);
+
+    // Skip ahead within the current block if the target falls inside it.
+    // Otherwise, discard it and resume scanning at the target.
+    if (ivars->match_tick < ivars->num_matches
+        && ivars->matches[ivars->num_matches - 1] >= target
+       ) {
+        while (ivars->matches[ivars->match_tick] < target) {
+            ivars->match_tick++;
+        }
+    }
+    else {
+        ivars->num_matches = 0;
+        ivars->match_tick  = 0;
+        if (ivars->scan_pos < target) {
+            ivars->scan_pos = target;
+        }
+    }
     return RangeMatcher_Next_IMP(self);
 }
 
@@ -94,4 +163,173 @@ RangeMatcher_Get_Doc_ID_IMP(RangeMatcher* self) {
     return RangeMatcher_IVARS(self)->doc_id;
 }
 
+// Append the docs flagged in the low `count` bits of `mask`, starting with
+// `doc_id`.  Always stores, only advancing when the bit is set, so that
+// there's no branch to mispredict.
+static CFISH_INLINE uint32_t
+SI_emit(int32_t *matches, uint32_t num_matches, int32_t doc_id,
+        uint32_t mask, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        matches[num_matches] = doc_id + (int32_t)i;
+        num_matches += (mask >> i) & 1;
+    }
+    return num_matches;
+}
+
+static uint32_t
+S_scan_packed(const uint8_t *ords, const uint8_t *byte_masks,
+              int32_t ord_width, int32_t start, int32_t end,
+              int32_t *matches) {
+    const int32_t per_byte    = 8 / ord_width;
+    uint32_t      num_matches = 0;
+    for (int32_t doc_id = start - start % per_byte; doc_id <= end;
+         doc_id += per_byte
+        ) {
+        uint32_t mask = byte_masks[ords[doc_id / per_byte]];
+        if (doc_id < start) {
+            mask &= ~0U << (start - doc_id);
+        }
+        if (end - doc_id < per_byte - 1) {
+            mask &= (1U << (end - doc_id + 1)) - 1;
+        }
+        num_matches = SI_emit(matches, num_matches, doc_id, mask,
+                              (uint32_t)per_byte);
+    }
+    return num_matches;
+}
+
+static uint32_t
+S_scan_u8(const uint8_t *ords, uint32_t lower, uint32_t span, int32_t start,
+          int32_t end, int32_t *matches) {
+    uint32_t num_matches = 0;
+    int32_t  doc_id      = start;
+#if defined(__SSE2__)
+    // 16 ords at a time.  SSE2 has no unsigned comparison, but an unsigned
+    // minimum will do: `ord - lower` is in range if it's no greater than
+    // `span`.
+    const __m128i lowers = _mm_set1_epi8((char)lower);
+    const __m128i spans  = _mm_set1_epi8((char)span);
+    for (; end - doc_id >= 15; doc_id += 16) {
+        __m128i diffs = _mm_sub_epi8(
+                            _mm_loadu_si128((const __m128i*)(ords + doc_id)),
+                            lowers);
+        __m128i hits  = _mm_cmpeq_epi8(_mm_min_epu8(diffs, spans), diffs);
+        num_matches = SI_emit(matches, num_matches, doc_id,
+                              (uint32_t)_mm_movemask_epi8(hits), 16);
+    }
+#endif
+    for (; doc_id <= end; doc_id++) {
+        matches[num_matches] = doc_id;
+        num_matches += (uint32_t)ords[doc_id] - lower <= span;
+    }
+    return num_matches;
+}
+
+static uint32_t
+S_scan_u16(const uint8_t *ords, bool native_ords, uint32_t lower,
+           uint32_t span, int32_t start, int32_t end, int32_t *matches) {
+    uint32_t num_matches = 0;
+    int32_t  doc_id      = start;
+#if defined(__SSE2__)
+    // 8 ords at a time.  Flipping the sign bit turns the unsigned
+    // comparison into a signed one.
+    const __m128i lowers = _mm_set1_epi16((short)lower);
+    const __m128i flip   = _mm_set1_epi16((short)0x8000);
+    const __m128i limits = _mm_set1_epi16((short)(span ^ 0x8000));
+    for (; end - doc_id >= 7; doc_id += 8) {
+        __m128i values = _mm_loadu_si128(
+                             (const __m128i*)(ords + (size_t)doc_id * 2));
+        if (!native_ords) {
+            values = _mm_or_si128(_mm_slli_epi16(values, 8),
+                                  _mm_srli_epi16(values, 8));
+        }
+        __m128i diffs  = _mm_xor_si128(_mm_sub_epi16(values, lowers), flip);
+        __m128i misses = _mm_cmpgt_epi16(diffs, limits);
+        uint32_t mask
+            = ~(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(misses, misses));
+        num_matches = SI_emit(matches, num_matches, doc_id, mask & 0xFF, 8);
+    }
+#endif
+    for (; doc_id <= end; doc_id++) {
+        const uint8_t *bytes = ords + (size_t)doc_id * 2;
+        uint32_t ord = native_ords
+                       ? *(const uint16_t*)bytes
+                       : NumUtil_decode_bigend_u16(bytes);
+        matches[num_matches] = doc_id;
+        num_matches += ord - lower <= span;
+    }
+    return num_matches;
+}
+
+static uint32_t
+S_scan_u32(const uint8_t *ords, bool native_ords, uint32_t lower,
+           uint32_t span, int32_t start, int32_t end, int32_t *matches) {
+    uint32_t num_matches = 0;
+    int32_t  doc_id      = start;
+#if defined(__SSE2__)
+    // 4 ords at a time, as for 16-bit ords.  Big-endian ords get their
+    // bytes swapped within each 16-bit half, then the halves swapped.
+    const __m128i lowers = _mm_set1_epi32((int)lower);
+    const __m128i flip   = _mm_set1_epi32((int)0x80000000);
+    const __m128i limits = _mm_set1_epi32((int)(span ^ 0x80000000));
+    for (; end - doc_id >= 3; doc_id += 4) {
+        __m128i values = _mm_loadu_si128(
+                             (const __m128i*)(ords + (size_t)doc_id * 4));
+        if (!native_ords) {
+            values = _mm_or_si128(_mm_slli_epi16(values, 8),
+                                  _mm_srli_epi16(values, 8));
+            values = _mm_shufflelo_epi16(values, _MM_SHUFFLE(2, 3, 0, 1));
+            values = _mm_shufflehi_epi16(values, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        __m128i diffs  = _mm_xor_si128(_mm_sub_epi32(values, lowers), flip);
+        __m128i misses = _mm_cmpgt_epi32(diffs, limits);
+        uint32_t mask
+            = ~(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(misses));
+        num_matches = SI_emit(matches, num_matches, doc_id, mask & 0xF, 4);
+    }
+#endif
+    for (; doc_id <= end; doc_id++) {
+        const uint8_t *bytes = ords + (size_t)doc_id * 4;
+        uint32_t ord = native_ords
+                       ? *(const uint32_t*)bytes
+                       : NumUtil_decode_bigend_u32(bytes);
+        matches[num_matches] = doc_id;
+        num_matches += ord - lower <= span;
+    }
+    return num_matches;
+}
+
+static void
+S_scan(RangeMatcherIVARS *ivars, int32_t start, int32_t end) {
+    const uint8_t *ords  = (const uint8_t*)ivars->ords;
+    const uint32_t lower = (uint32_t)ivars->lower_bound;
+    const uint32_t span  = (uint32_t)(ivars->upper_bound - ivars->lower_bound);
+    uint32_t num_matches;
+    switch (ivars->ord_width) {
+        case 1:
+        case 2:
+        case 4:
+            num_matches = S_scan_packed(ords, ivars->byte_masks,
+                                        ivars->ord_width, start, end,
+                                        ivars->matches);
+            break;
+        case 8:
+            num_matches = S_scan_u8(ords, lower, span, start, end,
+                                    ivars->matches);
+            break;
+        case 16:
+            num_matches = S_scan_u16(ords, ivars->native_ords, lower, span,
+                                     start, end, ivars->matches);
+            break;
+        case 32:
+            num_matches = S_scan_u32(ords, ivars->native_ords, lower, span,
+                                     start, end, ivars->matches);
+            break;
+        default:
+            THROW(ERR, "Invalid ord width: %i32", ivars->ord_width);
+            return;
+    }
+    ivars->num_matches = num_matches;
+    ivars->match_tick  = 0;
+}
 
@@ -75,6 +75,11 @@ ReqOptMatcher_Get_Doc_ID_IMP(RequiredOptionalMatcher *self) {
     return Matcher_Get_Doc_ID(ivars->req_matcher);
 }
 
+int64_t
+ReqOptMatcher_Cost_IMP(RequiredOptionalMatcher *self) {
+    return Matcher_Cost(ReqOptMatcher_IVARS(self)->req_matcher);
+}
+
 float
 ReqOptMatcher_Score_IMP(RequiredOptionalMatcher *self) {
     RequiredOptionalMatcherIVARS *const ivars = ReqOptMatcher_IVARS(self);
@@ -0,0 +1,542 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_TERMAUTOMATON
+#define C_LUCY_WILDCARDAUTOMATON
+#define C_LUCY_LEVENSHTEINAUTOMATON
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/TermAutomaton.h"
+#include "Clownfish/Util/SortUtils.h"
+
+#define MAX_CODE_POINT 0x10FFFF
+
+// The longest run of code points added to a seek target after the first.
+#define MAX_EXTENSION 64
+
+// Wildcard tokens other than literal code points.
+#define WILDCARD_ANY_ONE  -2
+#define WILDCARD_ANY_SEQ  -3
+
+// Decode `term` into the code point scratch buffer and return the number of
+// code points.
+static size_t
+S_decode(TermAutomaton *self, String *term);
+
+// Make sure there's room for `num_states` states.
+static uint8_t*
+S_grow_states(TermAutomaton *self, size_t num_states);
+
+// Return the least code point greater than `floor` on which `state` steps to
+// a live state, or -1 if there is none.  `scratch` receives that state.
+static int32_t
+S_least_live(TermAutomaton *self, const uint8_t *state, int32_t floor,
+             uint8_t *scratch);
+
+static int
+S_compare_i32(void *context, const void *va, const void *vb) {
+    UNUSED_VAR(context);
+    int32_t a = *(const int32_t*)va;
+    int32_t b = *(const int32_t*)vb;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+TermAutomaton*
+TermAuto_init(TermAutomaton *self, const int32_t *code_points,
+              size_t num_code_points, size_t state_size) {
+    TermAutomatonIVARS *const ivars = TermAuto_IVARS(self);
+    ABSTRACT_CLASS_CHECK(self, TERMAUTOMATON);
+
+    // Keep a sorted, duplicate-free copy of the alphabet.
+    int32_t *alphabet
+        = (int32_t*)MALLOCATE((num_code_points + 1) * sizeof(int32_t));
+    int32_t *scratch
+        = (int32_t*)MALLOCATE((num_code_points + 1) * sizeof(int32_t));
+    for (size_t i = 0; i < num_code_points; i++) {
+        alphabet[i] = code_points[i];
+    }
+    Sort_mergesort(alphabet, scratch, (uint32_t)num_code_points,
+                   sizeof(int32_t), S_compare_i32, NULL);
+    FREEMEM(scratch);
+    size_t alphabet_size = 0;
+    for (size_t i = 0; i < num_code_points; i++) {
+        if (!alphabet_size || alphabet[i] != alphabet[alphabet_size - 1]) {
+            alphabet[alphabet_size++] = alphabet[i];
+        }
+    }
+
+    ivars->alphabet        = alphabet;
+    ivars->alphabet_size   = alphabet_size;
+    ivars->state_size      = state_size ? state_size : 1;
+    ivars->states          = NULL;
+    ivars->states_cap      = 0;
+    ivars->code_points     = NULL;
+    ivars->code_points_cap = 0;
+    ivars->target_buf      = NULL;
+    ivars->target_cap      = 0;
+    return self;
+}
+
+void
+TermAuto_Destroy_IMP(TermAutomaton *self) {
+    TermAutomatonIVARS *const ivars = TermAuto_IVARS(self);
+    FREEMEM(ivars->alphabet);
+    FREEMEM(ivars->states);
+    FREEMEM(ivars->code_points);
+    FREEMEM(ivars->target_buf);
+    SUPER_DESTROY(self, TERMAUTOMATON);
+}
+
+static size_t
+S_decode(TermAutomaton *self, String *term) {
+    TermAutomatonIVARS *const ivars = TermAuto_IVARS(self);
+    const uint8_t *ptr = (const uint8_t*)Str_Get_Ptr8(term);
+    const uint8_t *end = ptr + Str_Get_Size(term);
+
+    // A term never has more code points than bytes.
+    size_t max_code_points = Str_Get_Size(term) + 1;
+    if (max_code_points > ivars->code_points_cap) {
+        ivars->code_points
+            = (int32_t*)REALLOCATE(ivars->code_points,
+                                   max_code_points * sizeof(int32_t));
+        ivars->code_points_cap = max_code_points;
+    }
+
+    size_t num_code_points = 0;
+    while (ptr < end) {
+        uint32_t lead = *ptr;
+        uint32_t len  = StrHelp_UTF8_COUNT[lead];
+        int32_t  code_point;
+        switch (len) {
+            case 2:
+                code_point = (int32_t)(((lead & 0x1F) << 6)
+                                       | (ptr[1] & 0x3F));
+                break;
+            case 3:
+                code_point = (int32_t)(((lead & 0x0F) << 12)
+                                       | ((ptr[1] & 0x3F) << 6)
+                                       | (ptr[2] & 0x3F));
+                break;
+            case 4:
+                code_point = (int32_t)(((lead & 0x07) << 18)
+                                       | ((ptr[1] & 0x3F) << 12)
+                                       | ((ptr[2] & 0x3F) << 6)
+                                       | (ptr[3] & 0x3F));
+                break;
+            default:
+                len = 1;
+                code_point = (int32_t)lead;
+        }
+        ivars->code_points[num_code_points++] = code_point;
+        ptr += len;
+    }
+    return num_code_points;
+}
+
+static uint8_t*
+S_grow_states(TermAutomaton *self, size_t num_states) {
+    TermAutomatonIVARS *const ivars = TermAuto_IVARS(self);
+    if (num_states > ivars->states_cap) {
+        size_t new_cap = num_states + num_states / 2 + 4;
+        ivars->states
+            = (uint8_t*)REALLOCATE(ivars->states,
+                                   new_cap * ivars->state_size);
+        ivars->states_cap = new_cap;
+    }
+    return ivars->states;
+}
+
+int32_t
+TermAuto_Run_IMP(TermAutomaton *self, String *term) {
+    TermAutomatonIVARS *const ivars = TermAuto_IVARS(self);
+    size_t   num_code_points = S_decode(self, term);
+    size_t   state_size      = ivars->state_size;
+    uint8_t *states          = S_grow_states(self, 2);
+    uint8_t *state           = states;
+    uint8_t *next            = states + state_size;
+
+    TermAuto_Start(self, state);
+    for (size_t i = 0; i < num_code_points; i++) {
+        TermAuto_Step(self, state, ivars->code_points[i], next);
+        if (!TermAuto_Is_Live(self, next)) { return -1; }
+        uint8_t *temp = state;
+        state = next;
+        next  = temp;
+    }
+    return TermAuto_Accept_Cost(self, state);
+}
+
+static bool
+S_in_alphabet(TermAutomatonIVARS *ivars, int32_t code_point) {
+    size_t lo = 0;
+    size_t hi = ivars->alphabet_size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ivars->alphabet[mid] < code_point)      { lo = mid + 1; }
+        else if (ivars->alphabet[mid] > code_point) { hi = mid; }
+        else                                        { return true; }
+    }
+    return false;
+}
+
+static int32_t
+S_least_live(TermAutomaton *self, const uint8_t *state, int32_t floor,
+             uint8_t *scratch) {
+    TermAutomatonIVARS *const ivars = TermAuto_IVARS(self);
+    int32_t least = -1;
+
+    // Every code point outside the alphabet leads to the same state, so
+    // only the smallest one above `floor` is a candidate.
+    TermAuto_Step(self, state, -1, scratch);
+    if (TermAuto_Is_Live(self, scratch)) {
+        int32_t candidate = floor + 1;
+        while (candidate <= MAX_CODE_POINT) {
+            if (candidate >= 0xD800 && candidate <= 0xDFFF) {
+                candidate = 0xE000;
+            }
+            else if (S_in_alphabet(ivars, candidate)) {
+                candidate++;
+            }
+            else {
+                break;
+            }
+        }
+        if (candidate <= MAX_CODE_POINT) { least = candidate; }
+    }
+
+    // The alphabet is sorted, so the first live code point is the least.
+    for (size_t i = 0; i < ivars->alphabet_size; i++) {
+        int32_t code_point = ivars->alphabet[i];
+        if (code_point <= floor) { continue; }
+        if (least >= 0 && code_point > least) { break; }
+        TermAuto_Step(self, state, code_point, scratch);
+        if (TermAuto_Is_Live(self, scratch)) {
+            least = code_point;
+            break;
+        }
+    }
+
+    // Leave the state for the winner in `scratch`.
+    if (least >= 0) {
+        TermAuto_Step(self, state,
+                      S_in_alphabet(ivars, least) ? least : -1, scratch);
+    }
+    return least;
+}
+
+String*
+TermAuto_Next_Target_IMP(TermAutomaton *self, String *term) {
+    TermAutomatonIVARS *const ivars = TermAuto_IVARS(self);
+    size_t   num_code_points = S_decode(self, term);
+    size_t   state_size      = ivars->state_size;
+    uint8_t *states
+        = S_grow_states(self, num_code_points + MAX_EXTENSION + 2);
+    int32_t *code_points     = ivars->code_points;
+
+    // Follow the term for as long as it stays live.
+    size_t pos = 0;
+    TermAuto_Start(self, states);
+    while (pos < num_code_points) {
+        uint8_t *next = states + (pos + 1) * state_size;
+        TermAuto_Step(self, states + pos * state_size, code_points[pos],
+                      next);
+        if (!TermAuto_Is_Live(self, next)) { break; }
+        pos++;
+    }
+
+    // Find the last position at which the term can be made larger while
+    // staying live, and the least code point which does it.
+    int32_t floor = pos < num_code_points ? code_points[pos] : -1;
+    int32_t code_point;
+    while (true) {
+        uint8_t *scratch = states + (pos + 1) * state_size;
+        code_point = S_least_live(self, states + pos * state_size, floor,
+                                  scratch);
+        if (code_point >= 0) { break; }
+        if (pos == 0)        { return NULL; }
+        pos--;
+        floor = code_points[pos];
+    }
+
+    // Every string between that prefix and its least accepted extension is
+    // rejected, so extend it greedily -- until it is accepted, it runs into
+    // a wildcard, or it gets long.
+    if (ivars->code_points_cap < pos + MAX_EXTENSION + 1) {
+        ivars->code_points
+            = (int32_t*)REALLOCATE(ivars->code_points,
+                                   (pos + MAX_EXTENSION + 1)
+                                   * sizeof(int32_t));
+        ivars->code_points_cap = pos + MAX_EXTENSION + 1;
+        code_points = ivars->code_points;
+    }
+    code_points[pos++] = code_point;
+    for (size_t i = 0; i < MAX_EXTENSION; i++) {
+        uint8_t *state = states + pos * state_size;
+        uint8_t *next  = state + state_size;
+        if (TermAuto_Accept_Cost(self, state) >= 0) { break; }
+        code_point = S_least_live(self, state, -1, next);
+        if (code_point < 0 || !S_in_alphabet(ivars, code_point)) { break; }
+        code_points[pos++] = code_point;
+    }
+
+    // Encode the target.
+    size_t max_size = pos * 4 + 1;
+    if (max_size > ivars->target_cap) {
+        ivars->target_buf = (char*)REALLOCATE(ivars->target_buf, max_size);
+        ivars->target_cap = max_size;
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < pos; i++) {
+        size += StrHelp_encode_utf8_char(code_points[i],
+                                         ivars->target_buf + size);
+    }
+    return Str_new_from_trusted_utf8(ivars->target_buf, size);
+}
+
+/**********************************************************************/
+
+WildcardAutomaton*
+WildcardAuto_new(String *pattern) {
+    WildcardAutomaton *self
+        = (WildcardAutomaton*)Class_Make_Obj(WILDCARDAUTOMATON);
+    return WildcardAuto_init(self, pattern);
+}
+
+WildcardAutomaton*
+WildcardAuto_init(WildcardAutomaton *self, String *pattern) {
+    WildcardAutomatonIVARS *const ivars = WildcardAuto_IVARS(self);
+    size_t   cap      = Str_Length(pattern) + 1;
+    int32_t *tokens   = (int32_t*)MALLOCATE(cap * sizeof(int32_t));
+    int32_t *literals = (int32_t*)MALLOCATE(cap * sizeof(int32_t));
+    size_t   num_tokens   = 0;
+    size_t   num_literals = 0;
+
+    StringIterator *iter = Str_Top(pattern);
+    int32_t code_point;
+    while (STR_OOB != (code_point = StrIter_Next(iter))) {
+        if (code_point == '*') {
+            // Adjacent stars are the same as one.
+            if (num_tokens && tokens[num_tokens - 1] == WILDCARD_ANY_SEQ) {
+                continue;
+            }
+            tokens[num_tokens++] = WILDCARD_ANY_SEQ;
+        }
+        else if (code_point == '?') {
+            tokens[num_tokens++] = WILDCARD_ANY_ONE;
+        }
+        else {
+            if (code_point == '\\') {
+                int32_t escaped = StrIter_Next(iter);
+                if (escaped != STR_OOB) { code_point = escaped; }
+            }
+            tokens[num_tokens++]     = code_point;
+            literals[num_literals++] = code_point;
+        }
+    }
+    DECREF(iter);
+
+    // One bit per position in the pattern, plus one for the end.
+    TermAuto_init((TermAutomaton*)self, literals, num_literals,
+                  (num_tokens + 8) / 8);
+    FREEMEM(literals);
+    ivars->tokens     = tokens;
+    ivars->num_tokens = num_tokens;
+    return self;
+}
+
+void
+WildcardAuto_Destroy_IMP(WildcardAutomaton *self) {
+    WildcardAutomatonIVARS *const ivars = WildcardAuto_IVARS(self);
+    FREEMEM(ivars->tokens);
+    SUPER_DESTROY(self, WILDCARDAUTOMATON);
+}
+
+// A star may match nothing, so reaching its position also reaches the next.
+static void
+S_close(WildcardAutomatonIVARS *ivars, uint8_t *state) {
+    for (size_t i = 0; i < ivars->num_tokens; i++) {
+        if ((state[i >> 3] & (1 << (i & 7)))
+            && ivars->tokens[i] == WILDCARD_ANY_SEQ
+           ) {
+            state[(i + 1) >> 3] |= (uint8_t)(1 << ((i + 1) & 7));
+        }
+    }
+}
+
+void
+WildcardAuto_Start_IMP(WildcardAutomaton *self, uint8_t *state) {
+    WildcardAutomatonIVARS *const ivars = WildcardAuto_IVARS(self);
+    memset(state, 0, ivars->state_size);
+    state[0] = 1;
+    S_close(ivars, state);
+}
+
+void
+WildcardAuto_Step_IMP(WildcardAutomaton *self, const uint8_t *state,
+                      int32_t code_point, uint8_t *dest) {
+    WildcardAutomatonIVARS *const ivars = WildcardAuto_IVARS(self);
+    memset(dest, 0, ivars->state_size);
+    for (size_t i = 0; i < ivars->num_tokens; i++) {
+        if (!(state[i >> 3] & (1 << (i & 7)))) { continue; }
+        int32_t token = ivars->tokens[i];
+        if (token == WILDCARD_ANY_SEQ) {
+            dest[i >> 3] |= (uint8_t)(1 << (i & 7));
+        }
+        else if (token == WILDCARD_ANY_ONE
+                 || (token == code_point && code_point >= 0)
+                ) {
+            dest[(i + 1) >> 3] |= (uint8_t)(1 << ((i + 1) & 7));
+        }
+    }
+    S_close(ivars, dest);
+}
+
+bool
+WildcardAuto_Is_Live_IMP(WildcardAutomaton *self, const uint8_t *state) {
+    // Whatever follows a position can always be matched, so any position
+    // at all will do.
+    WildcardAutomatonIVARS *const ivars = WildcardAuto_IVARS(self);
+    for (size_t i = 0; i < ivars->state_size; i++) {
+        if (state[i]) { return true; }
+    }
+    return false;
+}
+
+int32_t
+WildcardAuto_Accept_Cost_IMP(WildcardAutomaton *self, const uint8_t *state) {
+    size_t end = WildcardAuto_IVARS(self)->num_tokens;
+    return (state[end >> 3] & (1 << (end & 7))) ? 0 : -1;
+}
+
+/**********************************************************************/
+
+LevenshteinAutomaton*
+LevAuto_new(String *target, uint32_t max_edits, uint32_t prefix_length) {
+    LevenshteinAutomaton *self
+        = (LevenshteinAutomaton*)Class_Make_Obj(LEVENSHTEINAUTOMATON);
+    return LevAuto_init(self, target, max_edits, prefix_length);
+}
+
+LevenshteinAutomaton*
+LevAuto_init(LevenshteinAutomaton *self, String *target, uint32_t max_edits,
+             uint32_t prefix_length) {
+    LevenshteinAutomatonIVARS *const ivars = LevAuto_IVARS(self);
+    if (max_edits > 2) {
+        DECREF(self);
+        THROW(ERR, "max_edits can't be greater than 2: %u32", max_edits);
+    }
+    if (prefix_length > UINT8_MAX) {
+        DECREF(self);
+        THROW(ERR, "prefix_length can't be greater than 255: %u32",
+              prefix_length);
+    }
+
+    size_t   cap        = Str_Length(target) + 1;
+    int32_t *code_points = (int32_t*)MALLOCATE(cap * sizeof(int32_t));
+    size_t   target_len = 0;
+    StringIterator *iter = Str_Top(target);
+    int32_t code_point;
+    while (STR_OOB != (code_point = StrIter_Next(iter))) {
+        code_points[target_len++] = code_point;
+    }
+    DECREF(iter);
+    if (prefix_length > target_len) { prefix_length = (uint32_t)target_len; }
+
+    // The first byte counts the prefix code points read so far; the rest
+    // hold one table row for the remainder of the target.
+    TermAuto_init((TermAutomaton*)self, code_points, target_len,
+                  target_len - prefix_length + 2);
+    ivars->target        = code_points;
+    ivars->target_len    = target_len;
+    ivars->prefix_length = prefix_length;
+    ivars->max_edits     = (uint8_t)max_edits;
+    return self;
+}
+
+void
+LevAuto_Destroy_IMP(LevenshteinAutomaton *self) {
+    LevenshteinAutomatonIVARS *const ivars = LevAuto_IVARS(self);
+    FREEMEM(ivars->target);
+    SUPER_DESTROY(self, LEVENSHTEINAUTOMATON);
+}
+
+void
+LevAuto_Start_IMP(LevenshteinAutomaton *self, uint8_t *state) {
+    LevenshteinAutomatonIVARS *const ivars = LevAuto_IVARS(self);
+    const size_t  row_len = ivars->target_len - ivars->prefix_length + 1;
+    const uint8_t limit   = (uint8_t)(ivars->max_edits + 1);
+    uint8_t *row = state + 1;
+    state[0] = 0;
+    for (size_t j = 0; j < row_len; j++) {
+        row[j] = j < limit ? (uint8_t)j : limit;
+    }
+}
+
+void
+LevAuto_Step_IMP(LevenshteinAutomaton *self, const uint8_t *state,
+                 int32_t code_point, uint8_t *dest) {
+    LevenshteinAutomatonIVARS *const ivars = LevAuto_IVARS(self);
+    const size_t   prefix_length = ivars->prefix_length;
+    const size_t   row_len       = ivars->target_len - prefix_length + 1;
+    const int32_t *rest          = ivars->target + prefix_length;
+    const uint8_t  limit         = (uint8_t)(ivars->max_edits + 1);
+    const uint8_t *row           = state + 1;
+    uint8_t       *new_row       = dest + 1;
+
+    if (state[0] < prefix_length) {
+        // Still inside the prefix, which allows no edits at all.
+        memcpy(dest, state, ivars->state_size);
+        if (code_point >= 0 && code_point == ivars->target[state[0]]) {
+            dest[0]++;
+        }
+        else {
+            memset(new_row, limit, row_len);
+        }
+        return;
+    }
+
+    dest[0] = state[0];
+    new_row[0] = row[0] < limit ? (uint8_t)(row[0] + 1) : limit;
+    for (size_t j = 1; j < row_len; j++) {
+        uint8_t substitute = row[j - 1];
+        if (code_point < 0 || rest[j - 1] != code_point) { substitute++; }
+        uint8_t insert = (uint8_t)(row[j] + 1);
+        uint8_t remove = (uint8_t)(new_row[j - 1] + 1);
+        uint8_t least  = substitute < insert ? substitute : insert;
+        if (remove < least) { least = remove; }
+        new_row[j] = least < limit ? least : limit;
+    }
+}
+
+bool
+LevAuto_Is_Live_IMP(LevenshteinAutomaton *self, const uint8_t *state) {
+    LevenshteinAutomatonIVARS *const ivars = LevAuto_IVARS(self);
+    const size_t row_len = ivars->target_len - ivars->prefix_length + 1;
+    for (size_t j = 0; j < row_len; j++) {
+        if (state[j + 1] <= ivars->max_edits) { return true; }
+    }
+    return false;
+}
+
+int32_t
+LevAuto_Accept_Cost_IMP(LevenshteinAutomaton *self, const uint8_t *state) {
+    LevenshteinAutomatonIVARS *const ivars = LevAuto_IVARS(self);
+    const size_t row_len = ivars->target_len - ivars->prefix_length + 1;
+    if (state[0] < ivars->prefix_length)   { return -1; }
+    if (state[row_len] > ivars->max_edits) { return -1; }
+    return state[row_len];
+}
+
@@ -55,17 +55,14 @@ TermMatcher_Next_IMP(TermMatcher* self) {
     TermMatcherIVARS *const ivars = TermMatcher_IVARS(self);
     PostingList *const plist = ivars->plist;
     if (plist) {
+        // Hold on to the PostingList even once it's exhausted.  Freeing it
+        // would release objects shared with other segments' Matchers, and
+        // those may be iterating on other threads.
         int32_t doc_id = PList_Next(plist);
         if (doc_id) {
             ivars->posting = PList_Get_Posting(plist);
-            return doc_id;
-        }
-        else {
-            // Reclaim resources a little early.
-            DECREF(plist);
-            ivars->plist = NULL;
-            return 0;
         }
+        return doc_id;
     }
     return 0;
 }
@@ -78,14 +75,8 @@ TermMatcher_Advance_IMP(TermMatcher *self, int32_t target) {
         int32_t doc_id = PList_Advance(plist, target);
         if (doc_id) {
             ivars->posting = PList_Get_Posting(plist);
-            return doc_id;
-        }
-        else {
-            // Reclaim resources a little early.
-            DECREF(plist);
-            ivars->plist = NULL;
-            return 0;
         }
+        return doc_id;
     }
     return 0;
 }
@@ -96,4 +87,17 @@ TermMatcher_Get_Doc_ID_IMP(TermMatcher* self) {
     return Post_Get_Doc_ID(ivars->posting);
 }
 
+int64_t
+TermMatcher_Cost_IMP(TermMatcher *self) {
+    TermMatcherIVARS *const ivars = TermMatcher_IVARS(self);
+    return ivars->plist ? PList_Get_Doc_Freq(ivars->plist) : 0;
+}
+
+int32_t
+TermMatcher_Shallow_Advance_IMP(TermMatcher *self, int32_t target) {
+    TermMatcherIVARS *const ivars = TermMatcher_IVARS(self);
+    return ivars->plist
+           ? PList_Shallow_Advance(ivars->plist, target)
+           : INT32_MAX;
+}
 
@@ -23,10 +23,13 @@
 #include "Lucy/Index/SegReader.h"
 #include "Lucy/Index/PostingList.h"
 #include "Lucy/Index/PostingListReader.h"
+#include "Lucy/Index/SegPostingList.h"
 #include "Lucy/Index/Similarity.h"
 #include "Lucy/Index/TermVector.h"
+#include "Lucy/Plan/FullTextType.h"
 #include "Lucy/Plan/Schema.h"
 #include "Lucy/Search/Compiler.h"
+#include "Lucy/Search/ImpactMatcher.h"
 #include "Lucy/Search/Searcher.h"
 #include "Lucy/Search/Span.h"
 #include "Lucy/Search/TermMatcher.h"
@@ -34,6 +37,12 @@
 #include "Lucy/Store/OutStream.h"
 #include "Lucy/Util/Freezer.h"
 
+// Return an ImpactMatcher if the term has an impact-ordered list in this
+// segment, or NULL.
+static Matcher*
+S_make_impact_matcher(TermCompiler *self, SegReader *reader,
+                      PostingList *plist);
+
 TermQuery*
 TermQuery_new(String *field, Obj *term) {
     TermQuery *self = (TermQuery*)Class_Make_Obj(TERMQUERY);
@@ -275,13 +284,47 @@ TermCompiler_Make_Matcher_IMP(TermCompiler *self, SegReader *reader,
         return NULL;
     }
     else {
-        Matcher *retval = PList_Make_Matcher(plist, ivars->sim,
-                                             (Compiler*)self, need_score);
+        Matcher *retval = need_score
+                          ? S_make_impact_matcher(self, reader, plist)
+                          : NULL;
+        if (!retval) {
+            retval = PList_Make_Matcher(plist, ivars->sim, (Compiler*)self,
+                                        need_score);
+        }
         DECREF(plist);
         return retval;
     }
 }
 
+static Matcher*
+S_make_impact_matcher(TermCompiler *self, SegReader *reader,
+                      PostingList *plist) {
+    TermCompilerIVARS *const ivars = TermCompiler_IVARS(self);
+    TermQueryIVARS *const parent_ivars
+        = TermQuery_IVARS((TermQuery*)ivars->parent);
+    Schema    *schema = SegReader_Get_Schema(reader);
+    FieldType *type   = Schema_Fetch_Type(schema, parent_ivars->field);
+
+    if (!type
+        || !Obj_is_a((Obj*)type, FULLTEXTTYPE)
+        || !FullTextType_Impact_Ordered((FullTextType*)type)
+        || !Obj_is_a((Obj*)plist, SEGPOSTINGLIST)
+       ) {
+        return NULL;
+    }
+
+    // Segments written before the property was set, and short lists, have
+    // no impact-ordered list.
+    InStream *impact_stream
+        = SegPList_Impact_Stream((SegPostingList*)plist);
+    if (!impact_stream) { return NULL; }
+    ImpactMatcher *matcher = ImpactMatcher_new(ivars->sim, plist,
+                                               (Compiler*)self,
+                                               impact_stream);
+    DECREF(impact_stream);
+    return (Matcher*)matcher;
+}
+
 Vector*
 TermCompiler_Highlight_Spans_IMP(TermCompiler *self, Searcher *searcher,
                                  DocVector *doc_vec, String *field) {
@@ -0,0 +1,293 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_WANDSCORER
+#include "Lucy/Util/ToolSet.h"
+
+#include <float.h>
+
+#include "charmony.h"
+
+#include "Lucy/Search/WANDScorer.h"
+#include "Lucy/Index/Similarity.h"
+#include "Lucy/Search/Collector.h"
+
+// Move every cursor positioned before `target` up to it, drop exhausted
+// cursors and restore doc id order.
+static void
+S_catch_up(WANDScorerIVARS *ivars, int32_t target);
+
+// Find the first doc at or after `target` which might score at least as
+// high as the threshold.  Return 0 once no such doc remains.
+static int32_t
+S_advance(WANDScorerIVARS *ivars, int32_t target);
+
+WANDScorer*
+WANDScorer_new(Vector *children, Similarity *sim) {
+    WANDScorer *self = (WANDScorer*)Class_Make_Obj(WANDSCORER);
+    return WANDScorer_init(self, children, sim);
+}
+
+WANDScorer*
+WANDScorer_init(WANDScorer *self, Vector *children, Similarity *sim) {
+    PolyMatcher_init((PolyMatcher*)self, children, sim);
+    WANDScorerIVARS *const ivars = WANDScorer_IVARS(self);
+    const uint32_t num_kids = ivars->num_kids;
+
+    // Init.
+    ivars->collector = NULL;
+    ivars->doc_id    = 0;
+    ivars->threshold = CHY_F32_NEGINF;
+    ivars->num_live  = 0;
+
+    // Allocate.
+    ivars->cursors = (WANDCursor*)CALLOCATE(num_kids + 1, sizeof(WANDCursor));
+    ivars->sorted  = (WANDCursor**)CALLOCATE(num_kids + 1,
+                                             sizeof(WANDCursor*));
+    ivars->coord_ceiling = (float*)MALLOCATE((num_kids + 1) * sizeof(float));
+
+    // A doc matched by N children can score no more than the highest coord
+    // factor for any overlap up to N.
+    float ceiling = CHY_F32_NEGINF;
+    for (uint32_t i = 0; i <= num_kids; i++) {
+        if (ivars->coord_factors[i] > ceiling) {
+            ceiling = ivars->coord_factors[i];
+        }
+        ivars->coord_ceiling[i] = ceiling;
+    }
+
+    // Prime cursors.  They all start out at doc 0, i.e. before the first
+    // doc, so ordering is trivial.
+    for (uint32_t i = 0; i < num_kids; i++) {
+        Matcher *matcher = (Matcher*)Vec_Fetch(children, i);
+        if (matcher) {
+            WANDCursor *cursor = ivars->cursors + ivars->num_live;
+            cursor->matcher   = (Matcher*)INCREF(matcher);
+            cursor->doc       = 0;
+            cursor->block_end = -1;
+            cursor->max_score = Matcher_Max_Score(matcher);
+            cursor->block_max = cursor->max_score;
+            ivars->sorted[ivars->num_live] = cursor;
+            ivars->num_live++;
+        }
+    }
+
+    return self;
+}
+
+void
+WANDScorer_Destroy_IMP(WANDScorer *self) {
+    WANDScorerIVARS *const ivars = WANDScorer_IVARS(self);
+    if (ivars->cursors) {
+        for (uint32_t i = 0; i < ivars->num_kids; i++) {
+            DECREF(ivars->cursors[i].matcher);
+        }
+    }
+    DECREF(ivars->collector);
+    FREEMEM(ivars->cursors);
+    FREEMEM(ivars->sorted);
+    FREEMEM(ivars->coord_ceiling);
+    SUPER_DESTROY(self, WANDSCORER);
+}
+
+void
+WANDScorer_Collect_IMP(WANDScorer *self, Collector *collector,
+                       Matcher *deletions) {
+    WANDScorerIVARS *const ivars = WANDScorer_IVARS(self);
+    WANDScorer_Collect_t super_collect
+        = (WANDScorer_Collect_t)SUPER_METHOD_PTR(WANDSCORER,
+                                                 LUCY_WANDScorer_Collect);
+    Collector *temp = ivars->collector;
+    ivars->collector = (Collector*)INCREF(collector);
+    DECREF(temp);
+    super_collect(self, collector, deletions);
+    DECREF(ivars->collector);
+    ivars->collector = NULL;
+}
+
+int32_t
+WANDScorer_Next_IMP(WANDScorer *self) {
+    WANDScorerIVARS *const ivars = WANDScorer_IVARS(self);
+    return S_advance(ivars, ivars->doc_id + 1);
+}
+
+int32_t
+WANDScorer_Advance_IMP(WANDScorer *self, int32_t target) {
+    WANDScorerIVARS *const ivars = WANDScorer_IVARS(self);
+    return S_advance(ivars, target);
+}
+
+int32_t
+WANDScorer_Get_Doc_ID_IMP(WANDScorer *self) {
+    return WANDScorer_IVARS(self)->doc_id;
+}
+
+float
+WANDScorer_Score_IMP(WANDScorer *self) {
+    WANDScorerIVARS *const ivars = WANDScorer_IVARS(self);
+    WANDCursor **const sorted = ivars->sorted;
+    const int32_t doc_id = ivars->doc_id;
+    float    score    = 0.0f;
+    uint32_t matching = 0;
+
+    // All cursors on the current doc sit at the front.
+    while (matching < ivars->num_live && sorted[matching]->doc == doc_id) {
+        score += Matcher_Score(sorted[matching]->matcher);
+        matching++;
+    }
+
+    return score * ivars->coord_factors[matching];
+}
+
+float
+WANDScorer_Max_Score_IMP(WANDScorer *self) {
+    WANDScorerIVARS *const ivars = WANDScorer_IVARS(self);
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < ivars->num_live; i++) {
+        float max_score = ivars->sorted[i]->max_score;
+        if (max_score == FLT_MAX) { return FLT_MAX; }
+        sum += max_score;
+    }
+    return sum * ivars->coord_ceiling[ivars->num_live];
+}
+
+static void
+S_catch_up(WANDScorerIVARS *ivars, int32_t target) {
+    WANDCursor **const sorted = ivars->sorted;
+    uint32_t num_live = ivars->num_live;
+    uint32_t num_moved = 0;
+
+    // Cursors are in doc id order, so the laggards form a prefix.
+    while (num_moved < num_live && sorted[num_moved]->doc < target) {
+        WANDCursor *cursor = sorted[num_moved];
+        cursor->doc = cursor->doc == target - 1
+                      ? Matcher_Next(cursor->matcher)
+                      : Matcher_Advance(cursor->matcher, target);
+        num_moved++;
+    }
+    if (!num_moved) { return; }
+
+    // Drop exhausted cursors from the prefix, then insert the survivors into
+    // the sorted remainder.
+    uint32_t num_kept = 0;
+    for (uint32_t i = 0; i < num_moved; i++) {
+        if (sorted[i]->doc != 0) { sorted[num_kept++] = sorted[i]; }
+    }
+    if (num_kept < num_moved) {
+        memmove(sorted + num_kept, sorted + num_moved,
+                (num_live - num_moved) * sizeof(WANDCursor*));
+        num_live -= num_moved - num_kept;
+    }
+    for (uint32_t i = num_kept; i-- > 0;) {
+        WANDCursor *cursor = sorted[i];
+        uint32_t j = i + 1;
+        while (j < num_live && sorted[j]->doc < cursor->doc) {
+            sorted[j - 1] = sorted[j];
+            j++;
+        }
+        sorted[j - 1] = cursor;
+    }
+    ivars->num_live = num_live;
+}
+
+static int32_t
+S_advance(WANDScorerIVARS *ivars, int32_t target) {
+    WANDCursor **const sorted = ivars->sorted;
+    float *const coord_ceiling = ivars->coord_ceiling;
+
+    // The threshold can only rise as hits are collected.
+    if (ivars->collector) {
+        ivars->threshold = Coll_Competitive_Score(ivars->collector);
+    }
+    const float threshold = ivars->threshold;
+
+    while (1) {
+        S_catch_up(ivars, target);
+        const uint32_t num_live = ivars->num_live;
+
+        // Find the pivot: the last cursor on the first doc whose summed
+        // upper bound reaches the threshold.  Docs before it can't compete.
+        // Bounds are compared with "!(bound < threshold)" so that a NaN
+        // from an unbounded child never prunes anything.
+        uint32_t pivot = num_live;
+        float bound = 0.0f;
+        for (uint32_t i = 0; i < num_live; i++) {
+            bound += sorted[i]->max_score;
+            if (i + 1 < num_live && sorted[i + 1]->doc == sorted[i]->doc) {
+                continue;
+            }
+            if (threshold == CHY_F32_NEGINF
+                || !(bound * coord_ceiling[i + 1] < threshold)
+               ) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == num_live) {
+            // Nothing left can compete.
+            ivars->num_live = 0;
+            ivars->doc_id   = 0;
+            return 0;
+        }
+        const int32_t pivot_doc = sorted[pivot]->doc;
+
+        // Check the tighter per-block bounds before doing any real work.
+        if (threshold != CHY_F32_NEGINF) {
+            float   block_bound = 0.0f;
+            int32_t block_end   = INT32_MAX;
+            for (uint32_t i = 0; i <= pivot; i++) {
+                WANDCursor *cursor = sorted[i];
+                if (cursor->block_end < pivot_doc) {
+                    cursor->block_end
+                        = Matcher_Shallow_Advance(cursor->matcher, pivot_doc);
+                    cursor->block_max
+                        = Matcher_Block_Max_Score(cursor->matcher);
+                }
+                block_bound += cursor->block_max;
+                if (cursor->block_end < block_end) {
+                    block_end = cursor->block_end;
+                }
+            }
+            if (block_bound * coord_ceiling[pivot + 1] < threshold) {
+                // No doc up to the end of the shortest block can compete,
+                // nor any doc before the next cursor's.
+                int32_t next = block_end == INT32_MAX
+                               ? INT32_MAX
+                               : block_end + 1;
+                if (pivot + 1 < num_live && sorted[pivot + 1]->doc < next) {
+                    next = sorted[pivot + 1]->doc;
+                }
+                if (next == INT32_MAX) {
+                    ivars->num_live = 0;
+                    ivars->doc_id   = 0;
+                    return 0;
+                }
+                target = next;
+                continue;
+            }
+        }
+
+        if (sorted[0]->doc == pivot_doc) {
+            // Every cursor up to the pivot is on the pivot doc.
+            ivars->doc_id = pivot_doc;
+            return pivot_doc;
+        }
+
+        // Bring the cursors before the pivot up to it and try again.
+        target = pivot_doc;
+    }
+}
+
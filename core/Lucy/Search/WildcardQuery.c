@@ -0,0 +1,117 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_WILDCARDQUERY
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Search/WildcardQuery.h"
+#include "Lucy/Search/TermAutomaton.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/Freezer.h"
+
+WildcardQuery*
+WildcardQuery_new(String *field, String *pattern, uint32_t max_terms,
+                  int32_t rewrite) {
+    WildcardQuery *self = (WildcardQuery*)Class_Make_Obj(WILDCARDQUERY);
+    return WildcardQuery_init(self, field, pattern, max_terms, rewrite);
+}
+
+WildcardQuery*
+WildcardQuery_init(WildcardQuery *self, String *field, String *pattern,
+                   uint32_t max_terms, int32_t rewrite) {
+    MultiTermQuery_init((MultiTermQuery*)self, field, max_terms, rewrite);
+    WildcardQueryIVARS *const ivars = WildcardQuery_IVARS(self);
+    ivars->pattern = Str_Clone(pattern);
+    return self;
+}
+
+void
+WildcardQuery_Destroy_IMP(WildcardQuery *self) {
+    WildcardQueryIVARS *const ivars = WildcardQuery_IVARS(self);
+    DECREF(ivars->pattern);
+    SUPER_DESTROY(self, WILDCARDQUERY);
+}
+
+String*
+WildcardQuery_Get_Pattern_IMP(WildcardQuery *self) {
+    return WildcardQuery_IVARS(self)->pattern;
+}
+
+TermAutomaton*
+WildcardQuery_Make_Automaton_IMP(WildcardQuery *self) {
+    String *pattern = WildcardQuery_IVARS(self)->pattern;
+    return (TermAutomaton*)WildcardAuto_new(pattern);
+}
+
+String*
+WildcardQuery_To_String_IMP(WildcardQuery *self) {
+    WildcardQueryIVARS *const ivars = WildcardQuery_IVARS(self);
+    return Str_newf("%o:%o", ivars->field, ivars->pattern);
+}
+
+bool
+WildcardQuery_Equals_IMP(WildcardQuery *self, Obj *other) {
+    if ((WildcardQuery*)other == self)   { return true; }
+    if (!Obj_is_a(other, WILDCARDQUERY)) { return false; }
+    WildcardQueryIVARS *const ivars = WildcardQuery_IVARS(self);
+    WildcardQueryIVARS *const ovars
+        = WildcardQuery_IVARS((WildcardQuery*)other);
+    if (!Str_Equals(ivars->pattern, (Obj*)ovars->pattern)) { return false; }
+    WildcardQuery_Equals_t super_equals
+        = SUPER_METHOD_PTR(WILDCARDQUERY, LUCY_WildcardQuery_Equals);
+    return super_equals(self, other);
+}
+
+void
+WildcardQuery_Serialize_IMP(WildcardQuery *self, OutStream *outstream) {
+    WildcardQuery_Serialize_t super_serialize
+        = SUPER_METHOD_PTR(WILDCARDQUERY, LUCY_WildcardQuery_Serialize);
+    super_serialize(self, outstream);
+    Freezer_serialize_string(WildcardQuery_IVARS(self)->pattern, outstream);
+}
+
+WildcardQuery*
+WildcardQuery_Deserialize_IMP(WildcardQuery *self, InStream *instream) {
+    WildcardQuery_Deserialize_t super_deserialize
+        = SUPER_METHOD_PTR(WILDCARDQUERY, LUCY_WildcardQuery_Deserialize);
+    self = super_deserialize(self, instream);
+    WildcardQuery_IVARS(self)->pattern = Freezer_read_string(instream);
+    return self;
+}
+
+Obj*
+WildcardQuery_Dump_IMP(WildcardQuery *self) {
+    WildcardQueryIVARS *ivars = WildcardQuery_IVARS(self);
+    WildcardQuery_Dump_t super_dump
+        = SUPER_METHOD_PTR(WILDCARDQUERY, LUCY_WildcardQuery_Dump);
+    Hash *dump = (Hash*)CERTIFY(super_dump(self), HASH);
+    Hash_Store_Utf8(dump, "pattern", 7, Freezer_dump((Obj*)ivars->pattern));
+    return (Obj*)dump;
+}
+
+Obj*
+WildcardQuery_Load_IMP(WildcardQuery *self, Obj *dump) {
+    Hash *source = (Hash*)CERTIFY(dump, HASH);
+    WildcardQuery_Load_t super_load
+        = SUPER_METHOD_PTR(WILDCARDQUERY, LUCY_WildcardQuery_Load);
+    WildcardQuery *loaded = (WildcardQuery*)super_load(self, dump);
+    Obj *pattern = CERTIFY(Hash_Fetch_Utf8(source, "pattern", 7), OBJ);
+    WildcardQuery_IVARS(loaded)->pattern
+        = (String*)CERTIFY(Freezer_load(pattern), STRING);
+    return (Obj*)loaded;
+}
+
@@ -138,8 +138,9 @@ FSFH_do_open(FSFileHandle *self, String *path, uint32_t flags) {
     }
     else if (flags & FH_READ_ONLY) {
         if (SI_init_read_only(self, ivars)) {
-            // On 64-bit systems, map the whole file up-front.
-            if (IS_64_BIT && ivars->len) {
+            // On 64-bit systems, or if asked to, map the whole file
+            // up-front.
+            if ((IS_64_BIT || (flags & FH_MAP_WHOLE)) && ivars->len) {
                 ivars->buf = (char*)SI_map(self, ivars, 0, ivars->len);
                 if (!ivars->buf) {
                     // An error occurred during SI_map, which has set
@@ -168,8 +169,8 @@ bool
 FSFH_Close_IMP(FSFileHandle *self) {
     FSFileHandleIVARS *const ivars = FSFH_IVARS(self);
 
-    // On 64-bit systems, cancel the whole-file mapping.
-    if (IS_64_BIT && (ivars->flags & FH_READ_ONLY) && ivars->buf != NULL) {
+    // Cancel the whole-file mapping, if any.
+    if ((ivars->flags & FH_READ_ONLY) && ivars->buf != NULL) {
         if (!SI_unmap(self, ivars->buf, ivars->len)) { return false; }
         ivars->buf = NULL;
     }
@@ -221,6 +222,11 @@ FSFH_Length_IMP(FSFileHandle *self) {
     return FSFH_IVARS(self)->len;
 }
 
+bool
+FSFH_Is_Mapped_IMP(FSFileHandle *self) {
+    return FSFH_IVARS(self)->buf != NULL;
+}
+
 bool
 FSFH_Window_IMP(FSFileHandle *self, FileWindow *window, int64_t offset,
                 int64_t len) {
@@ -297,6 +303,12 @@ SI_window(FSFileHandle *self, FSFileHandleIVARS *ivars, FileWindow *window,
     // Release the previously mmap'd region, if any.
     FSFH_Release_Window_IMP(self, window);
 
+    // If the whole file was mapped up-front, just point into it.
+    if (ivars->buf) {
+        FileWindow_Set_Window(window, ivars->buf + offset, offset, len);
+        return true;
+    }
+
     // Start map on a page boundary.  Ensure that the window is at
     // least wide enough to view all the data spec'd in the original
     // request.
@@ -319,7 +331,9 @@ bool
 FSFH_Release_Window_IMP(FSFileHandle *self, FileWindow *window) {
     char *buf = FileWindow_Get_Buf(window);
     int64_t len = FileWindow_Get_Len(window);
-    if (!SI_unmap(self, buf, len)) { return false; }
+    if (!FSFH_IVARS(self)->buf) {
+        if (!SI_unmap(self, buf, len)) { return false; }
+    }
     FileWindow_Set_Window(window, NULL, 0, 0);
     return true;
 }
@@ -407,6 +421,41 @@ SI_unmap(FSFileHandle *self, char *buf, int64_t len) {
     return true;
 }
 
+bool
+FSFH_Advise_IMP(FSFileHandle *self, int64_t offset, int64_t len,
+                int32_t advice) {
+    FSFileHandleIVARS *const ivars = FSFH_IVARS(self);
+#ifdef POSIX_MADV_NORMAL
+    if (ivars->buf == NULL || len <= 0) { return true; }
+    if (offset < 0 || offset + len > ivars->len) {
+        Err_set_error(Err_new(Str_newf("Can't advise on offset %i64 and length %i64 of '%o' (len %i64)",
+                                       offset, len, ivars->path, ivars->len)));
+        return false;
+    }
+
+    // The advice has to start on a page boundary.
+    const int64_t remainder = offset % ivars->page_size;
+    int posix_advice = advice == FH_ADVICE_RANDOM
+                       ? POSIX_MADV_RANDOM
+                       : advice == FH_ADVICE_SEQUENTIAL
+                       ? POSIX_MADV_SEQUENTIAL
+                       : POSIX_MADV_NORMAL;
+    int check_val = posix_madvise(ivars->buf + offset - remainder,
+                                  (size_t)(len + remainder), posix_advice);
+    if (check_val != 0) {
+        Err_set_error(Err_new(Str_newf("posix_madvise on '%o' failed: %s",
+                                       ivars->path, strerror(check_val))));
+        return false;
+    }
+#else
+    UNUSED_VAR(ivars);
+    UNUSED_VAR(offset);
+    UNUSED_VAR(len);
+    UNUSED_VAR(advice);
+#endif
+    return true;
+}
+
 #if !IS_64_BIT
 bool
 FSFH_Read_IMP(FSFileHandle *self, char *dest, int64_t offset, size_t len) {
@@ -539,6 +588,17 @@ SI_unmap(FSFileHandle *self, char *buf, int64_t len) {
     return true;
 }
 
+bool
+FSFH_Advise_IMP(FSFileHandle *self, int64_t offset, int64_t len,
+                int32_t advice) {
+    // No equivalent of madvise() is used on Windows.
+    UNUSED_VAR(self);
+    UNUSED_VAR(offset);
+    UNUSED_VAR(len);
+    UNUSED_VAR(advice);
+    return true;
+}
+
 static CFISH_INLINE bool
 SI_close_win_handles(FSFileHandle *self) {
     FSFileHandleIVARS *ivars = FSFH_IVARS(self);
@@ -91,10 +91,21 @@ FSFolder*
 FSFolder_init(FSFolder *self, String *path) {
     String *abs_path = S_absolutify(path);
     Folder_init((Folder*)self, abs_path);
+    FSFolder_IVARS(self)->map_whole_files = false;
     DECREF(abs_path);
     return self;
 }
 
+void
+FSFolder_Set_Map_Whole_Files_IMP(FSFolder *self, bool map_whole_files) {
+    FSFolder_IVARS(self)->map_whole_files = map_whole_files;
+}
+
+bool
+FSFolder_Get_Map_Whole_Files_IMP(FSFolder *self) {
+    return FSFolder_IVARS(self)->map_whole_files;
+}
+
 void
 FSFolder_Initialize_IMP(FSFolder *self) {
     FSFolderIVARS *const ivars = FSFolder_IVARS(self);
@@ -115,6 +126,9 @@ FileHandle*
 FSFolder_Local_Open_FileHandle_IMP(FSFolder *self, String *name,
                                    uint32_t flags) {
     String       *fullpath = S_fullpath(self, name);
+    if ((flags & FH_READ_ONLY) && FSFolder_IVARS(self)->map_whole_files) {
+        flags |= FH_MAP_WHOLE;
+    }
     FSFileHandle *fh = FSFH_open(fullpath, flags);
     if (!fh) { ERR_ADD_FRAME(Err_get_error()); }
     DECREF(fullpath);
@@ -254,6 +268,8 @@ FSFolder_Local_Find_Folder_IMP(FSFolder *self, String *name) {
             DECREF(fullpath);
             THROW(ERR, "Failed to open FSFolder at '%o'", fullpath);
         }
+        FSFolder_IVARS((FSFolder*)subfolder)->map_whole_files
+            = ivars->map_whole_files;
         // Try to open a CompoundFileReader. On failure, just use the
         // existing folder.
         String *cfmeta_file = SSTR_WRAP_C("cfmeta.json");
@@ -0,0 +1,623 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_FSLOCK
+#include "Lucy/Util/ToolSet.h"
+
+#include "charmony.h"
+
+#include "Lucy/Store/FSLock.h"
+#include "Lucy/Store/FSFolder.h"
+#include "Lucy/Util/Json.h"
+#include "Lucy/Util/ProcessID.h"
+
+#if (defined(CHY_HAS_UNISTD_H) && defined(CHY_HAS_FCNTL_H) \
+     && !(defined(CHY_HAS_WINDOWS_H) && !defined(__CYGWIN__)))
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Open file description locks belong to the open file rather than to the
+// process, as flock() locks do, so two FSLocks within one process exclude
+// each other, and closing one descriptor leaves other locks alone.  Plain
+// fcntl() locks don't behave that way and can't be used.
+#ifndef F_OFD_SETLK
+  #include <sys/file.h>
+#endif
+
+#ifdef CHY_HAS_PTHREAD_H
+  #include <pthread.h>
+  #define LUCY_HAS_LOCK_WAITER
+#endif
+
+// Keep lock files from leaking into programs we exec.
+#ifndef O_CLOEXEC
+  #define O_CLOEXEC 0
+#endif
+
+#define KIND_SHARED    1
+#define KIND_EXCLUSIVE 2
+
+// Take a lock on an open file.  Return 0 on success, or an errno value,
+// which is EWOULDBLOCK if someone else holds the lock and `wait` is false.
+static int
+S_lock_fd(int fd, int kind, bool wait) {
+#ifdef F_OFD_SETLK
+    struct flock request;
+    memset(&request, 0, sizeof(request));
+    request.l_type   = kind == KIND_SHARED ? F_RDLCK : F_WRLCK;
+    request.l_whence = SEEK_SET;
+    request.l_start  = 0;
+    request.l_len    = 0;
+    while (fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &request) == -1) {
+        if (errno == EACCES || errno == EAGAIN) { return EWOULDBLOCK; }
+        if (errno != EINTR) { return errno; }
+    }
+#else
+    int operation = kind == KIND_SHARED ? LOCK_SH : LOCK_EX;
+    if (!wait) { operation |= LOCK_NB; }
+    while (flock(fd, operation) == -1) {
+        if (errno == EAGAIN) { return EWOULDBLOCK; }
+        if (errno != EINTR) { return errno; }
+    }
+#endif
+    return 0;
+}
+
+#ifdef F_OFD_GETLK
+// Report whether a lock of `kind` could be taken on an open file, the way
+// S_lock_fd() does, without taking it.  Locks held through `fd` itself don't
+// count.
+static int
+S_test_fd(int fd, int kind) {
+    struct flock request;
+    memset(&request, 0, sizeof(request));
+    request.l_type   = kind == KIND_SHARED ? F_RDLCK : F_WRLCK;
+    request.l_whence = SEEK_SET;
+    request.l_start  = 0;
+    request.l_len    = 0;
+    if (fcntl(fd, F_OFD_GETLK, &request) == -1) { return errno; }
+    return request.l_type == F_UNLCK ? 0 : EWOULDBLOCK;
+}
+#endif
+
+#ifdef LUCY_HAS_LOCK_WAITER
+
+// A blocking lock call can't time out, so it runs on a thread of its own
+// while callers wait for it with a deadline.  There is at most one such
+// thread per lock file and kind: a caller which finds one already waiting
+// joins it instead of starting another, so callers which keep timing out
+// against a long-held lock don't pile up threads.  Whoever is waiting when
+// the thread gets the lock takes over its descriptor; if nobody is, the
+// thread drops the lock and goes away.
+typedef struct S_Waiter {
+    struct S_Waiter *next;
+    char            *path;
+    int              kind;
+    int              fd;
+    int              result;
+    int              num_waiting;
+    bool             done;
+    pthread_cond_t   cond;
+} S_Waiter;
+
+static pthread_mutex_t S_waiters_mutex = PTHREAD_MUTEX_INITIALIZER;
+static S_Waiter       *S_waiters       = NULL;
+static int32_t         S_num_threads   = 0;
+
+// Returned to a caller when the lock which the waiter got went to another
+// caller.
+#define S_RETRY -1
+
+static void
+S_free_waiter(S_Waiter *waiter) {
+    if (waiter->fd != -1) { close(waiter->fd); }
+    pthread_cond_destroy(&waiter->cond);
+    free(waiter->path);
+    free(waiter);
+}
+
+static void*
+S_waiter_main(void *arg) {
+    S_Waiter *waiter = (S_Waiter*)arg;
+    int result = S_lock_fd(waiter->fd, waiter->kind, true);
+
+    pthread_mutex_lock(&S_waiters_mutex);
+    for (S_Waiter **ptr = &S_waiters; *ptr; ptr = &(*ptr)->next) {
+        if (*ptr == waiter) {
+            *ptr = waiter->next;
+            break;
+        }
+    }
+    S_num_threads--;
+    waiter->result = result;
+    waiter->done   = true;
+    if (waiter->num_waiting) {
+        pthread_cond_broadcast(&waiter->cond);
+    }
+    else {
+        // Closing the descriptor drops the lock.
+        S_free_waiter(waiter);
+    }
+    pthread_mutex_unlock(&S_waiters_mutex);
+    return NULL;
+}
+
+// Find the waiter for `path` and `kind`, or start one.  The caller must hold
+// the mutex.  Return NULL and set `*result` to an errno value on failure.
+static S_Waiter*
+S_find_waiter(const char *path, int kind, int *result) {
+    for (S_Waiter *waiter = S_waiters; waiter; waiter = waiter->next) {
+        if (waiter->kind == kind && strcmp(waiter->path, path) == 0) {
+            return waiter;
+        }
+    }
+
+    size_t    path_size = strlen(path) + 1;
+    S_Waiter *waiter    = (S_Waiter*)malloc(sizeof(S_Waiter));
+    char     *path_copy = (char*)malloc(path_size);
+    if (!waiter || !path_copy) {
+        free(path_copy);
+        free(waiter);
+        *result = ENOMEM;
+        return NULL;
+    }
+    memcpy(path_copy, path, path_size);
+    waiter->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (waiter->fd == -1) {
+        *result = errno;
+        free(path_copy);
+        free(waiter);
+        return NULL;
+    }
+    waiter->next        = NULL;
+    waiter->path        = path_copy;
+    waiter->kind        = kind;
+    waiter->result      = 0;
+    waiter->num_waiting = 0;
+    waiter->done        = false;
+    pthread_cond_init(&waiter->cond, NULL);
+
+    // The thread can't finish before the waiter is listed, since it needs
+    // the mutex to do so.
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, S_waiter_main, waiter) != 0) {
+        S_free_waiter(waiter);
+        *result = EWOULDBLOCK;
+        return NULL;
+    }
+    pthread_detach(thread);
+    waiter->next = S_waiters;
+    S_waiters    = waiter;
+    S_num_threads++;
+    return waiter;
+}
+
+// Block until the lock is ours or the deadline passes.  On success, `*fd`
+// is set to a new descriptor which holds the lock.
+static int
+S_lock_fd_by(const char *path, int kind, const struct timespec *deadline,
+             int *fd) {
+    int result = 0;
+    pthread_mutex_lock(&S_waiters_mutex);
+    S_Waiter *waiter = S_find_waiter(path, kind, &result);
+    if (!waiter) {
+        pthread_mutex_unlock(&S_waiters_mutex);
+        return result;
+    }
+
+    int wait_result = 0;
+    waiter->num_waiting++;
+    while (!waiter->done && wait_result != ETIMEDOUT) {
+        wait_result = pthread_cond_timedwait(&waiter->cond, &S_waiters_mutex,
+                                             deadline);
+    }
+    waiter->num_waiting--;
+
+    if (!waiter->done) {
+        result = EWOULDBLOCK;
+    }
+    else if (waiter->result != 0) {
+        result = waiter->result;
+    }
+    else if (waiter->fd != -1) {
+        *fd        = waiter->fd;
+        waiter->fd = -1;
+        result     = 0;
+    }
+    else {
+        result = S_RETRY;
+    }
+    if (waiter->done && !waiter->num_waiting) { S_free_waiter(waiter); }
+    pthread_mutex_unlock(&S_waiters_mutex);
+    return result;
+}
+
+#endif // LUCY_HAS_LOCK_WAITER
+
+// Return true if `fd` is still the file at `path` rather than one which
+// was removed by its last holder while we waited for it.  Set `*result` to
+// an errno value if the check itself failed.
+static bool
+S_same_file(int fd, const char *path, int *result) {
+    struct stat fd_stat;
+    struct stat path_stat;
+    *result = 0;
+    if (fstat(fd, &fd_stat) == -1) {
+        *result = errno;
+        return false;
+    }
+    if (stat(path, &path_stat) == -1) {
+        if (errno != ENOENT) { *result = errno; }
+        return false;
+    }
+    return fd_stat.st_dev == path_stat.st_dev
+           && fd_stat.st_ino == path_stat.st_ino;
+}
+
+static bool
+S_make_lock_dir(FSLockIVARS *ivars) {
+    String *lock_dir_name = SSTR_WRAP_C("locks");
+    if (Folder_Exists(ivars->folder, lock_dir_name)) { return true; }
+    if (Folder_MkDir(ivars->folder, lock_dir_name)) { return true; }
+
+    // Maybe our attempt failed because another process succeeded.
+    if (Folder_Find_Folder(ivars->folder, lock_dir_name)) { return true; }
+    Err *mkdir_err = (Err*)CERTIFY(Err_get_error(), ERR);
+    String *mess = Str_newf("Can't create 'locks' directory: %o",
+                            Err_Get_Mess(mkdir_err));
+    Err_set_error((Err*)LockErr_new(mess));
+    return false;
+}
+
+// Record who holds an exclusive lock.
+static bool
+S_write_holder(FSLockIVARS *ivars) {
+    Hash *file_data = Hash_new(3);
+    Hash_Store_Utf8(file_data, "pid", 3,
+                    (Obj*)Str_newf("%i32", (int32_t)PID_getpid()));
+    Hash_Store_Utf8(file_data, "host", 4, INCREF(ivars->host));
+    Hash_Store_Utf8(file_data, "name", 4, INCREF(ivars->name));
+    String *json = Json_to_json((Obj*)file_data);
+    DECREF(file_data);
+
+    size_t  size    = Str_Get_Size(json);
+    bool    success = ftruncate(ivars->fd, 0) == 0
+                      && pwrite(ivars->fd, Str_Get_Ptr8(json), size, 0)
+                         == (ssize_t)size;
+    if (!success) {
+        Err_set_error((Err*)LockErr_new(Str_newf("Can't write to '%o': %s",
+                                                 ivars->file_path,
+                                                 strerror(errno))));
+    }
+    DECREF(json);
+    return success;
+}
+
+// Acquire the lock, waiting until `deadline` if it isn't NULL.
+static bool
+S_acquire(FSLock *self, const struct timespec *deadline) {
+    FSLockIVARS *const ivars = FSLock_IVARS(self);
+    if (ivars->fd != -1) {
+        String *mess = Str_newf("Lock already obtained via '%o'",
+                                ivars->lock_path);
+        Err_set_error((Err*)LockErr_new(mess));
+        return false;
+    }
+    if (!S_make_lock_dir(ivars)) { return false; }
+
+    const int kind    = ivars->shared ? KIND_SHARED : KIND_EXCLUSIVE;
+    char     *path    = Str_To_Utf8(ivars->file_path);
+    int       result  = 0;
+
+    while (true) {
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        if (fd == -1) {
+            result = errno;
+            break;
+        }
+        result = S_lock_fd(fd, kind, false);
+#ifdef LUCY_HAS_LOCK_WAITER
+        if (result == EWOULDBLOCK && deadline) {
+            int waited_fd = -1;
+            result = S_lock_fd_by(path, kind, deadline, &waited_fd);
+            if (result == S_RETRY) {
+                close(fd);
+                continue;
+            }
+            if (result == 0) {
+                close(fd);
+                fd = waited_fd;
+            }
+        }
+#else
+        UNUSED_VAR(deadline);
+#endif
+        if (result == 0 && S_same_file(fd, path, &result)) {
+            ivars->fd = fd;
+            break;
+        }
+        close(fd);
+        if (result != 0) { break; }
+        // Otherwise the file went away while we waited, so try a new one.
+    }
+
+    FREEMEM(path);
+    if (result != 0) {
+        String *mess = result == EWOULDBLOCK
+                       ? Str_newf("Can't obtain lock: '%o' is locked",
+                                  ivars->lock_path)
+                       : Str_newf("Failed to obtain lock at '%o': %s",
+                                  ivars->lock_path, strerror(result));
+        Err_set_error((Err*)LockErr_new(mess));
+        return false;
+    }
+    if (!ivars->shared && !S_write_holder(ivars)) {
+        FSLock_Release(self);
+        return false;
+    }
+    return true;
+}
+
+bool
+FSLock_available() {
+    return true;
+}
+
+int32_t
+FSLock_num_waiters() {
+#ifdef LUCY_HAS_LOCK_WAITER
+    pthread_mutex_lock(&S_waiters_mutex);
+    int32_t num_threads = S_num_threads;
+    pthread_mutex_unlock(&S_waiters_mutex);
+    return num_threads;
+#else
+    return 0;
+#endif
+}
+
+FSLock*
+FSLock_init(FSLock *self, Folder *folder, String *name, String *host,
+            int32_t timeout, int32_t interval, bool shared) {
+    FSLockIVARS *const ivars = FSLock_IVARS(self);
+    ivars->fd = -1;
+    CERTIFY(folder, FSFOLDER);
+    Lock_init((Lock*)self, folder, name, host, timeout, interval);
+    ivars->shared = shared;
+
+    // Use a name of our own so that LockFileLocks can't mistake our files
+    // for theirs.
+    DECREF(ivars->lock_path);
+    ivars->lock_path = Str_newf("locks/%o.flock", name);
+    ivars->file_path = Str_newf("%o/%o", Folder_Get_Path(folder),
+                                ivars->lock_path);
+    return self;
+}
+
+bool
+FSLock_Obtain_IMP(FSLock *self) {
+    bool locked;
+#ifdef LUCY_HAS_LOCK_WAITER
+    FSLockIVARS *const ivars = FSLock_IVARS(self);
+    if (ivars->timeout > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += ivars->timeout / 1000;
+        deadline.tv_nsec += (long)(ivars->timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec  += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        locked = S_acquire(self, &deadline);
+    }
+    else {
+        locked = S_acquire(self, NULL);
+    }
+    if (!locked) { ERR_ADD_FRAME(Err_get_error()); }
+#else
+    // Fall back to polling once per interval.
+    FSLock_Obtain_t super_obtain
+        = SUPER_METHOD_PTR(FSLOCK, LUCY_FSLock_Obtain);
+    locked = super_obtain(self);
+#endif
+    return locked;
+}
+
+bool
+FSLock_Request_IMP(FSLock *self) {
+    return S_acquire(self, NULL);
+}
+
+void
+FSLock_Release_IMP(FSLock *self) {
+    FSLockIVARS *const ivars = FSLock_IVARS(self);
+    if (ivars->fd == -1) { return; }
+
+    // Remove the file if nobody else holds a lock on it.  Anyone who is
+    // waiting on it will notice and move on to a fresh file.  A shared
+    // holder has to take the lock over before removing the file, or a
+    // reader could lock it just before it goes away; ask first where we
+    // can, so that readers obtaining the lock meanwhile aren't turned away.
+    bool remove = true;
+    if (ivars->shared) {
+#ifdef F_OFD_GETLK
+        remove = S_test_fd(ivars->fd, KIND_EXCLUSIVE) == 0
+                 && S_lock_fd(ivars->fd, KIND_EXCLUSIVE, false) == 0;
+#else
+        remove = S_lock_fd(ivars->fd, KIND_EXCLUSIVE, false) == 0;
+#endif
+    }
+    if (remove) {
+        char *path = Str_To_Utf8(ivars->file_path);
+        unlink(path);
+        FREEMEM(path);
+    }
+
+    // Closing the only descriptor for the file drops the lock.
+    close(ivars->fd);
+    ivars->fd = -1;
+}
+
+bool
+FSLock_Is_Locked_IMP(FSLock *self) {
+    FSLockIVARS *const ivars = FSLock_IVARS(self);
+    if (ivars->fd != -1) { return true; }
+
+    char *path = Str_To_Utf8(ivars->file_path);
+    int   fd   = open(path, O_RDWR | O_CLOEXEC);
+    FREEMEM(path);
+    if (fd == -1) { return false; }
+
+    // Any error counts as locked, to be safe.  flock() can't say who holds
+    // a lock, so there we find out by taking it briefly.
+#ifdef F_OFD_GETLK
+    bool locked = S_test_fd(fd, KIND_EXCLUSIVE) != 0;
+#else
+    bool locked = S_lock_fd(fd, KIND_EXCLUSIVE, false) != 0;
+#endif
+    close(fd);
+    return locked;
+}
+
+// Return true unless the lock file names a process on this host which is
+// still running, or a holder on another host, which we can't check.
+static bool
+S_holder_gone(FSLockIVARS *ivars) {
+    Hash *hash = (Hash*)Json_slurp_json(ivars->folder, ivars->lock_path);
+    if (!hash || !Obj_is_a((Obj*)hash, HASH)) {
+        // Nothing recorded: either a shared lock file or an empty one.
+        DECREF(hash);
+        return true;
+    }
+
+    bool    gone    = true;
+    String *pid_buf = (String*)Hash_Fetch_Utf8(hash, "pid", 3);
+    String *host    = (String*)Hash_Fetch_Utf8(hash, "host", 4);
+    if (host && Str_is_a(host, STRING)
+        && !Str_Equals(host, (Obj*)ivars->host)
+       ) {
+        gone = false;
+    }
+    else if (pid_buf && Str_is_a(pid_buf, STRING)) {
+        int pid = (int)Str_To_I64(pid_buf);
+        gone = pid != PID_getpid() && !PID_active(pid);
+    }
+    DECREF(hash);
+    return gone;
+}
+
+void
+FSLock_Clear_Stale_IMP(FSLock *self) {
+    FSLockIVARS *const ivars = FSLock_IVARS(self);
+    if (ivars->fd != -1) { return; }
+
+    char *path = Str_To_Utf8(ivars->file_path);
+    int   fd   = open(path, O_RDWR | O_CLOEXEC);
+    if (fd != -1) {
+        int result;
+        if (S_lock_fd(fd, KIND_EXCLUSIVE, false) == 0
+            && S_same_file(fd, path, &result)
+            && S_holder_gone(ivars)
+           ) {
+            unlink(path);
+        }
+        close(fd);
+    }
+    FREEMEM(path);
+}
+
+#else // No kernel file locks.
+
+bool
+FSLock_available() {
+    return false;
+}
+
+int32_t
+FSLock_num_waiters() {
+    return 0;
+}
+
+FSLock*
+FSLock_init(FSLock *self, Folder *folder, String *name, String *host,
+            int32_t timeout, int32_t interval, bool shared) {
+    UNUSED_VAR(folder);
+    UNUSED_VAR(name);
+    UNUSED_VAR(host);
+    UNUSED_VAR(timeout);
+    UNUSED_VAR(interval);
+    UNUSED_VAR(shared);
+    DECREF(self);
+    THROW(ERR, "FSLock isn't supported on this platform");
+    UNREACHABLE_RETURN(FSLock*);
+}
+
+bool
+FSLock_Obtain_IMP(FSLock *self) {
+    UNUSED_VAR(self);
+    UNREACHABLE_RETURN(bool);
+}
+
+bool
+FSLock_Request_IMP(FSLock *self) {
+    UNUSED_VAR(self);
+    UNREACHABLE_RETURN(bool);
+}
+
+void
+FSLock_Release_IMP(FSLock *self) {
+    UNUSED_VAR(self);
+}
+
+bool
+FSLock_Is_Locked_IMP(FSLock *self) {
+    UNUSED_VAR(self);
+    UNREACHABLE_RETURN(bool);
+}
+
+void
+FSLock_Clear_Stale_IMP(FSLock *self) {
+    UNUSED_VAR(self);
+}
+
+#endif // Kernel file locks.
+
+FSLock*
+FSLock_new(Folder *folder, String *name, String *host, int32_t timeout,
+           int32_t interval, bool shared) {
+    FSLock *self = (FSLock*)Class_Make_Obj(FSLOCK);
+    return FSLock_init(self, folder, name, host, timeout, interval, shared);
+}
+
+bool
+FSLock_Shared_IMP(FSLock *self) {
+    return FSLock_IVARS(self)->shared;
+}
+
+void
+FSLock_Destroy_IMP(FSLock *self) {
+    FSLockIVARS *const ivars = FSLock_IVARS(self);
+    FSLock_Release(self);
+    DECREF(ivars->file_path);
+    SUPER_DESTROY(self, FSLOCK);
+}
+
+
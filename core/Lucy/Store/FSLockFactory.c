@@ -0,0 +1,68 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_FSLOCKFACTORY
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Store/FSLockFactory.h"
+#include "Lucy/Store/FSFolder.h"
+#include "Lucy/Store/FSLock.h"
+
+FSLockFactory*
+FSLockFact_new(Folder *folder, String *host) {
+    FSLockFactory *self = (FSLockFactory*)Class_Make_Obj(FSLOCKFACTORY);
+    return FSLockFact_init(self, folder, host);
+}
+
+FSLockFactory*
+FSLockFact_init(FSLockFactory *self, Folder *folder, String *host) {
+    LockFact_init((LockFactory*)self, folder, host);
+    return self;
+}
+
+static bool
+S_use_kernel_locks(FSLockFactory *self) {
+    FSLockFactoryIVARS *const ivars = FSLockFact_IVARS(self);
+    return FSLock_available() && Folder_is_a(ivars->folder, FSFOLDER);
+}
+
+Lock*
+FSLockFact_Make_Lock_IMP(FSLockFactory *self, String *name,
+                         int32_t timeout, int32_t interval) {
+    if (!S_use_kernel_locks(self)) {
+        FSLockFact_Make_Lock_t super_make_lock
+            = SUPER_METHOD_PTR(FSLOCKFACTORY, LUCY_FSLockFact_Make_Lock);
+        return super_make_lock(self, name, timeout, interval);
+    }
+    FSLockFactoryIVARS *const ivars = FSLockFact_IVARS(self);
+    return (Lock*)FSLock_new(ivars->folder, name, ivars->host, timeout,
+                             interval, false);
+}
+
+Lock*
+FSLockFact_Make_Shared_Lock_IMP(FSLockFactory *self, String *name,
+                                int32_t timeout, int32_t interval) {
+    if (!S_use_kernel_locks(self)) {
+        FSLockFact_Make_Shared_Lock_t super_make_shared_lock
+            = SUPER_METHOD_PTR(FSLOCKFACTORY,
+                               LUCY_FSLockFact_Make_Shared_Lock);
+        return super_make_shared_lock(self, name, timeout, interval);
+    }
+    FSLockFactoryIVARS *const ivars = FSLockFact_IVARS(self);
+    return (Lock*)FSLock_new(ivars->folder, name, ivars->host, timeout,
+                             interval, true);
+}
+
@@ -52,6 +52,22 @@ FH_Grow_IMP(FileHandle *self, int64_t length) {
     return true;
 }
 
+bool
+FH_Is_Mapped_IMP(FileHandle *self) {
+    UNUSED_VAR(self);
+    return false;
+}
+
+bool
+FH_Advise_IMP(FileHandle *self, int64_t offset, int64_t len,
+              int32_t advice) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(offset);
+    UNUSED_VAR(len);
+    UNUSED_VAR(advice);
+    return true;
+}
+
 void
 FH_Set_Path_IMP(FileHandle *self, String *path) {
     FileHandleIVARS *const ivars = FH_IVARS(self);
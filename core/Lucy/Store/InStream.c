@@ -213,8 +213,16 @@ S_fill(InStream *self, int64_t amount) {
               ivars->filename, virtual_file_pos, ivars->len, amount);
     }
 
-    // Make the request.
-    if (FH_Window(ivars->file_handle, window, real_file_pos, amount)) {
+    // Make the request.  If the FileHandle has mapped the whole file,
+    // expose all of the virtual file at once, turning later refills and
+    // seeks into pointer arithmetic.
+    int64_t window_pos = real_file_pos;
+    int64_t window_len = amount;
+    if (FH_Is_Mapped(ivars->file_handle)) {
+        window_pos = ivars->offset;
+        window_len = ivars->len;
+    }
+    if (FH_Window(ivars->file_handle, window, window_pos, window_len)) {
         char    *fw_buf    = FileWindow_Get_Buf(window);
         int64_t  fw_offset = FileWindow_Get_Offset(window);
         int64_t  fw_len    = FileWindow_Get_Len(window);
@@ -241,6 +249,14 @@ InStream_Fill_IMP(InStream *self, int64_t amount) {
     S_fill(self, amount);
 }
 
+void
+InStream_Advise_IMP(InStream *self, int32_t advice) {
+    InStreamIVARS *const ivars = InStream_IVARS(self);
+    if (ivars->file_handle) {
+        FH_Advise(ivars->file_handle, ivars->offset, ivars->len, advice);
+    }
+}
+
 void
 InStream_Seek_IMP(InStream *self, int64_t target) {
     InStreamIVARS *const ivars = InStream_IVARS(self);
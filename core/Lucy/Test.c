@@ -32,27 +32,42 @@
 #include "Lucy/Test/Analysis/TestStandardTokenizer.h"
 #include "Lucy/Test/Highlight/TestHeatMap.h"
 #include "Lucy/Test/Highlight/TestHighlighter.h"
+#include "Lucy/Test/Index/TestBlockPosting.h"
+#include "Lucy/Test/Index/TestDeletionsWriter.h"
 #include "Lucy/Test/Index/TestDocWriter.h"
 #include "Lucy/Test/Index/TestHighlightWriter.h"
 #include "Lucy/Test/Index/TestIndexManager.h"
+#include "Lucy/Test/Index/TestDocValues.h"
+#include "Lucy/Test/Index/TestIndexer.h"
+#include "Lucy/Test/Index/TestIndexSort.h"
 #include "Lucy/Test/Index/TestPolyReader.h"
 #include "Lucy/Test/Index/TestPostingListWriter.h"
+#include "Lucy/Test/Index/TestSegLexicon.h"
 #include "Lucy/Test/Index/TestSegWriter.h"
 #include "Lucy/Test/Index/TestSegment.h"
+#include "Lucy/Test/Index/TestSkipList.h"
 #include "Lucy/Test/Index/TestSnapshot.h"
 #include "Lucy/Test/Index/TestSortWriter.h"
 #include "Lucy/Test/Index/TestTermInfo.h"
 #include "Lucy/Test/Object/TestBitVector.h"
 #include "Lucy/Test/Object/TestI32Array.h"
+#include "Lucy/Test/Object/TestRoaringBitVector.h"
 #include "Lucy/Test/Plan/TestBlobType.h"
 #include "Lucy/Test/Plan/TestFieldMisc.h"
 #include "Lucy/Test/Plan/TestFieldType.h"
 #include "Lucy/Test/Plan/TestFullTextType.h"
 #include "Lucy/Test/Plan/TestNumericType.h"
+#include "Lucy/Test/Search/TestANDMatcher.h"
+#include "Lucy/Test/Search/TestFacetCollector.h"
+#include "Lucy/Test/Search/TestFilterQuery.h"
+#include "Lucy/Test/Search/TestImpactMatcher.h"
+#include "Lucy/Test/Search/TestIndexSearcher.h"
 #include "Lucy/Test/Search/TestLeafQuery.h"
 #include "Lucy/Test/Search/TestMatchAllQuery.h"
+#include "Lucy/Test/Search/TestMultiTermQuery.h"
 #include "Lucy/Test/Search/TestNOTQuery.h"
 #include "Lucy/Test/Search/TestNoMatchQuery.h"
+#include "Lucy/Test/Search/TestNumericRangeQuery.h"
 #include "Lucy/Test/Search/TestPhraseQuery.h"
 #include "Lucy/Test/Search/TestPolyQuery.h"
 #include "Lucy/Test/Search/TestQueryParserLogic.h"
@@ -63,11 +78,13 @@
 #include "Lucy/Test/Search/TestSortSpec.h"
 #include "Lucy/Test/Search/TestSpan.h"
 #include "Lucy/Test/Search/TestTermQuery.h"
+#include "Lucy/Test/Search/TestWANDScorer.h"
 #include "Lucy/Test/Store/TestCompoundFileReader.h"
 #include "Lucy/Test/Store/TestCompoundFileWriter.h"
 #include "Lucy/Test/Store/TestFSDirHandle.h"
 #include "Lucy/Test/Store/TestFSFileHandle.h"
 #include "Lucy/Test/Store/TestFSFolder.h"
+#include "Lucy/Test/Store/TestFSLock.h"
 #include "Lucy/Test/Store/TestFileHandle.h"
 #include "Lucy/Test/Store/TestFolder.h"
 #include "Lucy/Test/Store/TestIOChunks.h"
@@ -78,9 +95,11 @@
 #include "Lucy/Test/Store/TestRAMFolder.h"
 #include "Lucy/Test/TestSchema.h"
 #include "Lucy/Test/TestSimple.h"
+#include "Lucy/Test/Util/TestFST.h"
 #include "Lucy/Test/Util/TestFreezer.h"
 #include "Lucy/Test/Util/TestIndexFileNames.h"
 #include "Lucy/Test/Util/TestJson.h"
+#include "Lucy/Test/Util/TestLZ4.h"
 #include "Lucy/Test/Util/TestMemoryPool.h"
 #include "Lucy/Test/Util/TestNumberUtils.h"
 #include "Lucy/Test/Util/TestPriorityQueue.h"
@@ -92,12 +111,15 @@ Test_create_test_suite() {
 
     TestSuite_Add_Batch(suite, (TestBatch*)TestPriQ_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestBitVector_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestRoarBitVec_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestSortExternal_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestMemPool_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestNumUtil_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestIxFileNames_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestJson_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestFreezer_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestLZ4_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestFST_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestI32Arr_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestRAMFH_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestFSFH_new());
@@ -108,6 +130,7 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestRAMDH_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestFSDH_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestFSFolder_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestFSLock_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestRAMFolder_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestFolder_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestIxManager_new());
@@ -123,6 +146,7 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestStandardTokenizer_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestSnapshot_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestTermInfo_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestSkipList_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestFieldMisc_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestBatchSchema_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestDocWriter_new());
@@ -130,7 +154,13 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestPListWriter_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestSegWriter_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestSortWriter_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestBlockPost_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestPolyReader_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestDelWriter_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestIndexer_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestIndexSort_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestSegLex_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestDocValues_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestFullTextType_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestBlobType_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestNumericType_new());
@@ -144,14 +174,22 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestPhraseQuery_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestSortSpec_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestRangeQuery_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestNumericRangeQuery_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestANDQuery_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestANDMatcher_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestMatchAllQuery_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestNOTQuery_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestFilterQuery_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestFacetCollector_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestMultiTermQuery_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestReqOptQuery_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestLeafQuery_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestNoMatchQuery_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestSeriesMatcher_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestORQuery_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestWANDScorer_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestImpactMatcher_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestIxSearcher_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestQPLogic_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestQPSyntax_new());
 
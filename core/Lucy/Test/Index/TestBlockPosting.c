@@ -0,0 +1,192 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Index/TestBlockPosting.h"
+#include "Lucy/Test/TestSchema.h"
+#include "Lucy/Analysis/StandardTokenizer.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/BlockSimilarity.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/Posting/BlockPosting.h"
+#include "Lucy/Index/PostingList.h"
+#include "Lucy/Index/PostingListReader.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Plan/FullTextType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_DOCS 100
+
+TestBlockPosting*
+TestBlockPost_new() {
+    return (TestBlockPosting*)Class_Make_Obj(TESTBLOCKPOSTING);
+}
+
+BlockTextType*
+BlockTextType_new(Analyzer *analyzer) {
+    BlockTextType *self = (BlockTextType*)Class_Make_Obj(BLOCKTEXTTYPE);
+    return (BlockTextType*)FullTextType_init((FullTextType*)self, analyzer);
+}
+
+Similarity*
+BlockTextType_Make_Similarity_IMP(BlockTextType *self) {
+    UNUSED_VAR(self);
+    return (Similarity*)BlockSim_new();
+}
+
+// Doc n contains "common" (n % 3) + 1 times, and "even" if n is even.
+static void
+S_add_docs(Indexer *indexer, int32_t start, int32_t end) {
+    String *field = SSTR_WRAP_C("block");
+    for (int32_t n = start; n <= end; n++) {
+        String *content = (n % 3) == 0 ? Str_newf("common x")
+                        : (n % 3) == 1 ? Str_newf("common x common")
+                        :                Str_newf("common common common");
+        if (n % 2 == 0) {
+            String *with_even = Str_newf("%o even", content);
+            DECREF(content);
+            content = with_even;
+        }
+        Doc *doc = Doc_new(NULL, 0);
+        Doc_Store(doc, field, (Obj*)content);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(doc);
+        DECREF(content);
+    }
+}
+
+static PostingList*
+S_posting_list(PolyReader *reader, const char *term) {
+    Vector *seg_readers = PolyReader_Get_Seg_Readers(reader);
+    SegReader *seg_reader = (SegReader*)Vec_Fetch(seg_readers, 0);
+    PostingListReader *plist_reader
+        = (PostingListReader*)SegReader_Fetch(
+              seg_reader, Class_Get_Name(POSTINGLISTREADER));
+    String *field = SSTR_WRAP_C("block");
+    return PListReader_Posting_List(plist_reader, field,
+                                    (Obj*)SSTR_WRAP_C(term));
+}
+
+static void
+S_test_index(TestBatchRunner *runner, RAMFolder *folder, const char *label) {
+    PolyReader  *reader = PolyReader_open((Obj*)folder, NULL, NULL);
+    PostingList *plist  = S_posting_list(reader, "common");
+
+    TEST_TRUE(runner, Obj_is_a((Obj*)PList_Get_Posting(plist), BLOCKPOSTING),
+              "BlockSimilarity produces BlockPosting (%s)", label);
+    TEST_INT_EQ(runner, PList_Get_Doc_Freq(plist), NUM_DOCS,
+                "doc freq (%s)", label);
+
+    bool docs_ok = true;
+    bool freqs_ok = true;
+    bool prox_ok = true;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        int32_t doc_id = PList_Next(plist);
+        ScorePosting *posting = (ScorePosting*)PList_Get_Posting(plist);
+        int32_t  freq = ScorePost_Get_Freq(posting);
+        uint32_t *prox = ScorePost_Get_Prox(posting);
+        int32_t  expected_freq = (n % 3) + 1;
+        if (doc_id != n) { docs_ok = false; }
+        if (freq != expected_freq) { freqs_ok = false; }
+        if ((n % 3) == 1 && (prox[0] != 0 || prox[1] != 2)) {
+            prox_ok = false;
+        }
+    }
+    TEST_TRUE(runner, docs_ok, "Next returns every doc id (%s)", label);
+    TEST_TRUE(runner, freqs_ok, "freqs decoded from blocks (%s)", label);
+    TEST_TRUE(runner, prox_ok, "positions follow blocks (%s)", label);
+    TEST_INT_EQ(runner, PList_Next(plist), 0, "exhausted (%s)", label);
+    DECREF(plist);
+
+    // Positions are decoded on demand, so ask for only some of them.
+    plist = S_posting_list(reader, "common");
+    bool sparse_prox_ok = true;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        PList_Next(plist);
+        if (n % 7 != 0) { continue; }
+        ScorePosting *posting = (ScorePosting*)PList_Get_Posting(plist);
+        uint32_t *prox = ScorePost_Get_Prox(posting);
+        bool ok = (n % 3) == 0 ? prox[0] == 0
+                : (n % 3) == 1 ? prox[0] == 0 && prox[1] == 2
+                :                prox[0] == 0 && prox[1] == 1 && prox[2] == 2;
+        if (!ok) { sparse_prox_ok = false; }
+    }
+    TEST_TRUE(runner, sparse_prox_ok,
+              "positions skipped for docs which don't ask (%s)", label);
+    DECREF(plist);
+
+    plist = S_posting_list(reader, "even");
+    TEST_INT_EQ(runner, PList_Advance(plist, 7), 8,
+                "Advance within first block (%s)", label);
+    TEST_INT_EQ(runner, PList_Advance(plist, 51), 52,
+                "Advance across blocks (%s)", label);
+    TEST_INT_EQ(runner,
+                ScorePost_Get_Prox((ScorePosting*)PList_Get_Posting(plist))[0],
+                3, "positions after Advance (%s)", label);
+    TEST_INT_EQ(runner, PList_Next(plist), 54,
+                "Next after Advance (%s)", label);
+    TEST_INT_EQ(runner, PList_Advance(plist, NUM_DOCS), NUM_DOCS,
+                "Advance to last doc (%s)", label);
+    TEST_INT_EQ(runner, PList_Advance(plist, NUM_DOCS + 1), 0,
+                "Advance past end (%s)", label);
+    DECREF(plist);
+
+    DECREF(reader);
+}
+
+static void
+test_block_posting(TestBatchRunner *runner) {
+    TestSchema *schema = TestSchema_new(false);
+    StandardTokenizer *tokenizer = StandardTokenizer_new();
+    BlockTextType *type = BlockTextType_new((Analyzer*)tokenizer);
+    RAMFolder *folder = RAMFolder_new(NULL);
+    Schema_Spec_Field((Schema*)schema, SSTR_WRAP_C("block"),
+                      (FieldType*)type);
+
+    {
+        Indexer *indexer = Indexer_new((Schema*)schema, (Obj*)folder, NULL, 0);
+        S_add_docs(indexer, 1, 50);
+        Indexer_Commit(indexer);
+        DECREF(indexer);
+    }
+    {
+        Indexer *indexer = Indexer_new((Schema*)schema, (Obj*)folder, NULL, 0);
+        S_add_docs(indexer, 51, NUM_DOCS);
+        Indexer_Optimize(indexer);
+        Indexer_Commit(indexer);
+        DECREF(indexer);
+    }
+    S_test_index(runner, folder, "merged");
+
+    DECREF(folder);
+    DECREF(type);
+    DECREF(tokenizer);
+    DECREF(schema);
+}
+
+void
+TestBlockPost_Run_IMP(TestBlockPosting *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 13);
+    test_block_posting(runner);
+}
+
+
@@ -0,0 +1,229 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Index/TestDeletionsWriter.h"
+#include "Lucy/Test/Index/TestSortWriter.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/DeletionsReader.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/Matcher.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_DOCS 1000
+
+TestDeletionsWriter*
+TestDelWriter_new() {
+    return (TestDeletionsWriter*)Class_Make_Obj(TESTDELETIONSWRITER);
+}
+
+static Schema*
+S_create_schema() {
+    Schema *schema = Schema_new();
+    StringType *type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("id"), (FieldType*)type);
+    DECREF(type);
+    return schema;
+}
+
+// Doc n gets the id "n", so that the single segment's doc ids match.
+static void
+S_add_docs(Schema *schema, Folder *folder) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        Doc    *doc = Doc_new(NULL, 0);
+        String *id  = Str_newf("%i32", n);
+        Doc_Store(doc, SSTR_WRAP_C("id"), (Obj*)id);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(id);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+// Delete docs `first` through `last` in a commit of their own, leaving
+// every segment in place.
+static void
+S_delete_docs(Schema *schema, Folder *folder, bool *deleted, int32_t first,
+              int32_t last) {
+    NonMergingIndexManager *manager = NMIxManager_new();
+    Indexer *indexer
+        = Indexer_new(schema, (Obj*)folder, (IndexManager*)manager, 0);
+    for (int32_t n = first; n <= last; n++) {
+        String *id = Str_newf("%i32", n);
+        Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("id"), (Obj*)id);
+        deleted[n] = true;
+        DECREF(id);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    DECREF(manager);
+}
+
+// Return the metadata for the deletions file which the first segment's
+// deletions are read from.
+static Hash*
+S_del_meta(Folder *folder) {
+    PolyReader *reader = PolyReader_open((Obj*)folder, NULL, NULL);
+    Hash *meta = DefDelReader_find_deletions(PolyReader_Get_Segments(reader),
+                                             SSTR_WRAP_C("seg_1"));
+    if (meta) { INCREF(meta); }
+    DECREF(reader);
+    return meta;
+}
+
+static size_t
+S_num_layers(Hash *meta) {
+    Vector *layers = (Vector*)Hash_Fetch_Utf8(meta, "layers", 6);
+    return layers ? Vec_Get_Size(layers) : 0;
+}
+
+static bool
+S_is_type(Obj *meta, const char *type) {
+    String *value = (String*)Hash_Fetch_Utf8((Hash*)meta, "type", 4);
+    return value && Str_Equals_Utf8(value, type, strlen(type));
+}
+
+static void
+S_check_reader(TestBatchRunner *runner, Folder *folder, bool *deleted,
+               const char *message) {
+    PolyReader *reader = PolyReader_open((Obj*)folder, NULL, NULL);
+    DeletionsReader *del_reader
+        = (DeletionsReader*)PolyReader_Obtain(
+              reader, Class_Get_Name(DELETIONSREADER));
+    Matcher *iter = DelReader_Iterator(del_reader);
+    int32_t  num_deleted = 0;
+    int32_t  num_seen    = 0;
+    bool     ok          = true;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        if (deleted[n]) { num_deleted++; }
+    }
+    int32_t doc_id;
+    while (iter && 0 != (doc_id = Matcher_Next(iter))) {
+        if (doc_id > NUM_DOCS || !deleted[doc_id]) { ok = false; }
+        num_seen++;
+    }
+    TEST_TRUE(runner,
+              ok
+              && num_seen == num_deleted
+              && DelReader_Del_Count(del_reader) == num_deleted
+              && PolyReader_Doc_Count(reader) == NUM_DOCS - num_deleted,
+              "%s", message);
+    DECREF(iter);
+    DECREF(reader);
+}
+
+static void
+test_layers(TestBatchRunner *runner) {
+    Schema *schema  = S_create_schema();
+    Folder *folder  = (Folder*)RAMFolder_new(NULL);
+    bool   *deleted = (bool*)CALLOCATE(NUM_DOCS + 1, sizeof(bool));
+    Hash   *meta;
+
+    S_add_docs(schema, folder);
+
+    S_delete_docs(schema, folder, deleted, 10, 10);
+    meta = S_del_meta(folder);
+    TEST_TRUE(runner,
+              meta && S_is_type((Obj*)meta, "sparse")
+              && S_num_layers(meta) == 0,
+              "A few deletions are stored as doc ids");
+    DECREF(meta);
+    S_check_reader(runner, folder, deleted, "Sparse deletions read back");
+
+    S_delete_docs(schema, folder, deleted, 20, 20);
+    meta = S_del_meta(folder);
+    TEST_TRUE(runner,
+              meta && S_is_type((Obj*)meta, "sparse")
+              && S_num_layers(meta) == 1,
+              "Another deletion adds a layer");
+    DECREF(meta);
+    S_check_reader(runner, folder, deleted, "Layered deletions read back");
+
+    S_delete_docs(schema, folder, deleted, 30, 31);
+    meta = S_del_meta(folder);
+    TEST_TRUE(runner, meta && S_num_layers(meta) == 2,
+              "Layers stack up");
+    DECREF(meta);
+
+    S_delete_docs(schema, folder, deleted, 100, 399);
+    meta = S_del_meta(folder);
+    TEST_TRUE(runner,
+              meta && S_is_type((Obj*)meta, "bitmap")
+              && S_num_layers(meta) == 0,
+              "Many deletions are folded into one bitmap");
+    DECREF(meta);
+    S_check_reader(runner, folder, deleted, "Bitmap deletions read back");
+
+    S_delete_docs(schema, folder, deleted, 500, 500);
+    meta = S_del_meta(folder);
+    Vector *layers = meta ? (Vector*)Hash_Fetch_Utf8(meta, "layers", 6) : NULL;
+    TEST_TRUE(runner,
+              layers && Vec_Get_Size(layers) == 1
+              && S_is_type(Vec_Fetch(layers, 0), "bitmap")
+              && S_is_type((Obj*)meta, "sparse"),
+              "Doc ids layered over a bitmap");
+    DECREF(meta);
+    S_check_reader(runner, folder, deleted,
+                   "Doc ids layered over a bitmap read back");
+
+    size_t max_layers = 0;
+    for (int32_t n = 600; n < 620; n++) {
+        S_delete_docs(schema, folder, deleted, n, n);
+        meta = S_del_meta(folder);
+        size_t num_layers = meta ? S_num_layers(meta) : 0;
+        if (num_layers > max_layers) { max_layers = num_layers; }
+        DECREF(meta);
+    }
+    TEST_TRUE(runner, max_layers > 1 && max_layers < 8,
+              "Stacks of layers are kept short");
+    S_check_reader(runner, folder, deleted, "Deep stacks read back");
+
+    // Consolidating everything purges the deleted docs.
+    int32_t num_deleted = 0;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        if (deleted[n]) { num_deleted++; }
+    }
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    Indexer_Optimize(indexer);
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    PolyReader *reader = PolyReader_open((Obj*)folder, NULL, NULL);
+    TEST_TRUE(runner,
+              PolyReader_Doc_Count(reader) == NUM_DOCS - num_deleted
+              && PolyReader_Del_Count(reader) == 0,
+              "Optimize applies layered deletions");
+    DECREF(reader);
+
+    FREEMEM(deleted);
+    DECREF(folder);
+    DECREF(schema);
+}
+
+void
+TestDelWriter_Run_IMP(TestDeletionsWriter *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 12);
+    test_layers(runner);
+}
+
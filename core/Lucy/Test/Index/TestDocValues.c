@@ -0,0 +1,221 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/Num.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Index/TestDocValues.h"
+#include "Lucy/Analysis/StandardTokenizer.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/DocValuesReader.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Plan/FullTextType.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Store/RAMFolder.h"
+#include "Lucy/Util/Freezer.h"
+
+TestDocValues*
+TestDocValues_new() {
+    return (TestDocValues*)Class_Make_Obj(TESTDOCVALUES);
+}
+
+static Schema*
+S_create_schema() {
+    Schema *schema = Schema_new();
+
+    StringType *title_type = StringType_new();
+    StringType_Set_Columnar(title_type, true);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("title"), (FieldType*)title_type);
+
+    Int32Type *price_type = Int32Type_new();
+    Int32Type_Set_Stored(price_type, false);
+    Int32Type_Set_Columnar(price_type, true);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("price"), (FieldType*)price_type);
+
+    Float64Type *weight_type = Float64Type_new();
+    Float64Type_Set_Columnar(weight_type, true);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("weight"),
+                      (FieldType*)weight_type);
+
+    StandardTokenizer *tokenizer = StandardTokenizer_new();
+    FullTextType *body_type = FullTextType_new((Analyzer*)tokenizer);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("body"), (FieldType*)body_type);
+
+    DECREF(body_type);
+    DECREF(tokenizer);
+    DECREF(weight_type);
+    DECREF(price_type);
+    DECREF(title_type);
+    return schema;
+}
+
+// Add docs `first` through `last`.  Every third doc has no price.
+static void
+S_add_docs(Schema *schema, RAMFolder *folder, int32_t first, int32_t last) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = first; n <= last; n++) {
+        Doc     *doc    = Doc_new(NULL, 0);
+        String  *title  = Str_newf("doc %i32", n);
+        Integer *price  = Int_new(n * 10);
+        Float   *weight = Float_new(n / 2.0);
+        String  *body   = Str_newf("text %i32", n);
+        Doc_Store(doc, SSTR_WRAP_C("title"), (Obj*)title);
+        if (n % 3 != 0) {
+            Doc_Store(doc, SSTR_WRAP_C("price"), (Obj*)price);
+        }
+        Doc_Store(doc, SSTR_WRAP_C("weight"), (Obj*)weight);
+        Doc_Store(doc, SSTR_WRAP_C("body"), (Obj*)body);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(body);
+        DECREF(weight);
+        DECREF(price);
+        DECREF(title);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static Vector*
+S_field_list(const char *a, const char *b) {
+    Vector *fields = Vec_new(2);
+    Vec_Push(fields, (Obj*)Str_newf("%s", a));
+    if (b) { Vec_Push(fields, (Obj*)Str_newf("%s", b)); }
+    return fields;
+}
+
+static bool
+S_title_is(Hash *values, int32_t n) {
+    String *title = (String*)Hash_Fetch_Utf8(values, "title", 5);
+    String *want  = Str_newf("doc %i32", n);
+    bool    equal = title && Str_Equals(title, (Obj*)want);
+    DECREF(want);
+    return equal;
+}
+
+static int64_t
+S_price(Hash *values) {
+    Integer *price = (Integer*)Hash_Fetch_Utf8(values, "price", 5);
+    return price ? Int_Get_Value(price) : -1;
+}
+
+static void
+test_Dump_Load(TestBatchRunner *runner) {
+    StringType *type = StringType_new();
+    TEST_FALSE(runner, StringType_Columnar(type),
+               "Fields aren't columnar by default");
+    StringType_Set_Columnar(type, true);
+    Obj        *dump   = (Obj*)StringType_Dump(type);
+    StringType *loaded = (StringType*)Freezer_load(dump);
+    TEST_TRUE(runner, StringType_Columnar(loaded)
+                      && StringType_Equals(type, (Obj*)loaded),
+              "Dump/Load preserves columnar");
+    StringType_Set_Columnar(loaded, false);
+    TEST_FALSE(runner, StringType_Equals(type, (Obj*)loaded),
+               "Equals compares columnar");
+    DECREF(loaded);
+    DECREF(dump);
+    DECREF(type);
+}
+
+static void
+test_fetch(TestBatchRunner *runner) {
+    Schema    *schema = S_create_schema();
+    RAMFolder *folder = RAMFolder_new(NULL);
+    S_add_docs(schema, folder, 1, 20);
+    S_add_docs(schema, folder, 21, 30);
+
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    Vector *fields = S_field_list("title", "price");
+    Hash   *values = IxSearcher_Fetch_Fields(searcher, 2, fields);
+    TEST_TRUE(runner, S_title_is(values, 2) && S_price(values) == 20,
+              "Fetch_Fields");
+    TEST_INT_EQ(runner, Hash_Get_Size(values), 2,
+                "Fetch_Fields returns only the fields asked for");
+    DECREF(values);
+
+    values = IxSearcher_Fetch_Fields(searcher, 3, fields);
+    TEST_TRUE(runner, S_title_is(values, 3)
+                      && !Hash_Fetch_Utf8(values, "price", 5),
+              "Docs without a value are left out");
+    DECREF(values);
+
+    values = IxSearcher_Fetch_Fields(searcher, 25, fields);
+    TEST_TRUE(runner, S_title_is(values, 25) && S_price(values) == 250,
+              "Fetch_Fields from second segment");
+    DECREF(values);
+    DECREF(fields);
+
+    fields = S_field_list("weight", "body");
+    values = IxSearcher_Fetch_Fields(searcher, 7, fields);
+    Float  *weight = (Float*)Hash_Fetch_Utf8(values, "weight", 6);
+    String *body   = (String*)Hash_Fetch_Utf8(values, "body", 4);
+    TEST_TRUE(runner, weight && Float_Get_Value(weight) == 3.5,
+              "Fixed-width float column");
+    TEST_TRUE(runner, body && Str_Equals_Utf8(body, "text 7", 6),
+              "Non-columnar fields fall back to the stored doc");
+    DECREF(values);
+    DECREF(fields);
+
+    IndexReader *reader = IxSearcher_Get_Reader(searcher);
+    DocValuesReader *dv_reader = (DocValuesReader*)IxReader_Fetch(
+                                     reader, Class_Get_Name(DOCVALUESREADER));
+    Obj *value = DVReader_Fetch_Value(dv_reader, SSTR_WRAP_C("body"), 7);
+    TEST_TRUE(runner, value == NULL,
+              "DocValuesReader has no column for non-columnar field");
+    DECREF(value);
+    DECREF(searcher);
+
+    // Delete a doc and merge everything into one segment.
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("title"),
+                           (Obj*)SSTR_WRAP_C("doc 5"));
+    Indexer_Optimize(indexer);
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+
+    searcher = IxSearcher_new((Obj*)folder);
+    fields = S_field_list("title", "price");
+    values = IxSearcher_Fetch_Fields(searcher, 5, fields);
+    TEST_TRUE(runner, S_title_is(values, 6)
+                      && !Hash_Fetch_Utf8(values, "price", 5),
+              "Merged column skips deleted doc");
+    DECREF(values);
+    values = IxSearcher_Fetch_Fields(searcher, 28, fields);
+    TEST_TRUE(runner, S_title_is(values, 29) && S_price(values) == 290,
+              "Merged column spans former segments");
+    DECREF(values);
+    DECREF(fields);
+    DECREF(searcher);
+
+    DECREF(folder);
+    DECREF(schema);
+}
+
+void
+TestDocValues_Run_IMP(TestDocValues *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 12);
+    test_Dump_Load(runner);
+    test_fetch(runner);
+}
+
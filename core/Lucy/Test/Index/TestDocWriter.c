@@ -15,23 +15,156 @@
  */
 
 #define C_TESTLUCY_TESTDOCWRITER
+#define C_LUCY_DEFAULTDOCREADER
 #define TESTLUCY_USE_SHORT_NAMES
 #include "Lucy/Util/ToolSet.h"
 
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Lucy/Test.h"
 #include "Lucy/Test/Index/TestDocWriter.h"
+#include "Lucy/Analysis/StandardTokenizer.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Document/HitDoc.h"
+#include "Lucy/Index/DocReader.h"
 #include "Lucy/Index/DocWriter.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Plan/FullTextType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/RAMFolder.h"
 
 TestDocWriter*
 TestDocWriter_new() {
     return (TestDocWriter*)Class_Make_Obj(TESTDOCWRITER);
 }
 
-void
-TestDocWriter_Run_IMP(TestDocWriter *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 1);
-    PASS(runner, "placeholder");
+static Schema*
+S_create_schema() {
+    Schema *schema = Schema_new();
+    StringType *id_type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("id"), (FieldType*)id_type);
+    StandardTokenizer *tokenizer = StandardTokenizer_new();
+    FullTextType *body_type = FullTextType_new((Analyzer*)tokenizer);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("body"), (FieldType*)body_type);
+    DECREF(body_type);
+    DECREF(tokenizer);
+    DECREF(id_type);
+    return schema;
+}
+
+static String*
+S_body(int32_t n) {
+    return Str_newf("Document number %i32 has a body which is long enough "
+                    "to fill several blocks once enough of them pile up.  "
+                    "%i32 %i32 %i32", n, n * 7, n * 13, n * 31);
+}
+
+static void
+S_add_docs(Schema *schema, RAMFolder *folder, int32_t first, int32_t last) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = first; n <= last; n++) {
+        Doc    *doc  = Doc_new(NULL, 0);
+        String *id   = Str_newf("%i32", n);
+        String *body = S_body(n);
+        Doc_Store(doc, SSTR_WRAP_C("id"), (Obj*)id);
+        Doc_Store(doc, SSTR_WRAP_C("body"), (Obj*)body);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(body);
+        DECREF(id);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+// Verify that doc `doc_id` holds the fields for doc number `n`.
+static bool
+S_doc_is(IndexSearcher *searcher, int32_t doc_id, int32_t n) {
+    HitDoc *doc  = IxSearcher_Fetch_Doc(searcher, doc_id);
+    Obj    *id   = HitDoc_Extract(doc, SSTR_WRAP_C("id"));
+    Obj    *body = HitDoc_Extract(doc, SSTR_WRAP_C("body"));
+    String *want_id   = Str_newf("%i32", n);
+    String *want_body = S_body(n);
+    bool equal = id && body
+                 && Str_Equals(want_id, id)
+                 && Str_Equals(want_body, body);
+    DECREF(want_body);
+    DECREF(want_id);
+    DECREF(body);
+    DECREF(id);
+    DECREF(doc);
+    return equal;
+}
+
+static DefaultDocReader*
+S_first_doc_reader(IndexSearcher *searcher) {
+    IndexReader *reader = IxSearcher_Get_Reader(searcher);
+    Vector *seg_readers = IxReader_Seg_Readers(reader);
+    SegReader *seg_reader = (SegReader*)Vec_Fetch(seg_readers, 0);
+    DefaultDocReader *doc_reader = (DefaultDocReader*)SegReader_Fetch(
+        seg_reader, Class_Get_Name(DOCREADER));
+    DECREF(seg_readers);
+    return doc_reader;
 }
 
+static void
+test_blocks(TestBatchRunner *runner) {
+    Schema    *schema = S_create_schema();
+    RAMFolder *folder = RAMFolder_new(NULL);
+    S_add_docs(schema, folder, 1, 1000);
 
+    IndexSearcher    *searcher   = IxSearcher_new((Obj*)folder);
+    DefaultDocReader *doc_reader = S_first_doc_reader(searcher);
+    DefaultDocReaderIVARS *const ivars = DefDocReader_IVARS(doc_reader);
+    TEST_TRUE(runner, ivars->num_blocks > 2, "docs span several blocks");
+    TEST_TRUE(runner, InStream_Length(ivars->dat_in) * 2
+                      < (int64_t)DOCWRITER_BLOCK_SIZE
+                        * (ivars->num_blocks - 1),
+              "documents.dat is compressed");
+
+    bool ok = true;
+    for (int32_t n = 1; n <= 1000; n += 37) {
+        if (!S_doc_is(searcher, n, n)) { ok = false; }
+    }
+    TEST_TRUE(runner, ok, "Fetch_Doc across blocks");
+    TEST_TRUE(runner, S_doc_is(searcher, 1000, 1000)
+                      && S_doc_is(searcher, 1, 1),
+              "first and last docs");
+
+    // Fetching neighbours shouldn't decompress the block again.
+    InStream *block = DefDocReader_Doc_Stream(doc_reader, 500);
+    TEST_TRUE(runner, S_doc_is(searcher, 501, 501)
+                      && S_doc_is(searcher, 499, 499)
+                      && DefDocReader_Doc_Stream(doc_reader, 500) == block,
+              "nearby docs share a cached block");
+    DECREF(searcher);
+
+    // Merge with a second segment, dropping a doc.
+    S_add_docs(schema, folder, 1001, 1100);
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("id"),
+                           (Obj*)SSTR_WRAP_C("10"));
+    Indexer_Optimize(indexer);
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+
+    searcher = IxSearcher_new((Obj*)folder);
+    TEST_TRUE(runner, S_doc_is(searcher, 9, 9) && S_doc_is(searcher, 10, 11),
+              "merged doc store skips deleted doc");
+    TEST_TRUE(runner, S_doc_is(searcher, 1099, 1100),
+              "merged doc store spans former segments");
+    DECREF(searcher);
+
+    DECREF(folder);
+    DECREF(schema);
+}
+
+void
+TestDocWriter_Run_IMP(TestDocWriter *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 7);
+    test_blocks(runner);
+}
@@ -0,0 +1,410 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/Num.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/TestUtils.h"
+#include "Lucy/Test/Index/TestIndexSort.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Document/HitDoc.h"
+#include "Lucy/Index/BackgroundMerger.h"
+#include "Lucy/Index/DocReader.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/IndexManager.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/PostingList.h"
+#include "Lucy/Index/PostingListReader.h"
+#include "Lucy/Index/PostingListWriter.h"
+#include "Lucy/Index/Segment.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Index/SortCache.h"
+#include "Lucy/Index/SortReader.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/Hits.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/MatchDoc.h"
+#include "Lucy/Search/SortRule.h"
+#include "Lucy/Search/SortSpec.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Search/TopDocs.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_DOCS   200
+#define NUM_RANKS  101
+#define NUM_WANTED 10
+
+TestIndexSort*
+TestIndexSort_new() {
+    return (TestIndexSort*)Class_Make_Obj(TESTINDEXSORT);
+}
+
+static Schema*
+S_create_schema() {
+    Schema *schema = Schema_new();
+    Int32Type *rank_type = Int32Type_new();
+    Int32Type_Set_Sortable(rank_type, true);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("rank"), (FieldType*)rank_type);
+    StringType *flag_type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("flag"), (FieldType*)flag_type);
+    DECREF(flag_type);
+    DECREF(rank_type);
+    return schema;
+}
+
+static SortSpec*
+S_make_sort_spec(const char *field, bool reverse) {
+    Vector *rules = Vec_new(2);
+    Vec_Push(rules, (Obj*)SortRule_new(SortRule_FIELD, SSTR_WRAP_C(field),
+                                       reverse));
+    Vec_Push(rules, (Obj*)SortRule_new(SortRule_DOC_ID, NULL, false));
+    SortSpec *sort_spec = SortSpec_new(rules);
+    DECREF(rules);
+    return sort_spec;
+}
+
+static IndexManager*
+S_make_manager(SortSpec *index_sort) {
+    IndexManager *manager = IxManager_new(NULL, NULL);
+    IxManager_Set_Index_Sort(manager, index_sort);
+    return manager;
+}
+
+// Ranks arrive shuffled, and every rank but the last is shared by two docs,
+// so ties have to keep their order.
+static void
+S_add_docs(RAMFolder *folder, Schema *schema, IndexManager *manager,
+           int32_t first, int32_t last) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, manager, 0);
+    for (int32_t n = first; n <= last; n++) {
+        Doc *doc = Doc_new(NULL, 0);
+        Integer *rank = Int_new((n * 37) % NUM_RANKS);
+        String  *flag = Str_newf("%s", n % 3 ? "yes" : "no");
+        Doc_Store(doc, SSTR_WRAP_C("rank"), (Obj*)rank);
+        Doc_Store(doc, SSTR_WRAP_C("flag"), (Obj*)flag);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(flag);
+        DECREF(rank);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static void
+S_optimize(RAMFolder *folder, IndexManager *manager) {
+    Indexer *indexer = Indexer_new(NULL, (Obj*)folder, manager, 0);
+    Indexer_Optimize(indexer);
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static int64_t
+S_fetch_rank(DocReader *doc_reader, int32_t doc_id) {
+    HitDoc  *doc   = DocReader_Fetch_Doc(doc_reader, doc_id);
+    Integer *value = (Integer*)HitDoc_Extract(doc, SSTR_WRAP_C("rank"));
+    int64_t  rank  = value ? Int_Get_Value(value) : -1;
+    DECREF(value);
+    DECREF(doc);
+    return rank;
+}
+
+// Check that every segment numbers its docs by ascending rank, that the
+// sort cache agrees with the stored docs, and that the segment says it's
+// sorted.
+static void
+test_doc_order(TestBatchRunner *runner, RAMFolder *folder,
+               const char *label) {
+    PolyReader *reader      = PolyReader_open((Obj*)folder, NULL, NULL);
+    Vector     *seg_readers = PolyReader_Get_Seg_Readers(reader);
+    bool        in_order    = true;
+    bool        cache_ok    = true;
+    bool        recorded    = true;
+
+    for (size_t i = 0, max = Vec_Get_Size(seg_readers); i < max; i++) {
+        SegReader  *seg_reader = (SegReader*)Vec_Fetch(seg_readers, i);
+        Segment    *segment    = SegReader_Get_Segment(seg_reader);
+        DocReader  *doc_reader = (DocReader*)SegReader_Obtain(
+                                     seg_reader, Class_Get_Name(DOCREADER));
+        SortReader *sort_reader = (SortReader*)SegReader_Obtain(
+                                      seg_reader, Class_Get_Name(SORTREADER));
+        SortCache  *sort_cache = SortReader_Fetch_Sort_Cache(
+                                     sort_reader, SSTR_WRAP_C("rank"));
+        int32_t     doc_max    = SegReader_Doc_Max(seg_reader);
+        int64_t     last_rank  = -1;
+        int32_t     last_ord   = -1;
+
+        if (!Seg_Fetch_Metadata_Utf8(segment, "index_sort", 10)) {
+            recorded = false;
+        }
+        for (int32_t doc_id = 1; doc_id <= doc_max; doc_id++) {
+            int64_t  rank  = S_fetch_rank(doc_reader, doc_id);
+            int32_t  ord   = SortCache_Ordinal(sort_cache, doc_id);
+            Integer *value = (Integer*)SortCache_Value(sort_cache, ord);
+            if (rank < last_rank) { in_order = false; }
+            if (ord < last_ord || !value || Int_Get_Value(value) != rank) {
+                cache_ok = false;
+            }
+            last_rank = rank;
+            last_ord  = ord;
+            DECREF(value);
+        }
+    }
+
+    TEST_TRUE(runner, in_order, "%s: doc ids follow the index sort", label);
+    TEST_TRUE(runner, cache_ok, "%s: sort cache matches the stored docs",
+              label);
+    TEST_TRUE(runner, recorded, "%s: segment metadata records the sort",
+              label);
+
+    // Nothing should be left over from moving the unsorted files aside.
+    Vector *entries  = RAMFolder_List_R(folder, NULL);
+    bool    no_stage = true;
+    for (size_t i = 0, max = Vec_Get_Size(entries); i < max; i++) {
+        String *entry = (String*)Vec_Fetch(entries, i);
+        if (Str_Contains_Utf8(entry, "unsorted", 8)) { no_stage = false; }
+    }
+    TEST_TRUE(runner, no_stage, "%s: staging directory removed", label);
+    DECREF(entries);
+    DECREF(reader);
+}
+
+static Vector*
+S_top_ranks(IndexSearcher *searcher, TopDocs *top_docs) {
+    Vector *match_docs = TopDocs_Get_Match_Docs(top_docs);
+    Vector *ranks      = Vec_new(Vec_Get_Size(match_docs));
+    for (size_t i = 0, max = Vec_Get_Size(match_docs); i < max; i++) {
+        MatchDoc *match_doc = (MatchDoc*)Vec_Fetch(match_docs, i);
+        HitDoc   *doc = IxSearcher_Fetch_Doc(searcher,
+                                             MatchDoc_Get_Doc_ID(match_doc));
+        Vec_Push(ranks, HitDoc_Extract(doc, SSTR_WRAP_C("rank")));
+        DECREF(doc);
+    }
+    return ranks;
+}
+
+// Sorted searches against the sorted index must find the same ranks as
+// against the unsorted one.  Only a search sorted the same way as the index
+// may stop early.
+static void
+test_sorted_search(TestBatchRunner *runner, IndexSearcher *plain,
+                   IndexSearcher *sorted, uint32_t num_matches,
+                   const char *label) {
+    Query    *query      = (Query*)TestUtils_make_term_query("flag", "yes");
+    SortSpec *ascending  = S_make_sort_spec("rank", false);
+    SortSpec *descending = S_make_sort_spec("rank", true);
+
+    TopDocs *expected = IxSearcher_Top_Docs(plain, query, NUM_WANTED,
+                                            ascending);
+    IxSearcher_Set_Total_Hits_Threshold(sorted, NUM_WANTED);
+    TopDocs *pruned = IxSearcher_Top_Docs(sorted, query, NUM_WANTED,
+                                          ascending);
+    Vector *expected_ranks = S_top_ranks(plain, expected);
+    Vector *pruned_ranks   = S_top_ranks(sorted, pruned);
+    TEST_TRUE(runner, Vec_Get_Size(expected_ranks) == NUM_WANTED
+              && Vec_Equals(expected_ranks, (Obj*)pruned_ranks),
+              "%s: early termination keeps the top docs", label);
+    uint32_t pruned_hits = TopDocs_Get_Total_Hits(pruned);
+    TEST_TRUE(runner, pruned_hits >= NUM_WANTED && pruned_hits < num_matches,
+              "%s: stopped early (%u32 of %u32 visited)", label,
+              pruned_hits, num_matches);
+    DECREF(pruned_ranks);
+    DECREF(expected_ranks);
+    DECREF(pruned);
+    DECREF(expected);
+
+    expected = IxSearcher_Top_Docs(plain, query, NUM_WANTED, descending);
+    TopDocs *reversed = IxSearcher_Top_Docs(sorted, query, NUM_WANTED,
+                                            descending);
+    IxSearcher_Set_Total_Hits_Threshold(sorted, UINT32_MAX);
+    expected_ranks = S_top_ranks(plain, expected);
+    Vector *reversed_ranks = S_top_ranks(sorted, reversed);
+    TEST_TRUE(runner, Vec_Equals(expected_ranks, (Obj*)reversed_ranks),
+              "%s: reverse sort finds the same top docs", label);
+    TEST_INT_EQ(runner, TopDocs_Get_Total_Hits(reversed), num_matches,
+                "%s: reverse sort visits every match", label);
+    DECREF(reversed_ranks);
+    DECREF(expected_ranks);
+    DECREF(reversed);
+    DECREF(expected);
+
+    DECREF(descending);
+    DECREF(ascending);
+    DECREF(query);
+}
+
+// With a tiny memory threshold, the postings of each term get spilled in
+// many pieces while a segment is sorted.  They still have to come back
+// complete and in doc id order.
+static void
+test_spilled_postings(TestBatchRunner *runner, Schema *schema,
+                      IndexManager *manager, uint32_t num_matches) {
+    RAMFolder *folder = RAMFolder_new(NULL);
+    PListWriter_set_default_mem_thresh(0x100);
+    S_add_docs(folder, schema, manager, 1, NUM_DOCS);
+    PListWriter_set_default_mem_thresh(0x1000000);
+
+    PolyReader *reader     = PolyReader_open((Obj*)folder, NULL, NULL);
+    SegReader  *seg_reader
+        = (SegReader*)Vec_Fetch(PolyReader_Get_Seg_Readers(reader), 0);
+    PostingListReader *plist_reader
+        = (PostingListReader*)SegReader_Obtain(
+              seg_reader, Class_Get_Name(POSTINGLISTREADER));
+    PostingList *plist
+        = PListReader_Posting_List(plist_reader, SSTR_WRAP_C("flag"),
+                                   (Obj*)SSTR_WRAP_C("yes"));
+    uint32_t count    = 0;
+    int32_t  last     = 0;
+    bool     in_order = true;
+    int32_t  doc_id;
+    while (0 != (doc_id = PList_Next(plist))) {
+        if (doc_id <= last) { in_order = false; }
+        last = doc_id;
+        count++;
+    }
+    TEST_TRUE(runner, in_order && count == num_matches,
+              "Postings spilled while sorting come back whole and in order");
+
+    DECREF(plist);
+    DECREF(reader);
+    DECREF(folder);
+}
+
+static uint32_t
+S_count_hits(IndexSearcher *searcher, const char *flag) {
+    Query    *query = (Query*)TestUtils_make_term_query("flag", flag);
+    Hits     *hits  = IxSearcher_Hits(searcher, (Obj*)query, 0, 1, NULL);
+    uint32_t  count = Hits_Total_Hits(hits);
+    DECREF(hits);
+    DECREF(query);
+    return count;
+}
+
+// Deletions made while a BackgroundMerger runs have to land on the same
+// docs in the segment it writes, even though sorting that segment moves
+// them around.
+static void
+test_background_merge(TestBatchRunner *runner, Schema *schema,
+                      IndexManager *manager, uint32_t num_matches) {
+    RAMFolder *folder = RAMFolder_new(NULL);
+    S_add_docs(folder, schema, manager, 1, NUM_DOCS / 2);
+    S_add_docs(folder, schema, manager, NUM_DOCS / 2 + 1, NUM_DOCS);
+
+    BackgroundMerger *bg_merger = BGMerger_new((Obj*)folder, manager);
+    BGMerger_Optimize(bg_merger);
+    Indexer *indexer = Indexer_new(NULL, (Obj*)folder, manager, 0);
+    Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("flag"),
+                           (Obj*)SSTR_WRAP_C("no"));
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    BGMerger_Commit(bg_merger);
+    DECREF(bg_merger);
+
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    TEST_INT_EQ(runner, S_count_hits(searcher, "no"), 0,
+                "Deletions during a background merge hit the right docs");
+    TEST_INT_EQ(runner, S_count_hits(searcher, "yes"), num_matches,
+                "Deletions during a background merge spare the others");
+    DECREF(searcher);
+    DECREF(folder);
+}
+
+static void
+S_open_with_bad_sort(void *context) {
+    SortSpec     *sort_spec = (SortSpec*)context;
+    Schema       *schema    = S_create_schema();
+    RAMFolder    *folder    = RAMFolder_new(NULL);
+    IndexManager *manager   = S_make_manager(sort_spec);
+    Indexer      *indexer   = Indexer_new(schema, (Obj*)folder, manager, 0);
+    DECREF(indexer);
+    DECREF(manager);
+    DECREF(folder);
+    DECREF(schema);
+}
+
+static void
+test_bad_sort(TestBatchRunner *runner) {
+#ifdef LUCY_VALGRIND
+    SKIP(runner, 2, "known leaks");
+#else
+    Vector *rules = Vec_new(1);
+    Vec_Push(rules, (Obj*)SortRule_new(SortRule_SCORE, NULL, false));
+    SortSpec *by_score = SortSpec_new(rules);
+    Err *error = Err_trap(S_open_with_bad_sort, by_score);
+    TEST_TRUE(runner, error != NULL, "Sorting an index by score throws");
+    DECREF(error);
+    DECREF(by_score);
+    DECREF(rules);
+
+    SortSpec *by_flag = S_make_sort_spec("flag", false);
+    error = Err_trap(S_open_with_bad_sort, by_flag);
+    TEST_TRUE(runner, error != NULL
+              && Str_Contains_Utf8(Err_Get_Mess(error), "sortable", 8),
+              "Sorting an index by an unsortable field throws");
+    DECREF(error);
+    DECREF(by_flag);
+#endif
+}
+
+void
+TestIndexSort_Run_IMP(TestIndexSort *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 21);
+    Schema       *schema        = S_create_schema();
+    Vector       *rules         = Vec_new(1);
+    Vec_Push(rules, (Obj*)SortRule_new(SortRule_FIELD, SSTR_WRAP_C("rank"),
+                                       false));
+    SortSpec     *index_sort    = SortSpec_new(rules);
+    IndexManager *manager       = S_make_manager(index_sort);
+    RAMFolder    *plain_folder  = RAMFolder_new(NULL);
+    RAMFolder    *sorted_folder = RAMFolder_new(NULL);
+    uint32_t      num_matches   = NUM_DOCS - NUM_DOCS / 3;
+
+    // Two sessions, so that the sorted index has two sorted segments.
+    S_add_docs(plain_folder, schema, NULL, 1, NUM_DOCS / 2);
+    S_add_docs(plain_folder, schema, NULL, NUM_DOCS / 2 + 1, NUM_DOCS);
+    S_add_docs(sorted_folder, schema, manager, 1, NUM_DOCS / 2);
+    S_add_docs(sorted_folder, schema, manager, NUM_DOCS / 2 + 1, NUM_DOCS);
+
+    IndexSearcher *plain  = IxSearcher_new((Obj*)plain_folder);
+    IndexSearcher *sorted = IxSearcher_new((Obj*)sorted_folder);
+    test_doc_order(runner, sorted_folder, "New segments");
+    test_sorted_search(runner, plain, sorted, num_matches, "New segments");
+    DECREF(sorted);
+
+    S_optimize(sorted_folder, manager);
+    sorted = IxSearcher_new((Obj*)sorted_folder);
+    test_doc_order(runner, sorted_folder, "Merged");
+    test_sorted_search(runner, plain, sorted, num_matches, "Merged");
+
+    test_spilled_postings(runner, schema, manager, num_matches);
+    test_background_merge(runner, schema, manager, num_matches);
+    test_bad_sort(runner);
+
+    DECREF(sorted);
+    DECREF(plain);
+    DECREF(sorted_folder);
+    DECREF(plain_folder);
+    DECREF(manager);
+    DECREF(index_sort);
+    DECREF(rules);
+    DECREF(schema);
+}
+
@@ -0,0 +1,142 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Index/TestIndexer.h"
+#include "Lucy/Test/TestSchema.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Search/Hits.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_THREADS 4
+#define NUM_DOCS    1100
+
+TestIndexer*
+TestIndexer_new() {
+    return (TestIndexer*)Class_Make_Obj(TESTINDEXER);
+}
+
+static void
+S_add_docs(Indexer *indexer, int32_t num_docs, const char *extra) {
+    String *field = SSTR_WRAP_C("content");
+    for (int32_t n = 1; n <= num_docs; n++) {
+        String *content
+            = Str_newf("%s %s %s x",
+                       n % 2 == 0 ? "alpha" : "",
+                       n % 3 == 0 ? "beta beta" : "",
+                       extra);
+        Doc *doc = Doc_new(NULL, 0);
+        Doc_Store(doc, field, (Obj*)content);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(doc);
+        DECREF(content);
+    }
+}
+
+static RAMFolder*
+S_create_index(Schema *schema, uint32_t num_threads) {
+    RAMFolder *folder  = RAMFolder_new(NULL);
+    Indexer   *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    Indexer_Set_Num_Threads(indexer, num_threads);
+    S_add_docs(indexer, NUM_DOCS, "");
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    return folder;
+}
+
+static uint32_t
+S_num_hits(RAMFolder *folder, const char *term) {
+    TermQuery *query = TermQuery_new(SSTR_WRAP_C("content"),
+                                     (Obj*)SSTR_WRAP_C(term));
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    Hits *hits = IxSearcher_Hits(searcher, (Obj*)query, 0, 10, NULL);
+    uint32_t num_hits = Hits_Total_Hits(hits);
+    DECREF(hits);
+    DECREF(searcher);
+    DECREF(query);
+    return num_hits;
+}
+
+static void
+test_Num_Threads(TestBatchRunner *runner, Schema *schema) {
+    RAMFolder *folder  = RAMFolder_new(NULL);
+    Indexer   *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    TEST_INT_EQ(runner, Indexer_Get_Num_Threads(indexer), 1,
+                "Indexing runs on one thread by default");
+    Indexer_Set_Num_Threads(indexer, NUM_THREADS);
+    TEST_INT_EQ(runner, Indexer_Get_Num_Threads(indexer), NUM_THREADS,
+                "Set_Num_Threads");
+    DECREF(indexer);
+    DECREF(folder);
+}
+
+static void
+test_threaded_indexing(TestBatchRunner *runner, Schema *schema) {
+    RAMFolder   *serial   = S_create_index(schema, 1);
+    RAMFolder   *threaded = S_create_index(schema, NUM_THREADS);
+    IndexReader *reader   = IxReader_open((Obj*)threaded, NULL, NULL);
+    Vector      *seg_readers = IxReader_Seg_Readers(reader);
+
+    TEST_INT_EQ(runner, IxReader_Doc_Count(reader), NUM_DOCS,
+                "All docs added by threads are committed");
+    TEST_INT_EQ(runner, Vec_Get_Size(seg_readers), NUM_THREADS,
+                "One segment per thread");
+    TEST_TRUE(runner,
+              S_num_hits(threaded, "alpha") == S_num_hits(serial, "alpha")
+              && S_num_hits(threaded, "beta") == S_num_hits(serial, "beta")
+              && S_num_hits(threaded, "x") == NUM_DOCS,
+              "Threaded index matches the same docs as a serial one");
+    DECREF(seg_readers);
+    DECREF(reader);
+
+    // Delete from the existing segments while adding to new ones.
+    uint32_t num_alpha = S_num_hits(threaded, "alpha");
+    Indexer *indexer = Indexer_new(schema, (Obj*)threaded, NULL, 0);
+    Indexer_Set_Num_Threads(indexer, NUM_THREADS);
+    Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("content"),
+                           (Obj*)SSTR_WRAP_C("alpha"));
+    S_add_docs(indexer, 9, "gamma");
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+
+    reader = IxReader_open((Obj*)threaded, NULL, NULL);
+    TEST_INT_EQ(runner, IxReader_Doc_Count(reader), NUM_DOCS - num_alpha + 9,
+                "Deletions and threaded additions commit together");
+    TEST_INT_EQ(runner, S_num_hits(threaded, "gamma"), 9,
+                "Docs added in a later threaded session");
+    DECREF(reader);
+
+    DECREF(threaded);
+    DECREF(serial);
+}
+
+void
+TestIndexer_Run_IMP(TestIndexer *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 7);
+    TestSchema *schema = TestSchema_new(false);
+    test_Num_Threads(runner, (Schema*)schema);
+    test_threaded_indexing(runner, (Schema*)schema);
+    DECREF(schema);
+}
+
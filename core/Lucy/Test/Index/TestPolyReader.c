@@ -21,7 +21,15 @@
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Lucy/Test.h"
 #include "Lucy/Test/Index/TestPolyReader.h"
+#include "Lucy/Test/TestSchema.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Document/HitDoc.h"
+#include "Lucy/Index/DocReader.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/LexiconReader.h"
 #include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Store/RAMFolder.h"
 
 TestPolyReader*
 TestPolyReader_new() {
@@ -45,9 +53,126 @@ test_sub_tick(TestBatchRunner *runner) {
     FREEMEM(ints);
 }
 
+// Commit a session which adds `num_docs` docs, one in twenty of them
+// containing "doomed", and optionally deletes the earlier doomed docs.
+static void
+S_commit_session(Schema *schema, Folder *folder, int32_t num_docs,
+                 bool delete_doomed) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    String  *field   = SSTR_WRAP_C("content");
+    if (delete_doomed) {
+        Indexer_Delete_By_Term(indexer, field, (Obj*)SSTR_WRAP_C("doomed"));
+    }
+    for (int32_t n = 1; n <= num_docs; n++) {
+        Doc *doc = Doc_new(NULL, 0);
+        String *content = Str_newc(n % 20 == 0 ? "x doomed" : "x");
+        Doc_Store(doc, field, (Obj*)content);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(content);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static SegReader*
+S_find_seg_reader(PolyReader *reader, String *seg_name) {
+    Vector *seg_readers = PolyReader_Get_Seg_Readers(reader);
+    for (size_t i = 0, max = Vec_Get_Size(seg_readers); i < max; i++) {
+        SegReader *seg_reader = (SegReader*)Vec_Fetch(seg_readers, i);
+        if (Str_Equals(SegReader_Get_Seg_Name(seg_reader), (Obj*)seg_name)) {
+            return seg_reader;
+        }
+    }
+    return NULL;
+}
+
+static void
+test_Reopen(TestBatchRunner *runner) {
+    Schema *schema = (Schema*)TestSchema_new(false);
+    Folder *folder = (Folder*)RAMFolder_new(NULL);
+    String *lex_api = Class_Get_Name(LEXICONREADER);
+
+    S_commit_session(schema, folder, 100, false);
+    S_commit_session(schema, folder, 100, false);
+    PolyReader *first = PolyReader_open((Obj*)folder, NULL, NULL);
+    Vector *first_segs = PolyReader_Get_Seg_Readers(first);
+
+    // Add a segment.
+    S_commit_session(schema, folder, 100, false);
+    PolyReader *second = PolyReader_Reopen(first, NULL);
+    Vector *second_segs = PolyReader_Get_Seg_Readers(second);
+    TEST_INT_EQ(runner, PolyReader_Doc_Count(second), 300,
+                "Reopen sees new docs");
+    TEST_UINT_EQ(runner, Vec_Get_Size(second_segs), 3,
+                 "Reopen sees new segment");
+    TEST_TRUE(runner,
+              Vec_Fetch(second_segs, 0) == Vec_Fetch(first_segs, 0)
+              && Vec_Fetch(second_segs, 1) == Vec_Fetch(first_segs, 1),
+              "Unchanged SegReaders are reused");
+    TEST_TRUE(runner,
+              PolyReader_Get_Schema(second) == PolyReader_Get_Schema(first),
+              "Unchanged Schema is reused");
+
+    // Delete from every segment.
+    S_commit_session(schema, folder, 0, true);
+    PolyReader *third = PolyReader_Reopen(second, NULL);
+    TEST_INT_EQ(runner, PolyReader_Doc_Count(third), 285,
+                "Reopen sees new deletions");
+    SegReader *before = (SegReader*)Vec_Fetch(second_segs, 0);
+    SegReader *after
+        = S_find_seg_reader(third, SegReader_Get_Seg_Name(before));
+    TEST_TRUE(runner, after && after != before,
+              "SegReader with new deletions is replaced");
+    TEST_TRUE(runner,
+              after
+              && SegReader_Del_Count(before) == 0
+              && SegReader_Del_Count(after) == 5,
+              "Replacement SegReader reads the new deletions");
+    TEST_TRUE(runner,
+              after
+              && SegReader_Fetch(after, lex_api)
+                 == SegReader_Fetch(before, lex_api)
+              && SegReader_Get_Filter_Cache(after)
+                 == SegReader_Get_Filter_Cache(before),
+              "Replacement SegReader shares other components");
+
+    // A fresh open shares nothing.
+    PolyReader *fresh = PolyReader_open((Obj*)folder, NULL, NULL);
+    SegReader *unshared
+        = S_find_seg_reader(fresh, SegReader_Get_Seg_Name(before));
+    TEST_TRUE(runner,
+              unshared
+              && SegReader_Fetch(unshared, lex_api)
+                 != SegReader_Fetch(before, lex_api),
+              "open() doesn't reuse anything");
+
+    // Closing an old reader leaves what it shares with newer ones open.
+    String *doc_api = Class_Get_Name(DOCREADER);
+    PolyReader_Close(first);
+    SegReader *reused = (SegReader*)Vec_Fetch(second_segs, 0);
+    TEST_TRUE(runner, SegReader_Fetch(reused, lex_api) != NULL,
+              "Close spares SegReaders shared with a reopened reader");
+    PolyReader_Close(second);
+    DocReader *doc_reader
+        = after ? (DocReader*)SegReader_Fetch(after, doc_api) : NULL;
+    HitDoc *doc = doc_reader ? DocReader_Fetch_Doc(doc_reader, 1) : NULL;
+    TEST_TRUE(runner, doc != NULL,
+              "Close spares components shared with a reopened reader");
+
+    DECREF(doc);
+    DECREF(fresh);
+    DECREF(third);
+    DECREF(second);
+    DECREF(first);
+    DECREF(folder);
+    DECREF(schema);
+}
+
 void
 TestPolyReader_Run_IMP(TestPolyReader *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 1);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 11);
     test_sub_tick(runner);
+    test_Reopen(runner);
 }
 
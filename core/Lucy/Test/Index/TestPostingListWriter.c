@@ -21,16 +21,127 @@
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Lucy/Test.h"
 #include "Lucy/Test/Index/TestPostingListWriter.h"
+#include "Lucy/Analysis/StandardTokenizer.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Index/Lexicon.h"
+#include "Lucy/Index/LexiconReader.h"
+#include "Lucy/Index/PostingList.h"
+#include "Lucy/Index/PostingListReader.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Plan/FullTextType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_DOCS 300
 
 TestPostingListWriter*
 TestPListWriter_new() {
     return (TestPostingListWriter*)Class_Make_Obj(TESTPOSTINGLISTWRITER);
 }
 
+// Pick terms which tie on their first 8 bytes, terms which are prefixes of
+// others, and terms which occur in every document, so that sorting the
+// postings has to look past the cached key prefixes.
+static String*
+S_body(int32_t n) {
+    return Str_newf("x%i32 common %s abcdefghij%i32%s", n,
+                    n % 2 ? "commonplaces" : "commonplace", n % 50,
+                    n % 3 ? "" : " abcdefgh");
+}
+
+static RAMFolder*
+S_create_index() {
+    Schema *schema = Schema_new();
+    StandardTokenizer *tokenizer = StandardTokenizer_new();
+    FullTextType *type = FullTextType_new((Analyzer*)tokenizer);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("content"), (FieldType*)type);
+
+    RAMFolder *folder  = RAMFolder_new(NULL);
+    Indexer   *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        Doc    *doc  = Doc_new(NULL, 0);
+        String *body = S_body(n);
+        Doc_Store(doc, SSTR_WRAP_C("content"), (Obj*)body);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(body);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+
+    DECREF(indexer);
+    DECREF(type);
+    DECREF(tokenizer);
+    DECREF(schema);
+    return folder;
+}
+
+static void
+test_sorted_postings(TestBatchRunner *runner) {
+    RAMFolder   *folder      = S_create_index();
+    IndexReader *reader      = IxReader_open((Obj*)folder, NULL, NULL);
+    Vector      *seg_readers = IxReader_Seg_Readers(reader);
+    SegReader   *seg_reader  = (SegReader*)Vec_Fetch(seg_readers, 0);
+    LexiconReader *lex_reader = (LexiconReader*)SegReader_Fetch(
+                                    seg_reader, Class_Get_Name(LEXICONREADER));
+    PostingListReader *plist_reader
+        = (PostingListReader*)SegReader_Fetch(
+              seg_reader, Class_Get_Name(POSTINGLISTREADER));
+    String  *field   = SSTR_WRAP_C("content");
+    Lexicon *lexicon = LexReader_Lexicon(lex_reader, field, NULL);
+
+    String  *last_term      = NULL;
+    bool     terms_sorted   = true;
+    bool     docs_sorted    = true;
+    bool     freqs_match    = true;
+    uint32_t num_terms      = 0;
+    uint32_t num_postings   = 0;
+    uint32_t common_freq    = 0;
+    while (Lex_Next(lexicon)) {
+        String *term = (String*)Lex_Get_Term(lexicon);
+        if (last_term && Str_Compare_To(last_term, (Obj*)term) >= 0) {
+            terms_sorted = false;
+        }
+        DECREF(last_term);
+        last_term = Str_Clone(term);
+
+        PostingList *plist
+            = PListReader_Posting_List(plist_reader, field, (Obj*)term);
+        int32_t  last_doc_id = 0;
+        uint32_t count       = 0;
+        int32_t  doc_id;
+        while (0 != (doc_id = PList_Next(plist))) {
+            if (doc_id <= last_doc_id) { docs_sorted = false; }
+            last_doc_id = doc_id;
+            count++;
+        }
+        if (count != PList_Get_Doc_Freq(plist)) { freqs_match = false; }
+        if (Str_Equals_Utf8(term, "common", 6)) { common_freq = count; }
+        num_postings += count;
+        num_terms++;
+        DECREF(plist);
+    }
+
+    TEST_TRUE(runner, terms_sorted, "terms written in sorted order");
+    TEST_TRUE(runner, docs_sorted, "doc ids ascend within each term");
+    TEST_TRUE(runner, freqs_match, "doc freqs match posting counts");
+    TEST_UINT_EQ(runner, num_terms, NUM_DOCS + 54, "all terms present");
+    TEST_UINT_EQ(runner, num_postings, NUM_DOCS * 4 + NUM_DOCS / 3,
+                 "all postings present");
+    TEST_UINT_EQ(runner, common_freq, NUM_DOCS,
+                 "term in every doc keeps every posting");
+
+    DECREF(last_term);
+    DECREF(lexicon);
+    DECREF(seg_readers);
+    DECREF(reader);
+    DECREF(folder);
+}
+
 void
 TestPListWriter_Run_IMP(TestPostingListWriter *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 1);
-    PASS(runner, "Placeholder");
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 6);
+    test_sorted_postings(runner);
 }
 
-
@@ -0,0 +1,233 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Index/TestSegLexicon.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/LexiconReader.h"
+#include "Lucy/Index/PolyReader.h"
+#include "Lucy/Index/SegLexicon.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Store/RAMFolder.h"
+
+// Even numbers only, so that every odd one falls between two terms.  There
+// are enough terms to span several LexIndex key frames.
+#define MAX_WORD 1000
+
+TestSegLexicon*
+TestSegLex_new() {
+    return (TestSegLexicon*)Class_Make_Obj(TESTSEGLEXICON);
+}
+
+static RAMFolder*
+S_create_index() {
+    Schema     *schema = Schema_new();
+    StringType *type   = StringType_new();
+    RAMFolder  *folder = RAMFolder_new(NULL);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("word"), (FieldType*)type);
+
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t i = 0; i < MAX_WORD; i += 2) {
+        Doc    *doc  = Doc_new(NULL, 0);
+        String *word = Str_newf("w%i32", 10000 + i);
+        Doc_Store(doc, SSTR_WRAP_C("word"), (Obj*)word);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(word);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+
+    DECREF(indexer);
+    DECREF(type);
+    DECREF(schema);
+    return folder;
+}
+
+// Terms look like "w10042" for 42.
+static String*
+S_word(int32_t num) {
+    return Str_newf("w%i32", 10000 + num);
+}
+
+static bool
+S_at(SegLexicon *lexicon, int32_t num) {
+    String *word  = S_word(num);
+    Obj    *term  = SegLex_Get_Term(lexicon);
+    bool    retval = term != NULL && Str_Equals(word, term);
+    DECREF(word);
+    return retval;
+}
+
+// Check that iterating from the current position yields the even numbers
+// from `first` to `last` and nothing else.
+static bool
+S_yields(SegLexicon *lexicon, int32_t first, int32_t last) {
+    if (first > last) {
+        return SegLex_Get_Term(lexicon) == NULL && !SegLex_Next(lexicon);
+    }
+    for (int32_t num = first; num <= last; num += 2) {
+        if (!S_at(lexicon, num)) { return false; }
+        if (num < last && !SegLex_Next(lexicon)) { return false; }
+    }
+    return !SegLex_Next(lexicon) && !SegLex_Next(lexicon);
+}
+
+static void
+test_seek(TestBatchRunner *runner, SegLexicon *lexicon) {
+    String *word = S_word(500);
+    SegLex_Seek(lexicon, (Obj*)word);
+    TEST_TRUE(runner, S_at(lexicon, 500), "Seek to a term");
+    DECREF(word);
+
+    word = S_word(501);
+    SegLex_Seek(lexicon, (Obj*)word);
+    TEST_TRUE(runner, S_at(lexicon, 502), "Seek between terms");
+    DECREF(word);
+
+    SegLex_Seek(lexicon, (Obj*)SSTR_WRAP_C("a"));
+    TEST_TRUE(runner, S_at(lexicon, 0), "Seek before the first term");
+
+    word = S_word(MAX_WORD - 4);
+    SegLex_Seek(lexicon, (Obj*)word);
+    TEST_TRUE(runner, S_yields(lexicon, MAX_WORD - 4, MAX_WORD - 2),
+              "Next runs to the end after Seek");
+    DECREF(word);
+
+    SegLex_Seek(lexicon, (Obj*)SSTR_WRAP_C("x"));
+    TEST_TRUE(runner, S_yields(lexicon, 1, 0), "Seek past the last term");
+}
+
+static void
+test_seek_exact(TestBatchRunner *runner, SegLexicon *lexicon) {
+    String *word = S_word(778);
+    TEST_TRUE(runner, SegLex_Seek_Exact(lexicon, (Obj*)word)
+              && S_at(lexicon, 778)
+              && SegLex_Doc_Freq(lexicon) == 1,
+              "Seek_Exact finds a term");
+    DECREF(word);
+
+    word = S_word(777);
+    TEST_FALSE(runner, SegLex_Seek_Exact(lexicon, (Obj*)word),
+               "Seek_Exact misses a term between two others");
+    DECREF(word);
+
+    TEST_FALSE(runner, SegLex_Seek_Exact(lexicon, (Obj*)SSTR_WRAP_C("w1")),
+               "Seek_Exact misses a prefix of a term");
+}
+
+static void
+test_seek_prefix(TestBatchRunner *runner, SegLexicon *lexicon) {
+    SegLex_Seek_Prefix(lexicon, SSTR_WRAP_C("w101"));
+    TEST_TRUE(runner, S_yields(lexicon, 100, 198), "Seek_Prefix");
+
+    SegLex_Seek_Prefix(lexicon, SSTR_WRAP_C("w10"));
+    TEST_TRUE(runner, S_yields(lexicon, 0, 998),
+              "Seek_Prefix matching every term");
+
+    SegLex_Seek_Prefix(lexicon, SSTR_WRAP_C("w1013"));
+    TEST_TRUE(runner, S_yields(lexicon, 130, 138),
+              "Seek_Prefix for a handful of terms");
+
+    SegLex_Seek_Prefix(lexicon, SSTR_WRAP_C("w2"));
+    TEST_TRUE(runner, S_yields(lexicon, 1, 0),
+              "Seek_Prefix matching nothing");
+
+    // A plain Seek lifts the limit again.
+    SegLex_Seek_Prefix(lexicon, SSTR_WRAP_C("w101"));
+    String *word = S_word(198);
+    SegLex_Seek(lexicon, (Obj*)word);
+    TEST_TRUE(runner, SegLex_Next(lexicon) && S_at(lexicon, 200),
+              "Seek clears the end of a prefix scan");
+    DECREF(word);
+}
+
+static void
+test_seek_range(TestBatchRunner *runner, SegLexicon *lexicon) {
+    String *lower = S_word(300);
+    String *upper = S_word(400);
+    SegLex_Seek_Range(lexicon, lower, upper, true, false);
+    TEST_TRUE(runner, S_yields(lexicon, 300, 398),
+              "Seek_Range including the lower term");
+    SegLex_Seek_Range(lexicon, lower, upper, false, true);
+    TEST_TRUE(runner, S_yields(lexicon, 302, 400),
+              "Seek_Range including the upper term");
+    DECREF(upper);
+    DECREF(lower);
+
+    lower = S_word(301);
+    upper = S_word(311);
+    SegLex_Seek_Range(lexicon, lower, upper, true, true);
+    TEST_TRUE(runner, S_yields(lexicon, 302, 310),
+              "Seek_Range between terms");
+    SegLex_Seek_Range(lexicon, upper, lower, true, true);
+    TEST_TRUE(runner, S_yields(lexicon, 1, 0), "Seek_Range upside down");
+    DECREF(upper);
+    DECREF(lower);
+
+    lower = S_word(990);
+    SegLex_Seek_Range(lexicon, lower, NULL, false, false);
+    TEST_TRUE(runner, S_yields(lexicon, 992, 998),
+              "Seek_Range open at the top");
+    DECREF(lower);
+}
+
+static void
+test_doc_freq(TestBatchRunner *runner, LexiconReader *lex_reader) {
+    String *field = SSTR_WRAP_C("word");
+    String *word  = S_word(42);
+    TEST_UINT_EQ(runner, LexReader_Doc_Freq(lex_reader, field, (Obj*)word),
+                 1, "Doc_Freq for a term");
+    DECREF(word);
+    word = S_word(43);
+    TEST_UINT_EQ(runner, LexReader_Doc_Freq(lex_reader, field, (Obj*)word),
+                 0, "Doc_Freq for a missing term");
+    DECREF(word);
+}
+
+void
+TestSegLex_Run_IMP(TestSegLexicon *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 20);
+
+    RAMFolder  *folder      = S_create_index();
+    PolyReader *poly_reader = PolyReader_open((Obj*)folder, NULL, NULL);
+    Vector     *seg_readers = PolyReader_Get_Seg_Readers(poly_reader);
+    SegReader  *seg_reader  = (SegReader*)Vec_Fetch(seg_readers, 0);
+    LexiconReader *lex_reader
+        = (LexiconReader*)SegReader_Obtain(seg_reader,
+                                           Class_Get_Name(LEXICONREADER));
+    SegLexicon *lexicon
+        = (SegLexicon*)CERTIFY(LexReader_Lexicon(lex_reader,
+                                                 SSTR_WRAP_C("word"), NULL),
+                               SEGLEXICON);
+
+    test_seek(runner, lexicon);
+    test_seek_exact(runner, lexicon);
+    test_seek_prefix(runner, lexicon);
+    test_seek_range(runner, lexicon);
+    test_doc_freq(runner, lex_reader);
+
+    DECREF(lexicon);
+    DECREF(poly_reader);
+    DECREF(folder);
+}
+
@@ -0,0 +1,161 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Index/TestSkipList.h"
+#include "Lucy/Test/Plan/TestArchitecture.h"
+#include "Lucy/Index/SkipListReader.h"
+#include "Lucy/Index/SkipListWriter.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Store/RAMFile.h"
+
+#define DOC_FREQ     1000
+#define POST_FILEPOS 100
+
+TestSkipList*
+TestSkipList_new() {
+    return (TestSkipList*)Class_Make_Obj(TESTSKIPLIST);
+}
+
+// The nth posting (counting from 1) is for doc n * 2.
+static int32_t
+S_doc_id(int32_t n) {
+    return n * 2;
+}
+
+static float
+S_impact(int32_t n) {
+    return (float)((n * 7) % 11 + 1);
+}
+
+// Each block of postings occupies 10 bytes of the postings file.
+static int64_t
+S_filepos(int32_t n, int32_t skip_interval) {
+    return POST_FILEPOS + (n / skip_interval) * 10;
+}
+
+static int64_t
+S_write_term(SkipListWriter *writer, OutStream *outstream,
+             int32_t skip_interval, int32_t doc_freq) {
+    SkipWriter_Start_Term(writer);
+    for (int32_t n = 1; n <= doc_freq; n++) {
+        SkipWriter_Add_Posting(writer, S_impact(n));
+        if (n % skip_interval == 0) {
+            SkipWriter_Add_Entry(writer, S_doc_id(n),
+                                 S_filepos(n, skip_interval));
+        }
+    }
+    return SkipWriter_Finish_Term(writer, outstream, POST_FILEPOS);
+}
+
+static void
+test_skip_list(TestBatchRunner *runner) {
+    TestArchitecture *arch = TestArch_new();
+    const int32_t skip_interval = Arch_Skip_Interval((Architecture*)arch);
+    SkipListWriter *writer = SkipWriter_new((Architecture*)arch);
+    SkipListReader *reader = SkipReader_new((Architecture*)arch);
+    RAMFile   *file      = RAMFile_new(NULL, false);
+    OutStream *outstream = OutStream_open((Obj*)file);
+
+    // Surround the term under test with others.
+    OutStream_Write_Bytes(outstream, "xyz", 3);
+    S_write_term(writer, outstream, skip_interval, 50);
+    int64_t skip_filepos
+        = S_write_term(writer, outstream, skip_interval, DOC_FREQ);
+    TEST_INT_EQ(runner,
+                S_write_term(writer, outstream, skip_interval,
+                             skip_interval - 1),
+                -1, "no skip data for terms shorter than the interval");
+    S_write_term(writer, outstream, skip_interval, 200);
+    OutStream_Close(outstream);
+
+    InStream *instream = InStream_open((Obj*)file);
+    SkipReader_Init_Term(reader, instream, skip_filepos, DOC_FREQ,
+                         POST_FILEPOS);
+    TEST_TRUE(runner, SkipReader_Get_Max_Impact(reader) == 11.0f,
+              "Max_Impact");
+
+    SkipReader_Skip_To(reader, 1);
+    TEST_INT_EQ(runner, SkipReader_Get_Count(reader), 0,
+                "nothing precedes the first doc");
+    TEST_INT_EQ(runner, SkipReader_Get_Block_End(reader),
+                S_doc_id(skip_interval), "first block end");
+
+    SkipReader_Skip_To(reader, 501);
+    TEST_INT_EQ(runner, SkipReader_Get_Count(reader), 249, "Count");
+    TEST_INT_EQ(runner, SkipReader_Get_Doc_ID(reader), 498, "Doc_ID");
+    TEST_INT_EQ(runner, SkipReader_Get_Filepos(reader),
+                S_filepos(249, skip_interval), "Filepos");
+    TEST_INT_EQ(runner, SkipReader_Get_Block_End(reader), 504,
+                "Block_End");
+    float block_max = 0.0f;
+    for (int32_t n = 250; n <= 252; n++) {
+        if (S_impact(n) > block_max) { block_max = S_impact(n); }
+    }
+    TEST_TRUE(runner, SkipReader_Get_Block_Max(reader) == block_max,
+              "Block_Max");
+
+    // Walk forward in random strides, checking every stop.
+    bool all_ok = true;
+    int32_t target = 501;
+    while (target <= S_doc_id(DOC_FREQ)) {
+        target += (int32_t)(TestUtils_random_u64() % 40) + 1;
+        SkipReader_Skip_To(reader, target);
+        int32_t passed = (target - 1) / 2;
+        if (passed > DOC_FREQ) { passed = DOC_FREQ; }
+        passed -= passed % skip_interval;
+        if (SkipReader_Get_Count(reader) != (uint32_t)passed
+            || SkipReader_Get_Doc_ID(reader) != S_doc_id(passed)
+            || SkipReader_Get_Filepos(reader)
+               != S_filepos(passed, skip_interval)
+           ) {
+            all_ok = false;
+        }
+    }
+    TEST_TRUE(runner, all_ok, "Skip_To with random strides");
+    TEST_INT_EQ(runner, SkipReader_Get_Block_End(reader), INT32_MAX,
+                "no block end for the final partial block");
+    TEST_TRUE(runner, SkipReader_Get_Block_Max(reader) == 11.0f,
+              "final block falls back to Max_Impact");
+
+    // A fresh pass over the same term, jumping straight to the end.
+    SkipReader_Init_Term(reader, instream, skip_filepos, DOC_FREQ,
+                         POST_FILEPOS);
+    SkipReader_Skip_To(reader, 1990);
+    TEST_INT_EQ(runner, SkipReader_Get_Count(reader), 993,
+                "long jump from the start");
+
+    DECREF(instream);
+    DECREF(outstream);
+    DECREF(file);
+    DECREF(reader);
+    DECREF(writer);
+    DECREF(arch);
+}
+
+void
+TestSkipList_Run_IMP(TestSkipList *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 13);
+    test_skip_list(runner);
+}
+
+
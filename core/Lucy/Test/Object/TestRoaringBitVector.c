@@ -0,0 +1,270 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Object/TestRoaringBitVector.h"
+#include "Lucy/Object/RoaringBitVector.h"
+
+// Enough to span several chunks of 65536 bits.
+#define MAX_TICK 300000
+
+#define DO_OR 1
+#define DO_XOR 2
+#define DO_AND 3
+#define DO_AND_NOT 4
+
+TestRoaringBitVector*
+TestRoarBitVec_new() {
+    return (TestRoaringBitVector*)Class_Make_Obj(TESTROARINGBITVECTOR);
+}
+
+// Return true if both vectors have exactly the same bits set.
+static bool
+S_same_bits(BitVector *a, BitVector *b) {
+    if (BitVec_Count(a) != BitVec_Count(b)) { return false; }
+    int32_t tick = BitVec_Next_Hit(a, 0);
+    while (tick != -1) {
+        if (BitVec_Next_Hit(b, (size_t)tick) != tick) { return false; }
+        tick = BitVec_Next_Hit(a, (size_t)tick + 1);
+    }
+    return BitVec_Next_Hit(b, 0) == BitVec_Next_Hit(a, 0);
+}
+
+// Set the same bits in a RoaringBitVector and a plain BitVector.  Some
+// patterns fill a chunk past the point where it becomes a bitmap.
+static void
+S_fill(BitVector *roaring, BitVector *plain, int pattern) {
+    switch (pattern) {
+        case 0:
+            for (int i = 0; i < 50; i++) {
+                size_t tick = (size_t)(TestUtils_random_u64() % MAX_TICK);
+                BitVec_Set(roaring, tick);
+                BitVec_Set(plain, tick);
+            }
+            break;
+        case 1:
+            for (int i = 0; i < 20000; i++) {
+                size_t tick = 65536
+                              + (size_t)(TestUtils_random_u64() % 65536);
+                BitVec_Set(roaring, tick);
+                BitVec_Set(plain, tick);
+            }
+            break;
+        default:
+            for (int i = 0; i < 5000; i++) {
+                size_t tick = (size_t)(TestUtils_random_u64() % MAX_TICK);
+                BitVec_Set(roaring, tick);
+                BitVec_Set(plain, tick);
+            }
+            BitVec_Flip_Block(roaring, 1000, 70000);
+            BitVec_Flip_Block(plain, 1000, 70000);
+            break;
+    }
+}
+
+static void
+S_apply(BitVector *self, BitVector *other, int operation) {
+    switch (operation) {
+        case DO_OR:      BitVec_Or(self, other);      break;
+        case DO_XOR:     BitVec_Xor(self, other);     break;
+        case DO_AND:     BitVec_And(self, other);     break;
+        case DO_AND_NOT: BitVec_And_Not(self, other); break;
+        default:
+            THROW(ERR, "Unrecognized operation: %i32", (int32_t)operation);
+    }
+}
+
+static const char*
+S_op_name(int operation) {
+    switch (operation) {
+        case DO_OR:  return "Or";
+        case DO_XOR: return "Xor";
+        case DO_AND: return "And";
+        default:     return "And_Not";
+    }
+}
+
+static void
+test_ops(TestBatchRunner *runner) {
+    for (int operation = DO_OR; operation <= DO_AND_NOT; operation++) {
+        bool roaring_ok = true;
+        bool mixed_ok   = true;
+        bool plain_ok   = true;
+        for (int pattern_a = 0; pattern_a < 3; pattern_a++) {
+            for (int pattern_b = 0; pattern_b < 3; pattern_b++) {
+                BitVector *roar_a  = (BitVector*)RoarBitVec_new();
+                BitVector *roar_b  = (BitVector*)RoarBitVec_new();
+                BitVector *plain_a = BitVec_new(0);
+                BitVector *plain_b = BitVec_new(0);
+                S_fill(roar_a, plain_a, pattern_a);
+                S_fill(roar_b, plain_b, pattern_b);
+
+                BitVector *roar_mixed  = (BitVector*)BitVec_Clone(roar_a);
+                BitVector *plain_mixed = BitVec_Clone(plain_a);
+                S_apply(roar_a, roar_b, operation);
+                S_apply(roar_mixed, plain_b, operation);
+                S_apply(plain_mixed, roar_b, operation);
+                S_apply(plain_a, plain_b, operation);
+                roaring_ok = roaring_ok && S_same_bits(roar_a, plain_a);
+                mixed_ok   = mixed_ok && S_same_bits(roar_mixed, plain_a);
+                plain_ok   = plain_ok && S_same_bits(plain_mixed, plain_a);
+
+                DECREF(plain_mixed);
+                DECREF(roar_mixed);
+                DECREF(plain_b);
+                DECREF(plain_a);
+                DECREF(roar_b);
+                DECREF(roar_a);
+            }
+        }
+        TEST_TRUE(runner, roaring_ok, "%s with a RoaringBitVector",
+                  S_op_name(operation));
+        TEST_TRUE(runner, mixed_ok, "%s with a plain BitVector",
+                  S_op_name(operation));
+        TEST_TRUE(runner, plain_ok, "%s of a plain BitVector with roaring",
+                  S_op_name(operation));
+    }
+
+    BitVector *roaring = (BitVector*)RoarBitVec_new();
+    BitVector *plain   = BitVec_new(0);
+    S_fill(roaring, plain, 2);
+    BitVec_Or(roaring, roaring);
+    TEST_TRUE(runner, S_same_bits(roaring, plain), "Or with itself");
+    BitVec_Xor(roaring, roaring);
+    TEST_INT_EQ(runner, BitVec_Count(roaring), 0, "Xor with itself");
+    DECREF(plain);
+    DECREF(roaring);
+}
+
+static void
+test_dense_chunk(TestBatchRunner *runner) {
+    RoaringBitVector *bit_vec = RoarBitVec_new();
+
+    // One more bit than an array chunk holds, then back again.
+    for (size_t i = 0; i <= 4096; i++) {
+        RoarBitVec_Set(bit_vec, 70000 + i * 3);
+    }
+    TEST_INT_EQ(runner, RoarBitVec_Count(bit_vec), 4097, "Count of bitmap");
+    TEST_TRUE(runner, RoarBitVec_Get(bit_vec, 70000 + 4096 * 3)
+              && !RoarBitVec_Get(bit_vec, 70001),
+              "Get from bitmap");
+    TEST_INT_EQ(runner, RoarBitVec_Next_Hit(bit_vec, 70001), 70003,
+                "Next_Hit within bitmap");
+    RoarBitVec_Clear(bit_vec, 70000);
+    RoarBitVec_Clear(bit_vec, 70003);
+    TEST_INT_EQ(runner, RoarBitVec_Count(bit_vec), 4095,
+                "Count after dropping back to an array");
+    TEST_INT_EQ(runner, RoarBitVec_Next_Hit(bit_vec, 0), 70006,
+                "Next_Hit after dropping back to an array");
+
+    I32Array *array = RoarBitVec_To_Array(bit_vec);
+    bool ok = I32Arr_Get_Size(array) == 4095;
+    for (size_t i = 0; ok && i < 4095; i++) {
+        ok = I32Arr_Get(array, i) == (int32_t)(70006 + i * 3);
+    }
+    TEST_TRUE(runner, ok, "To_Array");
+    DECREF(array);
+
+    RoarBitVec_Clear_All(bit_vec);
+    TEST_INT_EQ(runner, RoarBitVec_Count(bit_vec), 0, "Clear_All");
+    TEST_INT_EQ(runner, RoarBitVec_Next_Hit(bit_vec, 0), -1,
+                "Next_Hit after Clear_All");
+
+    DECREF(bit_vec);
+}
+
+static void
+test_Flip_Block(TestBatchRunner *runner) {
+    BitVector *roaring = (BitVector*)RoarBitVec_new();
+    BitVector *plain   = BitVec_new(0);
+
+    // Ranges which start, end or lie within chunks and words.
+    static const size_t ranges[][2] = {
+        { 0, 1 }, { 63, 2 }, { 65530, 10 }, { 100, 200000 },
+        { 131072, 65536 }, { 5, 0 }, { 262143, 1 }
+    };
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        BitVec_Flip_Block(roaring, ranges[i][0], ranges[i][1]);
+        BitVec_Flip_Block(plain, ranges[i][0], ranges[i][1]);
+    }
+    TEST_TRUE(runner, S_same_bits(roaring, plain), "Flip_Block");
+    TEST_TRUE(runner, BitVec_Get_Capacity(roaring) >= 262144,
+              "Flip_Block raises capacity");
+
+    DECREF(plain);
+    DECREF(roaring);
+}
+
+static void
+test_Clone_and_Mimic(TestBatchRunner *runner) {
+    BitVector *roaring = (BitVector*)RoarBitVec_new();
+    BitVector *plain   = BitVec_new(0);
+    S_fill(roaring, plain, 2);
+
+    BitVector *twin = BitVec_Clone(roaring);
+    TEST_TRUE(runner, Obj_is_a((Obj*)twin, ROARINGBITVECTOR)
+              && S_same_bits(twin, plain),
+              "Clone");
+    BitVec_Clear(twin, (size_t)BitVec_Next_Hit(twin, 0));
+    TEST_TRUE(runner, S_same_bits(roaring, plain), "Clone is deep");
+
+    RoaringBitVector *mimic = RoarBitVec_new();
+    RoarBitVec_Set(mimic, 3);
+    RoarBitVec_Mimic(mimic, (Obj*)plain);
+    TEST_TRUE(runner, S_same_bits((BitVector*)mimic, plain),
+              "Mimic a plain BitVector");
+    BitVector *plain_mimic = BitVec_new(0);
+    BitVec_Mimic(plain_mimic, (Obj*)roaring);
+    TEST_TRUE(runner, S_same_bits(plain_mimic, plain),
+              "Mimic a RoaringBitVector");
+
+    DECREF(plain_mimic);
+    DECREF(mimic);
+    DECREF(twin);
+    DECREF(plain);
+    DECREF(roaring);
+}
+
+static void
+test_out_of_range(TestBatchRunner *runner) {
+    RoaringBitVector *bit_vec = RoarBitVec_new();
+    RoarBitVec_Set(bit_vec, 17);
+    TEST_FALSE(runner, RoarBitVec_Get(bit_vec, 1000000), "Get past end");
+    TEST_INT_EQ(runner, RoarBitVec_Next_Hit(bit_vec, 18), -1,
+                "Next_Hit past last bit");
+    TEST_INT_EQ(runner, RoarBitVec_Get_Capacity(bit_vec), 18,
+                "Capacity follows the highest bit set");
+    TEST_TRUE(runner, RoarBitVec_Get_Raw_Bits(bit_vec) == NULL,
+              "No raw bits");
+    DECREF(bit_vec);
+}
+
+void
+TestRoarBitVec_Run_IMP(TestRoaringBitVector *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 32);
+    test_ops(runner);
+    test_dense_chunk(runner);
+    test_Flip_Block(runner);
+    test_Clone_and_Mimic(runner);
+    test_out_of_range(runner);
+}
+
+
@@ -42,6 +42,7 @@ test_Dump_Load_and_Equals(TestBatchRunner *runner) {
     FullTextType      *not_indexed   = FullTextType_new((Analyzer*)tokenizer);
     FullTextType      *not_stored    = FullTextType_new((Analyzer*)tokenizer);
     FullTextType      *highlightable = FullTextType_new((Analyzer*)tokenizer);
+    FullTextType      *impact_ord    = FullTextType_new((Analyzer*)tokenizer);
     Obj               *dump          = (Obj*)FullTextType_Dump(type);
     Obj               *clone         = Freezer_load(dump);
     Obj               *another_dump  = (Obj*)FullTextType_Dump_For_Schema(type);
@@ -50,6 +51,7 @@ test_Dump_Load_and_Equals(TestBatchRunner *runner) {
     FullTextType_Set_Indexed(not_indexed, false);
     FullTextType_Set_Stored(not_stored, false);
     FullTextType_Set_Highlightable(highlightable, true);
+    FullTextType_Set_Impact_Ordered(impact_ord, true);
 
     // (This step is normally performed by Schema_Load() internally.)
     Hash_Store_Utf8((Hash*)another_dump, "analyzer", 8, INCREF(tokenizer));
@@ -65,15 +67,26 @@ test_Dump_Load_and_Equals(TestBatchRunner *runner) {
                "Equals() false with stored => false");
     TEST_FALSE(runner, FullTextType_Equals(type, (Obj*)highlightable),
                "Equals() false with highlightable => true");
+    TEST_FALSE(runner, FullTextType_Equals(type, (Obj*)impact_ord),
+               "Equals() false with impact_ordered => true");
     TEST_TRUE(runner, FullTextType_Equals(type, (Obj*)clone),
               "Dump => Load round trip");
     TEST_TRUE(runner, FullTextType_Equals(type, (Obj*)another_clone),
               "Dump_For_Schema => Load round trip");
 
+    Obj *impact_dump = (Obj*)FullTextType_Dump_For_Schema(impact_ord);
+    Hash_Store_Utf8((Hash*)impact_dump, "analyzer", 8, INCREF(tokenizer));
+    FullTextType *impact_clone = FullTextType_Load(type, impact_dump);
+    TEST_TRUE(runner, FullTextType_Equals(impact_ord, (Obj*)impact_clone),
+              "impact_ordered survives Dump_For_Schema => Load");
+
+    DECREF(impact_clone);
+    DECREF(impact_dump);
     DECREF(another_clone);
     DECREF(dump);
     DECREF(clone);
     DECREF(another_dump);
+    DECREF(impact_ord);
     DECREF(highlightable);
     DECREF(not_stored);
     DECREF(not_indexed);
@@ -104,7 +117,7 @@ test_Compare_Values(TestBatchRunner *runner) {
 
 void
 TestFullTextType_Run_IMP(TestFullTextType *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 10);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 12);
     test_Dump_Load_and_Equals(runner);
     test_Compare_Values(runner);
 }
@@ -0,0 +1,147 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_TESTLUCY_TESTANDMATCHER
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Search/TestANDMatcher.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Search/ANDMatcher.h"
+#include "Lucy/Search/BitVecMatcher.h"
+#include "Lucy/Search/I32ArrayMatcher.h"
+
+#define DOC_MAX 10000
+
+TestANDMatcher*
+TestANDMatcher_new() {
+    return (TestANDMatcher*)Class_Make_Obj(TESTANDMATCHER);
+}
+
+// Make a Matcher for the multiples of `step` up to DOC_MAX, as a BitVector
+// for dense sets and as a sorted array for sparse ones.
+static Matcher*
+S_make_multiples(int32_t step) {
+    if (step < 32) {
+        BitVector *bit_vec = BitVec_new(DOC_MAX + 1);
+        for (int32_t doc_id = step; doc_id <= DOC_MAX; doc_id += step) {
+            BitVec_Set(bit_vec, (size_t)doc_id);
+        }
+        Matcher *matcher = (Matcher*)BitVecMatcher_new(bit_vec);
+        DECREF(bit_vec);
+        return matcher;
+    }
+    else {
+        size_t   count   = (size_t)(DOC_MAX / step);
+        int32_t *doc_ids = (int32_t*)MALLOCATE(count * sizeof(int32_t));
+        for (size_t i = 0; i < count; i++) {
+            doc_ids[i] = (int32_t)(i + 1) * step;
+        }
+        I32Array *array = I32Arr_new_steal(doc_ids, count);
+        Matcher *matcher = (Matcher*)I32ArrMatcher_new(array);
+        DECREF(array);
+        return matcher;
+    }
+}
+
+static ANDMatcher*
+S_make_and_matcher(const int32_t *steps, size_t num_steps) {
+    Vector *children = Vec_new(num_steps);
+    for (size_t i = 0; i < num_steps; i++) {
+        Vec_Push(children, (Obj*)S_make_multiples(steps[i]));
+    }
+    ANDMatcher *and_matcher = ANDMatcher_new(children, NULL);
+    DECREF(children);
+    return and_matcher;
+}
+
+// Intersect the multiples of each of `steps`, which must be coprime, and
+// check that exactly the multiples of their product come back.
+static void
+S_test_intersection(TestBatchRunner *runner, const int32_t *steps,
+                    size_t num_steps) {
+    ANDMatcher *and_matcher = S_make_and_matcher(steps, num_steps);
+    int32_t product  = 1;
+    int64_t min_cost = INT64_MAX;
+    for (size_t i = 0; i < num_steps; i++) {
+        product *= steps[i];
+        int64_t cost = DOC_MAX / steps[i];
+        if (cost < min_cost) { min_cost = cost; }
+    }
+
+    int32_t expected = 0;
+    int32_t got;
+    bool    agree    = true;
+    while (0 != (got = ANDMatcher_Next(and_matcher))) {
+        expected += product;
+        if (got != expected
+            || ANDMatcher_Get_Doc_ID(and_matcher) != expected
+           ) {
+            agree = false;
+            break;
+        }
+    }
+    TEST_TRUE(runner, agree && expected + product > DOC_MAX,
+              "Intersect multiples of %d, %d, %d",
+              (int)steps[0], (int)steps[1], (int)steps[2]);
+    TEST_TRUE(runner, ANDMatcher_Cost(and_matcher) == min_cost,
+              "Cost is that of the cheapest child");
+
+    DECREF(and_matcher);
+}
+
+static void
+test_intersection(TestBatchRunner *runner) {
+    // Rarest child first, last and in the middle.
+    int32_t rare_first[]  = { 101, 2, 3 };
+    int32_t rare_last[]   = { 2, 3, 101 };
+    int32_t rare_middle[] = { 5, 37, 7 };
+    S_test_intersection(runner, rare_first, 3);
+    S_test_intersection(runner, rare_last, 3);
+    S_test_intersection(runner, rare_middle, 3);
+}
+
+static void
+test_Advance(TestBatchRunner *runner) {
+    int32_t steps[] = { 2, 3, 97 };
+    ANDMatcher *and_matcher = S_make_and_matcher(steps, 3);
+    int32_t step = 2 * 3 * 97;
+
+    TEST_INT_EQ(runner, ANDMatcher_Advance(and_matcher, 100), step,
+                "First Advance lands on first match past target");
+    TEST_INT_EQ(runner, ANDMatcher_Advance(and_matcher, step * 3 + 1),
+                step * 4, "Advance skips to next match past target");
+    TEST_INT_EQ(runner, ANDMatcher_Next(and_matcher), step * 5,
+                "Next after Advance");
+    TEST_INT_EQ(runner, ANDMatcher_Advance(and_matcher, DOC_MAX + 1), 0,
+                "Advance past the end");
+    TEST_INT_EQ(runner, ANDMatcher_Next(and_matcher), 0,
+                "Next after exhaustion");
+
+    DECREF(and_matcher);
+}
+
+void
+TestANDMatcher_Run_IMP(TestANDMatcher *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 11);
+    test_intersection(runner);
+    test_Advance(runner);
+}
+
+
@@ -0,0 +1,196 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/Num.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/TestUtils.h"
+#include "Lucy/Test/Search/TestFacetCollector.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/Collector/FacetCollector.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_DOCS 200
+
+TestFacetCollector*
+TestFacetCollector_new() {
+    return (TestFacetCollector*)Class_Make_Obj(TESTFACETCOLLECTOR);
+}
+
+// Four categories, of which "c0" is the most common and "c3" the least.
+// Every 25th doc has no category.
+static const char*
+S_category(int32_t n) {
+    if (n % 25 == 0) { return NULL; }
+    int32_t bucket = (n / 2) % 10;
+    return bucket < 4 ? "c0" : bucket < 7 ? "c1" : bucket < 9 ? "c2" : "c3";
+}
+
+static bool
+S_matches(int32_t n) {
+    return n % 2 == 1;
+}
+
+static Schema*
+S_create_schema() {
+    Schema *schema = Schema_new();
+    StringType *category_type = StringType_new();
+    StringType_Set_Sortable(category_type, true);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("category"),
+                      (FieldType*)category_type);
+    Int32Type *price_type = Int32Type_new();
+    Int32Type_Set_Sortable(price_type, true);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("price"), (FieldType*)price_type);
+    StringType *flag_type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("flag"), (FieldType*)flag_type);
+    DECREF(flag_type);
+    DECREF(price_type);
+    DECREF(category_type);
+    return schema;
+}
+
+static void
+S_add_docs(RAMFolder *folder, Schema *schema, int32_t first, int32_t last) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = first; n <= last; n++) {
+        Doc *doc = Doc_new(NULL, 0);
+        const char *category = S_category(n);
+        if (category) {
+            String *value = Str_newf("%s", category);
+            Doc_Store(doc, SSTR_WRAP_C("category"), (Obj*)value);
+            DECREF(value);
+        }
+        Integer *price = Int_new(n * 3);
+        String  *flag  = Str_newf("%s", S_matches(n) ? "yes" : "no");
+        Doc_Store(doc, SSTR_WRAP_C("price"), (Obj*)price);
+        Doc_Store(doc, SSTR_WRAP_C("flag"), (Obj*)flag);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(flag);
+        DECREF(price);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static FacetCollector*
+S_collect(IndexSearcher *searcher, const char *field, uint32_t num_buckets) {
+    Query *query = (Query*)TestUtils_make_term_query("flag", "yes");
+    FacetCollector *collector
+        = FacetColl_new(SSTR_WRAP_C(field), num_buckets);
+    IxSearcher_Collect(searcher, query, (Collector*)collector);
+    DECREF(query);
+    return collector;
+}
+
+static void
+test_counts(TestBatchRunner *runner, IndexSearcher *searcher) {
+    uint32_t expected[4] = { 0, 0, 0, 0 };
+    uint32_t num_matches = 0;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        if (!S_matches(n)) { continue; }
+        const char *category = S_category(n);
+        if (category) { expected[category[1] - '0']++; }
+        num_matches++;
+    }
+
+    FacetCollector *collector = S_collect(searcher, "category", 10);
+    TEST_INT_EQ(runner, FacetColl_Get_Total_Hits(collector), num_matches,
+                "Every hit collected");
+
+    Vector *top_values = FacetColl_Top_Values(collector);
+    bool    counts_ok  = Vec_Get_Size(top_values) == 4;
+    for (uint32_t i = 0; counts_ok && i < 4; i++) {
+        String *wanted = Str_newf("c%u32", i);
+        Obj    *value  = Vec_Fetch(top_values, i);
+        counts_ok = Str_Equals(wanted, value)
+                    && FacetColl_Get_Count(collector, value) == expected[i];
+        DECREF(wanted);
+    }
+    TEST_TRUE(runner, counts_ok,
+              "Top_Values lists each category by descending count");
+    TEST_INT_EQ(runner,
+                FacetColl_Get_Count(collector, (Obj*)SSTR_WRAP_C("c9")), 0,
+                "Get_Count for an absent value");
+    TEST_INT_EQ(runner, FacetColl_Get_Num_Values(collector), 0,
+                "No numeric aggregates for a text field");
+    DECREF(top_values);
+    DECREF(collector);
+
+    collector  = S_collect(searcher, "category", 2);
+    top_values = FacetColl_Top_Values(collector);
+    TEST_TRUE(runner, Vec_Get_Size(top_values) == 2
+              && Str_Equals(SSTR_WRAP_C("c0"), Vec_Fetch(top_values, 0))
+              && Str_Equals(SSTR_WRAP_C("c1"), Vec_Fetch(top_values, 1)),
+              "num_buckets limits Top_Values");
+    DECREF(top_values);
+    DECREF(collector);
+}
+
+static void
+test_numeric(TestBatchRunner *runner, IndexSearcher *searcher) {
+    double   sum         = 0.0;
+    uint32_t num_matches = 0;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        if (!S_matches(n)) { continue; }
+        sum += n * 3;
+        num_matches++;
+    }
+
+    FacetCollector *collector = S_collect(searcher, "price", 10);
+    TEST_INT_EQ(runner, FacetColl_Get_Num_Values(collector), num_matches,
+                "Num_Values");
+    TEST_TRUE(runner, FacetColl_Get_Min(collector) == 3.0, "Min");
+    TEST_TRUE(runner, FacetColl_Get_Max(collector) == (NUM_DOCS - 1) * 3.0,
+              "Max");
+    TEST_TRUE(runner, FacetColl_Get_Sum(collector) == sum, "Sum");
+
+    Integer *price = Int_new(9);
+    TEST_INT_EQ(runner, FacetColl_Get_Count(collector, (Obj*)price), 1,
+                "Numeric values are counted too");
+    DECREF(price);
+    DECREF(collector);
+}
+
+void
+TestFacetCollector_Run_IMP(TestFacetCollector *self,
+                           TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 10);
+    Schema    *schema = S_create_schema();
+    RAMFolder *folder = RAMFolder_new(NULL);
+
+    // Two segments, so that counts have to be merged.
+    S_add_docs(folder, schema, 1, NUM_DOCS / 2);
+    S_add_docs(folder, schema, NUM_DOCS / 2 + 1, NUM_DOCS);
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+
+    test_counts(runner, searcher);
+    test_numeric(runner, searcher);
+
+    DECREF(searcher);
+    DECREF(folder);
+    DECREF(schema);
+}
+
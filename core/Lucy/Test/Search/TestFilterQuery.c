@@ -0,0 +1,265 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/TestUtils.h"
+#include "Lucy/Test/Search/TestFilterQuery.h"
+#include "Lucy/Analysis/StandardTokenizer.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Object/I32Array.h"
+#include "Lucy/Plan/FullTextType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/ANDQuery.h"
+#include "Lucy/Search/FilterCache.h"
+#include "Lucy/Search/FilterQuery.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/LeafQuery.h"
+#include "Lucy/Search/MatchDoc.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Search/TopDocs.h"
+#include "Lucy/Store/RAMFolder.h"
+#include "Lucy/Util/Freezer.h"
+
+#define NUM_DOCS 1000
+
+TestFilterQuery*
+TestFilterQuery_new() {
+    return (TestFilterQuery*)Class_Make_Obj(TESTFILTERQUERY);
+}
+
+static void
+test_Dump_Load_and_Equals(TestBatchRunner *runner) {
+    Query       *a_leaf      = (Query*)TestUtils_make_leaf_query(NULL, "a");
+    Query       *b_leaf      = (Query*)TestUtils_make_leaf_query(NULL, "b");
+    FilterQuery *query       = FilterQuery_new(a_leaf);
+    FilterQuery *kids_differ = FilterQuery_new(b_leaf);
+    Obj         *dump        = (Obj*)FilterQuery_Dump(query);
+    FilterQuery *clone       = (FilterQuery*)Freezer_load(dump);
+
+    TEST_FALSE(runner, FilterQuery_Equals(query, (Obj*)kids_differ),
+               "Different kids spoil Equals");
+    TEST_TRUE(runner, FilterQuery_Equals(query, (Obj*)clone),
+              "Dump => Load round trip");
+    TEST_TRUE(runner, FilterQuery_Get_Boost(query) == 0.0f,
+              "Filters don't contribute to scores");
+
+    DECREF(a_leaf);
+    DECREF(b_leaf);
+    DECREF(query);
+    DECREF(kids_differ);
+    DECREF(dump);
+    DECREF(clone);
+}
+
+static void
+test_lru(TestBatchRunner *runner) {
+    Query *queries[3];
+    Obj   *doc_sets[3];
+    for (int i = 0; i < 3; i++) {
+        char term[2] = { (char)('a' + i), '\0' };
+        queries[i]  = (Query*)TestUtils_make_leaf_query(NULL, term);
+        doc_sets[i] = (Obj*)I32Arr_new_blank(16);
+    }
+
+    // Each entry takes 64 bytes of ids plus 64 of overhead, so two fit.
+    FilterCache *cache = FilterCache_new(300);
+    FilterCache_Store(cache, queries[0], doc_sets[0]);
+    FilterCache_Store(cache, queries[1], doc_sets[1]);
+    Query *equal_query = (Query*)TestUtils_make_leaf_query(NULL, "a");
+    TEST_TRUE(runner, FilterCache_Fetch(cache, equal_query) == doc_sets[0],
+              "Fetch with an equal query");
+    FilterCache_Store(cache, queries[2], doc_sets[2]);
+    TEST_TRUE(runner, FilterCache_Fetch(cache, queries[1]) == NULL
+                      && FilterCache_Fetch(cache, queries[0]) != NULL
+                      && FilterCache_Fetch(cache, queries[2]) != NULL,
+              "Least recently used entry evicted");
+    TEST_INT_EQ(runner, FilterCache_Get_Size(cache), 2, "Get_Size");
+    TEST_INT_EQ(runner, FilterCache_Get_Consumed(cache), 256,
+                "Get_Consumed");
+
+    Query_Set_Boost(queries[0], 2.0f);
+    TEST_TRUE(runner, FilterCache_Fetch(cache, equal_query) == doc_sets[0]
+                      && FilterCache_Fetch(cache, queries[0]) == NULL,
+              "Changing a stored query leaves its entry alone");
+
+    I32Array *huge = I32Arr_new_blank(1000);
+    FilterCache_Store(cache, queries[1], (Obj*)huge);
+    TEST_TRUE(runner, FilterCache_Fetch(cache, queries[1]) == NULL
+                      && FilterCache_Get_Size(cache) == 2,
+              "Sets over the budget aren't stored");
+
+    DECREF(huge);
+    DECREF(equal_query);
+    DECREF(cache);
+    for (int i = 0; i < 3; i++) {
+        DECREF(queries[i]);
+        DECREF(doc_sets[i]);
+    }
+}
+
+static Schema*
+S_create_schema() {
+    Schema *schema = Schema_new();
+    StandardTokenizer *tokenizer = StandardTokenizer_new();
+    FullTextType *content_type = FullTextType_new((Analyzer*)tokenizer);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("content"),
+                      (FieldType*)content_type);
+    StringType *category_type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("category"),
+                      (FieldType*)category_type);
+    DECREF(category_type);
+    DECREF(content_type);
+    DECREF(tokenizer);
+    return schema;
+}
+
+// Every doc contains "x", even docs contain "y" a varying number of times,
+// and each doc has one of four categories.  Every hundredth doc is "rare".
+static RAMFolder*
+S_create_index(Schema *schema) {
+    RAMFolder *folder  = RAMFolder_new(NULL);
+    Indexer   *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        Doc    *doc      = Doc_new(NULL, 0);
+        String *content  = Str_newf("x%s%s", n % 2 ? "" : " y",
+                                    n % 3 ? "" : " y y");
+        String *category = n % 100 == 0
+                           ? Str_newf("rare")
+                           : Str_newf("c%i32", n % 4);
+        Doc_Store(doc, SSTR_WRAP_C("content"), (Obj*)content);
+        Doc_Store(doc, SSTR_WRAP_C("category"), (Obj*)category);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(category);
+        DECREF(content);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    return folder;
+}
+
+static ANDQuery*
+S_filtered(Query *scoring, const char *category) {
+    Query *term = (Query*)TestUtils_make_term_query("category", category);
+    FilterQuery *filter = FilterQuery_new(term);
+    Vector *children = Vec_new(2);
+    Vec_Push(children, INCREF(scoring));
+    Vec_Push(children, (Obj*)filter);
+    ANDQuery *and_query = ANDQuery_new(children);
+    DECREF(children);
+    DECREF(term);
+    return and_query;
+}
+
+// Check that the filtered results are the unfiltered results which are in
+// the category, with the same scores.
+static bool
+S_check_filtered(IndexSearcher *searcher, Query *scoring,
+                 const char *category, uint32_t expected) {
+    ANDQuery *filtered = S_filtered(scoring, category);
+    TopDocs  *all      = IxSearcher_Top_Docs(searcher, scoring, NUM_DOCS,
+                                             NULL);
+    TopDocs  *some     = IxSearcher_Top_Docs(searcher, (Query*)filtered,
+                                             NUM_DOCS, NULL);
+    float    *scores   = (float*)CALLOCATE(NUM_DOCS + 1, sizeof(float));
+    Vector   *all_docs = TopDocs_Get_Match_Docs(all);
+    for (size_t i = 0, max = Vec_Get_Size(all_docs); i < max; i++) {
+        MatchDoc *match_doc = (MatchDoc*)Vec_Fetch(all_docs, i);
+        scores[MatchDoc_Get_Doc_ID(match_doc)]
+            = MatchDoc_Get_Score(match_doc);
+    }
+
+    Vector *some_docs = TopDocs_Get_Match_Docs(some);
+    bool    ok        = Vec_Get_Size(some_docs) == expected;
+    for (size_t i = 0, max = Vec_Get_Size(some_docs); i < max; i++) {
+        MatchDoc *match_doc = (MatchDoc*)Vec_Fetch(some_docs, i);
+        int32_t doc_id = MatchDoc_Get_Doc_ID(match_doc);
+        bool in_category = doc_id % 100 == 0
+                           ? strcmp(category, "rare") == 0
+                           : category[0] == 'c'
+                             && category[1] - '0' == doc_id % 4;
+        if (!in_category || scores[doc_id] != MatchDoc_Get_Score(match_doc)) {
+            ok = false;
+        }
+    }
+
+    FREEMEM(scores);
+    DECREF(some);
+    DECREF(all);
+    DECREF(filtered);
+    return ok;
+}
+
+static void
+test_search(TestBatchRunner *runner) {
+    Schema        *schema   = S_create_schema();
+    RAMFolder     *folder   = S_create_index(schema);
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    IndexReader   *reader   = IxSearcher_Get_Reader(searcher);
+    Vector        *seg_readers = IxReader_Seg_Readers(reader);
+    SegReader     *seg_reader  = (SegReader*)Vec_Fetch(seg_readers, 0);
+    FilterCache   *cache = SegReader_Get_Filter_Cache(seg_reader);
+    Query         *y     = (Query*)TestUtils_make_term_query("content", "y");
+
+    // Even docs which are 2 mod 4, other than the multiples of 100.
+    TEST_TRUE(runner, S_check_filtered(searcher, y, "c2", 250),
+              "Filtered results keep their scores");
+    TEST_INT_EQ(runner, FilterCache_Get_Size(cache), 1,
+                "Filter matches were cached");
+    Query *c2 = (Query*)TestUtils_make_term_query("category", "c2");
+    TEST_TRUE(runner, Obj_is_a(FilterCache_Fetch(cache, c2), BITVECTOR),
+              "Dense set cached as a BitVector");
+
+    TEST_TRUE(runner, S_check_filtered(searcher, y, "c2", 250),
+              "Results from the cache");
+    TEST_INT_EQ(runner, FilterCache_Get_Size(cache), 1,
+                "An equal filter reuses the cached entry");
+
+    TEST_TRUE(runner, S_check_filtered(searcher, y, "rare", 10),
+              "Sparse filter");
+    Query *rare = (Query*)TestUtils_make_term_query("category", "rare");
+    TEST_TRUE(runner, Obj_is_a(FilterCache_Fetch(cache, rare), I32ARRAY),
+              "Sparse set cached as an I32Array");
+
+    TEST_TRUE(runner, S_check_filtered(searcher, y, "nope", 0),
+              "Filter which matches nothing");
+
+    DECREF(rare);
+    DECREF(c2);
+    DECREF(y);
+    DECREF(seg_readers);
+    DECREF(searcher);
+    DECREF(folder);
+    DECREF(schema);
+}
+
+void
+TestFilterQuery_Run_IMP(TestFilterQuery *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 17);
+    test_Dump_Load_and_Equals(runner);
+    test_lru(runner);
+    test_search(runner);
+}
+
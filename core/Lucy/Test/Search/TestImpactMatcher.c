@@ -0,0 +1,232 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/TestUtils.h"
+#include "Lucy/Test/Search/TestImpactMatcher.h"
+#include "Lucy/Analysis/StandardTokenizer.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Plan/FullTextType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/Compiler.h"
+#include "Lucy/Search/ImpactMatcher.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/MatchDoc.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Search/TopDocs.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_DOCS   300
+#define NUM_WANTED 10
+
+TestImpactMatcher*
+TestImpactMatcher_new() {
+    return (TestImpactMatcher*)Class_Make_Obj(TESTIMPACTMATCHER);
+}
+
+static void
+S_append_words(CharBuf *buf, const char *word, int32_t count) {
+    for (int32_t i = 0; i < count; i++) {
+        CB_catf(buf, "%s ", word);
+    }
+}
+
+static Schema*
+S_create_schema(bool impact_ordered) {
+    Schema *schema = Schema_new();
+    StandardTokenizer *tokenizer = StandardTokenizer_new();
+    FullTextType *content_type = FullTextType_new((Analyzer*)tokenizer);
+    FullTextType_Set_Impact_Ordered(content_type, impact_ordered);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("content"),
+                      (FieldType*)content_type);
+    StringType *id_type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("id"), (FieldType*)id_type);
+    DECREF(id_type);
+    DECREF(content_type);
+    DECREF(tokenizer);
+    return schema;
+}
+
+// Vary the freq of "x" and the field length from doc to doc, so that
+// impact order is far from doc id order.  "gamma" is too rare to get an
+// impact-ordered list.
+static RAMFolder*
+S_create_index(bool impact_ordered) {
+    Schema    *schema  = S_create_schema(impact_ordered);
+    RAMFolder *folder  = RAMFolder_new(NULL);
+    Indexer   *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        CharBuf *buf = CB_new(0);
+        S_append_words(buf, "x", (n * 7) % 11 + 1);
+        S_append_words(buf, "filler", n % 13);
+        if (n % 31 == 0) { S_append_words(buf, "gamma", 1); }
+        String *content = CB_Yield_String(buf);
+        String *id      = Str_newf("%i32", n);
+        Doc *doc = Doc_new(NULL, 0);
+        Doc_Store(doc, SSTR_WRAP_C("content"), (Obj*)content);
+        Doc_Store(doc, SSTR_WRAP_C("id"), (Obj*)id);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(doc);
+        DECREF(id);
+        DECREF(content);
+        DECREF(buf);
+    }
+
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    DECREF(schema);
+    return folder;
+}
+
+static void
+S_delete_every_fifth(RAMFolder *folder) {
+    Indexer *indexer = Indexer_new(NULL, (Obj*)folder, NULL, 0);
+    for (int32_t n = 5; n <= NUM_DOCS; n += 5) {
+        String *id = Str_newf("%i32", n);
+        Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("id"), (Obj*)id);
+        DECREF(id);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static Matcher*
+S_make_matcher(IndexSearcher *searcher, Query *query, bool need_score) {
+    IndexReader *reader = IxSearcher_Get_Reader(searcher);
+    Vector *seg_readers = IxReader_Seg_Readers(reader);
+    SegReader *seg_reader = (SegReader*)Vec_Fetch(seg_readers, 0);
+    Compiler *compiler = Query_Make_Compiler(query, (Searcher*)searcher,
+                                             Query_Get_Boost(query), false);
+    Matcher *matcher = Compiler_Make_Matcher(compiler, seg_reader,
+                                             need_score);
+    DECREF(compiler);
+    DECREF(seg_readers);
+    return matcher;
+}
+
+static void
+test_Make_Matcher(TestBatchRunner *runner, IndexSearcher *plain,
+                  IndexSearcher *ordered) {
+    Query *x     = (Query*)TestUtils_make_term_query("content", "x");
+    Query *gamma = (Query*)TestUtils_make_term_query("content", "gamma");
+
+    Matcher *matcher = S_make_matcher(ordered, x, true);
+    TEST_TRUE(runner, Obj_is_a((Obj*)matcher, IMPACTMATCHER),
+              "Scoring a long list uses ImpactMatcher");
+    DECREF(matcher);
+
+    matcher = S_make_matcher(ordered, x, false);
+    TEST_FALSE(runner, Obj_is_a((Obj*)matcher, IMPACTMATCHER),
+               "Match-only search doesn't");
+    DECREF(matcher);
+
+    matcher = S_make_matcher(ordered, gamma, true);
+    TEST_FALSE(runner, Obj_is_a((Obj*)matcher, IMPACTMATCHER),
+               "Short lists have no impact-ordered copy");
+    DECREF(matcher);
+
+    matcher = S_make_matcher(plain, x, true);
+    TEST_FALSE(runner, Obj_is_a((Obj*)matcher, IMPACTMATCHER),
+               "Fields without impact_ordered don't");
+    DECREF(matcher);
+
+    DECREF(gamma);
+    DECREF(x);
+}
+
+static bool
+S_same_top_docs(TopDocs *a, TopDocs *b) {
+    Vector *a_docs = TopDocs_Get_Match_Docs(a);
+    Vector *b_docs = TopDocs_Get_Match_Docs(b);
+    size_t  size   = Vec_Get_Size(a_docs);
+    if (size != NUM_WANTED || Vec_Get_Size(b_docs) != size) { return false; }
+    for (size_t i = 0; i < size; i++) {
+        MatchDoc *a_doc = (MatchDoc*)Vec_Fetch(a_docs, i);
+        MatchDoc *b_doc = (MatchDoc*)Vec_Fetch(b_docs, i);
+        if (MatchDoc_Get_Doc_ID(a_doc) != MatchDoc_Get_Doc_ID(b_doc)
+            || MatchDoc_Get_Score(a_doc) != MatchDoc_Get_Score(b_doc)
+           ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+test_search(TestBatchRunner *runner, IndexSearcher *plain,
+            IndexSearcher *ordered, uint32_t num_matches,
+            const char *label) {
+    Query   *x        = (Query*)TestUtils_make_term_query("content", "x");
+    TopDocs *expected = IxSearcher_Top_Docs(plain, x, NUM_WANTED, NULL);
+    TopDocs *exact    = IxSearcher_Top_Docs(ordered, x, NUM_WANTED, NULL);
+
+    TEST_TRUE(runner, S_same_top_docs(expected, exact),
+              "%s: same top docs and scores", label);
+    TEST_INT_EQ(runner, TopDocs_Get_Total_Hits(exact), num_matches,
+                "%s: without a threshold, every match is counted", label);
+
+    IxSearcher_Set_Total_Hits_Threshold(ordered, NUM_WANTED);
+    TopDocs *pruned = IxSearcher_Top_Docs(ordered, x, NUM_WANTED, NULL);
+    IxSearcher_Set_Total_Hits_Threshold(ordered, UINT32_MAX);
+
+    TEST_TRUE(runner, S_same_top_docs(expected, pruned),
+              "%s: early termination keeps the top docs", label);
+    uint32_t pruned_hits = TopDocs_Get_Total_Hits(pruned);
+    TEST_TRUE(runner, pruned_hits >= NUM_WANTED && pruned_hits < num_matches,
+              "%s: stopped early (%u32 of %u32 visited)", label,
+              pruned_hits, num_matches);
+
+    DECREF(pruned);
+    DECREF(exact);
+    DECREF(expected);
+    DECREF(x);
+}
+
+void
+TestImpactMatcher_Run_IMP(TestImpactMatcher *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 12);
+    RAMFolder     *plain_folder   = S_create_index(false);
+    RAMFolder     *ordered_folder = S_create_index(true);
+    IndexSearcher *plain   = IxSearcher_new((Obj*)plain_folder);
+    IndexSearcher *ordered = IxSearcher_new((Obj*)ordered_folder);
+
+    test_Make_Matcher(runner, plain, ordered);
+    test_search(runner, plain, ordered, NUM_DOCS, "No deletions");
+    DECREF(plain);
+    DECREF(ordered);
+
+    S_delete_every_fifth(plain_folder);
+    S_delete_every_fifth(ordered_folder);
+    plain   = IxSearcher_new((Obj*)plain_folder);
+    ordered = IxSearcher_new((Obj*)ordered_folder);
+    test_search(runner, plain, ordered, NUM_DOCS - NUM_DOCS / 5,
+                "Deletions");
+
+    DECREF(plain);
+    DECREF(ordered);
+    DECREF(plain_folder);
+    DECREF(ordered_folder);
+}
+
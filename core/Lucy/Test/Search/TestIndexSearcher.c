@@ -0,0 +1,147 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Search/TestIndexSearcher.h"
+#include "Lucy/Test/TestSchema.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/MatchDoc.h"
+#include "Lucy/Search/ORQuery.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Search/TopDocs.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_SEGMENTS     4
+#define DOCS_PER_SEGMENT 60
+#define NUM_WANTED       10
+
+TestIndexSearcher*
+TestIxSearcher_new() {
+    return (TestIndexSearcher*)Class_Make_Obj(TESTINDEXSEARCHER);
+}
+
+// Index each batch of docs in a separate session, so that the index ends up
+// with several segments.
+static RAMFolder*
+S_create_index() {
+    TestSchema *schema = TestSchema_new(false);
+    RAMFolder  *folder = RAMFolder_new(NULL);
+    String     *field  = SSTR_WRAP_C("content");
+    int32_t     n      = 0;
+
+    for (int32_t seg = 0; seg < NUM_SEGMENTS; seg++) {
+        Indexer *indexer
+            = Indexer_new((Schema*)schema, (Obj*)folder, NULL, 0);
+        for (int32_t i = 0; i < DOCS_PER_SEGMENT; i++) {
+            n++;
+            String *content
+                = Str_newf("%s %s %s x",
+                           n % 2 == 0 ? "alpha" : "",
+                           n % 3 == 0 ? "beta beta" : "",
+                           n % 5 == 0 ? "x x x" : "");
+            Doc *doc = Doc_new(NULL, 0);
+            Doc_Store(doc, field, (Obj*)content);
+            Indexer_Add_Doc(indexer, doc, 1.0f);
+            DECREF(doc);
+            DECREF(content);
+        }
+        Indexer_Commit(indexer);
+        DECREF(indexer);
+    }
+
+    DECREF(schema);
+    return folder;
+}
+
+static Query*
+S_make_query() {
+    String *field = SSTR_WRAP_C("content");
+    Vector *children = Vec_new(2);
+    Vec_Push(children, (Obj*)TermQuery_new(field,
+                                           (Obj*)SSTR_WRAP_C("alpha")));
+    Vec_Push(children, (Obj*)TermQuery_new(field,
+                                           (Obj*)SSTR_WRAP_C("beta")));
+    ORQuery *query = ORQuery_new(children);
+    DECREF(children);
+    return (Query*)query;
+}
+
+static bool
+S_same_match_docs(TopDocs *a, TopDocs *b) {
+    Vector *a_docs = TopDocs_Get_Match_Docs(a);
+    Vector *b_docs = TopDocs_Get_Match_Docs(b);
+    size_t  size   = Vec_Get_Size(a_docs);
+    if (size != NUM_WANTED || Vec_Get_Size(b_docs) != size) { return false; }
+    for (size_t i = 0; i < size; i++) {
+        MatchDoc *a_doc = (MatchDoc*)Vec_Fetch(a_docs, i);
+        MatchDoc *b_doc = (MatchDoc*)Vec_Fetch(b_docs, i);
+        if (MatchDoc_Get_Doc_ID(a_doc) != MatchDoc_Get_Doc_ID(b_doc)
+            || MatchDoc_Get_Score(a_doc) != MatchDoc_Get_Score(b_doc)
+           ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+test_parallel_Top_Docs(TestBatchRunner *runner) {
+    RAMFolder     *folder   = S_create_index();
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    Query         *query    = S_make_query();
+
+    TEST_INT_EQ(runner, IxSearcher_Get_Num_Threads(searcher), 1,
+                "Searches run on one thread by default");
+
+    TopDocs *serial = IxSearcher_Top_Docs(searcher, query, NUM_WANTED, NULL);
+
+    IxSearcher_Set_Num_Threads(searcher, NUM_SEGMENTS);
+    TEST_INT_EQ(runner, IxSearcher_Get_Num_Threads(searcher), NUM_SEGMENTS,
+                "Set_Num_Threads");
+    TopDocs *parallel
+        = IxSearcher_Top_Docs(searcher, query, NUM_WANTED, NULL);
+    TEST_INT_EQ(runner, TopDocs_Get_Total_Hits(parallel),
+                TopDocs_Get_Total_Hits(serial),
+                "Parallel search counts the same total hits");
+    TEST_TRUE(runner, S_same_match_docs(serial, parallel),
+              "Parallel search returns the same top docs");
+
+    IxSearcher_Set_Total_Hits_Threshold(searcher, NUM_WANTED);
+    TopDocs *pruned = IxSearcher_Top_Docs(searcher, query, NUM_WANTED, NULL);
+    TEST_TRUE(runner, S_same_match_docs(serial, pruned),
+              "Parallel search with pruning returns the same top docs");
+
+    DECREF(pruned);
+    DECREF(parallel);
+    DECREF(serial);
+    DECREF(query);
+    DECREF(searcher);
+    DECREF(folder);
+}
+
+void
+TestIxSearcher_Run_IMP(TestIndexSearcher *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 5);
+    test_parallel_Top_Docs(runner);
+}
+
+
@@ -0,0 +1,420 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+#include <string.h>
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Search/TestMultiTermQuery.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Document/HitDoc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/Collector.h"
+#include "Lucy/Search/FuzzyQuery.h"
+#include "Lucy/Search/Hits.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/ORQuery.h"
+#include "Lucy/Search/PrefixQuery.h"
+#include "Lucy/Search/TermAutomaton.h"
+#include "Lucy/Search/WildcardQuery.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Store/RAMFile.h"
+#include "Lucy/Store/RAMFolder.h"
+#include "Lucy/Util/Freezer.h"
+
+#define NUM_DOCS  1000
+#define FIRST_SEG 600
+#define WORD_MAX  8
+
+typedef char Word[WORD_MAX];
+
+TestMultiTermQuery*
+TestMultiTermQuery_new() {
+    return (TestMultiTermQuery*)Class_Make_Obj(TESTMULTITERMQUERY);
+}
+
+static bool
+S_wildcard_match(const char *pattern, const char *word) {
+    if (!*pattern)       { return !*word; }
+    if (*pattern == '*') {
+        return S_wildcard_match(pattern + 1, word)
+               || (*word && S_wildcard_match(pattern, word + 1));
+    }
+    if (!*word) { return false; }
+    if (*pattern == '?' || *pattern == *word) {
+        return S_wildcard_match(pattern + 1, word + 1);
+    }
+    return false;
+}
+
+static int
+S_distance(const char *a, const char *b) {
+    int len_a = (int)strlen(a);
+    int len_b = (int)strlen(b);
+    int table[WORD_MAX + 1][WORD_MAX + 1];
+    for (int i = 0; i <= len_a; i++) { table[i][0] = i; }
+    for (int j = 0; j <= len_b; j++) { table[0][j] = j; }
+    for (int i = 1; i <= len_a; i++) {
+        for (int j = 1; j <= len_b; j++) {
+            int best = table[i - 1][j - 1] + (a[i - 1] != b[j - 1]);
+            if (table[i - 1][j] + 1 < best) { best = table[i - 1][j] + 1; }
+            if (table[i][j - 1] + 1 < best) { best = table[i][j - 1] + 1; }
+            table[i][j] = best;
+        }
+    }
+    return table[len_a][len_b];
+}
+
+static void
+S_fill_words(Word *words) {
+    uint64_t state = 7;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        state = state * UINT64_C(6364136223846793005)
+                + UINT64_C(1442695040888963407);
+        uint64_t bits = state >> 20;
+        size_t   len  = 1 + (size_t)(bits % (WORD_MAX - 2));
+        bits /= WORD_MAX - 2;
+        for (size_t i = 0; i < len; i++) {
+            words[n][i] = "abcdef"[bits % 6];
+            bits /= 6;
+        }
+        words[n][len] = '\0';
+    }
+}
+
+static void
+S_add_docs(Schema *schema, RAMFolder *folder, Word *words, int32_t first,
+           int32_t last) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = first; n <= last; n++) {
+        Doc    *doc  = Doc_new(NULL, 0);
+        String *word = Str_newf("%s", words[n]);
+        Doc_Store(doc, SSTR_WRAP_C("word"), (Obj*)word);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(word);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static BitVector*
+S_collect(IndexSearcher *searcher, Query *query) {
+    int32_t    doc_max = IxSearcher_Doc_Max(searcher);
+    BitVector *bit_vec = BitVec_new((size_t)doc_max + 1);
+    BitCollector *collector = BitColl_new(bit_vec);
+    IxSearcher_Collect(searcher, query, (Collector*)collector);
+    DECREF(collector);
+    return bit_vec;
+}
+
+typedef enum { PREFIX, WILDCARD, FUZZY } QueryKind;
+
+static bool
+S_expected(QueryKind kind, const char *text, uint32_t max_edits,
+           const char *word) {
+    switch (kind) {
+        case PREFIX:   return strncmp(word, text, strlen(text)) == 0;
+        case WILDCARD: return S_wildcard_match(text, word);
+        default:       return S_distance(text, word) <= (int)max_edits;
+    }
+}
+
+static MultiTermQuery*
+S_make_query(QueryKind kind, const char *text, uint32_t max_edits,
+             int32_t rewrite) {
+    String *field = SSTR_WRAP_C("word");
+    String *term  = SSTR_WRAP_C(text);
+    switch (kind) {
+        case PREFIX:
+            return (MultiTermQuery*)PrefixQuery_new(field, term, 10000,
+                                                    rewrite);
+        case WILDCARD:
+            return (MultiTermQuery*)WildcardQuery_new(field, term, 10000,
+                                                      rewrite);
+        default:
+            return (MultiTermQuery*)FuzzyQuery_new(field, term, max_edits, 0,
+                                                   10000, rewrite);
+    }
+}
+
+// Compare a query's matches in both rewrite modes against a scan of the
+// words.
+static bool
+S_check(IndexSearcher *searcher, Word *words, QueryKind kind,
+        const char *text, uint32_t max_edits) {
+    BitVector *expected = BitVec_new(NUM_DOCS + 1);
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        if (S_expected(kind, text, max_edits, words[n])) {
+            BitVec_Set(expected, (size_t)n);
+        }
+    }
+
+    bool equal = true;
+    int32_t rewrites[2] = {
+        MultiTermQuery_CONSTANT_SCORE, MultiTermQuery_TOP_TERMS
+    };
+    for (int i = 0; i < 2; i++) {
+        MultiTermQuery *query = S_make_query(kind, text, max_edits,
+                                             rewrites[i]);
+        BitVector *got = S_collect(searcher, (Query*)query);
+        equal = equal && BitVec_Count(got) == BitVec_Count(expected);
+        BitVec_And(got, expected);
+        equal = equal && BitVec_Count(got) == BitVec_Count(expected);
+        DECREF(got);
+        DECREF(query);
+    }
+
+    DECREF(expected);
+    return equal;
+}
+
+static void
+test_automata(TestBatchRunner *runner) {
+    WildcardAutomaton *wildcard = WildcardAuto_new(SSTR_WRAP_C("fo?*ar"));
+    TEST_INT_EQ(runner, WildcardAuto_Run(wildcard, SSTR_WRAP_C("foobar")), 0,
+                "Wildcard accepts");
+    TEST_INT_EQ(runner, WildcardAuto_Run(wildcard, SSTR_WRAP_C("foar")), -1,
+                "Wildcard rejects");
+    String *target = WildcardAuto_Next_Target(wildcard, SSTR_WRAP_C("apple"));
+    TEST_TRUE(runner, Str_Equals_Utf8(target, "fo", 2),
+              "Next_Target skips to the literal prefix");
+    DECREF(target);
+    target = WildcardAuto_Next_Target(wildcard, SSTR_WRAP_C("fz"));
+    TEST_TRUE(runner, target == NULL, "Next_Target past every match");
+    DECREF(wildcard);
+
+    wildcard = WildcardAuto_new(SSTR_WRAP_C("a\\*b"));
+    TEST_INT_EQ(runner, WildcardAuto_Run(wildcard, SSTR_WRAP_C("a*b")), 0,
+                "Escaped star matches itself");
+    TEST_INT_EQ(runner, WildcardAuto_Run(wildcard, SSTR_WRAP_C("axb")), -1,
+                "Escaped star isn't a wildcard");
+    DECREF(wildcard);
+
+    LevenshteinAutomaton *lev = LevAuto_new(SSTR_WRAP_C("lucy"), 1, 0);
+    TEST_INT_EQ(runner, LevAuto_Run(lev, SSTR_WRAP_C("lucy")), 0,
+                "Levenshtein cost of exact match");
+    TEST_INT_EQ(runner, LevAuto_Run(lev, SSTR_WRAP_C("lacy")), 1,
+                "Levenshtein cost of substitution");
+    TEST_INT_EQ(runner, LevAuto_Run(lev, SSTR_WRAP_C("lucky")), 1,
+                "Levenshtein cost of insertion");
+    TEST_INT_EQ(runner, LevAuto_Run(lev, SSTR_WRAP_C("lack")), -1,
+                "Levenshtein rejects two edits");
+    DECREF(lev);
+
+    lev = LevAuto_new(SSTR_WRAP_C("lucy"), 1, 1);
+    target = LevAuto_Next_Target(lev, SSTR_WRAP_C("kz"));
+    TEST_TRUE(runner, target && Str_Equals_Utf8(target, "l", 1),
+              "Levenshtein Next_Target skips to the prefix");
+    DECREF(target);
+    target = LevAuto_Next_Target(lev, SSTR_WRAP_C("m"));
+    TEST_TRUE(runner, target == NULL, "Levenshtein Next_Target exhausted");
+    DECREF(target);
+    DECREF(lev);
+
+    lev = LevAuto_new(SSTR_WRAP_C("\xC3\xA9t\xC3\xA9"), 1, 1);
+    TEST_INT_EQ(runner, LevAuto_Run(lev, SSTR_WRAP_C("\xC3\xA9te")), 1,
+                "Levenshtein counts code points, not bytes");
+    TEST_INT_EQ(runner, LevAuto_Run(lev, SSTR_WRAP_C("et\xC3\xA9")), -1,
+                "prefix_length allows no edits in the prefix");
+    DECREF(lev);
+}
+
+static Obj*
+S_freeze_thaw(Obj *object) {
+    RAMFile *ram_file = RAMFile_new(NULL, false);
+    OutStream *outstream = OutStream_open((Obj*)ram_file);
+    FREEZE(object, outstream);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+
+    InStream *instream = InStream_open((Obj*)ram_file);
+    Obj *retval = THAW(instream);
+    DECREF(instream);
+    DECREF(ram_file);
+    return retval;
+}
+
+static void
+S_new_bad_fuzzy(void *context) {
+    UNUSED_VAR(context);
+    FuzzyQuery *query = FuzzyQuery_new(SSTR_WRAP_C("word"),
+                                       SSTR_WRAP_C("foo"), 3, 0, 50,
+                                       MultiTermQuery_TOP_TERMS);
+    DECREF(query);
+}
+
+static void
+test_Dump_Load_and_Equals(TestBatchRunner *runner) {
+    String *field = SSTR_WRAP_C("word");
+    PrefixQuery *prefix = PrefixQuery_new(field, SSTR_WRAP_C("ab"), 20,
+                                          MultiTermQuery_TOP_TERMS);
+    WildcardQuery *wildcard
+        = WildcardQuery_new(field, SSTR_WRAP_C("a*c"), 50,
+                            MultiTermQuery_CONSTANT_SCORE);
+    FuzzyQuery *fuzzy = FuzzyQuery_new(field, SSTR_WRAP_C("abc"), 1, 1, 50,
+                                       MultiTermQuery_TOP_TERMS);
+    PrefixQuery *other_prefix
+        = PrefixQuery_new(field, SSTR_WRAP_C("ab"), 20,
+                          MultiTermQuery_CONSTANT_SCORE);
+
+    Obj *dump = (Obj*)PrefixQuery_Dump(prefix);
+    PrefixQuery *prefix_clone = (PrefixQuery*)Freezer_load(dump);
+    TEST_TRUE(runner, PrefixQuery_Equals(prefix, (Obj*)prefix_clone),
+              "PrefixQuery Dump => Load round trip");
+    DECREF(prefix_clone);
+    DECREF(dump);
+
+    dump = (Obj*)FuzzyQuery_Dump(fuzzy);
+    FuzzyQuery *fuzzy_clone = (FuzzyQuery*)Freezer_load(dump);
+    TEST_TRUE(runner, FuzzyQuery_Equals(fuzzy, (Obj*)fuzzy_clone),
+              "FuzzyQuery Dump => Load round trip");
+    DECREF(fuzzy_clone);
+    DECREF(dump);
+
+    WildcardQuery *wildcard_clone
+        = (WildcardQuery*)S_freeze_thaw((Obj*)wildcard);
+    TEST_TRUE(runner, WildcardQuery_Equals(wildcard, (Obj*)wildcard_clone),
+              "WildcardQuery serialization round trip");
+    DECREF(wildcard_clone);
+
+    TEST_FALSE(runner, PrefixQuery_Equals(prefix, (Obj*)other_prefix),
+               "Equals() false with different rewrite");
+    TEST_FALSE(runner, PrefixQuery_Equals(prefix, (Obj*)wildcard),
+               "Equals() false against WildcardQuery");
+
+    String *string = FuzzyQuery_To_String(fuzzy);
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "word:abc~1", 10), "To_String");
+    DECREF(string);
+
+    Err *error = Err_trap(S_new_bad_fuzzy, NULL);
+    TEST_TRUE(runner, error != NULL, "max_edits over 2 throws");
+    DECREF(error);
+
+    DECREF(other_prefix);
+    DECREF(fuzzy);
+    DECREF(wildcard);
+    DECREF(prefix);
+}
+
+static void
+test_queries(TestBatchRunner *runner) {
+    Schema     *schema    = Schema_new();
+    StringType *word_type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("word"), (FieldType*)word_type);
+    DECREF(word_type);
+
+    RAMFolder *folder = RAMFolder_new(NULL);
+    Word      *words  = (Word*)MALLOCATE((NUM_DOCS + 1) * sizeof(Word));
+    S_fill_words(words);
+    S_add_docs(schema, folder, words, 1, FIRST_SEG);
+    S_add_docs(schema, folder, words, FIRST_SEG + 1, NUM_DOCS);
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+
+    TEST_TRUE(runner, S_check(searcher, words, PREFIX, "ab", 0),
+              "PrefixQuery");
+    TEST_TRUE(runner, S_check(searcher, words, PREFIX, "fff", 0),
+              "PrefixQuery at the end of the lexicon");
+    TEST_TRUE(runner, S_check(searcher, words, PREFIX, "z", 0),
+              "PrefixQuery without matches");
+    TEST_TRUE(runner, S_check(searcher, words, WILDCARD, "b?d*", 0),
+              "WildcardQuery");
+    TEST_TRUE(runner, S_check(searcher, words, WILDCARD, "*ce", 0),
+              "WildcardQuery with leading star");
+    TEST_TRUE(runner, S_check(searcher, words, WILDCARD, "a*b*c", 0),
+              "WildcardQuery with several stars");
+    TEST_TRUE(runner, S_check(searcher, words, FUZZY, "cafe", 1),
+              "FuzzyQuery with one edit");
+    TEST_TRUE(runner, S_check(searcher, words, FUZZY, "bead", 2),
+              "FuzzyQuery with two edits");
+
+    // CONSTANT_SCORE matches score the query's weight, so boosts count.
+    PrefixQuery *boosted = PrefixQuery_new(SSTR_WRAP_C("word"),
+                                           SSTR_WRAP_C("ab"), 50,
+                                           MultiTermQuery_CONSTANT_SCORE);
+    PrefixQuery_Set_Boost(boosted, 2.5f);
+    Hits   *boosted_hits = IxSearcher_Hits(searcher, (Obj*)boosted, 0, 10,
+                                           NULL);
+    HitDoc *boosted_hit  = Hits_Next(boosted_hits);
+    TEST_TRUE(runner, boosted_hit && HitDoc_Get_Score(boosted_hit) == 2.5f,
+              "Constant score honors the boost");
+    DECREF(boosted_hit);
+    DECREF(boosted_hits);
+    DECREF(boosted);
+
+    // The TOP_TERMS rewrite keeps only the most common terms.
+    PrefixQuery *capped = PrefixQuery_new(SSTR_WRAP_C("word"),
+                                          SSTR_WRAP_C("a"), 1,
+                                          MultiTermQuery_TOP_TERMS);
+    Query *rewritten
+        = PrefixQuery_Rewrite(capped, IxSearcher_Get_Reader(searcher));
+    TEST_TRUE(runner, Obj_is_a((Obj*)rewritten, ORQUERY)
+              && Vec_Get_Size(ORQuery_Get_Children((ORQuery*)rewritten)) == 1,
+              "Rewrite honors max_terms");
+    DECREF(rewritten);
+    DECREF(capped);
+
+    // Closer terms score higher.
+    Doc     *doc     = Doc_new(NULL, 0);
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    String  *far     = Str_newf("zzzzz");
+    String  *near    = Str_newf("zzzzy");
+    Doc_Store(doc, SSTR_WRAP_C("word"), (Obj*)far);
+    Indexer_Add_Doc(indexer, doc, 1.0f);
+    Doc_Store(doc, SSTR_WRAP_C("word"), (Obj*)near);
+    Indexer_Add_Doc(indexer, doc, 1.0f);
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    DECREF(near);
+    DECREF(far);
+    DECREF(doc);
+    DECREF(searcher);
+    searcher = IxSearcher_new((Obj*)folder);
+    FuzzyQuery *fuzzy = FuzzyQuery_new(SSTR_WRAP_C("word"),
+                                       SSTR_WRAP_C("zzzzy"), 1, 0, 50,
+                                       MultiTermQuery_TOP_TERMS);
+    Hits *hits = IxSearcher_Hits(searcher, (Obj*)fuzzy, 0, 10, NULL);
+    TEST_INT_EQ(runner, Hits_Total_Hits(hits), 2, "FuzzyQuery hit count");
+    HitDoc *hit  = Hits_Next(hits);
+    Obj    *word = hit ? HitDoc_Extract(hit, SSTR_WRAP_C("word")) : NULL;
+    TEST_TRUE(runner, word && Str_Equals_Utf8((String*)word, "zzzzy", 5),
+              "Exact match ranks first");
+    DECREF(word);
+    DECREF(hit);
+    DECREF(hits);
+    DECREF(fuzzy);
+
+    DECREF(searcher);
+    FREEMEM(words);
+    DECREF(folder);
+    DECREF(schema);
+}
+
+void
+TestMultiTermQuery_Run_IMP(TestMultiTermQuery *self,
+                           TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 33);
+    test_automata(runner);
+    test_Dump_Load_and_Equals(runner);
+    test_queries(runner);
+}
+
@@ -0,0 +1,428 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+#include <math.h>
+
+#include "Clownfish/Num.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Search/TestNumericRangeQuery.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Index/PointReader.h"
+#include "Lucy/Index/PointWriter.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Plan/Schema.h"
+#include "Lucy/Plan/StringType.h"
+#include "Lucy/Search/ANDQuery.h"
+#include "Lucy/Search/Collector.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/NumericRangeQuery.h"
+#include "Lucy/Store/RAMFolder.h"
+#include "Lucy/Util/Freezer.h"
+
+#define NUM_DOCS  3000
+#define FIRST_SEG 1800
+#define DELETED   5
+
+typedef struct {
+    int32_t i32[NUM_DOCS + 1];
+    int64_t i64[NUM_DOCS + 1];
+    double  f64[NUM_DOCS + 1];
+    bool    has_f64[NUM_DOCS + 1];
+} Corpus;
+
+typedef enum { I32_FIELD, I64_FIELD, F64_FIELD } FieldKind;
+
+TestNumericRangeQuery*
+TestNumericRangeQuery_new() {
+    return (TestNumericRangeQuery*)Class_Make_Obj(TESTNUMERICRANGEQUERY);
+}
+
+static Schema*
+S_create_schema() {
+    Schema *schema = Schema_new();
+
+    StringType *id_type = StringType_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("id"), (FieldType*)id_type);
+
+    Int32Type *i32_type = Int32Type_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("i32"), (FieldType*)i32_type);
+
+    Int64Type *i64_type = Int64Type_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("i64"), (FieldType*)i64_type);
+
+    Float64Type *f64_type = Float64Type_new();
+    Schema_Spec_Field(schema, SSTR_WRAP_C("f64"), (FieldType*)f64_type);
+
+    // Not indexed, so queries against it go through the sort cache.
+    Int32Type *sorted_type = Int32Type_new();
+    Int32Type_Set_Indexed(sorted_type, false);
+    Int32Type_Set_Sortable(sorted_type, true);
+    Schema_Spec_Field(schema, SSTR_WRAP_C("sorted"),
+                      (FieldType*)sorted_type);
+
+    DECREF(sorted_type);
+    DECREF(f64_type);
+    DECREF(i64_type);
+    DECREF(i32_type);
+    DECREF(id_type);
+    return schema;
+}
+
+static uint64_t
+S_next_rand(uint64_t *state) {
+    *state = *state * UINT64_C(6364136223846793005)
+             + UINT64_C(1442695040888963407);
+    return *state >> 16;
+}
+
+static void
+S_fill_corpus(Corpus *corpus) {
+    uint64_t state = 42;
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        // Lots of duplicates, so that runs of equal keys span blocks.
+        corpus->i32[n] = (int32_t)(S_next_rand(&state) % 1001) - 500;
+        corpus->i64[n] = (int64_t)(S_next_rand(&state) << 16) >> 20;
+        corpus->f64[n] = n % 11 == 0 ? -0.0 : corpus->i32[n] / 7.0;
+        corpus->has_f64[n] = n % 10 != 0;
+    }
+}
+
+static void
+S_add_docs(Schema *schema, RAMFolder *folder, Corpus *corpus,
+           int32_t first, int32_t last) {
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    for (int32_t n = first; n <= last; n++) {
+        Doc     *doc    = Doc_new(NULL, 0);
+        String  *id     = Str_newf("%i32", n);
+        Integer *i32    = Int_new(corpus->i32[n]);
+        Integer *i64    = Int_new(corpus->i64[n]);
+        Float   *f64    = Float_new(corpus->f64[n]);
+        Doc_Store(doc, SSTR_WRAP_C("id"), (Obj*)id);
+        Doc_Store(doc, SSTR_WRAP_C("i32"), (Obj*)i32);
+        Doc_Store(doc, SSTR_WRAP_C("i64"), (Obj*)i64);
+        Doc_Store(doc, SSTR_WRAP_C("sorted"), (Obj*)i32);
+        if (corpus->has_f64[n]) {
+            Doc_Store(doc, SSTR_WRAP_C("f64"), (Obj*)f64);
+        }
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(f64);
+        DECREF(i64);
+        DECREF(i32);
+        DECREF(id);
+        DECREF(doc);
+    }
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+}
+
+static bool
+S_in_range(double value, double lower, double upper, bool include_lower,
+           bool include_upper) {
+    if (include_lower ? value < lower : value <= lower) { return false; }
+    if (include_upper ? value > upper : value >= upper) { return false; }
+    return true;
+}
+
+// Run a NumericRangeQuery and compare its matches against a scan of the
+// corpus.  Once the segments have been merged, doc DELETED is gone and the
+// docs after it have moved down by one.
+static bool
+S_check_range(IndexSearcher *searcher, Corpus *corpus, FieldKind kind,
+              double lower, double upper, bool include_lower,
+              bool include_upper, bool merged) {
+    static const char *const field_names[] = { "i32", "i64", "f64" };
+    const char *field_name = field_names[kind];
+    Obj *lower_term = kind == F64_FIELD
+                      ? (Obj*)Float_new(lower)
+                      : (Obj*)Int_new((int64_t)lower);
+    Obj *upper_term = kind == F64_FIELD
+                      ? (Obj*)Float_new(upper)
+                      : (Obj*)Int_new((int64_t)upper);
+    NumericRangeQuery *query
+        = NumRangeQuery_new(SSTR_WRAP_C(field_name), lower_term, upper_term,
+                            include_lower, include_upper);
+
+    int32_t    doc_max  = IxSearcher_Doc_Max(searcher);
+    BitVector *got      = BitVec_new((size_t)doc_max + 1);
+    BitVector *expected = BitVec_new((size_t)doc_max + 1);
+    BitCollector *collector = BitColl_new(got);
+    IxSearcher_Collect(searcher, (Query*)query, (Collector*)collector);
+
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        if (merged && n == DELETED) { continue; }
+        double value;
+        switch (kind) {
+            case I32_FIELD: value = corpus->i32[n]; break;
+            case I64_FIELD: value = (double)corpus->i64[n]; break;
+            default:
+                if (!corpus->has_f64[n]) { continue; }
+                value = corpus->f64[n];
+        }
+        if (S_in_range(value, lower, upper, include_lower, include_upper)) {
+            BitVec_Set(expected, (size_t)(merged && n > DELETED ? n - 1 : n));
+        }
+    }
+
+    bool equal = BitVec_Count(got) == BitVec_Count(expected);
+    BitVec_And(got, expected);
+    equal = equal && BitVec_Count(got) == BitVec_Count(expected);
+
+    DECREF(collector);
+    DECREF(expected);
+    DECREF(got);
+    DECREF(query);
+    DECREF(upper_term);
+    DECREF(lower_term);
+    return equal;
+}
+
+static uint32_t
+S_count(IndexSearcher *searcher, Query *query) {
+    int32_t    doc_max   = IxSearcher_Doc_Max(searcher);
+    BitVector *bit_vec   = BitVec_new((size_t)doc_max + 1);
+    BitCollector *collector = BitColl_new(bit_vec);
+    IxSearcher_Collect(searcher, query, (Collector*)collector);
+    uint32_t count = (uint32_t)BitVec_Count(bit_vec);
+    DECREF(collector);
+    DECREF(bit_vec);
+    return count;
+}
+
+static void
+S_new_bad_query(void *context) {
+    NumericRangeQuery *query
+        = NumRangeQuery_new(SSTR_WRAP_C("i32"), (Obj*)context, NULL, true,
+                            true);
+    DECREF(query);
+}
+
+static void
+test_Dump_Load_and_Equals(TestBatchRunner *runner) {
+    Integer *one  = Int_new(1);
+    Float   *half = Float_new(0.5);
+    NumericRangeQuery *query
+        = NumRangeQuery_new(SSTR_WRAP_C("i32"), (Obj*)half, (Obj*)one, true,
+                            false);
+    RangeQuery *plain
+        = RangeQuery_new(SSTR_WRAP_C("i32"), (Obj*)half, (Obj*)one, true,
+                         false);
+    Obj *dump = (Obj*)NumRangeQuery_Dump(query);
+    NumericRangeQuery *clone = (NumericRangeQuery*)Freezer_load(dump);
+
+    TEST_TRUE(runner, NumRangeQuery_Equals(query, (Obj*)clone),
+              "Dump => Load round trip");
+    TEST_FALSE(runner, NumRangeQuery_Equals(query, (Obj*)plain),
+               "Equals() false against plain RangeQuery");
+
+    Err *error = Err_trap(S_new_bad_query, SSTR_WRAP_C("foo"));
+    TEST_TRUE(runner, error != NULL, "Non-numeric bound throws");
+    DECREF(error);
+
+    DECREF(clone);
+    DECREF(dump);
+    DECREF(plain);
+    DECREF(query);
+    DECREF(half);
+    DECREF(one);
+}
+
+static void
+S_test_ranges(TestBatchRunner *runner, IndexSearcher *searcher,
+              Corpus *corpus, bool merged) {
+    const char *suffix = merged ? " after merge" : "";
+    TEST_TRUE(runner, S_check_range(searcher, corpus, I32_FIELD, -100, 250,
+                                    true, true, merged),
+              "Int32 inclusive range%s", suffix);
+    TEST_TRUE(runner, S_check_range(searcher, corpus, I32_FIELD, -100, 250,
+                                    false, false, merged),
+              "Int32 exclusive range%s", suffix);
+    TEST_TRUE(runner, S_check_range(searcher, corpus, I32_FIELD, 17, 17,
+                                    true, true, merged),
+              "Int32 single value%s", suffix);
+    TEST_TRUE(runner, S_check_range(searcher, corpus, I64_FIELD,
+                                    -1099511627776.0, 2199023255552.0,
+                                    true, false, merged),
+              "Int64 range%s", suffix);
+    TEST_TRUE(runner, S_check_range(searcher, corpus, F64_FIELD, -10.5,
+                                    20.25, false, true, merged),
+              "Float64 range%s", suffix);
+    TEST_TRUE(runner, S_check_range(searcher, corpus, F64_FIELD, -3.0, 0.0,
+                                    true, false, merged),
+              "Float64 range excluding zero%s", suffix);
+    TEST_TRUE(runner, S_check_range(searcher, corpus, F64_FIELD, 0.0, 0.0,
+                                    true, true, merged),
+              "Negative zero matches zero%s", suffix);
+}
+
+static void
+test_ranges(TestBatchRunner *runner) {
+    Schema    *schema = S_create_schema();
+    RAMFolder *folder = RAMFolder_new(NULL);
+    Corpus    *corpus = (Corpus*)MALLOCATE(sizeof(Corpus));
+    S_fill_corpus(corpus);
+    S_add_docs(schema, folder, corpus, 1, FIRST_SEG);
+    S_add_docs(schema, folder, corpus, FIRST_SEG + 1, NUM_DOCS);
+
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    IndexReader   *reader   = IxSearcher_Get_Reader(searcher);
+    Vector        *seg_readers = IxReader_Seg_Readers(reader);
+    SegReader     *seg_reader  = (SegReader*)Vec_Fetch(seg_readers, 0);
+    PointReader   *point_reader = (PointReader*)SegReader_Fetch(
+                                      seg_reader,
+                                      Class_Get_Name(POINTREADER));
+    PointTree *tree = PointReader_Fetch_Tree(point_reader,
+                                             SSTR_WRAP_C("i32"));
+    TEST_INT_EQ(runner, tree ? PointTree_Num_Leaves(tree) : 0,
+                (FIRST_SEG + POINT_LEAF_SIZE - 1) / POINT_LEAF_SIZE,
+                "Points are cut into leaf blocks");
+    DECREF(seg_readers);
+
+    S_test_ranges(runner, searcher, corpus, false);
+
+    // Fractional bounds round inward on integer fields.
+    Float *lower = Float_new(-99.5);
+    Float *upper = Float_new(3.2);
+    NumericRangeQuery *fractional
+        = NumRangeQuery_new(SSTR_WRAP_C("i32"), (Obj*)lower, (Obj*)upper,
+                            false, false);
+    Integer *int_lower = Int_new(-99);
+    Integer *int_upper = Int_new(3);
+    NumericRangeQuery *whole
+        = NumRangeQuery_new(SSTR_WRAP_C("i32"), (Obj*)int_lower,
+                            (Obj*)int_upper, true, true);
+    TEST_INT_EQ(runner, S_count(searcher, (Query*)fractional),
+                S_count(searcher, (Query*)whole),
+                "Fractional bounds on an Int32 field");
+
+    // The sort cache handles fields which aren't indexed.
+    NumericRangeQuery *sorted
+        = NumRangeQuery_new(SSTR_WRAP_C("sorted"), (Obj*)int_lower,
+                            (Obj*)int_upper, true, true);
+    TEST_INT_EQ(runner, S_count(searcher, (Query*)sorted),
+                S_count(searcher, (Query*)whole),
+                "Sortable field without points");
+
+    // Combining two ranges exercises Advance().
+    Integer *big = Int_new(1000);
+    NumericRangeQuery *everything
+        = NumRangeQuery_new(SSTR_WRAP_C("i32"), NULL, (Obj*)big, true, true);
+    Vector *children = Vec_new(2);
+    Vec_Push(children, INCREF(whole));
+    Vec_Push(children, INCREF(everything));
+    ANDQuery *and_query = ANDQuery_new(children);
+    TEST_INT_EQ(runner, S_count(searcher, (Query*)and_query),
+                S_count(searcher, (Query*)whole),
+                "ANDQuery of two numeric ranges");
+
+    NumericRangeQuery *empty
+        = NumRangeQuery_new(SSTR_WRAP_C("i32"), (Obj*)int_upper,
+                            (Obj*)int_lower, true, true);
+    TEST_INT_EQ(runner, S_count(searcher, (Query*)empty), 0,
+                "Inverted bounds match nothing");
+
+    DECREF(empty);
+    DECREF(and_query);
+    DECREF(children);
+    DECREF(everything);
+    DECREF(big);
+    DECREF(sorted);
+    DECREF(whole);
+    DECREF(int_upper);
+    DECREF(int_lower);
+    DECREF(fractional);
+    DECREF(upper);
+    DECREF(lower);
+    DECREF(searcher);
+
+    // Delete a doc and merge everything into one segment.
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    String  *deleted = Str_newf("%i32", DELETED);
+    Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("id"), (Obj*)deleted);
+    Indexer_Optimize(indexer);
+    Indexer_Commit(indexer);
+    DECREF(deleted);
+    DECREF(indexer);
+
+    searcher = IxSearcher_new((Obj*)folder);
+    S_test_ranges(runner, searcher, corpus, true);
+    DECREF(searcher);
+
+    FREEMEM(corpus);
+    DECREF(folder);
+    DECREF(schema);
+}
+
+// With a tiny memory threshold, points get spilled to sorted runs and merged
+// back together both when indexing and when merging segments.
+static void
+test_spilled_points(TestBatchRunner *runner) {
+    Schema    *schema = S_create_schema();
+    RAMFolder *folder = RAMFolder_new(NULL);
+    Corpus    *corpus = (Corpus*)MALLOCATE(sizeof(Corpus));
+    S_fill_corpus(corpus);
+    PointWriter_set_default_mem_thresh(0x400);
+    S_add_docs(schema, folder, corpus, 1, NUM_DOCS);
+
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    IndexReader   *reader   = IxSearcher_Get_Reader(searcher);
+    Vector        *seg_readers = IxReader_Seg_Readers(reader);
+    SegReader     *seg_reader  = (SegReader*)Vec_Fetch(seg_readers, 0);
+    PointReader   *point_reader = (PointReader*)SegReader_Fetch(
+                                      seg_reader,
+                                      Class_Get_Name(POINTREADER));
+    PointTree *tree = PointReader_Fetch_Tree(point_reader,
+                                             SSTR_WRAP_C("i32"));
+    TEST_INT_EQ(runner, tree ? PointTree_Num_Leaves(tree) : 0,
+                (NUM_DOCS + POINT_LEAF_SIZE - 1) / POINT_LEAF_SIZE,
+                "Spilled points are cut into leaf blocks");
+    DECREF(seg_readers);
+    S_test_ranges(runner, searcher, corpus, false);
+    DECREF(searcher);
+
+    Indexer *indexer = Indexer_new(schema, (Obj*)folder, NULL, 0);
+    String  *deleted = Str_newf("%i32", DELETED);
+    Indexer_Delete_By_Term(indexer, SSTR_WRAP_C("id"), (Obj*)deleted);
+    Indexer_Optimize(indexer);
+    Indexer_Commit(indexer);
+    DECREF(deleted);
+    DECREF(indexer);
+
+    searcher = IxSearcher_new((Obj*)folder);
+    S_test_ranges(runner, searcher, corpus, true);
+    DECREF(searcher);
+
+    PointWriter_set_default_mem_thresh(0x400000);
+    FREEMEM(corpus);
+    DECREF(folder);
+    DECREF(schema);
+}
+
+void
+TestNumericRangeQuery_Run_IMP(TestNumericRangeQuery *self,
+                              TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 37);
+    test_Dump_Load_and_Equals(runner);
+    test_ranges(runner);
+    test_spilled_points(runner);
+}
+
@@ -18,12 +18,20 @@
 #define TESTLUCY_USE_SHORT_NAMES
 #include "Lucy/Util/ToolSet.h"
 #include <math.h>
+#include <string.h>
+#include <time.h>
 
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Lucy/Test.h"
 #include "Lucy/Test/TestUtils.h"
 #include "Lucy/Test/Search/TestRangeQuery.h"
 #include "Lucy/Search/RangeQuery.h"
+#include "Lucy/Search/RangeMatcher.h"
+#include "Lucy/Index/SortCache/NumericSortCache.h"
+#include "Lucy/Plan/NumericType.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/RAMFile.h"
+#include "Lucy/Util/NumberUtils.h"
 
 TestRangeQuery*
 TestRangeQuery_new() {
@@ -65,11 +73,126 @@ test_Dump_Load_and_Equals(TestBatchRunner *runner) {
     DECREF(clone);
 }
 
+// Build a SortCache over random ords of the given width.
+static SortCache*
+S_random_sort_cache(int32_t ord_width, bool native_ords, int32_t doc_max,
+                    int32_t max_ord) {
+    size_t   size  = ((size_t)(doc_max + 1) * (size_t)ord_width + 7) / 8;
+    uint8_t *bytes = (uint8_t*)MALLOCATE(size);
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t)rand();
+    }
+    if (ord_width == 32) {
+        // Keep the ords within the cardinality.
+        for (int32_t doc_id = 0; doc_id <= doc_max; doc_id++) {
+            uint32_t ord = (uint32_t)(rand() % (max_ord + 1));
+            if (native_ords) {
+                memcpy(bytes + doc_id * 4, &ord, 4);
+            }
+            else {
+                NumUtil_encode_bigend_u32(ord, bytes + doc_id * 4);
+            }
+        }
+    }
+
+    ByteBuf   *contents = BB_new_bytes(bytes, size);
+    RAMFile   *file     = RAMFile_new(contents, true);
+    InStream  *ord_in   = InStream_open((Obj*)file);
+    InStream  *dat_in   = InStream_open((Obj*)file);
+    Int32Type *type     = Int32Type_new();
+    Int32Type_Set_Sortable(type, true);
+    SortCache *sort_cache
+        = (SortCache*)I32SortCache_new(SSTR_WRAP_C("num"), (FieldType*)type,
+                                       max_ord + 1, doc_max, -1, ord_width,
+                                       ord_in, dat_in);
+    SortCache_Set_Native_Ords(sort_cache, native_ords);
+
+    DECREF(type);
+    DECREF(dat_in);
+    DECREF(ord_in);
+    DECREF(file);
+    DECREF(contents);
+    FREEMEM(bytes);
+    return sort_cache;
+}
+
+static bool
+S_in_range(SortCache *sort_cache, int32_t doc_id, int32_t lower,
+           int32_t upper) {
+    int32_t ord = SortCache_Ordinal(sort_cache, doc_id);
+    return ord >= lower && ord <= upper;
+}
+
+// Check that RangeMatcher's scan of the raw ords agrees with
+// SortCache_Ordinal, both when iterating and when skipping.
+static void
+S_test_ord_width(TestBatchRunner *runner, int32_t ord_width,
+                 bool native_ords) {
+    const int32_t doc_max = 5000;
+    const int32_t max_ord = ord_width == 32
+                            ? 100000
+                            : (1 << ord_width) - 1;
+    SortCache *sort_cache
+        = S_random_sort_cache(ord_width, native_ords, doc_max, max_ord);
+    int32_t lower = rand() % (max_ord + 1);
+    int32_t upper = lower + rand() % (max_ord + 1 - lower);
+
+    RangeMatcher *matcher
+        = RangeMatcher_new(lower, upper, sort_cache, doc_max);
+    bool    ok     = true;
+    int32_t doc_id = 0;
+    for (int32_t i = 1; i <= doc_max; i++) {
+        if (S_in_range(sort_cache, i, lower, upper)) {
+            doc_id = RangeMatcher_Next(matcher);
+            if (doc_id != i) { ok = false; }
+        }
+    }
+    if (RangeMatcher_Next(matcher) != 0) { ok = false; }
+    TEST_TRUE(runner, ok, "Next() with %d-bit%s ords", (int)ord_width,
+              ord_width > 8 ? (native_ords ? " native" : " big-endian") : "");
+    DECREF(matcher);
+
+    matcher = RangeMatcher_new(lower, upper, sort_cache, doc_max);
+    ok = true;
+    int32_t target = 1;
+    while (target <= doc_max) {
+        int32_t expected = target;
+        while (expected <= doc_max
+               && !S_in_range(sort_cache, expected, lower, upper)
+              ) {
+            expected++;
+        }
+        if (expected > doc_max) { expected = 0; }
+        doc_id = RangeMatcher_Advance(matcher, target);
+        if (doc_id != expected) { ok = false; }
+        if (doc_id == 0) { break; }
+        target = doc_id + 1 + rand() % 100;
+    }
+    TEST_TRUE(runner, ok, "Advance() with %d-bit%s ords", (int)ord_width,
+              ord_width > 8 ? (native_ords ? " native" : " big-endian") : "");
+    DECREF(matcher);
+
+    DECREF(sort_cache);
+}
+
+static void
+test_RangeMatcher(TestBatchRunner *runner) {
+    S_test_ord_width(runner, 1, false);
+    S_test_ord_width(runner, 2, false);
+    S_test_ord_width(runner, 4, false);
+    S_test_ord_width(runner, 8, false);
+    S_test_ord_width(runner, 16, false);
+    S_test_ord_width(runner, 16, true);
+    S_test_ord_width(runner, 32, false);
+    S_test_ord_width(runner, 32, true);
+}
 
 void
 TestRangeQuery_Run_IMP(TestRangeQuery *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 5);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 21);
+    srand((unsigned int)time((time_t*)NULL));
     test_Dump_Load_and_Equals(runner);
+    test_RangeMatcher(runner);
 }
 
 
@@ -532,12 +532,30 @@ test_sort_spec(TestBatchRunner *runner) {
               "random strings");
     DECREF(results);
 
+    // Fewer wanted than docs per segment, so that each segment's own top
+    // hits have to be merged.
+    results = S_test_sorted_search(searcher, random_str, 5,
+                                   name_str, false, NULL);
+    results2 = Vec_Slice(random_strings, 0, 5);
+    TEST_TRUE(runner, Vec_Equals(results, (Obj*)results2),
+              "top random strings across segments");
+    DECREF(results2);
+    DECREF(results);
+
     results = S_test_sorted_search(searcher, random_int32s_str, 100,
                                    int32_str, false, NULL);
     TEST_TRUE(runner, Vec_Equals(results, (Obj*)random_int32s),
               "int32");
     DECREF(results);
 
+    results = S_test_sorted_search(searcher, random_int32s_str, 5,
+                                   int32_str, false, NULL);
+    results2 = Vec_Slice(random_int32s, 0, 5);
+    TEST_TRUE(runner, Vec_Equals(results, (Obj*)results2),
+              "top int32s across segments");
+    DECREF(results2);
+    DECREF(results);
+
     results = S_test_sorted_search(searcher, random_int64s_str, 100,
                                    int64_str, false, NULL);
     TEST_TRUE(runner, Vec_Equals(results, (Obj*)random_int64s),
@@ -633,7 +651,7 @@ test_sort_spec(TestBatchRunner *runner) {
 
 void
 TestSortSpec_Run_IMP(TestSortSpec *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 18);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 20);
     S_init_strings();
     test_sort_spec(runner);
     S_destroy_strings();
@@ -0,0 +1,184 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Search/TestWANDScorer.h"
+#include "Lucy/Test/TestSchema.h"
+#include "Lucy/Document/Doc.h"
+#include "Lucy/Index/IndexReader.h"
+#include "Lucy/Index/Indexer.h"
+#include "Lucy/Index/SegReader.h"
+#include "Lucy/Object/BitVector.h"
+#include "Lucy/Search/Collector.h"
+#include "Lucy/Search/Compiler.h"
+#include "Lucy/Search/IndexSearcher.h"
+#include "Lucy/Search/MatchDoc.h"
+#include "Lucy/Search/ORMatcher.h"
+#include "Lucy/Search/ORQuery.h"
+#include "Lucy/Search/TermQuery.h"
+#include "Lucy/Search/TopDocs.h"
+#include "Lucy/Search/WANDScorer.h"
+#include "Lucy/Store/RAMFolder.h"
+
+#define NUM_DOCS   300
+#define NUM_WANTED 10
+
+TestWANDScorer*
+TestWANDScorer_new() {
+    return (TestWANDScorer*)Class_Make_Obj(TESTWANDSCORER);
+}
+
+static void
+S_append_words(CharBuf *buf, const char *word, int32_t count) {
+    for (int32_t i = 0; i < count; i++) {
+        CB_catf(buf, "%s ", word);
+    }
+}
+
+// Spread three terms over the docs with varying freqs and field lengths, so
+// that their scores vary from block to block.
+static RAMFolder*
+S_create_index() {
+    TestSchema *schema  = TestSchema_new(false);
+    RAMFolder  *folder  = RAMFolder_new(NULL);
+    Indexer    *indexer = Indexer_new((Schema*)schema, (Obj*)folder, NULL, 0);
+    String     *field   = SSTR_WRAP_C("content");
+
+    for (int32_t n = 1; n <= NUM_DOCS; n++) {
+        CharBuf *buf = CB_new(0);
+        if (n % 2 == 0) { S_append_words(buf, "alpha", (n % 4) + 1); }
+        if (n % 3 == 0) { S_append_words(buf, "beta", (n % 5) + 1); }
+        if (n % 7 == 0) { S_append_words(buf, "gamma", 1); }
+        S_append_words(buf, "x", (n % 9) + 1);
+        String *content = CB_Yield_String(buf);
+        Doc *doc = Doc_new(NULL, 0);
+        Doc_Store(doc, field, (Obj*)content);
+        Indexer_Add_Doc(indexer, doc, 1.0f);
+        DECREF(doc);
+        DECREF(content);
+        DECREF(buf);
+    }
+
+    Indexer_Commit(indexer);
+    DECREF(indexer);
+    DECREF(schema);
+    return folder;
+}
+
+static Query*
+S_make_query() {
+    String *field = SSTR_WRAP_C("content");
+    const char *terms[] = { "alpha", "beta", "gamma" };
+    Vector *children = Vec_new(3);
+    for (size_t i = 0; i < 3; i++) {
+        String *term = SSTR_WRAP_C(terms[i]);
+        Vec_Push(children, (Obj*)TermQuery_new(field, (Obj*)term));
+    }
+    ORQuery *query = ORQuery_new(children);
+    DECREF(children);
+    return (Query*)query;
+}
+
+static void
+test_Make_Matcher(TestBatchRunner *runner, IndexSearcher *searcher,
+                  Query *query) {
+    IndexReader *reader = IxSearcher_Get_Reader(searcher);
+    Vector *seg_readers = IxReader_Seg_Readers(reader);
+    SegReader *seg_reader = (SegReader*)Vec_Fetch(seg_readers, 0);
+    Compiler *compiler = Query_Make_Compiler(query, (Searcher*)searcher,
+                                             Query_Get_Boost(query), false);
+
+    Matcher *scorer = Compiler_Make_Matcher(compiler, seg_reader, true);
+    TEST_TRUE(runner, Obj_is_a((Obj*)scorer, WANDSCORER),
+              "Scoring OR of long posting lists uses WANDScorer");
+    Matcher *matcher = Compiler_Make_Matcher(compiler, seg_reader, false);
+    TEST_TRUE(runner, Obj_is_a((Obj*)matcher, ORMATCHER)
+                      && !Obj_is_a((Obj*)matcher, ORSCORER),
+              "Match-only OR still uses ORMatcher");
+
+    DECREF(matcher);
+    DECREF(scorer);
+    DECREF(compiler);
+    DECREF(seg_readers);
+}
+
+static void
+test_pruning(TestBatchRunner *runner, IndexSearcher *searcher,
+             Query *query) {
+    int32_t    doc_max   = IxSearcher_Doc_Max(searcher);
+    BitVector *bit_vec   = BitVec_new((size_t)doc_max + 1);
+    BitCollector *bit_coll = BitColl_new(bit_vec);
+    IxSearcher_Collect(searcher, query, (Collector*)bit_coll);
+    uint32_t num_matches = (uint32_t)BitVec_Count(bit_vec);
+
+    TopDocs *exact = IxSearcher_Top_Docs(searcher, query, NUM_WANTED, NULL);
+    TEST_INT_EQ(runner, TopDocs_Get_Total_Hits(exact), num_matches,
+                "Without a threshold, every match is counted");
+
+    IxSearcher_Set_Total_Hits_Threshold(searcher, NUM_WANTED);
+    TopDocs *pruned = IxSearcher_Top_Docs(searcher, query, NUM_WANTED, NULL);
+    IxSearcher_Set_Total_Hits_Threshold(searcher, UINT32_MAX);
+
+    Vector *exact_docs  = TopDocs_Get_Match_Docs(exact);
+    Vector *pruned_docs = TopDocs_Get_Match_Docs(pruned);
+    size_t  size        = Vec_Get_Size(exact_docs);
+    bool    ids_ok      = size == NUM_WANTED
+                          && Vec_Get_Size(pruned_docs) == size;
+    bool    scores_ok   = ids_ok;
+    for (size_t i = 0; ids_ok && i < size; i++) {
+        MatchDoc *a = (MatchDoc*)Vec_Fetch(exact_docs, i);
+        MatchDoc *b = (MatchDoc*)Vec_Fetch(pruned_docs, i);
+        if (MatchDoc_Get_Doc_ID(a) != MatchDoc_Get_Doc_ID(b)) {
+            ids_ok = false;
+        }
+        if (MatchDoc_Get_Score(a) != MatchDoc_Get_Score(b)) {
+            scores_ok = false;
+        }
+    }
+    TEST_TRUE(runner, ids_ok, "Pruning returns the same top docs");
+    TEST_TRUE(runner, scores_ok, "Pruning returns the same scores");
+
+    uint32_t pruned_hits = TopDocs_Get_Total_Hits(pruned);
+    TEST_TRUE(runner, pruned_hits >= NUM_WANTED,
+              "Total hits counted at least up to the threshold");
+    TEST_TRUE(runner, pruned_hits < num_matches,
+              "Documents which couldn't compete were skipped (%u32 of %u32)",
+              num_matches - pruned_hits, num_matches);
+
+    DECREF(pruned);
+    DECREF(exact);
+    DECREF(bit_coll);
+    DECREF(bit_vec);
+}
+
+void
+TestWANDScorer_Run_IMP(TestWANDScorer *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 7);
+    RAMFolder     *folder   = S_create_index();
+    IndexSearcher *searcher = IxSearcher_new((Obj*)folder);
+    Query         *query    = S_make_query();
+    test_Make_Matcher(runner, searcher, query);
+    test_pruning(runner, searcher, query);
+    DECREF(query);
+    DECREF(searcher);
+    DECREF(folder);
+}
+
+
@@ -19,6 +19,7 @@
 
 #define C_LUCY_FSFILEHANDLE
 #define C_LUCY_FILEWINDOW
+#define C_LUCY_INSTREAM
 #define TESTLUCY_USE_SHORT_NAMES
 #include "Lucy/Util/ToolSet.h"
 
@@ -33,6 +34,7 @@
 #include "Lucy/Test/Store/TestFSFileHandle.h"
 #include "Lucy/Store/FSFileHandle.h"
 #include "Lucy/Store/FileWindow.h"
+#include "Lucy/Store/InStream.h"
 
 static void
 S_remove(String *path) {
@@ -255,13 +257,54 @@ test_Window(TestBatchRunner *runner) {
     S_remove(test_filename);
 }
 
+static void
+test_map_whole(TestBatchRunner *runner) {
+    String *test_filename = SSTR_WRAP_C("_fstest");
+    FSFileHandle *fh;
+    InStream *instream;
+    uint32_t i;
+
+    S_remove(test_filename);
+    fh = FSFH_open(test_filename,
+                   FH_CREATE | FH_WRITE_ONLY | FH_EXCLUSIVE);
+    for (i = 0; i < 1024; i++) {
+        FSFH_Write(fh, "foo ", 4);
+    }
+    TEST_FALSE(runner, FSFH_Is_Mapped(fh),
+               "Write-only handle isn't mapped");
+    if (!FSFH_Close(fh)) { RETHROW(INCREF(Err_get_error())); }
+    DECREF(fh);
+
+    fh = FSFH_open(test_filename, FH_READ_ONLY | FH_MAP_WHOLE);
+    if (!fh) { RETHROW(INCREF(Err_get_error())); }
+    TEST_TRUE(runner, FSFH_Is_Mapped(fh), "FH_MAP_WHOLE maps the file");
+    TEST_TRUE(runner, FSFH_Advise(fh, 1021, 2000, FH_ADVICE_RANDOM),
+              "Advise() returns true");
+
+    instream = InStream_open((Obj*)fh);
+    InStreamIVARS *const ivars = InStream_IVARS(instream);
+    InStream_Advise(instream, FH_ADVICE_SEQUENTIAL);
+    TEST_INT_EQ(runner, InStream_Read_U8(instream), 'f', "Read_U8");
+    TEST_INT_EQ(runner, ivars->limit - ivars->buf, 4095,
+                "Buffer covers the rest of a mapped file after one read");
+    InStream_Seek(instream, 4093);
+    TEST_TRUE(runner, InStream_Read_U8(instream) == 'o'
+                      && ivars->limit - ivars->buf == 2,
+              "Seek within a mapped file doesn't refill");
+
+    DECREF(instream);
+    DECREF(fh);
+    S_remove(test_filename);
+}
+
 void
 TestFSFH_Run_IMP(TestFSFileHandle *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 46);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 52);
     test_open(runner);
     test_Read_Write(runner);
     test_Close(runner);
     test_Window(runner);
+    test_map_whole(runner);
 }
 
 
@@ -0,0 +1,219 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "charmony.h"
+
+// rmdir
+#ifdef CHY_HAS_DIRECT_H
+  #include <direct.h>
+#endif
+#ifdef CHY_HAS_UNISTD_H
+  #include <unistd.h>
+#endif
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Store/TestFSLock.h"
+#include "Lucy/Store/FSFolder.h"
+#include "Lucy/Store/FSLock.h"
+#include "Lucy/Store/FSLockFactory.h"
+#include "Lucy/Store/Lock.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Store/RAMFolder.h"
+#include "Lucy/Util/Json.h"
+#include "Lucy/Util/ProcessID.h"
+
+#define NUM_TESTS 24
+
+TestFSLock*
+TestFSLock_new() {
+    return (TestFSLock*)Class_Make_Obj(TESTFSLOCK);
+}
+
+static Folder*
+S_set_up() {
+    FSFolder *folder = FSFolder_new(SSTR_WRAP_C("_fslocktest"));
+    FSFolder_Initialize(folder);
+    if (!FSFolder_Check(folder)) {
+        RETHROW(INCREF(Err_get_error()));
+    }
+    return (Folder*)folder;
+}
+
+static void
+S_tear_down(Folder *folder) {
+    Folder_Delete(folder, SSTR_WRAP_C("locks/foo.flock"));
+    Folder_Delete(folder, SSTR_WRAP_C("locks"));
+    DECREF(folder);
+    rmdir("_fslocktest");
+}
+
+static FSLock*
+S_make_lock(Folder *folder, int32_t timeout, bool shared) {
+    return FSLock_new(folder, SSTR_WRAP_C("foo"), SSTR_WRAP_C("somehost"),
+                      timeout, 10, shared);
+}
+
+static void
+S_write_lock_file(Folder *folder, const char *content) {
+    OutStream *outstream
+        = Folder_Open_Out(folder, SSTR_WRAP_C("locks/foo.flock"));
+    OutStream_Write_Bytes(outstream, content, strlen(content));
+    OutStream_Close(outstream);
+    DECREF(outstream);
+}
+
+static void
+test_exclusive(TestBatchRunner *runner, Folder *folder) {
+    String *lock_path = SSTR_WRAP_C("locks/foo.flock");
+    FSLock *lock  = S_make_lock(folder, 0, false);
+    FSLock *other = S_make_lock(folder, 50, false);
+
+    TEST_TRUE(runner, FSLock_Obtain(lock), "Obtain");
+    TEST_FALSE(runner, FSLock_Request(lock), "Can't obtain the lock twice");
+    TEST_TRUE(runner, FSLock_Is_Locked(other), "Is_Locked");
+    TEST_FALSE(runner, FSLock_Obtain(other),
+               "A second exclusive lock times out");
+    TEST_TRUE(runner, Obj_is_a((Obj*)Err_get_error(), LOCKERR),
+              "Failure sets a LockErr");
+
+    Hash *holder = (Hash*)Json_slurp_json(folder, lock_path);
+    String *pid_buf = holder
+                      ? (String*)Hash_Fetch_Utf8(holder, "pid", 3)
+                      : NULL;
+    TEST_TRUE(runner, pid_buf && Str_To_I64(pid_buf) == PID_getpid(),
+              "Lock file names the holder's pid");
+    DECREF(holder);
+
+    FSLock_Release(lock);
+    TEST_FALSE(runner, Folder_Exists(folder, lock_path),
+               "Release removes the lock file");
+    TEST_FALSE(runner, FSLock_Is_Locked(other), "Released");
+    TEST_TRUE(runner, FSLock_Obtain(other), "Obtain after Release");
+
+    DECREF(other);
+    TEST_FALSE(runner, FSLock_Is_Locked(lock),
+               "Destroying a lock releases it");
+    DECREF(lock);
+}
+
+static void
+test_repeated_timeouts(TestBatchRunner *runner, Folder *folder) {
+    FSLock *lock      = S_make_lock(folder, 0, false);
+    FSLock *other     = S_make_lock(folder, 20, false);
+    bool    timed_out = true;
+
+    FSLock_Obtain(lock);
+    for (int i = 0; i < 10; i++) {
+        if (FSLock_Obtain(other)) { timed_out = false; }
+    }
+    TEST_TRUE(runner, timed_out, "Repeated Obtains against a held lock fail");
+    TEST_TRUE(runner, FSLock_num_waiters() <= 1,
+              "Timed out Obtains share a single waiting thread");
+    FSLock_Release(lock);
+    TEST_TRUE(runner, FSLock_Obtain(other), "Obtain once the holder is done");
+
+    DECREF(other);
+    DECREF(lock);
+}
+
+static void
+test_shared(TestBatchRunner *runner, Folder *folder) {
+    FSLock *lock      = S_make_lock(folder, 0, true);
+    FSLock *other     = S_make_lock(folder, 0, true);
+    FSLock *exclusive = S_make_lock(folder, 0, false);
+
+    TEST_TRUE(runner, FSLock_Shared(lock), "Shared");
+    TEST_TRUE(runner, FSLock_Obtain(lock) && FSLock_Obtain(other),
+              "Shared locks can be held together");
+    TEST_FALSE(runner, FSLock_Request(exclusive),
+               "Shared locks keep out an exclusive one");
+    FSLock_Release(lock);
+    TEST_TRUE(runner, FSLock_Is_Locked(exclusive),
+              "Still locked while a shared lock is held");
+    FSLock_Release(other);
+    TEST_FALSE(runner,
+               Folder_Exists(folder, SSTR_WRAP_C("locks/foo.flock")),
+               "The last shared lock removes the lock file");
+    TEST_TRUE(runner, FSLock_Request(exclusive),
+              "Exclusive lock once the shared locks are gone");
+
+    DECREF(exclusive);
+    DECREF(other);
+    DECREF(lock);
+}
+
+static void
+test_Clear_Stale(TestBatchRunner *runner, Folder *folder) {
+    String *lock_path = SSTR_WRAP_C("locks/foo.flock");
+    FSLock *lock      = S_make_lock(folder, 0, false);
+
+    S_write_lock_file(folder, "");
+    FSLock_Clear_Stale(lock);
+    TEST_FALSE(runner, Folder_Exists(folder, lock_path),
+               "Clear_Stale removes a lock file nobody holds");
+
+    S_write_lock_file(folder, "{\"host\":\"elsewhere\",\"pid\":\"1\"}");
+    FSLock_Clear_Stale(lock);
+    TEST_TRUE(runner, Folder_Exists(folder, lock_path),
+              "Clear_Stale leaves a file from another host alone");
+    TEST_TRUE(runner, FSLock_Obtain(lock),
+              "A leftover file doesn't stop Obtain");
+
+    DECREF(lock);
+}
+
+static void
+test_factory(TestBatchRunner *runner, Folder *folder) {
+    FSLockFactory *factory
+        = FSLockFact_new(folder, SSTR_WRAP_C("somehost"));
+    Lock *lock = FSLockFact_Make_Shared_Lock(factory, SSTR_WRAP_C("foo"),
+                                             0, 100);
+    TEST_TRUE(runner, Obj_is_a((Obj*)lock, FSLOCK) && Lock_Shared(lock),
+              "FSLockFactory makes FSLocks for an FSFolder");
+    DECREF(lock);
+    DECREF(factory);
+
+    RAMFolder *ram_folder = RAMFolder_new(NULL);
+    factory = FSLockFact_new((Folder*)ram_folder, SSTR_WRAP_C("somehost"));
+    lock = FSLockFact_Make_Lock(factory, SSTR_WRAP_C("foo"), 0, 100);
+    TEST_TRUE(runner, Obj_is_a((Obj*)lock, LOCKFILELOCK),
+              "FSLockFactory falls back to lock files for other Folders");
+    DECREF(lock);
+    DECREF(factory);
+    DECREF(ram_folder);
+}
+
+void
+TestFSLock_Run_IMP(TestFSLock *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, NUM_TESTS);
+    if (!FSLock_available()) {
+        SKIP(runner, NUM_TESTS, "No kernel file locks on this platform");
+        return;
+    }
+    Folder *folder = S_set_up();
+    test_exclusive(runner, folder);
+    test_repeated_timeouts(runner, folder);
+    test_shared(runner, folder);
+    test_Clear_Stale(runner, folder);
+    test_factory(runner, folder);
+    S_tear_down(folder);
+}
+
+
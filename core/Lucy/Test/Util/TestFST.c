@@ -0,0 +1,223 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Util/TestFST.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Store/RAMFile.h"
+#include "Lucy/Util/FST.h"
+
+TestFST*
+TestFST_new() {
+    return (TestFST*)Class_Make_Obj(TESTFST);
+}
+
+// Build an FST mapping each key to its position in `keys`.
+static FiniteStateTransducer*
+S_build(Vector *keys) {
+    FSTBuilder *builder   = FSTBuilder_new();
+    RAMFile    *file      = RAMFile_new(NULL, false);
+    OutStream  *outstream = OutStream_open((Obj*)file);
+    for (size_t i = 0, max = Vec_Get_Size(keys); i < max; i++) {
+        String *key = (String*)Vec_Fetch(keys, i);
+        FSTBuilder_Add(builder, Str_Get_Ptr8(key), Str_Get_Size(key),
+                       (uint64_t)i);
+    }
+    FSTBuilder_Finish(builder, outstream);
+    OutStream_Close(outstream);
+
+    InStream *instream = InStream_open((Obj*)file);
+    FiniteStateTransducer *fst = FST_new(instream);
+    DECREF(instream);
+    DECREF(outstream);
+    DECREF(file);
+    DECREF(builder);
+    return fst;
+}
+
+static int64_t
+S_get(FiniteStateTransducer *fst, const char *key) {
+    return FST_Get(fst, key, strlen(key));
+}
+
+static int64_t
+S_ceil(FiniteStateTransducer *fst, const char *key) {
+    return FST_Ceil(fst, key, strlen(key));
+}
+
+static void
+test_lookups(TestBatchRunner *runner) {
+    static const char *const words[] = {
+        "", "a", "ab", "abc", "abd", "b", "ba", "zz", "\xC3\xA9t\xC3\xA9", NULL
+    };
+    Vector *keys = Vec_new(10);
+    for (size_t i = 0; words[i] != NULL; i++) {
+        Vec_Push(keys, (Obj*)Str_newf("%s", words[i]));
+    }
+    FiniteStateTransducer *fst = S_build(keys);
+
+    TEST_INT_EQ(runner, FST_Get_Num_Keys(fst), Vec_Get_Size(keys),
+                "Get_Num_Keys");
+
+    bool all_found = true;
+    for (size_t i = 0; words[i] != NULL; i++) {
+        if (S_get(fst, words[i]) != (int64_t)i) { all_found = false; }
+    }
+    TEST_TRUE(runner, all_found, "Get finds every key, including \"\"");
+    TEST_TRUE(runner, S_get(fst, "abe") == -1
+              && S_get(fst, "abcd") == -1
+              && S_get(fst, "c") == -1
+              && S_get(fst, "\xC3\xA9") == -1,
+              "Get returns -1 for missing keys and prefixes of keys");
+
+    TEST_INT_EQ(runner, S_ceil(fst, "abd"), 4, "Ceil of a key is the key");
+    TEST_INT_EQ(runner, S_ceil(fst, "aa"), 2,
+                "Ceil branching off at the last byte");
+    TEST_INT_EQ(runner, S_ceil(fst, "abcd"), 4,
+                "Ceil of an extension of a key");
+    TEST_INT_EQ(runner, S_ceil(fst, "bb"), 7,
+                "Ceil backing up to an earlier branch");
+    TEST_INT_EQ(runner, S_ceil(fst, "zzz"), 8, "Ceil past an ASCII key");
+    TEST_INT_EQ(runner, S_ceil(fst, "\xC3\xAA"), -1,
+                "Ceil past the last key");
+
+    DECREF(fst);
+    DECREF(keys);
+}
+
+static void
+test_empty(TestBatchRunner *runner) {
+    Vector *keys = Vec_new(0);
+    FiniteStateTransducer *fst = S_build(keys);
+    TEST_TRUE(runner, S_get(fst, "") == -1 && S_ceil(fst, "") == -1
+              && FST_Get_Num_Keys(fst) == 0,
+              "Empty FST");
+    DECREF(fst);
+    DECREF(keys);
+}
+
+static void
+S_add_out_of_order(void *context) {
+    FSTBuilder *builder = (FSTBuilder*)context;
+    FSTBuilder_Add(builder, "b", 1, 0);
+    FSTBuilder_Add(builder, "a", 1, 1);
+}
+
+static void
+S_add_lower_output(void *context) {
+    FSTBuilder *builder = (FSTBuilder*)context;
+    FSTBuilder_Add(builder, "a", 1, 5);
+    FSTBuilder_Add(builder, "b", 1, 4);
+}
+
+static void
+test_bad_input(TestBatchRunner *runner) {
+#ifdef LUCY_VALGRIND
+    SKIP(runner, 2, "known leaks");
+#else
+    FSTBuilder *builder = FSTBuilder_new();
+    Err *error = Err_trap(S_add_out_of_order, builder);
+    TEST_TRUE(runner, error != NULL, "Adding keys out of order throws");
+    DECREF(error);
+    DECREF(builder);
+
+    builder = FSTBuilder_new();
+    error = Err_trap(S_add_lower_output, builder);
+    TEST_TRUE(runner, error != NULL, "Decreasing outputs throw");
+    DECREF(error);
+    DECREF(builder);
+#endif
+}
+
+static void
+test_random_keys(TestBatchRunner *runner) {
+    // Short keys over a small alphabet, so that they share plenty of
+    // prefixes and suffixes.
+    Vector *samples = Vec_new(1000);
+    for (uint32_t i = 0; i < 1000; i++) {
+        char   buf[8];
+        size_t size = (size_t)(TestUtils_random_u64() % sizeof(buf));
+        for (size_t j = 0; j < size; j++) {
+            buf[j] = (char)('a' + TestUtils_random_u64() % 4);
+        }
+        Vec_Push(samples, (Obj*)Str_new_from_trusted_utf8(buf, size));
+    }
+    Vec_Sort(samples);
+    Vector *keys = Vec_new(1000);
+    for (size_t i = 0, max = Vec_Get_Size(samples); i < max; i++) {
+        Obj *sample = Vec_Fetch(samples, i);
+        Obj *prev   = i > 0 ? Vec_Fetch(samples, i - 1) : NULL;
+        if (!prev || !Str_Equals((String*)sample, prev)) {
+            Vec_Push(keys, INCREF(sample));
+        }
+    }
+    DECREF(samples);
+    FiniteStateTransducer *fst = S_build(keys);
+    const size_t num_keys = Vec_Get_Size(keys);
+
+    bool gets_ok = true;
+    for (size_t i = 0; i < num_keys; i++) {
+        String *key = (String*)Vec_Fetch(keys, i);
+        if (FST_Get(fst, Str_Get_Ptr8(key), Str_Get_Size(key))
+            != (int64_t)i
+           ) {
+            gets_ok = false;
+        }
+    }
+    TEST_TRUE(runner, gets_ok, "Get finds all of %u64 random keys",
+              (uint64_t)num_keys);
+
+    bool ceils_ok = true;
+    for (uint32_t i = 0; i < 1000; i++) {
+        char   buf[9];
+        size_t size = (size_t)(TestUtils_random_u64() % sizeof(buf));
+        for (size_t j = 0; j < size; j++) {
+            buf[j] = (char)('a' + TestUtils_random_u64() % 5);
+        }
+        String *probe = Str_new_from_trusted_utf8(buf, size);
+        int64_t expected = -1;
+        for (size_t j = 0; j < num_keys; j++) {
+            if (Str_Compare_To((String*)Vec_Fetch(keys, j), (Obj*)probe)
+                >= 0
+               ) {
+                expected = (int64_t)j;
+                break;
+            }
+        }
+        if (FST_Ceil(fst, buf, size) != expected) { ceils_ok = false; }
+        DECREF(probe);
+    }
+    TEST_TRUE(runner, ceils_ok, "Ceil agrees with a linear search");
+
+    DECREF(fst);
+    DECREF(keys);
+}
+
+void
+TestFST_Run_IMP(TestFST *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 14);
+    test_lookups(runner);
+    test_empty(runner);
+    test_bad_input(runner);
+    test_random_keys(runner);
+}
+
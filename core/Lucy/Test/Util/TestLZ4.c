@@ -0,0 +1,114 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+
+#define TESTLUCY_USE_SHORT_NAMES
+#include "Lucy/Util/ToolSet.h"
+
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Lucy/Test.h"
+#include "Lucy/Test/Util/TestLZ4.h"
+#include "Lucy/Util/LZ4.h"
+
+TestLZ4*
+TestLZ4_new() {
+    return (TestLZ4*)Class_Make_Obj(TESTLZ4);
+}
+
+// Compress and decompress `len` bytes, returning true if the data survives
+// the round trip.  The compressed size is stored in `compressed_len`.
+static bool
+S_round_trip(const char *source, size_t len, size_t *compressed_len) {
+    char   *compressed = (char*)MALLOCATE(LZ4_compress_bound(len));
+    char   *restored   = (char*)MALLOCATE(len + 1);
+    size_t  size       = LZ4_compress(source, len, compressed);
+    bool    ok         = LZ4_decompress(compressed, size, restored, len)
+                         && memcmp(source, restored, len) == 0;
+    *compressed_len = size;
+    FREEMEM(restored);
+    FREEMEM(compressed);
+    return ok;
+}
+
+static void
+test_round_trip(TestBatchRunner *runner) {
+    size_t size;
+
+    TEST_TRUE(runner, S_round_trip("", 0, &size), "empty input");
+    TEST_TRUE(runner, S_round_trip("abc", 3, &size),
+              "input shorter than a match");
+
+    const char *text = "the quick brown fox jumps over the lazy dog; "
+                       "the quick brown fox jumps over the lazy dog";
+    TEST_TRUE(runner, S_round_trip(text, strlen(text), &size)
+                      && size < strlen(text),
+              "repeated phrase compresses");
+
+    // Long runs exercise overlapping matches and extended lengths.
+    size_t  len    = 100000;
+    char   *buf    = (char*)MALLOCATE(len);
+    memset(buf, 'a', len);
+    TEST_TRUE(runner, S_round_trip(buf, len, &size) && size < len / 100,
+              "long run of one byte");
+
+    // Random bytes don't compress, but must still fit the bound.
+    uint64_t seed = TestUtils_random_u64();
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        buf[i] = (char)(seed >> 56);
+    }
+    TEST_TRUE(runner, S_round_trip(buf, len, &size)
+                      && size <= LZ4_compress_bound(len),
+              "random data");
+
+    // Short matches scattered among literals.
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = "abcdefghijklmnopqrstuvwxyz 0123456789"[(i * i) % 37];
+    }
+    TEST_TRUE(runner, S_round_trip(buf, len, &size), "mixed text");
+    FREEMEM(buf);
+}
+
+static void
+test_corrupt(TestBatchRunner *runner) {
+    const char *text = "abcdabcdabcdabcdabcdabcdabcdabcdabcdabcd";
+    size_t      len  = strlen(text);
+    char        compressed[128];
+    char        restored[128];
+    size_t      size = LZ4_compress(text, len, compressed);
+
+    TEST_FALSE(runner, LZ4_decompress(compressed, size - 1, restored, len),
+               "truncated input rejected");
+    TEST_FALSE(runner, LZ4_decompress(compressed, size, restored, len - 1),
+               "output overrun rejected");
+    TEST_FALSE(runner, LZ4_decompress(compressed, size, restored, len + 1),
+               "short output rejected");
+
+    // A match offset pointing before the start of the output.
+    const char bad_offset[] = { 0x10, 'a', 0x05, 0x00, 0x00 };
+    TEST_FALSE(runner, LZ4_decompress(bad_offset, sizeof(bad_offset),
+                                      restored, 10),
+               "bad match offset rejected");
+}
+
+void
+TestLZ4_Run_IMP(TestLZ4 *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 10);
+    test_round_trip(runner);
+    test_corrupt(runner);
+}
+
@@ -92,6 +92,42 @@ test_u4(TestBatchRunner *runner) {
     FREEMEM(ints);
 }
 
+static void
+test_packed_bits(TestBatchRunner *runner) {
+    size_t    count   = 100;
+    uint32_t *source  = (uint32_t*)MALLOCATE(count * sizeof(uint32_t));
+    uint32_t *dest    = (uint32_t*)MALLOCATE(count * sizeof(uint32_t));
+    uint8_t  *packed  = (uint8_t*)MALLOCATE(count * sizeof(uint32_t));
+
+    TEST_UINT_EQ(runner, NumUtil_bit_width(0), 0, "bit_width 0");
+    TEST_UINT_EQ(runner, NumUtil_bit_width(5), 3, "bit_width 5");
+    TEST_UINT_EQ(runner, NumUtil_bit_width(UINT32_MAX), 32,
+                 "bit_width UINT32_MAX");
+
+    for (uint32_t width = 0; width <= 32; width++) {
+        uint64_t  limit = (uint64_t)1 << width;
+        uint64_t *ints  = TestUtils_random_u64s(NULL, count, 0, limit);
+        for (size_t i = 0; i < count; i++) {
+            source[i] = (uint32_t)ints[i];
+        }
+        size_t written  = NumUtil_pack_bits(source, count, width, packed);
+        size_t consumed = NumUtil_unpack_bits(packed, count, width, dest);
+        TEST_TRUE(runner, written == consumed
+                  && written == (count * width + 7) / 8,
+                  "pack_bits/unpack_bits byte count, width %u",
+                  (unsigned)width);
+        TEST_TRUE(runner,
+                  memcmp(source, dest, count * sizeof(uint32_t)) == 0,
+                  "pack_bits/unpack_bits round trip, width %u",
+                  (unsigned)width);
+        FREEMEM(ints);
+    }
+
+    FREEMEM(packed);
+    FREEMEM(dest);
+    FREEMEM(source);
+}
+
 static void
 test_ci32(TestBatchRunner *runner) {
     int64_t   mins[]   = { -500, -0x4000 - 100, INT32_MIN };
@@ -453,11 +489,12 @@ test_bigend_f64(TestBatchRunner *runner) {
 
 void
 TestNumUtil_Run_IMP(TestNumberUtils *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 1655);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 1724);
     srand((unsigned int)time((time_t*)NULL));
     test_u1(runner);
     test_u2(runner);
     test_u4(runner);
+    test_packed_bits(runner);
     test_ci32(runner);
     test_cu32(runner);
     test_ci64(runner);
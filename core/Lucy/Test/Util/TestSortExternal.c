@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -156,11 +157,13 @@ test_clear_buffer(TestBatchRunner *runner) {
 
 static void
 S_test_sort(TestBatchRunner *runner, Vector *blobs, uint32_t mem_thresh,
-            const char *test_name) {
+            uint32_t num_threads, const char *test_name) {
     size_t       size     = Vec_Get_Size(blobs);
     BlobSortEx  *sortex   = BlobSortEx_new(mem_thresh, NULL);
     Blob       **shuffled = (Blob**)MALLOCATE(size * sizeof(Blob*));
 
+    BlobSortEx_Set_Num_Threads(sortex, num_threads);
+
     for (size_t i = 0; i < size; ++i) {
         shuffled[i] = (Blob*)CERTIFY(Vec_Fetch(blobs, i), BLOB);
     }
@@ -200,7 +203,7 @@ S_test_sort_letters(TestBatchRunner *runner, const char *letters,
         Vec_Push(blobs, (Obj*)blob);
     }
 
-    S_test_sort(runner, blobs, mem_thresh, test_name);
+    S_test_sort(runner, blobs, mem_thresh, 1, test_name);
 
     DECREF(blobs);
 }
@@ -243,7 +246,7 @@ test_sort_packed_ints(TestBatchRunner *runner) {
         Vec_Push(blobs, (Obj*)blob);
     }
 
-    S_test_sort(runner, blobs, 5000, "Sorting packed integers...");
+    S_test_sort(runner, blobs, 5000, 1, "Sorting packed integers...");
 
     DECREF(blobs);
 }
@@ -264,12 +267,106 @@ test_sort_random_strings(TestBatchRunner *runner) {
     }
 
     Vec_Sort(blobs);
-    S_test_sort(runner, blobs, 15000,
+    S_test_sort(runner, blobs, 15000, 1,
                 "Random binary strings of random length");
 
     DECREF(blobs);
 }
 
+static void
+test_bytes_prefix(TestBatchRunner *runner) {
+    TEST_TRUE(runner, SortEx_bytes_prefix("ab", 2)
+                      < SortEx_bytes_prefix("ab\0c", 4),
+              "bytes_prefix: shorter string sorts first");
+    TEST_TRUE(runner, SortEx_bytes_prefix("abcdefghX", 9)
+                      == SortEx_bytes_prefix("abcdefghY", 9),
+              "bytes_prefix only looks at the first 8 bytes");
+    TEST_TRUE(runner, SortEx_bytes_prefix("\xFF", 1)
+                      > SortEx_bytes_prefix("\x01\xFF\xFF", 3),
+              "bytes_prefix compares bytes as unsigned");
+}
+
+static Vector*
+S_packed_ints(uint32_t num_ints) {
+    Vector *blobs = Vec_new(num_ints);
+    for (uint32_t i = 0; i < num_ints; ++i) {
+        uint8_t buf[4];
+        buf[0] = (uint8_t)((i >> 24) & 0xFF);
+        buf[1] = (uint8_t)((i >> 16) & 0xFF);
+        buf[2] = (uint8_t)((i >> 8)  & 0xFF);
+        buf[3] = (uint8_t)(i & 0xFF);
+        Vec_Push(blobs, (Obj*)Blob_new((char*)buf, 4));
+    }
+    return blobs;
+}
+
+static void
+test_sort_threads(TestBatchRunner *runner) {
+    Vector *blobs = S_packed_ints(30001);
+    S_test_sort(runner, blobs, UINT32_MAX, 4,
+                "Sort a large buffer on several threads");
+    S_test_sort(runner, blobs, 20000, 3,
+                "Sort several runs on several threads");
+    DECREF(blobs);
+}
+
+// Build a fake posting: a term drawn from a small vocabulary followed by a
+// big-endian doc id.
+static Blob*
+S_fake_posting(uint32_t term_num, uint32_t doc_id) {
+    char buf[16];
+    int  len = sprintf(buf, "t%05u", (unsigned)term_num);
+    buf[len]     = (char)(doc_id >> 24);
+    buf[len + 1] = (char)(doc_id >> 16);
+    buf[len + 2] = (char)(doc_id >> 8);
+    buf[len + 3] = (char)doc_id;
+    return Blob_new(buf, (size_t)len + 4);
+}
+
+static bool
+S_sorts_in_order(Vector *postings, uint32_t mem_thresh, uint32_t num_threads) {
+    size_t      num_postings = Vec_Get_Size(postings);
+    BlobSortEx *sortex = BlobSortEx_new(mem_thresh, NULL);
+
+    BlobSortEx_Set_Num_Threads(sortex, num_threads);
+    for (size_t i = 0; i < num_postings; i++) {
+        BlobSortEx_Feed(sortex, INCREF(Vec_Fetch(postings, i)));
+    }
+    BlobSortEx_Flip(sortex);
+
+    Obj    *last   = BlobSortEx_Fetch(sortex);
+    Obj    *next;
+    size_t  count  = last ? 1 : 0;
+    bool    sorted = true;
+    while (NULL != (next = BlobSortEx_Fetch(sortex))) {
+        if (Obj_Compare_To(last, next) > 0) { sorted = false; }
+        DECREF(last);
+        last = next;
+        count++;
+    }
+    DECREF(last);
+    DECREF(sortex);
+
+    return sorted && count == num_postings;
+}
+
+static void
+test_fake_postings(TestBatchRunner *runner) {
+    uint32_t num_postings = 20000;
+    Vector  *postings     = Vec_new(num_postings);
+    for (uint32_t i = 0; i < num_postings; i++) {
+        Vec_Push(postings, (Obj*)S_fake_posting((uint32_t)rand() % 500,
+                                                (uint32_t)rand()));
+    }
+
+    TEST_TRUE(runner, S_sorts_in_order(postings, 0x8000, 1),
+              "Postings sorted across runs (1 thread)");
+    TEST_TRUE(runner, S_sorts_in_order(postings, 0x8000, 4),
+              "Postings sorted across runs (4 threads)");
+
+    DECREF(postings);
+}
+
 static void
 test_run(TestBatchRunner *runner) {
     Vector *letters = Vec_new(26);
@@ -307,7 +404,7 @@ test_run(TestBatchRunner *runner) {
 
 void
 TestSortExternal_Run_IMP(TestSortExternal *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 19);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 26);
 
     srand((unsigned int)time((time_t*)NULL));
     S_init_blobs();
@@ -318,6 +415,9 @@ TestSortExternal_Run_IMP(TestSortExternal *self, TestBatchRunner *runner) {
     test_sort_packed_ints(runner);
     test_sort_random_strings(runner);
     test_run(runner);
+    test_bytes_prefix(runner);
+    test_sort_threads(runner);
+    test_fake_postings(runner);
     S_destroy_blobs();
 }
 
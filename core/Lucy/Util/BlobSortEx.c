@@ -169,6 +169,13 @@ BlobSortEx_Compare_IMP(BlobSortEx *self, Obj **ptr_a, Obj **ptr_b) {
     return Obj_Compare_To(*ptr_a, *ptr_b);
 }
 
+uint64_t
+BlobSortEx_Key_Prefix_IMP(BlobSortEx *self, Obj *item) {
+    UNUSED_VAR(self);
+    return SortEx_bytes_prefix(Blob_Get_Buf((Blob*)item),
+                               Blob_Get_Size((Blob*)item));
+}
+
 Vector*
 BlobSortEx_Peek_Cache_IMP(BlobSortEx *self) {
     BlobSortExIVARS *const ivars = BlobSortEx_IVARS(self);
@@ -0,0 +1,546 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_FINITESTATETRANSDUCER
+#define C_LUCY_FSTBUILDER
+#include "Lucy/Util/ToolSet.h"
+
+#include "Lucy/Util/FST.h"
+#include "Lucy/Store/InStream.h"
+#include "Lucy/Store/OutStream.h"
+#include "Lucy/Util/NumberUtils.h"
+
+/* A node starts with a flags byte.  Nodes with arcs go on with the number of
+ * arcs minus one and a byte holding the widths of the arc outputs (high
+ * nibble) and targets (low nibble).  A final node's own output follows as a
+ * CU64, then the arc labels, then the output and target of each arc, both
+ * big-endian.  Targets are offsets from the start of the FST.
+ */
+#define FST_FINAL     0x1
+#define FST_HAS_ARCS  0x2
+
+// The trailer: the offset of the root node and the number of keys.
+#define FST_TRAILER_SIZE 16
+
+typedef struct {
+    const uint8_t *labels;
+    const uint8_t *arcs;
+    uint32_t       num_arcs;
+    uint32_t       out_width;
+    uint32_t       arc_width;
+    bool           is_final;
+    uint64_t       final_output;
+} S_FrozenNode;
+
+typedef struct {
+    uint8_t  *labels;
+    uint64_t *outputs;
+    uint64_t *targets;
+    uint32_t  num_arcs;
+    uint32_t  cap;
+    bool      is_final;
+    uint64_t  final_output;
+} S_PendingNode;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t addr;
+    size_t   size; // 0 for an empty slot
+} S_NodeSlot;
+
+static void
+S_read_node(const uint8_t *buf, uint64_t addr, S_FrozenNode *node) {
+    const uint8_t *ptr   = buf + addr;
+    const uint8_t  flags = *ptr++;
+    node->num_arcs  = 0;
+    node->out_width = 0;
+    node->arc_width = 0;
+    if (flags & FST_HAS_ARCS) {
+        node->num_arcs  = (uint32_t)ptr[0] + 1;
+        node->out_width = ptr[1] >> 4;
+        node->arc_width = node->out_width + (ptr[1] & 0xF);
+        ptr += 2;
+    }
+    node->is_final     = (flags & FST_FINAL) ? true : false;
+    node->final_output = 0;
+    if (node->is_final) {
+        const char *source = (const char*)ptr;
+        node->final_output = NumUtil_decode_cu64(&source);
+        ptr = (const uint8_t*)source;
+    }
+    node->labels = ptr;
+    node->arcs   = ptr + node->num_arcs;
+}
+
+static CFISH_INLINE uint64_t
+S_decode_width(const uint8_t *ptr, uint32_t width) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < width; i++) {
+        value = (value << 8) | ptr[i];
+    }
+    return value;
+}
+
+static CFISH_INLINE uint64_t
+S_arc_output(const S_FrozenNode *node, uint32_t tick) {
+    const uint8_t *ptr = node->arcs + tick * node->arc_width;
+    return S_decode_width(ptr, node->out_width);
+}
+
+static CFISH_INLINE uint64_t
+S_arc_target(const S_FrozenNode *node, uint32_t tick) {
+    const uint8_t *ptr = node->arcs + tick * node->arc_width;
+    return S_decode_width(ptr + node->out_width,
+                          node->arc_width - node->out_width);
+}
+
+// Return the tick of the first arc whose label is not less than `label`.
+static uint32_t
+S_find_arc(const S_FrozenNode *node, uint8_t label) {
+    uint32_t lo = 0;
+    uint32_t hi = node->num_arcs;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        if (node->labels[mid] < label) { lo = mid + 1; }
+        else                           { hi = mid; }
+    }
+    return lo;
+}
+
+// Follow the first arc out of each node down to the least key below `addr`.
+static int64_t
+S_least_key(const uint8_t *buf, uint64_t addr, uint64_t output) {
+    S_FrozenNode node;
+    while (1) {
+        S_read_node(buf, addr, &node);
+        if (node.is_final) { return (int64_t)(output + node.final_output); }
+        if (!node.num_arcs) { return -1; }
+        output += S_arc_output(&node, 0);
+        addr    = S_arc_target(&node, 0);
+    }
+}
+
+FiniteStateTransducer*
+FST_new(InStream *instream) {
+    FiniteStateTransducer *self
+        = (FiniteStateTransducer*)Class_Make_Obj(FINITESTATETRANSDUCER);
+    return FST_init(self, instream);
+}
+
+FiniteStateTransducer*
+FST_init(FiniteStateTransducer *self, InStream *instream) {
+    FiniteStateTransducerIVARS *const ivars = FST_IVARS(self);
+    const int64_t len = InStream_Length(instream);
+    if (len < FST_TRAILER_SIZE + 1) {
+        String *mess = MAKE_MESS("FST file '%o' too short: %i64",
+                                 InStream_Get_Filename(instream), len);
+        DECREF(self);
+        Err_throw_mess(ERR, mess);
+    }
+
+    ivars->instream = (InStream*)INCREF(instream);
+    InStream_Seek(instream, 0);
+    ivars->buf = (const uint8_t*)InStream_Buf(instream, (size_t)len);
+    const uint8_t *trailer = ivars->buf + len - FST_TRAILER_SIZE;
+    ivars->root     = NumUtil_decode_bigend_u64(trailer);
+    ivars->num_keys = (int64_t)NumUtil_decode_bigend_u64(trailer + 8);
+    if (ivars->root >= (uint64_t)(len - FST_TRAILER_SIZE)) {
+        THROW(ERR, "Corrupt FST file '%o': root at %u64",
+              InStream_Get_Filename(instream), ivars->root);
+    }
+
+    return self;
+}
+
+void
+FST_Destroy_IMP(FiniteStateTransducer *self) {
+    FiniteStateTransducerIVARS *const ivars = FST_IVARS(self);
+    DECREF(ivars->instream);
+    SUPER_DESTROY(self, FINITESTATETRANSDUCER);
+}
+
+int64_t
+FST_Get_IMP(FiniteStateTransducer *self, const char *key, size_t size) {
+    FiniteStateTransducerIVARS *const ivars = FST_IVARS(self);
+    uint64_t output = 0;
+    S_FrozenNode node;
+
+    S_read_node(ivars->buf, ivars->root, &node);
+    for (size_t i = 0; i < size; i++) {
+        const uint8_t  label = (uint8_t)key[i];
+        const uint32_t tick  = S_find_arc(&node, label);
+        if (tick >= node.num_arcs || node.labels[tick] != label) {
+            return -1;
+        }
+        output += S_arc_output(&node, tick);
+        S_read_node(ivars->buf, S_arc_target(&node, tick), &node);
+    }
+
+    return node.is_final ? (int64_t)(output + node.final_output) : -1;
+}
+
+int64_t
+FST_Ceil_IMP(FiniteStateTransducer *self, const char *key, size_t size) {
+    FiniteStateTransducerIVARS *const ivars = FST_IVARS(self);
+    uint64_t addr       = ivars->root;
+    uint64_t output     = 0;
+    uint64_t alt_addr   = 0;
+    uint64_t alt_output = 0;
+    bool     have_alt   = false;
+    S_FrozenNode node;
+
+    for (size_t i = 0; i < size; i++) {
+        const uint8_t label = (uint8_t)key[i];
+        S_read_node(ivars->buf, addr, &node);
+        const uint32_t tick  = S_find_arc(&node, label);
+        const bool     found = tick < node.num_arcs
+                               && node.labels[tick] == label;
+
+        // The next arc up leads to the keys which branch off above `key` at
+        // this byte.  A branch further down is always closer to `key`, so
+        // only the deepest one matters.
+        const uint32_t next = found ? tick + 1 : tick;
+        if (next < node.num_arcs) {
+            have_alt   = true;
+            alt_addr   = S_arc_target(&node, next);
+            alt_output = output + S_arc_output(&node, next);
+        }
+
+        if (!found) {
+            return have_alt
+                   ? S_least_key(ivars->buf, alt_addr, alt_output)
+                   : -1;
+        }
+        output += S_arc_output(&node, tick);
+        addr    = S_arc_target(&node, tick);
+    }
+
+    // All of `key` matched, so every key below this node is ge `key`.
+    return S_least_key(ivars->buf, addr, output);
+}
+
+int64_t
+FST_Get_Num_Keys_IMP(FiniteStateTransducer *self) {
+    return FST_IVARS(self)->num_keys;
+}
+
+/***************************************************************************/
+
+// Freeze the pending nodes deeper than `depth`, from the bottom up, pointing
+// each parent's last arc at its frozen child.
+static void
+S_freeze_tail(FSTBuilder *self, size_t depth);
+
+// Serialize a pending node and return the address of an identical frozen
+// node, adding it if it's new.
+static uint64_t
+S_compile_node(FSTBuilder *self, S_PendingNode *node);
+
+FSTBuilder*
+FSTBuilder_new() {
+    FSTBuilder *self = (FSTBuilder*)Class_Make_Obj(FSTBUILDER);
+    return FSTBuilder_init(self);
+}
+
+FSTBuilder*
+FSTBuilder_init(FSTBuilder *self) {
+    FSTBuilderIVARS *const ivars = FSTBuilder_IVARS(self);
+    ivars->buf_size       = 0;
+    ivars->buf_cap        = 1024;
+    ivars->buf            = (char*)MALLOCATE(ivars->buf_cap);
+    ivars->scratch_cap    = 64;
+    ivars->scratch        = (char*)MALLOCATE(ivars->scratch_cap);
+    ivars->frontier_cap   = 16;
+    ivars->frontier       = CALLOCATE(ivars->frontier_cap,
+                                      sizeof(S_PendingNode));
+    ivars->node_table_cap = 1024;
+    ivars->node_table     = CALLOCATE(ivars->node_table_cap,
+                                      sizeof(S_NodeSlot));
+    ivars->num_nodes      = 0;
+    ivars->last_cap       = 64;
+    ivars->last_key       = (char*)MALLOCATE(ivars->last_cap);
+    ivars->last_size      = 0;
+    ivars->last_output    = 0;
+    ivars->num_keys       = 0;
+    ivars->finished       = false;
+    return self;
+}
+
+void
+FSTBuilder_Destroy_IMP(FSTBuilder *self) {
+    FSTBuilderIVARS *const ivars = FSTBuilder_IVARS(self);
+    S_PendingNode *frontier = (S_PendingNode*)ivars->frontier;
+    for (size_t i = 0; i < ivars->frontier_cap; i++) {
+        FREEMEM(frontier[i].labels);
+        FREEMEM(frontier[i].outputs);
+        FREEMEM(frontier[i].targets);
+    }
+    FREEMEM(ivars->frontier);
+    FREEMEM(ivars->node_table);
+    FREEMEM(ivars->buf);
+    FREEMEM(ivars->scratch);
+    FREEMEM(ivars->last_key);
+    SUPER_DESTROY(self, FSTBUILDER);
+}
+
+static void
+S_add_arc(S_PendingNode *node, uint8_t label) {
+    if (node->num_arcs == node->cap) {
+        node->cap     = node->cap ? node->cap * 2 : 4;
+        node->labels  = (uint8_t*)REALLOCATE(node->labels, node->cap);
+        node->outputs = (uint64_t*)REALLOCATE(node->outputs,
+                                              node->cap * sizeof(uint64_t));
+        node->targets = (uint64_t*)REALLOCATE(node->targets,
+                                              node->cap * sizeof(uint64_t));
+    }
+    node->labels[node->num_arcs]  = label;
+    node->outputs[node->num_arcs] = 0;
+    node->targets[node->num_arcs] = 0;
+    node->num_arcs++;
+}
+
+void
+FSTBuilder_Add_IMP(FSTBuilder *self, const char *key, size_t size,
+                   uint64_t output) {
+    FSTBuilderIVARS *const ivars = FSTBuilder_IVARS(self);
+    size_t prefix = 0;
+
+    if (ivars->finished) {
+        THROW(ERR, "Can't add keys to a finished FST");
+    }
+    if (ivars->num_keys) {
+        const char   *last_key = ivars->last_key;
+        const size_t  min_size = size < ivars->last_size
+                                 ? size
+                                 : ivars->last_size;
+        while (prefix < min_size && key[prefix] == last_key[prefix]) {
+            prefix++;
+        }
+        const bool ascending
+            = prefix == min_size
+              ? size > ivars->last_size
+              : (uint8_t)key[prefix] > (uint8_t)last_key[prefix];
+        if (!ascending) {
+            THROW(ERR, "FST keys must be unique and added in ascending order");
+        }
+        if (output < ivars->last_output) {
+            THROW(ERR, "FST output decreased from %u64 to %u64",
+                  ivars->last_output, output);
+        }
+    }
+
+    // Make room for a pending node at each depth of the new key.
+    if (size + 1 > ivars->frontier_cap) {
+        size_t new_cap = size + 1 > ivars->frontier_cap * 2
+                         ? size + 1
+                         : ivars->frontier_cap * 2;
+        ivars->frontier = REALLOCATE(ivars->frontier,
+                                     new_cap * sizeof(S_PendingNode));
+        memset((S_PendingNode*)ivars->frontier + ivars->frontier_cap, 0,
+               (new_cap - ivars->frontier_cap) * sizeof(S_PendingNode));
+        ivars->frontier_cap = new_cap;
+    }
+    S_PendingNode *frontier = (S_PendingNode*)ivars->frontier;
+
+    // Nothing below the shared prefix can gain any more arcs.
+    S_freeze_tail(self, prefix);
+    for (size_t depth = prefix + 1; depth <= size; depth++) {
+        S_PendingNode *node = &frontier[depth];
+        node->num_arcs     = 0;
+        node->is_final     = false;
+        node->final_output = 0;
+        S_add_arc(&frontier[depth - 1], (uint8_t)key[depth - 1]);
+    }
+    frontier[size].is_final = true;
+
+    // The shared prefix already carries the output of an earlier key, which
+    // can't exceed this one's, so only the difference goes on the first new
+    // arc.
+    uint64_t remaining = output;
+    for (size_t depth = 0; depth < prefix; depth++) {
+        S_PendingNode *node = &frontier[depth];
+        remaining -= node->outputs[node->num_arcs - 1];
+    }
+    if (size > prefix) {
+        S_PendingNode *node = &frontier[prefix];
+        node->outputs[node->num_arcs - 1] = remaining;
+    }
+    else {
+        // Only possible for an empty first key.
+        frontier[size].final_output = remaining;
+    }
+
+    // Remember the key.
+    if (size > ivars->last_cap) {
+        ivars->last_cap = size;
+        ivars->last_key = (char*)REALLOCATE(ivars->last_key, size);
+    }
+    memcpy(ivars->last_key, key, size);
+    ivars->last_size   = size;
+    ivars->last_output = output;
+    ivars->num_keys++;
+}
+
+void
+FSTBuilder_Finish_IMP(FSTBuilder *self, OutStream *outstream) {
+    FSTBuilderIVARS *const ivars = FSTBuilder_IVARS(self);
+    if (ivars->finished) {
+        THROW(ERR, "FST already finished");
+    }
+
+    S_freeze_tail(self, 0);
+    S_PendingNode *frontier = (S_PendingNode*)ivars->frontier;
+    uint64_t root = S_compile_node(self, &frontier[0]);
+
+    OutStream_Write_Bytes(outstream, ivars->buf, ivars->buf_size);
+    OutStream_Write_U64(outstream, root);
+    OutStream_Write_U64(outstream, (uint64_t)ivars->num_keys);
+    ivars->finished = true;
+}
+
+int64_t
+FSTBuilder_Get_Num_Keys_IMP(FSTBuilder *self) {
+    return FSTBuilder_IVARS(self)->num_keys;
+}
+
+static void
+S_freeze_tail(FSTBuilder *self, size_t depth) {
+    FSTBuilderIVARS *const ivars = FSTBuilder_IVARS(self);
+    S_PendingNode *frontier = (S_PendingNode*)ivars->frontier;
+    for (size_t i = ivars->last_size; i > depth; i--) {
+        S_PendingNode *parent = &frontier[i - 1];
+        parent->targets[parent->num_arcs - 1]
+            = S_compile_node(self, &frontier[i]);
+    }
+}
+
+static uint32_t
+S_width_of(uint64_t value) {
+    uint32_t width = 0;
+    while (value) {
+        width++;
+        value >>= 8;
+    }
+    return width;
+}
+
+static void
+S_encode_width(uint64_t value, uint32_t width, char **dest) {
+    char *ptr = *dest;
+    for (uint32_t i = width; i > 0; i--) {
+        *ptr++ = (char)(value >> ((i - 1) * 8));
+    }
+    *dest = ptr;
+}
+
+static void
+S_grow_node_table(FSTBuilderIVARS *ivars) {
+    S_NodeSlot   *old_slots = (S_NodeSlot*)ivars->node_table;
+    const size_t  old_cap   = ivars->node_table_cap;
+    const size_t  new_cap   = old_cap * 2;
+    S_NodeSlot   *slots
+        = (S_NodeSlot*)CALLOCATE(new_cap, sizeof(S_NodeSlot));
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old_slots[i].size) { continue; }
+        size_t tick = (size_t)old_slots[i].hash & (new_cap - 1);
+        while (slots[tick].size) { tick = (tick + 1) & (new_cap - 1); }
+        slots[tick] = old_slots[i];
+    }
+    FREEMEM(old_slots);
+    ivars->node_table     = slots;
+    ivars->node_table_cap = new_cap;
+}
+
+static uint64_t
+S_compile_node(FSTBuilder *self, S_PendingNode *node) {
+    FSTBuilderIVARS *const ivars = FSTBuilder_IVARS(self);
+    const uint32_t num_arcs = node->num_arcs;
+
+    // Use the narrowest widths that fit every arc.
+    uint64_t max_output = 0;
+    uint64_t max_target = 0;
+    for (uint32_t i = 0; i < num_arcs; i++) {
+        if (node->outputs[i] > max_output) { max_output = node->outputs[i]; }
+        if (node->targets[i] > max_target) { max_target = node->targets[i]; }
+    }
+    const uint32_t out_width  = S_width_of(max_output);
+    const uint32_t addr_width = S_width_of(max_target);
+
+    // Serialize.
+    const size_t max_size = 3 + 10 + (size_t)num_arcs * 17;
+    if (max_size > ivars->scratch_cap) {
+        ivars->scratch_cap = max_size;
+        ivars->scratch = (char*)REALLOCATE(ivars->scratch, max_size);
+    }
+    char *ptr = ivars->scratch;
+    *ptr++ = (char)((node->is_final ? FST_FINAL : 0)
+                    | (num_arcs ? FST_HAS_ARCS : 0));
+    if (num_arcs) {
+        *ptr++ = (char)(num_arcs - 1);
+        *ptr++ = (char)((out_width << 4) | addr_width);
+    }
+    if (node->is_final) {
+        NumUtil_encode_cu64(node->final_output, &ptr);
+    }
+    for (uint32_t i = 0; i < num_arcs; i++) {
+        *ptr++ = (char)node->labels[i];
+    }
+    for (uint32_t i = 0; i < num_arcs; i++) {
+        S_encode_width(node->outputs[i], out_width, &ptr);
+        S_encode_width(node->targets[i], addr_width, &ptr);
+    }
+    const size_t size = (size_t)(ptr - ivars->scratch);
+
+    // FNV-1a.
+    uint64_t hash = UINT64_C(0xCBF29CE484222325);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (uint8_t)ivars->scratch[i];
+        hash *= UINT64_C(0x100000001B3);
+    }
+
+    // Reuse an identical node if there is one.
+    S_NodeSlot   *slots = (S_NodeSlot*)ivars->node_table;
+    const size_t  mask  = ivars->node_table_cap - 1;
+    size_t        tick  = (size_t)hash & mask;
+    while (slots[tick].size) {
+        if (slots[tick].hash == hash
+            && slots[tick].size == size
+            && memcmp(ivars->buf + slots[tick].addr, ivars->scratch, size) == 0
+           ) {
+            return slots[tick].addr;
+        }
+        tick = (tick + 1) & mask;
+    }
+
+    // Append a new node.
+    if (ivars->buf_size + size > ivars->buf_cap) {
+        ivars->buf_cap = (ivars->buf_size + size) * 2;
+        ivars->buf = (char*)REALLOCATE(ivars->buf, ivars->buf_cap);
+    }
+    const uint64_t addr = ivars->buf_size;
+    memcpy(ivars->buf + addr, ivars->scratch, size);
+    ivars->buf_size += size;
+
+    slots[tick].hash = hash;
+    slots[tick].addr = addr;
+    slots[tick].size = size;
+    if (++ivars->num_nodes * 3 > ivars->node_table_cap * 2) {
+        S_grow_node_table(ivars);
+    }
+
+    return addr;
+}
+
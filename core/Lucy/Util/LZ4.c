@@ -0,0 +1,180 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_LZ4
+#include "Lucy/Util/ToolSet.h"
+
+#include <string.h>
+
+#include "Lucy/Util/LZ4.h"
+
+// Format constants.  Matches are at least MIN_MATCH bytes long, the last
+// LAST_LITERALS bytes of input are always emitted as literals, and no match
+// may start within MF_LIMIT bytes of the end.
+#define MIN_MATCH     4
+#define LAST_LITERALS 5
+#define MF_LIMIT      12
+#define HASH_LOG      12
+#define MAX_DISTANCE  65535
+
+// Unaligned load.
+static uint32_t
+S_read32(const uint8_t *ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static uint32_t
+S_hash(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+static uint8_t*
+S_write_length(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+size_t
+LZ4_compress_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+size_t
+LZ4_compress(const char *source, size_t len, char *dest) {
+    const uint8_t *const src = (const uint8_t*)source;
+    uint8_t  *op     = (uint8_t*)dest;
+    size_t    anchor = 0;
+    size_t    ip     = 0;
+    uint32_t  table[1 << HASH_LOG];
+
+    memset(table, 0, sizeof(table));
+    if (len > MF_LIMIT) {
+        const size_t match_limit = len - LAST_LITERALS;
+        while (ip < len - MF_LIMIT) {
+            uint32_t sequence = S_read32(src + ip);
+            uint32_t hash     = S_hash(sequence);
+            size_t   ref      = table[hash];
+            table[hash] = (uint32_t)ip + 1;
+            if (ref == 0
+                || ip - (ref - 1) > MAX_DISTANCE
+                || S_read32(src + ref - 1) != sequence
+               ) {
+                ip++;
+                continue;
+            }
+            ref--;
+
+            // Extend the match forwards, then backwards.
+            size_t match_len = MIN_MATCH;
+            while (ip + match_len < match_limit
+                   && src[ref + match_len] == src[ip + match_len]
+                  ) {
+                match_len++;
+            }
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+                match_len++;
+            }
+
+            // Emit the sequence: token, literals, offset, match length.
+            size_t   lit_len = ip - anchor;
+            size_t   extra   = match_len - MIN_MATCH;
+            uint8_t *token   = op++;
+            *token = (uint8_t)(((lit_len < 15 ? lit_len : 15) << 4)
+                               | (extra < 15 ? extra : 15));
+            if (lit_len >= 15) { op = S_write_length(op, lit_len - 15); }
+            memcpy(op, src + anchor, lit_len);
+            op += lit_len;
+            size_t offset = ip - ref;
+            *op++ = (uint8_t)(offset & 0xFF);
+            *op++ = (uint8_t)(offset >> 8);
+            if (extra >= 15) { op = S_write_length(op, extra - 15); }
+
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    // The final sequence is all literals.
+    size_t lit_len = len - anchor;
+    *op++ = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15) { op = S_write_length(op, lit_len - 15); }
+    memcpy(op, src + anchor, lit_len);
+    op += lit_len;
+
+    return (size_t)(op - (uint8_t*)dest);
+}
+
+bool
+LZ4_decompress(const char *source, size_t len, char *dest, size_t dest_len) {
+    const uint8_t *ip      = (const uint8_t*)source;
+    const uint8_t *ip_end  = ip + len;
+    uint8_t       *op      = (uint8_t*)dest;
+    uint8_t *const op_end  = op + dest_len;
+
+    while (ip < ip_end) {
+        uint32_t token   = *ip++;
+        size_t   lit_len = token >> 4;
+        if (lit_len == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= ip_end) { return false; }
+                byte = *ip++;
+                lit_len += byte;
+            } while (byte == 255);
+        }
+        if ((size_t)(ip_end - ip) < lit_len
+            || (size_t)(op_end - op) < lit_len
+           ) {
+            return false;
+        }
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip == ip_end) { break; }
+
+        // Copy the match, which may overlap its own output.
+        if (ip_end - ip < 2) { return false; }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - (uint8_t*)dest)) {
+            return false;
+        }
+        size_t match_len = token & 0xF;
+        if (match_len == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= ip_end) { return false; }
+                byte = *ip++;
+                match_len += byte;
+            } while (byte == 255);
+        }
+        match_len += MIN_MATCH;
+        if ((size_t)(op_end - op) < match_len) { return false; }
+        const uint8_t *match = op - offset;
+        for (size_t i = 0; i < match_len; i++) { op[i] = match[i]; }
+        op += match_len;
+    }
+
+    return op == op_end;
+}
@@ -19,6 +19,48 @@
 
 #include "Lucy/Util/SortExternal.h"
 #include "Clownfish/Util/SortUtils.h"
+#include "Lucy/Util/Threads.h"
+
+// Smallest number of items worth handing to a thread of its own.
+#define MIN_ITEMS_PER_THREAD 4096
+
+// An item paired with its key prefix.
+typedef struct {
+    uint64_t  prefix;
+    Obj      *item;
+} S_SortEntry;
+
+// Shared state for sorting the buffer in chunks.
+typedef struct {
+    SortExternal          *self;
+    SortEx_Compare_t       compare;
+    SortEx_Key_Prefix_t    key_prefix;
+    Obj                  **items;
+    Obj                  **dest;
+    Obj                  **item_scratch;
+    S_SortEntry           *entries;
+    S_SortEntry           *entry_scratch;
+    uint32_t               num_items;
+    uint32_t               num_chunks;
+} S_SortContext;
+
+// One of the sorted sequences feeding a merge, with the prefix of the item
+// at its head.
+typedef struct {
+    Obj      **cur;
+    Obj      **limit;
+    uint64_t   prefix;
+} S_MergeSource;
+
+// A tournament tree over the merge sources.  Each internal node holds the
+// loser of the match played there; the overall winner is kept apart.
+typedef struct {
+    SortExternal          *self;
+    SortEx_Compare_t       compare;
+    S_MergeSource         *sources;
+    uint32_t              *losers;
+    uint32_t               num_sources;
+} S_LoserTree;
 
 // Refill the main buffer, drawing from the buffers of all runs.
 static void
@@ -30,11 +72,10 @@ static void
 S_absorb_slices(SortExternal *self, SortExternalIVARS *ivars,
                 Obj **endpost);
 
+// Merge several sorted slices into `dest`.
 static void
-S_merge(SortExternal *self,
-        Obj **left_ptr,  size_t left_size,
-        Obj **right_ptr, size_t right_size,
-        Obj **dest, SortEx_Compare_t compare);
+S_merge_slices(SortExternal *self, Obj ***slice_starts,
+               uint32_t *slice_sizes, uint32_t num_slices, Obj **dest);
 
 // Return the address for the item in one of the runs' buffers which is the
 // highest in sort order, but which we can guarantee is lower in sort order
@@ -58,9 +99,12 @@ SortEx_init(SortExternal *self) {
     ivars->buf_tick     = 0;
     ivars->scratch      = NULL;
     ivars->scratch_cap  = 0;
+    ivars->entries      = NULL;
+    ivars->entries_cap  = 0;
     ivars->runs         = Vec_new(0);
     ivars->slice_sizes  = NULL;
     ivars->slice_starts = NULL;
+    ivars->num_threads  = 1;
     ivars->flipped      = false;
 
     ABSTRACT_CLASS_CHECK(self, SORTEXTERNAL);
@@ -71,6 +115,7 @@ void
 SortEx_Destroy_IMP(SortExternal *self) {
     SortExternalIVARS *const ivars = SortEx_IVARS(self);
     FREEMEM(ivars->scratch);
+    FREEMEM(ivars->entries);
     FREEMEM(ivars->slice_sizes);
     FREEMEM(ivars->slice_starts);
     if (ivars->buffer) {
@@ -132,6 +177,54 @@ SortEx_Peek_IMP(SortExternal *self) {
     return SI_peek(self, ivars);
 }
 
+static int
+S_compare_entries(void *context, const void *va, const void *vb) {
+    S_SortContext *const sort_context = (S_SortContext*)context;
+    const S_SortEntry *a = (const S_SortEntry*)va;
+    const S_SortEntry *b = (const S_SortEntry*)vb;
+    if (a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    return sort_context->compare(sort_context->self, (Obj**)&a->item,
+                                 (Obj**)&b->item);
+}
+
+// Sort one chunk of the buffer.  May run on a worker thread.
+static void
+S_sort_chunk(void *context, uint32_t tick) {
+    S_SortContext *const sort_context = (S_SortContext*)context;
+    const uint64_t num_items  = sort_context->num_items;
+    const uint32_t num_chunks = sort_context->num_chunks;
+    const uint32_t start = (uint32_t)(num_items * tick / num_chunks);
+    const uint32_t end   = (uint32_t)(num_items * (tick + 1) / num_chunks);
+    // Without key prefixes, sort the items themselves.
+    if (!sort_context->key_prefix) {
+        Obj **items = sort_context->items + start;
+        Sort_mergesort(items, sort_context->item_scratch + start,
+                       end - start, sizeof(Obj*),
+                       (CFISH_Sort_Compare_t)sort_context->compare,
+                       sort_context->self);
+        if (sort_context->dest != sort_context->items) {
+            memcpy(sort_context->dest + start, items,
+                   (end - start) * sizeof(Obj*));
+        }
+        return;
+    }
+
+    S_SortEntry *const entries = sort_context->entries + start;
+    for (uint32_t i = start; i < end; i++) {
+        Obj *item = sort_context->items[i];
+        entries[i - start].item   = item;
+        entries[i - start].prefix
+            = sort_context->key_prefix(sort_context->self, item);
+    }
+    Sort_mergesort(entries, sort_context->entry_scratch + start, end - start,
+                   sizeof(S_SortEntry), S_compare_entries, sort_context);
+    for (uint32_t i = start; i < end; i++) {
+        sort_context->dest[i] = entries[i - start].item;
+    }
+}
+
 void
 SortEx_Sort_Buffer_IMP(SortExternal *self) {
     SortExternalIVARS *const ivars = SortEx_IVARS(self);
@@ -140,16 +233,78 @@ SortEx_Sort_Buffer_IMP(SortExternal *self) {
     }
     if (ivars->buf_max != 0) {
         Class *klass = SortEx_get_class(self);
-        CFISH_Sort_Compare_t compare
-            = (CFISH_Sort_Compare_t)METHOD_PTR(klass, LUCY_SortEx_Compare);
-        if (ivars->scratch_cap < ivars->buf_cap) {
+        const uint32_t num_items = ivars->buf_max;
+        uint32_t num_chunks = 1;
+        if (ivars->num_threads > 1 && Threads_available()) {
+            num_chunks = num_items / MIN_ITEMS_PER_THREAD;
+            if (num_chunks > ivars->num_threads) {
+                num_chunks = ivars->num_threads;
+            }
+            if (num_chunks < 1) { num_chunks = 1; }
+        }
+        // Key prefixes only pay off when a subclass supplies them.
+        SortEx_Key_Prefix_t key_prefix
+            = METHOD_PTR(klass, LUCY_SortEx_Key_Prefix);
+        if (key_prefix == (SortEx_Key_Prefix_t)SortEx_Key_Prefix_IMP) {
+            key_prefix = NULL;
+        }
+        if ((num_chunks > 1 || !key_prefix)
+            && ivars->scratch_cap < ivars->buf_cap
+           ) {
             ivars->scratch_cap = ivars->buf_cap;
             ivars->scratch
                 = (Obj**)REALLOCATE(ivars->scratch,
                                     ivars->scratch_cap * sizeof(Obj*));
         }
-        Sort_mergesort(ivars->buffer, ivars->scratch, ivars->buf_max,
-                       sizeof(Obj*), compare, self);
+        if (key_prefix && ivars->entries_cap < ivars->buf_cap) {
+            ivars->entries_cap = ivars->buf_cap;
+            ivars->entries
+                = REALLOCATE(ivars->entries,
+                             2 * (size_t)ivars->entries_cap
+                             * sizeof(S_SortEntry));
+        }
+
+        // Sort each chunk on its own, then merge the chunks back into the
+        // buffer.  The buffer itself must stay put: PostingPool lends it to
+        // a run before sorting.
+        S_SortContext context;
+        context.self          = self;
+        context.compare       = METHOD_PTR(klass, LUCY_SortEx_Compare);
+        context.key_prefix    = key_prefix;
+        context.items         = ivars->buffer;
+        context.dest          = num_chunks > 1
+                                ? ivars->scratch
+                                : ivars->buffer;
+        context.item_scratch  = ivars->scratch;
+        context.entries       = (S_SortEntry*)ivars->entries;
+        context.entry_scratch = context.entries
+                                ? context.entries + ivars->entries_cap
+                                : NULL;
+        context.num_items     = num_items;
+        context.num_chunks    = num_chunks;
+        if (num_chunks > 1) {
+            Threads_run(num_chunks, num_chunks, S_sort_chunk, &context);
+        }
+        else {
+            S_sort_chunk(&context, 0);
+        }
+
+        if (num_chunks > 1) {
+            Obj    ***starts = (Obj***)MALLOCATE(num_chunks * sizeof(Obj**));
+            uint32_t *sizes  = (uint32_t*)MALLOCATE(num_chunks
+                                                    * sizeof(uint32_t));
+            for (uint32_t i = 0; i < num_chunks; i++) {
+                uint32_t start = (uint32_t)((uint64_t)num_items * i
+                                            / num_chunks);
+                uint32_t end   = (uint32_t)((uint64_t)num_items * (i + 1)
+                                            / num_chunks);
+                starts[i] = ivars->scratch + start;
+                sizes[i]  = end - start;
+            }
+            S_merge_slices(self, starts, sizes, num_chunks, ivars->buffer);
+            FREEMEM(sizes);
+            FREEMEM(starts);
+        }
     }
 }
 
@@ -196,6 +351,9 @@ SortEx_Shrink_IMP(SortExternal *self) {
     ivars->scratch_cap = 0;
     FREEMEM(ivars->scratch);
     ivars->scratch = NULL;
+    ivars->entries_cap = 0;
+    FREEMEM(ivars->entries);
+    ivars->entries = NULL;
 
     for (size_t i = 0, max = Vec_Get_Size(ivars->runs); i < max; i++) {
         SortExternal *run = (SortExternal*)Vec_Fetch(ivars->runs, i);
@@ -265,8 +423,6 @@ S_absorb_slices(SortExternal *self, SortExternalIVARS *ivars,
     size_t      num_runs     = Vec_Get_Size(ivars->runs);
     Obj      ***slice_starts = ivars->slice_starts;
     uint32_t   *slice_sizes  = ivars->slice_sizes;
-    Class      *klass        = SortEx_get_class(self);
-    SortEx_Compare_t compare = METHOD_PTR(klass, LUCY_SortEx_Compare);
 
     if (ivars->buf_max != 0) { THROW(ERR, "Can't refill unless empty"); }
 
@@ -297,88 +453,92 @@ S_absorb_slices(SortExternal *self, SortExternalIVARS *ivars,
     }
     ivars->buf_max = total_size;
 
-    if (num_slices == 1) {
-        // Copy single slice content from run buffer to main buffer.
-        memcpy(ivars->buffer, slice_starts[0], total_size * sizeof(Obj*));
-        return;
-    }
+    S_merge_slices(self, slice_starts, slice_sizes, num_slices,
+                   ivars->buffer);
+}
 
-    // There are more than two slices to merge.
-    if (ivars->scratch_cap < total_size) {
-        ivars->scratch_cap = total_size;
-        ivars->scratch = (Obj**)REALLOCATE(
-                            ivars->scratch, ivars->scratch_cap * sizeof(Obj*));
+// Return true if the head of source `a` sorts before the head of source
+// `b`.  Exhausted sources sort after everything else, and ties go to the
+// lower-numbered source, which keeps the merge stable.
+static CFISH_INLINE bool
+SI_beats(S_LoserTree *tree, uint32_t a, uint32_t b) {
+    S_MergeSource *const source_a = tree->sources + a;
+    S_MergeSource *const source_b = tree->sources + b;
+    if (source_a->cur == source_a->limit) { return false; }
+    if (source_b->cur == source_b->limit) { return true; }
+    if (source_a->prefix != source_b->prefix) {
+        return source_a->prefix < source_b->prefix;
     }
+    int comparison = tree->compare(tree->self, source_a->cur, source_b->cur);
+    return comparison < 0 || (comparison == 0 && a < b);
+}
 
-    // Divide-and-conquer k-way merge.
-    while (num_slices > 1) {
-        uint32_t i = 0;
-        uint32_t j = 0;
-        Obj **dest = ivars->scratch;
-
-        while (i < num_slices) {
-            if (num_slices - i >= 2) {
-                // Merge two consecutive slices.
-                const uint32_t merged_size = slice_sizes[i] + slice_sizes[i + 1];
-                S_merge(self,
-                        slice_starts[i], slice_sizes[i],
-                        slice_starts[i + 1], slice_sizes[i + 1],
-                        dest, compare);
-                slice_sizes[j]  = merged_size;
-                slice_starts[j] = dest;
-                dest += merged_size;
-                i += 2;
-                j += 1;
-            }
-            else if (num_slices - i >= 1) {
-                // Move last slice.
-                memcpy(dest, slice_starts[i], slice_sizes[i] * sizeof(Obj*));
-                slice_sizes[j]  = slice_sizes[i];
-                slice_starts[j] = dest;
-                i += 1;
-                j += 1;
-            }
-        }
-        num_slices = j;
-
-        // Swap scratch and buffer.
-        Obj      **tmp_buf = ivars->buffer;
-        uint32_t   tmp_cap = ivars->buf_cap;
-        ivars->buffer      = ivars->scratch;
-        ivars->buf_cap     = ivars->scratch_cap;
-        ivars->scratch     = tmp_buf;
-        ivars->scratch_cap = tmp_cap;
+// Play the matches below `node`, recording the losers, and return the
+// winner.  Leaves are numbered from `num_sources` up.
+static uint32_t
+S_build_tree(S_LoserTree *tree, uint32_t node) {
+    if (node >= tree->num_sources) { return node - tree->num_sources; }
+    uint32_t left  = S_build_tree(tree, node * 2);
+    uint32_t right = S_build_tree(tree, node * 2 + 1);
+    if (SI_beats(tree, right, left)) {
+        tree->losers[node] = left;
+        return right;
+    }
+    else {
+        tree->losers[node] = right;
+        return left;
     }
 }
 
-// Assumes left_size > 0 and right_size > 0.
 static void
-S_merge(SortExternal *self,
-        Obj **left_ptr,  size_t left_size,
-        Obj **right_ptr, size_t right_size,
-        Obj **dest, SortEx_Compare_t compare) {
-
-    Obj **left_limit  = left_ptr  + left_size;
-    Obj **right_limit = right_ptr + right_size;
-
-    while (1) {
-        if (compare(self, left_ptr, right_ptr) <= 0) {
-            *dest++ = *left_ptr++;
-            if (left_ptr >= left_limit) {
-                right_size = (size_t)(right_limit - right_ptr);
-                memcpy(dest, right_ptr, right_size * sizeof(Obj*));
-                break;
-            }
+S_merge_slices(SortExternal *self, Obj ***slice_starts,
+               uint32_t *slice_sizes, uint32_t num_slices, Obj **dest) {
+    if (num_slices == 1) {
+        memcpy(dest, slice_starts[0], slice_sizes[0] * sizeof(Obj*));
+        return;
+    }
+
+    Class *klass = SortEx_get_class(self);
+    SortEx_Key_Prefix_t key_prefix
+        = METHOD_PTR(klass, LUCY_SortEx_Key_Prefix);
+    S_LoserTree tree;
+    tree.self        = self;
+    tree.compare     = METHOD_PTR(klass, LUCY_SortEx_Compare);
+    tree.num_sources = num_slices;
+    tree.sources     = (S_MergeSource*)MALLOCATE(num_slices
+                                                 * sizeof(S_MergeSource));
+    tree.losers      = (uint32_t*)MALLOCATE(num_slices * sizeof(uint32_t));
+
+    // Each item's prefix gets computed once, when it reaches the head of its
+    // source, so most matches never look at the items themselves.
+    size_t total_size = 0;
+    for (uint32_t i = 0; i < num_slices; i++) {
+        S_MergeSource *source = tree.sources + i;
+        source->cur    = slice_starts[i];
+        source->limit  = slice_starts[i] + slice_sizes[i];
+        source->prefix = key_prefix(self, *source->cur);
+        total_size += slice_sizes[i];
+    }
+
+    // After taking the winner's head, replay its path up the tree.
+    uint32_t winner = S_build_tree(&tree, 1);
+    for (size_t i = 0; i < total_size; i++) {
+        S_MergeSource *source = tree.sources + winner;
+        *dest++ = *source->cur++;
+        if (source->cur < source->limit) {
+            source->prefix = key_prefix(self, *source->cur);
         }
-        else {
-            *dest++ = *right_ptr++;
-            if (right_ptr >= right_limit) {
-                left_size = (size_t)(left_limit - left_ptr);
-                memcpy(dest, left_ptr, left_size * sizeof(Obj*));
-                break;
+        for (uint32_t node = (winner + num_slices) / 2; node > 0; node /= 2) {
+            uint32_t loser = tree.losers[node];
+            if (SI_beats(&tree, loser, winner)) {
+                tree.losers[node] = winner;
+                winner = loser;
             }
         }
     }
+
+    FREEMEM(tree.losers);
+    FREEMEM(tree.sources);
 }
 
 void
@@ -418,6 +578,34 @@ SortEx_Set_Mem_Thresh_IMP(SortExternal *self, uint32_t mem_thresh) {
     SortEx_IVARS(self)->mem_thresh = mem_thresh;
 }
 
+void
+SortEx_Set_Num_Threads_IMP(SortExternal *self, uint32_t num_threads) {
+    SortEx_IVARS(self)->num_threads = num_threads ? num_threads : 1;
+}
+
+uint32_t
+SortEx_Get_Num_Threads_IMP(SortExternal *self) {
+    return SortEx_IVARS(self)->num_threads;
+}
+
+uint64_t
+SortEx_Key_Prefix_IMP(SortExternal *self, Obj *item) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(item);
+    return 0;
+}
+
+uint64_t
+SortEx_bytes_prefix(const void *bytes, size_t size) {
+    const uint8_t *const buf = (const uint8_t*)bytes;
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        prefix <<= 8;
+        if (i < size) { prefix |= buf[i]; }
+    }
+    return prefix;
+}
+
 uint32_t
 SortEx_Buffer_Count_IMP(SortExternal *self) {
     SortExternalIVARS *const ivars = SortEx_IVARS(self);
@@ -0,0 +1,180 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_LUCY_THREADS
+
+#include "charmony.h"
+
+#include <stdlib.h>
+
+#include "Lucy/Util/Threads.h"
+
+/********************************* WINDOWS ********************************/
+#if (defined(CHY_HAS_WINDOWS_H) && !defined(__CYGWIN__))
+
+#include <windows.h>
+
+#define LUCY_HAS_THREADS
+#define LOCK_T               CRITICAL_SECTION
+#define LOCK_INIT(lock)      InitializeCriticalSection(lock)
+#define LOCK_DESTROY(lock)   DeleteCriticalSection(lock)
+#define LOCK_ACQUIRE(lock)   EnterCriticalSection(lock)
+#define LOCK_RELEASE(lock)   LeaveCriticalSection(lock)
+#define THREAD_T             HANDLE
+
+/********************************* UNIXEN *********************************/
+#elif defined(CHY_HAS_PTHREAD_H)
+
+#include <pthread.h>
+
+#define LUCY_HAS_THREADS
+#define LOCK_T               pthread_mutex_t
+#define LOCK_INIT(lock)      pthread_mutex_init(lock, NULL)
+#define LOCK_DESTROY(lock)   pthread_mutex_destroy(lock)
+#define LOCK_ACQUIRE(lock)   pthread_mutex_lock(lock)
+#define LOCK_RELEASE(lock)   pthread_mutex_unlock(lock)
+#define THREAD_T             pthread_t
+
+#endif // OS switch.
+
+#ifdef LUCY_HAS_THREADS
+
+typedef struct {
+    LUCY_Threads_Task_t  task;
+    void                *context;
+    uint32_t             num_ticks;
+    uint32_t             next_tick;
+    LOCK_T               lock;
+} lucy_ThreadsPool;
+
+// Claim ticks one at a time until there are none left.
+static void
+S_work(lucy_ThreadsPool *pool) {
+    while (1) {
+        LOCK_ACQUIRE(&pool->lock);
+        uint32_t tick = pool->next_tick;
+        if (tick < pool->num_ticks) { pool->next_tick++; }
+        LOCK_RELEASE(&pool->lock);
+        if (tick >= pool->num_ticks) { return; }
+        pool->task(pool->context, tick);
+    }
+}
+
+#if (defined(CHY_HAS_WINDOWS_H) && !defined(__CYGWIN__))
+
+static DWORD WINAPI
+S_thread_main(LPVOID arg) {
+    S_work((lucy_ThreadsPool*)arg);
+    return 0;
+}
+
+static bool
+S_thread_start(THREAD_T *thread, lucy_ThreadsPool *pool) {
+    *thread = CreateThread(NULL, 0, S_thread_main, pool, 0, NULL);
+    return *thread != NULL;
+}
+
+static void
+S_thread_join(THREAD_T thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+#else
+
+static void*
+S_thread_main(void *arg) {
+    S_work((lucy_ThreadsPool*)arg);
+    return NULL;
+}
+
+static bool
+S_thread_start(THREAD_T *thread, lucy_ThreadsPool *pool) {
+    return pthread_create(thread, NULL, S_thread_main, pool) == 0;
+}
+
+static void
+S_thread_join(THREAD_T thread) {
+    pthread_join(thread, NULL);
+}
+
+#endif
+
+void
+lucy_Threads_run(uint32_t num_ticks, uint32_t num_threads,
+                 LUCY_Threads_Task_t task, void *context) {
+    if (num_threads > num_ticks) { num_threads = num_ticks; }
+    if (num_threads <= 1) {
+        for (uint32_t tick = 0; tick < num_ticks; tick++) {
+            task(context, tick);
+        }
+        return;
+    }
+
+    lucy_ThreadsPool pool;
+    pool.task      = task;
+    pool.context   = context;
+    pool.num_ticks = num_ticks;
+    pool.next_tick = 0;
+    LOCK_INIT(&pool.lock);
+
+    // The calling thread works too, so start one fewer helper.  If a helper
+    // can't be started, the others simply pick up its share.
+    uint32_t  num_helpers = num_threads - 1;
+    THREAD_T *helpers = (THREAD_T*)malloc(num_helpers * sizeof(THREAD_T));
+    uint32_t  num_started = 0;
+    if (helpers) {
+        while (num_started < num_helpers
+               && S_thread_start(helpers + num_started, &pool)
+              ) {
+            num_started++;
+        }
+    }
+
+    S_work(&pool);
+
+    for (uint32_t i = 0; i < num_started; i++) {
+        S_thread_join(helpers[i]);
+    }
+    free(helpers);
+    LOCK_DESTROY(&pool.lock);
+}
+
+bool
+lucy_Threads_available() {
+    return true;
+}
+
+/******************************* NO THREADS *******************************/
+#else
+
+void
+lucy_Threads_run(uint32_t num_ticks, uint32_t num_threads,
+                 LUCY_Threads_Task_t task, void *context) {
+    (void)num_threads;
+    for (uint32_t tick = 0; tick < num_ticks; tick++) {
+        task(context, tick);
+    }
+}
+
+bool
+lucy_Threads_available() {
+    return false;
+}
+
+#endif // LUCY_HAS_THREADS
+
+
@@ -24,6 +24,7 @@
 #include "Lucy/Index/PostingList.h"
 #include "Lucy/Index/Similarity.h"
 #include "Lucy/Search/Compiler.h"
+#include "Lucy/Search/PhraseMatcher.h"
 
 
 ProximityMatcher*
@@ -280,23 +281,23 @@ ProximityMatcher_Calc_Proximity_Freq_IMP(ProximityMatcher *self) {
     size_t    amount        = anchors_remaining * sizeof(uint32_t);
     uint32_t *anchors_start = (uint32_t*)BB_Grow(ivars->anchor_set, amount);
     uint32_t *anchors_end   = anchors_start + anchors_remaining;
-    memcpy(anchors_start, post_ivars->prox, amount);
+    memcpy(anchors_start, ScorePost_Get_Prox(posting), amount);
 
     // Match the positions of other terms against the anchor set.
     for (uint32_t i = 1, max = ivars->num_elements; i < max; i++) {
         // Get the array of positions for the next term.  Unlike the anchor
         // set (which is a copy), these won't be overwritten.
         ScorePosting *next_post = (ScorePosting*)PList_Get_Posting(plists[i]);
-        ScorePostingIVARS *const next_post_ivars = ScorePost_IVARS(next_post);
-        uint32_t *candidates_start = next_post_ivars->prox;
-        uint32_t *candidates_end   = candidates_start + next_post_ivars->freq;
+        uint32_t *candidates_start = ScorePost_Get_Prox(next_post);
+        uint32_t  num_candidates   = ScorePost_IVARS(next_post)->freq;
+        uint32_t *candidates_end   = candidates_start + num_candidates;
 
         // Splice out anchors that don't match the next term.  Bail out if
         // we've eliminated all possible anchors.
         if (ivars->within == 1) { // exact phrase match
-            anchors_remaining = SI_winnow_anchors(anchors_start, anchors_end,
-                                                  candidates_start,
-                                                  candidates_end, i, 1);
+            anchors_remaining = PhraseMatcher_winnow_anchors(
+                                    anchors_start, anchors_remaining,
+                                    candidates_start, num_candidates, i);
         }
         else {  // fuzzy-phrase match
             anchors_remaining = SI_winnow_anchors(anchors_start, anchors_end,
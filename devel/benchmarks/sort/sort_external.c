@@ -0,0 +1,138 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Time a large external sort on one thread and on several.
+ *
+ * Feeds --items random keys shaped like serialized postings (a term,
+ * a doc id, a position) to a BlobSortEx with a --mem-thresh byte budget,
+ * so the buffer gets sorted and flushed into runs many times, then merges
+ * the runs back out.  Each thread count is timed --reps times and the
+ * median is reported.
+ *
+ *     $ ./sort_external --items=2000000 --mem-thresh=16777216 \
+ *     > --threads=4 --reps=5
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define LUCY_USE_SHORT_NAMES
+#include "Clownfish/Blob.h"
+#include "Lucy/Util/BlobSortEx.h"
+
+static unsigned long
+S_arg(int argc, char **argv, const char *name, unsigned long fallback) {
+    size_t name_len = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], name, name_len) == 0
+            && argv[i][name_len] == '='
+           ) {
+            return strtoul(argv[i] + name_len + 1, NULL, 10);
+        }
+    }
+    return fallback;
+}
+
+static double
+S_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int
+S_compare_doubles(const void *va, const void *vb) {
+    double a = *(const double*)va;
+    double b = *(const double*)vb;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+// Build a key like "term00042\0" followed by big-endian doc id and position,
+// drawing terms from a Zipf-ish distribution so that some are very common.
+static Blob*
+S_fake_posting(unsigned long *seed, unsigned long num_terms) {
+    char buf[24];
+    *seed = *seed * 6364136223846793005UL + 1442695040888963407UL;
+    unsigned long r    = *seed >> 17;
+    unsigned long term = (r % num_terms) % ((r >> 20) % num_terms + 1);
+    unsigned long doc  = (r >> 8) & 0xFFFFF;
+    int len = sprintf(buf, "term%05lu", term) + 1;
+    buf[len++] = (char)((doc >> 16) & 0xFF);
+    buf[len++] = (char)((doc >> 8) & 0xFF);
+    buf[len++] = (char)(doc & 0xFF);
+    buf[len++] = (char)(r & 0xFF);
+    return Blob_new(buf, (size_t)len);
+}
+
+static double
+S_time_sort(unsigned long num_items, uint32_t mem_thresh,
+            uint32_t num_threads) {
+    BlobSortEx *sortex = BlobSortEx_new(mem_thresh, NULL);
+    BlobSortEx_Set_Num_Threads(sortex, num_threads);
+    unsigned long seed = 42;
+
+    double start = S_now();
+    for (unsigned long i = 0; i < num_items; i++) {
+        BlobSortEx_Feed(sortex, (Obj*)S_fake_posting(&seed, 50000));
+    }
+    BlobSortEx_Flip(sortex);
+    unsigned long count = 0;
+    Obj *item;
+    while (NULL != (item = BlobSortEx_Fetch(sortex))) {
+        DECREF(item);
+        count++;
+    }
+    double elapsed = S_now() - start;
+
+    if (count != num_items) {
+        fprintf(stderr, "Fetched %lu of %lu items\n", count, num_items);
+        exit(1);
+    }
+    DECREF(sortex);
+    return elapsed;
+}
+
+int
+main(int argc, char **argv) {
+    unsigned long num_items  = S_arg(argc, argv, "--items", 2000000);
+    unsigned long mem_thresh = S_arg(argc, argv, "--mem-thresh", 0x1000000);
+    unsigned long threads    = S_arg(argc, argv, "--threads", 4);
+    unsigned long reps       = S_arg(argc, argv, "--reps", 5);
+    if (reps == 0) { reps = 1; }
+
+    lucy_bootstrap_parcel();
+
+    double *times = (double*)malloc(reps * sizeof(double));
+    unsigned long thread_counts[2] = { 1, threads };
+    double medians[2];
+    for (int i = 0; i < 2; i++) {
+        for (unsigned long rep = 0; rep < reps; rep++) {
+            times[rep] = S_time_sort(num_items, (uint32_t)mem_thresh,
+                                     (uint32_t)thread_counts[i]);
+        }
+        qsort(times, reps, sizeof(double), S_compare_doubles);
+        medians[i] = times[reps / 2];
+        printf("%-3lu thread(s): %8.3f secs (median of %lu)\n",
+               thread_counts[i], medians[i], reps);
+    }
+    printf("speedup: %.2fx\n", medians[0] / medians[1]);
+
+    free(times);
+    return 0;
+}
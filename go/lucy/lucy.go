@@ -463,16 +463,12 @@ func doReadDocData(ddrC *C.lucy_DefaultDocReader, docID int32, doc interface{})
 
 	ivars := C.lucy_DefDocReader_IVARS(ddrC)
 	schema := ivars.schema
-	datInstream := ivars.dat_in
-	ixInstream := ivars.ix_in
+	datInstream := C.LUCY_DefDocReader_Doc_Stream(ddrC, C.int32_t(docID))
 	fieldNameCap := C.size_t(31)
 	var fieldName *C.char = ((*C.char)(C.malloc(fieldNameCap + 1)))
 	defer C.free(unsafe.Pointer(fieldName))
 
-	// Get data file pointer from index, read number of fields.
-	C.LUCY_InStream_Seek(ixInstream, C.int64_t(docID*8))
-	start := C.LUCY_InStream_Read_U64(ixInstream)
-	C.LUCY_InStream_Seek(datInstream, C.int64_t(start))
+	// Read number of fields.
 	numFields := uint32(C.LUCY_InStream_Read_CU32(datInstream))
 
 	// Decode stored data and build up the doc field by field.
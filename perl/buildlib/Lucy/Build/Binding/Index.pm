@@ -26,6 +26,7 @@ sub bind_all {
     $class->bind_datawriter;
     $class->bind_deletionswriter;
     $class->bind_docreader;
+    $class->bind_docvaluesreader;
     $class->bind_indexmanager;
     $class->bind_indexreader;
     $class->bind_indexer;
@@ -213,6 +214,26 @@ END_SYNOPSIS
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_docvaluesreader {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $dv_reader = $seg_reader->obtain("Lucy::Index::DocValuesReader");
+    my $price     = $dv_reader->fetch_value(
+        field  => 'price',
+        doc_id => $doc_id,
+    );
+END_SYNOPSIS
+    $pod_spec->set_synopsis($synopsis);
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Index::DocValuesReader",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_indexmanager {
     my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
     my $synopsis = <<'END_SYNOPSIS';
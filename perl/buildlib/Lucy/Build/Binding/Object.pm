@@ -23,6 +23,7 @@ sub bind_all {
     my $class = shift;
     $class->bind_bitvector;
     $class->bind_i32array;
+    $class->bind_roaringbitvector;
 }
 
 sub bind_bitvector {
@@ -52,6 +53,29 @@ END_CONSTRUCTOR
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_roaringbitvector {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $bit_vec = Lucy::Object::RoaringBitVector->new;
+    $bit_vec->set($_) for ( 3, 70_000, 5_000_000 );
+    print $bit_vec->count, "\n";                  # prints 3
+    print $bit_vec->next_hit(4), "\n";            # prints 70000
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $bit_vec = Lucy::Object::RoaringBitVector->new;
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Object::RoaringBitVector",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_i32array {
     my $xs_code = <<'END_XS_CODE';
 MODULE = Lucy PACKAGE = Lucy::Object::I32Array
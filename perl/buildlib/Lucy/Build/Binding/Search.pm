@@ -25,19 +25,25 @@ sub bind_all {
     $class->bind_collector;
     $class->bind_bitcollector;
     $class->bind_compiler;
+    $class->bind_facetcollector;
+    $class->bind_filterquery;
+    $class->bind_fuzzyquery;
     $class->bind_hits;
     $class->bind_indexsearcher;
     $class->bind_leafquery;
     $class->bind_matchallquery;
     $class->bind_matcher;
+    $class->bind_multitermquery;
     $class->bind_notquery;
     $class->bind_nomatchquery;
+    $class->bind_numericrangequery;
     $class->bind_orquery;
     $class->bind_parserelem;
     $class->bind_phrasequery;
     $class->bind_phrasecompiler;
     $class->bind_polyquery;
     $class->bind_polysearcher;
+    $class->bind_prefixquery;
     $class->bind_query;
     $class->bind_queryparser;
     $class->bind_rangequery;
@@ -48,6 +54,7 @@ sub bind_all {
     $class->bind_span;
     $class->bind_termquery;
     $class->bind_termcompiler;
+    $class->bind_wildcardquery;
 }
 
 sub bind_andquery {
@@ -195,6 +202,104 @@ END_CONSTRUCTOR_POD
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_facetcollector {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $facet_collector = Lucy::Search::Collector::FacetCollector->new(
+        field       => 'category',
+        num_buckets => 5,
+    );
+    $searcher->collect(
+        collector => $facet_collector,
+        query     => $query,
+    );
+    for my $category ( @{ $facet_collector->top_values } ) {
+        my $count = $facet_collector->get_count($category);
+        print "$category ($count)\n";
+    }
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $facet_collector = Lucy::Search::Collector::FacetCollector->new(
+        field       => 'category',    # required
+        num_buckets => 10,            # default: 10
+    );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor, );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Search::Collector::FacetCollector",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
+sub bind_filterquery {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $in_stock_filter = Lucy::Search::FilterQuery->new(
+        query => Lucy::Search::TermQuery->new(
+            field => 'in_stock',
+            term  => 'yes',
+        ),
+    );
+    my $in_stock_query = Lucy::Search::ANDQuery->new(
+        children => [ $query, $in_stock_filter ],
+    );
+    my $hits = $searcher->hits( query => $in_stock_query );
+    ...
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $filter_query = Lucy::Search::FilterQuery->new(
+        query => $query,
+    );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor, );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Search::FilterQuery",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
+sub bind_fuzzyquery {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $fuzzy_query = Lucy::Search::FuzzyQuery->new(
+        field => 'title',
+        term  => 'lucy',
+    );
+    my $hits = $searcher->hits( query => $fuzzy_query );
+    ...
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $fuzzy_query = Lucy::Search::FuzzyQuery->new(
+        field         => 'title',    # required
+        term          => 'lucy',     # required
+        max_edits     => 1,          # default 2
+        prefix_length => 1,          # default 0
+        max_terms     => 20,         # default 50
+        rewrite       => Lucy::Search::MultiTermQuery::CONSTANT_SCORE,
+    );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor, );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Search::FuzzyQuery",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_hits {
     my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
     my $synopsis = <<'END_SYNOPSIS';
@@ -324,6 +429,44 @@ END_CONSTRUCTOR_POD
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_multitermquery {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $query = Lucy::Search::PrefixQuery->new(
+        field   => 'title',
+        prefix  => 'luc',
+        rewrite => Lucy::Search::MultiTermQuery::TOP_TERMS,
+    );
+    my $rewritten = $query->rewrite( $searcher->get_reader );
+END_SYNOPSIS
+    $pod_spec->set_synopsis($synopsis);
+
+    my $xs_code = <<'END_XS_CODE';
+MODULE = Lucy   PACKAGE = Lucy::Search::MultiTermQuery
+
+int32_t
+CONSTANT_SCORE()
+CODE:
+    RETVAL = lucy_MultiTermQuery_CONSTANT_SCORE;
+OUTPUT: RETVAL
+
+int32_t
+TOP_TERMS()
+CODE:
+    RETVAL = lucy_MultiTermQuery_TOP_TERMS;
+OUTPUT: RETVAL
+END_XS_CODE
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Search::MultiTermQuery",
+    );
+    $binding->append_xs($xs_code);
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_notquery {
     my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
     my $synopsis = <<'END_SYNOPSIS';
@@ -369,6 +512,40 @@ END_CONSTRUCTOR
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_numericrangequery {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    # Match all products priced from 10 up to but not including 20.
+    my $price_query = Lucy::Search::NumericRangeQuery->new(
+        field         => 'price',
+        lower_term    => 10,
+        upper_term    => 20,
+        include_upper => 0,
+    );
+    my $hits = $searcher->hits( query => $price_query );
+    ...
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $numeric_range_query = Lucy::Search::NumericRangeQuery->new(
+        field         => 'weight',    # required
+        lower_term    => 0.5,         # see below
+        upper_term    => 2,           # see below
+        include_lower => 0,           # default true
+        include_upper => 0,           # default true
+    );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor, );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Search::NumericRangeQuery",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_orquery {
     my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
     my $synopsis = <<'END_SYNOPSIS';
@@ -565,6 +742,36 @@ END_CONSTRUCTOR
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_prefixquery {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $prefix_query = Lucy::Search::PrefixQuery->new(
+        field  => 'title',
+        prefix => 'luc',
+    );
+    my $hits = $searcher->hits( query => $prefix_query );
+    ...
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $prefix_query = Lucy::Search::PrefixQuery->new(
+        field     => 'title',    # required
+        prefix    => 'luc',      # required
+        max_terms => 20,         # default 50
+        rewrite   => Lucy::Search::MultiTermQuery::TOP_TERMS,
+    );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor, );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Search::PrefixQuery",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_query {
     my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
     my $synopsis = <<'END_SYNOPSIS';
@@ -899,4 +1106,34 @@ sub bind_termcompiler {
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_wildcardquery {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $wildcard_query = Lucy::Search::WildcardQuery->new(
+        field   => 'title',
+        pattern => 'l?c*',
+    );
+    my $hits = $searcher->hits( query => $wildcard_query );
+    ...
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $wildcard_query = Lucy::Search::WildcardQuery->new(
+        field     => 'title',    # required
+        pattern   => 'l?c*',     # required
+        max_terms => 20,         # default 50
+        rewrite   => Lucy::Search::MultiTermQuery::TOP_TERMS,
+    );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor, );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Search::WildcardQuery",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 1;
@@ -23,6 +23,7 @@ sub bind_all {
     my $class = shift;
     $class->bind_fsfilehandle;
     $class->bind_fsfolder;
+    $class->bind_fslockfactory;
     $class->bind_filehandle;
     $class->bind_folder;
     $class->bind_instream;
@@ -303,6 +304,41 @@ END_SYNOPSIS
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_fslockfactory {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    use Sys::Hostname qw( hostname );
+    my $hostname = hostname() or die "Can't get unique hostname";
+    my $folder = Lucy::Store::FSFolder->new(
+        path => '/path/to/index',
+    );
+    my $lock_factory = Lucy::Store::FSLockFactory->new(
+        folder => $folder,
+        host   => $hostname,
+    );
+    my $manager = Lucy::Index::IndexManager->new(
+        host         => $hostname,
+        lock_factory => $lock_factory,
+    );
+END_SYNOPSIS
+    my $constructor = <<'END_CONSTRUCTOR';
+    my $lock_factory = Lucy::Store::FSLockFactory->new(
+        folder => $folder,      # required
+        host   => $hostname,    # required
+    );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor( alias => 'new', sample => $constructor, );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        parcel     => "Lucy",
+        class_name => "Lucy::Store::FSLockFactory",
+    );
+    $binding->set_pod_spec($pod_spec);
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_lockfactory {
     my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
     my $synopsis = <<'END_SYNOPSIS';
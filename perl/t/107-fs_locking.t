@@ -0,0 +1,72 @@
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.
+# The ASF licenses this file to You under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License.  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+use strict;
+use warnings;
+use lib 'buildlib';
+
+use Time::HiRes qw( sleep time );
+use Test::More;
+use File::Spec::Functions qw( catfile );
+use Lucy::Test::TestUtils qw( init_test_index_loc );
+
+BEGIN {
+    if ( $^O =~ /(mswin|cygwin)/i ) {
+        plan( 'skip_all', "fork on Windows not supported by Lucy" );
+    }
+    else {
+        plan( tests => 4 );
+    }
+}
+
+my $path   = init_test_index_loc();
+my $folder = Lucy::Store::FSFolder->new( path => $path );
+my $lock_factory = Lucy::Store::FSLockFactory->new(
+    folder => $folder,
+    host   => '',
+);
+my $ready_path = catfile( $path, 'child_ready' );
+unlink $ready_path;
+
+sub make_lock {
+    return $lock_factory->make_lock( name => 'foo', @_ );
+}
+
+# Fork a process which holds the lock for a while, then exits without
+# releasing it.
+my $pid = fork();
+if ( $pid == 0 ) {    # child
+    my $lock = make_lock();
+    $lock->obtain or die "no dice";
+    open( my $fh, '>', $ready_path ) or die $!;
+    close $fh;
+    sleep 1;
+    exit;
+}
+sleep .05 until -e $ready_path;
+
+my $lock = make_lock( timeout => 0 );
+ok( $lock->is_locked, "child holds lock" );
+ok( !$lock->request, "can't take lock held by child" );
+
+# The wait should end when the child exits, not at the timeout.
+$lock = make_lock( timeout => 20_000 );
+my $start = time;
+ok( $lock->obtain, "obtain once child exits" );
+cmp_ok( time - $start, '<', 10, "woke up when the lock was dropped" );
+$lock->release;
+
+waitpid( $pid, 0 );
+unlink $ready_path;
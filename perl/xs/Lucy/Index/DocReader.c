@@ -32,17 +32,12 @@ LUCY_DefDocReader_Fetch_Doc_IMP(lucy_DefaultDocReader *self, int32_t doc_id) {
     dTHX;
     lucy_DefaultDocReaderIVARS *const ivars = lucy_DefDocReader_IVARS(self);
     lucy_Schema   *const schema = ivars->schema;
-    lucy_InStream *const dat_in = ivars->dat_in;
-    lucy_InStream *const ix_in  = ivars->ix_in;
+    lucy_InStream *const dat_in = LUCY_DefDocReader_Doc_Stream(self, doc_id);
     HV *fields = newHV();
-    int64_t start;
     uint32_t num_fields;
     SV *field_name_sv = newSV(1);
 
-    // Get data file pointer from index, read number of fields.
-    LUCY_InStream_Seek(ix_in, (int64_t)doc_id * 8);
-    start = LUCY_InStream_Read_U64(ix_in);
-    LUCY_InStream_Seek(dat_in, start);
+    // Read number of fields.
     num_fields = LUCY_InStream_Read_CU32(dat_in);
 
     // Decode stored data and build up the doc field by field.